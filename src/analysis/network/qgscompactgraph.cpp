@@ -0,0 +1,110 @@
+/***************************************************************************
+  qgscompactgraph.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgscompactgraph.h"
+#include "qgsgraph.h"
+
+#include <algorithm>
+#include <limits>
+
+QgsCompactGraph::QgsCompactGraph()
+  : mChecksum( calculateChecksum() )
+{
+}
+
+QgsCompactGraph::QgsCompactGraph( const QgsGraph *graph, int strategyIndex )
+{
+  const int vertexCount = graph->vertexCount();
+  const int edgeCount = graph->edgeCount();
+
+  mPoints.reserve( vertexCount );
+  for ( int i = 0; i < vertexCount; ++i )
+    mPoints.emplace_back( graph->vertex( i ).point() );
+
+  mEdgeSources.resize( edgeCount );
+  mEdgeTargets.resize( edgeCount );
+  mEdgeCosts.resize( edgeCount );
+  mOutgoingOffsets.assign( vertexCount + 1, 0 );
+  mIncomingOffsets.assign( vertexCount + 1, 0 );
+
+  double minimumCostPerDistance = std::numeric_limits< double >::max();
+  for ( int i = 0; i < edgeCount; ++i )
+  {
+    const QgsGraphEdge &edge = graph->edge( i );
+    mEdgeSources[i] = edge.fromVertex();
+    mEdgeTargets[i] = edge.toVertex();
+    mEdgeCosts[i] = edge.cost( strategyIndex ).toDouble();
+    mOutgoingOffsets[ edge.fromVertex() + 1 ]++;
+    mIncomingOffsets[ edge.toVertex() + 1 ]++;
+
+    const double length = mPoints[ edge.fromVertex() ].distance( mPoints[ edge.toVertex() ] );
+    if ( length > 0 )
+      minimumCostPerDistance = std::min( minimumCostPerDistance, mEdgeCosts[i] / length );
+  }
+  mMinimumCostPerDistance = minimumCostPerDistance < std::numeric_limits< double >::max() ? std::max( minimumCostPerDistance, 0.0 ) : 0;
+
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    mOutgoingOffsets[ i + 1 ] += mOutgoingOffsets[i];
+    mIncomingOffsets[ i + 1 ] += mIncomingOffsets[i];
+  }
+
+  // fill the arcs in edge order, so that the arcs of each vertex keep the order of the source graph
+  mOutgoingArcs.resize( edgeCount );
+  mIncomingArcs.resize( edgeCount );
+  std::vector< int > outgoingPosition( mOutgoingOffsets.begin(), mOutgoingOffsets.end() - 1 );
+  std::vector< int > incomingPosition( mIncomingOffsets.begin(), mIncomingOffsets.end() - 1 );
+  for ( int i = 0; i < edgeCount; ++i )
+  {
+    Arc &outgoing = mOutgoingArcs[ outgoingPosition[ mEdgeSources[i] ]++ ];
+    outgoing.vertex = mEdgeTargets[i];
+    outgoing.edge = i;
+    outgoing.cost = mEdgeCosts[i];
+
+    Arc &incoming = mIncomingArcs[ incomingPosition[ mEdgeTargets[i] ]++ ];
+    incoming.vertex = mEdgeSources[i];
+    incoming.edge = i;
+    incoming.cost = mEdgeCosts[i];
+  }
+
+  mChecksum = calculateChecksum();
+}
+
+quint64 QgsCompactGraph::calculateChecksum() const
+{
+  // FNV-1a hash of the graph structure and costs
+  quint64 hash = 14695981039346656037ULL;
+  auto add = [&hash]( const void *data, std::size_t size )
+  {
+    const unsigned char *bytes = static_cast< const unsigned char * >( data );
+    for ( std::size_t i = 0; i < size; ++i )
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+  };
+
+  const int vertexCount = this->vertexCount();
+  const int edgeCount = this->edgeCount();
+  add( &vertexCount, sizeof( int ) );
+  add( &edgeCount, sizeof( int ) );
+  for ( int i = 0; i < edgeCount; ++i )
+  {
+    add( &mEdgeSources[i], sizeof( int ) );
+    add( &mEdgeTargets[i], sizeof( int ) );
+    add( &mEdgeCosts[i], sizeof( double ) );
+  }
+  return hash;
+}
@@ -0,0 +1,184 @@
+/***************************************************************************
+  qgscompactgraph.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSCOMPACTGRAPH_H
+#define QGSCOMPACTGRAPH_H
+
+#define SIP_NO_FILE
+
+#include "qgis_analysis.h"
+#include "qgspointxy.h"
+
+#include <vector>
+
+class QgsGraph;
+
+/**
+ * \ingroup analysis
+ * \class QgsCompactGraph
+ * \brief A read-only copy of a QgsGraph for a single cost strategy, stored in compressed
+ * sparse row form for fast shortest path searches.
+ *
+ * The arcs leaving each vertex are stored contiguously, together with their cost converted
+ * to a double, so that searches don't need to access the QVariant costs of the QgsGraph edges.
+ * The arcs entering each vertex are also stored, for searches on the reversed graph.
+ *
+ * Vertex and edge indices match the indices of the source QgsGraph.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class ANALYSIS_EXPORT QgsCompactGraph
+{
+  public:
+
+    /**
+     * An arc stored in a QgsCompactGraph.
+     */
+    struct Arc
+    {
+      //! Index of the vertex at the other end of the arc
+      int vertex = -1;
+      //! Index of the matching edge in the source graph
+      int edge = -1;
+      //! Arc cost
+      double cost = 0;
+    };
+
+    /**
+     * A range of arcs, which can be used in range-based for loops.
+     */
+    class ArcRange
+    {
+      public:
+
+        //! Constructor for ArcRange, for the arcs from \a begin to \a end
+        ArcRange( const Arc *begin, const Arc *end )
+          : mBegin( begin )
+          , mEnd( end )
+        {}
+
+        //! Returns a pointer to the first arc of the range
+        const Arc *begin() const { return mBegin; }
+        //! Returns a pointer past the last arc of the range
+        const Arc *end() const { return mEnd; }
+
+      private:
+        const Arc *mBegin = nullptr;
+        const Arc *mEnd = nullptr;
+    };
+
+    /**
+     * Constructor for an empty QgsCompactGraph.
+     */
+    QgsCompactGraph();
+
+    /**
+     * Constructor for QgsCompactGraph, copying the vertices and edges of a \a graph
+     * with the costs calculated by the strategy with matching \a strategyIndex.
+     */
+    QgsCompactGraph( const QgsGraph *graph, int strategyIndex );
+
+    /**
+     * Returns the number of vertices in the graph.
+     */
+    int vertexCount() const { return static_cast< int >( mPoints.size() ); }
+
+    /**
+     * Returns the number of edges in the graph.
+     */
+    int edgeCount() const { return static_cast< int >( mEdgeSources.size() ); }
+
+    /**
+     * Returns the point associated with the vertex at index \a vertex.
+     */
+    const QgsPointXY &point( int vertex ) const { return mPoints[ vertex ]; }
+
+    /**
+     * Returns the index of the vertex at the start of the edge at index \a edge.
+     */
+    int edgeSource( int edge ) const { return mEdgeSources[ edge ]; }
+
+    /**
+     * Returns the index of the vertex at the end of the edge at index \a edge.
+     */
+    int edgeTarget( int edge ) const { return mEdgeTargets[ edge ]; }
+
+    /**
+     * Returns the cost of the edge at index \a edge.
+     */
+    double edgeCost( int edge ) const { return mEdgeCosts[ edge ]; }
+
+    /**
+     * Returns the arcs leaving the vertex at index \a vertex. The vertex of each arc is the vertex at its end.
+     */
+    ArcRange outgoingArcs( int vertex ) const
+    {
+      return ArcRange( mOutgoingArcs.data() + mOutgoingOffsets[ vertex ], mOutgoingArcs.data() + mOutgoingOffsets[ vertex + 1 ] );
+    }
+
+    /**
+     * Returns the arcs entering the vertex at index \a vertex. The vertex of each arc is the vertex at its start.
+     */
+    ArcRange incomingArcs( int vertex ) const
+    {
+      return ArcRange( mIncomingArcs.data() + mIncomingOffsets[ vertex ], mIncomingArcs.data() + mIncomingOffsets[ vertex + 1 ] );
+    }
+
+    /**
+     * Returns a lower bound of the cost of any path between two vertices, which can be used as the
+     * heuristic of A* searches.
+     *
+     * The bound is proportional to the straight line distance between the vertices, using the lowest ratio
+     * of cost to straight line length of all edges of the graph.
+     */
+    double costLowerBound( int vertex1, int vertex2 ) const
+    {
+      return mMinimumCostPerDistance > 0 ? mMinimumCostPerDistance * mPoints[ vertex1 ].distance( mPoints[ vertex2 ] ) : 0;
+    }
+
+    /**
+     * Returns a checksum of the structure and costs of the graph, which can be used to check
+     * whether data calculated for a graph matches another graph.
+     *
+     * The checksum is calculated when the graph is created, so this is cheap to call.
+     */
+    quint64 checksum() const { return mChecksum; }
+
+  private:
+
+    //! Calculates the checksum of the graph structure and costs
+    quint64 calculateChecksum() const;
+
+    std::vector< QgsPointXY > mPoints;
+
+    std::vector< int > mEdgeSources;
+    std::vector< int > mEdgeTargets;
+    std::vector< double > mEdgeCosts;
+
+    //! Index of the first outgoing arc of each vertex, followed by the total arc count
+    std::vector< int > mOutgoingOffsets;
+    std::vector< Arc > mOutgoingArcs;
+
+    //! Index of the first incoming arc of each vertex, followed by the total arc count
+    std::vector< int > mIncomingOffsets;
+    std::vector< Arc > mIncomingArcs;
+
+    double mMinimumCostPerDistance = 0;
+
+    quint64 mChecksum = 0;
+};
+
+#endif // QGSCOMPACTGRAPH_H
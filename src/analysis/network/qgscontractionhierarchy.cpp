@@ -0,0 +1,441 @@
+/***************************************************************************
+  qgscontractionhierarchy.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgscontractionhierarchy.h"
+#include "qgscompactgraph.h"
+#include "qgsfeedback.h"
+
+#include <QDataStream>
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+
+///@cond PRIVATE
+
+// file format identification
+static const quint32 HIERARCHY_FILE_MAGIC = 0x51434831; // "QCH1"
+static const qint32 HIERARCHY_FILE_VERSION = 1;
+
+// maximum number of vertices settled by a witness search, beyond which a shortcut is added anyway
+static const int WITNESS_SEARCH_SETTLED_LIMIT = 500;
+
+typedef QgsContractionHierarchy::Arc Arc;
+
+/**
+ * The remaining graph during the contraction of a graph.
+ */
+class ContractionGraph
+{
+  public:
+
+    explicit ContractionGraph( const QgsCompactGraph &graph )
+      : mOutgoing( graph.vertexCount() )
+      , mIncoming( graph.vertexCount() )
+    {
+      const int edgeCount = graph.edgeCount();
+      for ( int i = 0; i < edgeCount; ++i )
+      {
+        const int from = graph.edgeSource( i );
+        const int to = graph.edgeTarget( i );
+        if ( from == to )
+          continue;
+
+        addArc( from, to, i, -1, graph.edgeCost( i ) );
+      }
+    }
+
+    //! Adds an arc, or lowers the cost of an existing arc between the same vertices. Returns TRUE if a new arc was added.
+    bool addArc( int from, int to, int edge, int middle, double cost )
+    {
+      std::vector< Arc > &outgoing = mOutgoing[ from ];
+      auto it = std::find_if( outgoing.begin(), outgoing.end(), [to]( const Arc & arc ) { return arc.vertex == to; } );
+      if ( it != outgoing.end() )
+      {
+        if ( it->cost <= cost )
+          return false;
+
+        it->edge = edge;
+        it->middle = middle;
+        it->cost = cost;
+
+        std::vector< Arc > &incoming = mIncoming[ to ];
+        auto inIt = std::find_if( incoming.begin(), incoming.end(), [from]( const Arc & arc ) { return arc.vertex == from; } );
+        inIt->edge = edge;
+        inIt->middle = middle;
+        inIt->cost = cost;
+        return false;
+      }
+
+      outgoing.emplace_back( Arc{ to, edge, middle, cost } );
+      mIncoming[ to ].emplace_back( Arc{ from, edge, middle, cost } );
+      return true;
+    }
+
+    //! Removes a vertex from the graph, after its arcs were copied to the hierarchy
+    void removeVertex( int vertex )
+    {
+      for ( const Arc &arc : mIncoming[ vertex ] )
+      {
+        std::vector< Arc > &outgoing = mOutgoing[ arc.vertex ];
+        outgoing.erase( std::remove_if( outgoing.begin(), outgoing.end(), [vertex]( const Arc & a ) { return a.vertex == vertex; } ), outgoing.end() );
+      }
+      for ( const Arc &arc : mOutgoing[ vertex ] )
+      {
+        std::vector< Arc > &incoming = mIncoming[ arc.vertex ];
+        incoming.erase( std::remove_if( incoming.begin(), incoming.end(), [vertex]( const Arc & a ) { return a.vertex == vertex; } ), incoming.end() );
+      }
+      std::vector< Arc >().swap( mIncoming[ vertex ] );
+      std::vector< Arc >().swap( mOutgoing[ vertex ] );
+    }
+
+    const std::vector< Arc > &outgoing( int vertex ) const { return mOutgoing[ vertex ]; }
+    const std::vector< Arc > &incoming( int vertex ) const { return mIncoming[ vertex ]; }
+
+  private:
+
+    std::vector< std::vector< Arc > > mOutgoing;
+    std::vector< std::vector< Arc > > mIncoming;
+};
+
+/**
+ * A limited Dijkstra search in the remaining graph, looking for paths which make a shortcut unnecessary.
+ */
+class WitnessSearch
+{
+  public:
+
+    explicit WitnessSearch( int vertexCount )
+      : mCosts( vertexCount, std::numeric_limits< double >::infinity() )
+    {}
+
+    //! Searches paths from \a source avoiding \a excludedVertex, up to \a maxCost
+    void run( const ContractionGraph &graph, int source, int excludedVertex, double maxCost )
+    {
+      for ( int vertex : mTouched )
+        mCosts[ vertex ] = std::numeric_limits< double >::infinity();
+      mTouched.clear();
+
+      typedef std::pair< double, int > Entry;
+      std::priority_queue< Entry, std::vector< Entry >, std::greater< Entry > > queue;
+      mCosts[ source ] = 0;
+      mTouched.emplace_back( source );
+      queue.push( Entry( 0, source ) );
+
+      int settled = 0;
+      while ( !queue.empty() && settled < WITNESS_SEARCH_SETTLED_LIMIT )
+      {
+        const Entry entry = queue.top();
+        queue.pop();
+        if ( entry.first > mCosts[ entry.second ] )
+          continue;
+        if ( entry.first > maxCost )
+          break;
+
+        ++settled;
+        for ( const Arc &arc : graph.outgoing( entry.second ) )
+        {
+          if ( arc.vertex == excludedVertex )
+            continue;
+
+          const double cost = entry.first + arc.cost;
+          if ( cost < mCosts[ arc.vertex ] )
+          {
+            if ( std::isinf( mCosts[ arc.vertex ] ) )
+              mTouched.emplace_back( arc.vertex );
+            mCosts[ arc.vertex ] = cost;
+            queue.push( Entry( cost, arc.vertex ) );
+          }
+        }
+      }
+    }
+
+    //! Returns the cost of the best path found to \a vertex, which may not be the shortest one
+    double cost( int vertex ) const { return mCosts[ vertex ]; }
+
+  private:
+
+    std::vector< double > mCosts;
+    std::vector< int > mTouched;
+};
+
+/**
+ * Calculates the shortcuts required to contract \a vertex, and adds them to the \a graph if \a apply is TRUE.
+ * Returns the number of required shortcuts.
+ */
+static int contractVertex( ContractionGraph &graph, WitnessSearch &search, int vertex, bool apply )
+{
+  int shortcuts = 0;
+
+  // copy the arcs, as adding shortcuts may modify the arrays of the neighbors
+  const std::vector< Arc > incoming = graph.incoming( vertex );
+  const std::vector< Arc > outgoing = graph.outgoing( vertex );
+  for ( const Arc &in : incoming )
+  {
+    double maxOutgoingCost = -1;
+    for ( const Arc &out : outgoing )
+    {
+      if ( out.vertex != in.vertex )
+        maxOutgoingCost = std::max( maxOutgoingCost, out.cost );
+    }
+    if ( maxOutgoingCost < 0 )
+      continue;
+
+    search.run( graph, in.vertex, vertex, in.cost + maxOutgoingCost );
+
+    for ( const Arc &out : outgoing )
+    {
+      if ( out.vertex == in.vertex )
+        continue;
+
+      const double cost = in.cost + out.cost;
+      if ( search.cost( out.vertex ) <= cost )
+        continue;
+
+      ++shortcuts;
+      if ( apply )
+        graph.addArc( in.vertex, out.vertex, -1, vertex, cost );
+    }
+  }
+  return shortcuts;
+}
+
+// copies per vertex arc lists to compressed sparse row arrays
+static void flattenArcs( const std::vector< std::vector< Arc > > &arcs, std::vector< int > &offsets, std::vector< Arc > &flat )
+{
+  offsets.assign( arcs.size() + 1, 0 );
+  for ( std::size_t i = 0; i < arcs.size(); ++i )
+    offsets[ i + 1 ] = offsets[i] + static_cast< int >( arcs[i].size() );
+
+  flat.clear();
+  flat.reserve( offsets.back() );
+  for ( const std::vector< Arc > &vertexArcs : arcs )
+    flat.insert( flat.end(), vertexArcs.begin(), vertexArcs.end() );
+}
+
+static QDataStream &operator<<( QDataStream &stream, const Arc &arc )
+{
+  stream << static_cast< qint32 >( arc.vertex ) << static_cast< qint32 >( arc.edge ) << static_cast< qint32 >( arc.middle ) << arc.cost;
+  return stream;
+}
+
+static QDataStream &operator>>( QDataStream &stream, Arc &arc )
+{
+  qint32 vertex = -1;
+  qint32 edge = -1;
+  qint32 middle = -1;
+  stream >> vertex >> edge >> middle >> arc.cost;
+  arc.vertex = vertex;
+  arc.edge = edge;
+  arc.middle = middle;
+  return stream;
+}
+
+template <typename T>
+static void writeVector( QDataStream &stream, const std::vector< T > &values )
+{
+  stream << static_cast< quint64 >( values.size() );
+  for ( const T &value : values )
+    stream << value;
+}
+
+template <typename T>
+static bool readVector( QDataStream &stream, std::vector< T > &values )
+{
+  quint64 size = 0;
+  stream >> size;
+  if ( stream.status() != QDataStream::Ok )
+    return false;
+
+  values.clear();
+  values.reserve( size );
+  for ( quint64 i = 0; i < size && stream.status() == QDataStream::Ok; ++i )
+  {
+    T value;
+    stream >> value;
+    values.emplace_back( value );
+  }
+  return stream.status() == QDataStream::Ok;
+}
+
+///@endcond
+
+QgsContractionHierarchy::QgsContractionHierarchy( const QgsCompactGraph &graph, QgsFeedback *feedback )
+  : mGraphChecksum( graph.checksum() )
+{
+  const int vertexCount = graph.vertexCount();
+  ContractionGraph remaining( graph );
+  WitnessSearch search( vertexCount );
+
+  // vertices are contracted by increasing priority, favoring vertices which need few shortcuts
+  // and vertices whose neighbors were not contracted yet, to spread contractions uniformly over the graph
+  std::vector< int > contractedNeighbors( vertexCount, 0 );
+  auto priority = [&]( int vertex )
+  {
+    const int shortcuts = contractVertex( remaining, search, vertex, false );
+    const int arcCount = static_cast< int >( remaining.incoming( vertex ).size() + remaining.outgoing( vertex ).size() );
+    return 2 * shortcuts - arcCount + contractedNeighbors[ vertex ];
+  };
+
+  typedef std::pair< int, int > Entry;
+  std::priority_queue< Entry, std::vector< Entry >, std::greater< Entry > > queue;
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    if ( feedback && feedback->isCanceled() )
+      return;
+
+    queue.push( Entry( priority( i ), i ) );
+  }
+
+  mRanks.assign( vertexCount, -1 );
+  std::vector< std::vector< Arc > > upwardArcs( vertexCount );
+  std::vector< std::vector< Arc > > downwardArcs( vertexCount );
+
+  int rank = 0;
+  while ( !queue.empty() )
+  {
+    const int vertex = queue.top().second;
+    queue.pop();
+    if ( mRanks[ vertex ] >= 0 )
+      continue;
+
+    // priorities change as neighbors are contracted, so they are only updated lazily when a vertex reaches the top
+    const int currentPriority = priority( vertex );
+    if ( !queue.empty() && currentPriority > queue.top().first )
+    {
+      queue.push( Entry( currentPriority, vertex ) );
+      continue;
+    }
+
+    contractVertex( remaining, search, vertex, true );
+
+    // the remaining arcs of the vertex all lead to higher ranked vertices
+    upwardArcs[ vertex ] = remaining.outgoing( vertex );
+    downwardArcs[ vertex ] = remaining.incoming( vertex );
+    for ( const Arc &arc : upwardArcs[ vertex ] )
+      contractedNeighbors[ arc.vertex ]++;
+    for ( const Arc &arc : downwardArcs[ vertex ] )
+      contractedNeighbors[ arc.vertex ]++;
+
+    remaining.removeVertex( vertex );
+    mRanks[ vertex ] = rank++;
+
+    if ( feedback && rank % 1000 == 0 )
+    {
+      if ( feedback->isCanceled() )
+      {
+        mRanks.clear();
+        return;
+      }
+      feedback->setProgress( 100.0 * rank / vertexCount );
+    }
+  }
+
+  for ( const std::vector< Arc > &arcs : upwardArcs )
+    mShortcutCount += static_cast< int >( std::count_if( arcs.begin(), arcs.end(), []( const Arc & arc ) { return arc.edge < 0; } ) );
+  for ( const std::vector< Arc > &arcs : downwardArcs )
+    mShortcutCount += static_cast< int >( std::count_if( arcs.begin(), arcs.end(), []( const Arc & arc ) { return arc.edge < 0; } ) );
+
+  flattenArcs( upwardArcs, mUpwardOffsets, mUpwardArcs );
+  flattenArcs( downwardArcs, mDownwardOffsets, mDownwardArcs );
+  mValid = true;
+}
+
+bool QgsContractionHierarchy::isValidForGraph( const QgsCompactGraph &graph ) const
+{
+  return mValid && static_cast< int >( mRanks.size() ) == graph.vertexCount() && mGraphChecksum == graph.checksum();
+}
+
+void QgsContractionHierarchy::appendEdges( int from, int to, const Arc &arc, QVector<int> &edges ) const
+{
+  if ( arc.edge >= 0 )
+  {
+    edges.append( arc.edge );
+    return;
+  }
+
+  // a shortcut replaces the arcs from the start vertex to the middle vertex and from the middle vertex to the end vertex,
+  // which were stored with the middle vertex when it was contracted
+  const int middle = arc.middle;
+  for ( const Arc &first : downwardArcs( middle ) )
+  {
+    if ( first.vertex != from )
+      continue;
+
+    for ( const Arc &second : upwardArcs( middle ) )
+    {
+      if ( second.vertex != to )
+        continue;
+
+      appendEdges( from, middle, first, edges );
+      appendEdges( middle, to, second, edges );
+      return;
+    }
+  }
+}
+
+bool QgsContractionHierarchy::writeToFile( const QString &path ) const
+{
+  if ( !mValid )
+    return false;
+
+  QFile file( path );
+  if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream << HIERARCHY_FILE_MAGIC << HIERARCHY_FILE_VERSION << mGraphChecksum << static_cast< qint32 >( mShortcutCount );
+  writeVector( stream, mRanks );
+  writeVector( stream, mUpwardOffsets );
+  writeVector( stream, mUpwardArcs );
+  writeVector( stream, mDownwardOffsets );
+  writeVector( stream, mDownwardArcs );
+  return stream.status() == QDataStream::Ok;
+}
+
+bool QgsContractionHierarchy::readFromFile( const QString &path, const QgsCompactGraph &graph )
+{
+  mValid = false;
+
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  quint32 magic = 0;
+  qint32 version = 0;
+  quint64 checksum = 0;
+  qint32 shortcutCount = 0;
+  stream >> magic >> version >> checksum >> shortcutCount;
+  if ( stream.status() != QDataStream::Ok || magic != HIERARCHY_FILE_MAGIC || version != HIERARCHY_FILE_VERSION || checksum != graph.checksum() )
+    return false;
+
+  if ( !readVector( stream, mRanks ) || !readVector( stream, mUpwardOffsets ) || !readVector( stream, mUpwardArcs )
+       || !readVector( stream, mDownwardOffsets ) || !readVector( stream, mDownwardArcs ) )
+    return false;
+
+  const std::size_t vertexCount = static_cast< std::size_t >( graph.vertexCount() );
+  if ( mRanks.size() != vertexCount || mUpwardOffsets.size() != vertexCount + 1 || mDownwardOffsets.size() != vertexCount + 1
+       || static_cast< std::size_t >( mUpwardOffsets.back() ) != mUpwardArcs.size() || static_cast< std::size_t >( mDownwardOffsets.back() ) != mDownwardArcs.size() )
+    return false;
+
+  mGraphChecksum = checksum;
+  mShortcutCount = shortcutCount;
+  mValid = true;
+  return true;
+}
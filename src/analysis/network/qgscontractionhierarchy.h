@@ -0,0 +1,184 @@
+/***************************************************************************
+  qgscontractionhierarchy.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSCONTRACTIONHIERARCHY_H
+#define QGSCONTRACTIONHIERARCHY_H
+
+#define SIP_NO_FILE
+
+#include "qgis_analysis.h"
+
+#include <QString>
+#include <QVector>
+#include <vector>
+
+class QgsCompactGraph;
+class QgsFeedback;
+
+/**
+ * \ingroup analysis
+ * \class QgsContractionHierarchy
+ * \brief A contraction hierarchy calculated for a QgsCompactGraph, which speeds up shortest path
+ * queries between two vertices of the graph.
+ *
+ * The hierarchy is built by contracting the vertices of the graph one by one, adding shortcut arcs
+ * between the neighbors of a contracted vertex where the shortest path between them went through the vertex.
+ * Queries then only need to search arcs going to vertices contracted later than the current one, from both
+ * the start and end vertices (see QgsGraphAnalyzer::shortestPath()).
+ *
+ * Building a hierarchy is expensive, so hierarchies can be saved with writeToFile() and reused
+ * with readFromFile() for the same graph.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class ANALYSIS_EXPORT QgsContractionHierarchy
+{
+  public:
+
+    /**
+     * An arc of a contraction hierarchy, which is either an edge of the graph or a shortcut
+     * replacing two consecutive arcs.
+     */
+    struct Arc
+    {
+      //! Index of the vertex at the other end of the arc
+      int vertex = -1;
+      //! Index of the matching edge of the graph, or -1 for shortcuts
+      int edge = -1;
+      //! Index of the vertex bypassed by a shortcut, or -1 for edges
+      int middle = -1;
+      //! Arc cost
+      double cost = 0;
+    };
+
+    /**
+     * A range of arcs, which can be used in range-based for loops.
+     */
+    class ArcRange
+    {
+      public:
+
+        //! Constructor for ArcRange, for the arcs from \a begin to \a end
+        ArcRange( const Arc *begin, const Arc *end )
+          : mBegin( begin )
+          , mEnd( end )
+        {}
+
+        //! Returns a pointer to the first arc of the range
+        const Arc *begin() const { return mBegin; }
+        //! Returns a pointer past the last arc of the range
+        const Arc *end() const { return mEnd; }
+
+      private:
+        const Arc *mBegin = nullptr;
+        const Arc *mEnd = nullptr;
+    };
+
+    /**
+     * Constructor for an invalid QgsContractionHierarchy.
+     */
+    QgsContractionHierarchy() = default;
+
+    /**
+     * Constructor for QgsContractionHierarchy, which builds the hierarchy of a \a graph.
+     *
+     * The optional \a feedback argument can be used to report progress and to cancel the
+     * build, in which case the hierarchy is invalid.
+     */
+    explicit QgsContractionHierarchy( const QgsCompactGraph &graph, QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns TRUE if the hierarchy was successfully built or read.
+     */
+    bool isValid() const { return mValid; }
+
+    /**
+     * Returns TRUE if the hierarchy was built for the specified \a graph.
+     */
+    bool isValidForGraph( const QgsCompactGraph &graph ) const;
+
+    /**
+     * Returns the contraction rank of the vertex at index \a vertex. Vertices with a higher rank were contracted later.
+     */
+    int rank( int vertex ) const { return mRanks[ vertex ]; }
+
+    /**
+     * Returns the arcs leaving the vertex at index \a vertex towards vertices with a higher rank.
+     * The vertex of each arc is the vertex at its end.
+     */
+    ArcRange upwardArcs( int vertex ) const
+    {
+      return ArcRange( mUpwardArcs.data() + mUpwardOffsets[ vertex ], mUpwardArcs.data() + mUpwardOffsets[ vertex + 1 ] );
+    }
+
+    /**
+     * Returns the arcs entering the vertex at index \a vertex from vertices with a higher rank.
+     * The vertex of each arc is the vertex at its start.
+     */
+    ArcRange downwardArcs( int vertex ) const
+    {
+      return ArcRange( mDownwardArcs.data() + mDownwardOffsets[ vertex ], mDownwardArcs.data() + mDownwardOffsets[ vertex + 1 ] );
+    }
+
+    /**
+     * Returns the number of shortcuts added to the graph.
+     */
+    int shortcutCount() const { return mShortcutCount; }
+
+    /**
+     * Appends the indices of the graph edges which make up an \a arc going from the vertex at index \a from
+     * to the vertex at index \a to, to a list of \a edges.
+     */
+    void appendEdges( int from, int to, const Arc &arc, QVector< int > &edges ) const;
+
+    /**
+     * Writes the hierarchy to a file at the specified \a path.
+     *
+     * Returns FALSE if the file could not be written.
+     *
+     * \see readFromFile()
+     */
+    bool writeToFile( const QString &path ) const;
+
+    /**
+     * Reads a hierarchy previously written with writeToFile() from a file at the specified \a path.
+     *
+     * Returns FALSE if the file could not be read, or if it was written for a different \a graph.
+     *
+     * \see writeToFile()
+     */
+    bool readFromFile( const QString &path, const QgsCompactGraph &graph );
+
+  private:
+
+    bool mValid = false;
+
+    //! Checksum of the graph the hierarchy was built for
+    quint64 mGraphChecksum = 0;
+    int mShortcutCount = 0;
+
+    std::vector< int > mRanks;
+
+    //! Index of the first upward arc of each vertex, followed by the total arc count
+    std::vector< int > mUpwardOffsets;
+    std::vector< Arc > mUpwardArcs;
+
+    //! Index of the first downward arc of each vertex, followed by the total arc count
+    std::vector< int > mDownwardOffsets;
+    std::vector< Arc > mDownwardArcs;
+};
+
+#endif // QGSCONTRACTIONHIERARCHY_H
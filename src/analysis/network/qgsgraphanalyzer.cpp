@@ -14,6 +14,8 @@
 ***************************************************************************/
 
 #include <limits>
+#include <queue>
+#include <unordered_map>
 
 #include <QMap>
 #include <QVector>
@@ -21,6 +23,135 @@
 
 #include "qgsgraph.h"
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
+#include "qgscontractionhierarchy.h"
+
+///@cond PRIVATE
+
+//! An entry of the priority queue of a search
+struct SearchEntry
+{
+  //! Priority of the entry, the entry with the lowest key is processed first
+  double key;
+  //! Cost of the path to the vertex when the entry was created
+  double cost;
+  int vertex;
+  //! Insertion order, used to break ties
+  int sequence;
+};
+
+struct SearchEntryCompare
+{
+  bool operator()( const SearchEntry &a, const SearchEntry &b ) const
+  {
+    // among entries with the same key, the most recently inserted is processed first
+    return a.key > b.key || ( a.key == b.key && a.sequence < b.sequence );
+  }
+};
+
+typedef std::priority_queue< SearchEntry, std::vector< SearchEntry >, SearchEntryCompare > SearchQueue;
+
+//! The best path found to a vertex by a search
+struct SearchLabel
+{
+  double cost;
+  //! Index of the graph edge from the previous vertex of the path, or -1 for the first vertex
+  int edge;
+};
+
+//! The best path found to a vertex by a search of a contraction hierarchy
+struct HierarchySearchLabel
+{
+  double cost;
+  //! Index of the previous vertex of the path, or -1 for the first vertex
+  int previousVertex;
+  //! Hierarchy arc from the previous vertex
+  const QgsContractionHierarchy::Arc *arc;
+};
+
+static double hierarchyShortestPath( const QgsContractionHierarchy *hierarchy, int startVertexIdx, int endVertexIdx, QVector<int> *resultPath )
+{
+  // both searches only follow arcs towards higher ranked vertices, and meet at the highest ranked vertex of the path
+  std::unordered_map< int, HierarchySearchLabel > forward;
+  std::unordered_map< int, HierarchySearchLabel > backward;
+  SearchQueue forwardQueue;
+  SearchQueue backwardQueue;
+  int sequence = 0;
+
+  forward[ startVertexIdx ] = HierarchySearchLabel{ 0, -1, nullptr };
+  forwardQueue.push( SearchEntry{ 0, 0, startVertexIdx, sequence++ } );
+  backward[ endVertexIdx ] = HierarchySearchLabel{ 0, -1, nullptr };
+  backwardQueue.push( SearchEntry{ 0, 0, endVertexIdx, sequence++ } );
+
+  double bestCost = std::numeric_limits<double>::infinity();
+  int meetingVertex = -1;
+
+  while ( true )
+  {
+    const bool forwardActive = !forwardQueue.empty() && forwardQueue.top().key < bestCost;
+    const bool backwardActive = !backwardQueue.empty() && backwardQueue.top().key < bestCost;
+    if ( !forwardActive && !backwardActive )
+      break;
+
+    const bool isForward = forwardActive && ( !backwardActive || forwardQueue.top().key <= backwardQueue.top().key );
+    SearchQueue &queue = isForward ? forwardQueue : backwardQueue;
+    std::unordered_map< int, HierarchySearchLabel > &labels = isForward ? forward : backward;
+    const std::unordered_map< int, HierarchySearchLabel > &otherLabels = isForward ? backward : forward;
+
+    const SearchEntry entry = queue.top();
+    queue.pop();
+    if ( entry.cost > labels[ entry.vertex ].cost )
+      continue;
+
+    const QgsContractionHierarchy::ArcRange arcs = isForward ? hierarchy->upwardArcs( entry.vertex ) : hierarchy->downwardArcs( entry.vertex );
+    for ( const QgsContractionHierarchy::Arc &arc : arcs )
+    {
+      const double cost = entry.cost + arc.cost;
+      auto it = labels.find( arc.vertex );
+      if ( it != labels.end() && it->second.cost <= cost )
+        continue;
+
+      labels[ arc.vertex ] = HierarchySearchLabel{ cost, entry.vertex, &arc };
+      queue.push( SearchEntry{ cost, cost, arc.vertex, sequence++ } );
+
+      auto other = otherLabels.find( arc.vertex );
+      if ( other != otherLabels.end() && cost + other->second.cost < bestCost )
+      {
+        bestCost = cost + other->second.cost;
+        meetingVertex = arc.vertex;
+      }
+    }
+  }
+
+  if ( meetingVertex < 0 || !resultPath )
+    return bestCost;
+
+  QVector< int > reversedEdges;
+  int vertex = meetingVertex;
+  while ( vertex != startVertexIdx )
+  {
+    const HierarchySearchLabel &label = forward[ vertex ];
+    QVector< int > arcEdges;
+    hierarchy->appendEdges( label.previousVertex, vertex, *label.arc, arcEdges );
+    for ( int i = arcEdges.size() - 1; i >= 0; --i )
+      reversedEdges.append( arcEdges.at( i ) );
+    vertex = label.previousVertex;
+  }
+  for ( int i = reversedEdges.size() - 1; i >= 0; --i )
+    resultPath->append( reversedEdges.at( i ) );
+
+  vertex = meetingVertex;
+  while ( vertex != endVertexIdx )
+  {
+    const HierarchySearchLabel &label = backward[ vertex ];
+    hierarchy->appendEdges( vertex, label.previousVertex, *label.arc, *resultPath );
+    vertex = label.previousVertex;
+  }
+
+  return bestCost;
+}
+
+///@endcond
 
 void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int criterionNum, QVector<int> *resultTree, QVector<double> *resultCost )
 {
@@ -50,26 +181,33 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int
     resultTree->insert( resultTree->begin(), source->vertexCount(), -1 );
   }
 
-  // QMultiMap< cost, vertexIdx > not_begin
-  // I use it and don't create any struct or class
-  QMultiMap< double, int > not_begin;
-  QMultiMap< double, int >::iterator it;
+  // edge costs are converted from QVariant once, instead of on every relaxation
+  QVector< double > edgeCosts( source->edgeCount() );
+  for ( int i = 0; i < source->edgeCount(); ++i )
+  {
+    edgeCosts[ i ] = source->edge( i ).cost( criterionNum ).toDouble();
+  }
 
-  not_begin.insert( 0.0, startPointIdx );
+  // binary heap of vertices to visit, without decrease-key: outdated entries are skipped when popped
+  SearchQueue not_begin;
+  int sequence = 0;
+  not_begin.push( SearchEntry{ 0.0, 0.0, startPointIdx, sequence++ } );
 
   while ( !not_begin.empty() )
   {
-    it = not_begin.begin();
-    double curCost = it.key();
-    int curVertex = it.value();
-    not_begin.erase( it );
+    const SearchEntry entry = not_begin.top();
+    not_begin.pop();
+    const double curCost = entry.cost;
+    const int curVertex = entry.vertex;
+    if ( curCost > ( *result )[ curVertex ] )
+      continue;
 
     // edge index list
     const QgsGraphEdgeIds &outgoingEdges = source->vertex( curVertex ).outgoingEdges();
     for ( int edgeId : outgoingEdges )
     {
       const QgsGraphEdge &arc = source->edge( edgeId );
-      double cost = arc.cost( criterionNum ).toDouble() + curCost;
+      double cost = edgeCosts[ edgeId ] + curCost;
 
       if ( cost < ( *result )[ arc.toVertex()] )
       {
@@ -78,7 +216,7 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int
         {
           ( *resultTree )[ arc.toVertex()] = edgeId;
         }
-        not_begin.insert( cost, arc.toVertex() );
+        not_begin.push( SearchEntry{ cost, cost, arc.toVertex(), sequence++ } );
       }
     }
   }
@@ -88,6 +226,151 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int
   }
 }
 
+void QgsGraphAnalyzer::dijkstra( const QgsCompactGraph *source, int vertexIdx, QVector<int> *resultTree, QVector<double> *resultCost, bool reverse )
+{
+  if ( vertexIdx < 0 || vertexIdx >= source->vertexCount() )
+  {
+    // invalid start point
+    return;
+  }
+
+  QVector< double > costs( source->vertexCount(), std::numeric_limits<double>::infinity() );
+  costs[ vertexIdx ] = 0.0;
+
+  if ( resultTree )
+  {
+    resultTree->clear();
+    resultTree->insert( resultTree->begin(), source->vertexCount(), -1 );
+  }
+
+  SearchQueue queue;
+  int sequence = 0;
+  queue.push( SearchEntry{ 0.0, 0.0, vertexIdx, sequence++ } );
+
+  while ( !queue.empty() )
+  {
+    const SearchEntry entry = queue.top();
+    queue.pop();
+    if ( entry.cost > costs[ entry.vertex ] )
+      continue;
+
+    const QgsCompactGraph::ArcRange arcs = reverse ? source->incomingArcs( entry.vertex ) : source->outgoingArcs( entry.vertex );
+    for ( const QgsCompactGraph::Arc &arc : arcs )
+    {
+      const double cost = entry.cost + arc.cost;
+      if ( cost < costs[ arc.vertex ] )
+      {
+        costs[ arc.vertex ] = cost;
+        if ( resultTree )
+        {
+          ( *resultTree )[ arc.vertex ] = arc.edge;
+        }
+        queue.push( SearchEntry{ cost, cost, arc.vertex, sequence++ } );
+      }
+    }
+  }
+
+  if ( resultCost )
+  {
+    *resultCost = costs;
+  }
+}
+
+double QgsGraphAnalyzer::shortestPath( const QgsCompactGraph *source, int startVertexIdx, int endVertexIdx, QVector<int> *resultPath, const QgsContractionHierarchy *hierarchy )
+{
+  if ( resultPath )
+    resultPath->clear();
+
+  if ( startVertexIdx < 0 || startVertexIdx >= source->vertexCount() || endVertexIdx < 0 || endVertexIdx >= source->vertexCount() )
+    return std::numeric_limits<double>::infinity();
+
+  if ( startVertexIdx == endVertexIdx )
+    return 0.0;
+
+  // a hierarchy built for another graph would return wrong paths, or refer to vertices outside the graph
+  if ( hierarchy && hierarchy->isValidForGraph( *source ) )
+    return hierarchyShortestPath( hierarchy, startVertexIdx, endVertexIdx, resultPath );
+
+  // bidirectional A*, using the average of the forward and backward heuristics as potential so that
+  // both searches use consistent reduced costs, and can stop as soon as the sum of their smallest keys
+  // exceeds the cost of the best path found
+  auto potential = [source, startVertexIdx, endVertexIdx]( int vertex )
+  {
+    return ( source->costLowerBound( vertex, endVertexIdx ) - source->costLowerBound( startVertexIdx, vertex ) ) / 2;
+  };
+
+  std::unordered_map< int, SearchLabel > forward;
+  std::unordered_map< int, SearchLabel > backward;
+  SearchQueue forwardQueue;
+  SearchQueue backwardQueue;
+  int sequence = 0;
+
+  forward[ startVertexIdx ] = SearchLabel{ 0, -1 };
+  forwardQueue.push( SearchEntry{ potential( startVertexIdx ), 0, startVertexIdx, sequence++ } );
+  backward[ endVertexIdx ] = SearchLabel{ 0, -1 };
+  backwardQueue.push( SearchEntry{ -potential( endVertexIdx ), 0, endVertexIdx, sequence++ } );
+
+  double bestCost = std::numeric_limits<double>::infinity();
+  int meetingVertex = -1;
+
+  while ( !forwardQueue.empty() && !backwardQueue.empty() )
+  {
+    if ( forwardQueue.top().key + backwardQueue.top().key >= bestCost )
+      break;
+
+    // expand the smallest search
+    const bool isForward = forwardQueue.size() <= backwardQueue.size();
+    SearchQueue &queue = isForward ? forwardQueue : backwardQueue;
+    std::unordered_map< int, SearchLabel > &labels = isForward ? forward : backward;
+    const std::unordered_map< int, SearchLabel > &otherLabels = isForward ? backward : forward;
+
+    const SearchEntry entry = queue.top();
+    queue.pop();
+    if ( entry.cost > labels[ entry.vertex ].cost )
+      continue;
+
+    const QgsCompactGraph::ArcRange arcs = isForward ? source->outgoingArcs( entry.vertex ) : source->incomingArcs( entry.vertex );
+    for ( const QgsCompactGraph::Arc &arc : arcs )
+    {
+      const double cost = entry.cost + arc.cost;
+      auto it = labels.find( arc.vertex );
+      if ( it != labels.end() && it->second.cost <= cost )
+        continue;
+
+      labels[ arc.vertex ] = SearchLabel{ cost, arc.edge };
+      const double vertexPotential = potential( arc.vertex );
+      queue.push( SearchEntry{ cost + ( isForward ? vertexPotential : -vertexPotential ), cost, arc.vertex, sequence++ } );
+
+      auto other = otherLabels.find( arc.vertex );
+      if ( other != otherLabels.end() && cost + other->second.cost < bestCost )
+      {
+        bestCost = cost + other->second.cost;
+        meetingVertex = arc.vertex;
+      }
+    }
+  }
+
+  if ( meetingVertex < 0 || !resultPath )
+    return bestCost;
+
+  int vertex = meetingVertex;
+  while ( vertex != startVertexIdx )
+  {
+    const int edge = forward[ vertex ].edge;
+    resultPath->prepend( edge );
+    vertex = source->edgeSource( edge );
+  }
+  vertex = meetingVertex;
+  while ( vertex != endVertexIdx )
+  {
+    const int edge = backward[ vertex ].edge;
+    resultPath->append( edge );
+    vertex = source->edgeTarget( edge );
+  }
+
+  return bestCost;
+}
+
 QgsGraph *QgsGraphAnalyzer::shortestTree( const QgsGraph *source, int startVertexIdx, int criterionNum )
 {
   QgsGraph *treeResult = new QgsGraph();
@@ -22,6 +22,8 @@
 #include "qgis_analysis.h"
 
 class QgsGraph;
+class QgsCompactGraph;
+class QgsContractionHierarchy;
 
 /**
  * \ingroup analysis
@@ -82,6 +84,41 @@ class ANALYSIS_EXPORT QgsGraphAnalyzer
      * \param criterionNum index of the optimization strategy
      */
     static QgsGraph *shortestTree( const QgsGraph *source, int startVertexIdx, int criterionNum );
+
+    /**
+     * Solve shortest path problem using Dijkstra algorithm on a compact \a source graph.
+     *
+     * If \a reverse is FALSE, the tree contains the shortest paths from the vertex with index \a vertexIdx
+     * to all other vertices, and resultTree[ vertexIndex ] is the index of the edge entering each vertex.
+     *
+     * If \a reverse is TRUE, the tree contains the shortest paths from all other vertices to the vertex with
+     * index \a vertexIdx, and resultTree[ vertexIndex ] is the index of the edge leaving each vertex. This
+     * calculates the paths from many start points to a single end point in a single search.
+     *
+     * resultTree[ vertexIndex ] is -1 for unreachable vertices and for the vertex with index \a vertexIdx.
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.22
+     */
+    static void dijkstra( const QgsCompactGraph *source, int vertexIdx, QVector<int> *resultTree, QVector<double> *resultCost, bool reverse = false ) SIP_SKIP;
+
+    /**
+     * Returns the cost of the shortest path between the vertices with index \a startVertexIdx and \a endVertexIdx
+     * of a compact \a source graph, or infinity if the end vertex can't be reached.
+     *
+     * If \a resultPath is specified, it will be filled with the indices of the edges of the path, in order.
+     *
+     * If a contraction \a hierarchy built for the graph is specified, the path is found by a bidirectional search
+     * of the hierarchy. Otherwise, or if the hierarchy was not built for this graph (see QgsContractionHierarchy::isValidForGraph()),
+     * the path is found by a bidirectional A* search, guided by the straight line distance between the vertices.
+     *
+     * Unlike dijkstra(), this only explores the part of the graph needed to find the path.
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.22
+     */
+    static double shortestPath( const QgsCompactGraph *source, int startVertexIdx, int endVertexIdx, QVector<int> *resultPath = nullptr,
+                                const QgsContractionHierarchy *hierarchy = nullptr ) SIP_SKIP;
 };
 
 #endif // QGSGRAPHANALYZER_H
@@ -20,6 +20,11 @@
 
 ///@cond PRIVATE
 
+QgsProcessingAlgorithm::Flags QgsBoundaryAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | QgsProcessingAlgorithm::FlagSupportsParallelFeatureProcessing;
+}
+
 QString QgsBoundaryAlgorithm::name() const
 {
   return QStringLiteral( "boundary" );
@@ -20,6 +20,11 @@
 
 ///@cond PRIVATE
 
+QgsProcessingAlgorithm::Flags QgsMinimumEnclosingCircleAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | QgsProcessingAlgorithm::FlagSupportsParallelFeatureProcessing;
+}
+
 QString QgsMinimumEnclosingCircleAlgorithm::name() const
 {
   return QStringLiteral( "minimumenclosingcircle" );
@@ -35,6 +35,7 @@ class QgsMinimumEnclosingCircleAlgorithm : public QgsProcessingFeatureBasedAlgor
 
     QgsMinimumEnclosingCircleAlgorithm() = default;
     void initParameters( const QVariantMap &configuration = QVariantMap() ) override;
+    QgsProcessingAlgorithm::Flags flags() const override;
     QString name() const override;
     QString displayName() const override;
     QStringList tags() const override;
@@ -20,6 +20,11 @@
 
 ///@cond PRIVATE
 
+QgsProcessingAlgorithm::Flags QgsMultipartToSinglepartAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | QgsProcessingAlgorithm::FlagSupportsParallelFeatureProcessing;
+}
+
 QString QgsMultipartToSinglepartAlgorithm::name() const
 {
   return QStringLiteral( "multiparttosingleparts" );
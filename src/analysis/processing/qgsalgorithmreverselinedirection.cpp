@@ -21,6 +21,11 @@
 
 ///@cond PRIVATE
 
+QgsProcessingAlgorithm::Flags QgsReverseLineDirectionAlgorithm::flags() const
+{
+  return QgsProcessingFeatureBasedAlgorithm::flags() | QgsProcessingAlgorithm::FlagSupportsParallelFeatureProcessing;
+}
+
 QString QgsReverseLineDirectionAlgorithm ::name() const
 {
   return QStringLiteral( "reverselinedirection" );
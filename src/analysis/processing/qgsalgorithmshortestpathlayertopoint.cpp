@@ -18,6 +18,7 @@
 #include "qgsalgorithmshortestpathlayertopoint.h"
 
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
 
 #include "qgsmessagelog.h"
 
@@ -92,8 +93,11 @@ QVariantMap QgsShortestPathLayerToPointAlgorithm::processAlgorithm( const QVaria
   int idxStart;
   int currentIdx;
 
+  // a single search on the reversed graph gives the shortest paths from all start points to the end point
+  const QgsCompactGraph compactGraph( graph, 0 );
   QVector< int > tree;
   QVector< double > costs;
+  QgsGraphAnalyzer::dijkstra( &compactGraph, idxEnd, &tree, &costs, true );
 
   QVector<QgsPointXY> route;
   double cost;
@@ -111,9 +115,8 @@ QVariantMap QgsShortestPathLayerToPointAlgorithm::processAlgorithm( const QVaria
     }
 
     idxStart = graph->findVertex( snappedPoints[i] );
-    QgsGraphAnalyzer::dijkstra( graph, idxStart, 0, &tree, &costs );
 
-    if ( tree.at( idxEnd ) == -1 )
+    if ( tree.at( idxStart ) == -1 )
     {
       feedback->reportError( QObject::tr( "There is no route from start point (%1) to end point (%2)." )
                              .arg( points[i].toString(),
@@ -127,13 +130,13 @@ QVariantMap QgsShortestPathLayerToPointAlgorithm::processAlgorithm( const QVaria
     }
 
     route.clear();
-    route.push_front( graph->vertex( idxEnd ).point() );
-    cost = costs.at( idxEnd );
-    currentIdx = idxEnd;
-    while ( currentIdx != idxStart )
+    route.push_back( graph->vertex( idxStart ).point() );
+    cost = costs.at( idxStart );
+    currentIdx = idxStart;
+    while ( currentIdx != idxEnd )
     {
-      currentIdx = graph->edge( tree.at( currentIdx ) ).fromVertex();
-      route.push_front( graph->vertex( currentIdx ).point() );
+      currentIdx = compactGraph.edgeTarget( tree.at( currentIdx ) );
+      route.push_back( graph->vertex( currentIdx ).point() );
     }
 
     QgsGeometry geom = QgsGeometry::fromPolylineXY( route );
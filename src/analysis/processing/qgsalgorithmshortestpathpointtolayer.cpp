@@ -18,6 +18,7 @@
 #include "qgsalgorithmshortestpathpointtolayer.h"
 
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
 
 #include "qgsmessagelog.h"
 
@@ -93,7 +94,8 @@ QVariantMap QgsShortestPathPointToLayerAlgorithm::processAlgorithm( const QVaria
 
   QVector< int > tree;
   QVector< double > costs;
-  QgsGraphAnalyzer::dijkstra( graph, idxStart, 0, &tree, &costs );
+  const QgsCompactGraph compactGraph( graph, 0 );
+  QgsGraphAnalyzer::dijkstra( &compactGraph, idxStart, &tree, &costs );
 
   QVector<QgsPointXY> route;
   double cost;
@@ -130,7 +132,7 @@ QVariantMap QgsShortestPathPointToLayerAlgorithm::processAlgorithm( const QVaria
     cost = costs.at( idxEnd );
     while ( idxEnd != idxStart )
     {
-      idxEnd = graph->edge( tree.at( idxEnd ) ).fromVertex();
+      idxEnd = compactGraph.edgeSource( tree.at( idxEnd ) );
       route.push_front( graph->vertex( idxEnd ).point() );
     }
 
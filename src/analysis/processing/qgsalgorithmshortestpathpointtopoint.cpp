@@ -18,6 +18,7 @@
 #include "qgsalgorithmshortestpathpointtopoint.h"
 
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
 
 ///@cond PRIVATE
 
@@ -84,22 +85,21 @@ QVariantMap QgsShortestPathPointToPointAlgorithm::processAlgorithm( const QVaria
   int idxStart = graph->findVertex( snappedPoints[0] );
   int idxEnd = graph->findVertex( snappedPoints[1] );
 
-  QVector< int > tree;
-  QVector< double > costs;
-  QgsGraphAnalyzer::dijkstra( graph, idxStart, 0, &tree, &costs );
+  // a bidirectional A* search only explores the part of the network between the points
+  const QgsCompactGraph compactGraph( graph, 0 );
+  QVector< int > path;
+  const double cost = QgsGraphAnalyzer::shortestPath( &compactGraph, idxStart, idxEnd, &path );
 
-  if ( tree.at( idxEnd ) == -1 )
+  if ( path.isEmpty() )
   {
     throw QgsProcessingException( QObject::tr( "There is no route from start point to end point." ) );
   }
 
   QVector<QgsPointXY> route;
-  route.push_front( graph->vertex( idxEnd ).point() );
-  double cost = costs.at( idxEnd );
-  while ( idxEnd != idxStart )
+  route.push_back( graph->vertex( idxStart ).point() );
+  for ( int edge : std::as_const( path ) )
   {
-    idxEnd = graph->edge( tree.at( idxEnd ) ).fromVertex();
-    route.push_front( graph->vertex( idxEnd ).point() );
+    route.push_back( graph->vertex( compactGraph.edgeTarget( edge ) ).point() );
   }
 
   feedback->pushInfo( QObject::tr( "Writing results…" ) );
@@ -89,7 +89,7 @@ void QgsOverlayUtils::difference( const QgsFeatureSource &sourceA, const QgsFeat
   requestB.setNoAttributes();
   if ( outputAttrs != OutputBA )
     requestB.setDestinationCrs( sourceA.sourceCrs(), context.transformContext() );
-  QgsSpatialIndex indexB( sourceB.getFeatures( requestB ), feedback );
+  QgsSpatialIndex indexB( sourceB.getFeatures( requestB ), feedback, QgsSpatialIndex::FlagStaticIndex );
   if ( feedback->isCanceled() )
     return;
 
@@ -204,7 +204,7 @@ void QgsOverlayUtils::intersection( const QgsFeatureSource &sourceA, const QgsFe
   request.setDestinationCrs( sourceA.sourceCrs(), context.transformContext() );
 
   QgsFeature outFeat;
-  QgsSpatialIndex indexB( sourceB.getFeatures( request ), feedback );
+  QgsSpatialIndex indexB( sourceB.getFeatures( request ), feedback, QgsSpatialIndex::FlagStaticIndex );
   if ( feedback->isCanceled() )
     return;
 
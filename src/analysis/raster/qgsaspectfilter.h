@@ -32,9 +32,9 @@ class ANALYSIS_EXPORT QgsAspectFilter: public QgsDerivativeFilter
   public:
     QgsAspectFilter( const QString &inputFile, const QString &outputFile, const QString &outputFormat );
 
-    float processNineCellWindow( float *x11, float *x21, float *x31,
-                                 float *x12, float *x22, float *x32,
-                                 float *x13, float *x23, float *x33 ) override;
+    float processNineCellWindow( float *x11 SIP_IN, float *x21 SIP_IN, float *x31 SIP_IN,
+                                 float *x12 SIP_IN, float *x22 SIP_IN, float *x32 SIP_IN,
+                                 float *x13 SIP_IN, float *x23 SIP_IN, float *x33 SIP_IN ) override;
 
 
 #ifdef HAVE_OPENCL
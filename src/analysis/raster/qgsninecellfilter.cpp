@@ -30,7 +30,19 @@
 #include <QFile>
 #include <QDebug>
 #include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
 #include <iterator>
+#include <memory>
+#include <vector>
+
+///@cond PRIVATE
+
+//! Approximate number of cells of the stripes of rows processed by each task of the CPU route
+static constexpr int STRIPE_CELL_COUNT = 1 << 20;
+
+///@endcond
 
 
 
@@ -401,91 +413,80 @@ int QgsNineCellFilter::processRasterCPU( QgsFeedback *feedback )
     return 6;
   }
 
-  //keep only three scanlines in memory at a time, make room for initial and final nodata
-  std::size_t bufferSize( sizeof( float ) * ( xSize + 2 ) );
-  float *scanLine1 = ( float * ) CPLMalloc( bufferSize );
-  float *scanLine2 = ( float * ) CPLMalloc( bufferSize );
-  float *scanLine3 = ( float * ) CPLMalloc( bufferSize );
-
-  float *resultLine = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-
-  //values outside the layer extent (if the 3x3 window is on the border) are sent to the processing method as (input) nodata values
-  for ( int yIndex = 0; yIndex < ySize; ++yIndex )
+  // the raster is split into stripes of rows, which are processed in parallel by worker threads.
+  // This thread reads the stripes, including a row above and below them (the "halo") and an extra
+  // column on each side, and writes the processed stripes in order. A few stripes ahead get processed
+  // while the first ones are written. Values outside the layer extent (if the 3x3 window is on the
+  // border) are sent to the processing method as (input) nodata values
+  const int stripeRows = std::max( 1, STRIPE_CELL_COUNT / xSize );
+  const int maxPendingStripes = 2 * std::max( 1, QThread::idealThreadCount() );
+  const std::size_t lineSize = static_cast< std::size_t >( xSize ) + 2;
+
+  QThreadPool pool;
+  QList< QFuture< std::shared_ptr< std::vector< float > > > > pendingStripes;
+
+  int nextRow = 0;
+  int writtenRows = 0;
+  while ( writtenRows < ySize )
   {
     if ( feedback && feedback->isCanceled() )
     {
       break;
     }
 
-    if ( feedback )
+    while ( nextRow < ySize && pendingStripes.size() < maxPendingStripes )
     {
-      feedback->setProgress( 100.0 * static_cast< double >( yIndex ) / ySize );
-    }
-
-    if ( yIndex == 0 )
-    {
-      //fill scanline 1 with (input) nodata for the values above the first row and feed scanline2 with the first row
-      for ( int a = 0; a < xSize + 2 ; ++a )
-      {
-        scanLine1[a] = mInputNodataValue;
-      }
-      // Read scanline2
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, 0, xSize, 1, &scanLine2[1], xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
+      const int rows = std::min( stripeRows, ySize - nextRow );
+      std::shared_ptr< std::vector< float > > input = std::make_shared< std::vector< float > >( lineSize * ( rows + 2 ), mInputNodataValue );
+
+      // read the rows of the stripe and its halo which are within the raster
+      const int firstRow = std::max( 0, nextRow - 1 );
+      const int lastRow = std::min( ySize - 1, nextRow + rows );
+      float *firstLine = input->data() + lineSize * ( firstRow - nextRow + 1 );
+      if ( GDALRasterIO( rasterBand, GF_Read, 0, firstRow, xSize, lastRow - firstRow + 1, firstLine + 1, xSize, lastRow - firstRow + 1, GDT_Float32,
+                         0, static_cast< GSpacing >( lineSize * sizeof( float ) ) ) != CE_None )
       {
         QgsDebugMsg( QStringLiteral( "Raster IO Error" ) );
       }
-    }
-    else
-    {
-      //normally fetch only scanLine3 and release scanline 1 if we move forward one row
-      CPLFree( scanLine1 );
-      scanLine1 = scanLine2;
-      scanLine2 = scanLine3;
-      scanLine3 = ( float * ) CPLMalloc( bufferSize );
-    }
 
-    // Read scanline 3
-    if ( yIndex == ySize - 1 ) //fill the row below the bottom with nodata values
-    {
-      for ( int a = 0; a < xSize + 2; ++a )
+      pendingStripes << QtConcurrent::run( &pool, [this, input, rows, xSize, lineSize]
       {
-        scanLine3[a] = mInputNodataValue;
-      }
-    }
-    else
-    {
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, yIndex + 1, xSize, 1, &scanLine3[1], xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
-      {
-        QgsDebugMsg( QStringLiteral( "Raster IO Error" ) );
-      }
+        std::shared_ptr< std::vector< float > > result = std::make_shared< std::vector< float > >( static_cast< std::size_t >( xSize ) * rows );
+        for ( int row = 0; row < rows; ++row )
+        {
+          float *scanLine1 = input->data() + lineSize * row;
+          float *scanLine2 = scanLine1 + lineSize;
+          float *scanLine3 = scanLine2 + lineSize;
+          float *resultLine = result->data() + static_cast< std::size_t >( xSize ) * row;
+          for ( int xIndex = 0; xIndex < xSize ; ++xIndex )
+          {
+            // cells(x, y) x11, x21, x31, x12, x22, x32, x13, x23, x33
+            resultLine[ xIndex ] = processNineCellWindow( &scanLine1[ xIndex ], &scanLine1[ xIndex + 1 ], &scanLine1[ xIndex + 2 ],
+                                   &scanLine2[ xIndex ], &scanLine2[ xIndex + 1 ], &scanLine2[ xIndex + 2 ],
+                                   &scanLine3[ xIndex ], &scanLine3[ xIndex + 1 ], &scanLine3[ xIndex + 2 ] );
+          }
+        }
+        return result;
+      } );
+      nextRow += rows;
     }
-    // Set first and last extra columns to nodata
-    scanLine1[0] = scanLine1[xSize + 1] = mInputNodataValue;
-    scanLine2[0] = scanLine2[xSize + 1] = mInputNodataValue;
-    scanLine3[0] = scanLine3[xSize + 1] = mInputNodataValue;
-
-
 
-    // j is the x axis index, skip 0 and last cell that have been filled with nodata
-    for ( int xIndex = 0; xIndex < xSize ; ++xIndex )
+    const std::shared_ptr< std::vector< float > > result = pendingStripes.takeFirst().result();
+    const int rows = std::min( stripeRows, ySize - writtenRows );
+    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, writtenRows, xSize, rows, result->data(), xSize, rows, GDT_Float32, 0, 0 ) != CE_None )
     {
-      // cells(x, y) x11, x21, x31, x12, x22, x32, x13, x23, x33
-      resultLine[ xIndex ] = processNineCellWindow( &scanLine1[ xIndex ], &scanLine1[ xIndex + 1 ], &scanLine1[ xIndex + 2 ],
-                             &scanLine2[ xIndex ], &scanLine2[ xIndex + 1 ], &scanLine2[ xIndex + 2 ],
-                             &scanLine3[ xIndex ], &scanLine3[ xIndex + 1 ], &scanLine3[ xIndex + 2 ] );
-
+      QgsDebugMsg( QStringLiteral( "Raster IO Error" ) );
     }
+    writtenRows += rows;
 
-    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, yIndex, xSize, 1, resultLine, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
+    if ( feedback )
     {
-      QgsDebugMsg( QStringLiteral( "Raster IO Error" ) );
+      feedback->setProgress( 100.0 * static_cast< double >( writtenRows ) / ySize );
     }
   }
 
-  CPLFree( resultLine );
-  CPLFree( scanLine1 );
-  CPLFree( scanLine2 );
-  CPLFree( scanLine3 );
+  // let the stripes still being processed finish before the output gets deleted
+  pool.waitForDone();
 
   if ( feedback && feedback->isCanceled() )
   {
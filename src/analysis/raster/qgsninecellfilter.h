@@ -21,6 +21,7 @@
 #include <QString>
 #include "gdal.h"
 #include "qgis_analysis.h"
+#include "qgis_sip.h"
 #include "qgsogrutils.h"
 
 class QgsFeedback;
@@ -45,7 +46,7 @@ class ANALYSIS_EXPORT QgsNineCellFilter
      * \param feedback feedback object that receives update and that is checked for cancellation.
      * \returns 0 in case of success
      */
-    int processRaster( QgsFeedback *feedback = nullptr );
+    int processRaster( QgsFeedback *feedback = nullptr ) SIP_RELEASEGIL;
 
     double cellSizeX() const { return mCellSizeX; }
     void setCellSizeX( double size ) { mCellSizeX = size; }
@@ -65,6 +66,10 @@ class ANALYSIS_EXPORT QgsNineCellFilter
      * value can be equal to the nodata value if not present or outside of the border.
      * Must be implemented by subclasses.
      *
+     * Since QGIS 3.22 the CPU implementation calls this method concurrently from several
+     * threads, so implementations must not modify the state of the filter. Implementations
+     * in Python are called with the GIL held, so they are run one at a time.
+     *
      * First index of the input cell is the row, second index is the column
      *
      * \param x11 surrounding cell top left
@@ -78,9 +83,9 @@ class ANALYSIS_EXPORT QgsNineCellFilter
      * \param x33 surrounding cell bottom right
      * \return the calculated cell value for the central cell x22
      */
-    virtual float processNineCellWindow( float *x11, float *x21, float *x31,
-                                         float *x12, float *x22, float *x32,
-                                         float *x13, float *x23, float *x33 ) = 0;
+    virtual float processNineCellWindow( float *x11 SIP_IN, float *x21 SIP_IN, float *x31 SIP_IN,
+                                         float *x12 SIP_IN, float *x22 SIP_IN, float *x32 SIP_IN,
+                                         float *x13 SIP_IN, float *x23 SIP_IN, float *x33 SIP_IN ) = 0;
 
   private:
     //default constructor forbidden. We need input file, output file and format obligatory
@@ -0,0 +1,320 @@
+/***************************************************************************
+  qgsrastercalckernel.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrastercalckernel.h"
+#include "qgsrasterblock.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+///@cond PRIVATE
+
+//! Number of pixels evaluated at once, small enough for the scratch buffers to stay in the CPU cache
+static constexpr qgssize CHUNK_SIZE = 256;
+
+QgsRasterCalcKernel::QgsRasterCalcKernel( const QgsRasterCalcNode *node )
+{
+  mValid = node && compile( node, 0 );
+  if ( !mValid )
+    mInstructions.clear();
+}
+
+bool QgsRasterCalcKernel::compile( const QgsRasterCalcNode *node, int depth )
+{
+  Instruction instruction;
+  switch ( node->mType )
+  {
+    case QgsRasterCalcNode::tRasterRef:
+    {
+      int index = mRasterReferences.indexOf( node->mRasterName );
+      if ( index < 0 )
+      {
+        mRasterReferences << node->mRasterName;
+        index = mRasterReferences.size() - 1;
+      }
+      instruction.type = PushRaster;
+      instruction.raster = index;
+      mStackSize = std::max( mStackSize, depth + 1 );
+      break;
+    }
+
+    case QgsRasterCalcNode::tNumber:
+      instruction.type = PushNumber;
+      instruction.number = node->mNumber;
+      mStackSize = std::max( mStackSize, depth + 1 );
+      break;
+
+    case QgsRasterCalcNode::tMatrix:
+      return false;
+
+    case QgsRasterCalcNode::tOperator:
+      instruction.op = node->mOperator;
+      switch ( node->mOperator )
+      {
+        case QgsRasterCalcNode::opPLUS:
+        case QgsRasterCalcNode::opMINUS:
+        case QgsRasterCalcNode::opMUL:
+        case QgsRasterCalcNode::opDIV:
+        case QgsRasterCalcNode::opPOW:
+        case QgsRasterCalcNode::opEQ:
+        case QgsRasterCalcNode::opNE:
+        case QgsRasterCalcNode::opGT:
+        case QgsRasterCalcNode::opLT:
+        case QgsRasterCalcNode::opGE:
+        case QgsRasterCalcNode::opLE:
+        case QgsRasterCalcNode::opAND:
+        case QgsRasterCalcNode::opOR:
+        case QgsRasterCalcNode::opMAX:
+        case QgsRasterCalcNode::opMIN:
+          if ( !node->mLeft || !node->mRight
+               || !compile( node->mLeft, depth ) || !compile( node->mRight, depth + 1 ) )
+            return false;
+          instruction.type = Binary;
+          break;
+
+        case QgsRasterCalcNode::opSQRT:
+        case QgsRasterCalcNode::opSIN:
+        case QgsRasterCalcNode::opCOS:
+        case QgsRasterCalcNode::opTAN:
+        case QgsRasterCalcNode::opASIN:
+        case QgsRasterCalcNode::opACOS:
+        case QgsRasterCalcNode::opATAN:
+        case QgsRasterCalcNode::opSIGN:
+        case QgsRasterCalcNode::opLOG:
+        case QgsRasterCalcNode::opLOG10:
+        case QgsRasterCalcNode::opABS:
+          if ( !node->mLeft || !compile( node->mLeft, depth ) )
+            return false;
+          instruction.type = Unary;
+          break;
+
+        case QgsRasterCalcNode::opNONE:
+          return false;
+      }
+      break;
+  }
+
+  mInstructions << instruction;
+  return true;
+}
+
+// The operators follow the rules of QgsRasterMatrix: pixels for which an operator is
+// undefined become nodata, and operations on nodata pixels always generate nodata.
+
+static void applyUnary( QgsRasterCalcNode::Operator op, double *v, unsigned char *noData, int n )
+{
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opSQRT:
+      for ( int i = 0; i < n; ++i )
+      {
+        noData[i] |= v[i] < 0;
+        v[i] = std::sqrt( std::max( v[i], 0.0 ) );
+      }
+      break;
+    case QgsRasterCalcNode::opSIN:
+      for ( int i = 0; i < n; ++i )
+        v[i] = std::sin( v[i] );
+      break;
+    case QgsRasterCalcNode::opCOS:
+      for ( int i = 0; i < n; ++i )
+        v[i] = std::cos( v[i] );
+      break;
+    case QgsRasterCalcNode::opTAN:
+      for ( int i = 0; i < n; ++i )
+        v[i] = std::tan( v[i] );
+      break;
+    case QgsRasterCalcNode::opASIN:
+      for ( int i = 0; i < n; ++i )
+        v[i] = std::asin( v[i] );
+      break;
+    case QgsRasterCalcNode::opACOS:
+      for ( int i = 0; i < n; ++i )
+        v[i] = std::acos( v[i] );
+      break;
+    case QgsRasterCalcNode::opATAN:
+      for ( int i = 0; i < n; ++i )
+        v[i] = std::atan( v[i] );
+      break;
+    case QgsRasterCalcNode::opSIGN:
+      for ( int i = 0; i < n; ++i )
+        v[i] = -v[i];
+      break;
+    case QgsRasterCalcNode::opLOG:
+      for ( int i = 0; i < n; ++i )
+      {
+        noData[i] |= v[i] <= 0;
+        v[i] = v[i] > 0 ? std::log( v[i] ) : 0;
+      }
+      break;
+    case QgsRasterCalcNode::opLOG10:
+      for ( int i = 0; i < n; ++i )
+      {
+        noData[i] |= v[i] <= 0;
+        v[i] = v[i] > 0 ? std::log10( v[i] ) : 0;
+      }
+      break;
+    case QgsRasterCalcNode::opABS:
+      for ( int i = 0; i < n; ++i )
+        v[i] = std::fabs( v[i] );
+      break;
+    default:
+      break;
+  }
+}
+
+static void applyBinary( QgsRasterCalcNode::Operator op, double *a, unsigned char *noDataA, const double *b, const unsigned char *noDataB, int n )
+{
+  for ( int i = 0; i < n; ++i )
+    noDataA[i] |= noDataB[i];
+
+  switch ( op )
+  {
+    case QgsRasterCalcNode::opPLUS:
+      for ( int i = 0; i < n; ++i )
+        a[i] += b[i];
+      break;
+    case QgsRasterCalcNode::opMINUS:
+      for ( int i = 0; i < n; ++i )
+        a[i] -= b[i];
+      break;
+    case QgsRasterCalcNode::opMUL:
+      for ( int i = 0; i < n; ++i )
+        a[i] *= b[i];
+      break;
+    case QgsRasterCalcNode::opDIV:
+      for ( int i = 0; i < n; ++i )
+      {
+        noDataA[i] |= b[i] == 0;
+        a[i] = b[i] != 0 ? a[i] / b[i] : 0;
+      }
+      break;
+    case QgsRasterCalcNode::opPOW:
+      for ( int i = 0; i < n; ++i )
+      {
+        const bool valid = !( ( a[i] == 0 && b[i] < 0 ) || ( a[i] < 0 && ( b[i] - std::floor( b[i] ) ) > 0 ) );
+        noDataA[i] |= !valid;
+        a[i] = valid ? std::pow( a[i], b[i] ) : 0;
+      }
+      break;
+    case QgsRasterCalcNode::opEQ:
+      for ( int i = 0; i < n; ++i )
+        a[i] = a[i] == b[i] ? 1.0 : 0.0;
+      break;
+    case QgsRasterCalcNode::opNE:
+      for ( int i = 0; i < n; ++i )
+        a[i] = a[i] == b[i] ? 0.0 : 1.0;
+      break;
+    case QgsRasterCalcNode::opGT:
+      for ( int i = 0; i < n; ++i )
+        a[i] = a[i] > b[i] ? 1.0 : 0.0;
+      break;
+    case QgsRasterCalcNode::opLT:
+      for ( int i = 0; i < n; ++i )
+        a[i] = a[i] < b[i] ? 1.0 : 0.0;
+      break;
+    case QgsRasterCalcNode::opGE:
+      for ( int i = 0; i < n; ++i )
+        a[i] = a[i] >= b[i] ? 1.0 : 0.0;
+      break;
+    case QgsRasterCalcNode::opLE:
+      for ( int i = 0; i < n; ++i )
+        a[i] = a[i] <= b[i] ? 1.0 : 0.0;
+      break;
+    case QgsRasterCalcNode::opAND:
+      for ( int i = 0; i < n; ++i )
+        a[i] = a[i] != 0 && b[i] != 0 ? 1.0 : 0.0;
+      break;
+    case QgsRasterCalcNode::opOR:
+      for ( int i = 0; i < n; ++i )
+        a[i] = a[i] != 0 || b[i] != 0 ? 1.0 : 0.0;
+      break;
+    case QgsRasterCalcNode::opMAX:
+      for ( int i = 0; i < n; ++i )
+        a[i] = std::max( a[i], b[i] );
+      break;
+    case QgsRasterCalcNode::opMIN:
+      for ( int i = 0; i < n; ++i )
+        a[i] = std::min( a[i], b[i] );
+      break;
+    default:
+      break;
+  }
+}
+
+void QgsRasterCalcKernel::evaluate( const QVector<const QgsRasterBlock *> &inputs, qgssize offset, qgssize count, float *output, float outputNoData ) const
+{
+  if ( !mValid )
+  {
+    std::fill( output, output + count, outputNoData );
+    return;
+  }
+
+  // one chunk of values and nodata flags for each level of the stack
+  std::vector< double > values( static_cast< std::size_t >( mStackSize ) * CHUNK_SIZE );
+  std::vector< unsigned char > noData( static_cast< std::size_t >( mStackSize ) * CHUNK_SIZE );
+
+  for ( qgssize chunkStart = 0; chunkStart < count; chunkStart += CHUNK_SIZE )
+  {
+    const int n = static_cast< int >( std::min( CHUNK_SIZE, count - chunkStart ) );
+    int top = -1;
+
+    for ( const Instruction &instruction : mInstructions )
+    {
+      switch ( instruction.type )
+      {
+        case PushRaster:
+        {
+          ++top;
+          double *v = values.data() + top * CHUNK_SIZE;
+          unsigned char *m = noData.data() + top * CHUNK_SIZE;
+          const QgsRasterBlock *block = inputs.at( instruction.raster );
+          bool isNoData = false;
+          for ( int i = 0; i < n; ++i )
+          {
+            v[i] = block->valueAndNoData( offset + chunkStart + i, isNoData );
+            m[i] = isNoData;
+          }
+          break;
+        }
+
+        case PushNumber:
+          ++top;
+          std::fill( values.data() + top * CHUNK_SIZE, values.data() + top * CHUNK_SIZE + n, instruction.number );
+          std::fill( noData.data() + top * CHUNK_SIZE, noData.data() + top * CHUNK_SIZE + n, 0 );
+          break;
+
+        case Unary:
+          applyUnary( instruction.op, values.data() + top * CHUNK_SIZE, noData.data() + top * CHUNK_SIZE, n );
+          break;
+
+        case Binary:
+          --top;
+          applyBinary( instruction.op, values.data() + top * CHUNK_SIZE, noData.data() + top * CHUNK_SIZE,
+                       values.data() + ( top + 1 ) * CHUNK_SIZE, noData.data() + ( top + 1 ) * CHUNK_SIZE, n );
+          break;
+      }
+    }
+
+    const double *v = values.data();
+    const unsigned char *m = noData.data();
+    float *out = output + chunkStart;
+    for ( int i = 0; i < n; ++i )
+      out[i] = m[i] ? outputNoData : static_cast< float >( v[i] );
+  }
+}
+
+///@endcond
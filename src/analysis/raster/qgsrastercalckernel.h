@@ -0,0 +1,105 @@
+/***************************************************************************
+  qgsrastercalckernel.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRASTERCALCKERNEL_H
+#define QGSRASTERCALCKERNEL_H
+
+#define SIP_NO_FILE
+
+#include "qgis_analysis.h"
+#include "qgsrastercalcnode.h"
+
+#include <QStringList>
+#include <QVector>
+
+class QgsRasterBlock;
+
+///@cond PRIVATE
+
+/**
+ * \ingroup analysis
+ * \class QgsRasterCalcKernel
+ * \brief A raster calculator expression compiled to a flat list of instructions, evaluated
+ * element-wise on chunks of pixels.
+ *
+ * Unlike QgsRasterCalcNode::calculate(), which allocates a matrix for every node of the
+ * expression tree, the kernel evaluates the whole expression for a small chunk of pixels
+ * at a time in a few scratch buffers, tracking nodata pixels with a mask. The loops over
+ * the chunks are simple enough to be vectorized by the compiler.
+ *
+ * The kernel is immutable once compiled, and evaluate() can be called concurrently from
+ * several threads.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class ANALYSIS_EXPORT QgsRasterCalcKernel
+{
+  public:
+
+    /**
+     * Compiles the expression tree starting at \a node.
+     *
+     * Expressions with matrix nodes are not supported and result in an invalid kernel.
+     */
+    explicit QgsRasterCalcKernel( const QgsRasterCalcNode *node );
+
+    //! Returns TRUE if the expression could be compiled
+    bool isValid() const { return mValid; }
+
+    /**
+     * Returns the names of the rasters referenced by the expression. The blocks passed to
+     * evaluate() must follow the same order.
+     */
+    QStringList rasterReferences() const { return mRasterReferences; }
+
+    /**
+     * Evaluates the expression for \a count pixels, starting from pixel \a offset of the
+     * \a inputs blocks (one for each entry of rasterReferences()), and writes the results
+     * to \a output. Pixels which are nodata in any of the used inputs, or for which the
+     * expression is undefined (e.g. division by zero), are set to \a outputNoData.
+     */
+    void evaluate( const QVector< const QgsRasterBlock * > &inputs, qgssize offset, qgssize count, float *output, float outputNoData ) const;
+
+  private:
+
+    //! Kind of a compiled instruction
+    enum InstructionType
+    {
+      PushRaster, //!< Pushes the values of a raster
+      PushNumber, //!< Pushes a constant
+      Unary, //!< Applies an operator to the value on top of the stack
+      Binary, //!< Applies an operator to the two values on top of the stack, which are replaced by the result
+    };
+
+    struct Instruction
+    {
+      InstructionType type = PushNumber;
+      QgsRasterCalcNode::Operator op = QgsRasterCalcNode::opNONE;
+      int raster = -1;
+      double number = 0;
+    };
+
+    bool compile( const QgsRasterCalcNode *node, int depth );
+
+    bool mValid = false;
+    QStringList mRasterReferences;
+    QVector< Instruction > mInstructions;
+    int mStackSize = 0;
+};
+
+///@endcond
+
+#endif // QGSRASTERCALCKERNEL_H
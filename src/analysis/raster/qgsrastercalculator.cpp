@@ -17,6 +17,7 @@
 
 #include "qgsgdalutils.h"
 #include "qgsrastercalculator.h"
+#include "qgsrastercalckernel.h"
 #include "qgsrasterdataprovider.h"
 #include "qgsrasterinterface.h"
 #include "qgsrasterlayer.h"
@@ -27,6 +28,8 @@
 #include "qgsproject.h"
 
 #include <QFile>
+#include <QThreadPool>
+#include <QtConcurrentRun>
 
 #include <cpl_string.h>
 #include <gdalwarper.h>
@@ -37,6 +40,48 @@
 #endif
 
 
+///@cond PRIVATE
+
+//! Approximate number of pixels of the blocks of rows calculated by each task of the CPU route
+static constexpr int ROW_BLOCK_PIXEL_COUNT = 1 << 20;
+
+/**
+ * Input of a task calculating a block of rows, with its own clone of the data provider
+ * so that the task can read it from a worker thread.
+ */
+struct QgsRasterCalculatorBlockInput
+{
+  std::unique_ptr< QgsRasterDataProvider > provider;
+  std::unique_ptr< QgsRasterProjector > projector;
+  int bandNumber = 1;
+};
+
+/**
+ * Reads the \a inputs for a block of \a rows rows covering \a extent and evaluates the \a kernel.
+ * Returns an empty vector if the inputs could not be read.
+ */
+static std::vector< float > calculateRowBlock( const QgsRasterCalcKernel &kernel, const std::vector< QgsRasterCalculatorBlockInput > &inputs,
+    const QgsRectangle &extent, int columns, int rows, float outputNodataValue )
+{
+  std::vector< std::unique_ptr< QgsRasterBlock > > blocks;
+  QVector< const QgsRasterBlock * > inputBlocks;
+  for ( const QgsRasterCalculatorBlockInput &input : inputs )
+  {
+    QgsRasterInterface *rasterInterface = input.projector ? static_cast< QgsRasterInterface * >( input.projector.get() ) : input.provider.get();
+    std::unique_ptr< QgsRasterBlock > block( rasterInterface->block( input.bandNumber, extent, columns, rows ) );
+    if ( !block || block->isEmpty() )
+      return std::vector< float >();
+    inputBlocks << block.get();
+    blocks.emplace_back( std::move( block ) );
+  }
+
+  std::vector< float > result( static_cast< std::size_t >( columns ) * rows );
+  kernel.evaluate( inputBlocks, 0, result.size(), result.data(), outputNodataValue );
+  return result;
+}
+
+///@endcond
+
 //
 // global callback function
 //
@@ -194,92 +239,106 @@ QgsRasterCalculator::Result QgsRasterCalculator::processCalculation( QgsFeedback
   GDALSetRasterNoDataValue( outputRasterBand, outputNodataValue );
 
 
-  // Take the fast route (process one line at a time) if we can
+  // Take the fast route (process blocks of rows in parallel) if we can
   if ( ! requiresMatrix )
   {
-    // Map of raster names -> blocks
-    std::map<QString, std::unique_ptr<QgsRasterBlock>> inputBlocks;
-    std::map<QString, QgsRasterCalculatorEntry> uniqueRasterEntries;
-    const QList<const QgsRasterCalcNode *> rasterRefNodes = calcNode->findNodes( QgsRasterCalcNode::Type::tRasterRef );
-    for ( const QgsRasterCalcNode *r : rasterRefNodes )
+    const QgsRasterCalcKernel kernel( calcNode.get() );
+    if ( !kernel.isValid() )
     {
-      QString layerRef( r->toString().remove( 0, 1 ) );
-      layerRef.chop( 1 );
-      if ( ! inputBlocks.count( layerRef ) )
-      {
-        for ( const QgsRasterCalculatorEntry &ref : std::as_const( mRasterEntries ) )
-        {
-          if ( ref.ref == layerRef )
-          {
-            uniqueRasterEntries[layerRef] = ref;
-            inputBlocks[layerRef ] = std::make_unique<QgsRasterBlock>();
-          }
-        }
-      }
+      gdal::fast_delete_and_close( outputDataset, outputDriver, mOutputFile );
+      return CalculationError;
     }
 
-    //read / write line by line
-    QMap<QString, QgsRasterBlock * > _rasterData;
-    // Cast to float
-    std::vector<float> castedResult( static_cast<size_t>( mNumOutputColumns ), 0 );
-    auto rowHeight = mOutputRectangle.height() / mNumOutputRows;
-    for ( size_t row = 0; row < static_cast<size_t>( mNumOutputRows ); ++row )
+    // entries of the rasters used by the kernel, in the order of its references
+    QVector< QgsRasterCalculatorEntry > kernelEntries;
+    const QStringList rasterReferences = kernel.rasterReferences();
+    for ( const QString &rasterRef : rasterReferences )
     {
-      if ( feedback )
+      auto entryIt = std::find_if( mRasterEntries.constBegin(), mRasterEntries.constEnd(), [&rasterRef]( const QgsRasterCalculatorEntry & entry ) { return entry.ref == rasterRef; } );
+      if ( entryIt == mRasterEntries.constEnd() )
       {
-        feedback->setProgress( 100.0 * static_cast< double >( row ) / mNumOutputRows );
+        QgsDebugMsg( QStringLiteral( "Error: could not find raster data for \"%1\"" ).arg( rasterRef ) );
+        gdal::fast_delete_and_close( outputDataset, outputDriver, mOutputFile );
+        return CalculationError;
       }
+      kernelEntries << *entryIt;
+    }
 
+    // blocks of rows are read and calculated by worker threads, and written in order by this thread.
+    // A few blocks ahead get calculated while the first ones are written. The pool is destroyed
+    // before the kernel, waiting for running tasks when returning early
+    const int rowsPerBlock = std::max( 1, ROW_BLOCK_PIXEL_COUNT / std::max( 1, mNumOutputColumns ) );
+    const int maxPendingBlocks = 2 * std::max( 1, QThread::idealThreadCount() );
+    const double rowHeight = mOutputRectangle.height() / mNumOutputRows;
+    QThreadPool pool;
+    QList< QFuture< std::vector< float > > > pendingBlocks;
+
+    int nextRow = 0;
+    int writtenRows = 0;
+    while ( writtenRows < mNumOutputRows )
+    {
       if ( feedback && feedback->isCanceled() )
       {
         break;
       }
 
-      // Calculates the rect for a single row read
-      QgsRectangle rect( mOutputRectangle );
-      rect.setYMaximum( rect.yMaximum() - rowHeight * row );
-      rect.setYMinimum( rect.yMaximum() - rowHeight );
-
-      // Read rows into input blocks
-      for ( auto &layerRef : inputBlocks )
+      while ( nextRow < mNumOutputRows && pendingBlocks.size() < maxPendingBlocks )
       {
-        QgsRasterCalculatorEntry ref = uniqueRasterEntries[layerRef.first];
-        if ( ref.raster->crs() != mOutputCrs )
+        const int rows = std::min( rowsPerBlock, mNumOutputRows - nextRow );
+
+        // Calculates the rect for the block of rows
+        QgsRectangle rect( mOutputRectangle );
+        rect.setYMaximum( mOutputRectangle.yMaximum() - rowHeight * nextRow );
+        rect.setYMinimum( rect.yMaximum() - rowHeight * rows );
+
+        std::shared_ptr< std::vector< QgsRasterCalculatorBlockInput > > inputs = std::make_shared< std::vector< QgsRasterCalculatorBlockInput > >( kernelEntries.size() );
+        for ( int i = 0; i < kernelEntries.size(); ++i )
         {
-          QgsRasterProjector proj;
-          proj.setCrs( ref.raster->crs(), mOutputCrs, mTransformContext );
-          proj.setInput( ref.raster->dataProvider() );
-          proj.setPrecision( QgsRasterProjector::Exact );
-          layerRef.second.reset( proj.block( ref.bandNumber, rect, mNumOutputColumns, 1 ) );
+          const QgsRasterCalculatorEntry &entry = kernelEntries.at( i );
+          QgsRasterCalculatorBlockInput &input = ( *inputs )[i];
+          input.provider.reset( entry.raster->dataProvider()->clone() );
+          if ( !input.provider )
+          {
+            mLastError = QObject::tr( "Could not read data for %1" ).arg( entry.ref );
+            gdal::fast_delete_and_close( outputDataset, outputDriver, mOutputFile );
+            return CalculationError;
+          }
+          input.bandNumber = entry.bandNumber;
+          if ( entry.raster->crs() != mOutputCrs )
+          {
+            input.projector = std::make_unique< QgsRasterProjector >();
+            input.projector->setCrs( entry.raster->crs(), mOutputCrs, mTransformContext );
+            input.projector->setInput( input.provider.get() );
+            input.projector->setPrecision( QgsRasterProjector::Exact );
+          }
         }
-        else
+
+        const int columns = mNumOutputColumns;
+        pendingBlocks << QtConcurrent::run( &pool, [&kernel, inputs, rect, columns, rows, outputNodataValue]
         {
-          layerRef.second.reset( ref.raster->dataProvider()->block( ref.bandNumber, rect, mNumOutputColumns, 1 ) );
-        }
+          return calculateRowBlock( kernel, *inputs, rect, columns, rows, outputNodataValue );
+        } );
+        nextRow += rows;
       }
 
-      // 1 row X mNumOutputColumns matrix
-      QgsRasterMatrix resultMatrix( mNumOutputColumns, 1, nullptr, outputNodataValue );
-
-      _rasterData.clear();
-      for ( const auto &layerRef : inputBlocks )
+      const std::vector< float > castedResult = pendingBlocks.takeFirst().result();
+      const int rows = std::min( rowsPerBlock, mNumOutputRows - writtenRows );
+      if ( castedResult.empty() )
       {
-        _rasterData.insert( layerRef.first, layerRef.second.get() );
+        mLastError = QObject::tr( "Could not read input data for rows %1 to %2" ).arg( writtenRows ).arg( writtenRows + rows - 1 );
+        gdal::fast_delete_and_close( outputDataset, outputDriver, mOutputFile );
+        return CalculationError;
       }
 
-      if ( calcNode->calculate( _rasterData, resultMatrix, 0 ) )
+      if ( GDALRasterIO( outputRasterBand, GF_Write, 0, writtenRows, mNumOutputColumns, rows, const_cast< float * >( castedResult.data() ), mNumOutputColumns, rows, GDT_Float32, 0, 0 ) != CE_None )
       {
-        std::copy( resultMatrix.data(), resultMatrix.data() + mNumOutputColumns, castedResult.begin() );
-        if ( GDALRasterIO( outputRasterBand, GF_Write, 0, row, mNumOutputColumns, 1, castedResult.data(), mNumOutputColumns, 1, GDT_Float32, 0, 0 ) != CE_None )
-        {
-          QgsDebugMsg( QStringLiteral( "RasterIO error!" ) );
-        }
+        QgsDebugMsg( QStringLiteral( "RasterIO error!" ) );
       }
-      else
+      writtenRows += rows;
+
+      if ( feedback )
       {
-        //delete the dataset without closing (because it is faster)
-        gdal::fast_delete_and_close( outputDataset, outputDriver, mOutputFile );
-        return CalculationError;
+        feedback->setProgress( 100.0 * static_cast< double >( writtenRows ) / mNumOutputRows );
       }
     }
 
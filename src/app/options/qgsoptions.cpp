@@ -30,6 +30,7 @@
 #include "qgstolerance.h"
 #include "qgsscaleutils.h"
 #include "qgsnetworkaccessmanager.h"
+#include "qgstilecache.h"
 #include "qgsauthconfigselect.h"
 #include "qgsproject.h"
 #include "qgsdualview.h"
@@ -2325,6 +2326,7 @@ void QgsOptions::browseCacheDirectory()
 void QgsOptions::clearCache()
 {
   QgsNetworkAccessManager::instance()->cache()->clear();
+  QgsTileCache::clear();
   QMessageBox::information( this, tr( "Clear Cache" ), tr( "Content cache has been cleared." ) );
 }
 
@@ -25,6 +25,7 @@
 #include "qgsexpressioncontextutils.h"
 #include "qgsexpressionutils.h"
 #include "qgsexpression_p.h"
+#include "qgsexpressionbatchevaluator.h"
 
 #include <QRegularExpression>
 
@@ -51,6 +52,7 @@ bool QgsExpression::checkExpression( const QString &text, const QgsExpressionCon
 void QgsExpression::setExpression( const QString &expression )
 {
   detach();
+  d->mBytecode.reset();
   d->mRootNode = ::parseExpression( expression, d->mParserErrorString, d->mParserErrors );
   d->mEvalErrorString = QString();
   d->mExp = expression;
@@ -343,7 +345,29 @@ bool QgsExpression::prepare( const QgsExpressionContext *context )
 
   initGeomCalculator( context );
   d->mIsPrepared = true;
-  return d->mRootNode->prepare( this, context );
+  const bool res = d->mRootNode->prepare( this, context );
+
+  d->mBytecode.reset();
+  if ( d->mEvaluationMode == BytecodeEvaluation )
+    d->mBytecode = QgsExpressionBytecodeProgram::compile( d->mRootNode, this, context );
+
+  return res;
+}
+
+QgsExpression::EvaluationMode QgsExpression::evaluationMode() const
+{
+  return d->mEvaluationMode;
+}
+
+void QgsExpression::setEvaluationMode( EvaluationMode mode )
+{
+  if ( mode == d->mEvaluationMode )
+    return;
+
+  detach();
+  d->mEvaluationMode = mode;
+  d->mIsPrepared = false;
+  d->mBytecode.reset();
 }
 
 QVariant QgsExpression::evaluate()
@@ -371,9 +395,45 @@ QVariant QgsExpression::evaluate( const QgsExpressionContext *context )
   {
     prepare( context );
   }
+
+  if ( d->mBytecode )
+  {
+    QVariant res;
+    if ( d->mBytecode->execute( this, context, res ) )
+      return res;
+  }
+
   return d->mRootNode->eval( this, context );
 }
 
+QVariantList QgsExpression::evaluateBatch( const QList<QgsFeature> &features, QgsExpressionContext *context )
+{
+  d->mEvalErrorString = QString();
+  if ( !d->mRootNode )
+  {
+    d->mEvalErrorString = tr( "No root node! Parsing failed?" );
+    QVariantList results;
+    results.reserve( features.size() );
+    for ( int i = 0; i < features.size(); ++i )
+      results << QVariant();
+    return results;
+  }
+
+  QgsExpressionContext localContext;
+  if ( !context )
+    context = &localContext;
+
+  if ( ! d->mIsPrepared )
+  {
+    prepare( context );
+  }
+
+  QgsExpressionBatchEvaluator evaluator( this, context, features );
+  const QVariantList results = evaluator.evaluate( d->mRootNode );
+  d->mEvalErrorString = evaluator.firstError();
+  return results;
+}
+
 bool QgsExpression::hasEvalError() const
 {
   return !d->mEvalErrorString.isNull();
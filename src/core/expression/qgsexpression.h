@@ -152,6 +152,16 @@ class CORE_EXPORT QgsExpression
       int lastColumn = 0;
     };
 
+    /**
+     * Strategies used to evaluate prepared expressions.
+     * \since QGIS 3.22
+     */
+    enum EvaluationMode
+    {
+      TreeEvaluation, //!< Expressions are evaluated by walking the tree of expression nodes (default)
+      BytecodeEvaluation, //!< Expressions are compiled to bytecode when prepared, and evaluated by a register based virtual machine. Parts of the expression which cannot be compiled are evaluated by walking the node tree.
+    };
+
     /**
      * Creates a new expression based on the provided string.
      * The string will immediately be parsed. For optimization
@@ -231,6 +241,28 @@ class CORE_EXPORT QgsExpression
      */
     bool prepare( const QgsExpressionContext *context );
 
+    /**
+     * Returns the strategy used to evaluate the expression.
+     *
+     * \see setEvaluationMode()
+     * \since QGIS 3.22
+     */
+    EvaluationMode evaluationMode() const;
+
+    /**
+     * Sets the \a mode used to evaluate the expression.
+     *
+     * Bytecode evaluation is considerably faster for expressions which perform numeric calculations,
+     * comparisons and logical operations on feature attributes (e.g. data defined symbol sizes or
+     * filters evaluated against large numbers of features). The results are identical for both modes.
+     *
+     * Changing the mode requires the expression to be prepared again.
+     *
+     * \see evaluationMode()
+     * \since QGIS 3.22
+     */
+    void setEvaluationMode( EvaluationMode mode );
+
     /**
      * Gets list of columns referenced by the expression.
      *
@@ -340,6 +372,32 @@ class CORE_EXPORT QgsExpression
      */
     QVariant evaluate( const QgsExpressionContext *context );
 
+    /**
+     * Evaluates the expression for a block of \a features at once, returning a list
+     * containing the result for each feature (in the same order as the features).
+     *
+     * Each node of the expression is evaluated for all features before its parent node.
+     * Numeric operators, comparisons, logical operators, CASE conditions and basic math
+     * functions are computed over typed columns of values, which is considerably faster than
+     * calling evaluate() for each feature when evaluating large numbers of features (e.g.
+     * when classifying features or calculating field values). Other parts of the expression
+     * are evaluated for each feature individually. The results are identical to calling
+     * evaluate() for each feature.
+     *
+     * The \a context must contain the fields of the features. Its feature will be modified
+     * during the evaluation.
+     *
+     * If the evaluation fails for a feature, the result for this feature is NULL. hasEvalError()
+     * and evalErrorString() report the error raised for the first failing feature.
+     *
+     * \note Functions with side effects may be called in a different order than when
+     * evaluating the features one by one.
+     * \note the expression will be prepared using the \a context if prepare() has not been called.
+     *
+     * \since QGIS 3.22
+     */
+    QVariantList evaluateBatch( const QList< QgsFeature > &features, QgsExpressionContext *context );
+
     //! Returns TRUE if an error occurred when evaluating last input
     bool hasEvalError() const;
     //! Returns evaluation error
@@ -24,6 +24,7 @@
 #include "qgsdistancearea.h"
 #include "qgsunittypes.h"
 #include "qgsexpressionnode.h"
+#include "qgsexpressionbytecode.h"
 
 ///@cond
 
@@ -50,6 +51,7 @@ class QgsExpressionPrivate
       , mCalc( other.mCalc )
       , mDistanceUnit( other.mDistanceUnit )
       , mAreaUnit( other.mAreaUnit )
+      , mEvaluationMode( other.mEvaluationMode )
     {
       if ( other.mDaCrs )
         mDaCrs = std::make_unique<QgsCoordinateReferenceSystem>( *other.mDaCrs.get() );
@@ -84,6 +86,11 @@ class QgsExpressionPrivate
     //! Whether prepare() has been called before evaluate()
     bool mIsPrepared = false;
 
+    QgsExpression::EvaluationMode mEvaluationMode = QgsExpression::TreeEvaluation;
+
+    //! Compiled program, created when the expression is prepared in bytecode evaluation mode
+    std::unique_ptr< QgsExpressionBytecodeProgram > mBytecode;
+
     QgsExpressionPrivate &operator= ( const QgsExpressionPrivate & ) = delete;
 };
 
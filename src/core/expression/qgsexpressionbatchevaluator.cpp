@@ -0,0 +1,881 @@
+/***************************************************************************
+  qgsexpressionbatchevaluator.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionbatchevaluator.h"
+#include "qgsexpressionbytecode.h"
+#include "qgsexpression.h"
+#include "qgsexpressioncontext.h"
+#include "qgsexpressionfunction.h"
+#include "qgsexpressionutils.h"
+
+#include <cmath>
+
+///@cond PRIVATE
+
+using MathFunction = QgsExpressionBytecodeProgram::MathFunction;
+
+// applies a math function to all values of an array, in a loop the compiler can vectorize
+template <typename F>
+static void applyMathFunction( const std::vector< double > &x, std::vector< double > &result, F f )
+{
+  const std::size_t size = x.size();
+  for ( std::size_t i = 0; i < size; ++i )
+    result[i] = f( x[i] );
+}
+
+//
+// QgsExpressionBatchEvaluator::Column
+//
+
+QVariant QgsExpressionBatchEvaluator::Column::value( int i ) const
+{
+  // values loaded from features or literals are returned unchanged
+  if ( !variants.empty() )
+    return variants[i];
+
+  if ( isNull( i ) )
+    return QVariant();
+
+  switch ( type )
+  {
+    case Int:
+      return intType == QVariant::Int ? QVariant( static_cast< int >( ints[i] ) ) : QVariant( ints[i] );
+    case Double:
+      return QVariant( doubles[i] );
+    case Variant:
+      break;
+  }
+  return QVariant();
+}
+
+//
+// QgsExpressionBatchEvaluator
+//
+
+QgsExpressionBatchEvaluator::QgsExpressionBatchEvaluator( QgsExpression *parent, QgsExpressionContext *context, const QgsFeatureList &features )
+  : mParent( parent )
+  , mContext( context )
+  , mFeatures( features )
+  , mErrors( features.size() )
+{
+  if ( mContext && mContext->hasVariable( QgsExpressionContext::EXPR_FIELDS ) )
+    mFields = qvariant_cast<QgsFields>( mContext->variable( QgsExpressionContext::EXPR_FIELDS ) );
+}
+
+QVariantList QgsExpressionBatchEvaluator::evaluate( QgsExpressionNode *node )
+{
+  const int size = mFeatures.size();
+  std::vector< int > rows( size );
+  for ( int i = 0; i < size; ++i )
+    rows[i] = i;
+
+  const Column column = evalNode( node, rows );
+
+  QVariantList results;
+  results.reserve( size );
+  for ( int i = 0; i < size; ++i )
+    results << ( hasError( i ) ? QVariant() : column.value( i ) );
+  return results;
+}
+
+QString QgsExpressionBatchEvaluator::firstError() const
+{
+  for ( const QString &error : mErrors )
+  {
+    if ( !error.isNull() )
+      return error;
+  }
+  return QString();
+}
+
+bool QgsExpressionBatchEvaluator::checkError( int row )
+{
+  if ( !mParent->hasEvalError() )
+    return false;
+
+  if ( mErrors[ row ].isNull() )
+    mErrors[ row ] = mParent->evalErrorString();
+  mParent->setEvalErrorString( QString() );
+  return true;
+}
+
+std::vector< int > QgsExpressionBatchEvaluator::activeRows( const std::vector< int > &rows ) const
+{
+  std::vector< int > res;
+  res.reserve( rows.size() );
+  for ( int row : rows )
+  {
+    if ( !hasError( row ) )
+      res.emplace_back( row );
+  }
+  return res;
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::evalNode( QgsExpressionNode *node, const std::vector< int > &rows )
+{
+  if ( rows.empty() )
+    return constant( QVariant(), mFeatures.size() );
+
+  if ( node->hasCachedStaticValue() )
+    return constant( node->cachedStaticValue(), mFeatures.size() );
+
+  if ( node->effectiveNode() != node )
+    return evalNode( node->effectiveNode(), rows );
+
+  switch ( node->nodeType() )
+  {
+    case QgsExpressionNode::ntLiteral:
+      return constant( static_cast< const QgsExpressionNodeLiteral * >( node )->value(), mFeatures.size() );
+
+    case QgsExpressionNode::ntColumnRef:
+      return evalColumnRef( static_cast< QgsExpressionNodeColumnRef * >( node ), rows );
+
+    case QgsExpressionNode::ntUnaryOperator:
+      return evalUnaryOperator( static_cast< QgsExpressionNodeUnaryOperator * >( node ), rows );
+
+    case QgsExpressionNode::ntBinaryOperator:
+      return evalBinaryOperator( static_cast< QgsExpressionNodeBinaryOperator * >( node ), rows );
+
+    case QgsExpressionNode::ntCondition:
+      return evalCondition( static_cast< QgsExpressionNodeCondition * >( node ), rows );
+
+    case QgsExpressionNode::ntFunction:
+      return evalFunction( static_cast< QgsExpressionNodeFunction * >( node ), rows );
+
+    case QgsExpressionNode::ntInOperator:
+    case QgsExpressionNode::ntIndexOperator:
+      break;
+  }
+
+  return evalFallback( node, rows );
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::evalFallback( QgsExpressionNode *node, const std::vector< int > &rows )
+{
+  std::vector< QVariant > values( mFeatures.size() );
+  for ( int row : rows )
+  {
+    mContext->setFeature( mFeatures.at( row ) );
+    values[ row ] = node->eval( mParent, mContext );
+    if ( checkError( row ) )
+      values[ row ] = QVariant();
+  }
+  return fromVariants( std::move( values ) );
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::evalColumnRef( QgsExpressionNodeColumnRef *node, const std::vector< int > &rows )
+{
+  const int index = mFields.lookupField( node->name() );
+  if ( index < 0 )
+    return evalFallback( node, rows );
+
+  std::vector< QVariant > values( mFeatures.size() );
+  for ( int row : rows )
+  {
+    const QgsFeature &feature = mFeatures.at( row );
+    if ( feature.isValid() )
+    {
+      values[ row ] = feature.attribute( index );
+    }
+    else
+    {
+      // let the tree walker raise the error
+      mContext->setFeature( feature );
+      values[ row ] = node->eval( mParent, mContext );
+      if ( checkError( row ) )
+        values[ row ] = QVariant();
+    }
+  }
+  return fromVariants( std::move( values ) );
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::evalUnaryOperator( QgsExpressionNodeUnaryOperator *node, const std::vector< int > &rows )
+{
+  const Column operand = evalNode( node->operand(), rows );
+  const std::vector< int > active = activeRows( rows );
+
+  if ( node->op() == QgsExpressionNodeUnaryOperator::uoNot )
+  {
+    TruthColumn tvl = truthValues( operand, active );
+    for ( int &value : tvl )
+      value = QgsExpressionUtils::NOT[ value ];
+    return fromTruthValues( tvl );
+  }
+
+  Column result;
+  switch ( operand.type )
+  {
+    case Column::Int:
+    {
+      result.type = Column::Int;
+      result.ints.resize( operand.ints.size() );
+      const std::size_t size = operand.ints.size();
+      for ( std::size_t i = 0; i < size; ++i )
+        result.ints[i] = -operand.ints[i];
+      break;
+    }
+
+    case Column::Double:
+    {
+      result.type = Column::Double;
+      result.doubles.resize( operand.doubles.size() );
+      const std::size_t size = operand.doubles.size();
+      for ( std::size_t i = 0; i < size; ++i )
+        result.doubles[i] = -operand.doubles[i];
+      break;
+    }
+
+    case Column::Variant:
+      break;
+  }
+
+  if ( result.type != Column::Variant && operand.nulls.empty() )
+    return result;
+
+  // NULL and non numeric values are left to the tree walker, which treats typed NULL values as zero
+  std::vector< QVariant > values( mFeatures.size() );
+  for ( int row : active )
+  {
+    if ( result.type != Column::Variant && !operand.isNull( row ) )
+    {
+      values[ row ] = result.value( row );
+      continue;
+    }
+
+    QgsExpressionNodeUnaryOperator minus( QgsExpressionNodeUnaryOperator::uoMinus, new QgsExpressionNodeLiteral( operand.value( row ) ) );
+    values[ row ] = minus.eval( mParent, mContext );
+    if ( checkError( row ) )
+      values[ row ] = QVariant();
+  }
+  return fromVariants( std::move( values ) );
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::evalBinaryOperator( QgsExpressionNodeBinaryOperator *node, const std::vector< int > &rows )
+{
+  const QgsExpressionNodeBinaryOperator::BinaryOperator op = node->op();
+  if ( op == QgsExpressionNodeBinaryOperator::boAnd || op == QgsExpressionNodeBinaryOperator::boOr )
+    return evalLogicalOperator( node, rows );
+
+  const Column left = evalNode( node->opLeft(), rows );
+  const std::vector< int > leftRows = activeRows( rows );
+  const Column right = evalNode( node->opRight(), leftRows );
+  const std::vector< int > active = activeRows( leftRows );
+
+  const bool numeric = left.type != Column::Variant && right.type != Column::Variant;
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boIntDiv:
+      // the tree walker handles NULL values for integer divisions in its own way
+      if ( !left.nulls.empty() || !right.nulls.empty() )
+        break;
+      FALLTHROUGH
+
+    case QgsExpressionNodeBinaryOperator::boPlus:
+    case QgsExpressionNodeBinaryOperator::boMinus:
+    case QgsExpressionNodeBinaryOperator::boMul:
+    case QgsExpressionNodeBinaryOperator::boDiv:
+    case QgsExpressionNodeBinaryOperator::boMod:
+    case QgsExpressionNodeBinaryOperator::boPow:
+      if ( numeric )
+        return arithmetic( op, left, right );
+      break;
+
+    case QgsExpressionNodeBinaryOperator::boEQ:
+    case QgsExpressionNodeBinaryOperator::boNE:
+    case QgsExpressionNodeBinaryOperator::boLT:
+    case QgsExpressionNodeBinaryOperator::boGT:
+    case QgsExpressionNodeBinaryOperator::boLE:
+    case QgsExpressionNodeBinaryOperator::boGE:
+    case QgsExpressionNodeBinaryOperator::boIs:
+    case QgsExpressionNodeBinaryOperator::boIsNot:
+      if ( numeric )
+        return compare( op, left, right );
+      break;
+
+    default:
+      break;
+  }
+
+  return binaryOperatorByFeature( op, left, right, active );
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::evalLogicalOperator( QgsExpressionNodeBinaryOperator *node, const std::vector< int > &rows )
+{
+  const bool isAnd = node->op() == QgsExpressionNodeBinaryOperator::boAnd;
+
+  const Column left = evalNode( node->opLeft(), rows );
+  std::vector< int > active = activeRows( rows );
+  TruthColumn result = truthValues( left, active );
+  active = activeRows( active );
+
+  // the right hand side is only evaluated for features which are not already decided by the left hand side
+  std::vector< int > rightRows;
+  rightRows.reserve( active.size() );
+  const int shortcut = isAnd ? QgsExpressionUtils::False : QgsExpressionUtils::True;
+  for ( int row : active )
+  {
+    if ( result[ row ] != shortcut )
+      rightRows.emplace_back( row );
+  }
+  if ( rightRows.empty() )
+    return fromTruthValues( result );
+
+  const Column right = evalNode( node->opRight(), rightRows );
+  rightRows = activeRows( rightRows );
+  const TruthColumn tvlRight = truthValues( right, rightRows );
+
+  for ( int row : rightRows )
+  {
+    if ( hasError( row ) )
+      continue;
+    result[ row ] = isAnd ? QgsExpressionUtils::AND[ result[ row ] ][ tvlRight[ row ] ] : QgsExpressionUtils::OR[ result[ row ] ][ tvlRight[ row ] ];
+  }
+  return fromTruthValues( result );
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::evalCondition( QgsExpressionNodeCondition *node, const std::vector< int > &rows )
+{
+  std::vector< QVariant > values( mFeatures.size() );
+  std::vector< int > remaining = rows;
+
+  const QgsExpressionNodeCondition::WhenThenList conditions = node->conditions();
+  for ( QgsExpressionNodeCondition::WhenThen *condition : conditions )
+  {
+    if ( remaining.empty() )
+      break;
+
+    const Column when = evalNode( condition->whenExp(), remaining );
+    remaining = activeRows( remaining );
+    const TruthColumn tvl = truthValues( when, remaining );
+
+    std::vector< int > thenRows;
+    std::vector< int > otherRows;
+    for ( int row : remaining )
+    {
+      if ( hasError( row ) )
+        continue;
+      if ( tvl[ row ] == QgsExpressionUtils::True )
+        thenRows.emplace_back( row );
+      else
+        otherRows.emplace_back( row );
+    }
+    remaining = std::move( otherRows );
+
+    if ( thenRows.empty() )
+      continue;
+
+    const Column then = evalNode( condition->thenExp(), thenRows );
+    for ( int row : thenRows )
+    {
+      if ( !hasError( row ) )
+        values[ row ] = then.value( row );
+    }
+  }
+
+  if ( node->elseExp() && !remaining.empty() )
+  {
+    const Column elseColumn = evalNode( node->elseExp(), remaining );
+    for ( int row : remaining )
+    {
+      if ( !hasError( row ) )
+        values[ row ] = elseColumn.value( row );
+    }
+  }
+
+  // features without matching condition are NULL
+  return fromVariants( std::move( values ) );
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::evalFunction( QgsExpressionNodeFunction *node, const std::vector< int > &rows )
+{
+  MathFunction function;
+  if ( !QgsExpressionBytecodeProgram::compilableMathFunction( node, mContext, function ) )
+    return evalFallback( node, rows );
+
+  const Column argument = evalNode( node->args()->at( 0 ), rows );
+  const std::vector< int > active = activeRows( rows );
+
+  if ( argument.type == Column::Variant )
+  {
+    QgsExpressionFunction *fd = QgsExpression::Functions()[ node->fnIndex() ];
+    std::vector< QVariant > values( mFeatures.size() );
+    for ( int row : active )
+    {
+      const QVariant value = argument.value( row );
+      // like all "normal" functions, return NULL when the argument is NULL
+      if ( QgsExpressionUtils::isNull( value ) )
+        continue;
+
+      values[ row ] = fd->func( QVariantList() << value, mContext, mParent, node );
+      if ( checkError( row ) )
+        values[ row ] = QVariant();
+    }
+    return fromVariants( std::move( values ) );
+  }
+
+  const std::vector< double > x = toDoubles( argument );
+  Column result;
+  result.type = Column::Double;
+  result.doubles.resize( x.size() );
+  result.nulls = argument.nulls;
+
+  switch ( function )
+  {
+    case MathFunction::Sqrt:
+      applyMathFunction( x, result.doubles, []( double v ) { return std::sqrt( v ); } );
+      break;
+    case MathFunction::Abs:
+      applyMathFunction( x, result.doubles, []( double v ) { return std::fabs( v ); } );
+      break;
+    case MathFunction::Sin:
+      applyMathFunction( x, result.doubles, []( double v ) { return std::sin( v ); } );
+      break;
+    case MathFunction::Cos:
+      applyMathFunction( x, result.doubles, []( double v ) { return std::cos( v ); } );
+      break;
+    case MathFunction::Tan:
+      applyMathFunction( x, result.doubles, []( double v ) { return std::tan( v ); } );
+      break;
+    case MathFunction::Asin:
+      applyMathFunction( x, result.doubles, []( double v ) { return std::asin( v ); } );
+      break;
+    case MathFunction::Acos:
+      applyMathFunction( x, result.doubles, []( double v ) { return std::acos( v ); } );
+      break;
+    case MathFunction::Atan:
+      applyMathFunction( x, result.doubles, []( double v ) { return std::atan( v ); } );
+      break;
+    case MathFunction::Exp:
+      applyMathFunction( x, result.doubles, []( double v ) { return std::exp( v ); } );
+      break;
+    case MathFunction::Floor:
+      applyMathFunction( x, result.doubles, []( double v ) { return std::floor( v ); } );
+      break;
+    case MathFunction::Ceil:
+      applyMathFunction( x, result.doubles, []( double v ) { return std::ceil( v ); } );
+      break;
+
+    case MathFunction::Ln:
+    case MathFunction::Log10:
+    {
+      const bool ln = function == MathFunction::Ln;
+      applyMathFunction( x, result.doubles, [ln]( double v ) { return v <= 0 ? 0 : ( ln ? std::log( v ) : std::log10( v ) ); } );
+
+      // logarithms of values <= 0 are NULL
+      const std::size_t size = x.size();
+      for ( std::size_t i = 0; i < size; ++i )
+      {
+        if ( x[i] <= 0 )
+        {
+          if ( result.nulls.empty() )
+            result.nulls.resize( size, 0 );
+          result.nulls[i] = 1;
+        }
+      }
+      break;
+    }
+  }
+
+  checkFinite( result );
+  return result;
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::arithmetic( QgsExpressionNodeBinaryOperator::BinaryOperator op, const Column &left, const Column &right )
+{
+  Column result;
+  result.nulls = combineNulls( left, right );
+  const std::size_t size = mFeatures.size();
+
+  const bool integers = left.type == Column::Int && right.type == Column::Int;
+  if ( integers && ( op == QgsExpressionNodeBinaryOperator::boPlus || op == QgsExpressionNodeBinaryOperator::boMinus
+                     || op == QgsExpressionNodeBinaryOperator::boMul || op == QgsExpressionNodeBinaryOperator::boMod ) )
+  {
+    // both are integers - use integer arithmetic, as the tree walker does
+    result.type = Column::Int;
+    result.ints.resize( size );
+    const qlonglong *iL = left.ints.data();
+    const qlonglong *iR = right.ints.data();
+    qlonglong *res = result.ints.data();
+    switch ( op )
+    {
+      case QgsExpressionNodeBinaryOperator::boPlus:
+        for ( std::size_t i = 0; i < size; ++i )
+          res[i] = iL[i] + iR[i];
+        break;
+      case QgsExpressionNodeBinaryOperator::boMinus:
+        for ( std::size_t i = 0; i < size; ++i )
+          res[i] = iL[i] - iR[i];
+        break;
+      case QgsExpressionNodeBinaryOperator::boMul:
+        for ( std::size_t i = 0; i < size; ++i )
+          res[i] = iL[i] * iR[i];
+        break;
+      default:
+        for ( std::size_t i = 0; i < size; ++i )
+        {
+          if ( iR[i] == 0 )
+          {
+            if ( result.nulls.empty() )
+              result.nulls.resize( size, 0 );
+            result.nulls[i] = 1;
+            res[i] = 0;
+          }
+          else
+          {
+            res[i] = iL[i] % iR[i];
+          }
+        }
+        break;
+    }
+    return result;
+  }
+
+  const std::vector< double > dL = toDoubles( left );
+  const std::vector< double > dR = toDoubles( right );
+  const double *fL = dL.data();
+  const double *fR = dR.data();
+
+  if ( op == QgsExpressionNodeBinaryOperator::boIntDiv )
+  {
+    result.type = Column::Int;
+    result.ints.resize( size );
+    qlonglong *res = result.ints.data();
+    for ( std::size_t i = 0; i < size; ++i )
+    {
+      if ( fR[i] == 0. )
+      {
+        if ( result.nulls.empty() )
+          result.nulls.resize( size, 0 );
+        result.nulls[i] = 1;
+        res[i] = 0;
+      }
+      else
+      {
+        res[i] = static_cast< qlonglong >( std::floor( fL[i] / fR[i] ) );
+      }
+    }
+    return result;
+  }
+
+  result.type = Column::Double;
+  result.doubles.resize( size );
+  double *res = result.doubles.data();
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boPlus:
+      for ( std::size_t i = 0; i < size; ++i )
+        res[i] = fL[i] + fR[i];
+      break;
+    case QgsExpressionNodeBinaryOperator::boMinus:
+      for ( std::size_t i = 0; i < size; ++i )
+        res[i] = fL[i] - fR[i];
+      break;
+    case QgsExpressionNodeBinaryOperator::boMul:
+      for ( std::size_t i = 0; i < size; ++i )
+        res[i] = fL[i] * fR[i];
+      break;
+    case QgsExpressionNodeBinaryOperator::boPow:
+      for ( std::size_t i = 0; i < size; ++i )
+        res[i] = std::pow( fL[i], fR[i] );
+      break;
+    case QgsExpressionNodeBinaryOperator::boDiv:
+    case QgsExpressionNodeBinaryOperator::boMod:
+    {
+      const bool div = op == QgsExpressionNodeBinaryOperator::boDiv;
+      for ( std::size_t i = 0; i < size; ++i )
+        res[i] = fR[i] == 0. ? 0 : ( div ? fL[i] / fR[i] : std::fmod( fL[i], fR[i] ) );
+
+      // silently handle division by zero and return NULL
+      for ( std::size_t i = 0; i < size; ++i )
+      {
+        if ( fR[i] == 0. )
+        {
+          if ( result.nulls.empty() )
+            result.nulls.resize( size, 0 );
+          result.nulls[i] = 1;
+        }
+      }
+      break;
+    }
+    default:
+      Q_ASSERT( false );
+      break;
+  }
+
+  checkFinite( result );
+  return result;
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::compare( QgsExpressionNodeBinaryOperator::BinaryOperator op, const Column &left, const Column &right )
+{
+  const std::size_t size = mFeatures.size();
+  const std::vector< double > dL = toDoubles( left );
+  const std::vector< double > dR = toDoubles( right );
+
+  // the tree walker compares all numbers as doubles
+  std::vector< char > res( size );
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boIs:
+    case QgsExpressionNodeBinaryOperator::boEQ:
+      for ( std::size_t i = 0; i < size; ++i )
+        res[i] = qgsDoubleNear( dL[i] - dR[i], 0.0 );
+      break;
+    case QgsExpressionNodeBinaryOperator::boIsNot:
+    case QgsExpressionNodeBinaryOperator::boNE:
+      for ( std::size_t i = 0; i < size; ++i )
+        res[i] = !qgsDoubleNear( dL[i] - dR[i], 0.0 );
+      break;
+    case QgsExpressionNodeBinaryOperator::boLT:
+      for ( std::size_t i = 0; i < size; ++i )
+        res[i] = dL[i] - dR[i] < 0;
+      break;
+    case QgsExpressionNodeBinaryOperator::boGT:
+      for ( std::size_t i = 0; i < size; ++i )
+        res[i] = dL[i] - dR[i] > 0;
+      break;
+    case QgsExpressionNodeBinaryOperator::boLE:
+      for ( std::size_t i = 0; i < size; ++i )
+        res[i] = dL[i] - dR[i] <= 0;
+      break;
+    case QgsExpressionNodeBinaryOperator::boGE:
+      for ( std::size_t i = 0; i < size; ++i )
+        res[i] = dL[i] - dR[i] >= 0;
+      break;
+    default:
+      Q_ASSERT( false );
+      break;
+  }
+
+  TruthColumn tvl( size );
+  const bool isOperator = op == QgsExpressionNodeBinaryOperator::boIs || op == QgsExpressionNodeBinaryOperator::boIsNot;
+  for ( std::size_t i = 0; i < size; ++i )
+  {
+    const bool leftNull = left.isNull( static_cast< int >( i ) );
+    const bool rightNull = right.isNull( static_cast< int >( i ) );
+    if ( !leftNull && !rightNull )
+    {
+      tvl[i] = res[i] ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+    }
+    else if ( isOperator )
+    {
+      const bool equal = leftNull && rightNull;
+      tvl[i] = ( op == QgsExpressionNodeBinaryOperator::boIs ) == equal ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+    }
+    else
+    {
+      tvl[i] = QgsExpressionUtils::Unknown;
+    }
+  }
+  return fromTruthValues( tvl );
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::binaryOperatorByFeature( QgsExpressionNodeBinaryOperator::BinaryOperator op, const Column &left, const Column &right, const std::vector< int > &rows )
+{
+  std::vector< QVariant > values( mFeatures.size() );
+  for ( int row : rows )
+  {
+    QgsExpressionNodeBinaryOperator node( op, new QgsExpressionNodeLiteral( left.value( row ) ), new QgsExpressionNodeLiteral( right.value( row ) ) );
+    values[ row ] = node.eval( mParent, mContext );
+    if ( checkError( row ) )
+      values[ row ] = QVariant();
+  }
+  return fromVariants( std::move( values ) );
+}
+
+QgsExpressionBatchEvaluator::TruthColumn QgsExpressionBatchEvaluator::truthValues( const Column &column, const std::vector< int > &rows )
+{
+  const std::size_t size = mFeatures.size();
+  TruthColumn tvl( size, QgsExpressionUtils::Unknown );
+  switch ( column.type )
+  {
+    case Column::Int:
+      for ( std::size_t i = 0; i < size; ++i )
+        tvl[i] = column.ints[i] != 0 ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+      break;
+
+    case Column::Double:
+      for ( std::size_t i = 0; i < size; ++i )
+        tvl[i] = !qgsDoubleNear( column.doubles[i], 0.0 ) ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+      break;
+
+    case Column::Variant:
+      for ( int row : rows )
+      {
+        tvl[ row ] = QgsExpressionUtils::getTVLValue( column.variants[ row ], mParent );
+        checkError( row );
+      }
+      return tvl;
+  }
+
+  if ( !column.nulls.empty() )
+  {
+    for ( std::size_t i = 0; i < size; ++i )
+    {
+      if ( column.nulls[i] )
+        tvl[i] = QgsExpressionUtils::Unknown;
+    }
+  }
+  return tvl;
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::fromVariants( std::vector< QVariant > &&values )
+{
+  Column column;
+  const std::size_t size = values.size();
+
+  bool allIntegers = true;
+  bool allDoubles = true;
+  bool hasNulls = false;
+  for ( const QVariant &value : values )
+  {
+    if ( value.isNull() )
+    {
+      hasNulls = true;
+      continue;
+    }
+
+    switch ( value.type() )
+    {
+      case QVariant::Int:
+      case QVariant::UInt:
+      case QVariant::LongLong:
+        allDoubles = false;
+        break;
+
+      case QVariant::Double:
+        allIntegers = false;
+        if ( !std::isfinite( value.toDouble() ) )
+          allDoubles = false;
+        break;
+
+      default:
+        allIntegers = false;
+        allDoubles = false;
+        break;
+    }
+
+    if ( !allIntegers && !allDoubles )
+      break;
+  }
+
+  if ( allIntegers )
+  {
+    column.type = Column::Int;
+    column.ints.resize( size );
+    for ( std::size_t i = 0; i < size; ++i )
+      column.ints[i] = values[i].isNull() ? 0 : values[i].toLongLong();
+  }
+  else if ( allDoubles )
+  {
+    column.type = Column::Double;
+    column.doubles.resize( size );
+    for ( std::size_t i = 0; i < size; ++i )
+      column.doubles[i] = values[i].isNull() ? 0 : values[i].toDouble();
+  }
+
+  if ( column.type != Column::Variant && hasNulls )
+  {
+    column.nulls.resize( size );
+    for ( std::size_t i = 0; i < size; ++i )
+      column.nulls[i] = values[i].isNull();
+  }
+
+  // keep the original values, so that they are returned unchanged
+  column.variants = std::move( values );
+  return column;
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::fromTruthValues( const TruthColumn &values )
+{
+  Column column;
+  column.type = Column::Int;
+  column.intType = QVariant::Int;
+  const std::size_t size = values.size();
+  column.ints.resize( size );
+  for ( std::size_t i = 0; i < size; ++i )
+    column.ints[i] = values[i] == QgsExpressionUtils::True ? 1 : 0;
+
+  for ( std::size_t i = 0; i < size; ++i )
+  {
+    if ( values[i] == QgsExpressionUtils::Unknown )
+    {
+      if ( column.nulls.empty() )
+        column.nulls.resize( size, 0 );
+      column.nulls[i] = 1;
+    }
+  }
+  return column;
+}
+
+QgsExpressionBatchEvaluator::Column QgsExpressionBatchEvaluator::constant( const QVariant &value, int size )
+{
+  return fromVariants( std::vector< QVariant >( size, value ) );
+}
+
+std::vector< double > QgsExpressionBatchEvaluator::toDoubles( const Column &column )
+{
+  if ( column.type == Column::Double )
+    return column.doubles;
+
+  std::vector< double > res( column.ints.size() );
+  const std::size_t size = column.ints.size();
+  for ( std::size_t i = 0; i < size; ++i )
+    res[i] = static_cast< double >( column.ints[i] );
+  return res;
+}
+
+std::vector< char > QgsExpressionBatchEvaluator::combineNulls( const Column &left, const Column &right )
+{
+  if ( left.nulls.empty() )
+    return right.nulls;
+  if ( right.nulls.empty() )
+    return left.nulls;
+
+  std::vector< char > res( left.nulls.size() );
+  const std::size_t size = left.nulls.size();
+  for ( std::size_t i = 0; i < size; ++i )
+    res[i] = left.nulls[i] | right.nulls[i];
+  return res;
+}
+
+void QgsExpressionBatchEvaluator::checkFinite( Column &column )
+{
+  if ( column.type != Column::Double )
+    return;
+
+  const std::size_t size = column.doubles.size();
+  bool finite = true;
+  for ( std::size_t i = 0; i < size; ++i )
+  {
+    if ( !column.isNull( static_cast< int >( i ) ) && !std::isfinite( column.doubles[i] ) )
+    {
+      finite = false;
+      break;
+    }
+  }
+  if ( finite )
+    return;
+
+  // non finite numbers are rejected by most operators, so they need the tree walker
+  column.variants.resize( size );
+  for ( std::size_t i = 0; i < size; ++i )
+    column.variants[i] = column.isNull( static_cast< int >( i ) ) ? QVariant() : QVariant( column.doubles[i] );
+  column.type = Column::Variant;
+  column.doubles.clear();
+  column.nulls.clear();
+}
+
+///@endcond PRIVATE
@@ -0,0 +1,156 @@
+/***************************************************************************
+  qgsexpressionbatchevaluator.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONBATCHEVALUATOR_H
+#define QGSEXPRESSIONBATCHEVALUATOR_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+#include "qgsexpressionnodeimpl.h"
+#include "qgsfeature.h"
+#include "qgsfields.h"
+
+#include <QVariant>
+#include <vector>
+
+class QgsExpression;
+class QgsExpressionContext;
+
+///@cond PRIVATE
+
+/**
+ * \ingroup core
+ * \brief Evaluates a prepared expression node tree over a block of features at once.
+ *
+ * Every node is evaluated for all features of the block before its parent node, producing a
+ * typed column of values. Columns of integer or double values are stored in plain arrays, and
+ * arithmetic, comparison, logical operators and the basic math functions are computed with
+ * tight loops over these arrays, which the compiler can vectorize.
+ *
+ * Columns containing values of other types (strings, dates, geometries...) and nodes without
+ * a columnar implementation are evaluated feature by feature using the tree walking evaluation,
+ * so results are identical to evaluating the expression for each feature individually.
+ *
+ * Logical operators and CASE conditions only evaluate their dependent nodes for the features
+ * which need them.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsExpressionBatchEvaluator
+{
+  public:
+
+    /**
+     * Constructor for QgsExpressionBatchEvaluator, for evaluating nodes of the \a parent
+     * expression over a block of \a features.
+     *
+     * The feature of the \a context is changed when nodes are evaluated feature by feature.
+     */
+    QgsExpressionBatchEvaluator( QgsExpression *parent, QgsExpressionContext *context, const QgsFeatureList &features );
+
+    /**
+     * Evaluates a prepared \a node for all features, returning a list containing the result
+     * for each feature (in the same order as the features).
+     *
+     * NULL values are returned for features for which the evaluation failed.
+     */
+    QVariantList evaluate( QgsExpressionNode *node );
+
+    /**
+     * Returns the evaluation error raised for the first feature (in block order) whose evaluation
+     * failed, or an empty string if all features were evaluated successfully.
+     */
+    QString firstError() const;
+
+  private:
+
+    //! Column of values, one for each evaluated feature
+    struct Column
+    {
+      enum Type
+      {
+        Int, //!< Integer or NULL values, stored in ints
+        Double, //!< Finite double or NULL values, stored in doubles
+        Variant, //!< Arbitrary values, stored in variants
+      };
+
+      Type type = Variant;
+
+      //! Variant type used to return values of integer columns without original values
+      QVariant::Type intType = QVariant::LongLong;
+
+      std::vector< qlonglong > ints;
+      std::vector< double > doubles;
+
+      //! NULL flags for integer and double columns, empty if no value is NULL
+      std::vector< char > nulls;
+
+      //! Values of variant columns, or original values of integer and double columns created from variants
+      std::vector< QVariant > variants;
+
+      bool isNull( int i ) const { return !nulls.empty() && nulls[i]; }
+      QVariant value( int i ) const;
+    };
+
+    //! Three valued logic values (QgsExpressionUtils::TVL), one for each evaluated feature
+    typedef std::vector< int > TruthColumn;
+
+    Column evalNode( QgsExpressionNode *node, const std::vector< int > &rows );
+    Column evalColumnRef( QgsExpressionNodeColumnRef *node, const std::vector< int > &rows );
+    Column evalUnaryOperator( QgsExpressionNodeUnaryOperator *node, const std::vector< int > &rows );
+    Column evalBinaryOperator( QgsExpressionNodeBinaryOperator *node, const std::vector< int > &rows );
+    Column evalLogicalOperator( QgsExpressionNodeBinaryOperator *node, const std::vector< int > &rows );
+    Column evalCondition( QgsExpressionNodeCondition *node, const std::vector< int > &rows );
+    Column evalFunction( QgsExpressionNodeFunction *node, const std::vector< int > &rows );
+    Column evalFallback( QgsExpressionNode *node, const std::vector< int > &rows );
+
+    Column arithmetic( QgsExpressionNodeBinaryOperator::BinaryOperator op, const Column &left, const Column &right );
+    Column compare( QgsExpressionNodeBinaryOperator::BinaryOperator op, const Column &left, const Column &right );
+
+    //! Evaluates a binary operator feature by feature, with the tree walker
+    Column binaryOperatorByFeature( QgsExpressionNodeBinaryOperator::BinaryOperator op, const Column &left, const Column &right, const std::vector< int > &rows );
+
+    TruthColumn truthValues( const Column &column, const std::vector< int > &rows );
+
+    //! Checks the parent expression for an evaluation error raised for the feature at \a row, and records it
+    bool checkError( int row );
+    bool hasError( int row ) const { return !mErrors[ row ].isNull(); }
+
+    //! Returns the \a rows for which no evaluation error was raised so far
+    std::vector< int > activeRows( const std::vector< int > &rows ) const;
+
+    static Column fromVariants( std::vector< QVariant > &&values );
+    static Column fromTruthValues( const TruthColumn &values );
+    static Column constant( const QVariant &value, int size );
+    static std::vector< double > toDoubles( const Column &column );
+    static std::vector< char > combineNulls( const Column &left, const Column &right );
+
+    //! Converts double columns containing non finite values to variant columns, so that they are handled like the tree walker does
+    static void checkFinite( Column &column );
+
+    QgsExpression *mParent = nullptr;
+    QgsExpressionContext *mContext = nullptr;
+    QgsFeatureList mFeatures;
+    QgsFields mFields;
+
+    //! Evaluation errors for each feature, null strings for features without errors
+    std::vector< QString > mErrors;
+};
+
+///@endcond PRIVATE
+
+#endif // QGSEXPRESSIONBATCHEVALUATOR_H
@@ -0,0 +1,1014 @@
+/***************************************************************************
+  qgsexpressionbytecode.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionbytecode.h"
+#include "qgsexpression.h"
+#include "qgsexpressioncontext.h"
+#include "qgsexpressionfunction.h"
+#include "qgsexpressionutils.h"
+#include "qgsfeature.h"
+#include "qgsfields.h"
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <cmath>
+
+///@cond PRIVATE
+
+static bool isNumericType( QVariant::Type type )
+{
+  switch ( type )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::Double:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool isNumericValue( const QVariant &value )
+{
+  return value.isNull() || isNumericType( value.type() );
+}
+
+std::unique_ptr<QgsExpressionBytecodeProgram> QgsExpressionBytecodeProgram::compile( QgsExpressionNode *node, QgsExpression *parent, const QgsExpressionContext *context )
+{
+  if ( !node )
+    return nullptr;
+
+  // plain values are already as cheap as they can get
+  if ( node->hasCachedStaticValue() || node->effectiveNode() != node
+       || node->nodeType() == QgsExpressionNode::ntLiteral || node->nodeType() == QgsExpressionNode::ntColumnRef )
+    return nullptr;
+
+  QgsFields fields;
+  if ( context && context->hasVariable( QgsExpressionContext::EXPR_FIELDS ) )
+    fields = qvariant_cast<QgsFields>( context->variable( QgsExpressionContext::EXPR_FIELDS ) );
+
+  std::unique_ptr< QgsExpressionBytecodeProgram > program( new QgsExpressionBytecodeProgram() );
+  program->mResultRegister = program->compileNode( node, parent, context, fields );
+
+  // a program consisting only of tree walking fallbacks would just add overhead
+  if ( program->fallbackCount() == program->instructionCount() )
+    return nullptr;
+
+  // the constant pool is complete, so it's now safe to point registers at its values
+  for ( const RegisterLoad &load : std::as_const( program->mConstantLoads ) )
+  {
+    loadValue( program->mRegisters[ load.reg ], &program->mConstants[ load.index ] );
+  }
+
+  return program;
+}
+
+int QgsExpressionBytecodeProgram::fallbackCount() const
+{
+  return static_cast< int >( std::count_if( mInstructions.begin(), mInstructions.end(), []( const Instruction & instruction )
+  {
+    return instruction.opcode == Opcode::Fallback;
+  } ) );
+}
+
+bool QgsExpressionBytecodeProgram::isNumeric( const QgsExpressionNode *node, const QgsExpressionContext *context, const QgsFields &fields )
+{
+  if ( node->hasCachedStaticValue() )
+    return isNumericValue( node->cachedStaticValue() );
+
+  if ( node->effectiveNode() != node )
+    return false;
+
+  switch ( node->nodeType() )
+  {
+    case QgsExpressionNode::ntLiteral:
+      return isNumericValue( static_cast< const QgsExpressionNodeLiteral * >( node )->value() );
+
+    case QgsExpressionNode::ntColumnRef:
+    {
+      const int index = fields.lookupField( static_cast< const QgsExpressionNodeColumnRef * >( node )->name() );
+      return index >= 0 && isNumericType( fields.at( index ).type() );
+    }
+
+    case QgsExpressionNode::ntUnaryOperator:
+    {
+      const QgsExpressionNodeUnaryOperator *unary = static_cast< const QgsExpressionNodeUnaryOperator * >( node );
+      if ( unary->op() == QgsExpressionNodeUnaryOperator::uoNot )
+        return true;
+      return isNumeric( unary->operand(), context, fields );
+    }
+
+    case QgsExpressionNode::ntBinaryOperator:
+    {
+      const QgsExpressionNodeBinaryOperator *binary = static_cast< const QgsExpressionNodeBinaryOperator * >( node );
+      switch ( binary->op() )
+      {
+        case QgsExpressionNodeBinaryOperator::boOr:
+        case QgsExpressionNodeBinaryOperator::boAnd:
+          return true;
+
+        case QgsExpressionNodeBinaryOperator::boEQ:
+        case QgsExpressionNodeBinaryOperator::boNE:
+        case QgsExpressionNodeBinaryOperator::boLE:
+        case QgsExpressionNodeBinaryOperator::boGE:
+        case QgsExpressionNodeBinaryOperator::boLT:
+        case QgsExpressionNodeBinaryOperator::boGT:
+        case QgsExpressionNodeBinaryOperator::boIs:
+        case QgsExpressionNodeBinaryOperator::boIsNot:
+        case QgsExpressionNodeBinaryOperator::boPlus:
+        case QgsExpressionNodeBinaryOperator::boMinus:
+        case QgsExpressionNodeBinaryOperator::boMul:
+        case QgsExpressionNodeBinaryOperator::boDiv:
+        case QgsExpressionNodeBinaryOperator::boIntDiv:
+        case QgsExpressionNodeBinaryOperator::boMod:
+        case QgsExpressionNodeBinaryOperator::boPow:
+          return isNumeric( binary->opLeft(), context, fields ) && isNumeric( binary->opRight(), context, fields );
+
+        case QgsExpressionNodeBinaryOperator::boRegexp:
+        case QgsExpressionNodeBinaryOperator::boLike:
+        case QgsExpressionNodeBinaryOperator::boNotLike:
+        case QgsExpressionNodeBinaryOperator::boILike:
+        case QgsExpressionNodeBinaryOperator::boNotILike:
+        case QgsExpressionNodeBinaryOperator::boConcat:
+          return false;
+      }
+      return false;
+    }
+
+    case QgsExpressionNode::ntCondition:
+    {
+      const QgsExpressionNodeCondition *condition = static_cast< const QgsExpressionNodeCondition * >( node );
+      const QgsExpressionNodeCondition::WhenThenList conditions = condition->conditions();
+      for ( const QgsExpressionNodeCondition::WhenThen *whenThen : conditions )
+      {
+        if ( !isNumeric( whenThen->thenExp(), context, fields ) )
+          return false;
+      }
+      return !condition->elseExp() || isNumeric( condition->elseExp(), context, fields );
+    }
+
+    case QgsExpressionNode::ntFunction:
+    {
+      const QgsExpressionNodeFunction *function = static_cast< const QgsExpressionNodeFunction * >( node );
+      MathFunction mathFunction;
+      return compilableMathFunction( function, context, mathFunction ) && isNumeric( function->args()->at( 0 ), context, fields );
+    }
+
+    case QgsExpressionNode::ntInOperator:
+    case QgsExpressionNode::ntIndexOperator:
+      return false;
+  }
+  return false;
+}
+
+bool QgsExpressionBytecodeProgram::compilableMathFunction( const QgsExpressionNodeFunction *node, const QgsExpressionContext *context, MathFunction &function )
+{
+  if ( !node->args() || node->args()->count() != 1 || node->args()->hasNamedNodes() )
+    return false;
+
+  const QString name = QgsExpression::Functions()[node->fnIndex()]->name();
+
+  // functions can be overridden by the context at evaluation time
+  if ( context && context->hasFunction( name ) )
+    return false;
+
+  static const QMap< QString, MathFunction > sMathFunctions
+  {
+    { QStringLiteral( "sqrt" ), MathFunction::Sqrt },
+    { QStringLiteral( "abs" ), MathFunction::Abs },
+    { QStringLiteral( "sin" ), MathFunction::Sin },
+    { QStringLiteral( "cos" ), MathFunction::Cos },
+    { QStringLiteral( "tan" ), MathFunction::Tan },
+    { QStringLiteral( "asin" ), MathFunction::Asin },
+    { QStringLiteral( "acos" ), MathFunction::Acos },
+    { QStringLiteral( "atan" ), MathFunction::Atan },
+    { QStringLiteral( "exp" ), MathFunction::Exp },
+    { QStringLiteral( "ln" ), MathFunction::Ln },
+    { QStringLiteral( "log10" ), MathFunction::Log10 },
+    { QStringLiteral( "floor" ), MathFunction::Floor },
+    { QStringLiteral( "ceil" ), MathFunction::Ceil },
+  };
+
+  auto it = sMathFunctions.constFind( name );
+  if ( it == sMathFunctions.constEnd() )
+    return false;
+
+  function = it.value();
+  return true;
+}
+
+int QgsExpressionBytecodeProgram::newRegister()
+{
+  mRegisters.emplace_back( Register() );
+  return static_cast< int >( mRegisters.size() ) - 1;
+}
+
+int QgsExpressionBytecodeProgram::addInstruction( Opcode opcode, int dest, int a, int b, int arg, QgsExpressionNode *node )
+{
+  Instruction instruction;
+  instruction.opcode = opcode;
+  instruction.dest = dest;
+  instruction.a = a;
+  instruction.b = b;
+  instruction.arg = arg;
+  instruction.node = node;
+  mInstructions.emplace_back( instruction );
+  return static_cast< int >( mInstructions.size() ) - 1;
+}
+
+int QgsExpressionBytecodeProgram::addConstant( const QVariant &value )
+{
+  const int reg = newRegister();
+  mConstants.emplace_back( value );
+  mConstantLoads.emplace_back( RegisterLoad{ reg, static_cast< int >( mConstants.size() ) - 1, isNumericValue( value ) } );
+  return reg;
+}
+
+int QgsExpressionBytecodeProgram::addFallback( QgsExpressionNode *node )
+{
+  const int reg = newRegister();
+  addInstruction( Opcode::Fallback, reg, -1, -1, -1, node );
+  return reg;
+}
+
+int QgsExpressionBytecodeProgram::compileNode( QgsExpressionNode *node, QgsExpression *parent, const QgsExpressionContext *context, const QgsFields &fields )
+{
+  if ( node->hasCachedStaticValue() )
+    return addConstant( node->cachedStaticValue() );
+
+  // nodes which were simplified during preparation are left to the tree walker
+  if ( node->effectiveNode() != node )
+    return addFallback( node );
+
+  switch ( node->nodeType() )
+  {
+    case QgsExpressionNode::ntLiteral:
+      return addConstant( static_cast< const QgsExpressionNodeLiteral * >( node )->value() );
+
+    case QgsExpressionNode::ntColumnRef:
+    {
+      const int index = fields.lookupField( static_cast< const QgsExpressionNodeColumnRef * >( node )->name() );
+      if ( index < 0 )
+        return addFallback( node );
+
+      const int reg = newRegister();
+      mFieldLoads.emplace_back( RegisterLoad{ reg, index, isNumericType( fields.at( index ).type() ) } );
+      return reg;
+    }
+
+    case QgsExpressionNode::ntUnaryOperator:
+    {
+      QgsExpressionNodeUnaryOperator *unary = static_cast< QgsExpressionNodeUnaryOperator * >( node );
+      if ( unary->op() == QgsExpressionNodeUnaryOperator::uoNot )
+      {
+        const int operand = compileNode( unary->operand(), parent, context, fields );
+        const int reg = newRegister();
+        addInstruction( Opcode::Not, reg, operand );
+        return reg;
+      }
+      else if ( isNumeric( unary->operand(), context, fields ) )
+      {
+        const int operand = compileNode( unary->operand(), parent, context, fields );
+        const int reg = newRegister();
+        addInstruction( Opcode::Negate, reg, operand, -1, -1, node );
+        return reg;
+      }
+      return addFallback( node );
+    }
+
+    case QgsExpressionNode::ntBinaryOperator:
+      return compileBinaryOperator( static_cast< QgsExpressionNodeBinaryOperator * >( node ), parent, context, fields );
+
+    case QgsExpressionNode::ntCondition:
+      return compileCondition( static_cast< QgsExpressionNodeCondition * >( node ), parent, context, fields );
+
+    case QgsExpressionNode::ntFunction:
+      return compileFunction( static_cast< QgsExpressionNodeFunction * >( node ), parent, context, fields );
+
+    case QgsExpressionNode::ntInOperator:
+    case QgsExpressionNode::ntIndexOperator:
+      break;
+  }
+
+  return addFallback( node );
+}
+
+int QgsExpressionBytecodeProgram::compileBinaryOperator( QgsExpressionNodeBinaryOperator *node, QgsExpression *parent, const QgsExpressionContext *context, const QgsFields &fields )
+{
+  switch ( node->op() )
+  {
+    case QgsExpressionNodeBinaryOperator::boOr:
+    case QgsExpressionNodeBinaryOperator::boAnd:
+    {
+      // the left hand side short circuits evaluation of the right hand side, like the tree walker does
+      const int left = compileNode( node->opLeft(), parent, context, fields );
+      const int reg = newRegister();
+      const int leftInstruction = addInstruction( Opcode::LogicLeft, reg, left, -1, -1, node );
+      const int right = compileNode( node->opRight(), parent, context, fields );
+      addInstruction( Opcode::LogicRight, reg, -1, right, -1, node );
+      mInstructions[ leftInstruction ].arg = instructionCount();
+      return reg;
+    }
+
+    case QgsExpressionNodeBinaryOperator::boEQ:
+    case QgsExpressionNodeBinaryOperator::boNE:
+    case QgsExpressionNodeBinaryOperator::boLE:
+    case QgsExpressionNodeBinaryOperator::boGE:
+    case QgsExpressionNodeBinaryOperator::boLT:
+    case QgsExpressionNodeBinaryOperator::boGT:
+    case QgsExpressionNodeBinaryOperator::boIs:
+    case QgsExpressionNodeBinaryOperator::boIsNot:
+    case QgsExpressionNodeBinaryOperator::boPlus:
+    case QgsExpressionNodeBinaryOperator::boMinus:
+    case QgsExpressionNodeBinaryOperator::boMul:
+    case QgsExpressionNodeBinaryOperator::boDiv:
+    case QgsExpressionNodeBinaryOperator::boIntDiv:
+    case QgsExpressionNodeBinaryOperator::boMod:
+    case QgsExpressionNodeBinaryOperator::boPow:
+    {
+      // operators on other types (strings, dates, lists...) have too many special cases, leave them to the tree walker
+      if ( !isNumeric( node->opLeft(), context, fields ) || !isNumeric( node->opRight(), context, fields ) )
+        break;
+
+      const int left = compileNode( node->opLeft(), parent, context, fields );
+      const int right = compileNode( node->opRight(), parent, context, fields );
+      const int reg = newRegister();
+
+      Opcode opcode = Opcode::Arithmetic;
+      if ( node->op() == QgsExpressionNodeBinaryOperator::boIs || node->op() == QgsExpressionNodeBinaryOperator::boIsNot )
+        opcode = Opcode::Is;
+      else if ( node->op() < QgsExpressionNodeBinaryOperator::boRegexp )
+        opcode = Opcode::Compare;
+
+      addInstruction( opcode, reg, left, right, static_cast< int >( node->op() ), node );
+      return reg;
+    }
+
+    case QgsExpressionNodeBinaryOperator::boRegexp:
+    case QgsExpressionNodeBinaryOperator::boLike:
+    case QgsExpressionNodeBinaryOperator::boNotLike:
+    case QgsExpressionNodeBinaryOperator::boILike:
+    case QgsExpressionNodeBinaryOperator::boNotILike:
+    case QgsExpressionNodeBinaryOperator::boConcat:
+      break;
+  }
+
+  return addFallback( node );
+}
+
+int QgsExpressionBytecodeProgram::compileCondition( QgsExpressionNodeCondition *node, QgsExpression *parent, const QgsExpressionContext *context, const QgsFields &fields )
+{
+  const int reg = newRegister();
+  std::vector< int > jumpsToEnd;
+
+  const QgsExpressionNodeCondition::WhenThenList conditions = node->conditions();
+  for ( QgsExpressionNodeCondition::WhenThen *whenThen : conditions )
+  {
+    const int when = compileNode( whenThen->whenExp(), parent, context, fields );
+    const int jumpToNext = addInstruction( Opcode::JumpIfNotTrue, -1, when );
+    const int then = compileNode( whenThen->thenExp(), parent, context, fields );
+    addInstruction( Opcode::Move, reg, then );
+    jumpsToEnd.emplace_back( addInstruction( Opcode::Jump, -1 ) );
+    mInstructions[ jumpToNext ].arg = instructionCount();
+  }
+
+  if ( node->elseExp() )
+  {
+    const int elseReg = compileNode( node->elseExp(), parent, context, fields );
+    addInstruction( Opcode::Move, reg, elseReg );
+  }
+  else
+  {
+    addInstruction( Opcode::SetNull, reg );
+  }
+
+  for ( int jump : jumpsToEnd )
+    mInstructions[ jump ].arg = instructionCount();
+
+  return reg;
+}
+
+int QgsExpressionBytecodeProgram::compileFunction( QgsExpressionNodeFunction *node, QgsExpression *parent, const QgsExpressionContext *context, const QgsFields &fields )
+{
+  MathFunction function;
+  if ( !compilableMathFunction( node, context, function ) || !isNumeric( node->args()->at( 0 ), context, fields ) )
+    return addFallback( node );
+
+  const int argument = compileNode( node->args()->at( 0 ), parent, context, fields );
+  const int reg = newRegister();
+  addInstruction( Opcode::MathFunction, reg, argument, -1, static_cast< int >( function ), node );
+  return reg;
+}
+
+bool QgsExpressionBytecodeProgram::loadValue( Register &reg, const QVariant *value )
+{
+  reg.source = value;
+  if ( value->isNull() )
+  {
+    reg.type = Register::Null;
+    return true;
+  }
+
+  switch ( value->type() )
+  {
+    case QVariant::Int:
+      reg.type = Register::Int;
+      reg.intValue = value->toInt();
+      return true;
+
+    case QVariant::UInt:
+    case QVariant::LongLong:
+      reg.type = Register::LongLong;
+      reg.intValue = value->toLongLong();
+      return true;
+
+    case QVariant::Double:
+      reg.type = Register::Double;
+      reg.doubleValue = value->toDouble();
+      return true;
+
+    default:
+      reg.type = Register::Variant;
+      return false;
+  }
+}
+
+void QgsExpressionBytecodeProgram::setValue( Register &reg, const QVariant &value )
+{
+  reg.source = nullptr;
+  if ( value.isNull() )
+  {
+    reg.type = Register::Null;
+    // keep typed NULL values intact
+    reg.variant = value;
+    return;
+  }
+
+  switch ( value.type() )
+  {
+    case QVariant::Int:
+      reg.type = Register::Int;
+      reg.intValue = value.toInt();
+      return;
+
+    case QVariant::LongLong:
+      reg.type = Register::LongLong;
+      reg.intValue = value.toLongLong();
+      return;
+
+    case QVariant::Double:
+      reg.type = Register::Double;
+      reg.doubleValue = value.toDouble();
+      return;
+
+    default:
+      reg.type = Register::Variant;
+      reg.variant = value;
+      return;
+  }
+}
+
+QVariant QgsExpressionBytecodeProgram::toVariant( const Register &reg )
+{
+  if ( reg.source )
+    return *reg.source;
+
+  switch ( reg.type )
+  {
+    case Register::Int:
+      return QVariant( static_cast< int >( reg.intValue ) );
+    case Register::LongLong:
+      return QVariant( reg.intValue );
+    case Register::Double:
+      return QVariant( reg.doubleValue );
+    case Register::Null:
+    case Register::Variant:
+      break;
+  }
+  return reg.variant;
+}
+
+int QgsExpressionBytecodeProgram::truthValue( const Register &reg, QgsExpression *parent )
+{
+  switch ( reg.type )
+  {
+    case Register::Null:
+      return QgsExpressionUtils::Unknown;
+    case Register::Int:
+    case Register::LongLong:
+      return reg.intValue != 0 ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+    case Register::Double:
+      return !qgsDoubleNear( reg.doubleValue, 0.0 ) ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+    case Register::Variant:
+      break;
+  }
+  return QgsExpressionUtils::getTVLValue( toVariant( reg ), parent );
+}
+
+void QgsExpressionBytecodeProgram::setTruthValue( Register &reg, int tvl )
+{
+  reg.source = nullptr;
+  switch ( tvl )
+  {
+    case QgsExpressionUtils::True:
+      reg.type = Register::Int;
+      reg.intValue = 1;
+      break;
+    case QgsExpressionUtils::False:
+      reg.type = Register::Int;
+      reg.intValue = 0;
+      break;
+    default:
+      reg.type = Register::Null;
+      reg.variant = QVariant();
+      break;
+  }
+}
+
+// TRUE if the register holds a number which can be used by the numeric fast paths, i.e. a number the tree walker would not reject
+#define REGISTER_IS_FINITE_NUMBER( reg ) ( ( reg ).type == Register::Int || ( reg ).type == Register::LongLong || ( ( reg ).type == Register::Double && std::isfinite( ( reg ).doubleValue ) ) )
+#define REGISTER_TO_DOUBLE( reg ) ( ( reg ).type == Register::Double ? ( reg ).doubleValue : static_cast< double >( ( reg ).intValue ) )
+
+QVariant QgsExpressionBytecodeProgram::evaluateBinaryOperator( QgsExpressionNodeBinaryOperator::BinaryOperator op, const QVariant &left, const QVariant &right, QgsExpression *parent, const QgsExpressionContext *context )
+{
+  QgsExpressionNodeBinaryOperator node( op, new QgsExpressionNodeLiteral( left ), new QgsExpressionNodeLiteral( right ) );
+  return node.eval( parent, context );
+}
+
+void QgsExpressionBytecodeProgram::executeNegate( const Instruction &instruction, Register *registers, QgsExpression *parent, const QgsExpressionContext *context ) const
+{
+  const Register &operand = registers[ instruction.a ];
+  Register &dest = registers[ instruction.dest ];
+  dest.source = nullptr;
+
+  if ( operand.type == Register::Int || operand.type == Register::LongLong )
+  {
+    dest.type = Register::LongLong;
+    dest.intValue = -operand.intValue;
+  }
+  else if ( operand.type == Register::Double && std::isfinite( operand.doubleValue ) )
+  {
+    dest.type = Register::Double;
+    dest.doubleValue = -operand.doubleValue;
+  }
+  else
+  {
+    QgsExpressionNodeUnaryOperator node( QgsExpressionNodeUnaryOperator::uoMinus, new QgsExpressionNodeLiteral( toVariant( operand ) ) );
+    setValue( dest, node.eval( parent, context ) );
+  }
+}
+
+void QgsExpressionBytecodeProgram::executeArithmetic( const Instruction &instruction, Register *registers, QgsExpression *parent, const QgsExpressionContext *context ) const
+{
+  const Register &left = registers[ instruction.a ];
+  const Register &right = registers[ instruction.b ];
+  Register &dest = registers[ instruction.dest ];
+  const QgsExpressionNodeBinaryOperator::BinaryOperator op = static_cast< QgsExpressionNodeBinaryOperator::BinaryOperator >( instruction.arg );
+
+  if ( !REGISTER_IS_FINITE_NUMBER( left ) || !REGISTER_IS_FINITE_NUMBER( right ) )
+  {
+    // NULL values and non-finite numbers
+    setValue( dest, evaluateBinaryOperator( op, toVariant( left ), toVariant( right ), parent, context ) );
+    return;
+  }
+
+  dest.source = nullptr;
+  const bool integers = left.type != Register::Double && right.type != Register::Double;
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boPlus:
+    case QgsExpressionNodeBinaryOperator::boMinus:
+    case QgsExpressionNodeBinaryOperator::boMul:
+    case QgsExpressionNodeBinaryOperator::boMod:
+      if ( integers )
+      {
+        const qlonglong iL = left.intValue;
+        const qlonglong iR = right.intValue;
+        dest.type = Register::LongLong;
+        switch ( op )
+        {
+          case QgsExpressionNodeBinaryOperator::boPlus:
+            dest.intValue = iL + iR;
+            break;
+          case QgsExpressionNodeBinaryOperator::boMinus:
+            dest.intValue = iL - iR;
+            break;
+          case QgsExpressionNodeBinaryOperator::boMul:
+            dest.intValue = iL * iR;
+            break;
+          default:
+            if ( iR == 0 )
+            {
+              dest.type = Register::Null;
+              dest.variant = QVariant();
+            }
+            else
+            {
+              dest.intValue = iL % iR;
+            }
+            break;
+        }
+        return;
+      }
+      FALLTHROUGH
+
+    case QgsExpressionNodeBinaryOperator::boDiv:
+    {
+      const double fL = REGISTER_TO_DOUBLE( left );
+      const double fR = REGISTER_TO_DOUBLE( right );
+      dest.type = Register::Double;
+      switch ( op )
+      {
+        case QgsExpressionNodeBinaryOperator::boPlus:
+          dest.doubleValue = fL + fR;
+          break;
+        case QgsExpressionNodeBinaryOperator::boMinus:
+          dest.doubleValue = fL - fR;
+          break;
+        case QgsExpressionNodeBinaryOperator::boMul:
+          dest.doubleValue = fL * fR;
+          break;
+        default:
+          // silently handle division by zero and return NULL
+          if ( fR == 0. )
+          {
+            dest.type = Register::Null;
+            dest.variant = QVariant();
+          }
+          else
+          {
+            dest.doubleValue = op == QgsExpressionNodeBinaryOperator::boDiv ? fL / fR : std::fmod( fL, fR );
+          }
+          break;
+      }
+      return;
+    }
+
+    case QgsExpressionNodeBinaryOperator::boIntDiv:
+    {
+      const double fL = REGISTER_TO_DOUBLE( left );
+      const double fR = REGISTER_TO_DOUBLE( right );
+      if ( fR == 0. )
+      {
+        dest.type = Register::Null;
+        dest.variant = QVariant();
+      }
+      else
+      {
+        dest.type = Register::LongLong;
+        dest.intValue = static_cast< qlonglong >( std::floor( fL / fR ) );
+      }
+      return;
+    }
+
+    case QgsExpressionNodeBinaryOperator::boPow:
+      dest.type = Register::Double;
+      dest.doubleValue = std::pow( REGISTER_TO_DOUBLE( left ), REGISTER_TO_DOUBLE( right ) );
+      return;
+
+    default:
+      Q_ASSERT( false );
+      return;
+  }
+}
+
+void QgsExpressionBytecodeProgram::executeCompare( const Instruction &instruction, Register *registers, QgsExpression *parent, const QgsExpressionContext *context ) const
+{
+  const Register &left = registers[ instruction.a ];
+  const Register &right = registers[ instruction.b ];
+  Register &dest = registers[ instruction.dest ];
+  const QgsExpressionNodeBinaryOperator::BinaryOperator op = static_cast< QgsExpressionNodeBinaryOperator::BinaryOperator >( instruction.arg );
+
+  if ( instruction.opcode == Opcode::Is )
+  {
+    const bool leftNull = left.type == Register::Null;
+    const bool rightNull = right.type == Register::Null;
+    if ( leftNull || rightNull )
+    {
+      const bool equal = leftNull && rightNull;
+      setTruthValue( dest, ( op == QgsExpressionNodeBinaryOperator::boIs ) == equal ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+      return;
+    }
+  }
+  else if ( left.type == Register::Null || right.type == Register::Null )
+  {
+    setTruthValue( dest, QgsExpressionUtils::Unknown );
+    return;
+  }
+
+  if ( !REGISTER_IS_FINITE_NUMBER( left ) || !REGISTER_IS_FINITE_NUMBER( right ) )
+  {
+    setValue( dest, evaluateBinaryOperator( op, toVariant( left ), toVariant( right ), parent, context ) );
+    return;
+  }
+
+  // the tree walker compares all numbers as doubles
+  const double fL = REGISTER_TO_DOUBLE( left );
+  const double fR = REGISTER_TO_DOUBLE( right );
+  const double diff = fL - fR;
+  bool result = false;
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boIs:
+      result = qgsDoubleNear( fL, fR );
+      break;
+    case QgsExpressionNodeBinaryOperator::boIsNot:
+      result = !qgsDoubleNear( fL, fR );
+      break;
+    case QgsExpressionNodeBinaryOperator::boEQ:
+      result = qgsDoubleNear( diff, 0.0 );
+      break;
+    case QgsExpressionNodeBinaryOperator::boNE:
+      result = !qgsDoubleNear( diff, 0.0 );
+      break;
+    case QgsExpressionNodeBinaryOperator::boLT:
+      result = diff < 0;
+      break;
+    case QgsExpressionNodeBinaryOperator::boGT:
+      result = diff > 0;
+      break;
+    case QgsExpressionNodeBinaryOperator::boLE:
+      result = diff <= 0;
+      break;
+    case QgsExpressionNodeBinaryOperator::boGE:
+      result = diff >= 0;
+      break;
+    default:
+      Q_ASSERT( false );
+      break;
+  }
+  setTruthValue( dest, result ? QgsExpressionUtils::True : QgsExpressionUtils::False );
+}
+
+void QgsExpressionBytecodeProgram::executeMathFunction( const Instruction &instruction, Register *registers, QgsExpression *parent, const QgsExpressionContext *context ) const
+{
+  const Register &argument = registers[ instruction.a ];
+  Register &dest = registers[ instruction.dest ];
+
+  if ( argument.type == Register::Null )
+  {
+    // like all "normal" functions, return NULL when the argument is NULL
+    dest.source = nullptr;
+    dest.type = Register::Null;
+    dest.variant = QVariant();
+    return;
+  }
+
+  if ( !REGISTER_IS_FINITE_NUMBER( argument ) )
+  {
+    const QgsExpressionNodeFunction *node = static_cast< const QgsExpressionNodeFunction * >( instruction.node );
+    QgsExpressionFunction *function = QgsExpression::Functions()[ node->fnIndex() ];
+    setValue( dest, function->func( QVariantList() << toVariant( argument ), context, parent, node ) );
+    return;
+  }
+
+  const double x = REGISTER_TO_DOUBLE( argument );
+  dest.source = nullptr;
+  dest.type = Register::Double;
+  switch ( static_cast< MathFunction >( instruction.arg ) )
+  {
+    case MathFunction::Sqrt:
+      dest.doubleValue = std::sqrt( x );
+      break;
+    case MathFunction::Abs:
+      dest.doubleValue = std::fabs( x );
+      break;
+    case MathFunction::Sin:
+      dest.doubleValue = std::sin( x );
+      break;
+    case MathFunction::Cos:
+      dest.doubleValue = std::cos( x );
+      break;
+    case MathFunction::Tan:
+      dest.doubleValue = std::tan( x );
+      break;
+    case MathFunction::Asin:
+      dest.doubleValue = std::asin( x );
+      break;
+    case MathFunction::Acos:
+      dest.doubleValue = std::acos( x );
+      break;
+    case MathFunction::Atan:
+      dest.doubleValue = std::atan( x );
+      break;
+    case MathFunction::Exp:
+      dest.doubleValue = std::exp( x );
+      break;
+    case MathFunction::Ln:
+    case MathFunction::Log10:
+      if ( x <= 0 )
+      {
+        dest.type = Register::Null;
+        dest.variant = QVariant();
+      }
+      else
+      {
+        dest.doubleValue = static_cast< MathFunction >( instruction.arg ) == MathFunction::Ln ? std::log( x ) : std::log10( x );
+      }
+      break;
+    case MathFunction::Floor:
+      dest.doubleValue = std::floor( x );
+      break;
+    case MathFunction::Ceil:
+      dest.doubleValue = std::ceil( x );
+      break;
+  }
+}
+
+bool QgsExpressionBytecodeProgram::execute( QgsExpression *parent, const QgsExpressionContext *context, QVariant &result ) const
+{
+  // registers are local to the evaluation, as copies of an expression share the program and may be evaluated
+  // concurrently. Fallbacks may also evaluate other expressions on the same thread, so a thread local buffer won't do.
+  QVarLengthArray< Register, 32 > registerFile( static_cast< int >( mRegisters.size() ) );
+  std::copy( mRegisters.begin(), mRegisters.end(), registerFile.begin() );
+  Register *registers = registerFile.data();
+
+  // attribute registers point into this copy of the attributes, so it must stay alive until the result is retrieved
+  QgsAttributes attributes;
+  if ( !mFieldLoads.empty() )
+  {
+    if ( !context )
+      return false;
+
+    const QgsFeature feature = context->feature();
+    if ( !feature.isValid() )
+      return false;
+
+    attributes = feature.attributes();
+    for ( const RegisterLoad &load : std::as_const( mFieldLoads ) )
+    {
+      if ( load.index >= attributes.size() )
+        return false;
+
+      // attributes with an unexpected type (e.g. a string value in a numeric field) are left to the tree walker
+      if ( !loadValue( registers[ load.reg ], &attributes.at( load.index ) ) && load.numeric )
+        return false;
+    }
+  }
+
+  const int count = instructionCount();
+  int pc = 0;
+  while ( pc < count )
+  {
+    const Instruction &instruction = mInstructions[ pc ];
+    ++pc;
+
+    switch ( instruction.opcode )
+    {
+      case Opcode::Fallback:
+      {
+        Register &dest = registers[ instruction.dest ];
+        dest.variant = instruction.node->eval( parent, context );
+        dest.source = nullptr;
+        dest.type = Register::Variant;
+        break;
+      }
+
+      case Opcode::Negate:
+        executeNegate( instruction, registers, parent, context );
+        break;
+
+      case Opcode::Not:
+      {
+        const int tvl = truthValue( registers[ instruction.a ], parent );
+        setTruthValue( registers[ instruction.dest ], QgsExpressionUtils::NOT[ tvl ] );
+        break;
+      }
+
+      case Opcode::Arithmetic:
+        executeArithmetic( instruction, registers, parent, context );
+        break;
+
+      case Opcode::Compare:
+      case Opcode::Is:
+        executeCompare( instruction, registers, parent, context );
+        break;
+
+      case Opcode::LogicLeft:
+      {
+        Register &dest = registers[ instruction.dest ];
+        const int tvl = truthValue( registers[ instruction.a ], parent );
+        if ( parent->hasEvalError() )
+          break;
+
+        const bool isAnd = static_cast< const QgsExpressionNodeBinaryOperator * >( instruction.node )->op() == QgsExpressionNodeBinaryOperator::boAnd;
+        if ( ( isAnd && tvl == QgsExpressionUtils::False ) || ( !isAnd && tvl == QgsExpressionUtils::True ) )
+        {
+          // shortcut -- no need to evaluate right-hand side
+          setTruthValue( dest, tvl );
+          pc = instruction.arg;
+        }
+        else
+        {
+          // keep the left hand value around until the right hand side is known
+          dest.intValue = tvl;
+        }
+        break;
+      }
+
+      case Opcode::LogicRight:
+      {
+        Register &dest = registers[ instruction.dest ];
+        const int tvlRight = truthValue( registers[ instruction.b ], parent );
+        const int tvlLeft = static_cast< int >( dest.intValue );
+        if ( static_cast< const QgsExpressionNodeBinaryOperator * >( instruction.node )->op() == QgsExpressionNodeBinaryOperator::boAnd )
+          setTruthValue( dest, QgsExpressionUtils::AND[ tvlLeft ][ tvlRight ] );
+        else
+          setTruthValue( dest, QgsExpressionUtils::OR[ tvlLeft ][ tvlRight ] );
+        break;
+      }
+
+      case Opcode::MathFunction:
+        executeMathFunction( instruction, registers, parent, context );
+        break;
+
+      case Opcode::JumpIfNotTrue:
+        if ( truthValue( registers[ instruction.a ], parent ) != QgsExpressionUtils::True )
+          pc = instruction.arg;
+        break;
+
+      case Opcode::Jump:
+        pc = instruction.arg;
+        break;
+
+      case Opcode::Move:
+        registers[ instruction.dest ] = registers[ instruction.a ];
+        break;
+
+      case Opcode::SetNull:
+        setTruthValue( registers[ instruction.dest ], QgsExpressionUtils::Unknown );
+        break;
+    }
+
+    // errors abort the evaluation, and NULL is returned
+    if ( parent->hasEvalError() )
+    {
+      result = QVariant();
+      return true;
+    }
+  }
+
+  result = toVariant( registers[ mResultRegister ] );
+  return true;
+}
+
+QString QgsExpressionBytecodeProgram::dump() const
+{
+  static const QMap< Opcode, QString > sOpcodeNames
+  {
+    { Opcode::Fallback, QStringLiteral( "FALLBACK" ) },
+    { Opcode::Negate, QStringLiteral( "NEG" ) },
+    { Opcode::Not, QStringLiteral( "NOT" ) },
+    { Opcode::Arithmetic, QStringLiteral( "ARITH" ) },
+    { Opcode::Compare, QStringLiteral( "CMP" ) },
+    { Opcode::Is, QStringLiteral( "IS" ) },
+    { Opcode::LogicLeft, QStringLiteral( "LOGIC_L" ) },
+    { Opcode::LogicRight, QStringLiteral( "LOGIC_R" ) },
+    { Opcode::MathFunction, QStringLiteral( "MATH" ) },
+    { Opcode::JumpIfNotTrue, QStringLiteral( "JNT" ) },
+    { Opcode::Jump, QStringLiteral( "JMP" ) },
+    { Opcode::Move, QStringLiteral( "MOV" ) },
+    { Opcode::SetNull, QStringLiteral( "NULL" ) },
+  };
+
+  QStringList lines;
+  for ( const RegisterLoad &load : mFieldLoads )
+    lines << QStringLiteral( "r%1 <- attribute %2" ).arg( load.reg ).arg( load.index );
+  for ( const RegisterLoad &load : mConstantLoads )
+    lines << QStringLiteral( "r%1 <- %2" ).arg( load.reg ).arg( mConstants[ load.index ].toString() );
+
+  for ( int i = 0; i < instructionCount(); ++i )
+  {
+    const Instruction &instruction = mInstructions[ i ];
+    QString line = QStringLiteral( "%1: %2" ).arg( i ).arg( sOpcodeNames.value( instruction.opcode ) );
+    if ( instruction.dest >= 0 )
+      line += QStringLiteral( " r%1" ).arg( instruction.dest );
+    if ( instruction.a >= 0 )
+      line += QStringLiteral( " r%1" ).arg( instruction.a );
+    if ( instruction.b >= 0 )
+      line += QStringLiteral( " r%1" ).arg( instruction.b );
+    if ( instruction.arg >= 0 )
+      line += QStringLiteral( " #%1" ).arg( instruction.arg );
+    if ( instruction.opcode == Opcode::Fallback )
+      line += QStringLiteral( " [%1]" ).arg( instruction.node->dump() );
+    lines << line;
+  }
+  lines << QStringLiteral( "result r%1" ).arg( mResultRegister );
+  return lines.join( '\n' );
+}
+
+///@endcond PRIVATE
@@ -0,0 +1,230 @@
+/***************************************************************************
+  qgsexpressionbytecode.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONBYTECODE_H
+#define QGSEXPRESSIONBYTECODE_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+#include "qgsexpressionnodeimpl.h"
+
+#include <QVariant>
+#include <memory>
+#include <vector>
+
+class QgsExpression;
+class QgsExpressionContext;
+class QgsExpressionNode;
+class QgsFields;
+
+///@cond PRIVATE
+
+/**
+ * \ingroup core
+ * \brief A prepared expression node tree, lowered to a flat program for a register based virtual machine.
+ *
+ * Numeric operators, comparisons, logical operators, CASE conditions and the basic math functions
+ * are compiled to instructions operating on typed registers, which avoids the cost of boxing every
+ * intermediate result into a QVariant. Any other node (string handling, geometry functions, aggregates,
+ * variables, ...) is compiled to a fallback instruction which evaluates the node's subtree
+ * using the regular tree walking evaluation, storing the result in a variant register.
+ *
+ * Results are identical to the tree walking evaluation, including the types of the returned values
+ * and the evaluation errors raised.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsExpressionBytecodeProgram
+{
+  public:
+
+    //! Single argument math functions with a native implementation
+    enum class MathFunction
+    {
+      Sqrt,
+      Abs,
+      Sin,
+      Cos,
+      Tan,
+      Asin,
+      Acos,
+      Atan,
+      Exp,
+      Ln,
+      Log10,
+      Floor,
+      Ceil,
+    };
+
+    /**
+     * Returns TRUE if the function \a node calls a single argument math function with a native
+     * implementation, storing it in \a function.
+     *
+     * Functions overridden by the \a context are not considered native.
+     */
+    static bool compilableMathFunction( const QgsExpressionNodeFunction *node, const QgsExpressionContext *context, MathFunction &function );
+
+    /**
+     * Compiles the prepared expression \a node tree, belonging to the \a parent expression.
+     *
+     * The node tree must have been prepared using the \a context. Field references are resolved
+     * against the fields from the context.
+     *
+     * Returns NULLPTR if the expression does not contain any parts which benefit from compilation.
+     *
+     * The node tree must outlive the program.
+     */
+    static std::unique_ptr< QgsExpressionBytecodeProgram > compile( QgsExpressionNode *node, QgsExpression *parent, const QgsExpressionContext *context );
+
+    /**
+     * Executes the program for the feature from the specified \a context, storing the result
+     * in \a result.
+     *
+     * Returns FALSE if the program cannot be used with the context (e.g. because the context
+     * does not contain a feature, or a feature's attribute has an unexpected type), in which
+     * case the caller must evaluate the expression using the node tree instead. No part of the
+     * expression will have been evaluated in that case.
+     *
+     * The program can be executed concurrently from multiple threads.
+     */
+    bool execute( QgsExpression *parent, const QgsExpressionContext *context, QVariant &result ) const;
+
+    /**
+     * Returns the number of instructions in the program.
+     */
+    int instructionCount() const { return static_cast< int >( mInstructions.size() ); }
+
+    /**
+     * Returns the number of instructions which fall back to tree walking evaluation.
+     */
+    int fallbackCount() const;
+
+    /**
+     * Returns a human readable listing of the program, for debugging purposes.
+     */
+    QString dump() const;
+
+  private:
+
+    //! Register value
+    struct Register
+    {
+      enum Type
+      {
+        Null, //!< NULL value
+        Int, //!< 32 bit integer, stored in intValue
+        LongLong, //!< 64 bit integer, stored in intValue
+        Double, //!< Double value, stored in doubleValue
+        Variant, //!< Arbitrary value, stored in variant
+      };
+
+      Type type = Null;
+      qlonglong intValue = 0;
+      double doubleValue = 0;
+
+      //! Original value for loaded attributes and constants, so that they are returned unchanged
+      const QVariant *source = nullptr;
+
+      QVariant variant;
+    };
+
+    enum class Opcode
+    {
+      Fallback, //!< Evaluate node subtree with the tree walker
+      Negate, //!< Unary minus
+      Not, //!< Logical NOT
+      Arithmetic, //!< Numeric binary operator (+, -, *, /, //, %, ^)
+      Compare, //!< Numeric comparison (=, <>, <, >, <=, >=)
+      Is, //!< IS / IS NOT operator
+      LogicLeft, //!< Left hand side of AND/OR, jumps to target if the result is known
+      LogicRight, //!< Right hand side of AND/OR
+      MathFunction, //!< Single argument math function
+      JumpIfNotTrue, //!< Conditional jump, used by CASE
+      Jump, //!< Unconditional jump
+      Move, //!< Register copy
+      SetNull, //!< Sets register to NULL
+    };
+
+    struct Instruction
+    {
+      Opcode opcode;
+      int dest = -1;
+      int a = -1;
+      int b = -1;
+      //! Binary/unary operator, math function or jump target, depending on opcode
+      int arg = -1;
+      //! Node evaluated by fallback instructions, or used to report errors
+      QgsExpressionNode *node = nullptr;
+    };
+
+    //! Initial value of a register, from a feature attribute or the constant pool
+    struct RegisterLoad
+    {
+      int reg;
+      int index;
+      //! TRUE if the register must hold a numeric value
+      bool numeric;
+    };
+
+    QgsExpressionBytecodeProgram() = default;
+    QgsExpressionBytecodeProgram( const QgsExpressionBytecodeProgram &other ) = delete;
+    QgsExpressionBytecodeProgram &operator=( const QgsExpressionBytecodeProgram &other ) = delete;
+
+    //! Compiles a node, returning the register holding its result
+    int compileNode( QgsExpressionNode *node, QgsExpression *parent, const QgsExpressionContext *context, const QgsFields &fields );
+    int compileBinaryOperator( QgsExpressionNodeBinaryOperator *node, QgsExpression *parent, const QgsExpressionContext *context, const QgsFields &fields );
+    int compileCondition( QgsExpressionNodeCondition *node, QgsExpression *parent, const QgsExpressionContext *context, const QgsFields &fields );
+    int compileFunction( QgsExpressionNodeFunction *node, QgsExpression *parent, const QgsExpressionContext *context, const QgsFields &fields );
+    int addConstant( const QVariant &value );
+    int addFallback( QgsExpressionNode *node );
+    int newRegister();
+    int addInstruction( Opcode opcode, int dest, int a = -1, int b = -1, int arg = -1, QgsExpressionNode *node = nullptr );
+
+    //! Returns TRUE if the node compiles to instructions which only produce NULL or numeric values, without any fallback
+    static bool isNumeric( const QgsExpressionNode *node, const QgsExpressionContext *context, const QgsFields &fields );
+
+    //! Sets a register from a value loaded from a feature or the constant pool. Returns FALSE if the value is not numeric.
+    static bool loadValue( Register &reg, const QVariant *value );
+    //! Sets a register from a value computed by the tree walker
+    static void setValue( Register &reg, const QVariant &value );
+    static QVariant toVariant( const Register &reg );
+    static int truthValue( const Register &reg, QgsExpression *parent );
+    static void setTruthValue( Register &reg, int tvl );
+
+    void executeNegate( const Instruction &instruction, Register *registers, QgsExpression *parent, const QgsExpressionContext *context ) const;
+    void executeArithmetic( const Instruction &instruction, Register *registers, QgsExpression *parent, const QgsExpressionContext *context ) const;
+    void executeCompare( const Instruction &instruction, Register *registers, QgsExpression *parent, const QgsExpressionContext *context ) const;
+    void executeMathFunction( const Instruction &instruction, Register *registers, QgsExpression *parent, const QgsExpressionContext *context ) const;
+
+    //! Evaluates a binary operator with the tree walker, for values outside of the numeric fast path
+    static QVariant evaluateBinaryOperator( QgsExpressionNodeBinaryOperator::BinaryOperator op, const QVariant &left, const QVariant &right, QgsExpression *parent, const QgsExpressionContext *context );
+
+    std::vector< Instruction > mInstructions;
+    //! Initial register values, copied for each evaluation
+    std::vector< Register > mRegisters;
+
+    //! Constant pool. Must not be resized after compilation, as registers point to its values.
+    std::vector< QVariant > mConstants;
+
+    std::vector< RegisterLoad > mConstantLoads;
+    std::vector< RegisterLoad > mFieldLoads;
+    int mResultRegister = -1;
+};
+
+///@endcond PRIVATE
+
+#endif // QGSEXPRESSIONBYTECODE_H
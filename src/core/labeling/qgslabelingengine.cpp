@@ -22,6 +22,7 @@
 #include "labelposition.h"
 #include "layer.h"
 #include "pal.h"
+#include "palstat.h"
 #include "problem.h"
 #include "qgsrendercontext.h"
 #include "qgsmaplayer.h"
@@ -245,6 +246,22 @@ void QgsLabelingEngine::processProvider( QgsAbstractLabelProvider *provider, Qgs
 
   for ( QgsLabelFeature *feature : features )
   {
+    if ( !mReusablePlacementsExtent.isEmpty() && !feature->hasFixedPosition() )
+    {
+      // reuse the previous placement if the label is unchanged and is not close to the map edges,
+      // where it may have been affected by features or labels outside the previous map
+      const QgsLabelPlacementCache::Placement *placement = mPreviousPlacements.placement( provider->layerId(), provider->providerId(), feature->id() );
+      if ( placement && placement->labelText == feature->labelText() )
+      {
+        const QSizeF size = feature->size();
+        if ( qgsDoubleNear( size.width(), placement->labelSize.width() ) && qgsDoubleNear( size.height(), placement->labelSize.height() )
+             && mReusablePlacementsExtent.contains( placement->boundingBox.buffered( std::max( placement->width, placement->height ) ) ) )
+        {
+          p.setPreviousPlacement( feature, *placement );
+        }
+      }
+    }
+
     try
     {
       l->registerFeature( feature );
@@ -278,6 +295,8 @@ void QgsLabelingEngine::registerLabels( QgsRenderContext &context )
   mPal->setShowPartialLabels( settings.testFlag( QgsLabelingEngineSettings::UsePartialCandidates ) );
   mPal->setPlacementVersion( settings.placementVersion() );
 
+  mReusablePlacementsExtent = settings.testFlag( QgsLabelingEngineSettings::ReusePlacements ) ? mPreviousPlacements.reusableExtent( mMapSettings ) : QgsRectangle();
+
   // for each provider: get labels and register them in PAL
   for ( QgsAbstractLabelProvider *provider : std::as_const( mProviders ) )
   {
@@ -399,7 +418,54 @@ void QgsLabelingEngine::solve( QgsRenderContext &context )
   // sort labels
   std::sort( mLabels.begin(), mLabels.end(), QgsLabelSorter( mMapSettings ) );
 
+  if ( settings.testFlag( QgsLabelingEngineSettings::ReusePlacements ) )
+    storePlacements();
+
   QgsDebugMsgLevel( QStringLiteral( "LABELING work:  %1 ms ... labels# %2" ).arg( t.elapsed() ).arg( mLabels.size() ), 4 );
+  if ( const pal::PalStat *stats = mPal->statistics() )
+  {
+    QgsDebugMsgLevel( QStringLiteral( "LABELING phases: candidates %1 ms, obstacles %2 ms, conflicts %3 ms, partitioning %4 ms, solving %5 ms (%6 partitions, largest %7 features)" )
+                      .arg( stats->candidatesGenerationTime() ).arg( stats->obstaclesTime() ).arg( stats->conflictsTime() )
+                      .arg( stats->partitioningTime() ).arg( stats->solvingTime() )
+                      .arg( stats->partitionCount() ).arg( stats->largestPartitionSize() ), 4 );
+  }
+}
+
+void QgsLabelingEngine::storePlacements()
+{
+  mPlacementCache = QgsLabelPlacementCache();
+
+  // label positions are rotated around the map center for rotated maps
+  if ( !qgsDoubleNear( mMapSettings.rotation(), 0.0 ) )
+    return;
+
+  mPlacementCache = QgsLabelPlacementCache( mMapSettings );
+  for ( pal::LabelPosition *label : std::as_const( mLabels ) )
+  {
+    // curved and flipped labels can't be restored from a single candidate
+    if ( label->nextPart() || label->getUpsideDown() || label->getReversed() )
+      continue;
+
+    QgsLabelFeature *lf = label->getFeaturePart()->feature();
+    if ( !lf || lf->hasFixedPosition() || !lf->provider() )
+      continue;
+
+    QgsLabelPlacementCache::Placement placement;
+    placement.position = QgsPointXY( label->getX(), label->getY() );
+    placement.angle = label->getAlpha();
+    placement.width = label->getWidth();
+    placement.height = label->getHeight();
+    // obstacle penalties and the final cost adjustments are applied again to a reused placement
+    placement.cost = label->baseCost();
+    placement.quadrant = static_cast< int >( label->getQuadrant() );
+    placement.boundingBox.setMinimal();
+    for ( int i = 0; i < 4; ++i )
+      placement.boundingBox.combineExtentWith( label->getX( i ), label->getY( i ) );
+    placement.labelSize = lf->size();
+    placement.labelText = lf->labelText();
+
+    mPlacementCache.addPlacement( lf->provider()->layerId(), lf->provider()->providerId(), lf->id(), placement );
+  }
 }
 
 void QgsLabelingEngine::drawLabels( QgsRenderContext &context, const QString &layerId )
@@ -24,6 +24,7 @@
 #include "qgspallabeling.h"
 #include "qgslabelingenginesettings.h"
 #include "qgslabeling.h"
+#include "qgslabelplacementcache.h"
 
 class QgsLabelingEngine;
 class QgsLabelingResults;
@@ -286,6 +287,27 @@ class CORE_EXPORT QgsLabelingEngine
     //! Returns pointer to recently computed results and pass the ownership of results to the caller
     QgsLabelingResults *takeResults();
 
+    /**
+     * Sets the label placements \a cache from a previous labeling solution.
+     *
+     * If the QgsLabelingEngineSettings::ReusePlacements flag is set, the placements of labels
+     * which remain well inside the map are reused instead of recalculating all their candidates.
+     *
+     * \see placementCache()
+     * \since QGIS 3.22
+     */
+    void setPlacementCache( const QgsLabelPlacementCache &cache ) { mPreviousPlacements = cache; }
+
+    /**
+     * Returns the label placements of the last labeling solution.
+     *
+     * Placements are only stored if the QgsLabelingEngineSettings::ReusePlacements flag is set.
+     *
+     * \see setPlacementCache()
+     * \since QGIS 3.22
+     */
+    QgsLabelPlacementCache placementCache() const { return mPlacementCache; }
+
     //! For internal use by the providers
     QgsLabelingResults *results() const { return mResults.get(); }
 
@@ -346,6 +368,18 @@ class CORE_EXPORT QgsLabelingEngine
     QList<pal::LabelPosition *> mUnlabeled;
     QList<pal::LabelPosition *> mLabels;
 
+    //! Placements from a previous labeling solution, which may be reused
+    QgsLabelPlacementCache mPreviousPlacements;
+    //! Area of the map in which previous placements can be reused
+    QgsRectangle mReusablePlacementsExtent;
+    //! Placements of the last labeling solution
+    QgsLabelPlacementCache mPlacementCache;
+
+  private:
+
+    //! Stores the placements of the labels of the last solution in mPlacementCache
+    void storePlacements();
+
 };
 
 /**
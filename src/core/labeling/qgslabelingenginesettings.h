@@ -41,6 +41,7 @@ class CORE_EXPORT QgsLabelingEngineSettings
       DrawCandidates        = 1 << 5,  //!< Whether to draw rectangles of generated candidates (good for debugging)
       DrawUnplacedLabels    = 1 << 6,  //!< Whether to render unplaced labels as an indicator/warning for users
       CollectUnplacedLabels = 1 << 7,  //!< Whether unplaced labels should be collected in the labeling results (regardless of whether they are being rendered). Since QGIS 3.20
+      ReusePlacements       = 1 << 8,  //!< Whether the placements of labels from a previous render of the map should be reused when the map is panned, for labels which remain well inside the map. Requires a map renderer cache. Since QGIS 3.22
     };
     Q_DECLARE_FLAGS( Flags, Flag )
 
@@ -0,0 +1,66 @@
+/***************************************************************************
+  qgslabelplacementcache.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgslabelplacementcache.h"
+#include "qgsmapsettings.h"
+
+QgsLabelPlacementCache::QgsLabelPlacementCache( const QgsMapSettings &settings )
+  : mExtent( settings.visibleExtent() )
+  , mCrs( settings.destinationCrs() )
+  , mMapUnitsPerPixel( settings.mapUnitsPerPixel() )
+{
+}
+
+int QgsLabelPlacementCache::placementCount() const
+{
+  int count = 0;
+  for ( auto it = mPlacements.constBegin(); it != mPlacements.constEnd(); ++it )
+    count += it->size();
+  return count;
+}
+
+QgsRectangle QgsLabelPlacementCache::reusableExtent( const QgsMapSettings &settings ) const
+{
+  if ( mPlacements.isEmpty() )
+    return QgsRectangle();
+
+  // label positions are pre-rotated around the map center for rotated maps, so they can't be reused after panning
+  if ( !qgsDoubleNear( settings.rotation(), 0.0 ) )
+    return QgsRectangle();
+
+  // label sizes depend on the map scale
+  if ( settings.destinationCrs() != mCrs || !qgsDoubleNear( settings.mapUnitsPerPixel(), mMapUnitsPerPixel, mMapUnitsPerPixel * 1e-6 ) )
+    return QgsRectangle();
+
+  return mExtent.intersect( settings.visibleExtent() );
+}
+
+void QgsLabelPlacementCache::addPlacement( const QString &layerId, const QString &providerId, QgsFeatureId featureId, const Placement &placement )
+{
+  mPlacements[ qMakePair( layerId, providerId ) ].insert( featureId, placement );
+}
+
+const QgsLabelPlacementCache::Placement *QgsLabelPlacementCache::placement( const QString &layerId, const QString &providerId, QgsFeatureId featureId ) const
+{
+  auto providerIt = mPlacements.constFind( qMakePair( layerId, providerId ) );
+  if ( providerIt == mPlacements.constEnd() )
+    return nullptr;
+
+  auto it = providerIt->constFind( featureId );
+  if ( it == providerIt->constEnd() )
+    return nullptr;
+
+  return &( *it );
+}
@@ -0,0 +1,130 @@
+/***************************************************************************
+  qgslabelplacementcache.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSLABELPLACEMENTCACHE_H
+#define QGSLABELPLACEMENTCACHE_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+#include "qgscoordinatereferencesystem.h"
+#include "qgsfeatureid.h"
+#include "qgspointxy.h"
+#include "qgsrectangle.h"
+
+#include <QHash>
+#include <QPair>
+#include <QSizeF>
+#include <QString>
+
+class QgsMapSettings;
+
+/**
+ * \ingroup core
+ * \brief Stores the label placements of a labeling solution, so that they can be reused when
+ * labeling a map which overlaps the labeled map (e.g. after panning the map).
+ *
+ * Placements are only stored for maps without rotation, and can only be reused for maps with the same
+ * destination CRS and scale.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsLabelPlacementCache
+{
+  public:
+
+    /**
+     * The placement of a label.
+     */
+    struct Placement
+    {
+      //! Position of the label's first corner, in map units
+      QgsPointXY position;
+      //! Label angle, in radians
+      double angle = 0;
+      //! Label width, in map units
+      double width = 0;
+      //! Label height, in map units
+      double height = 0;
+      //! Candidate cost, before obstacle penalties and the final cost adjustments
+      double cost = 0;
+      //! Candidate quadrant, as a pal::LabelPosition::Quadrant value
+      int quadrant = 0;
+      //! Bounding box of the label, in map units
+      QgsRectangle boundingBox;
+      //! Size of the label feature, used to detect changes in the label content or style
+      QSizeF labelSize;
+      //! Label text, used to detect changes in the label content
+      QString labelText;
+    };
+
+    /**
+     * Constructor for an empty QgsLabelPlacementCache.
+     */
+    QgsLabelPlacementCache() = default;
+
+    /**
+     * Constructor for an empty QgsLabelPlacementCache, storing the placements calculated for a map
+     * with the specified \a settings.
+     */
+    explicit QgsLabelPlacementCache( const QgsMapSettings &settings );
+
+    /**
+     * Returns TRUE if the cache does not contain any placement.
+     */
+    bool isEmpty() const { return mPlacements.isEmpty(); }
+
+    /**
+     * Returns the number of stored placements.
+     */
+    int placementCount() const;
+
+    /**
+     * Returns the visible extent of the map the placements were calculated for.
+     */
+    QgsRectangle extent() const { return mExtent; }
+
+    /**
+     * Returns the area in which the placements can be reused when labeling a map with the
+     * specified \a settings, or an empty rectangle if the placements can't be reused for this map.
+     *
+     * This is the part of the map shared by the map the placements were calculated for.
+     */
+    QgsRectangle reusableExtent( const QgsMapSettings &settings ) const;
+
+    /**
+     * Stores the \a placement of the label of the feature with matching \a featureId, from the
+     * label provider with the specified \a layerId and \a providerId.
+     */
+    void addPlacement( const QString &layerId, const QString &providerId, QgsFeatureId featureId, const Placement &placement );
+
+    /**
+     * Returns the stored placement of the label of the feature with matching \a featureId, from the
+     * label provider with the specified \a layerId and \a providerId, or NULLPTR if there is no such placement.
+     */
+    const Placement *placement( const QString &layerId, const QString &providerId, QgsFeatureId featureId ) const;
+
+  private:
+
+    QgsRectangle mExtent;
+    QgsCoordinateReferenceSystem mCrs;
+    double mMapUnitsPerPixel = 0;
+
+    //! Placements by feature ID, for each label provider (identified by its layer ID and provider ID)
+    QHash< QPair< QString, QString >, QHash< QgsFeatureId, Placement > > mPlacements;
+};
+
+#endif // QGSLABELPLACEMENTCACHE_H
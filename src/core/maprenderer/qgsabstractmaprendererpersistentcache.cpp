@@ -0,0 +1,161 @@
+/***************************************************************************
+  qgsabstractmaprendererpersistentcache.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsabstractmaprendererpersistentcache.h"
+
+#include "qgsmaplayer.h"
+#include "qgsmaplayerstyle.h"
+#include "qgsmapsettings.h"
+#include "qgsvectorlayer.h"
+#include "qgsexpressioncontextutils.h"
+#include "qgsfeaturefilterprovider.h"
+#include "qgsfeaturerequest.h"
+#include "qgsgeometry.h"
+
+#include <QCryptographicHash>
+
+///@cond PRIVATE
+
+//! Returns a string representation of a variable \a value, for use in cache keys
+static QString variableKeyString( const QVariant &value )
+{
+  if ( value.type() == QVariant::List || value.type() == QVariant::StringList )
+  {
+    QStringList parts;
+    const QVariantList list = value.toList();
+    for ( const QVariant &part : list )
+      parts << variableKeyString( part );
+    return '[' + parts.join( ',' ) + ']';
+  }
+  else if ( value.type() == QVariant::Map )
+  {
+    QStringList parts;
+    const QVariantMap map = value.toMap();
+    for ( auto it = map.constBegin(); it != map.constEnd(); ++it )
+      parts << it.key() + ':' + variableKeyString( it.value() );
+    return '{' + parts.join( ',' ) + '}';
+  }
+  else if ( value.canConvert< QgsGeometry >() )
+  {
+    return value.value< QgsGeometry >().asWkt();
+  }
+  else if ( value.canConvert( QVariant::String ) )
+  {
+    return value.toString();
+  }
+
+  // values which can't be represented (e.g. pointers to layers) are identified by their type only
+  return QString::fromLatin1( value.typeName() );
+}
+
+///@endcond
+
+QString QgsAbstractMapRendererPersistentCache::layerCacheKey( QgsMapLayer *layer, const QgsMapSettings &settings, const QgsFeatureFilterProvider *featureFilterProvider )
+{
+  if ( !layer )
+    return QString();
+
+  QCryptographicHash hash( QCryptographicHash::Sha1 );
+
+  const auto addString = [&hash]( const QString & string )
+  {
+    hash.addData( string.toUtf8() );
+    // separator, so that adjacent strings can't be confused
+    hash.addData( "\n", 1 );
+  };
+
+  addString( layer->id() );
+  addString( layer->source() );
+
+  QgsMapLayerStyle style;
+  style.readFromLayer( layer );
+  addString( style.xmlData() );
+
+  if ( QgsVectorLayer *vl = qobject_cast< QgsVectorLayer * >( layer ) )
+  {
+    addString( vl->subsetString() );
+
+    // selected features are rendered differently, so the selection is part of the render
+    QList< QgsFeatureId > selectedIds = qgis::setToList( vl->selectedFeatureIds() );
+    if ( !selectedIds.empty() )
+    {
+      std::sort( selectedIds.begin(), selectedIds.end() );
+      QStringList ids;
+      ids.reserve( selectedIds.size() );
+      for ( QgsFeatureId id : std::as_const( selectedIds ) )
+        ids << QString::number( id );
+      addString( ids.join( ',' ) );
+      addString( settings.selectionColor().name( QColor::HexArgb ) );
+    }
+
+    // filters restricting the rendered features, e.g. server access control
+    if ( featureFilterProvider )
+    {
+      QgsFeatureRequest request;
+      featureFilterProvider->filterFeatures( vl, request );
+      if ( request.filterType() != QgsFeatureRequest::FilterNone || !request.filterRect().isNull() )
+      {
+        addString( QString::number( static_cast< int >( request.filterType() ) ) );
+        if ( request.filterExpression() )
+          addString( request.filterExpression()->expression() );
+        QList< QgsFeatureId > filterIds = qgis::setToList( request.filterFids() );
+        std::sort( filterIds.begin(), filterIds.end() );
+        QStringList ids;
+        ids.reserve( filterIds.size() + 1 );
+        ids << QString::number( request.filterFid() );
+        for ( QgsFeatureId id : std::as_const( filterIds ) )
+          ids << QString::number( id );
+        addString( ids.join( ',' ) );
+        addString( request.filterRect().toString( 17 ) );
+      }
+
+      const QStringList fieldNames = vl->fields().names();
+      const QStringList attributes = featureFilterProvider->layerAttributes( vl, fieldNames );
+      if ( attributes != fieldNames )
+        addString( attributes.join( ',' ) );
+    }
+  }
+
+  // data defined properties of the style can depend on any variable of the context used for the render
+  QgsExpressionContext expressionContext = settings.expressionContext();
+  expressionContext.appendScope( QgsExpressionContextUtils::layerScope( layer ) );
+  const QList< QgsExpressionContextScope * > scopes = expressionContext.scopes();
+  for ( const QgsExpressionContextScope *scope : scopes )
+  {
+    addString( scope->name() );
+    QStringList names = scope->variableNames();
+    names.sort();
+    for ( const QString &name : std::as_const( names ) )
+      addString( name + '=' + variableKeyString( scope->variable( name ) ) );
+  }
+
+  const QgsCoordinateReferenceSystem crs = settings.destinationCrs();
+  addString( crs.authid().isEmpty() ? crs.toWkt() : crs.authid() );
+  addString( settings.visibleExtent().toString( 17 ) );
+  addString( QStringLiteral( "%1x%2@%3" ).arg( settings.outputSize().width() ).arg( settings.outputSize().height() ).arg( settings.devicePixelRatio() ) );
+  addString( qgsDoubleToString( settings.scale() ) );
+  addString( qgsDoubleToString( settings.outputDpi() ) );
+  addString( qgsDoubleToString( settings.rotation() ) );
+  addString( QString::number( static_cast< int >( settings.flags() ) ) );
+  addString( QString::number( static_cast< int >( settings.outputImageFormat() ) ) );
+
+  if ( settings.isTemporal() )
+    addString( settings.temporalRange().begin().toString( Qt::ISODateWithMs ) + '/' + settings.temporalRange().end().toString( Qt::ISODateWithMs ) );
+
+  if ( !settings.zRange().isInfinite() )
+    addString( qgsDoubleToString( settings.zRange().lower() ) + '/' + qgsDoubleToString( settings.zRange().upper() ) );
+
+  return QString::fromLatin1( hash.result().toHex() );
+}
@@ -0,0 +1,86 @@
+/***************************************************************************
+  qgsabstractmaprendererpersistentcache.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSABSTRACTMAPRENDERERPERSISTENTCACHE_H
+#define QGSABSTRACTMAPRENDERERPERSISTENTCACHE_H
+
+#include "qgis_core.h"
+#include "qgis_sip.h"
+
+#include <QImage>
+#include <QString>
+
+class QgsMapLayer;
+class QgsMapSettings;
+class QgsFeatureFilterProvider;
+
+/**
+ * \ingroup core
+ * \brief Abstract base class for persistent caches of rendered map layer images.
+ *
+ * Unlike QgsMapRendererCache, which keeps the images of a single map canvas or render
+ * job in memory, a persistent cache stores layer renders under a key which fully describes
+ * the render (see layerCacheKey()). This allows the cached images to outlive the render job
+ * and, depending on the implementation, to be shared between sessions or processes (e.g.
+ * multiple QGIS Server workers).
+ *
+ * Persistent caches are assigned to render jobs via QgsMapRendererJob::setPersistentCache().
+ *
+ * Implementations must be thread-safe, as the cache is accessed from render threads.
+ *
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsAbstractMapRendererPersistentCache
+{
+  public:
+
+    virtual ~QgsAbstractMapRendererPersistentCache() = default;
+
+    /**
+     * Returns the cached image for the specified \a key, or a null image if
+     * there is no image stored for the key.
+     */
+    virtual QImage image( const QString &key ) const = 0;
+
+    /**
+     * Stores an \a image in the cache for the specified \a key.
+     */
+    virtual void storeImage( const QString &key, const QImage &image ) = 0;
+
+    /**
+     * Removes all images from the cache.
+     */
+    virtual void clear() = 0;
+
+    /**
+     * Calculates the key under which the render of a map \a layer with the given map \a settings
+     * is stored.
+     *
+     * The key is derived from the layer ID and source, a hash of the layer's current style
+     * and the map settings which affect the render (extent, output size, scale, DPI, CRS, rotation,
+     * temporal and elevation ranges and flags). The variables of the map settings' expression context
+     * and of the layer's scope are included too, as data defined properties of the style may depend
+     * on them.
+     *
+     * If a \a featureFilterProvider is specified (e.g. the access control of QGIS Server), the filter it
+     * applies to vector layers is included in the key.
+     *
+     * \note Changes made to the layer's underlying data source are not reflected in the key. Persistent
+     * caches are thus only suitable for layers with static data.
+     */
+    static QString layerCacheKey( QgsMapLayer *layer, const QgsMapSettings &settings, const QgsFeatureFilterProvider *featureFilterProvider = nullptr );
+};
+
+#endif // QGSABSTRACTMAPRENDERERPERSISTENTCACHE_H
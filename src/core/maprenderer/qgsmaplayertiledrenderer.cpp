@@ -0,0 +1,311 @@
+/***************************************************************************
+  qgsmaplayertiledrenderer.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsmaplayertiledrenderer.h"
+
+#include "qgsexception.h"
+#include "qgsfeedback.h"
+#include "qgslogger.h"
+#include "qgsmapsettings.h"
+#include "qgspainteffect.h"
+#include "qgspainteffectregistry.h"
+#include "qgspallabeling.h"
+#include "qgsrenderer.h"
+#include "qgssymbol.h"
+#include "qgssymbollayer.h"
+#include "qgssymbollayerutils.h"
+#include "qgsvectorlayer.h"
+
+#include <QAtomicInt>
+#include <QtConcurrentMap>
+
+///@cond PRIVATE
+
+static QAtomicInt sRenderedTileCount = 0;
+
+/**
+ * Returns TRUE if the area painted by the \a symbol is bounded by its estimated bleed,
+ * i.e. if none of its symbol layers have data defined properties changing their extent
+ * and none of them generate geometries or apply paint effects.
+ */
+static bool symbolBleedIsBounded( QgsSymbol *symbol )
+{
+  // data defined properties which don't change the area painted by a symbol layer
+  static const QSet< int > sBoundedProperties
+  {
+    QgsSymbolLayer::PropertyFillColor,
+    QgsSymbolLayer::PropertyStrokeColor,
+    QgsSymbolLayer::PropertySecondaryColor,
+    QgsSymbolLayer::PropertyFillStyle,
+    QgsSymbolLayer::PropertyStrokeStyle,
+    QgsSymbolLayer::PropertyJoinStyle,
+    QgsSymbolLayer::PropertyCapStyle,
+    QgsSymbolLayer::PropertyOpacity,
+    QgsSymbolLayer::PropertyLayerEnabled,
+  };
+
+  for ( int i = 0; i < symbol->symbolLayerCount(); ++i )
+  {
+    QgsSymbolLayer *layer = symbol->symbolLayer( i );
+    if ( layer->layerType() == QLatin1String( "GeometryGenerator" ) )
+      return false;
+
+    if ( layer->paintEffect() && layer->paintEffect()->enabled() && !QgsPaintEffectRegistry::isDefaultStack( layer->paintEffect() ) )
+      return false;
+
+    const QgsPropertyCollection &properties = layer->dataDefinedProperties();
+    const QSet< int > keys = properties.propertyKeys();
+    for ( int key : keys )
+    {
+      if ( properties.isActive( key ) && !sBoundedProperties.contains( key ) )
+        return false;
+    }
+
+    if ( QgsSymbol *subSymbol = layer->subSymbol() )
+    {
+      if ( !symbolBleedIsBounded( subSymbol ) )
+        return false;
+    }
+  }
+  return true;
+}
+
+bool QgsMapLayerTiledRenderer::layerIsEligible( QgsMapLayer *layer, const QgsMapSettings &settings, const QgsRenderContext &context, QgsLabelingEngine *labelingEngine )
+{
+  QgsVectorLayer *vl = qobject_cast< QgsVectorLayer * >( layer );
+  if ( !vl || !vl->renderer() )
+    return false;
+
+  // labels and diagrams must be registered exactly once with the labeling engine
+  if ( labelingEngine && QgsPalLabeling::staticWillUseLayer( vl ) )
+    return false;
+
+  // rendered feature handlers expect to see each feature only once
+  if ( context.hasRenderedFeatureHandlers() )
+    return false;
+
+  // stripes of a rotated map do not correspond to an axis aligned extent
+  if ( !qgsDoubleNear( settings.rotation(), 0.0 ) )
+    return false;
+
+  if ( context.testFlag( QgsRenderContext::ApplyClipAfterReprojection ) )
+    return false;
+
+  // features must be drawn within the estimated symbol bleed of their geometry, or they would be
+  // cut at the stripe edges
+  static const QStringList sUnboundedRenderers
+  {
+    QStringLiteral( "pointDisplacement" ),
+    QStringLiteral( "pointCluster" ),
+    QStringLiteral( "heatmapRenderer" ),
+  };
+  if ( sUnboundedRenderers.contains( vl->renderer()->type() ) )
+    return false;
+
+  if ( vl->renderer()->paintEffect() && vl->renderer()->paintEffect()->enabled() && !QgsPaintEffectRegistry::isDefaultStack( vl->renderer()->paintEffect() ) )
+    return false;
+
+  QgsRenderContext symbolContext = context;
+  const QgsSymbolList symbols = vl->renderer()->symbols( symbolContext );
+  for ( QgsSymbol *symbol : symbols )
+  {
+    if ( !symbolBleedIsBounded( symbol ) )
+      return false;
+  }
+
+  return true;
+}
+
+QgsMapLayerTiledRenderer::QgsMapLayerTiledRenderer( QgsVectorLayer *layer, QgsRenderContext &context, const QgsMapSettings &settings, int tileCount )
+  : QgsMapLayerRenderer( layer->id(), &context )
+  , mFeedback( std::make_unique< QgsFeedback >() )
+{
+  const QSize outputSize = settings.outputSize();
+  const QSize deviceSize = settings.deviceOutputSize();
+  const float devicePixelRatio = settings.devicePixelRatio();
+  tileCount = std::max( 1, std::min( tileCount, outputSize.height() ) );
+
+  // estimate how far symbols can extend beyond the features' geometry, so that each stripe
+  // fetches the features which are outside of it but still paint onto it
+  double maxBleed = 0;
+  QgsSymbolList symbols = layer->renderer()->symbols( context );
+  for ( QgsSymbol *symbol : std::as_const( symbols ) )
+  {
+    maxBleed = std::max( maxBleed, QgsSymbolLayerUtils::estimateMaxSymbolBleed( symbol, context ) );
+  }
+  // an extra pixel accounts for antialiasing
+  const double bufferMapUnits = ( maxBleed + 1 ) * settings.mapUnitsPerPixel() + settings.extentBuffer();
+
+  const QgsMapToPixel &mapToPixel = settings.mapToPixel();
+  const QgsCoordinateTransform ct = context.coordinateTransform();
+  const int rowsPerTile = static_cast< int >( std::ceil( static_cast< double >( outputSize.height() ) / tileCount ) );
+
+  for ( int top = 0; top < outputSize.height(); top += rowsPerTile )
+  {
+    const int bottom = std::min( top + rowsPerTile, outputSize.height() );
+
+    std::unique_ptr< Tile > tile = std::make_unique< Tile >();
+    tile->top = top;
+    tile->context = context;
+    tile->context.setLabelingEngine( nullptr );
+
+    const QgsPointXY topLeft = mapToPixel.toMapCoordinates( 0.0, static_cast< double >( top ) );
+    const QgsPointXY bottomRight = mapToPixel.toMapCoordinates( static_cast< double >( outputSize.width() ), static_cast< double >( bottom ) );
+    QgsRectangle tileExtent( topLeft, bottomRight );
+    tileExtent.grow( bufferMapUnits );
+
+    if ( ct.isValid() )
+    {
+      try
+      {
+        tileExtent = ct.transformBoundingBox( tileExtent, QgsCoordinateTransform::ReverseTransform );
+      }
+      catch ( QgsCsException & )
+      {
+        QgsDebugMsg( QStringLiteral( "Could not transform tile extent to layer CRS, using full extent" ) );
+        tileExtent = context.extent();
+      }
+    }
+    if ( !tileExtent.isFinite() )
+      tileExtent = context.extent();
+    else
+      tileExtent = tileExtent.intersect( context.extent() );
+    tile->context.setExtent( tileExtent );
+
+    const int deviceRows = std::min( static_cast< int >( std::ceil( ( bottom - top ) * devicePixelRatio ) ), deviceSize.height() );
+    tile->image = std::make_unique< QImage >( deviceSize.width(), deviceRows, settings.outputImageFormat() );
+    if ( tile->image->isNull() )
+    {
+      mErrors.append( QObject::tr( "Insufficient memory for image %1x%2" ).arg( deviceSize.width() ).arg( deviceRows ) );
+      mTiles.clear();
+      return;
+    }
+    tile->image->setDevicePixelRatio( static_cast<qreal>( devicePixelRatio ) );
+    tile->image->fill( 0 );
+
+    tile->painter = std::make_unique< QPainter >( tile->image.get() );
+    tile->painter->setRenderHint( QPainter::Antialiasing, settings.testFlag( QgsMapSettings::Antialiasing ) );
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    tile->painter->setRenderHint( QPainter::LosslessImageRendering, settings.testFlag( QgsMapSettings::LosslessImageRendering ) );
+#endif
+    // the stripe image only covers its own rows, so anything painted outside of them is simply dropped
+    tile->painter->translate( 0, -top );
+    tile->context.setPainter( tile->painter.get() );
+
+    tile->renderer.reset( layer->createMapRenderer( tile->context ) );
+    if ( !tile->renderer )
+    {
+      mTiles.clear();
+      return;
+    }
+    mForceRasterRender = mForceRasterRender || tile->renderer->forceRasterRender();
+
+    mTiles.emplace_back( std::move( tile ) );
+  }
+
+  QObject::connect( mFeedback.get(), &QgsFeedback::canceled, mFeedback.get(), [ = ]
+  {
+    for ( const std::unique_ptr< Tile > &tile : mTiles )
+    {
+      tile->context.setRenderingStopped( true );
+    }
+  }, Qt::DirectConnection );
+
+  mReadyToCompose = false;
+}
+
+QgsMapLayerTiledRenderer::~QgsMapLayerTiledRenderer() = default;
+
+bool QgsMapLayerTiledRenderer::forceRasterRender() const
+{
+  return mForceRasterRender;
+}
+
+QgsFeedback *QgsMapLayerTiledRenderer::feedback() const
+{
+  return mFeedback.get();
+}
+
+bool QgsMapLayerTiledRenderer::render()
+{
+  if ( mTiles.empty() )
+  {
+    mReadyToCompose = true;
+    return mErrors.isEmpty();
+  }
+
+  if ( renderContext()->renderingStopped() )
+  {
+    for ( const std::unique_ptr< Tile > &tile : mTiles )
+      tile->context.setRenderingStopped( true );
+  }
+
+  QtConcurrent::blockingMap( mTiles, renderTile );
+
+  bool completed = true;
+  QPainter *painter = renderContext()->painter();
+  for ( const std::unique_ptr< Tile > &tile : mTiles )
+  {
+    // painter must be finished before the image can be drawn elsewhere
+    tile->painter.reset();
+    tile->context.setPainter( nullptr );
+
+    mErrors.append( tile->errors );
+    completed = completed && tile->completed;
+
+    if ( painter )
+      painter->drawImage( QPointF( 0, tile->top ), *tile->image );
+    tile->image.reset();
+  }
+
+  mReadyToCompose = true;
+  return completed && !renderContext()->renderingStopped();
+}
+
+void QgsMapLayerTiledRenderer::renderTile( std::unique_ptr< Tile > &tile )
+{
+  if ( tile->context.renderingStopped() )
+    return;
+
+  sRenderedTileCount.fetchAndAddRelaxed( 1 );
+
+  try
+  {
+    tile->completed = tile->renderer->render();
+  }
+  catch ( QgsException &e )
+  {
+    Q_UNUSED( e )
+    QgsDebugMsg( "Caught unhandled QgsException: " + e.what() );
+  }
+  catch ( std::exception &e )
+  {
+    Q_UNUSED( e )
+    QgsDebugMsg( "Caught unhandled std::exception: " + QString::fromLatin1( e.what() ) );
+  }
+  catch ( ... )
+  {
+    QgsDebugMsg( QStringLiteral( "Caught unhandled unknown exception" ) );
+  }
+
+  tile->errors = tile->renderer->errors();
+}
+
+int QgsMapLayerTiledRenderer::renderedTileCount()
+{
+  return sRenderedTileCount.loadAcquire();
+}
+
+///@endcond PRIVATE
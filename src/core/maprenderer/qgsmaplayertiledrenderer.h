@@ -0,0 +1,113 @@
+/***************************************************************************
+  qgsmaplayertiledrenderer.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSMAPLAYERTILEDRENDERER_H
+#define QGSMAPLAYERTILEDRENDERER_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+#include "qgsmaplayerrenderer.h"
+#include "qgsrendercontext.h"
+
+#include <QImage>
+#include <memory>
+#include <vector>
+
+class QgsFeedback;
+class QgsMapSettings;
+class QgsVectorLayer;
+class QgsLabelingEngine;
+
+///@cond PRIVATE
+
+/**
+ * \ingroup core
+ * \brief Map layer renderer which splits the rendering of a single (heavy) vector layer
+ * into horizontal stripes of the map image, which are rendered concurrently and then
+ * composed in order onto the destination painter.
+ *
+ * Each stripe uses its own copy of the render context, with the extent reduced to the
+ * stripe (grown by the estimated maximum symbol bleed) so that every worker only fetches
+ * and draws the features relevant for its part of the map. Because every stripe image only
+ * covers its own rows, the result is identical to an untiled render. Layers whose symbols can
+ * paint further than the estimated bleed (e.g. data defined sizes or offsets, geometry generators
+ * or paint effects) are not eligible for tiling.
+ *
+ * The sub-renderers are created in the constructor, so like any other map layer renderer
+ * this object must be constructed in the main thread and rendered in a worker thread.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsMapLayerTiledRenderer : public QgsMapLayerRenderer
+{
+  public:
+
+    /**
+     * Returns TRUE if the specified \a layer can be rendered in tiles for the given
+     * map \a settings and render \a context.
+     *
+     * Only vector layers which do not participate in labeling (or diagrams) and which do
+     * not have rendered feature handlers attached are eligible, and the map must not be rotated.
+     * The extent painted by the layer's symbols must also be bounded by their estimated bleed,
+     * which excludes data defined symbol sizes and offsets, geometry generators, paint effects
+     * and renderers which displace or spread the features.
+     */
+    static bool layerIsEligible( QgsMapLayer *layer, const QgsMapSettings &settings, const QgsRenderContext &context, QgsLabelingEngine *labelingEngine );
+
+    /**
+     * Constructor for QgsMapLayerTiledRenderer, which renders the specified vector \a layer
+     * using the given render \a context in \a tileCount stripes.
+     */
+    QgsMapLayerTiledRenderer( QgsVectorLayer *layer, QgsRenderContext &context, const QgsMapSettings &settings, int tileCount );
+    ~QgsMapLayerTiledRenderer() override;
+
+    bool render() override;
+    bool forceRasterRender() const override;
+    QgsFeedback *feedback() const override;
+
+    //! Returns the number of tiles which will be rendered
+    int tileCount() const { return static_cast< int >( mTiles.size() ); }
+
+  private:
+
+    struct Tile
+    {
+      QgsRenderContext context;
+      std::unique_ptr< QImage > image;
+      std::unique_ptr< QPainter > painter;
+      std::unique_ptr< QgsMapLayerRenderer > renderer;
+      //! Top row of the tile, in logical pixels
+      int top = 0;
+      bool completed = false;
+      QStringList errors;
+    };
+
+    static void renderTile( std::unique_ptr< Tile > &tile );
+
+    //! Returns the total number of tiles rendered, for tests
+    static int renderedTileCount();
+
+    friend class TestQgsMapRendererJob;
+
+    std::vector< std::unique_ptr< Tile > > mTiles;
+    std::unique_ptr< QgsFeedback > mFeedback;
+    bool mForceRasterRender = false;
+};
+
+///@endcond PRIVATE
+
+#endif // QGSMAPLAYERTILEDRENDERER_H
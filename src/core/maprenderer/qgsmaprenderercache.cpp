@@ -50,6 +50,8 @@ void QgsMapRendererCache::clearInternal()
   }
   mCachedImages.clear();
   mConnectedLayers.clear();
+  mLabelPlacements = QgsLabelPlacementCache();
+  mLabelPlacementLayers.clear();
 }
 
 void QgsMapRendererCache::dropUnusedConnections()
@@ -81,6 +83,11 @@ QSet<QgsWeakMapLayerPointer > QgsMapRendererCache::dependentLayers() const
         result << l;
     }
   }
+  for ( const QgsWeakMapLayerPointer &l : mLabelPlacementLayers )
+  {
+    if ( l.data() )
+      result << l;
+  }
   return result;
 }
 
@@ -304,6 +311,12 @@ void QgsMapRendererCache::invalidateCacheForLayer( QgsMapLayer *layer )
 
     it = mCachedImages.erase( it );
   }
+  // labels of other layers may have been placed around the labels or the obstacles of this layer
+  if ( mLabelPlacementLayers.contains( layer ) )
+  {
+    mLabelPlacements = QgsLabelPlacementCache();
+    mLabelPlacementLayers.clear();
+  }
   dropUnusedConnections();
 }
 
@@ -315,3 +328,32 @@ void QgsMapRendererCache::clearCacheImage( const QString &cacheKey )
   dropUnusedConnections();
 }
 
+
+void QgsMapRendererCache::setLabelPlacementCache( const QgsLabelPlacementCache &cache, const QList< QgsMapLayer * > &dependentLayers )
+{
+  QMutexLocker lock( &mMutex );
+  mLabelPlacements = cache;
+  mLabelPlacementLayers.clear();
+
+  // connect to the layers to drop the placements when any of them requests a repaint
+  for ( QgsMapLayer *layer : dependentLayers )
+  {
+    if ( layer )
+    {
+      mLabelPlacementLayers << layer;
+      if ( !mConnectedLayers.contains( QgsWeakMapLayerPointer( layer ) ) )
+      {
+        connect( layer, &QgsMapLayer::repaintRequested, this, &QgsMapRendererCache::layerRequestedRepaint );
+        connect( layer, &QgsMapLayer::willBeDeleted, this, &QgsMapRendererCache::layerRequestedRepaint );
+        mConnectedLayers << layer;
+      }
+    }
+  }
+  dropUnusedConnections();
+}
+
+QgsLabelPlacementCache QgsMapRendererCache::labelPlacementCache() const
+{
+  QMutexLocker lock( &mMutex );
+  return mLabelPlacements;
+}
@@ -17,12 +17,14 @@
 #define QGSMAPRENDERERCACHE_H
 
 #include "qgis_core.h"
+#include "qgis_sip.h"
 #include <QMap>
 #include <QImage>
 #include <QMutex>
 
 #include "qgsrectangle.h"
 #include "qgsmaplayer.h"
+#include "qgslabelplacementcache.h"
 
 
 /**
@@ -173,6 +175,29 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
      */
     void invalidateCacheForLayer( QgsMapLayer *layer );
 
+    /**
+     * Sets the label placements \a cache of the last rendered map, which may be reused
+     * when the map is panned.
+     *
+     * The \a dependentLayers are the layers which took part in the labeling, including the layers
+     * which are only obstacles for labels. All placements are dropped when any of these layers requests
+     * a repaint, as a change in one layer can affect the placements of the labels of the others.
+     *
+     * \see labelPlacementCache()
+     * \note not available in Python bindings
+     * \since QGIS 3.22
+     */
+    void setLabelPlacementCache( const QgsLabelPlacementCache &cache, const QList< QgsMapLayer * > &dependentLayers = QList< QgsMapLayer * >() ) SIP_SKIP;
+
+    /**
+     * Returns the label placements cache of the last rendered map.
+     *
+     * \see setLabelPlacementCache()
+     * \note not available in Python bindings
+     * \since QGIS 3.22
+     */
+    QgsLabelPlacementCache labelPlacementCache() const SIP_SKIP;
+
   private slots:
     //! Remove layer (that emitted the signal) from the cache
     void layerRequestedRepaint();
@@ -205,6 +230,10 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
     QMap<QString, CacheParameters> mCachedImages;
     //! List of all layers on which this cache is currently connected
     QSet< QgsWeakMapLayerPointer > mConnectedLayers;
+    //! Label placements of the last rendered map
+    QgsLabelPlacementCache mLabelPlacements;
+    //! Layers which took part in the labeling of the last rendered map
+    QgsWeakMapLayerPointerList mLabelPlacementLayers;
 };
 
 
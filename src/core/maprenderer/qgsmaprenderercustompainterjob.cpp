@@ -20,6 +20,7 @@
 #include "qgslogger.h"
 #include "qgsmaplayerrenderer.h"
 #include "qgsmaplayerlistutils.h"
+#include "qgsmaprenderercache.h"
 #include "qgsvectorlayerlabeling.h"
 
 #include <QtConcurrentRun>
@@ -101,6 +102,8 @@ void QgsMapRendererCustomPainterJob::startPrivate()
   {
     mLabelingEngineV2.reset( new QgsDefaultLabelingEngine() );
     mLabelingEngineV2->setMapSettings( mSettings );
+    if ( mCache && mSettings.labelingEngineSettings().testFlag( QgsLabelingEngineSettings::ReusePlacements ) )
+      mLabelingEngineV2->setPlacementCache( mCache->labelPlacementCache() );
   }
 
   bool canUseLabelCache = prepareLabelCache();
@@ -355,6 +358,9 @@ void QgsMapRendererCustomPainterJob::doRender()
       mLabelJob.complete = true;
       mLabelJob.renderingTime = labelTime.elapsed();
       mLabelJob.participatingLayers = _qgis_listRawToQPointer( mLabelingEngineV2->participatingLayers() );
+
+      if ( mCache && !mLabelJob.context.renderingStopped() && mSettings.labelingEngineSettings().testFlag( QgsLabelingEngineSettings::ReusePlacements ) )
+        mCache->setLabelPlacementCache( mLabelingEngineV2->placementCache(), mLabelingEngineV2->participatingLayers() );
     }
   }
 
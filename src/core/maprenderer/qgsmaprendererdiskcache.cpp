@@ -0,0 +1,239 @@
+/***************************************************************************
+  qgsmaprendererdiskcache.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsmaprendererdiskcache.h"
+#include "qgslogger.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+
+///@cond PRIVATE
+
+/**
+ * Header of a cached image file, followed by the raw scanlines of the image.
+ */
+struct QgsMapRendererDiskCacheHeader
+{
+  char magic[4];
+  quint32 version;
+  qint32 width;
+  qint32 height;
+  qint32 format;
+  qint32 bytesPerLine;
+  double devicePixelRatio;
+  qint32 dotsPerMeterX;
+  qint32 dotsPerMeterY;
+};
+
+static const char DISK_CACHE_MAGIC[4] = { 'Q', 'G', 'R', 'C' };
+static const quint32 DISK_CACHE_VERSION = 1;
+static const QString DISK_CACHE_SUFFIX = QStringLiteral( ".qgsrc" );
+
+///@endcond
+
+QgsMapRendererDiskCache::QgsMapRendererDiskCache( const QString &directory, qint64 maximumSize )
+  : mDirectory( directory )
+  , mMaximumSize( maximumSize )
+{
+  QDir().mkpath( mDirectory );
+}
+
+qint64 QgsMapRendererDiskCache::maximumSize() const
+{
+  QMutexLocker locker( &mMutex );
+  return mMaximumSize;
+}
+
+void QgsMapRendererDiskCache::setMaximumSize( qint64 size )
+{
+  QMutexLocker locker( &mMutex );
+  mMaximumSize = size;
+  mCurrentSize = scanCacheSize();
+  if ( mCurrentSize > mMaximumSize )
+    evictEntries( mMaximumSize );
+}
+
+qint64 QgsMapRendererDiskCache::cacheSize() const
+{
+  QMutexLocker locker( &mMutex );
+  mCurrentSize = scanCacheSize();
+  return mCurrentSize;
+}
+
+QString QgsMapRendererDiskCache::filePath( const QString &key ) const
+{
+  // spread the files over subdirectories, to keep the directories small
+  return mDirectory + '/' + key.left( 2 ) + '/' + key + DISK_CACHE_SUFFIX;
+}
+
+QImage QgsMapRendererDiskCache::image( const QString &key ) const
+{
+  if ( key.isEmpty() )
+    return QImage();
+
+  QFile file( filePath( key ) );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return QImage();
+
+  const qint64 size = file.size();
+  if ( size < static_cast< qint64 >( sizeof( QgsMapRendererDiskCacheHeader ) ) )
+    return QImage();
+
+  uchar *data = file.map( 0, size );
+  if ( !data )
+    return QImage();
+
+  QgsMapRendererDiskCacheHeader header;
+  std::memcpy( &header, data, sizeof( QgsMapRendererDiskCacheHeader ) );
+
+  QImage result;
+  if ( std::memcmp( header.magic, DISK_CACHE_MAGIC, 4 ) == 0
+       && header.version == DISK_CACHE_VERSION
+       && header.width > 0 && header.height > 0 && header.bytesPerLine > 0
+       && static_cast< qint64 >( sizeof( QgsMapRendererDiskCacheHeader ) ) + static_cast< qint64 >( header.bytesPerLine ) * header.height <= size )
+  {
+    // the file will be unmapped once we return, so take a deep copy of the mapped pixels
+    const QImage mapped( data + sizeof( QgsMapRendererDiskCacheHeader ), header.width, header.height, header.bytesPerLine, static_cast< QImage::Format >( header.format ) );
+    result = mapped.copy();
+    result.setDevicePixelRatio( header.devicePixelRatio );
+    result.setDotsPerMeterX( header.dotsPerMeterX );
+    result.setDotsPerMeterY( header.dotsPerMeterY );
+  }
+  else
+  {
+    QgsDebugMsg( QStringLiteral( "Invalid map renderer cache file %1" ).arg( file.fileName() ) );
+  }
+
+  file.unmap( data );
+
+  // touching the file keeps track of the least recently used entries, across processes
+  if ( !result.isNull() )
+    file.setFileTime( QDateTime::currentDateTime(), QFileDevice::FileModificationTime );
+
+  return result;
+}
+
+void QgsMapRendererDiskCache::storeImage( const QString &key, const QImage &image )
+{
+  if ( key.isEmpty() || image.isNull() )
+    return;
+
+  const QString path = filePath( key );
+  QDir().mkpath( QFileInfo( path ).absolutePath() );
+
+  QgsMapRendererDiskCacheHeader header;
+  std::memcpy( header.magic, DISK_CACHE_MAGIC, 4 );
+  header.version = DISK_CACHE_VERSION;
+  header.width = image.width();
+  header.height = image.height();
+  header.format = static_cast< qint32 >( image.format() );
+  header.bytesPerLine = image.bytesPerLine();
+  header.devicePixelRatio = image.devicePixelRatio();
+  header.dotsPerMeterX = image.dotsPerMeterX();
+  header.dotsPerMeterY = image.dotsPerMeterY();
+
+  // QSaveFile writes to a temporary file and renames it on commit, so that other processes
+  // never see partially written images
+  QSaveFile file( path );
+  if ( !file.open( QIODevice::WriteOnly ) )
+  {
+    QgsDebugMsg( QStringLiteral( "Could not write map renderer cache file %1" ).arg( path ) );
+    return;
+  }
+
+  const qint64 imageBytes = static_cast< qint64 >( image.bytesPerLine() ) * image.height();
+  file.write( reinterpret_cast< const char * >( &header ), sizeof( QgsMapRendererDiskCacheHeader ) );
+  file.write( reinterpret_cast< const char * >( image.constBits() ), imageBytes );
+  if ( !file.commit() )
+  {
+    QgsDebugMsg( QStringLiteral( "Could not write map renderer cache file %1" ).arg( path ) );
+    return;
+  }
+
+  QMutexLocker locker( &mMutex );
+  if ( mCurrentSize < 0 )
+    mCurrentSize = scanCacheSize();
+  else
+    mCurrentSize += imageBytes + static_cast< qint64 >( sizeof( QgsMapRendererDiskCacheHeader ) );
+
+  if ( mCurrentSize > mMaximumSize )
+  {
+    // evict a little more than strictly required, so that we don't have to scan the directory on every store
+    evictEntries( static_cast< qint64 >( mMaximumSize * 0.9 ) );
+  }
+}
+
+void QgsMapRendererDiskCache::clear()
+{
+  QMutexLocker locker( &mMutex );
+  evictEntries( 0 );
+}
+
+qint64 QgsMapRendererDiskCache::scanCacheSize() const
+{
+  qint64 size = 0;
+  QDirIterator it( mDirectory, QStringList() << '*' + DISK_CACHE_SUFFIX, QDir::Files, QDirIterator::Subdirectories );
+  while ( it.hasNext() )
+  {
+    it.next();
+    size += it.fileInfo().size();
+  }
+  return size;
+}
+
+void QgsMapRendererDiskCache::evictEntries( qint64 targetSize )
+{
+  struct Entry
+  {
+    QString path;
+    QDateTime lastUsed;
+    qint64 size;
+  };
+
+  std::vector< Entry > entries;
+  qint64 totalSize = 0;
+  QDirIterator it( mDirectory, QStringList() << '*' + DISK_CACHE_SUFFIX, QDir::Files, QDirIterator::Subdirectories );
+  while ( it.hasNext() )
+  {
+    it.next();
+    const QFileInfo info = it.fileInfo();
+    entries.emplace_back( Entry{ info.absoluteFilePath(), info.lastModified(), info.size() } );
+    totalSize += info.size();
+  }
+
+  std::sort( entries.begin(), entries.end(), []( const Entry & a, const Entry & b )
+  {
+    return a.lastUsed < b.lastUsed;
+  } );
+
+  for ( const Entry &entry : entries )
+  {
+    if ( totalSize <= targetSize )
+      break;
+
+    // another process may have evicted the entry already, that's fine
+    QFile::remove( entry.path );
+    totalSize -= entry.size;
+  }
+
+  mCurrentSize = totalSize;
+}
@@ -0,0 +1,98 @@
+/***************************************************************************
+  qgsmaprendererdiskcache.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSMAPRENDERERDISKCACHE_H
+#define QGSMAPRENDERERDISKCACHE_H
+
+#include "qgis_core.h"
+#include "qgis_sip.h"
+#include "qgsabstractmaprendererpersistentcache.h"
+
+#include <QMutex>
+
+/**
+ * \ingroup core
+ * \brief A persistent cache of rendered map layer images, stored in a directory on disk.
+ *
+ * Every cached image is stored as an uncompressed file, which is memory mapped when read. Files
+ * are written atomically, so the same directory can safely be shared by several processes
+ * (e.g. QGIS Server FastCGI workers), which will then reuse each other's renders.
+ *
+ * The total size of the cache is bounded by maximumSize(). When it is exceeded the least recently
+ * used images (of all processes sharing the directory) are evicted.
+ *
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsMapRendererDiskCache : public QgsAbstractMapRendererPersistentCache
+{
+  public:
+
+    /**
+     * Constructor for QgsMapRendererDiskCache, storing images in the specified \a directory
+     * and using up to \a maximumSize bytes of disk space.
+     *
+     * The directory is created if it does not exist.
+     */
+    QgsMapRendererDiskCache( const QString &directory, qint64 maximumSize = 100 * 1024 * 1024 );
+
+    QImage image( const QString &key ) const override;
+    void storeImage( const QString &key, const QImage &image ) override;
+    void clear() override;
+
+    /**
+     * Returns the directory in which cached images are stored.
+     */
+    QString directory() const { return mDirectory; }
+
+    /**
+     * Returns the maximum size of the cache, in bytes.
+     *
+     * \see setMaximumSize()
+     */
+    qint64 maximumSize() const;
+
+    /**
+     * Sets the maximum \a size of the cache, in bytes.
+     *
+     * \see maximumSize()
+     */
+    void setMaximumSize( qint64 size );
+
+    /**
+     * Returns the current size of all images stored in the cache directory, in bytes.
+     */
+    qint64 cacheSize() const;
+
+  private:
+
+    //! Returns the path of the file storing the image for \a key
+    QString filePath( const QString &key ) const;
+
+    //! Removes least recently used images until the cache is smaller than \a targetSize. Must be called with the mutex locked.
+    void evictEntries( qint64 targetSize );
+
+    //! Returns the total size of the cache directory. Must be called with the mutex locked.
+    qint64 scanCacheSize() const;
+
+    QString mDirectory;
+    qint64 mMaximumSize = 0;
+
+    mutable QMutex mMutex;
+
+    //! Estimated size of the cache, or -1 if not known yet
+    mutable qint64 mCurrentSize = -1;
+};
+
+#endif // QGSMAPRENDERERDISKCACHE_H
@@ -27,6 +27,7 @@
 #include "qgsmaplayerrenderer.h"
 #include "qgsmaplayerstylemanager.h"
 #include "qgsmaprenderercache.h"
+#include "qgsabstractmaprendererpersistentcache.h"
 #include "qgsmessagelog.h"
 #include "qgspallabeling.h"
 #include "qgsexception.h"
@@ -99,6 +100,16 @@ void QgsMapRendererJob::setCache( QgsMapRendererCache *cache )
   mCache = cache;
 }
 
+void QgsMapRendererJob::setPersistentCache( QgsAbstractMapRendererPersistentCache *cache )
+{
+  mPersistentCache = cache;
+}
+
+QgsAbstractMapRendererPersistentCache *QgsMapRendererJob::persistentCache() const
+{
+  return mPersistentCache;
+}
+
 QHash<QgsMapLayer *, int> QgsMapRendererJob::perLayerRenderingTime() const
 {
   QHash<QgsMapLayer *, int> result;
@@ -451,6 +462,25 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
       continue;
     }
 
+    // next try the persistent cache. Layers being edited or requiring labeling must always be rendered.
+    // The filters of the feature filter provider (e.g. server access control) are part of the key.
+    if ( mPersistentCache && !( vl && vl->isEditable() ) && !( labelingEngine2 && QgsPalLabeling::staticWillUseLayer( ml ) ) )
+    {
+      job.persistentCacheKey = QgsAbstractMapRendererPersistentCache::layerCacheKey( ml, mSettings, mFeatureFilterProvider );
+      const QImage cachedImage = mPersistentCache->image( job.persistentCacheKey );
+      if ( !cachedImage.isNull() && cachedImage.size() == mSettings.deviceOutputSize() )
+      {
+        QgsDebugMsgLevel( QStringLiteral( "using persistent cache image for %1" ).arg( job.layerId ), 2 );
+        job.cached = true;
+        job.imageInitialized = true;
+        job.img = new QImage( cachedImage );
+        job.img->setDevicePixelRatio( static_cast<qreal>( mSettings.devicePixelRatio() ) );
+        job.renderer = nullptr;
+        job.context.setPainter( nullptr );
+        continue;
+      }
+    }
+
     QElapsedTimer layerTime;
     layerTime.start();
     job.renderer = ml->createMapRenderer( job.context );
@@ -460,7 +490,7 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter *painter, QgsLabelingEn
     // If we are drawing with an alternative blending mode then we need to render to a separate image
     // before compositing this on the map. This effectively flattens the layer and prevents
     // blending occurring between objects on the layer
-    if ( mCache || ( !painter && !deferredPainterSet ) || ( job.renderer && job.renderer->forceRasterRender() ) )
+    if ( mCache || !job.persistentCacheKey.isEmpty() || ( !painter && !deferredPainterSet ) || ( job.renderer && job.renderer->forceRasterRender() ) )
     {
       // Flattened image for drawing when a blending mode is set
       job.context.setPainter( allocateImageAndPainter( ml->id(), job.img ) );
@@ -737,6 +767,12 @@ void QgsMapRendererJob::cleanupJobs( LayerRenderJobs &jobs )
         mCache->setCacheImageWithParameters( job.layerId + QStringLiteral( "_preview" ), *job.img, mSettings.visibleExtent(), mSettings.mapToPixel(), QList< QgsMapLayer * >() << job.layer );
       }
 
+      if ( mPersistentCache && !job.cached && job.completed && !job.persistentCacheKey.isEmpty() )
+      {
+        QgsDebugMsgLevel( QStringLiteral( "storing image for %1 in persistent cache" ).arg( job.layerId ), 2 );
+        mPersistentCache->storeImage( job.persistentCacheKey, *job.img );
+      }
+
       delete job.img;
       job.img = nullptr;
     }
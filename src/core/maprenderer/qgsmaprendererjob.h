@@ -36,6 +36,7 @@ class QgsLabelingEngine;
 class QgsLabelingResults;
 class QgsMapLayerRenderer;
 class QgsMapRendererCache;
+class QgsAbstractMapRendererPersistentCache;
 class QgsFeatureFilterProvider;
 
 #ifndef SIP_RUN
@@ -132,6 +133,14 @@ struct LayerRenderJob
    * In this latter case, the second element of the QPair gives the label mask id.
    */
   QList<QPair<LayerRenderJob *, int>> maskJobs;
+
+  /**
+   * Key of the layer render within the job's persistent cache, or an empty
+   * string if the persistent cache should not be used for the job.
+   *
+   * \since QGIS 3.22
+   */
+  QString persistentCacheKey;
 };
 
 typedef QList<LayerRenderJob> LayerRenderJobs;
@@ -297,6 +306,31 @@ class CORE_EXPORT QgsMapRendererJob : public QObject SIP_ABSTRACT
      */
     void setCache( QgsMapRendererCache *cache );
 
+    /**
+     * Assigns a persistent \a cache to be used for reading and storing rendered images of individual layers.
+     *
+     * Unlike the cache set by setCache(), a persistent cache stores images keyed by the full set of render
+     * parameters, so that they can be reused by later render jobs (possibly in other processes).
+     * Layers which are being edited or which participate in labeling are never read from or stored
+     * in the persistent cache. The filtering of a feature filter provider set with setFeatureFilterProvider()
+     * is part of the cache keys, see QgsAbstractMapRendererPersistentCache::layerCacheKey().
+     *
+     * Does not take ownership of the object.
+     *
+     * \see persistentCache()
+     * \since QGIS 3.22
+     */
+    void setPersistentCache( QgsAbstractMapRendererPersistentCache *cache );
+
+    /**
+     * Returns the persistent cache used for reading and storing rendered images of individual layers,
+     * or NULLPTR if no persistent cache is set.
+     *
+     * \see setPersistentCache()
+     * \since QGIS 3.22
+     */
+    QgsAbstractMapRendererPersistentCache *persistentCache() const;
+
     /**
      * Returns the total time it took to finish the job (in milliseconds).
      * \see perLayerRenderingTime()
@@ -371,6 +405,13 @@ class CORE_EXPORT QgsMapRendererJob : public QObject SIP_ABSTRACT
 
     QgsMapRendererCache *mCache = nullptr;
 
+    /**
+     * Persistent cache of layer images.
+     *
+     * \since QGIS 3.22
+     */
+    QgsAbstractMapRendererPersistentCache *mPersistentCache = nullptr;
+
     int mRenderingTime = 0;
 
     //! Render time (in ms) per layer, by layer ID
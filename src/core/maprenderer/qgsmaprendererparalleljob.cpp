@@ -22,6 +22,10 @@
 #include "qgsproject.h"
 #include "qgsmaplayer.h"
 #include "qgsmaplayerlistutils.h"
+#include "qgsmaprenderercache.h"
+#include "qgsmaplayerstylemanager.h"
+#include "qgsmaplayertiledrenderer.h"
+#include "qgsvectorlayer.h"
 
 #include <QtConcurrentMap>
 #include <QtConcurrentRun>
@@ -55,12 +59,15 @@ void QgsMapRendererParallelJob::startPrivate()
   {
     mLabelingEngineV2.reset( new QgsDefaultLabelingEngine() );
     mLabelingEngineV2->setMapSettings( mSettings );
+    if ( mCache && mSettings.labelingEngineSettings().testFlag( QgsLabelingEngineSettings::ReusePlacements ) )
+      mLabelingEngineV2->setPlacementCache( mCache->labelPlacementCache() );
   }
 
   bool canUseLabelCache = prepareLabelCache();
   mLayerJobs = prepareJobs( nullptr, mLabelingEngineV2.get() );
   mLabelJob = prepareLabelingJob( nullptr, mLabelingEngineV2.get(), canUseLabelCache );
   mSecondPassLayerJobs = prepareSecondPassJobs( mLayerJobs, mLabelJob );
+  prepareTiledJobs();
 
   QgsDebugMsgLevel( QStringLiteral( "QThreadPool max thread count is %1" ).arg( QThreadPool::globalInstance()->maxThreadCount() ), 2 );
 
@@ -72,6 +79,45 @@ void QgsMapRendererParallelJob::startPrivate()
   mFutureWatcher.setFuture( mFuture );
 }
 
+void QgsMapRendererParallelJob::prepareTiledJobs()
+{
+  const QMap<QString, int> tileCounts = mSettings.layerRenderTileCounts();
+  if ( tileCounts.isEmpty() )
+    return;
+
+  for ( LayerRenderJob &job : mLayerJobs )
+  {
+    const int tileCount = tileCounts.value( job.layerId, 0 );
+    if ( tileCount < 2 || job.cached || !job.renderer || !job.img || job.maskImage || !job.layer )
+      continue;
+
+    // jobs which are involved in selective masking are rendered as a whole
+    const bool usedBySecondPass = std::any_of( mSecondPassLayerJobs.constBegin(), mSecondPassLayerJobs.constEnd(), [&job]( const LayerRenderJob & secondPassJob )
+    {
+      return secondPassJob.firstPassJob == &job;
+    } );
+    if ( usedBySecondPass )
+      continue;
+
+    if ( !QgsMapLayerTiledRenderer::layerIsEligible( job.layer, mSettings, job.context, mLabelingEngineV2.get() ) )
+      continue;
+
+    QgsVectorLayer *vl = qobject_cast< QgsVectorLayer * >( job.layer );
+    QgsMapLayerStyleOverride styleOverride( vl );
+    if ( mSettings.layerStyleOverrides().contains( job.layerId ) )
+      styleOverride.setOverrideStyle( mSettings.layerStyleOverrides().value( job.layerId ) );
+
+    std::unique_ptr< QgsMapLayerTiledRenderer > tiledRenderer = std::make_unique< QgsMapLayerTiledRenderer >( vl, job.context, mSettings, tileCount );
+    if ( tiledRenderer->tileCount() < 2 )
+      continue;
+
+    QgsDebugMsgLevel( QStringLiteral( "Rendering layer %1 in %2 tiles" ).arg( job.layerId ).arg( tiledRenderer->tileCount() ), 2 );
+    tiledRenderer->setLayerRenderingTimeHint( job.estimatedRenderingTime );
+    delete job.renderer;
+    job.renderer = tiledRenderer.release();
+  }
+}
+
 void QgsMapRendererParallelJob::cancel()
 {
   if ( !isActive() )
@@ -411,6 +457,9 @@ void QgsMapRendererParallelJob::renderLabelsStatic( QgsMapRendererParallelJob *s
     try
     {
       drawLabeling( job.context, self->mLabelingEngineV2.get(), &painter );
+
+      if ( self->mCache && !job.context.renderingStopped() && self->mSettings.labelingEngineSettings().testFlag( QgsLabelingEngineSettings::ReusePlacements ) )
+        self->mCache->setLabelPlacementCache( self->mLabelingEngineV2->placementCache(), self->mLabelingEngineV2->participatingLayers() );
     }
     catch ( QgsException &e )
     {
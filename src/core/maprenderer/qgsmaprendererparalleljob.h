@@ -64,6 +64,13 @@ class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
 
     void startPrivate() override;
 
+    /**
+     * Replaces the renderers of layer jobs which have been set to render in multiple tiles
+     * (see QgsMapSettings::layerRenderTileCounts()) with tiled renderers.
+     * \note not available in Python bindings
+     */
+    void prepareTiledJobs() SIP_SKIP;
+
     QImage mFinalImage;
 
     //! \note not available in Python bindings
@@ -66,6 +66,8 @@ void QgsMapRendererSequentialJob::startPrivate()
 
   mInternalJob = new QgsMapRendererCustomPainterJob( mSettings, mPainter );
   mInternalJob->setCache( mCache );
+  mInternalJob->setPersistentCache( mPersistentCache );
+  mInternalJob->setFeatureFilterProvider( featureFilterProvider() );
 
   connect( mInternalJob, &QgsMapRendererJob::finished, this, &QgsMapRendererSequentialJob::internalFinished );
 
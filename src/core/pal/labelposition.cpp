@@ -142,6 +142,7 @@ LabelPosition::LabelPosition( const LabelPosition &other )
 {
   id = other.id;
   mCost = other.mCost;
+  mBaseCost = other.mBaseCost;
   feature = other.feature;
   probFeat = other.probFeat;
   nbOverlap = other.nbOverlap;
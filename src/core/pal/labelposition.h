@@ -212,6 +212,22 @@ namespace pal
       */
       void setCost( double newCost ) { mCost = newCost; }
 
+      /**
+       * Returns the cost of the candidate label position as it was generated, before the
+       * penalties of obstacles and the final cost adjustments were applied.
+       * \see setBaseCost
+       * \since QGIS 3.22
+       */
+      double baseCost() const { return mBaseCost; }
+
+      /**
+       * Sets the cost of the candidate label position as it was generated, before the
+       * penalties of obstacles and the final cost adjustments were applied.
+       * \see baseCost
+       * \since QGIS 3.22
+       */
+      void setBaseCost( double cost ) { mBaseCost = cost; }
+
       /**
        * Sets whether the position is marked as conflicting with an obstacle feature.
        * \param conflicts set to TRUE to mark candidate as being in conflict
@@ -373,6 +389,7 @@ namespace pal
       std::unique_ptr< LabelPosition > mNextPart;
 
       double mCost;
+      double mBaseCost = 0;
       bool mHasObstacleConflict;
       bool mHasHardConflict = false;
       int mUpsideDownCharCount;
@@ -44,10 +44,14 @@
 #include "qgssettings.h"
 #include <cfloat>
 #include <list>
+#include <numeric>
+#include <QElapsedTimer>
+#include <QtConcurrentMap>
 
 using namespace pal;
 
 Pal::Pal()
+  : mStats( new PalStat() )
 {
   QgsSettings settings;
   mGlobalCandidatesLimitPoint = settings.value( QStringLiteral( "rendering/label_candidates_limit_points" ), 0, QgsSettings::Core ).toInt();
@@ -116,7 +120,6 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
 
   // prepare map boundary
   geos::unique_ptr mapBoundaryGeos( QgsGeos::asGeos( mapBoundary ) );
-  geos::prepared_unique_ptr mapBoundaryPrepared( GEOSPrepare_r( QgsGeos::getGEOSHandler(), mapBoundaryGeos.get() ) );
 
   int obstacleCount = 0;
 
@@ -127,6 +130,10 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
 
   QStringList layersWithFeaturesInBBox;
 
+  mStats.reset( new PalStat() );
+  QElapsedTimer timer;
+  timer.start();
+
   QMutexLocker palLocker( &mMutex );
   for ( const auto &it : mLayers )
   {
@@ -156,10 +163,13 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
     QMutexLocker locker( &layer->mMutex );
 
     // generate candidates for all features
-    for ( const std::unique_ptr< FeaturePart > &featurePart : std::as_const( layer->mFeatureParts ) )
+    std::vector< std::vector< std::unique_ptr< LabelPosition > > > layerCandidates = generateCandidates( layer, mapBoundaryGeos.get() );
+    if ( isCanceled() )
+      return nullptr;
+
+    for ( std::size_t partIndex = 0; partIndex < layer->mFeatureParts.size(); ++partIndex )
     {
-      if ( isCanceled() )
-        break;
+      const std::unique_ptr< FeaturePart > &featurePart = layer->mFeatureParts[ partIndex ];
 
       // Holes of the feature are obstacles
       for ( int i = 0; i < featurePart->getNumSelfObstacles(); i++ )
@@ -174,23 +184,7 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
         }
       }
 
-      // generate candidates for the feature part
-      std::vector< std::unique_ptr< LabelPosition > > candidates = featurePart->createCandidates( this );
-
-      if ( isCanceled() )
-        break;
-
-      // purge candidates that are outside the bbox
-      candidates.erase( std::remove_if( candidates.begin(), candidates.end(), [&mapBoundaryPrepared, this]( std::unique_ptr< LabelPosition > &candidate )
-      {
-        if ( showPartialLabels() )
-          return !candidate->intersects( mapBoundaryPrepared.get() );
-        else
-          return !candidate->within( mapBoundaryPrepared.get() );
-      } ), candidates.end() );
-
-      if ( isCanceled() )
-        break;
+      std::vector< std::unique_ptr< LabelPosition > > candidates = std::move( layerCandidates[ partIndex ] );
 
       if ( !candidates.empty() )
       {
@@ -271,6 +265,9 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
   if ( isCanceled() )
     return nullptr;
 
+  mStats->mCandidatesGenerationTime = timer.nsecsElapsed() / 1000000.0;
+  timer.restart();
+
   prob->mLayerCount = layersWithFeaturesInBBox.size();
   prob->labelledLayersName = layersWithFeaturesInBBox;
 
@@ -279,6 +276,8 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
   prob->mFeatNbLp.resize( prob->mFeatureCount );
   prob->mFeatStartId.resize( prob->mFeatureCount );
   prob->mInactiveCost.resize( prob->mFeatureCount );
+  prob->mComponentParents.resize( prob->mFeatureCount );
+  std::iota( prob->mComponentParents.begin(), prob->mComponentParents.end(), 0 );
 
   if ( !features.empty() )
   {
@@ -312,6 +311,9 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
       return nullptr;
     }
 
+    mStats->mObstaclesTime = timer.nsecsElapsed() / 1000000.0;
+    timer.restart();
+
     int idlp = 0;
     for ( std::size_t i = 0; i < prob->mFeatureCount; i++ ) /* for each feature into prob */
     {
@@ -447,11 +449,12 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
 
         // lookup for overlapping candidate
         lp->getBoundingBox( amin, amax );
-        prob->allCandidatesIndex().intersects( QgsRectangle( amin[0], amin[1], amax[0], amax[1] ), [&lp, this]( const LabelPosition * lp2 )->bool
+        prob->allCandidatesIndex().intersects( QgsRectangle( amin[0], amin[1], amax[0], amax[1] ), [&lp, &prob, this]( const LabelPosition * lp2 )->bool
         {
           if ( candidatesAreConflicting( lp.get(), lp2 ) )
           {
             lp->incrementNumOverlaps();
+            prob->joinComponents( lp->getProblemFeatureId(), lp2->getProblemFeatureId() );
           }
 
           return true;
@@ -469,11 +472,99 @@ std::unique_ptr<Problem> Pal::extract( const QgsRectangle &extent, const QgsGeom
     nbOverlaps /= 2;
     prob->mAllNblp = prob->mTotalCandidates;
     prob->mNbOverlap = nbOverlaps;
+
+    mStats->mConflictsTime = timer.nsecsElapsed() / 1000000.0;
   }
 
+  mStats->nbObjects = static_cast< int >( prob->mFeatureCount );
+
   return prob;
 }
 
+std::vector< std::vector< std::unique_ptr< LabelPosition > > > Pal::generateCandidates( Layer *layer, const GEOSGeometry *mapBoundary )
+{
+  const std::size_t partCount = layer->mFeatureParts.size();
+  std::vector< std::vector< std::unique_ptr< LabelPosition > > > candidates( partCount );
+
+  // the parts of a multipart feature share the label feature's geometries (e.g. its permissible zone),
+  // which can't be used from several threads at once. So all the parts of a label feature are handled by the same task
+  std::vector< std::vector< std::size_t > > tasks;
+  QHash< QgsLabelFeature *, std::size_t > labelFeatureTasks;
+  for ( std::size_t i = 0; i < partCount; ++i )
+  {
+    QgsLabelFeature *labelFeature = layer->mFeatureParts[i]->feature();
+    auto it = labelFeatureTasks.constFind( labelFeature );
+    if ( it == labelFeatureTasks.constEnd() )
+    {
+      labelFeatureTasks.insert( labelFeature, tasks.size() );
+      tasks.emplace_back( std::vector< std::size_t > { i } );
+    }
+    else
+    {
+      tasks[ *it ].emplace_back( i );
+    }
+  }
+
+  auto generate = [this, layer, mapBoundary, &candidates]( const std::vector< std::size_t > &parts )
+  {
+    // prepared geometries are not thread safe, so each task prepares its own copy of the map boundary
+    geos::prepared_unique_ptr mapBoundaryPrepared( GEOSPrepare_r( QgsGeos::getGEOSHandler(), mapBoundary ) );
+
+    // a previous placement is reused as the only candidate of single part features
+    const QgsLabelPlacementCache::Placement *previousPlacement = nullptr;
+    if ( parts.size() == 1 )
+    {
+      auto it = mPreviousPlacements.constFind( layer->mFeatureParts[ parts.front() ]->feature() );
+      if ( it != mPreviousPlacements.constEnd() )
+        previousPlacement = &( *it );
+    }
+
+    for ( std::size_t part : parts )
+    {
+      if ( isCanceled() )
+        return;
+
+      FeaturePart *featurePart = layer->mFeatureParts[ part ].get();
+
+      // generate candidates for the feature part
+      std::vector< std::unique_ptr< LabelPosition > > partCandidates;
+      if ( previousPlacement )
+      {
+        partCandidates.emplace_back( std::make_unique< LabelPosition >( 0, previousPlacement->position.x(), previousPlacement->position.y(),
+                                     previousPlacement->width, previousPlacement->height, previousPlacement->angle, previousPlacement->cost,
+                                     featurePart, false, static_cast< LabelPosition::Quadrant >( previousPlacement->quadrant ) ) );
+      }
+      else
+      {
+        partCandidates = featurePart->createCandidates( this );
+      }
+
+      if ( isCanceled() )
+        return;
+
+      // keep the costs of the generated candidates, before obstacles and the final adjustments are applied to them,
+      // as the placement of a label may be reused as a candidate in a later labeling solution
+      for ( std::unique_ptr< LabelPosition > &candidate : partCandidates )
+        candidate->setBaseCost( candidate->cost() );
+
+      // purge candidates that are outside the bbox
+      partCandidates.erase( std::remove_if( partCandidates.begin(), partCandidates.end(), [&mapBoundaryPrepared, this]( std::unique_ptr< LabelPosition > &candidate )
+      {
+        if ( showPartialLabels() )
+          return !candidate->intersects( mapBoundaryPrepared.get() );
+        else
+          return !candidate->within( mapBoundaryPrepared.get() );
+      } ), partCandidates.end() );
+
+      candidates[ part ] = std::move( partCandidates );
+    }
+  };
+
+  QtConcurrent::blockingMap( tasks, generate );
+
+  return candidates;
+}
+
 void Pal::registerCancellationCallback( Pal::FnIsCanceled fnCanceled, void *context )
 {
   fnIsCanceled = fnCanceled;
@@ -490,18 +581,18 @@ QList<LabelPosition *> Pal::solveProblem( Problem *prob, bool displayAll, QList<
   if ( !prob )
     return QList<LabelPosition *>();
 
-  prob->reduce();
-
   try
   {
-    prob->chain_search();
+    prob->solve( mStats.get() );
   }
   catch ( InternalException::Empty & )
   {
     return QList<LabelPosition *>();
   }
 
-  return prob->getSolution( displayAll, unlabeled );
+  const QList<LabelPosition *> solution = prob->getSolution( displayAll, unlabeled );
+  mStats->nbLabelledObjects = solution.size();
+  return solution;
 }
 
 void Pal::setMinIt( int min_it )
@@ -568,6 +659,21 @@ bool Pal::candidatesAreConflicting( const LabelPosition *lp1, const LabelPositio
   return res;
 }
 
+void Pal::setPreviousPlacement( const QgsLabelFeature *feature, const QgsLabelPlacementCache::Placement &placement )
+{
+  mPreviousPlacements.insert( feature, placement );
+}
+
+bool Pal::candidatesAreConflictingNoCacheUpdate( const LabelPosition *lp1, const LabelPosition *lp2 ) const
+{
+  auto key = qMakePair( std::min( lp1->globalId(), lp2->globalId() ), std::max( lp1->globalId(), lp2->globalId() ) );
+  auto it = mCandidateConflicts.constFind( key );
+  if ( it != mCandidateConflicts.constEnd() )
+    return *it;
+
+  return lp1->isInConflict( lp2 );
+}
+
 int Pal::getMinIt()
 {
   return mTabuMaxIt;
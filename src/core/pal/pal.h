@@ -38,11 +38,13 @@
 #include "qgsgeos.h"
 #include "qgspallabeling.h"
 #include "qgslabelingenginesettings.h"
+#include "qgslabelplacementcache.h"
 #include <QList>
 #include <iostream>
 #include <ctime>
 #include <QMutex>
 #include <QStringList>
+#include <memory>
 #include <unordered_map>
 
 // TODO ${MAJOR} ${MINOR} etc instead of 0.2
@@ -246,6 +248,25 @@ namespace pal
        */
       bool candidatesAreConflicting( const LabelPosition *lp1, const LabelPosition *lp2 ) const;
 
+      /**
+       * Returns the statistics of the last extracted and solved problem, e.g. the time spent in each
+       * labeling phase.
+       *
+       * \since QGIS 3.22
+       */
+      const PalStat *statistics() const { return mStats.get(); }
+
+      /**
+       * Sets the \a placement of the label of a \a feature from a previous labeling solution, which will be
+       * used as the only label candidate for this feature.
+       *
+       * This is only supported for features with a single part, the placement is ignored for
+       * features made of several parts.
+       *
+       * \since QGIS 3.22
+       */
+      void setPreviousPlacement( const QgsLabelFeature *feature, const QgsLabelPlacementCache::Placement &placement );
+
     private:
 
       std::unordered_map< QgsAbstractLabelProvider *, std::unique_ptr< Layer > > mLayers;
@@ -267,6 +288,10 @@ namespace pal
       unsigned int mNextCandidateId = 1;
       mutable QHash< QPair< unsigned int, unsigned int >, bool > mCandidateConflicts;
 
+      std::unique_ptr< PalStat > mStats;
+
+      QHash< const QgsLabelFeature *, QgsLabelPlacementCache::Placement > mPreviousPlacements;
+
       /**
        * \brief show partial labels (cut-off by the map canvas) or not
        */
@@ -293,6 +318,24 @@ namespace pal
        */
       std::unique_ptr< Problem > extract( const QgsRectangle &extent, const QgsGeometry &mapBoundary );
 
+      /**
+       * Generates the candidates for all the feature parts of a \a layer, discarding the candidates
+       * which are not visible within the \a mapBoundary geometry.
+       *
+       * Candidates are generated in parallel. The returned list contains the candidates of each feature part,
+       * in the order of the layer's feature parts.
+       */
+      std::vector< std::vector< std::unique_ptr< LabelPosition > > > generateCandidates( Layer *layer, const GEOSGeometry *mapBoundary );
+
+      /**
+       * Returns TRUE if a labelling candidate \a lp1 conflicts with \a lp2, without storing the result
+       * in the conflicts cache.
+       *
+       * Unlike candidatesAreConflicting(), this method can be called from several threads at once, as long
+       * as the same candidates are not tested concurrently.
+       */
+      bool candidatesAreConflictingNoCacheUpdate( const LabelPosition *lp1, const LabelPosition *lp2 ) const;
+
       /**
        * \brief Choose the size of popmusic subpart's
        * \param r subpart size
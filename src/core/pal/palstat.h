@@ -90,6 +90,48 @@ namespace pal
        */
       int getLayerNbLabelledObjects( int layerId );
 
+      /**
+       * Returns the time spent generating the label candidates of all features, in milliseconds.
+       * \since QGIS 3.22
+       */
+      double candidatesGenerationTime() const { return mCandidatesGenerationTime; }
+
+      /**
+       * Returns the time spent applying the obstacle costs to the candidates, in milliseconds.
+       * \since QGIS 3.22
+       */
+      double obstaclesTime() const { return mObstaclesTime; }
+
+      /**
+       * Returns the time spent searching for conflicting candidates, in milliseconds.
+       * \since QGIS 3.22
+       */
+      double conflictsTime() const { return mConflictsTime; }
+
+      /**
+       * Returns the time spent splitting the problem into independent partitions, in milliseconds.
+       * \since QGIS 3.22
+       */
+      double partitioningTime() const { return mPartitioningTime; }
+
+      /**
+       * Returns the time spent solving the problem (reduction and chain search of all partitions), in milliseconds.
+       * \since QGIS 3.22
+       */
+      double solvingTime() const { return mSolvingTime; }
+
+      /**
+       * Returns the number of independent partitions the problem was split into.
+       * \since QGIS 3.22
+       */
+      int partitionCount() const { return mPartitionCount; }
+
+      /**
+       * Returns the number of features of the largest partition of the problem.
+       * \since QGIS 3.22
+       */
+      int largestPartitionSize() const { return mLargestPartitionSize; }
+
     private:
       int nbObjects;
       int nbLabelledObjects;
@@ -100,6 +142,14 @@ namespace pal
       int *layersNbObjects; // [nbLayers]
       int *layersNbLabelledObjects; // [nbLayers]
 
+      double mCandidatesGenerationTime = 0;
+      double mObstaclesTime = 0;
+      double mConflictsTime = 0;
+      double mPartitioningTime = 0;
+      double mSolvingTime = 0;
+      int mPartitionCount = 0;
+      int mLargestPartitionSize = 0;
+
       PalStat();
 
   };
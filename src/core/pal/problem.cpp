@@ -39,9 +39,14 @@
 #include "internalexception.h"
 #include <cfloat>
 #include <limits> //for std::numeric_limits<int>::max()
+#include <atomic>
+#include <numeric>
 
 #include "qgslabelingengine.h"
 
+#include <QElapsedTimer>
+#include <QtConcurrentMap>
+
 using namespace pal;
 
 inline void delete_chain( Chain *chain )
@@ -55,7 +60,8 @@ inline void delete_chain( Chain *chain )
 }
 
 Problem::Problem( const QgsRectangle &extent )
-  : mAllCandidatesIndex( extent )
+  : mExtent( extent )
+  , mAllCandidatesIndex( extent )
   , mActiveCandidatesIndex( extent )
 {
 
@@ -279,9 +285,230 @@ void Problem::init_sol_falp()
 
 bool Problem::candidatesAreConflicting( const LabelPosition *lp1, const LabelPosition *lp2 ) const
 {
+  // partitions are solved in parallel, so they must not modify the shared conflicts cache
+  if ( mIsPartition )
+    return pal->candidatesAreConflictingNoCacheUpdate( lp1, lp2 );
+
   return  pal->candidatesAreConflicting( lp1, lp2 );
 }
 
+int Problem::componentRoot( int feature )
+{
+  int root = feature;
+  while ( mComponentParents[ root ] != root )
+    root = mComponentParents[ root ];
+
+  // compress the path, so that following lookups are direct
+  while ( mComponentParents[ feature ] != root )
+  {
+    const int parent = mComponentParents[ feature ];
+    mComponentParents[ feature ] = root;
+    feature = parent;
+  }
+
+  return root;
+}
+
+void Problem::joinComponents( int feature1, int feature2 )
+{
+  const int root1 = componentRoot( feature1 );
+  const int root2 = componentRoot( feature2 );
+  if ( root1 == root2 )
+    return;
+
+  // always keep the smallest feature as root, so that partitions don't depend on the joining order
+  if ( root1 < root2 )
+    mComponentParents[ root2 ] = root1;
+  else
+    mComponentParents[ root1 ] = root2;
+}
+
+std::vector< std::vector< int > > Problem::partitions()
+{
+  std::vector< std::vector< int > > result;
+  if ( mComponentParents.size() != mFeatureCount )
+  {
+    // no conflicts information, keep all features together
+    result.emplace_back( std::vector< int >( mFeatureCount ) );
+    std::iota( result.front().begin(), result.front().end(), 0 );
+    return result;
+  }
+
+  // collect the features of each group of connected features, ordered by their first feature
+  std::vector< std::vector< int > > components;
+  std::vector< int > componentIndex( mFeatureCount, -1 );
+  for ( int i = 0; i < static_cast< int >( mFeatureCount ); i++ )
+  {
+    const int root = componentRoot( i );
+    if ( componentIndex[ root ] < 0 )
+    {
+      componentIndex[ root ] = static_cast< int >( components.size() );
+      components.emplace_back();
+    }
+    components[ componentIndex[ root ] ].emplace_back( i );
+  }
+
+  // merge the small groups, solving many problems with a handful of features isn't worth the overhead
+  int partitionCandidates = 0;
+  for ( const std::vector< int > &component : components )
+  {
+    if ( result.empty() || partitionCandidates >= PARTITION_MIN_CANDIDATES )
+    {
+      result.emplace_back();
+      partitionCandidates = 0;
+    }
+
+    result.back().insert( result.back().end(), component.begin(), component.end() );
+    for ( int feature : component )
+      partitionCandidates += mFeatNbLp[ feature ];
+  }
+
+  for ( std::vector< int > &partition : result )
+    std::sort( partition.begin(), partition.end() );
+
+  return result;
+}
+
+std::unique_ptr< Problem > Problem::createPartition( const std::vector< int > &features )
+{
+  std::unique_ptr< Problem > partition = std::make_unique< Problem >( mExtent );
+  partition->pal = pal;
+  partition->mIsPartition = true;
+  partition->mDisplayAll = mDisplayAll;
+  std::copy( std::begin( mMapExtentBounds ), std::end( mMapExtentBounds ), std::begin( partition->mMapExtentBounds ) );
+
+  partition->mFeatureCount = features.size();
+  partition->mFeatStartId.resize( features.size() );
+  partition->mFeatNbLp.resize( features.size() );
+  partition->mInactiveCost.resize( features.size() );
+
+  int nbOverlaps = 0;
+  int lpId = 0;
+  for ( std::size_t i = 0; i < features.size(); i++ )
+  {
+    const int feature = features[i];
+    partition->mFeatStartId[i] = lpId;
+    partition->mFeatNbLp[i] = mFeatNbLp[ feature ];
+    partition->mInactiveCost[i] = mInactiveCost[ feature ];
+
+    for ( int j = 0; j < mFeatNbLp[ feature ]; j++ )
+    {
+      std::unique_ptr< LabelPosition > lp = std::move( mLabelPositions[ mFeatStartId[ feature ] + j ] );
+      lp->setProblemIds( static_cast< int >( i ), lpId++ );
+      lp->insertIntoIndex( partition->mAllCandidatesIndex );
+      nbOverlaps += lp->getNumOverlaps();
+      partition->mLabelPositions.emplace_back( std::move( lp ) );
+    }
+  }
+
+  partition->mTotalCandidates = lpId;
+  partition->mAllNblp = lpId;
+  partition->mNbOverlap = nbOverlaps / 2;
+
+  return partition;
+}
+
+void Problem::restorePartition( Problem *partition, const std::vector< int > &features )
+{
+  for ( std::size_t i = 0; i < features.size(); i++ )
+  {
+    const int feature = features[i];
+
+    // move back all the candidates, including the ones discarded by reduce()
+    for ( int j = 0; j < mFeatNbLp[ feature ]; j++ )
+    {
+      std::unique_ptr< LabelPosition > lp = std::move( partition->mLabelPositions[ partition->mFeatStartId[i] + j ] );
+      lp->setProblemIds( feature, mFeatStartId[ feature ] + j );
+      if ( j >= partition->mFeatNbLp[i] )
+        lp->removeFromIndex( mAllCandidatesIndex );
+      mLabelPositions[ mFeatStartId[ feature ] + j ] = std::move( lp );
+    }
+
+    mTotalCandidates -= mFeatNbLp[ feature ] - partition->mFeatNbLp[i];
+    mFeatNbLp[ feature ] = partition->mFeatNbLp[i];
+
+    const int labelId = partition->mSol.activeLabelIds[i];
+    if ( labelId >= 0 )
+    {
+      mSol.activeLabelIds[ feature ] = mFeatStartId[ feature ] + labelId - partition->mFeatStartId[i];
+      mLabelPositions[ mSol.activeLabelIds[ feature ] ]->insertIntoIndex( mActiveCandidatesIndex );
+    }
+    else
+    {
+      mSol.activeLabelIds[ feature ] = -1;
+    }
+  }
+
+  mSol.totalCost += partition->mSol.totalCost;
+}
+
+void Problem::solve( PalStat *stats )
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  const std::vector< std::vector< int > > problemPartitions = partitions();
+
+  if ( stats )
+  {
+    stats->mPartitionCount = static_cast< int >( problemPartitions.size() );
+    for ( const std::vector< int > &partition : problemPartitions )
+      stats->mLargestPartitionSize = std::max( stats->mLargestPartitionSize, static_cast< int >( partition.size() ) );
+  }
+
+  if ( problemPartitions.size() < 2 )
+  {
+    if ( stats )
+      stats->mPartitioningTime = timer.nsecsElapsed() / 1000000.0;
+    timer.restart();
+
+    reduce();
+    chain_search();
+
+    if ( stats )
+      stats->mSolvingTime = timer.nsecsElapsed() / 1000000.0;
+    return;
+  }
+
+  std::vector< std::unique_ptr< Problem > > partitionProblems;
+  partitionProblems.reserve( problemPartitions.size() );
+  for ( const std::vector< int > &partition : problemPartitions )
+    partitionProblems.emplace_back( createPartition( partition ) );
+
+  if ( stats )
+    stats->mPartitioningTime = timer.nsecsElapsed() / 1000000.0;
+  timer.restart();
+
+  // exceptions can't be thrown from the worker threads, so they are rethrown once all candidates are restored
+  std::atomic< bool > emptyQueue( false );
+  QtConcurrent::blockingMap( partitionProblems, [&emptyQueue]( std::unique_ptr< Problem > &partition )
+  {
+    partition->reduce();
+    try
+    {
+      partition->chain_search();
+    }
+    catch ( InternalException::Empty & )
+    {
+      emptyQueue = true;
+    }
+  } );
+
+  mSol.init( mFeatureCount );
+  mNbOverlap = 0;
+  for ( std::size_t i = 0; i < partitionProblems.size(); i++ )
+  {
+    restorePartition( partitionProblems[i].get(), problemPartitions[i] );
+    mNbOverlap += partitionProblems[i]->mNbOverlap;
+  }
+
+  if ( stats )
+    stats->mSolvingTime = timer.nsecsElapsed() / 1000000.0;
+
+  if ( emptyQueue )
+    throw InternalException::Empty();
+}
+
 inline Chain *Problem::chain( int seed )
 {
   int lid;
@@ -45,6 +45,7 @@ namespace pal
 
   class LabelPosition;
   class Label;
+  class PalStat;
   class PriorityQueue;
 
   /**
@@ -119,6 +120,19 @@ namespace pal
        */
       void chain_search();
 
+      /**
+       * Solves the problem, by reducing the candidates with reduce() and searching the best solution with chain_search().
+       *
+       * Features whose candidates can never conflict with each other are independent, so the problem is split into
+       * partitions made of groups of connected features, which are solved in parallel. The partitioning only depends
+       * on the problem itself, so the solution does not depend on the number of available threads.
+       *
+       * If \a stats is specified, it will be filled with the partitioning and solving statistics.
+       *
+       * \since QGIS 3.22
+       */
+      void solve( PalStat *stats = nullptr );
+
       /**
        * Solves the labeling problem, selecting the best candidate locations for all labels and returns a list of these
        * calculated label positions.
@@ -161,6 +175,50 @@ namespace pal
        */
       bool candidatesAreConflicting( const LabelPosition *lp1, const LabelPosition *lp2 ) const;
 
+      /**
+       * Returns the representative feature of the group of connected features containing \a feature.
+       */
+      int componentRoot( int feature );
+
+      /**
+       * Records that the candidates of \a feature1 and \a feature2 conflict, so that the two features
+       * end up in the same partition of the problem.
+       */
+      void joinComponents( int feature1, int feature2 );
+
+      /**
+       * Returns the features of each partition of the problem, in increasing feature order.
+       *
+       * Small groups of connected features are merged together, so that each partition (except the last one)
+       * has at least PARTITION_MIN_CANDIDATES candidates.
+       */
+      std::vector< std::vector< int > > partitions();
+
+      /**
+       * Creates a problem for the specified partition \a features. The candidates of these features
+       * are moved to the new problem, until they are restored with restorePartition().
+       */
+      std::unique_ptr< Problem > createPartition( const std::vector< int > &features );
+
+      /**
+       * Moves the candidates of a solved \a partition back to this problem, created from the
+       * specified \a features, and copies the partition's solution.
+       */
+      void restorePartition( Problem *partition, const std::vector< int > &features );
+
+      //! Minimum number of candidates of a problem partition
+      static constexpr int PARTITION_MIN_CANDIDATES = 1000;
+
+      /**
+       * Extent of the coordinates stored in the candidate indexes
+       */
+      QgsRectangle mExtent;
+
+      /**
+       * TRUE if the problem is a partition of a larger problem, solved in parallel with the other partitions
+       */
+      bool mIsPartition = false;
+
       /**
        * Total number of layers containing labels
        */
@@ -207,6 +265,9 @@ namespace pal
       std::vector< int > mFeatNbLp;
       std::vector< double > mInactiveCost;
 
+      //! Parent of each feature in the union-find forest of connected features
+      std::vector< int > mComponentParents;
+
       class Sol
       {
         public:
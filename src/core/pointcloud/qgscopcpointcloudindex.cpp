@@ -0,0 +1,399 @@
+/***************************************************************************
+  qgscopcpointcloudindex.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgscopcpointcloudindex.h"
+#include <QFileInfo>
+#include <QQueue>
+#include <QSet>
+#include <QPair>
+#include <QMutexLocker>
+#include <QtEndian>
+
+#include "qgseptdecoder.h"
+#include "qgslazlayereddecoder.h"
+#include "qgscoordinatereferencesystem.h"
+#include "qgspointcloudrequest.h"
+#include "qgspointcloudattribute.h"
+#include "qgslogger.h"
+#include "qgsmessagelog.h"
+#include "qgis.h"
+
+#include <cmath>
+#include <cstring>
+
+///@cond PRIVATE
+
+// sizes of the LAS 1.4 public header block, of a variable length record header and of a COPC hierarchy entry
+constexpr int LAS_HEADER_SIZE = 375;
+constexpr int LAS_VLR_HEADER_SIZE = 54;
+constexpr int COPC_HIERARCHY_ENTRY_SIZE = 32;
+
+template<typename T>
+T _readLittleEndian( const char *data )
+{
+  return qFromLittleEndian<T>( reinterpret_cast< const uchar * >( data ) );
+}
+
+static double _readDouble( const char *data )
+{
+  const quint64 bits = _readLittleEndian<quint64>( data );
+  double value;
+  memcpy( &value, &bits, sizeof( double ) );
+  return value;
+}
+
+static QString _readString( const char *data, int maxLength )
+{
+  const QByteArray bytes( data, maxLength );
+  const int end = bytes.indexOf( '\0' );
+  return QString::fromLatin1( end >= 0 ? bytes.left( end ) : bytes ).trimmed();
+}
+
+QgsCopcPointCloudIndex::QgsCopcPointCloudIndex() = default;
+
+QgsCopcPointCloudIndex::~QgsCopcPointCloudIndex()
+{
+  if ( mMappedData )
+    mFile.unmap( mMappedData );
+}
+
+void QgsCopcPointCloudIndex::load( const QString &fileName )
+{
+  mFile.setFileName( fileName );
+  if ( !mFile.open( QIODevice::ReadOnly ) )
+  {
+    QgsMessageLog::logMessage( tr( "Unable to open %1 for reading" ).arg( fileName ) );
+    mIsValid = false;
+    return;
+  }
+
+  mUri = QFileInfo( fileName ).absoluteFilePath();
+  mFileSize = static_cast< quint64 >( mFile.size() );
+
+  // map the whole file, so that the chunks of the nodes are read straight from the page cache without
+  // any locking. If mapping fails (e.g. for very large files on 32 bit platforms) the chunks are read
+  // from the file instead.
+  mMappedData = mFile.map( 0, mFile.size() );
+  if ( !mMappedData )
+    QgsDebugMsgLevel( QStringLiteral( "Could not map %1, reading chunks from the file" ).arg( fileName ), 2 );
+
+  mIsValid = loadHeader();
+}
+
+QByteArray QgsCopcPointCloudIndex::readRange( quint64 offset, quint64 size ) const
+{
+  if ( offset >= mFileSize )
+    return QByteArray();
+  size = std::min( size, mFileSize - offset );
+
+  if ( mMappedData )
+    return QByteArray::fromRawData( reinterpret_cast< const char * >( mMappedData + offset ), static_cast< int >( size ) );
+
+  QMutexLocker locker( &mFileMutex );
+  if ( !mFile.seek( static_cast< qint64 >( offset ) ) )
+    return QByteArray();
+  return mFile.read( static_cast< qint64 >( size ) );
+}
+
+bool QgsCopcPointCloudIndex::loadHeader()
+{
+  const QByteArray header = readRange( 0, LAS_HEADER_SIZE );
+  // LAS 1.4 is required by COPC
+  if ( header.size() < LAS_HEADER_SIZE || !header.startsWith( "LASF" ) )
+  {
+    QgsMessageLog::logMessage( tr( "%1 is not a LAS 1.4 file" ).arg( mUri ) );
+    return false;
+  }
+  const char *h = header.constData();
+
+  const int versionMajor = static_cast< uchar >( h[24] );
+  const int versionMinor = static_cast< uchar >( h[25] );
+  const quint16 headerSize = _readLittleEndian<quint16>( h + 94 );
+  const quint32 vlrCount = _readLittleEndian<quint32>( h + 100 );
+  // the two high bits of the point format flag compressed data
+  mPointFormat = static_cast< uchar >( h[104] ) & 0x3f;
+  mPointRecordLength = _readLittleEndian<quint16>( h + 105 );
+  // COPC requires the point formats 6 to 8, the formats of LAS 1.2 are accepted too
+  if ( mPointFormat > 3 && !QgsLazLayeredDecoder::supportsPointFormat( mPointFormat ) )
+  {
+    QgsMessageLog::logMessage( tr( "%1 uses point format %2, which is not supported" ).arg( mUri ).arg( mPointFormat ) );
+    return false;
+  }
+  mPointCount = static_cast< qint64 >( _readLittleEndian<quint64>( h + 247 ) );
+  if ( mPointCount == 0 )
+    mPointCount = _readLittleEndian<quint32>( h + 107 );
+
+  mScale = QgsVector3D( _readDouble( h + 131 ), _readDouble( h + 139 ), _readDouble( h + 147 ) );
+  mOffset = QgsVector3D( _readDouble( h + 155 ), _readDouble( h + 163 ), _readDouble( h + 171 ) );
+  if ( qgsDoubleNear( mScale.x(), 0 ) || qgsDoubleNear( mScale.y(), 0 ) || qgsDoubleNear( mScale.z(), 0 ) )
+    return false;
+
+  const double xMax = _readDouble( h + 179 );
+  const double xMin = _readDouble( h + 187 );
+  const double yMax = _readDouble( h + 195 );
+  const double yMin = _readDouble( h + 203 );
+  mZMax = _readDouble( h + 211 );
+  mZMin = _readDouble( h + 219 );
+  mExtent.set( xMin, yMin, xMax, yMax );
+
+  // variable length records: the COPC info record and the WKT of the CRS
+  bool copcInfoFound = false;
+  double centerX = 0;
+  double centerY = 0;
+  double centerZ = 0;
+  double halfSize = 0;
+  double spacing = 0;
+  quint64 rootHierarchyOffset = 0;
+  quint64 rootHierarchySize = 0;
+
+  quint64 position = headerSize;
+  for ( quint32 i = 0; i < vlrCount; ++i )
+  {
+    const QByteArray vlrHeader = readRange( position, LAS_VLR_HEADER_SIZE );
+    if ( vlrHeader.size() < LAS_VLR_HEADER_SIZE )
+      return false;
+
+    const QString userId = _readString( vlrHeader.constData() + 2, 16 );
+    const quint16 recordId = _readLittleEndian<quint16>( vlrHeader.constData() + 18 );
+    const quint16 recordLength = _readLittleEndian<quint16>( vlrHeader.constData() + 20 );
+    const QByteArray record = readRange( position + LAS_VLR_HEADER_SIZE, recordLength );
+
+    if ( userId == QLatin1String( "copc" ) && recordId == 1 && record.size() >= 56 )
+    {
+      const char *r = record.constData();
+      centerX = _readDouble( r );
+      centerY = _readDouble( r + 8 );
+      centerZ = _readDouble( r + 16 );
+      halfSize = _readDouble( r + 24 );
+      spacing = _readDouble( r + 32 );
+      rootHierarchyOffset = _readLittleEndian<quint64>( r + 40 );
+      rootHierarchySize = _readLittleEndian<quint64>( r + 48 );
+      copcInfoFound = true;
+    }
+    else if ( userId == QLatin1String( "LASF_Projection" ) && recordId == 2112 )
+    {
+      mWkt = _readString( record.constData(), record.size() );
+    }
+
+    position += LAS_VLR_HEADER_SIZE + recordLength;
+  }
+
+  if ( !copcInfoFound || halfSize <= 0 || spacing <= 0 )
+  {
+    QgsMessageLog::logMessage( tr( "%1 is not a COPC file" ).arg( mUri ) );
+    return false;
+  }
+
+  QgsPointCloudAttributeCollection attributes;
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "X" ), QgsPointCloudAttribute::Int32 ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Y" ), QgsPointCloudAttribute::Int32 ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Z" ), QgsPointCloudAttribute::Int32 ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Intensity" ), QgsPointCloudAttribute::UShort ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "ReturnNumber" ), QgsPointCloudAttribute::Char ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "NumberOfReturns" ), QgsPointCloudAttribute::Char ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "ScanDirectionFlag" ), QgsPointCloudAttribute::Char ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "EdgeOfFlightLine" ), QgsPointCloudAttribute::Char ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Classification" ), QgsPointCloudAttribute::Char ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "ScanAngleRank" ), QgsPointCloudAttribute::Float ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "UserData" ), QgsPointCloudAttribute::Char ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "PointSourceId" ), QgsPointCloudAttribute::UShort ) );
+  if ( mPointFormat == 2 || mPointFormat == 3 || mPointFormat == 7 || mPointFormat == 8 )
+  {
+    attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Red" ), QgsPointCloudAttribute::UShort ) );
+    attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Green" ), QgsPointCloudAttribute::UShort ) );
+    attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Blue" ), QgsPointCloudAttribute::UShort ) );
+  }
+  if ( mPointFormat == 8 )
+    attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Infrared" ), QgsPointCloudAttribute::UShort ) );
+  setAttributes( attributes );
+
+  // the octree is a cube centered on the COPC center
+  mRootBounds = QgsPointCloudDataBounds(
+                  ( centerX - halfSize - mOffset.x() ) / mScale.x(),
+                  ( centerY - halfSize - mOffset.y() ) / mScale.y(),
+                  ( centerZ - halfSize - mOffset.z() ) / mScale.z(),
+                  ( centerX + halfSize - mOffset.x() ) / mScale.x(),
+                  ( centerY + halfSize - mOffset.y() ) / mScale.y(),
+                  ( centerZ + halfSize - mOffset.z() ) / mScale.z()
+                );
+  mSpan = std::max( 1, static_cast< int >( std::round( 2 * halfSize / spacing ) ) );
+
+  mOriginalMetadata.insert( QStringLiteral( "major_version" ), versionMajor );
+  mOriginalMetadata.insert( QStringLiteral( "minor_version" ), versionMinor );
+  mOriginalMetadata.insert( QStringLiteral( "system_id" ), _readString( h + 26, 32 ) );
+  mOriginalMetadata.insert( QStringLiteral( "software_id" ), _readString( h + 58, 32 ) );
+  mOriginalMetadata.insert( QStringLiteral( "creation_doy" ), _readLittleEndian<quint16>( h + 90 ) );
+  mOriginalMetadata.insert( QStringLiteral( "creation_year" ), _readLittleEndian<quint16>( h + 92 ) );
+  mOriginalMetadata.insert( QStringLiteral( "dataformat_id" ), mPointFormat );
+  mOriginalMetadata.insert( QStringLiteral( "count" ), mPointCount );
+
+  return loadHierarchy( rootHierarchyOffset, rootHierarchySize );
+}
+
+bool QgsCopcPointCloudIndex::loadHierarchy( quint64 rootOffset, quint64 rootSize )
+{
+  // the whole hierarchy is read upfront: pages are small and stored next to each other,
+  // so this costs far less than a node data read
+  QQueue< QPair< quint64, quint64 > > pages;
+  pages.enqueue( qMakePair( rootOffset, rootSize ) );
+  // offsets of the pages already read, so that a malformed file with pages referring to each other can't loop forever
+  QSet< quint64 > visitedPages;
+  while ( !pages.isEmpty() )
+  {
+    const QPair< quint64, quint64 > page = pages.dequeue();
+    if ( visitedPages.contains( page.first ) )
+    {
+      QgsDebugMsgLevel( QStringLiteral( "hierarchy page at %1 is referenced more than once" ).arg( page.first ), 2 );
+      continue;
+    }
+    visitedPages.insert( page.first );
+
+    const QByteArray pageData = readRange( page.first, page.second );
+    if ( static_cast< quint64 >( pageData.size() ) != page.second )
+    {
+      QgsDebugMsgLevel( QStringLiteral( "unable to read hierarchy page at %1" ).arg( page.first ), 2 );
+      return false;
+    }
+
+    for ( int entry = 0; entry + COPC_HIERARCHY_ENTRY_SIZE <= pageData.size(); entry += COPC_HIERARCHY_ENTRY_SIZE )
+    {
+      const char *e = pageData.constData() + entry;
+      const IndexedPointCloudNode node( _readLittleEndian<qint32>( e ),
+                                        _readLittleEndian<qint32>( e + 4 ),
+                                        _readLittleEndian<qint32>( e + 8 ),
+                                        _readLittleEndian<qint32>( e + 12 ) );
+      const quint64 offset = _readLittleEndian<quint64>( e + 16 );
+      const qint32 byteSize = _readLittleEndian<qint32>( e + 24 );
+      const qint32 pointCount = _readLittleEndian<qint32>( e + 28 );
+
+      if ( pointCount == -1 )
+      {
+        // the entry refers to a child hierarchy page, which holds the entry of the node itself
+        pages.enqueue( qMakePair( offset, static_cast< quint64 >( byteSize ) ) );
+        continue;
+      }
+
+      mHierarchy[node] = pointCount;
+      if ( pointCount > 0 && byteSize > 0 )
+      {
+        Chunk chunk;
+        chunk.offset = offset;
+        chunk.byteSize = byteSize;
+        chunk.pointCount = pointCount;
+        mChunks.insert( node, chunk );
+      }
+    }
+  }
+
+  return !mHierarchy.isEmpty();
+}
+
+QgsPointCloudBlock *QgsCopcPointCloudIndex::nodeData( const IndexedPointCloudNode &n, const QgsPointCloudRequest &request )
+{
+  if ( QgsPointCloudBlock *cached = getNodeDataFromCache( n, request ) )
+  {
+    return cached;
+  }
+
+  // mChunks is only written when the index is loaded, so it can be read without locking
+  const auto it = mChunks.constFind( n );
+  if ( it == mChunks.constEnd() )
+    return nullptr;
+
+  const QByteArray chunkData = readRange( it->offset, static_cast< quint64 >( it->byteSize ) );
+  if ( chunkData.size() != it->byteSize )
+    return nullptr;
+
+  QgsPointCloudBlock *block = QgsEptDecoder::decompressLazChunk( chunkData.constData(), chunkData.size(), mPointFormat, mPointRecordLength, it->pointCount,
+                              request.attributes(), scale(), offset() );
+
+  storeNodeDataToCache( block, n, request );
+  return block;
+}
+
+QgsPointCloudBlockRequest *QgsCopcPointCloudIndex::asyncNodeData( const IndexedPointCloudNode &n, const QgsPointCloudRequest &request )
+{
+  Q_UNUSED( n );
+  Q_UNUSED( request );
+  Q_ASSERT( false );
+  return nullptr; // unsupported
+}
+
+QgsCoordinateReferenceSystem QgsCopcPointCloudIndex::crs() const
+{
+  return QgsCoordinateReferenceSystem::fromWkt( mWkt );
+}
+
+qint64 QgsCopcPointCloudIndex::pointCount() const
+{
+  return mPointCount;
+}
+
+QVariant QgsCopcPointCloudIndex::metadataStatistic( const QString &attribute, QgsStatisticalSummary::Statistic statistic ) const
+{
+  // only the bounds of the coordinates are stored in the LAS header
+  double minimum = 0;
+  double maximum = 0;
+  if ( attribute == QLatin1String( "X" ) )
+  {
+    minimum = mExtent.xMinimum();
+    maximum = mExtent.xMaximum();
+  }
+  else if ( attribute == QLatin1String( "Y" ) )
+  {
+    minimum = mExtent.yMinimum();
+    maximum = mExtent.yMaximum();
+  }
+  else if ( attribute == QLatin1String( "Z" ) )
+  {
+    minimum = mZMin;
+    maximum = mZMax;
+  }
+  else
+  {
+    return QVariant();
+  }
+
+  if ( statistic == QgsStatisticalSummary::Count )
+    return mPointCount;
+  else if ( statistic == QgsStatisticalSummary::Min )
+    return minimum;
+  else if ( statistic == QgsStatisticalSummary::Max )
+    return maximum;
+  else if ( statistic == QgsStatisticalSummary::Range )
+    return maximum - minimum;
+  return QVariant();
+}
+
+QVariantList QgsCopcPointCloudIndex::metadataClasses( const QString &attribute ) const
+{
+  Q_UNUSED( attribute );
+  return QVariantList();
+}
+
+QVariant QgsCopcPointCloudIndex::metadataClassStatistic( const QString &attribute, const QVariant &value, QgsStatisticalSummary::Statistic statistic ) const
+{
+  Q_UNUSED( attribute );
+  Q_UNUSED( value );
+  Q_UNUSED( statistic );
+  return QVariant();
+}
+
+bool QgsCopcPointCloudIndex::isValid() const
+{
+  return mIsValid;
+}
+
+///@endcond
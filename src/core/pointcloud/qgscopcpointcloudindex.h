@@ -0,0 +1,102 @@
+/***************************************************************************
+  qgscopcpointcloudindex.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSCOPCPOINTCLOUDINDEX_H
+#define QGSCOPCPOINTCLOUDINDEX_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QFile>
+#include <QMutex>
+
+#include "qgspointcloudindex.h"
+#include "qgspointcloudattribute.h"
+#include "qgsstatisticalsummary.h"
+#include "qgis_sip.h"
+
+///@cond PRIVATE
+#define SIP_NO_FILE
+
+class QgsCoordinateReferenceSystem;
+
+/**
+ * Point cloud index for a local Cloud Optimized Point Cloud (COPC) file.
+ *
+ * A COPC file is a single LAZ file whose point chunks are ordered as the nodes of an octree,
+ * described by a hierarchy stored in the same file. Only the header and the hierarchy are read
+ * when the index is loaded, the points of a node are read from the byte range of its chunk
+ * when they are requested.
+ */
+class CORE_EXPORT QgsCopcPointCloudIndex: public QgsPointCloudIndex
+{
+    Q_OBJECT
+  public:
+
+    explicit QgsCopcPointCloudIndex();
+    ~QgsCopcPointCloudIndex();
+
+    void load( const QString &fileName ) override;
+
+    QgsPointCloudBlock *nodeData( const IndexedPointCloudNode &n, const QgsPointCloudRequest &request ) override;
+    QgsPointCloudBlockRequest *asyncNodeData( const IndexedPointCloudNode &n, const QgsPointCloudRequest &request ) override;
+
+    QgsCoordinateReferenceSystem crs() const override;
+    qint64 pointCount() const override;
+    QVariant metadataStatistic( const QString &attribute, QgsStatisticalSummary::Statistic statistic ) const override;
+    QVariantList metadataClasses( const QString &attribute ) const override;
+    QVariant metadataClassStatistic( const QString &attribute, const QVariant &value, QgsStatisticalSummary::Statistic statistic ) const override;
+    QVariantMap originalMetadata() const override { return mOriginalMetadata; }
+
+    bool isValid() const override;
+    QgsPointCloudIndex::AccessType accessType() const override { return QgsPointCloudIndex::Local; };
+
+  private:
+
+    //! Location of the compressed points of a node in the file
+    struct Chunk
+    {
+      quint64 offset = 0;
+      qint32 byteSize = 0;
+      qint32 pointCount = 0;
+    };
+
+    bool loadHeader();
+    bool loadHierarchy( quint64 rootOffset, quint64 rootSize );
+
+    /**
+     * Returns the \a size bytes of the file starting at \a offset. When the file is mapped
+     * in memory the returned array references the mapped data without copying it.
+     */
+    QByteArray readRange( quint64 offset, quint64 size ) const;
+
+    mutable QFile mFile;
+    mutable QMutex mFileMutex;
+    uchar *mMappedData = nullptr;
+    quint64 mFileSize = 0;
+
+    bool mIsValid = false;
+    QString mWkt;
+    qint64 mPointCount = 0;
+    int mPointFormat = -1;
+    int mPointRecordLength = 0;
+
+    QHash< IndexedPointCloudNode, Chunk > mChunks;
+
+    QVariantMap mOriginalMetadata;
+};
+
+///@endcond
+#endif // QGSCOPCPOINTCLOUDINDEX_H
@@ -17,6 +17,7 @@
 
 #include "qgseptdecoder.h"
 #include "qgseptpointcloudindex.h"
+#include "qgslazlayereddecoder.h"
 #include "qgspointcloudattribute.h"
 #include "qgsvector3d.h"
 #include "qgsconfig.h"
@@ -28,10 +29,12 @@
 #include <memory>
 #include <cstring>
 #include <QTemporaryFile>
+#include <QtEndian>
 
 #include <zstd.h>
 
 #include "laz-perf/io.hpp"
+#include "laz-perf/streams.hpp"
 #include "laz-perf/common/common.hpp"
 
 ///@cond PRIVATE
@@ -268,27 +271,21 @@ QgsPointCloudBlock *QgsEptDecoder::decompressZStandard( const QByteArray &data,
 
 /* *************************************************************************************** */
 
-template<typename FileType>
-QgsPointCloudBlock *__decompressLaz( FileType &file, const QgsPointCloudAttributeCollection &attributes, const QgsPointCloudAttributeCollection &requestedAttributes, const QgsVector3D &_scale, const QgsVector3D &_offset )
+//! Layout of the point records returned by the LAZ decoders
+struct LazRecordLayout
 {
-  Q_UNUSED( attributes );
-  Q_UNUSED( _scale );
-  Q_UNUSED( _offset );
-
-  if ( ! file.good() )
-    return nullptr;
-
-#ifdef QGISDEBUG
-  auto start = common::tick();
-#endif
-
-  laszip::io::reader::basic_file<FileType> f( file );
-
-  const size_t count = f.get_header().point_count;
-  QgsVector3D scale( f.get_header().scale.x, f.get_header().scale.y, f.get_header().scale.z );
-  QgsVector3D offset( f.get_header().offset.x, f.get_header().offset.y, f.get_header().offset.z );
-
-  QByteArray bufArray( f.get_header().point_record_length, 0 );
+  //! TRUE for the records of the LAS 1.4 point formats 6 to 10, FALSE for the records of the formats 0 to 5
+  bool las14 = false;
+  //! Offset of the red, green and blue values in the record, -1 if the record has no colors
+  int rgbOffset = -1;
+  //! Offset of the near infrared value in the record, -1 if the record has no near infrared value
+  int nirOffset = -1;
+};
+
+template<typename PointReader>
+QgsPointCloudBlock *__decodeLazPoints( PointReader readPoint, std::size_t count, std::size_t pointRecordLength, const LazRecordLayout &layout, const QgsPointCloudAttributeCollection &requestedAttributes, const QgsVector3D &scale, const QgsVector3D &offset )
+{
+  QByteArray bufArray( static_cast< int >( pointRecordLength ), 0 );
   char *buf = bufArray.data();
 
   const size_t requestedPointRecordSize = requestedAttributes.pointRecordSize();
@@ -317,6 +314,7 @@ QgsPointCloudBlock *__decompressLaz( FileType &file, const QgsPointCloudAttribut
     Red,
     Green,
     Blue,
+    Infrared,
     MissingOrUnknown
   };
 
@@ -397,6 +395,10 @@ QgsPointCloudBlock *__decompressLaz( FileType &file, const QgsPointCloudAttribut
     {
       requestedAttributeDetails.emplace_back( RequestedAttributeDetails( LazAttribute::Blue, requestedAttribute.type(), requestedAttribute.size() ) );
     }
+    else if ( requestedAttribute.name().compare( QLatin1String( "Infrared" ), Qt::CaseInsensitive ) == 0 )
+    {
+      requestedAttributeDetails.emplace_back( RequestedAttributeDetails( LazAttribute::Infrared, requestedAttribute.type(), requestedAttribute.size() ) );
+    }
     else
     {
       // this can possibly happen -- e.g. if a style built using a different point cloud format references an attribute which isn't available from the laz file
@@ -406,9 +408,42 @@ QgsPointCloudBlock *__decompressLaz( FileType &file, const QgsPointCloudAttribut
 
   for ( size_t i = 0 ; i < count ; i ++ )
   {
-    f.readPoint( buf ); // read the point out
+    readPoint( buf ); // read the point out
     laszip::formats::las::point10 p = laszip::formats::packers<laszip::formats::las::point10>::unpack( buf );
-    laszip::formats::las::rgb rgb = laszip::formats::packers<laszip::formats::las::rgb>::unpack( buf + sizeof( laszip::formats::las::point10 ) + sizeof( laszip::formats::las::gpstime ) );
+    // the fields of the LAS 1.4 point formats which are wider than in the point10 layout
+    unsigned char returnNumber = p.return_number;
+    unsigned char numberOfReturns = p.number_of_returns_of_given_pulse;
+    unsigned char scanDirectionFlag = p.scan_direction_flag;
+    unsigned char edgeOfFlightLine = p.edge_of_flight_line;
+    unsigned char classification = p.classification;
+    double scanAngle = p.scan_angle_rank;
+    unsigned char userData = p.user_data;
+    unsigned short pointSourceId = p.point_source_ID;
+    if ( layout.las14 )
+    {
+      const unsigned char *record = reinterpret_cast< const unsigned char * >( buf );
+      returnNumber = record[14] & 0x0f;
+      numberOfReturns = ( record[14] >> 4 ) & 0x0f;
+      scanDirectionFlag = ( record[15] >> 6 ) & 0x01;
+      edgeOfFlightLine = ( record[15] >> 7 ) & 0x01;
+      classification = record[16];
+      userData = record[17];
+      qint16 scanAngleValue;
+      memcpy( &scanAngleValue, buf + 18, sizeof( qint16 ) );
+      // stored in steps of 0.006 degrees
+      scanAngle = qFromLittleEndian( scanAngleValue ) * 0.006;
+      memcpy( &pointSourceId, buf + 20, sizeof( unsigned short ) );
+      pointSourceId = qFromLittleEndian( pointSourceId );
+    }
+    laszip::formats::las::rgb rgb;
+    if ( layout.rgbOffset >= 0 )
+      rgb = laszip::formats::packers<laszip::formats::las::rgb>::unpack( buf + layout.rgbOffset );
+    unsigned short nir = 0;
+    if ( layout.nirOffset >= 0 )
+    {
+      memcpy( &nir, buf + layout.nirOffset, sizeof( unsigned short ) );
+      nir = qFromLittleEndian( nir );
+    }
 
     for ( const RequestedAttributeDetails &requestedAttribute : requestedAttributeDetails )
     {
@@ -424,31 +459,31 @@ QgsPointCloudBlock *__decompressLaz( FileType &file, const QgsPointCloudAttribut
           _storeToStream<qint32>( dataBuffer, outputOffset, requestedAttribute.type, p.z );
           break;
         case LazAttribute::Classification:
-          _storeToStream<unsigned char>( dataBuffer, outputOffset, requestedAttribute.type, p.classification );
+          _storeToStream<unsigned char>( dataBuffer, outputOffset, requestedAttribute.type, classification );
           break;
         case LazAttribute::Intensity:
           _storeToStream<unsigned short>( dataBuffer, outputOffset, requestedAttribute.type, p.intensity );
           break;
         case LazAttribute::ReturnNumber:
-          _storeToStream<unsigned char>( dataBuffer,  outputOffset, requestedAttribute.type, p.return_number );
+          _storeToStream<unsigned char>( dataBuffer,  outputOffset, requestedAttribute.type, returnNumber );
           break;
         case LazAttribute::NumberOfReturns:
-          _storeToStream<unsigned char>( dataBuffer,  outputOffset, requestedAttribute.type, p.number_of_returns_of_given_pulse );
+          _storeToStream<unsigned char>( dataBuffer,  outputOffset, requestedAttribute.type, numberOfReturns );
           break;
         case LazAttribute::ScanDirectionFlag:
-          _storeToStream<unsigned char>( dataBuffer, outputOffset, requestedAttribute.type, p.scan_direction_flag );
+          _storeToStream<unsigned char>( dataBuffer, outputOffset, requestedAttribute.type, scanDirectionFlag );
           break;
         case LazAttribute::EdgeOfFlightLine:
-          _storeToStream<unsigned char>( dataBuffer, outputOffset, requestedAttribute.type, p.edge_of_flight_line );
+          _storeToStream<unsigned char>( dataBuffer, outputOffset, requestedAttribute.type, edgeOfFlightLine );
           break;
         case LazAttribute::ScanAngleRank:
-          _storeToStream<char>( dataBuffer, outputOffset, requestedAttribute.type, p.scan_angle_rank );
+          _storeToStream<double>( dataBuffer, outputOffset, requestedAttribute.type, scanAngle );
           break;
         case LazAttribute::UserData:
-          _storeToStream<unsigned char>( dataBuffer, outputOffset, requestedAttribute.type, p.user_data );
+          _storeToStream<unsigned char>( dataBuffer, outputOffset, requestedAttribute.type, userData );
           break;
         case LazAttribute::PointSourceId:
-          _storeToStream<unsigned short>( dataBuffer, outputOffset, requestedAttribute.type, p.point_source_ID );
+          _storeToStream<unsigned short>( dataBuffer, outputOffset, requestedAttribute.type, pointSourceId );
           break;
         case LazAttribute::Red:
           _storeToStream<unsigned short>( dataBuffer, outputOffset, requestedAttribute.type, rgb.r );
@@ -459,6 +494,9 @@ QgsPointCloudBlock *__decompressLaz( FileType &file, const QgsPointCloudAttribut
         case LazAttribute::Blue:
           _storeToStream<unsigned short>( dataBuffer, outputOffset, requestedAttribute.type, rgb.b );
           break;
+        case LazAttribute::Infrared:
+          _storeToStream<unsigned short>( dataBuffer, outputOffset, requestedAttribute.type, nir );
+          break;
         case LazAttribute::MissingOrUnknown:
           // just store 0 for unknown/missing attributes
           _storeToStream<unsigned short>( dataBuffer, outputOffset, requestedAttribute.type, 0 );
@@ -469,15 +507,43 @@ QgsPointCloudBlock *__decompressLaz( FileType &file, const QgsPointCloudAttribut
     }
   }
 
+  return new QgsPointCloudBlock(
+           count,
+           requestedAttributes,
+           data, scale, offset
+         );
+}
+
+template<typename FileType>
+QgsPointCloudBlock *__decompressLaz( FileType &file, const QgsPointCloudAttributeCollection &attributes, const QgsPointCloudAttributeCollection &requestedAttributes, const QgsVector3D &_scale, const QgsVector3D &_offset )
+{
+  Q_UNUSED( attributes );
+  Q_UNUSED( _scale );
+  Q_UNUSED( _offset );
+
+  if ( ! file.good() )
+    return nullptr;
+
+#ifdef QGISDEBUG
+  auto start = common::tick();
+#endif
+
+  laszip::io::reader::basic_file<FileType> f( file );
+
+  const size_t count = f.get_header().point_count;
+  QgsVector3D scale( f.get_header().scale.x, f.get_header().scale.y, f.get_header().scale.z );
+  QgsVector3D offset( f.get_header().offset.x, f.get_header().offset.y, f.get_header().offset.z );
+
+  // EPT LAZ data is expected to use point format 3, with the RGB values following the GPS time
+  LazRecordLayout layout;
+  layout.rgbOffset = sizeof( laszip::formats::las::point10 ) + sizeof( laszip::formats::las::gpstime );
+  QgsPointCloudBlock *block = __decodeLazPoints( [&f]( char *buf ) { f.readPoint( buf ); }, count, f.get_header().point_record_length,
+                              layout, requestedAttributes, scale, offset );
+
 #ifdef QGISDEBUG
   float t = common::since( start );
   QgsDebugMsgLevel( QStringLiteral( "LAZ-PERF Read through the points in %1 seconds." ).arg( t ), 2 );
 #endif
-  QgsPointCloudBlock *block = new QgsPointCloudBlock(
-    count,
-    requestedAttributes,
-    data, scale, offset
-  );
   return block;
 }
 
@@ -501,4 +567,82 @@ QgsPointCloudBlock *QgsEptDecoder::decompressLaz( const QByteArray &byteArrayDat
   return __decompressLaz<std::istringstream>( file, attributes, requestedAttributes, scale, offset );
 }
 
+QgsPointCloudBlock *QgsEptDecoder::decompressLazChunk( const char *data, std::size_t size, int pointFormat, int pointRecordLength, int pointCount,
+    const QgsPointCloudAttributeCollection &requestedAttributes,
+    const QgsVector3D &scale, const QgsVector3D &offset )
+{
+  using namespace laszip::factory;
+
+  if ( QgsLazLayeredDecoder::supportsPointFormat( pointFormat ) )
+  {
+    // the LAS 1.4 point formats use the layered compression, which the bundled laz-perf doesn't support
+    LazRecordLayout layout;
+    layout.las14 = true;
+    // the 30 bytes of the point fields are followed by the GPS time, the RGB values and the near infrared value
+    if ( pointFormat == 7 || pointFormat == 8 )
+      layout.rgbOffset = 30;
+    if ( pointFormat == 8 )
+      layout.nirOffset = 36;
+
+    try
+    {
+      QgsLazLayeredDecoder decoder( data, size, pointFormat, pointRecordLength );
+      return __decodeLazPoints( [&decoder]( char *buf ) { decoder.readPoint( buf ); }, pointCount, pointRecordLength, layout,
+                                requestedAttributes, scale, offset );
+    }
+    catch ( std::exception &e )
+    {
+      QgsDebugMsg( QStringLiteral( "Error decompressing LAZ chunk: %1" ).arg( e.what() ) );
+      return nullptr;
+    }
+  }
+
+  // the point formats of LAS 1.2 use the pointwise compression of laz-perf
+  record_schema schema;
+  schema( record_item::point() );
+  LazRecordLayout layout;
+  switch ( pointFormat )
+  {
+    case 0:
+      break;
+    case 1:
+      schema( record_item::gpstime() );
+      break;
+    case 2:
+      layout.rgbOffset = record_item::point().size;
+      schema( record_item::rgb() );
+      break;
+    case 3:
+      layout.rgbOffset = record_item::point().size + record_item::gpstime().size;
+      schema( record_item::gpstime() )( record_item::rgb() );
+      break;
+    default:
+      QgsDebugMsg( QStringLiteral( "Unsupported LAZ point format %1" ).arg( pointFormat ) );
+      return nullptr;
+  }
+  const int extraBytes = pointRecordLength - schema.size_in_bytes();
+  if ( extraBytes < 0 )
+    return nullptr;
+  if ( extraBytes > 0 )
+    schema( record_item::eb( extraBytes ) );
+
+  try
+  {
+    // chunks are compressed independently, so the decoder can start at the first byte of the chunk
+    typedef laszip::io::__ifstream_wrapper< laszip::streams::memory_stream > StreamWrapper;
+    laszip::streams::memory_stream stream( data, static_cast< std::streamsize >( size ) );
+    StreamWrapper wrapper( stream );
+    laszip::decoders::arithmetic< StreamWrapper > decoder( wrapper );
+    laszip::formats::dynamic_decompressor::ptr decompressor = build_decompressor( decoder, schema );
+
+    return __decodeLazPoints( [&decompressor]( char *buf ) { decompressor->decompress( buf ); }, pointCount, pointRecordLength, layout,
+                              requestedAttributes, scale, offset );
+  }
+  catch ( std::exception &e )
+  {
+    QgsDebugMsg( QStringLiteral( "Error decompressing LAZ chunk: %1" ).arg( e.what() ) );
+    return nullptr;
+  }
+}
+
 ///@endcond
@@ -28,6 +28,7 @@
 #define SIP_NO_FILE
 
 #include <QString>
+#include <cstddef>
 
 namespace QgsEptDecoder
 {
@@ -37,6 +38,15 @@ namespace QgsEptDecoder
   QgsPointCloudBlock *decompressZStandard( const QByteArray &data, const QgsPointCloudAttributeCollection &attributes, const QgsPointCloudAttributeCollection &requestedAttributes, const QgsVector3D &scale, const QgsVector3D &offset );
   QgsPointCloudBlock *decompressLaz( const QString &filename, const QgsPointCloudAttributeCollection &attributes, const QgsPointCloudAttributeCollection &requestedAttributes, const QgsVector3D &scale, const QgsVector3D &offset );
   QgsPointCloudBlock *decompressLaz( const QByteArray &data, const QgsPointCloudAttributeCollection &attributes, const QgsPointCloudAttributeCollection &requestedAttributes, const QgsVector3D &scale, const QgsVector3D &offset );
+
+  /**
+   * Decompresses a single chunk of \a pointCount points of a LAZ file, stored in the \a size bytes from \a data.
+   *
+   * The \a pointFormat and \a pointRecordLength arguments must match the LAS header of the file. The point formats 0 to 3
+   * (pointwise compression) and 6 to 8 (layered compression) are supported.
+   * Returns nullptr if the point format is not supported or the chunk could not be decompressed.
+   */
+  QgsPointCloudBlock *decompressLazChunk( const char *data, std::size_t size, int pointFormat, int pointRecordLength, int pointCount, const QgsPointCloudAttributeCollection &requestedAttributes, const QgsVector3D &scale, const QgsVector3D &offset );
 };
 
 ///@endcond
@@ -55,6 +55,7 @@ void QgsEptPointCloudIndex::load( const QString &fileName )
 
   const QDir directory = QFileInfo( fileName ).absoluteDir();
   mDirectory = directory.absolutePath();
+  mUri = QFileInfo( fileName ).absoluteFilePath();
 
   const QByteArray dataJson = f.readAll();
   bool success = loadSchema( dataJson );
@@ -273,31 +274,40 @@ bool QgsEptPointCloudIndex::loadSchema( const QByteArray &dataJson )
 
 QgsPointCloudBlock *QgsEptPointCloudIndex::nodeData( const IndexedPointCloudNode &n, const QgsPointCloudRequest &request )
 {
+  if ( QgsPointCloudBlock *cached = getNodeDataFromCache( n, request ) )
+  {
+    return cached;
+  }
+
   mHierarchyMutex.lock();
   bool found = mHierarchy.contains( n );
   mHierarchyMutex.unlock();
   if ( !found )
     return nullptr;
 
+  QgsPointCloudBlock *block = nullptr;
   if ( mDataType == QLatin1String( "binary" ) )
   {
     QString filename = QStringLiteral( "%1/ept-data/%2.bin" ).arg( mDirectory, n.toString() );
-    return QgsEptDecoder::decompressBinary( filename, attributes(), request.attributes(), scale(), offset() );
+    block = QgsEptDecoder::decompressBinary( filename, attributes(), request.attributes(), scale(), offset() );
   }
   else if ( mDataType == QLatin1String( "zstandard" ) )
   {
     QString filename = QStringLiteral( "%1/ept-data/%2.zst" ).arg( mDirectory, n.toString() );
-    return QgsEptDecoder::decompressZStandard( filename, attributes(), request.attributes(), scale(), offset() );
+    block = QgsEptDecoder::decompressZStandard( filename, attributes(), request.attributes(), scale(), offset() );
   }
   else if ( mDataType == QLatin1String( "laszip" ) )
   {
     QString filename = QStringLiteral( "%1/ept-data/%2.laz" ).arg( mDirectory, n.toString() );
-    return QgsEptDecoder::decompressLaz( filename, attributes(), request.attributes(), scale(), offset() );
+    block = QgsEptDecoder::decompressLaz( filename, attributes(), request.attributes(), scale(), offset() );
   }
   else
   {
     return nullptr;  // unsupported
   }
+
+  storeNodeDataToCache( block, n, request );
+  return block;
 }
 
 QgsPointCloudBlockRequest *QgsEptPointCloudIndex::asyncNodeData( const IndexedPointCloudNode &n, const QgsPointCloudRequest &request )
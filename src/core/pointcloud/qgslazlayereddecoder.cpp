@@ -0,0 +1,832 @@
+/***************************************************************************
+  qgslazlayereddecoder.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgslazlayereddecoder.h"
+
+#include "laz-perf/common/types.hpp"
+#include "laz-perf/model.hpp"
+#include "laz-perf/decoder.hpp"
+#include "laz-perf/decompressor.hpp"
+#include "laz-perf/util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+///@cond PRIVATE
+
+// The layered compression is the one of the version 3 of the LASzip items POINT14, RGB14, RGBNIR14 and BYTE14,
+// decoded with the entropy models, arithmetic decoder and integer decompressor of laz-perf
+
+typedef laszip::models::arithmetic SymbolModel;
+typedef laszip::decompressors::integer IntegerDecompressor;
+typedef laszip::utils::streaming_median< int32_t > Median;
+
+// sizes of the items of a point record
+constexpr int POINT14_SIZE = 30;
+constexpr int RGB14_SIZE = 6;
+constexpr int RGBNIR14_SIZE = 8;
+
+// symbols of the GPS time multipliers
+constexpr int GPSTIME_MULTI = 500;
+constexpr int GPSTIME_MULTI_MINUS = -10;
+constexpr int GPSTIME_MULTI_CODE_FULL = GPSTIME_MULTI - GPSTIME_MULTI_MINUS + 1;
+constexpr int GPSTIME_MULTI_TOTAL = GPSTIME_MULTI - GPSTIME_MULTI_MINUS + 5;
+
+// context of the X and Y differences for the number of returns (row) and the return number (column) of a point:
+// single return, first and last of two returns, first, intermediate and last of more returns
+static const uint8_t NUMBER_RETURN_MAP_6CTX[16][16] =
+{
+  {  0,  1,  2,  3,  4,  5,  3,  4,  4,  5,  5,  5,  5,  5,  5,  5 },
+  {  1,  0,  1,  3,  4,  5,  3,  4,  4,  5,  5,  5,  5,  5,  5,  5 },
+  {  2,  1,  2,  4,  5,  3,  4,  4,  5,  5,  5,  5,  5,  5,  5,  5 },
+  {  3,  3,  4,  5,  4,  5,  4,  5,  5,  5,  5,  5,  5,  5,  5,  5 },
+  {  4,  3,  4,  4,  5,  4,  5,  4,  5,  5,  5,  5,  5,  5,  5,  5 },
+  {  5,  3,  4,  4,  4,  5,  4,  5,  4,  5,  5,  5,  5,  5,  5,  5 },
+  {  3,  3,  4,  4,  4,  4,  5,  4,  5,  4,  5,  5,  5,  5,  5,  5 },
+  {  4,  3,  4,  4,  4,  4,  4,  5,  4,  5,  4,  5,  5,  5,  5,  5 },
+  {  4,  3,  4,  4,  4,  4,  4,  4,  5,  4,  5,  4,  5,  5,  5,  5 },
+  {  5,  3,  4,  4,  4,  4,  4,  4,  4,  5,  4,  5,  4,  5,  5,  5 },
+  {  5,  3,  4,  4,  4,  4,  4,  4,  4,  4,  5,  4,  5,  4,  5,  5 },
+  {  5,  3,  4,  4,  4,  4,  4,  4,  4,  4,  4,  5,  4,  5,  4,  5 },
+  {  5,  3,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  5,  4,  5,  4 },
+  {  5,  3,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  5,  4,  5 },
+  {  5,  3,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  5,  4 },
+  {  5,  3,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  5 }
+};
+
+// context of the Z values and of the intensities: how far the return number is from the number of returns
+static unsigned int numberReturnLevel( unsigned int numberOfReturns, unsigned int returnNumber )
+{
+  return static_cast< unsigned int >( std::min( std::abs( static_cast< int >( numberOfReturns ) - static_cast< int >( returnNumber ) ), 7 ) );
+}
+
+template<typename T>
+static T readLittleEndian( const unsigned char *data )
+{
+  typename std::make_unsigned<T>::type value = 0;
+  for ( std::size_t i = 0; i < sizeof( T ); ++i )
+    value |= static_cast< typename std::make_unsigned<T>::type >( data[i] ) << ( 8 * i );
+  return static_cast< T >( value );
+}
+
+template<typename T>
+static void writeLittleEndian( char *data, T value )
+{
+  const typename std::make_unsigned<T>::type bits = static_cast< typename std::make_unsigned<T>::type >( value );
+  for ( std::size_t i = 0; i < sizeof( T ); ++i )
+    data[i] = static_cast< char >( ( bits >> ( 8 * i ) ) & 0xff );
+}
+
+/**
+ * Bytes of a layer. The arithmetic decoder can read a few bytes ahead of the last symbol of the
+ * layer, these reads return zeros instead of reading past the end of the chunk.
+ */
+class LayerStream
+{
+  public:
+    void init( const unsigned char *data, std::size_t size )
+    {
+      mData = data;
+      mSize = size;
+      mPosition = 0;
+    }
+
+    unsigned char getByte()
+    {
+      return mPosition < mSize ? mData[mPosition++] : 0;
+    }
+
+  private:
+    const unsigned char *mData = nullptr;
+    std::size_t mSize = 0;
+    std::size_t mPosition = 0;
+};
+
+//! A layer of a chunk, with its own arithmetic decoder
+struct Layer
+{
+  Layer() = default;
+  Layer( const Layer &other ) = delete;
+  Layer &operator=( const Layer &other ) = delete;
+
+  void init( const unsigned char *data, std::size_t size )
+  {
+    stream.init( data, size );
+    // empty layers hold attributes which are the same for all the points of the chunk
+    changed = size > 0;
+    if ( changed )
+      decoder.readInitBytes();
+  }
+
+  LayerStream stream;
+  laszip::decoders::arithmetic< LayerStream > decoder{ stream };
+  bool changed = false;
+};
+
+//! Attributes of the POINT14 item of a point
+struct Point14
+{
+  int32_t x = 0;
+  int32_t y = 0;
+  int32_t z = 0;
+  uint16_t intensity = 0;
+  uint8_t returnNumber = 0;
+  uint8_t numberOfReturns = 0;
+  uint8_t classificationFlags = 0;
+  uint8_t scannerChannel = 0;
+  uint8_t scanDirectionFlag = 0;
+  uint8_t edgeOfFlightLine = 0;
+  uint8_t classification = 0;
+  uint8_t userData = 0;
+  int16_t scanAngle = 0;
+  uint16_t pointSourceId = 0;
+  U64I64F64 gpsTime;
+  //! TRUE if the GPS time of the point differs from the one of the previous point of its scanner channel
+  bool gpsTimeChange = false;
+
+  void unpack( const unsigned char *data )
+  {
+    x = readLittleEndian< int32_t >( data );
+    y = readLittleEndian< int32_t >( data + 4 );
+    z = readLittleEndian< int32_t >( data + 8 );
+    intensity = readLittleEndian< uint16_t >( data + 12 );
+    returnNumber = data[14] & 0x0f;
+    numberOfReturns = ( data[14] >> 4 ) & 0x0f;
+    classificationFlags = data[15] & 0x0f;
+    scannerChannel = ( data[15] >> 4 ) & 0x03;
+    scanDirectionFlag = ( data[15] >> 6 ) & 0x01;
+    edgeOfFlightLine = ( data[15] >> 7 ) & 0x01;
+    classification = data[16];
+    userData = data[17];
+    scanAngle = readLittleEndian< int16_t >( data + 18 );
+    pointSourceId = readLittleEndian< uint16_t >( data + 20 );
+    gpsTime.u64 = readLittleEndian< uint64_t >( data + 22 );
+    gpsTimeChange = false;
+  }
+
+  void pack( char *data ) const
+  {
+    writeLittleEndian< int32_t >( data, x );
+    writeLittleEndian< int32_t >( data + 4, y );
+    writeLittleEndian< int32_t >( data + 8, z );
+    writeLittleEndian< uint16_t >( data + 12, intensity );
+    data[14] = static_cast< char >( ( returnNumber & 0x0f ) | ( ( numberOfReturns & 0x0f ) << 4 ) );
+    data[15] = static_cast< char >( ( classificationFlags & 0x0f ) | ( ( scannerChannel & 0x03 ) << 4 ) | ( ( scanDirectionFlag & 0x01 ) << 6 ) | ( ( edgeOfFlightLine & 0x01 ) << 7 ) );
+    data[16] = static_cast< char >( classification );
+    data[17] = static_cast< char >( userData );
+    writeLittleEndian< int16_t >( data + 18, scanAngle );
+    writeLittleEndian< uint16_t >( data + 20, pointSourceId );
+    writeLittleEndian< uint64_t >( data + 22, gpsTime.u64 );
+  }
+};
+
+//! Models and state of the POINT14 item for one scanner channel
+struct Point14Context
+{
+  explicit Point14Context( const Point14 &item )
+    : last( item )
+  {
+    last.gpsTimeChange = false;
+
+    changedValues.reserve( 8 );
+    for ( int i = 0; i < 8; ++i )
+      changedValues.emplace_back( 128 );
+
+    dX.init();
+    dY.init();
+    zDecompressor.init();
+    intensityDecompressor.init();
+    scanAngleDecompressor.init();
+    pointSourceIdDecompressor.init();
+    gpsTimeDecompressor.init();
+
+    lastZ.fill( item.z );
+    lastIntensity.fill( item.intensity );
+
+    lastGpsTime[0] = item.gpsTime;
+    for ( int i = 1; i < 4; ++i )
+      lastGpsTime[i].u64 = 0;
+    lastGpsTimeDiff.fill( 0 );
+    multiExtremeCounter.fill( 0 );
+  }
+
+  //! The previous point of the scanner channel
+  Point14 last;
+
+  std::vector< SymbolModel > changedValues;
+  SymbolModel scannerChannel{ 3 };
+  std::array< std::unique_ptr< SymbolModel >, 16 > numberOfReturns;
+  std::array< std::unique_ptr< SymbolModel >, 16 > returnNumber;
+  SymbolModel returnNumberGpsSame{ 13 };
+
+  IntegerDecompressor dX{ 32, 2 };
+  IntegerDecompressor dY{ 32, 22 };
+  std::array< Median, 12 > lastXDiffMedian;
+  std::array< Median, 12 > lastYDiffMedian;
+
+  IntegerDecompressor zDecompressor{ 32, 20 };
+  std::array< int32_t, 8 > lastZ;
+
+  std::array< std::unique_ptr< SymbolModel >, 64 > classification;
+  std::array< std::unique_ptr< SymbolModel >, 64 > flags;
+  std::array< std::unique_ptr< SymbolModel >, 64 > userData;
+
+  IntegerDecompressor intensityDecompressor{ 16, 4 };
+  std::array< uint16_t, 8 > lastIntensity;
+
+  IntegerDecompressor scanAngleDecompressor{ 16, 2 };
+  IntegerDecompressor pointSourceIdDecompressor{ 16 };
+
+  SymbolModel gpsTimeMulti{ GPSTIME_MULTI_TOTAL };
+  SymbolModel gpsTime0Diff{ 5 };
+  IntegerDecompressor gpsTimeDecompressor{ 32, 9 };
+  // up to four interleaved sequences of GPS times
+  std::array< U64I64F64, 4 > lastGpsTime;
+  std::array< int32_t, 4 > lastGpsTimeDiff;
+  std::array< int32_t, 4 > multiExtremeCounter;
+  unsigned int lastSequence = 0;
+  unsigned int nextSequence = 0;
+};
+
+//! Models and state of the RGB14 and RGBNIR14 items for one scanner channel
+struct ColorContext
+{
+  explicit ColorContext( const std::array< uint16_t, 4 > &item )
+    : last( item )
+  {}
+
+  //! Red, green, blue and near infrared values of the previous point of the scanner channel
+  std::array< uint16_t, 4 > last;
+
+  SymbolModel byteUsed{ 128 };
+  SymbolModel rgbDiff0{ 256 };
+  SymbolModel rgbDiff1{ 256 };
+  SymbolModel rgbDiff2{ 256 };
+  SymbolModel rgbDiff3{ 256 };
+  SymbolModel rgbDiff4{ 256 };
+  SymbolModel rgbDiff5{ 256 };
+
+  SymbolModel nirBytesUsed{ 4 };
+  SymbolModel nirDiff0{ 256 };
+  SymbolModel nirDiff1{ 256 };
+};
+
+//! Models and state of the BYTE14 item (the extra bytes) for one scanner channel
+struct BytesContext
+{
+  explicit BytesContext( const std::vector< uint8_t > &item )
+    : last( item )
+  {
+    bytes.reserve( item.size() );
+    for ( std::size_t i = 0; i < item.size(); ++i )
+      bytes.emplace_back( 256 );
+  }
+
+  std::vector< uint8_t > last;
+  std::vector< SymbolModel > bytes;
+};
+
+// layers of the POINT14 item, in the order of the chunk
+enum Point14Layer
+{
+  ChannelReturnsXYLayer = 0,
+  ZLayer,
+  ClassificationLayer,
+  FlagsLayer,
+  IntensityLayer,
+  ScanAngleLayer,
+  UserDataLayer,
+  PointSourceLayer,
+  GpsTimeLayer,
+  Point14LayerCount
+};
+
+struct QgsLazLayeredDecoder::Private
+{
+  void readPoint14();
+  void readGpsTime();
+  void readColor();
+  void readBytes();
+
+  int pointFormat = 0;
+  int recordLength = 0;
+  int colorSize = 0;
+  int extraBytes = 0;
+
+  //! The first point of the chunk, which is stored uncompressed
+  std::vector< unsigned char > firstRecord;
+  bool firstPointRead = false;
+
+  std::array< Layer, Point14LayerCount > point14Layers;
+  Layer rgbLayer;
+  Layer nirLayer;
+  std::vector< std::unique_ptr< Layer > > byteLayers;
+
+  std::array< std::unique_ptr< Point14Context >, 4 > point14Contexts;
+  std::array< std::unique_ptr< ColorContext >, 4 > colorContexts;
+  std::array< std::unique_ptr< BytesContext >, 4 > bytesContexts;
+  // the scanner channel of the last point, which selects the contexts of all the items
+  unsigned int currentContext = 0;
+  unsigned int colorContext = 0;
+  unsigned int bytesContext = 0;
+};
+
+QgsLazLayeredDecoder::QgsLazLayeredDecoder( const char *data, std::size_t size, int pointFormat, int pointRecordLength )
+  : d( std::make_unique< Private >() )
+{
+  if ( !supportsPointFormat( pointFormat ) )
+    throw std::runtime_error( "Unsupported point format" );
+
+  d->pointFormat = pointFormat;
+  d->recordLength = pointRecordLength;
+  d->colorSize = pointFormat == 7 ? RGB14_SIZE : ( pointFormat == 8 ? RGBNIR14_SIZE : 0 );
+  d->extraBytes = pointRecordLength - POINT14_SIZE - d->colorSize;
+  if ( d->extraBytes < 0 )
+    throw std::runtime_error( "Point record length too small for the point format" );
+
+  const unsigned char *bytes = reinterpret_cast< const unsigned char * >( data );
+  std::size_t position = 0;
+  const auto take = [&]( std::size_t count ) -> const unsigned char *
+  {
+    if ( count > size - position )
+      throw std::runtime_error( "Truncated LAZ chunk" );
+    const unsigned char *result = bytes + position;
+    position += count;
+    return result;
+  };
+
+  const unsigned char *first = take( static_cast< std::size_t >( pointRecordLength ) );
+  d->firstRecord.assign( first, first + pointRecordLength );
+
+  // the number of points of the chunk, which is also known from the hierarchy
+  take( 4 );
+
+  const int layerCount = Point14LayerCount + ( pointFormat == 7 ? 1 : 0 ) + ( pointFormat == 8 ? 2 : 0 ) + d->extraBytes;
+  std::vector< std::size_t > layerSizes;
+  layerSizes.reserve( layerCount );
+  for ( int i = 0; i < layerCount; ++i )
+    layerSizes.emplace_back( readLittleEndian< uint32_t >( take( 4 ) ) );
+
+  int layer = 0;
+  for ( Layer &point14Layer : d->point14Layers )
+  {
+    const std::size_t layerSize = layerSizes[layer++];
+    point14Layer.init( take( layerSize ), layerSize );
+  }
+  if ( d->colorSize > 0 )
+  {
+    const std::size_t layerSize = layerSizes[layer++];
+    d->rgbLayer.init( take( layerSize ), layerSize );
+  }
+  if ( pointFormat == 8 )
+  {
+    const std::size_t layerSize = layerSizes[layer++];
+    d->nirLayer.init( take( layerSize ), layerSize );
+  }
+  for ( int i = 0; i < d->extraBytes; ++i )
+  {
+    const std::size_t layerSize = layerSizes[layer++];
+    d->byteLayers.emplace_back( std::make_unique< Layer >() );
+    d->byteLayers.back()->init( take( layerSize ), layerSize );
+  }
+
+  // the contexts of the scanner channel of the first point start from its values
+  Point14 firstPoint;
+  firstPoint.unpack( d->firstRecord.data() );
+  d->currentContext = firstPoint.scannerChannel;
+  d->point14Contexts[d->currentContext] = std::make_unique< Point14Context >( firstPoint );
+
+  if ( d->colorSize > 0 )
+  {
+    const unsigned char *color = d->firstRecord.data() + POINT14_SIZE;
+    std::array< uint16_t, 4 > firstColor { readLittleEndian< uint16_t >( color ), readLittleEndian< uint16_t >( color + 2 ), readLittleEndian< uint16_t >( color + 4 ), 0 };
+    if ( pointFormat == 8 )
+      firstColor[3] = readLittleEndian< uint16_t >( color + 6 );
+    d->colorContext = d->currentContext;
+    d->colorContexts[d->colorContext] = std::make_unique< ColorContext >( firstColor );
+  }
+
+  if ( d->extraBytes > 0 )
+  {
+    const unsigned char *extra = d->firstRecord.data() + POINT14_SIZE + d->colorSize;
+    d->bytesContext = d->currentContext;
+    d->bytesContexts[d->bytesContext] = std::make_unique< BytesContext >( std::vector< uint8_t >( extra, extra + d->extraBytes ) );
+  }
+}
+
+QgsLazLayeredDecoder::~QgsLazLayeredDecoder() = default;
+
+bool QgsLazLayeredDecoder::supportsPointFormat( int pointFormat )
+{
+  return pointFormat >= 6 && pointFormat <= 8;
+}
+
+void QgsLazLayeredDecoder::readPoint( char *record )
+{
+  if ( !d->firstPointRead )
+  {
+    d->firstPointRead = true;
+    std::memcpy( record, d->firstRecord.data(), d->firstRecord.size() );
+    return;
+  }
+
+  d->readPoint14();
+  if ( d->colorSize > 0 )
+    d->readColor();
+  if ( d->extraBytes > 0 )
+    d->readBytes();
+
+  Point14Context &context = *d->point14Contexts[d->currentContext];
+  context.last.pack( record );
+  if ( d->colorSize > 0 )
+  {
+    const ColorContext &color = *d->colorContexts[d->colorContext];
+    writeLittleEndian< uint16_t >( record + POINT14_SIZE, color.last[0] );
+    writeLittleEndian< uint16_t >( record + POINT14_SIZE + 2, color.last[1] );
+    writeLittleEndian< uint16_t >( record + POINT14_SIZE + 4, color.last[2] );
+    if ( d->pointFormat == 8 )
+      writeLittleEndian< uint16_t >( record + POINT14_SIZE + 6, color.last[3] );
+  }
+  if ( d->extraBytes > 0 )
+  {
+    const BytesContext &bytes = *d->bytesContexts[d->bytesContext];
+    std::memcpy( record + POINT14_SIZE + d->colorSize, bytes.last.data(), bytes.last.size() );
+  }
+}
+
+static SymbolModel &lazyModel( std::unique_ptr< SymbolModel > &model, unsigned int symbols )
+{
+  if ( !model )
+    model = std::make_unique< SymbolModel >( symbols );
+  return *model;
+}
+
+void QgsLazLayeredDecoder::Private::readPoint14()
+{
+  Layer &channelReturnsXY = point14Layers[ChannelReturnsXYLayer];
+  laszip::decoders::arithmetic< LayerStream > &decoder = channelReturnsXY.decoder;
+
+  Point14Context *context = point14Contexts[currentContext].get();
+  Point14 *last = &context->last;
+
+  // return context of the previous point: first (1), last (2) or single (3) return, and whether its GPS time changed (4)
+  unsigned int lastReturnContext = last->returnNumber == 1 ? 1 : 0;
+  lastReturnContext += last->returnNumber >= last->numberOfReturns ? 2 : 0;
+  lastReturnContext += last->gpsTimeChange ? 4 : 0;
+
+  const unsigned int changedValues = decoder.decodeSymbol( context->changedValues[lastReturnContext] );
+
+  if ( changedValues & ( 1 << 6 ) )
+  {
+    // the scanner channel changed, the other values are predicted from the previous point of the new channel
+    const unsigned int diff = decoder.decodeSymbol( context->scannerChannel );
+    const unsigned int scannerChannel = ( currentContext + diff + 1 ) % 4;
+    if ( !point14Contexts[scannerChannel] )
+      point14Contexts[scannerChannel] = std::make_unique< Point14Context >( *last );
+    currentContext = scannerChannel;
+    context = point14Contexts[currentContext].get();
+    last = &context->last;
+    last->scannerChannel = static_cast< uint8_t >( scannerChannel );
+  }
+
+  const bool pointSourceChange = changedValues & ( 1 << 5 );
+  const bool gpsTimeChange = changedValues & ( 1 << 4 );
+  const bool scanAngleChange = changedValues & ( 1 << 3 );
+
+  const unsigned int lastN = last->numberOfReturns;
+  const unsigned int lastR = last->returnNumber;
+
+  unsigned int n = lastN;
+  if ( changedValues & ( 1 << 2 ) )
+  {
+    n = decoder.decodeSymbol( lazyModel( context->numberOfReturns[lastN], 16 ) );
+    last->numberOfReturns = static_cast< uint8_t >( n );
+  }
+
+  unsigned int r = lastR;
+  switch ( changedValues & 3 )
+  {
+    case 0:
+      break;
+    case 1:
+      r = ( lastR + 1 ) % 16;
+      break;
+    case 2:
+      r = ( lastR + 15 ) % 16;
+      break;
+    default:
+      if ( gpsTimeChange )
+        r = decoder.decodeSymbol( lazyModel( context->returnNumber[lastR], 16 ) );
+      else
+        r = ( lastR + decoder.decodeSymbol( context->returnNumberGpsSame ) + 2 ) % 16;
+      break;
+  }
+  last->returnNumber = static_cast< uint8_t >( r );
+
+  const unsigned int m = NUMBER_RETURN_MAP_6CTX[n][r];
+  const unsigned int l = numberReturnLevel( n, r );
+
+  // return context of the point: last (1), first (2) or single (3) return
+  unsigned int returnContext = r == 1 ? 2 : 0;
+  returnContext += r >= n ? 1 : 0;
+
+  const unsigned int medianIndex = ( m << 1 ) | ( gpsTimeChange ? 1 : 0 );
+  int32_t diff = context->dX.decompress( decoder, context->lastXDiffMedian[medianIndex].get(), n == 1 ? 1 : 0 );
+  last->x += diff;
+  context->lastXDiffMedian[medianIndex].add( diff );
+
+  unsigned int kBits = context->dX.getK();
+  diff = context->dY.decompress( decoder, context->lastYDiffMedian[medianIndex].get(), ( n == 1 ? 1 : 0 ) + ( kBits < 20 ? ( kBits & ~1u ) : 20 ) );
+  last->y += diff;
+  context->lastYDiffMedian[medianIndex].add( diff );
+
+  Layer &zLayer = point14Layers[ZLayer];
+  if ( zLayer.changed )
+  {
+    kBits = ( context->dX.getK() + context->dY.getK() ) / 2;
+    last->z = context->zDecompressor.decompress( zLayer.decoder, context->lastZ[l], ( n == 1 ? 1 : 0 ) + ( kBits < 18 ? ( kBits & ~1u ) : 18 ) );
+    context->lastZ[l] = last->z;
+  }
+
+  Layer &classificationLayer = point14Layers[ClassificationLayer];
+  if ( classificationLayer.changed )
+  {
+    const unsigned int classificationContext = ( ( last->classification & 0x1f ) << 1 ) + ( returnContext == 3 ? 1 : 0 );
+    last->classification = static_cast< uint8_t >( classificationLayer.decoder.decodeSymbol( lazyModel( context->classification[classificationContext], 256 ) ) );
+  }
+
+  Layer &flagsLayer = point14Layers[FlagsLayer];
+  if ( flagsLayer.changed )
+  {
+    const unsigned int lastFlags = ( last->edgeOfFlightLine << 5 ) | ( last->scanDirectionFlag << 4 ) | last->classificationFlags;
+    const unsigned int flags = flagsLayer.decoder.decodeSymbol( lazyModel( context->flags[lastFlags], 64 ) );
+    last->edgeOfFlightLine = ( flags >> 5 ) & 1;
+    last->scanDirectionFlag = ( flags >> 4 ) & 1;
+    last->classificationFlags = flags & 0x0f;
+  }
+
+  Layer &intensityLayer = point14Layers[IntensityLayer];
+  if ( intensityLayer.changed )
+  {
+    const unsigned int intensityIndex = ( returnContext << 1 ) | ( gpsTimeChange ? 1 : 0 );
+    const uint16_t intensity = static_cast< uint16_t >( context->intensityDecompressor.decompress( intensityLayer.decoder, context->lastIntensity[intensityIndex], returnContext ) );
+    context->lastIntensity[intensityIndex] = intensity;
+    last->intensity = intensity;
+  }
+
+  Layer &scanAngleLayer = point14Layers[ScanAngleLayer];
+  if ( scanAngleLayer.changed && scanAngleChange )
+  {
+    last->scanAngle = static_cast< int16_t >( context->scanAngleDecompressor.decompress( scanAngleLayer.decoder, last->scanAngle, gpsTimeChange ? 1 : 0 ) );
+  }
+
+  Layer &userDataLayer = point14Layers[UserDataLayer];
+  if ( userDataLayer.changed )
+  {
+    last->userData = static_cast< uint8_t >( userDataLayer.decoder.decodeSymbol( lazyModel( context->userData[last->userData / 4], 256 ) ) );
+  }
+
+  Layer &pointSourceLayer = point14Layers[PointSourceLayer];
+  if ( pointSourceLayer.changed && pointSourceChange )
+  {
+    last->pointSourceId = static_cast< uint16_t >( context->pointSourceIdDecompressor.decompress( pointSourceLayer.decoder, last->pointSourceId, 0 ) );
+  }
+
+  if ( point14Layers[GpsTimeLayer].changed && gpsTimeChange )
+  {
+    readGpsTime();
+    last->gpsTime = context->lastGpsTime[context->lastSequence];
+  }
+
+  last->gpsTimeChange = gpsTimeChange;
+}
+
+void QgsLazLayeredDecoder::Private::readGpsTime()
+{
+  laszip::decoders::arithmetic< LayerStream > &decoder = point14Layers[GpsTimeLayer].decoder;
+  Point14Context &context = *point14Contexts[currentContext];
+
+  // GPS times are predicted from the last difference of their sequence, or start a new sequence
+  const auto readFullGpsTime = [&decoder, &context]
+  {
+    context.nextSequence = ( context.nextSequence + 1 ) & 3;
+    const uint64_t high = static_cast< uint32_t >( context.gpsTimeDecompressor.decompress( decoder, static_cast< int32_t >( context.lastGpsTime[context.lastSequence].u64 >> 32 ), 8 ) );
+    context.lastGpsTime[context.nextSequence].u64 = ( high << 32 ) | decoder.readInt();
+    context.lastSequence = context.nextSequence;
+    context.lastGpsTimeDiff[context.lastSequence] = 0;
+    context.multiExtremeCounter[context.lastSequence] = 0;
+  };
+
+  // a GPS time can switch to another sequence, which is then decoded from its own last value
+  while ( true )
+  {
+    const unsigned int sequence = context.lastSequence;
+    if ( context.lastGpsTimeDiff[sequence] == 0 )
+    {
+      const int multi = static_cast< int >( decoder.decodeSymbol( context.gpsTime0Diff ) );
+      if ( multi == 0 )
+      {
+        // the difference fits in 32 bits
+        context.lastGpsTimeDiff[sequence] = context.gpsTimeDecompressor.decompress( decoder, 0, 0 );
+        context.lastGpsTime[sequence].i64 += context.lastGpsTimeDiff[sequence];
+        context.multiExtremeCounter[sequence] = 0;
+      }
+      else if ( multi == 1 )
+      {
+        readFullGpsTime();
+      }
+      else
+      {
+        context.lastSequence = ( sequence + multi - 1 ) & 3;
+        continue;
+      }
+    }
+    else
+    {
+      int multi = static_cast< int >( decoder.decodeSymbol( context.gpsTimeMulti ) );
+      if ( multi == 1 )
+      {
+        context.lastGpsTime[sequence].i64 += context.gpsTimeDecompressor.decompress( decoder, context.lastGpsTimeDiff[sequence], 1 );
+        context.multiExtremeCounter[sequence] = 0;
+      }
+      else if ( multi < GPSTIME_MULTI_CODE_FULL )
+      {
+        int32_t gpsTimeDiff = 0;
+        bool extreme = false;
+        if ( multi == 0 )
+        {
+          gpsTimeDiff = context.gpsTimeDecompressor.decompress( decoder, 0, 7 );
+          extreme = true;
+        }
+        else if ( multi < GPSTIME_MULTI )
+        {
+          gpsTimeDiff = context.gpsTimeDecompressor.decompress( decoder, multi * context.lastGpsTimeDiff[sequence], multi < 10 ? 2 : 3 );
+        }
+        else if ( multi == GPSTIME_MULTI )
+        {
+          gpsTimeDiff = context.gpsTimeDecompressor.decompress( decoder, GPSTIME_MULTI * context.lastGpsTimeDiff[sequence], 4 );
+          extreme = true;
+        }
+        else
+        {
+          multi = GPSTIME_MULTI - multi;
+          if ( multi > GPSTIME_MULTI_MINUS )
+          {
+            gpsTimeDiff = context.gpsTimeDecompressor.decompress( decoder, multi * context.lastGpsTimeDiff[sequence], 5 );
+          }
+          else
+          {
+            gpsTimeDiff = context.gpsTimeDecompressor.decompress( decoder, GPSTIME_MULTI_MINUS * context.lastGpsTimeDiff[sequence], 6 );
+            extreme = true;
+          }
+        }
+
+        // after more than three extreme multipliers the difference becomes the new reference
+        if ( extreme && ++context.multiExtremeCounter[sequence] > 3 )
+        {
+          context.lastGpsTimeDiff[sequence] = gpsTimeDiff;
+          context.multiExtremeCounter[sequence] = 0;
+        }
+        context.lastGpsTime[sequence].i64 += gpsTimeDiff;
+      }
+      else if ( multi == GPSTIME_MULTI_CODE_FULL )
+      {
+        readFullGpsTime();
+      }
+      else
+      {
+        context.lastSequence = ( sequence + multi - GPSTIME_MULTI_CODE_FULL ) & 3;
+        continue;
+      }
+    }
+    break;
+  }
+}
+
+void QgsLazLayeredDecoder::Private::readColor()
+{
+  // all the items use the scanner channel decoded by the POINT14 item
+  if ( colorContext != currentContext )
+  {
+    if ( !colorContexts[currentContext] )
+      colorContexts[currentContext] = std::make_unique< ColorContext >( colorContexts[colorContext]->last );
+    colorContext = currentContext;
+  }
+  ColorContext &context = *colorContexts[colorContext];
+  std::array< uint16_t, 4 > &last = context.last;
+
+  if ( rgbLayer.changed )
+  {
+    laszip::decoders::arithmetic< LayerStream > &decoder = rgbLayer.decoder;
+    std::array< uint16_t, 3 > item;
+    const unsigned int sym = decoder.decodeSymbol( context.byteUsed );
+
+    if ( sym & ( 1 << 0 ) )
+      item[0] = U8_FOLD( decoder.decodeSymbol( context.rgbDiff0 ) + ( last[0] & 0xff ) );
+    else
+      item[0] = last[0] & 0xff;
+
+    if ( sym & ( 1 << 1 ) )
+      item[0] |= static_cast< uint16_t >( U8_FOLD( decoder.decodeSymbol( context.rgbDiff1 ) + ( last[0] >> 8 ) ) ) << 8;
+    else
+      item[0] |= last[0] & 0xff00;
+
+    if ( sym & ( 1 << 6 ) )
+    {
+      int diff = ( item[0] & 0xff ) - ( last[0] & 0xff );
+      if ( sym & ( 1 << 2 ) )
+        item[1] = U8_FOLD( decoder.decodeSymbol( context.rgbDiff2 ) + U8_CLAMP( diff + ( last[1] & 0xff ) ) );
+      else
+        item[1] = last[1] & 0xff;
+
+      if ( sym & ( 1 << 4 ) )
+      {
+        const unsigned int corr = decoder.decodeSymbol( context.rgbDiff4 );
+        diff = ( diff + ( item[1] & 0xff ) - ( last[1] & 0xff ) ) / 2;
+        item[2] = U8_FOLD( corr + U8_CLAMP( diff + ( last[2] & 0xff ) ) );
+      }
+      else
+      {
+        item[2] = last[2] & 0xff;
+      }
+
+      diff = ( item[0] >> 8 ) - ( last[0] >> 8 );
+      if ( sym & ( 1 << 3 ) )
+        item[1] |= static_cast< uint16_t >( U8_FOLD( decoder.decodeSymbol( context.rgbDiff3 ) + U8_CLAMP( diff + ( last[1] >> 8 ) ) ) ) << 8;
+      else
+        item[1] |= last[1] & 0xff00;
+
+      if ( sym & ( 1 << 5 ) )
+      {
+        const unsigned int corr = decoder.decodeSymbol( context.rgbDiff5 );
+        diff = ( diff + ( item[1] >> 8 ) - ( last[1] >> 8 ) ) / 2;
+        item[2] |= static_cast< uint16_t >( U8_FOLD( corr + U8_CLAMP( diff + ( last[2] >> 8 ) ) ) ) << 8;
+      }
+      else
+      {
+        item[2] |= last[2] & 0xff00;
+      }
+    }
+    else
+    {
+      // grey
+      item[1] = item[0];
+      item[2] = item[0];
+    }
+    std::copy( item.begin(), item.end(), last.begin() );
+  }
+
+  if ( nirLayer.changed )
+  {
+    laszip::decoders::arithmetic< LayerStream > &decoder = nirLayer.decoder;
+    const unsigned int sym = decoder.decodeSymbol( context.nirBytesUsed );
+    uint16_t nir;
+    if ( sym & ( 1 << 0 ) )
+      nir = U8_FOLD( decoder.decodeSymbol( context.nirDiff0 ) + ( last[3] & 0xff ) );
+    else
+      nir = last[3] & 0xff;
+
+    if ( sym & ( 1 << 1 ) )
+      nir |= static_cast< uint16_t >( U8_FOLD( decoder.decodeSymbol( context.nirDiff1 ) + ( last[3] >> 8 ) ) ) << 8;
+    else
+      nir |= last[3] & 0xff00;
+    last[3] = nir;
+  }
+}
+
+void QgsLazLayeredDecoder::Private::readBytes()
+{
+  if ( bytesContext != currentContext )
+  {
+    if ( !bytesContexts[currentContext] )
+      bytesContexts[currentContext] = std::make_unique< BytesContext >( bytesContexts[bytesContext]->last );
+    bytesContext = currentContext;
+  }
+  BytesContext &context = *bytesContexts[bytesContext];
+
+  for ( int i = 0; i < extraBytes; ++i )
+  {
+    Layer &layer = *byteLayers[i];
+    if ( layer.changed )
+      context.last[i] = U8_FOLD( context.last[i] + layer.decoder.decodeSymbol( context.bytes[i] ) );
+  }
+}
+
+///@endcond
@@ -0,0 +1,67 @@
+/***************************************************************************
+  qgslazlayereddecoder.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSLAZLAYEREDDECODER_H
+#define QGSLAZLAYEREDDECODER_H
+
+#include "qgis_sip.h"
+
+///@cond PRIVATE
+#define SIP_NO_FILE
+
+#include <cstddef>
+#include <memory>
+
+/**
+ * Decoder for the chunks of LAZ files compressed with the layered compression of the LAS 1.4
+ * point formats 6, 7 and 8, which the bundled laz-perf can't decode.
+ *
+ * A layered chunk starts with its first point stored uncompressed, followed by the number of points
+ * of the chunk and the byte sizes of its layers. Each layer holds one group of attributes of all the
+ * other points of the chunk (e.g. the return numbers and the X and Y coordinates, the Z coordinates or
+ * the GPS times), compressed with its own arithmetic decoder.
+ *
+ * The points are returned as LAS 1.4 point records. Errors in the chunk are reported by throwing
+ * std::runtime_error.
+ */
+class QgsLazLayeredDecoder
+{
+  public:
+
+    /**
+     * Constructor for QgsLazLayeredDecoder, reading the chunk stored in the \a size bytes from \a data.
+     *
+     * The \a pointFormat and \a pointRecordLength arguments must match the LAS header of the file, the record
+     * length includes the extra bytes. \a data must stay valid as long as the decoder is used.
+     */
+    QgsLazLayeredDecoder( const char *data, std::size_t size, int pointFormat, int pointRecordLength );
+    ~QgsLazLayeredDecoder();
+
+    QgsLazLayeredDecoder( const QgsLazLayeredDecoder &other ) = delete;
+    QgsLazLayeredDecoder &operator=( const QgsLazLayeredDecoder &other ) = delete;
+
+    //! Returns TRUE if the chunks of the \a pointFormat can be decoded
+    static bool supportsPointFormat( int pointFormat );
+
+    //! Decodes the next point of the chunk into \a record, which must hold the point record length
+    void readPoint( char *record );
+
+  private:
+    struct Private;
+    std::unique_ptr< Private > d;
+};
+
+///@endcond
+#endif // QGSLAZLAYEREDDECODER_H
@@ -49,84 +49,60 @@ QgsPointCloudRenderer *QgsPointCloudAttributeByRampRenderer::clone() const
 
 void QgsPointCloudAttributeByRampRenderer::renderBlock( const QgsPointCloudBlock *block, QgsPointCloudRenderContext &context )
 {
-  const QgsRectangle visibleExtent = context.renderContext().extent();
-
-  const char *ptr = block->data();
-  int count = block->pointCount();
   const QgsPointCloudAttributeCollection request = block->attributes();
 
-  const std::size_t recordSize = request.pointRecordSize();
   int attributeOffset = 0;
   const QgsPointCloudAttribute *attribute = request.find( mAttribute, attributeOffset );
   if ( !attribute )
     return;
   const QgsPointCloudAttribute::DataType attributeType = attribute->type();
 
-  const QgsDoubleRange zRange = context.renderContext().zRange();
-  const bool considerZ = !zRange.isInfinite();
-
   const bool applyZOffset = attribute->name() == QLatin1String( "Z" );
   const bool applyXOffset = attribute->name() == QLatin1String( "X" );
   const bool applyYOffset = attribute->name() == QLatin1String( "Y" );
 
-  int rendered = 0;
-  double x = 0;
-  double y = 0;
-  double z = 0;
-  const QgsCoordinateTransform ct = context.renderContext().coordinateTransform();
-  const bool reproject = ct.isValid();
+  QVector< int > pointIndices;
+  QVector< QPointF > devicePoints;
+  collectVisiblePoints( block, context, pointIndices, devicePoints );
+  if ( pointIndices.isEmpty() || context.renderContext().renderingStopped() )
+    return;
+
+  QVector< double > attributeValues;
+  QgsPointCloudRenderer::attributeValues( block, attributeOffset, attributeType, pointIndices, attributeValues );
 
+  double valueScale = 1;
+  double valueOffset = 0;
+  if ( applyXOffset )
+  {
+    valueScale = context.scale().x();
+    valueOffset = context.offset().x();
+  }
+  else if ( applyYOffset )
+  {
+    valueScale = context.scale().y();
+    valueOffset = context.offset().y();
+  }
+
+  const int count = pointIndices.size();
+  QVector< QRgb > colors( count );
   int red = 0;
   int green = 0;
   int blue = 0;
   int alpha = 0;
   for ( int i = 0; i < count; ++i )
   {
-    if ( context.renderContext().renderingStopped() )
-    {
-      break;
-    }
-
-    if ( considerZ )
-    {
-      // z value filtering is cheapest, if we're doing it...
-      z = pointZ( context, ptr, i );
-      if ( !zRange.contains( z ) )
-        continue;
-    }
-
-    pointXY( context, ptr, i, x, y );
-    if ( visibleExtent.contains( x, y ) )
-    {
-      if ( reproject )
-      {
-        try
-        {
-          ct.transformInPlace( x, y, z );
-        }
-        catch ( QgsCsException & )
-        {
-          continue;
-        }
-      }
-
-      double attributeValue = 0;
-      context.getAttribute( ptr, i * recordSize + attributeOffset, attributeType, attributeValue );
-
-      if ( applyXOffset )
-        attributeValue = context.offset().x() + context.scale().x() * attributeValue;
-      if ( applyYOffset )
-        attributeValue = context.offset().y() + context.scale().y() * attributeValue;
-      if ( applyZOffset )
-        attributeValue = ( context.offset().z() + context.scale().z() * attributeValue ) * context.zValueScale() + context.zValueFixedOffset();
-
-      mColorRampShader.shade( attributeValue, &red, &green, &blue, &alpha );
-      drawPoint( x, y, QColor( red, green, blue, alpha ), context );
-
-      rendered++;
-    }
+    double attributeValue = attributeValues.at( i );
+    if ( applyXOffset || applyYOffset )
+      attributeValue = valueOffset + valueScale * attributeValue;
+    else if ( applyZOffset )
+      attributeValue = ( context.offset().z() + context.scale().z() * attributeValue ) * context.zValueScale() + context.zValueFixedOffset();
+
+    mColorRampShader.shade( attributeValue, &red, &green, &blue, &alpha );
+    colors[i] = qRgba( red, green, blue, alpha );
   }
-  context.incrementPointsRendered( rendered );
+
+  drawPoints( devicePoints, colors, context );
+  context.incrementPointsRendered( count );
 }
 
 
@@ -21,12 +21,28 @@
 #include "qgseptdecoder.h"
 #include "qgsapplication.h"
 
+#include <QTimer>
+#include <QtConcurrentRun>
+#include <QThreadPool>
+
 //
 // QgsPointCloudBlockRequest
 //
 
 ///@cond PRIVATE
 
+/**
+ * Returns the pool of threads decoding the downloaded blocks. A dedicated pool is used because
+ * requests are typically waited for from jobs running on the global thread pool. Its number of
+ * threads follows the limit set on the global pool.
+ */
+static QThreadPool *decodingThreadPool()
+{
+  static QThreadPool sPool;
+  sPool.setMaxThreadCount( QThreadPool::globalInstance()->maxThreadCount() );
+  return &sPool;
+}
+
 QgsPointCloudBlockRequest::QgsPointCloudBlockRequest( const IndexedPointCloudNode &node, const QString &Uri, const QString &dataType,
     const QgsPointCloudAttributeCollection &attributes, const QgsPointCloudAttributeCollection &requestedAttributes,
     const QgsVector3D &scale, const QgsVector3D &offset )
@@ -39,6 +55,36 @@ QgsPointCloudBlockRequest::QgsPointCloudBlockRequest( const IndexedPointCloudNod
   nr.setAttribute( QNetworkRequest::CacheSaveControlAttribute, true );
   mTileDownloadManagetReply.reset( QgsApplication::tileDownloadManager()->get( nr ) );
   connect( mTileDownloadManagetReply.get(), &QgsTileDownloadManagerReply::finished, this, &QgsPointCloudBlockRequest::blockFinishedLoading );
+  connect( &mDecodeWatcher, &QFutureWatcherBase::finished, this, &QgsPointCloudBlockRequest::blockFinishedDecoding );
+}
+
+QgsPointCloudBlockRequest::QgsPointCloudBlockRequest( const IndexedPointCloudNode &node, QgsPointCloudBlock *block )
+  : mNode( node )
+  , mBlock( block )
+{
+  // emit the signal once the caller had a chance to connect to it
+  QTimer::singleShot( 0, this, [this]
+  {
+    mFinished = true;
+    emit finished();
+  } );
+}
+
+QgsPointCloudBlockRequest::~QgsPointCloudBlockRequest()
+{
+  // the block of a request deleted before it finished was never handed to the caller
+  if ( mFinished )
+    return;
+
+  if ( mDecoding )
+  {
+    mDecodeWatcher.waitForFinished();
+    delete mDecodeWatcher.result().first;
+  }
+  else
+  {
+    delete mBlock;
+  }
 }
 
 QgsPointCloudBlock *QgsPointCloudBlockRequest::block()
@@ -56,41 +102,67 @@ void QgsPointCloudBlockRequest::blockFinishedLoading()
   mBlock = nullptr;
   if ( mTileDownloadManagetReply->error() == QNetworkReply::NetworkError::NoError )
   {
-    bool invalidDataType = false;
-    try
+    // decompression is expensive, so it is done in a worker thread. This allows the blocks of several
+    // requests to be decoded in parallel
+    const QByteArray data = mTileDownloadManagetReply->data();
+    const QString errorString = mTileDownloadManagetReply->errorString();
+    const IndexedPointCloudNode node = mNode;
+    const QString dataType = mDataType;
+    const QgsPointCloudAttributeCollection attributes = mAttributes;
+    const QgsPointCloudAttributeCollection requestedAttributes = mRequestedAttributes;
+    const QgsVector3D scale = mScale;
+    const QgsVector3D offset = mOffset;
+    mDecoding = true;
+    mDecodeWatcher.setFuture( QtConcurrent::run( decodingThreadPool(), [ = ]
     {
-      mBlock = nullptr;
-#ifdef WITH_EPT
-      if ( mDataType == QLatin1String( "binary" ) )
-      {
-        mBlock = QgsEptDecoder::decompressBinary( mTileDownloadManagetReply->data(), mAttributes, mRequestedAttributes, mScale, mOffset );
-      }
-      else if ( mDataType == QLatin1String( "zstandard" ) )
-      {
-        mBlock = QgsEptDecoder::decompressZStandard( mTileDownloadManagetReply->data(), mAttributes, mRequestedAttributes, mScale, mOffset );
-      }
-      else if ( mDataType == QLatin1String( "laszip" ) )
+      QgsPointCloudBlock *block = nullptr;
+      QString error;
+      bool invalidDataType = false;
+      try
       {
-        mBlock = QgsEptDecoder::decompressLaz( mTileDownloadManagetReply->data(), mAttributes, mRequestedAttributes, mScale, mOffset );
+#ifdef WITH_EPT
+        if ( dataType == QLatin1String( "binary" ) )
+        {
+          block = QgsEptDecoder::decompressBinary( data, attributes, requestedAttributes, scale, offset );
+        }
+        else if ( dataType == QLatin1String( "zstandard" ) )
+        {
+          block = QgsEptDecoder::decompressZStandard( data, attributes, requestedAttributes, scale, offset );
+        }
+        else if ( dataType == QLatin1String( "laszip" ) )
+        {
+          block = QgsEptDecoder::decompressLaz( data, attributes, requestedAttributes, scale, offset );
+        }
+        else
+        {
+          error = QStringLiteral( "unknown data type %1;" ).arg( dataType );
+          invalidDataType = true;
+        }
+#endif
       }
-      else
+      catch ( std::exception &e )
       {
-        mErrorStr = QStringLiteral( "unknown data type %1;" ).arg( mDataType );
-        invalidDataType = true;
+        error = QStringLiteral( "Error while decompressing node %1: %2" ).arg( node.toString(), e.what() );
       }
-#endif
-    }
-    catch ( std::exception &e )
-    {
-      mErrorStr = QStringLiteral( "Error while decompressing node %1: %2" ).arg( mNode.toString(), e.what() );
-    }
-    if ( invalidDataType && !mBlock )
-      mErrorStr = QStringLiteral( "Error loading point cloud tile: \" %1 \"" ).arg( mTileDownloadManagetReply->errorString() );
+      if ( invalidDataType && !block )
+        error = QStringLiteral( "Error loading point cloud tile: \" %1 \"" ).arg( errorString );
+      return qMakePair( block, error );
+    } ) );
   }
   else
   {
     mErrorStr = mTileDownloadManagetReply->errorString();
+    mFinished = true;
+    emit finished();
   }
+}
+
+void QgsPointCloudBlockRequest::blockFinishedDecoding()
+{
+  const QPair< QgsPointCloudBlock *, QString > result = mDecodeWatcher.result();
+  mBlock = result.first;
+  mErrorStr = result.second;
+  mFinished = true;
   emit finished();
 }
 
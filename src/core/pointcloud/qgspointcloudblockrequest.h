@@ -19,6 +19,8 @@
 #define QGSPOINTCLOUDBLOCKREQUEST_H
 
 #include <QObject>
+#include <QFutureWatcher>
+#include <QPair>
 
 #include "qgspointcloudattribute.h"
 #include "qgstiledownloadmanager.h"
@@ -50,6 +52,17 @@ class CORE_EXPORT QgsPointCloudBlockRequest : public QObject
                                const QgsPointCloudAttributeCollection &attributes, const QgsPointCloudAttributeCollection &requestedAttributes,
                                const QgsVector3D &scale, const QgsVector3D &offset );
 
+    /**
+     * QgsPointCloudBlockRequest constructor for an already loaded \a block, e.g. a block retrieved from a cache.
+     * The finished() signal is emitted as soon as control returns to the event loop.
+     * Note: It is the responsablitiy of the caller to delete the block once finished() was emitted.
+     * If the request is deleted before that, the block is deleted with it.
+     * \since QGIS 3.22
+     */
+    QgsPointCloudBlockRequest( const IndexedPointCloudNode &node, QgsPointCloudBlock *block );
+
+    ~QgsPointCloudBlockRequest() override;
+
     /**
      * Returns the requested block. if the returned block is nullptr, that means the data request failed
      * Note: It is the responsablitiy of the caller to delete the block if it was loaded correctly
@@ -71,8 +84,15 @@ class CORE_EXPORT QgsPointCloudBlockRequest : public QObject
     QgsPointCloudBlock *mBlock = nullptr;
     QString mErrorStr;
     QgsVector3D mScale, mOffset;
+    //! Decodes the downloaded data in a worker thread, as a pair of the decoded block and the error message
+    QFutureWatcher< QPair< QgsPointCloudBlock *, QString > > mDecodeWatcher;
+    //! TRUE once the downloaded data is being decoded
+    bool mDecoding = false;
+    //! TRUE once finished() was emitted, after which the caller owns the block
+    bool mFinished = false;
   private slots:
     void blockFinishedLoading();
+    void blockFinishedDecoding();
 };
 
 #endif // QGSPOINTCLOUDBLOCKREQUEST_H
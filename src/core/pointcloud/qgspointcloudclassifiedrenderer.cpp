@@ -23,6 +23,8 @@
 #include "qgslayertreemodellegendnode.h"
 #include "qgspointclouddataprovider.h"
 
+#include <array>
+
 QgsPointCloudCategory::QgsPointCloudCategory( const int value, const QColor &color, const QString &label, bool render )
   : mValue( value )
   , mColor( color )
@@ -59,78 +61,52 @@ QgsPointCloudRenderer *QgsPointCloudClassifiedRenderer::clone() const
 
 void QgsPointCloudClassifiedRenderer::renderBlock( const QgsPointCloudBlock *block, QgsPointCloudRenderContext &context )
 {
-  const QgsRectangle visibleExtent = context.renderContext().extent();
-
-  const char *ptr = block->data();
-  int count = block->pointCount();
   const QgsPointCloudAttributeCollection request = block->attributes();
 
-  const std::size_t recordSize = request.pointRecordSize();
   int attributeOffset = 0;
   const QgsPointCloudAttribute *attribute = request.find( mAttribute, attributeOffset );
   if ( !attribute )
     return;
   const QgsPointCloudAttribute::DataType attributeType = attribute->type();
 
-  const QgsDoubleRange zRange = context.renderContext().zRange();
-  const bool considerZ = !zRange.isInfinite();
-
-  int rendered = 0;
-  double x = 0;
-  double y = 0;
-  double z = 0;
-  const QgsCoordinateTransform ct = context.renderContext().coordinateTransform();
-  const bool reproject = ct.isValid();
-
-  QHash< int, QColor > colors;
+  // classes are usually small values, e.g. LAS classifications, so they are looked up in a table instead of a hash.
+  // A fully transparent color is used for classes which are not rendered
+  std::array< QRgb, 256 > colorTable;
+  colorTable.fill( 0 );
+  QHash< int, QRgb > colors;
   for ( const QgsPointCloudCategory &category : std::as_const( mCategories ) )
   {
-    if ( !category.renderState() )
+    if ( !category.renderState() || !category.color().isValid() )
       continue;
 
-    colors.insert( category.value(), category.color() );
+    if ( category.value() >= 0 && category.value() < static_cast< int >( colorTable.size() ) )
+      colorTable[ category.value() ] = category.color().rgba();
+    else
+      colors.insert( category.value(), category.color().rgba() );
   }
 
-  for ( int i = 0; i < count; ++i )
-  {
-    if ( context.renderContext().renderingStopped() )
-    {
-      break;
-    }
-
-    if ( considerZ )
-    {
-      // z value filtering is cheapest, if we're doing it...
-      z = pointZ( context, ptr, i );
-      if ( !zRange.contains( z ) )
-        continue;
-    }
-
-    int attributeValue = 0;
-    context.getAttribute( ptr, i * recordSize + attributeOffset, attributeType, attributeValue );
-    const QColor color = colors.value( attributeValue );
-    if ( !color.isValid() )
-      continue;
+  QVector< int > pointIndices;
+  QVector< QPointF > devicePoints;
+  collectVisiblePoints( block, context, pointIndices, devicePoints );
+  if ( pointIndices.isEmpty() || context.renderContext().renderingStopped() )
+    return;
 
-    pointXY( context, ptr, i, x, y );
-    if ( visibleExtent.contains( x, y ) )
-    {
-      if ( reproject )
-      {
-        try
-        {
-          ct.transformInPlace( x, y, z );
-        }
-        catch ( QgsCsException & )
-        {
-          continue;
-        }
-      }
+  QVector< int > attributeValues;
+  QgsPointCloudRenderer::attributeValues( block, attributeOffset, attributeType, pointIndices, attributeValues );
 
-      drawPoint( x, y, color, context );
+  const int count = pointIndices.size();
+  QVector< QRgb > pointColors( count );
+  int rendered = 0;
+  for ( int i = 0; i < count; ++i )
+  {
+    const int attributeValue = attributeValues.at( i );
+    const QRgb color = attributeValue >= 0 && attributeValue < static_cast< int >( colorTable.size() ) ? colorTable[ attributeValue ] : colors.value( attributeValue, 0 );
+    pointColors[i] = color;
+    if ( qAlpha( color ) != 0 )
       rendered++;
-    }
   }
+
+  drawPoints( devicePoints, pointColors, context );
   context.incrementPointsRendered( rendered );
 }
 
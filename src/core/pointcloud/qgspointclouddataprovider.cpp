@@ -21,6 +21,8 @@
 #include "qgsgeometry.h"
 #include "qgspointcloudrequest.h"
 #include "qgsgeometryengine.h"
+#include "qgsfeedback.h"
+#include "qgslogger.h"
 #include <mutex>
 #include <QDebug>
 #include <QtMath>
@@ -169,19 +171,67 @@ QMap<int, QString> QgsPointCloudDataProvider::translatedDataFormatIds()
   return sCodes;
 }
 
-QVariant QgsPointCloudDataProvider::metadataStatistic( const QString &, QgsStatisticalSummary::Statistic ) const
+QVariant QgsPointCloudDataProvider::metadataStatistic( const QString &attribute, QgsStatisticalSummary::Statistic statistic ) const
 {
-  return QVariant();
+  return statistics().statistic( attribute, statistic );
 }
 
-QVariantList QgsPointCloudDataProvider::metadataClasses( const QString & ) const
+QVariantList QgsPointCloudDataProvider::metadataClasses( const QString &attribute ) const
 {
-  return QVariantList();
+  return statistics().classes( attribute );
 }
 
-QVariant QgsPointCloudDataProvider::metadataClassStatistic( const QString &, const QVariant &, QgsStatisticalSummary::Statistic ) const
+QVariant QgsPointCloudDataProvider::metadataClassStatistic( const QString &attribute, const QVariant &value, QgsStatisticalSummary::Statistic statistic ) const
 {
-  return QVariant();
+  return statistics().classStatistic( attribute, value, statistic );
+}
+
+bool QgsPointCloudDataProvider::calculateStatistics( QgsFeedback *feedback )
+{
+  if ( statistics().isValid() )
+    return true;
+
+  QgsPointCloudIndex *index = this->index();
+  if ( !index || !index->isValid() )
+    return false;
+
+  const QgsPointCloudStatistics calculated = QgsPointCloudStatistics::calculate( index, feedback );
+  if ( !calculated.isValid() )
+    return false;
+
+  const QString path = QgsPointCloudStatistics::statisticsFilePath( index );
+  if ( !path.isEmpty() && !calculated.writeToFile( path ) )
+    QgsDebugMsgLevel( QStringLiteral( "Could not persist point cloud statistics to %1" ).arg( path ), 2 );
+
+  QMutexLocker locker( &mStatisticsMutex );
+  mStatistics = calculated;
+  mStatisticsRead = true;
+  return true;
+}
+
+void QgsPointCloudDataProvider::setStatistics( const QgsPointCloudStatistics &statistics )
+{
+  QMutexLocker locker( &mStatisticsMutex );
+  mStatistics = statistics;
+  mStatisticsRead = true;
+}
+
+QgsPointCloudStatistics QgsPointCloudDataProvider::statistics() const
+{
+  QMutexLocker locker( &mStatisticsMutex );
+  if ( !mStatisticsRead )
+  {
+    // statistics can only be read once the index is available, e.g. after the index generation of the PDAL provider
+    QgsPointCloudIndex *index = this->index();
+    if ( !index || !index->isValid() )
+      return QgsPointCloudStatistics();
+
+    const QString path = QgsPointCloudStatistics::statisticsFilePath( index );
+    if ( !path.isEmpty() )
+      mStatistics.readFromFile( path, index->pointCount() );
+    mStatisticsRead = true;
+  }
+  return mStatistics;
 }
 
 struct MapIndexedPointCloudNode
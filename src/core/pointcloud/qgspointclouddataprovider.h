@@ -25,12 +25,15 @@
 #include "qgspointcloudindex.h"
 #include "qgspoint.h"
 #include "qgsray3d.h"
+#include "qgspointcloudstatistics.h"
 #include <memory>
+#include <QMutex>
 
 class IndexedPointCloudNode;
 class QgsPointCloudIndex;
 class QgsPointCloudRenderer;
 class QgsGeometry;
+class QgsFeedback;
 
 /**
  * \ingroup core
@@ -220,6 +223,7 @@ class CORE_EXPORT QgsPointCloudDataProvider: public QgsDataProvider
      * This method will not perform any statistical calculations, rather it will return only precomputed attribute
      * statistics which are included in the data source's metadata. Not all data sources include this information
      * in the metadata, and even for sources with statistical metadata only some \a statistic values may be available.
+     * Statistics calculated by calculateStatistics() are used for statistics missing from the metadata.
      *
      * If no matching precalculated statistic is available then an invalid variant will be returned.
      */
@@ -233,6 +237,7 @@ class CORE_EXPORT QgsPointCloudDataProvider: public QgsDataProvider
      * This method will not perform any statistical calculations, rather it will return only precomputed attribute
      * statistics which are included in the data source's metadata. Not all data sources include this information
      * in the metadata, and even for sources with statistical metadata only some \a statistic values may be available.
+     * Statistics calculated by calculateStatistics() are used for statistics missing from the metadata.
      *
      * \throws ValueError if no matching precalculated statistic is available for the attribute.
      */
@@ -260,7 +265,7 @@ class CORE_EXPORT QgsPointCloudDataProvider: public QgsDataProvider
      *
      * This method will not perform any classification or scan for available classes, rather it will return only
      * precomputed classes which are included in the data source's metadata. Not all data sources include this information
-     * in the metadata.
+     * in the metadata. Classes found by calculateStatistics() are used when the metadata doesn't include them.
      */
     virtual QVariantList metadataClasses( const QString &attribute ) const;
 
@@ -274,6 +279,7 @@ class CORE_EXPORT QgsPointCloudDataProvider: public QgsDataProvider
      * This method will not perform any statistical calculations, rather it will return only precomputed class
      * statistics which are included in the data source's metadata. Not all data sources include this information
      * in the metadata, and even for sources with statistical metadata only some \a statistic values may be available.
+     * Statistics calculated by calculateStatistics() are used for statistics missing from the metadata.
      *
      * If no matching precalculated statistic is available then an invalid variant will be returned.
      */
@@ -286,6 +292,7 @@ class CORE_EXPORT QgsPointCloudDataProvider: public QgsDataProvider
      * This method will not perform any statistical calculations, rather it will return only precomputed class
      * statistics which are included in the data source's metadata. Not all data sources include this information
      * in the metadata, and even for sources with statistical metadata only some \a statistic values may be available.
+     * Statistics calculated by calculateStatistics() are used for statistics missing from the metadata.
      *
      * \throws ValueError if no matching precalculated statistic is available for the attribute.
      */
@@ -307,6 +314,48 @@ class CORE_EXPORT QgsPointCloudDataProvider: public QgsDataProvider
     % End
 #endif
 
+    /**
+     * Calculates statistics for all attributes of the point cloud, reading all points of the index in a single
+     * parallel pass.
+     *
+     * Statistics of local point clouds are persisted next to the index, so that they are only calculated once
+     * for a dataset: if persisted statistics exist they are read instead of scanning the points again.
+     *
+     * Once calculated, the statistics are used by metadataStatistic(), metadataClasses() and metadataClassStatistic()
+     * for any statistic which is missing from the data source's metadata.
+     *
+     * The optional \a feedback argument can be used to report progress and to cancel the calculation.
+     *
+     * Returns TRUE if statistics are available after the call.
+     *
+     * \warning Calculating statistics reads the whole point cloud, so this method should not be called from the main thread.
+     *
+     * \since QGIS 3.22
+     */
+    bool calculateStatistics( QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns the statistics calculated by calculateStatistics(), or persisted by an earlier calculation
+     * for the same dataset.
+     *
+     * Returns invalid statistics if none are available.
+     *
+     * \see setStatistics()
+     * \note Not available in Python bindings
+     * \since QGIS 3.22
+     */
+    QgsPointCloudStatistics statistics() const SIP_SKIP;
+
+    /**
+     * Sets the \a statistics of the point cloud, e.g. statistics calculated in a background task
+     * by another data provider for the same dataset.
+     *
+     * \see statistics()
+     * \note Not available in Python bindings
+     * \since QGIS 3.22
+     */
+    void setStatistics( const QgsPointCloudStatistics &statistics ) SIP_SKIP;
+
     /**
      * Returns the map of LAS classification code to untranslated string value, corresponding to the ASPRS Standard
      * Lidar Point Classes.
@@ -346,6 +395,10 @@ class CORE_EXPORT QgsPointCloudDataProvider: public QgsDataProvider
 
   private:
     QVector<IndexedPointCloudNode> traverseTree( const QgsPointCloudIndex *pc, IndexedPointCloudNode n, double maxError, double nodeError, const QgsGeometry &extentGeometry, const QgsDoubleRange &extentZRange );
+
+    mutable QMutex mStatisticsMutex;
+    mutable bool mStatisticsRead = false;
+    mutable QgsPointCloudStatistics mStatistics;
 };
 
 #endif // QGSMESHDATAPROVIDER_H
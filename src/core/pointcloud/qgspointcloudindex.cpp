@@ -24,8 +24,10 @@
 #include <QJsonObject>
 #include <QTime>
 #include <QtDebug>
+#include <algorithm>
 
 #include "qgstiledownloadmanager.h"
+#include "qgspointcloudrequest.h"
 
 IndexedPointCloudNode::IndexedPointCloudNode():
   mD( -1 ),
@@ -84,6 +86,36 @@ uint qHash( IndexedPointCloudNode id )
   return id.d() + id.x() + id.y() + id.z();
 }
 
+//
+// QgsPointCloudCacheKey
+//
+
+QgsPointCloudCacheKey::QgsPointCloudCacheKey( const IndexedPointCloudNode &node, const QgsPointCloudRequest &request, const QString &uri )
+  : mNode( node )
+  , mUri( uri )
+{
+  // blocks are only interchangeable if they hold the same attributes, with the same types and in the same order
+  const QgsPointCloudAttributeCollection attributes = request.attributes();
+  QStringList attributeParts;
+  attributeParts.reserve( attributes.count() );
+  for ( int i = 0; i < attributes.count(); ++i )
+  {
+    const QgsPointCloudAttribute &attribute = attributes.at( i );
+    attributeParts << QStringLiteral( "%1:%2" ).arg( attribute.name() ).arg( static_cast< int >( attribute.type() ) );
+  }
+  mAttributes = attributeParts.join( ',' );
+}
+
+bool QgsPointCloudCacheKey::operator==( const QgsPointCloudCacheKey &other ) const
+{
+  return mNode == other.mNode && mUri == other.mUri && mAttributes == other.mAttributes;
+}
+
+uint qHash( const QgsPointCloudCacheKey &key )
+{
+  return qHash( key.node() ) ^ qHash( key.uri() ) ^ qHash( key.attributes() );
+}
+
 ///@cond PRIVATE
 
 //
@@ -240,6 +272,57 @@ void QgsPointCloudIndex::setAttributes( const QgsPointCloudAttributeCollection &
   mAttributes = attributes;
 }
 
+QMutex QgsPointCloudIndex::sCacheMutex;
+// default to 256 MB of decoded point data
+QCache<QgsPointCloudCacheKey, QgsPointCloudBlock> QgsPointCloudIndex::sCache( 256 * 1024 * 1024 );
+
+int QgsPointCloudIndex::maximumCacheSize()
+{
+  QMutexLocker l( &sCacheMutex );
+  return sCache.maxCost();
+}
+
+void QgsPointCloudIndex::setMaximumCacheSize( int size )
+{
+  QMutexLocker l( &sCacheMutex );
+  sCache.setMaxCost( std::max( size, 0 ) );
+}
+
+QgsPointCloudBlock *QgsPointCloudIndex::getNodeDataFromCache( const IndexedPointCloudNode &node, const QgsPointCloudRequest &request, const QString &uri )
+{
+  if ( uri.isEmpty() )
+    return nullptr;
+
+  const QgsPointCloudCacheKey key( node, request, uri );
+
+  QMutexLocker l( &sCacheMutex );
+  const QgsPointCloudBlock *cached = sCache.object( key );
+  // the block data is implicitly shared, so copying the cached block is cheap
+  return cached ? new QgsPointCloudBlock( *cached ) : nullptr;
+}
+
+void QgsPointCloudIndex::storeNodeDataToCache( const QgsPointCloudBlock *data, const IndexedPointCloudNode &node, const QgsPointCloudRequest &request, const QString &uri )
+{
+  if ( !data || uri.isEmpty() )
+    return;
+
+  const QgsPointCloudCacheKey key( node, request, uri );
+  const int cost = data->pointCount() * data->attributes().pointRecordSize();
+
+  QMutexLocker l( &sCacheMutex );
+  sCache.insert( key, new QgsPointCloudBlock( *data ), cost );
+}
+
+QgsPointCloudBlock *QgsPointCloudIndex::getNodeDataFromCache( const IndexedPointCloudNode &node, const QgsPointCloudRequest &request ) const
+{
+  return getNodeDataFromCache( node, request, mUri );
+}
+
+void QgsPointCloudIndex::storeNodeDataToCache( const QgsPointCloudBlock *data, const IndexedPointCloudNode &node, const QgsPointCloudRequest &request ) const
+{
+  storeNodeDataToCache( data, node, request, mUri );
+}
+
 int QgsPointCloudIndex::span() const
 {
   return mSpan;
@@ -25,6 +25,7 @@
 #include <QVector>
 #include <QList>
 #include <QMutex>
+#include <QCache>
 
 #include "qgis_core.h"
 #include "qgsrectangle.h"
@@ -103,6 +104,45 @@ Q_DECLARE_TYPEINFO( IndexedPointCloudNode, Q_PRIMITIVE_TYPE );
 //! Hash function for indexed nodes
 CORE_EXPORT uint qHash( IndexedPointCloudNode id );
 
+/**
+ * \ingroup core
+ *
+ * \brief Container class for QgsPointCloudBlock cache keys.
+ *
+ * A key identifies the decoded data of a node of a point cloud index, for a set of
+ * requested attributes.
+ *
+ * \note The API is considered EXPERIMENTAL and can be changed without a notice
+ *
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsPointCloudCacheKey
+{
+  public:
+    //! Constructor for QgsPointCloudCacheKey, for the \a node of the index with matching \a uri and a \a request
+    QgsPointCloudCacheKey( const IndexedPointCloudNode &node, const QgsPointCloudRequest &request, const QString &uri );
+
+    //! Compares keys
+    bool operator==( const QgsPointCloudCacheKey &other ) const;
+
+    //! Returns the key's IndexedPointCloudNode
+    IndexedPointCloudNode node() const { return mNode; }
+
+    //! Returns the key's uri
+    QString uri() const { return mUri; }
+
+    //! Returns a string identifying the key's requested attributes
+    QString attributes() const { return mAttributes; }
+
+  private:
+    IndexedPointCloudNode mNode;
+    QString mUri;
+    QString mAttributes;
+};
+
+//! Hash function for point cloud cache keys
+CORE_EXPORT uint qHash( const QgsPointCloudCacheKey &key );
+
 /**
  * \ingroup core
  *
@@ -199,6 +239,13 @@ class CORE_EXPORT QgsPointCloudIndex: public QObject
     //! Returns the original metadata map
     virtual QVariantMap originalMetadata() const = 0;
 
+    /**
+     * Returns the uri of the index, i.e. the absolute path of its main file for local indexes or its url for remote indexes.
+     *
+     * \since QGIS 3.22
+     */
+    QString uri() const { return mUri; }
+
     //! Returns root node of the index
     IndexedPointCloudNode root() { return IndexedPointCloudNode( 0, 0, 0, 0 ); }
 
@@ -279,10 +326,60 @@ class CORE_EXPORT QgsPointCloudIndex: public QObject
      */
     int nodePointCount( const IndexedPointCloudNode &n );
 
+    /**
+     * Returns the maximum size of the cache of decoded node data blocks, in bytes.
+     *
+     * The cache is shared by all point cloud indexes.
+     *
+     * \see setMaximumCacheSize()
+     * \since QGIS 3.22
+     */
+    static int maximumCacheSize();
+
+    /**
+     * Sets the maximum \a size of the cache of decoded node data blocks, in bytes.
+     *
+     * Setting a size of 0 disables the cache.
+     *
+     * \see maximumCacheSize()
+     * \since QGIS 3.22
+     */
+    static void setMaximumCacheSize( int size );
+
+    /**
+     * Retrieves a copy of the node data block for the node \a node of the index with matching \a uri and the \a request from the cache.
+     *
+     * Returns nullptr if the block is not cached. It is caller responsibility to free the block.
+     *
+     * \since QGIS 3.22
+     */
+    static QgsPointCloudBlock *getNodeDataFromCache( const IndexedPointCloudNode &node, const QgsPointCloudRequest &request, const QString &uri );
+
+    /**
+     * Stores a copy of the node data block \a data for the node \a node of the index with matching \a uri and the \a request in the cache.
+     *
+     * The least recently used blocks are removed from the cache when its maximum size is exceeded.
+     *
+     * \since QGIS 3.22
+     */
+    static void storeNodeDataToCache( const QgsPointCloudBlock *data, const IndexedPointCloudNode &node, const QgsPointCloudRequest &request, const QString &uri );
+
   protected: //TODO private
     //! Sets native attributes of the data
     void setAttributes( const QgsPointCloudAttributeCollection &attributes );
 
+    /**
+     * Retrieves a copy of the node data block for the node \a node and the \a request from the cache, or nullptr if it is not cached.
+     * \since QGIS 3.22
+     */
+    QgsPointCloudBlock *getNodeDataFromCache( const IndexedPointCloudNode &node, const QgsPointCloudRequest &request ) const;
+
+    /**
+     * Stores a copy of the node data block \a data for the node \a node and the \a request in the cache.
+     * \since QGIS 3.22
+     */
+    void storeNodeDataToCache( const QgsPointCloudBlock *data, const IndexedPointCloudNode &node, const QgsPointCloudRequest &request ) const;
+
     QgsRectangle mExtent;  //!< 2D extent of data
     double mZMin = 0, mZMax = 0;   //!< Vertical extent of data
 
@@ -293,6 +390,11 @@ class CORE_EXPORT QgsPointCloudIndex: public QObject
     QgsPointCloudDataBounds mRootBounds;  //!< Bounds of the root node's cube (in int32 coordinates)
     QgsPointCloudAttributeCollection mAttributes; //! All native attributes stored in the file
     int mSpan;  //!< Number of points in one direction in a single node
+    QString mUri; //!< Uri of the index, used to identify its blocks in the cache
+
+  private:
+    static QMutex sCacheMutex;
+    static QCache<QgsPointCloudCacheKey, QgsPointCloudBlock> sCache;
 };
 
 #endif // QGSPOINTCLOUDINDEX_H
@@ -32,6 +32,8 @@
 #include "qgsmaplayerlegend.h"
 #include "qgsxmlutils.h"
 #include "qgsmaplayerfactory.h"
+#include "qgspointcloudstatisticscalculationtask.h"
+#include "qgstaskmanager.h"
 #include <QUrl>
 
 QgsPointCloudLayer::QgsPointCloudLayer( const QString &uri,
@@ -40,6 +42,7 @@ QgsPointCloudLayer::QgsPointCloudLayer( const QString &uri,
                                         const QgsPointCloudLayer::LayerOptions &options )
   : QgsMapLayer( QgsMapLayerType::PointCloudLayer, baseName, uri )
   , mElevationProperties( new QgsPointCloudLayerElevationProperties( this ) )
+  , mSkipStatisticsCalculation( options.skipStatisticsCalculation )
 {
   if ( !uri.isEmpty() && !providerLib.isEmpty() )
   {
@@ -53,6 +56,10 @@ QgsPointCloudLayer::QgsPointCloudLayer( const QString &uri,
 
     if ( !options.skipIndexGeneration && mDataProvider && mDataProvider->isValid() )
       mDataProvider.get()->generateIndex();
+
+    // for providers which generate their index, this is done again once the index is generated
+    if ( mDataProvider && mDataProvider->isValid() && mDataProvider->indexingState() == QgsPointCloudDataProvider::Indexed )
+      calculateStatisticsInBackground();
   }
 
   setLegend( QgsMapLayerLegend::defaultPointCloudLegend( this ) );
@@ -418,6 +425,7 @@ void QgsPointCloudLayer::onPointCloudIndexGenerationStateChanged( QgsPointCloudD
   if ( state == QgsPointCloudDataProvider::Indexed )
   {
     mDataProvider.get()->loadIndex();
+    calculateStatisticsInBackground();
     if ( mRenderer->type() == QLatin1String( "extent" ) )
     {
       setRenderer( QgsApplication::pointCloudRendererRegistry()->defaultRenderer( mDataProvider.get() ) );
@@ -428,6 +436,31 @@ void QgsPointCloudLayer::onPointCloudIndexGenerationStateChanged( QgsPointCloudD
   }
 }
 
+void QgsPointCloudLayer::calculateStatisticsInBackground()
+{
+  if ( mSkipStatisticsCalculation || !mDataProvider || !mDataProvider->isValid() )
+    return;
+
+  // the statistics of remote point clouds aren't persisted, and calculating them would download the whole cloud
+  QgsPointCloudIndex *index = mDataProvider->index();
+  if ( !index || !index->isValid() || QgsPointCloudStatistics::statisticsFilePath( index ).isEmpty() )
+    return;
+
+  // statistics persisted by an earlier calculation are read back
+  if ( mDataProvider->statistics().isValid() )
+    return;
+
+  QgsPointCloudStatisticsCalculationTask *task = new QgsPointCloudStatisticsCalculationTask( source(), mProviderKey, QgsDataProvider::ProviderOptions { transformContext() } );
+  const QString calculatedSource = source();
+  connect( task, &QgsTask::taskCompleted, this, [this, task, calculatedSource]
+  {
+    // the data source may have changed while the statistics were calculated
+    if ( mDataProvider && source() == calculatedSource )
+      mDataProvider->setStatistics( task->statistics() );
+  } );
+  QgsApplication::taskManager()->addTask( task );
+}
+
 QString QgsPointCloudLayer::loadDefaultStyle( bool &resultFlag )
 {
   if ( mDataProvider->capabilities() & QgsPointCloudDataProvider::CreateRenderer )
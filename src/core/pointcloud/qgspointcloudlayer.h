@@ -82,6 +82,16 @@ class CORE_EXPORT QgsPointCloudLayer : public QgsMapLayer
        * Set to TRUE if point cloud index generation should be skipped.
        */
       bool skipIndexGeneration = false;
+
+      /**
+       * Set to TRUE if the calculation of the point cloud statistics should be skipped.
+       *
+       * If FALSE (the default), the statistics of local point clouds which have no stored statistics
+       * are calculated in a background task once the index is available.
+       *
+       * \since QGIS 3.22
+       */
+      bool skipStatisticsCalculation = false;
     };
 
 
@@ -177,6 +187,9 @@ class CORE_EXPORT QgsPointCloudLayer : public QgsMapLayer
 
     bool isReadOnly() const override {return true;}
 
+    //! Starts a background task calculating the statistics of the point cloud, if they are not stored yet
+    void calculateStatisticsInBackground();
+
 #ifdef SIP_RUN
     QgsPointCloudLayer( const QgsPointCloudLayer &rhs );
 #endif
@@ -186,6 +199,8 @@ class CORE_EXPORT QgsPointCloudLayer : public QgsMapLayer
     std::unique_ptr<QgsPointCloudRenderer> mRenderer;
 
     QgsPointCloudLayerElevationProperties *mElevationProperties = nullptr;
+
+    bool mSkipStatisticsCalculation = false;
 };
 
 
@@ -17,6 +17,10 @@
 
 #include <QElapsedTimer>
 #include <QPointer>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#include <algorithm>
 
 #include "qgspointcloudlayerrenderer.h"
 #include "qgspointcloudlayer.h"
@@ -95,7 +99,6 @@ bool QgsPointCloudLayerRenderer::render()
     return true;
   }
 
-  // TODO cache!?
   QgsPointCloudIndex *pc = mLayer->dataProvider()->index();
   if ( !pc || !pc->isValid() )
   {
@@ -170,7 +173,12 @@ bool QgsPointCloudLayerRenderer::render()
     return false;
   }
   double rootErrorPixels = rootErrorInMapCoordinates / mapUnitsPerPixel; // in pixels
-  const QVector<IndexedPointCloudNode> nodes = traverseTree( pc, context.renderContext(), pc->root(), maximumError, rootErrorPixels );
+  QVector<IndexedPointCloudNode> nodes = traverseTree( pc, context.renderContext(), pc->root(), maximumError, rootErrorPixels );
+  // render coarser levels first, so that the whole extent is quickly covered during progressive rendering
+  std::stable_sort( nodes.begin(), nodes.end(), []( const IndexedPointCloudNode & a, const IndexedPointCloudNode & b )
+  {
+    return a.d() < b.d();
+  } );
 
   QgsPointCloudRequest request;
   request.setAttributes( mAttributes );
@@ -203,7 +211,18 @@ bool QgsPointCloudLayerRenderer::render()
 int QgsPointCloudLayerRenderer::renderNodesSync( const QVector<IndexedPointCloudNode> &nodes, QgsPointCloudIndex *pc, QgsPointCloudRenderContext &context, QgsPointCloudRequest &request, bool &canceled )
 {
   int nodesDrawn = 0;
-  for ( const IndexedPointCloudNode &n : nodes )
+
+  // Nodes are decoded in parallel on a bounded pool of threads, while the decoded blocks are rendered
+  // in the order of the nodes. Only a limited number of nodes are decoded ahead of the node being rendered,
+  // so that memory use stays bounded and the rendering can be quickly canceled. The number of threads follows
+  // the limit set on the global pool, see QgsApplication::setMaxThreads()
+  QThreadPool pool;
+  pool.setMaxThreadCount( QThreadPool::globalInstance()->maxThreadCount() );
+  const int maxPendingNodes = 2 * std::max( pool.maxThreadCount(), 1 );
+  QVector< QFuture< QgsPointCloudBlock * > > decodedBlocks( nodes.size() );
+  int nextNodeToDecode = 0;
+
+  for ( int i = 0; i < nodes.size(); ++i )
   {
     if ( context.renderContext().renderingStopped() )
     {
@@ -211,7 +230,18 @@ int QgsPointCloudLayerRenderer::renderNodesSync( const QVector<IndexedPointCloud
       canceled = true;
       break;
     }
-    std::unique_ptr<QgsPointCloudBlock> block( pc->nodeData( n, request ) );
+
+    for ( ; nextNodeToDecode < nodes.size() && nextNodeToDecode <= i + maxPendingNodes; ++nextNodeToDecode )
+    {
+      const IndexedPointCloudNode n = nodes.at( nextNodeToDecode );
+      decodedBlocks[ nextNodeToDecode ] = QtConcurrent::run( &pool, [pc, n, request]
+      {
+        return pc->nodeData( n, request );
+      } );
+    }
+
+    std::unique_ptr<QgsPointCloudBlock> block( decodedBlocks[ i ].result() );
+    decodedBlocks[ i ] = QFuture< QgsPointCloudBlock * >();
 
     if ( !block )
       continue;
@@ -239,6 +269,16 @@ int QgsPointCloudLayerRenderer::renderNodesSync( const QVector<IndexedPointCloud
       mReadyToCompose = true;
     }
   }
+
+  // discard the blocks which were decoded ahead of a cancellation
+  pool.clear();
+  pool.waitForDone();
+  for ( const QFuture< QgsPointCloudBlock * > &decodedBlock : std::as_const( decodedBlocks ) )
+  {
+    if ( decodedBlock.resultCount() > 0 )
+      delete decodedBlock.result();
+  }
+
   return nodesDrawn;
 }
 
@@ -249,29 +289,36 @@ int QgsPointCloudLayerRenderer::renderNodesAsync( const QVector<IndexedPointClou
   QElapsedTimer downloadTimer;
   downloadTimer.start();
 
-  // Instead of loading all point blocks in parallel and then rendering the one by one,
-  // we split the processing into groups of size groupSize where we load the blocks of the group
-  // in parallel and then render the group's blocks sequentially.
+  // Blocks are requested ahead of the block being rendered, up to a maximum number of pending requests. Blocks
+  // are downloaded and decoded in parallel, and rendered in the order of the nodes as soon as they are available.
   // This way helps QGIS stay responsive if the nodes vector size is big
-  const int groupSize = 4;
-  for ( int groupIndex = 0; groupIndex < nodes.size(); groupIndex += groupSize )
+  const int maxPendingRequests = std::max( 4, QThread::idealThreadCount() );
+  QVector<QgsPointCloudBlockRequest *> blockRequests( nodes.size(), nullptr );
+  QVector<bool> finishedLoadingBlock( nodes.size(), false );
+  int nextNodeToRequest = 0;
+  int nodeToRender = 0;
+
+  QEventLoop loop;
+  if ( context.feedback() )
+    QObject::connect( context.feedback(), &QgsFeedback::canceled, &loop, &QEventLoop::quit );
+
+  for ( ; nodeToRender < nodes.size(); ++nodeToRender )
   {
     if ( context.feedback() && context.feedback()->isCanceled() )
       break;
-    // Async loading of nodes
-    const int currentGroupSize = std::min( std::max( nodes.size() - groupIndex, 0 ), groupSize );
-    QVector<QgsPointCloudBlockRequest *> blockRequests( currentGroupSize, nullptr );
-    QVector<bool> finishedLoadingBlock( currentGroupSize, false );
-    QEventLoop loop;
-    if ( context.feedback() )
-      QObject::connect( context.feedback(), &QgsFeedback::canceled, &loop, &QEventLoop::quit );
+
     // Note: All capture by reference warnings here shouldn't be an issue since we have an event loop, so locals won't be deallocated
-    for ( int i = 0; i < blockRequests.size(); ++i )
+    for ( ; nextNodeToRequest < nodes.size() && nextNodeToRequest < nodeToRender + maxPendingRequests; ++nextNodeToRequest )
     {
-      int nodeIndex = groupIndex + i;
-      const IndexedPointCloudNode &n = nodes[nodeIndex];
+      const int i = nextNodeToRequest;
+      const IndexedPointCloudNode &n = nodes[i];
       const QString nStr = n.toString();
       QgsPointCloudBlockRequest *blockRequest = pc->asyncNodeData( n, request );
+      if ( !blockRequest )
+      {
+        finishedLoadingBlock[ i ] = true;
+        continue;
+      }
       blockRequests[ i ] = blockRequest;
       QObject::connect( blockRequest, &QgsPointCloudBlockRequest::finished, &loop, [ &, i, nStr, blockRequest ]()
       {
@@ -280,62 +327,72 @@ int QgsPointCloudLayerRenderer::renderNodesAsync( const QVector<IndexedPointClou
           QgsDebugMsg( QStringLiteral( "Unable to load node %1, error: %2" ).arg( nStr, blockRequest->errorStr() ) );
         }
         finishedLoadingBlock[ i ] = true;
-        // If all blocks are loaded, exit the event loop
-        if ( !finishedLoadingBlock.contains( false ) ) loop.exit();
+        // If the next block to render is loaded, exit the event loop
+        if ( i == nodeToRender )
+          loop.exit();
       } );
     }
-    // Wait for all point cloud nodes to finish loading
-    loop.exec();
 
-    QgsDebugMsg( QStringLiteral( "Downloaded in : %1ms" ).arg( downloadTimer.elapsed() ) );
-    if ( !context.feedback()->isCanceled() )
+    // Wait for the next point cloud node to finish loading
+    if ( !finishedLoadingBlock[ nodeToRender ] )
+      loop.exec();
+
+    if ( !finishedLoadingBlock[ nodeToRender ] || ( context.feedback() && context.feedback()->isCanceled() ) )
+      break;
+
+    if ( context.renderContext().renderingStopped() )
     {
-      // Render all the point cloud blocks sequentially
-      for ( int i = 0; i < blockRequests.size(); ++i )
-      {
-        if ( context.renderContext().renderingStopped() )
-        {
-          QgsDebugMsgLevel( "canceled", 2 );
-          canceled = true;
-          break;
-        }
+      QgsDebugMsgLevel( "canceled", 2 );
+      canceled = true;
+      break;
+    }
 
-        if ( !blockRequests[ i ]->block() )
-          continue;
+    QgsPointCloudBlockRequest *blockRequest = blockRequests[ nodeToRender ];
+    blockRequests[ nodeToRender ] = nullptr;
+    if ( !blockRequest )
+      continue;
 
-        QgsVector3D contextScale = context.scale();
-        QgsVector3D contextOffset = context.offset();
+    std::unique_ptr< QgsPointCloudBlock > block( blockRequest->block() );
+    blockRequest->deleteLater();
+    if ( !block )
+      continue;
 
-        context.setScale( blockRequests[ i ]->block()->scale() );
-        context.setOffset( blockRequests[ i ]->block()->offset() );
+    QgsVector3D contextScale = context.scale();
+    QgsVector3D contextOffset = context.offset();
 
-        context.setAttributes( blockRequests[ i ]->block()->attributes() );
+    context.setScale( block->scale() );
+    context.setOffset( block->offset() );
 
-        mRenderer->renderBlock( blockRequests[ i ]->block(), context );
+    context.setAttributes( block->attributes() );
 
-        context.setScale( contextScale );
-        context.setOffset( contextOffset );
+    mRenderer->renderBlock( block.get(), context );
 
-        ++nodesDrawn;
+    context.setScale( contextScale );
+    context.setOffset( contextOffset );
 
-        // as soon as first block is rendered, we can start showing layer updates.
-        // but if we are blocking render updates (so that a previously cached image is being shown), we wait
-        // at most e.g. 3 seconds before we start forcing progressive updates.
-        if ( !mBlockRenderUpdates || mElapsedTimer.elapsed() > MAX_TIME_TO_USE_CACHED_PREVIEW_IMAGE )
-        {
-          mReadyToCompose = true;
-        }
-      }
+    ++nodesDrawn;
+
+    // as soon as first block is rendered, we can start showing layer updates.
+    // but if we are blocking render updates (so that a previously cached image is being shown), we wait
+    // at most e.g. 3 seconds before we start forcing progressive updates.
+    if ( !mBlockRenderUpdates || mElapsedTimer.elapsed() > MAX_TIME_TO_USE_CACHED_PREVIEW_IMAGE )
+    {
+      mReadyToCompose = true;
     }
+  }
+
+  QgsDebugMsgLevel( QStringLiteral( "Downloaded and rendered in : %1ms" ).arg( downloadTimer.elapsed() ), 2 );
 
-    for ( int i = 0; i < blockRequests.size(); ++i )
+  // the remaining requests were issued ahead of a cancellation. The blocks of finished requests belong to
+  // the renderer, those of the other requests are deleted with them. Requests are deleted right away, so that a
+  // block decoded in the meantime can't be delivered to a request waiting for deletion
+  for ( int i = 0; i < blockRequests.size(); ++i )
+  {
+    if ( blockRequests[ i ] )
     {
-      if ( blockRequests[ i ] )
-      {
-        if ( blockRequests[ i ]->block() )
-          delete blockRequests[ i ]->block();
-        blockRequests[ i ]->deleteLater();
-      }
+      if ( finishedLoadingBlock[ i ] )
+        delete blockRequests[ i ]->block();
+      delete blockRequests[ i ];
     }
   }
 
@@ -26,6 +26,8 @@
 #include "qgscircle.h"
 #include <QThread>
 #include <QPointer>
+#include <QPaintEngine>
+#include <algorithm>
 
 QgsPointCloudRenderContext::QgsPointCloudRenderContext( QgsRenderContext &context, const QgsVector3D &scale, const QgsVector3D &offset, double zValueScale, double zValueFixedOffset, QgsFeedback *feedback )
   : mRenderContext( context )
@@ -107,6 +109,216 @@ void QgsPointCloudRenderer::startRender( QgsPointCloudRenderContext &context )
   }
 }
 
+void QgsPointCloudRenderer::collectVisiblePoints( const QgsPointCloudBlock *block, QgsPointCloudRenderContext &context, QVector<int> &pointIndices, QVector<QPointF> &devicePoints ) const
+{
+  pointIndices.clear();
+  devicePoints.clear();
+
+  const QgsRectangle visibleExtent = context.renderContext().extent();
+  const QgsDoubleRange zRange = context.renderContext().zRange();
+  const bool considerZ = !zRange.isInfinite();
+
+  const char *ptr = block->data();
+  const int count = block->pointCount();
+  const std::size_t recordSize = context.pointRecordSize();
+  const int xOffset = context.xOffset();
+  const int yOffset = context.yOffset();
+  const int zOffset = context.zOffset();
+
+  const double offsetX = context.offset().x();
+  const double offsetY = context.offset().y();
+  const double offsetZ = context.offset().z();
+  const double scaleX = context.scale().x();
+  const double scaleY = context.scale().y();
+  const double scaleZ = context.scale().z();
+  const double zValueScale = context.zValueScale();
+  const double zValueFixedOffset = context.zValueFixedOffset();
+
+  QVector< double > x;
+  QVector< double > y;
+  QVector< double > z;
+  x.reserve( count );
+  y.reserve( count );
+  z.reserve( count );
+  pointIndices.reserve( count );
+
+  // be wary when copying this code!! In the renderer we explicitly request x/y/z as qint32 values, but in other
+  // situations these may be floats or doubles!
+  for ( int i = 0; i < count; ++i )
+  {
+    const char *record = ptr + i * recordSize;
+    double pointZ = 0;
+    if ( considerZ )
+    {
+      // z value filtering is cheapest, if we're doing it...
+      qint32 iz;
+      memcpy( &iz, record + zOffset, sizeof( qint32 ) );
+      pointZ = ( offsetZ + scaleZ * iz ) * zValueScale + zValueFixedOffset;
+      if ( !zRange.contains( pointZ ) )
+        continue;
+    }
+
+    qint32 ix;
+    qint32 iy;
+    memcpy( &ix, record + xOffset, sizeof( qint32 ) );
+    memcpy( &iy, record + yOffset, sizeof( qint32 ) );
+    const double pointX = offsetX + scaleX * ix;
+    const double pointY = offsetY + scaleY * iy;
+    if ( !visibleExtent.contains( pointX, pointY ) )
+      continue;
+
+    pointIndices << i;
+    x << pointX;
+    y << pointY;
+    z << pointZ;
+  }
+
+  if ( context.renderContext().renderingStopped() )
+  {
+    pointIndices.clear();
+    return;
+  }
+
+  const QgsCoordinateTransform ct = context.renderContext().coordinateTransform();
+  if ( ct.isValid() && !pointIndices.isEmpty() )
+  {
+    const QVector< double > sourceX = x;
+    const QVector< double > sourceY = y;
+    const QVector< double > sourceZ = z;
+    try
+    {
+      ct.transformInPlace( x, y, z );
+    }
+    catch ( QgsCsException & )
+    {
+      // some points could not be transformed, so transform the points one by one and skip these
+      int transformed = 0;
+      for ( int i = 0; i < sourceX.size(); ++i )
+      {
+        double pointX = sourceX.at( i );
+        double pointY = sourceY.at( i );
+        double pointZ = sourceZ.at( i );
+        try
+        {
+          ct.transformInPlace( pointX, pointY, pointZ );
+        }
+        catch ( QgsCsException & )
+        {
+          continue;
+        }
+        pointIndices[ transformed ] = pointIndices.at( i );
+        x[ transformed ] = pointX;
+        y[ transformed ] = pointY;
+        ++transformed;
+      }
+      pointIndices.resize( transformed );
+      x.resize( transformed );
+      y.resize( transformed );
+    }
+  }
+
+  const QgsMapToPixel &mapToPixel = context.renderContext().mapToPixel();
+  const int visibleCount = pointIndices.size();
+  devicePoints.resize( visibleCount );
+  QPointF *out = devicePoints.data();
+  for ( int i = 0; i < visibleCount; ++i )
+  {
+    double pointX = x.at( i );
+    double pointY = y.at( i );
+    mapToPixel.transformInPlace( pointX, pointY );
+    out[i] = QPointF( pointX, pointY );
+  }
+}
+
+void QgsPointCloudRenderer::drawPoints( const QVector<QPointF> &devicePoints, const QVector<QRgb> &colors, QgsPointCloudRenderContext &context ) const
+{
+  QPainter *painter = context.renderContext().painter();
+  const int count = devicePoints.size();
+  const double halfWidth = mPainterPenWidth * 0.5;
+
+  // Square points drawn on an image with a simple translation and no clipping can be written directly to the
+  // image scanlines. The rounding of the point rectangles matches the rounding done by the raster paint engine
+  // for aliased rectangles, so the result is identical to drawing them with QPainter::fillRect
+  QImage *image = nullptr;
+  if ( mPointSymbol == Square
+       && painter->paintEngine() && painter->paintEngine()->type() == QPaintEngine::Raster
+       && painter->device() && painter->device()->devType() == QInternal::Image
+       && !painter->hasClipping()
+       && painter->opacity() == 1.0
+       && painter->compositionMode() == QPainter::CompositionMode_SourceOver
+       && painter->deviceTransform().type() <= QTransform::TxTranslate )
+  {
+    image = static_cast< QImage * >( painter->device() );
+    if ( image->format() != QImage::Format_ARGB32_Premultiplied && image->format() != QImage::Format_ARGB32 && image->format() != QImage::Format_RGB32 )
+      image = nullptr;
+  }
+
+  if ( image )
+  {
+    const double dx = painter->deviceTransform().dx();
+    const double dy = painter->deviceTransform().dy();
+    const int imageWidth = image->width();
+    const int imageHeight = image->height();
+    const std::size_t bytesPerLine = image->bytesPerLine();
+    // the painter is already writing to the image data, so avoid detaching the image
+    uchar *bits = const_cast< uchar * >( image->constBits() );
+
+    for ( int i = 0; i < count; ++i )
+    {
+      const QRgb color = colors.at( i );
+      const int alpha = qAlpha( color );
+      if ( alpha == 0 )
+        continue;
+
+      const QRectF rect( devicePoints.at( i ).x() - halfWidth, devicePoints.at( i ).y() - halfWidth, mPainterPenWidth, mPainterPenWidth );
+      if ( alpha != 255 )
+      {
+        // blending is left to the paint engine
+        painter->fillRect( rect, QColor::fromRgba( color ) );
+        continue;
+      }
+
+      const int x1 = std::max( qRound( rect.left() + dx ), 0 );
+      const int x2 = std::min( qRound( rect.right() + dx ), imageWidth );
+      const int y1 = std::max( qRound( rect.top() + dy ), 0 );
+      const int y2 = std::min( qRound( rect.bottom() + dy ), imageHeight );
+      for ( int row = y1; row < y2; ++row )
+      {
+        QRgb *scanLine = reinterpret_cast< QRgb * >( bits + row * bytesPerLine );
+        std::fill( scanLine + x1, scanLine + std::max( x1, x2 ), color );
+      }
+    }
+    return;
+  }
+
+  switch ( mPointSymbol )
+  {
+    case Square:
+      for ( int i = 0; i < count; ++i )
+      {
+        if ( qAlpha( colors.at( i ) ) == 0 )
+          continue;
+        painter->fillRect( QRectF( devicePoints.at( i ).x() - halfWidth,
+                                   devicePoints.at( i ).y() - halfWidth,
+                                   mPainterPenWidth, mPainterPenWidth ), QColor::fromRgba( colors.at( i ) ) );
+      }
+      break;
+
+    case Circle:
+      painter->setPen( Qt::NoPen );
+      for ( int i = 0; i < count; ++i )
+      {
+        if ( qAlpha( colors.at( i ) ) == 0 )
+          continue;
+        painter->setBrush( QBrush( QColor::fromRgba( colors.at( i ) ) ) );
+        painter->drawEllipse( QRectF( devicePoints.at( i ).x() - halfWidth,
+                                      devicePoints.at( i ).y() - halfWidth,
+                                      mPainterPenWidth, mPainterPenWidth ) );
+      }
+      break;
+  }
+}
+
 void QgsPointCloudRenderer::stopRender( QgsPointCloudRenderContext & )
 {
 #ifdef QGISDEBUG
@@ -24,8 +24,10 @@
 #include "qgis_sip.h"
 #include "qgsvector3d.h"
 #include "qgspointcloudattribute.h"
+#include "qgspointcloudblock.h"
+
+#include <cstring>
 
-class QgsPointCloudBlock;
 class QgsLayerTreeLayer;
 class QgsLayerTreeModelLegendNode;
 class QgsPointCloudLayer;
@@ -552,6 +554,77 @@ class CORE_EXPORT QgsPointCloudRenderer
       };
     }
 
+#ifndef SIP_RUN
+
+    /**
+     * Collects the points of a \a block which are visible in the render context, i.e. those inside the visible
+     * extent and z range of the context which could be transformed to the destination CRS.
+     *
+     * The indices of the visible points in the block are stored in \a pointIndices, and their positions in
+     * painter device coordinates in \a devicePoints.
+     *
+     * This is considerably faster than calling pointXY(), pointZ() and drawPoint() for every point of the block,
+     * as the coordinates of the whole block are processed in tight loops and reprojected in a single batch.
+     *
+     * \note Not available in Python bindings.
+     * \since QGIS 3.22
+     */
+    void collectVisiblePoints( const QgsPointCloudBlock *block, QgsPointCloudRenderContext &context, QVector< int > &pointIndices, QVector< QPointF > &devicePoints ) const;
+
+    /**
+     * Retrieves the values of an attribute for the points of a \a block with the specified \a pointIndices, and
+     * stores them in \a values.
+     *
+     * The \a attributeOffset and \a type arguments give the offset of the attribute in a point record and its data type.
+     *
+     * \note Not available in Python bindings.
+     * \since QGIS 3.22
+     */
+    template <typename T>
+    static void attributeValues( const QgsPointCloudBlock *block, int attributeOffset, QgsPointCloudAttribute::DataType type,
+                                 const QVector< int > &pointIndices, QVector< T > &values )
+    {
+      // the switch on the attribute type is done once per block, so that the loop copying the values is type specialised
+      switch ( type )
+      {
+        case QgsPointCloudAttribute::Char:
+          copyAttributeValues< char >( block, attributeOffset, pointIndices, values );
+          return;
+
+        case QgsPointCloudAttribute::Int32:
+          copyAttributeValues< qint32 >( block, attributeOffset, pointIndices, values );
+          return;
+
+        case QgsPointCloudAttribute::Short:
+          copyAttributeValues< short >( block, attributeOffset, pointIndices, values );
+          return;
+
+        case QgsPointCloudAttribute::UShort:
+          copyAttributeValues< unsigned short >( block, attributeOffset, pointIndices, values );
+          return;
+
+        case QgsPointCloudAttribute::Float:
+          copyAttributeValues< float >( block, attributeOffset, pointIndices, values );
+          return;
+
+        case QgsPointCloudAttribute::Double:
+          copyAttributeValues< double >( block, attributeOffset, pointIndices, values );
+          return;
+      }
+    }
+
+    /**
+     * Draws points at the specified \a devicePoints (in painter device coordinates) using matching \a colors.
+     *
+     * When rendering square points to an image, opaque points are written directly to the image scanlines,
+     * instead of being drawn individually by the painter. Points with a fully transparent color are skipped.
+     *
+     * \note Not available in Python bindings.
+     * \since QGIS 3.22
+     */
+    void drawPoints( const QVector< QPointF > &devicePoints, const QVector< QRgb > &colors, QgsPointCloudRenderContext &context ) const;
+#endif
+
     /**
      * Copies common point cloud properties (such as point size and screen error) to the \a destination renderer.
      */
@@ -592,6 +665,25 @@ class CORE_EXPORT QgsPointCloudRenderer
 
     PointSymbol mPointSymbol = Square;
     int mPainterPenWidth = 1;
+
+#ifndef SIP_RUN
+    template <typename S, typename T>
+    static void copyAttributeValues( const QgsPointCloudBlock *block, int attributeOffset, const QVector< int > &pointIndices, QVector< T > &values )
+    {
+      const char *ptr = block->data() + attributeOffset;
+      const std::size_t recordSize = block->attributes().pointRecordSize();
+      const int count = pointIndices.size();
+      values.resize( count );
+      const int *indices = pointIndices.constData();
+      T *out = values.data();
+      for ( int i = 0; i < count; ++i )
+      {
+        S value;
+        memcpy( &value, ptr + indices[i] * recordSize, sizeof( S ) );
+        out[i] = static_cast< T >( value );
+      }
+    }
+#endif
 };
 
 #endif // QGSPOINTCLOUDRENDERER_H
@@ -56,13 +56,8 @@ QgsPointCloudRenderer *QgsPointCloudRgbRenderer::clone() const
 
 void QgsPointCloudRgbRenderer::renderBlock( const QgsPointCloudBlock *block, QgsPointCloudRenderContext &context )
 {
-  const QgsRectangle visibleExtent = context.renderContext().extent();
-
-  const char *ptr = block->data();
-  int count = block->pointCount();
   const QgsPointCloudAttributeCollection request = block->attributes();
 
-  const std::size_t recordSize = request.pointRecordSize();
   int redOffset = 0;
   const QgsPointCloudAttribute *attribute = request.find( mRedAttribute, redOffset );
   if ( !attribute )
@@ -85,82 +80,61 @@ void QgsPointCloudRgbRenderer::renderBlock( const QgsPointCloudBlock *block, Qgs
   const bool useBlueContrastEnhancement = mBlueContrastEnhancement && mBlueContrastEnhancement->contrastEnhancementAlgorithm() != QgsContrastEnhancement::NoEnhancement;
   const bool useGreenContrastEnhancement = mGreenContrastEnhancement && mGreenContrastEnhancement->contrastEnhancementAlgorithm() != QgsContrastEnhancement::NoEnhancement;
 
-  const QgsDoubleRange zRange = context.renderContext().zRange();
-  const bool considerZ = !zRange.isInfinite();
+  QVector< int > pointIndices;
+  QVector< QPointF > devicePoints;
+  collectVisiblePoints( block, context, pointIndices, devicePoints );
+  if ( pointIndices.isEmpty() || context.renderContext().renderingStopped() )
+    return;
+
+  QVector< int > redValues;
+  QVector< int > greenValues;
+  QVector< int > blueValues;
+  attributeValues( block, redOffset, redType, pointIndices, redValues );
+  attributeValues( block, greenOffset, greenType, pointIndices, greenValues );
+  attributeValues( block, blueOffset, blueType, pointIndices, blueValues );
 
+  const int count = pointIndices.size();
+  QVector< QRgb > colors( count );
   int rendered = 0;
-  double x = 0;
-  double y = 0;
-  double z = 0;
-  const QgsCoordinateTransform ct = context.renderContext().coordinateTransform();
-  const bool reproject = ct.isValid();
   for ( int i = 0; i < count; ++i )
   {
-    if ( context.renderContext().renderingStopped() )
+    int red = redValues.at( i );
+    int green = greenValues.at( i );
+    int blue = blueValues.at( i );
+
+    //skip if red, green or blue not in displayable range
+    if ( ( useRedContrastEnhancement && !mRedContrastEnhancement->isValueInDisplayableRange( red ) )
+         || ( useGreenContrastEnhancement && !mGreenContrastEnhancement->isValueInDisplayableRange( green ) )
+         || ( useBlueContrastEnhancement && !mBlueContrastEnhancement->isValueInDisplayableRange( blue ) ) )
     {
-      break;
+      // a fully transparent color is not drawn
+      colors[i] = 0;
+      continue;
     }
 
-    if ( considerZ )
+    //stretch color values
+    if ( useRedContrastEnhancement )
     {
-      // z value filtering is cheapest, if we're doing it...
-      z = pointZ( context, ptr, i );
-      if ( !zRange.contains( z ) )
-        continue;
+      red = mRedContrastEnhancement->enhanceContrast( red );
     }
-
-    pointXY( context, ptr, i, x, y );
-    if ( visibleExtent.contains( x, y ) )
+    if ( useGreenContrastEnhancement )
     {
-      if ( reproject )
-      {
-        try
-        {
-          ct.transformInPlace( x, y, z );
-        }
-        catch ( QgsCsException & )
-        {
-          continue;
-        }
-      }
-
-      int red = 0;
-      context.getAttribute( ptr, i * recordSize + redOffset, redType, red );
-      int green = 0;
-      context.getAttribute( ptr, i * recordSize + greenOffset, greenType, green );
-      int blue = 0;
-      context.getAttribute( ptr, i * recordSize + blueOffset, blueType, blue );
-
-      //skip if red, green or blue not in displayable range
-      if ( ( useRedContrastEnhancement && !mRedContrastEnhancement->isValueInDisplayableRange( red ) )
-           || ( useGreenContrastEnhancement && !mGreenContrastEnhancement->isValueInDisplayableRange( green ) )
-           || ( useBlueContrastEnhancement && !mBlueContrastEnhancement->isValueInDisplayableRange( blue ) ) )
-      {
-        continue;
-      }
-
-      //stretch color values
-      if ( useRedContrastEnhancement )
-      {
-        red = mRedContrastEnhancement->enhanceContrast( red );
-      }
-      if ( useGreenContrastEnhancement )
-      {
-        green = mGreenContrastEnhancement->enhanceContrast( green );
-      }
-      if ( useBlueContrastEnhancement )
-      {
-        blue = mBlueContrastEnhancement->enhanceContrast( blue );
-      }
-
-      red = std::max( 0, std::min( 255, red ) );
-      green = std::max( 0, std::min( 255, green ) );
-      blue = std::max( 0, std::min( 255, blue ) );
-
-      drawPoint( x, y, QColor( red, green, blue ), context );
-      rendered++;
+      green = mGreenContrastEnhancement->enhanceContrast( green );
     }
+    if ( useBlueContrastEnhancement )
+    {
+      blue = mBlueContrastEnhancement->enhanceContrast( blue );
+    }
+
+    red = std::max( 0, std::min( 255, red ) );
+    green = std::max( 0, std::min( 255, green ) );
+    blue = std::max( 0, std::min( 255, blue ) );
+
+    colors[i] = qRgb( red, green, blue );
+    rendered++;
   }
+
+  drawPoints( devicePoints, colors, context );
   context.incrementPointsRendered( rendered );
 }
 
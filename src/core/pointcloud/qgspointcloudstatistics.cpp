@@ -0,0 +1,514 @@
+/***************************************************************************
+  qgspointcloudstatistics.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgspointcloudstatistics.h"
+#include "qgspointcloudindex.h"
+#include "qgspointcloudblock.h"
+#include "qgspointcloudrequest.h"
+#include "qgspointcloudattribute.h"
+#include "qgsfeedback.h"
+#include "qgslogger.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQueue>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+double QgsPointCloudAttributeStatistics::stDev() const
+{
+  return count > 0 ? std::sqrt( m2 / count ) : std::numeric_limits< double >::quiet_NaN();
+}
+
+void QgsPointCloudAttributeStatistics::combineWith( const QgsPointCloudAttributeStatistics &other )
+{
+  if ( other.count == 0 )
+    return;
+
+  if ( count == 0 )
+  {
+    *this = other;
+    return;
+  }
+
+  // parallel variant of Welford's algorithm
+  const qint64 combinedCount = count + other.count;
+  const double delta = other.mean - mean;
+  mean += delta * other.count / combinedCount;
+  m2 += other.m2 + delta * delta * static_cast< double >( count ) * other.count / combinedCount;
+  count = combinedCount;
+  minimum = std::min( minimum, other.minimum );
+  maximum = std::max( maximum, other.maximum );
+
+  if ( histogram.size() == other.histogram.size() )
+  {
+    for ( int i = 0; i < histogram.size(); ++i )
+      histogram[i] += other.histogram.at( i );
+  }
+  belowHistogramCount += other.belowHistogramCount;
+  aboveHistogramCount += other.aboveHistogramCount;
+
+  for ( auto it = other.classCounts.constBegin(); it != other.classCounts.constEnd(); ++it )
+    classCounts[ it.key() ] += it.value();
+}
+
+///@cond PRIVATE
+
+struct QgsPointCloudStatisticsCalculator
+{
+  typedef QgsPointCloudStatistics result_type;
+
+  struct HistogramRange
+  {
+    double minimum = 0;
+    double maximum = 0;
+  };
+
+  QgsPointCloudStatisticsCalculator( QgsPointCloudIndex *index, const QgsPointCloudRequest &request, const QMap< QString, HistogramRange > &ranges, QgsFeedback *feedback )
+    : mIndex( index )
+    , mRequest( request )
+    , mRanges( ranges )
+    , mFeedback( feedback )
+  {}
+
+  template <typename T>
+  static double readValue( const char *ptr )
+  {
+    // the values of a point record are not aligned
+    T value;
+    memcpy( &value, ptr, sizeof( T ) );
+    return value;
+  }
+
+  static double readValue( const char *ptr, QgsPointCloudAttribute::DataType type )
+  {
+    switch ( type )
+    {
+      case QgsPointCloudAttribute::Char:
+        return *ptr;
+      case QgsPointCloudAttribute::Short:
+        return readValue< short >( ptr );
+      case QgsPointCloudAttribute::UShort:
+        return readValue< unsigned short >( ptr );
+      case QgsPointCloudAttribute::Int32:
+        return readValue< qint32 >( ptr );
+      case QgsPointCloudAttribute::Float:
+        return readValue< float >( ptr );
+      case QgsPointCloudAttribute::Double:
+        return readValue< double >( ptr );
+    }
+    return 0;
+  }
+
+  QgsPointCloudStatistics operator()( const IndexedPointCloudNode &node )
+  {
+    QgsPointCloudStatistics result;
+    if ( mFeedback && mFeedback->isCanceled() )
+      return result;
+
+    std::unique_ptr< QgsPointCloudBlock > block( mIndex->nodeData( node, mRequest ) );
+    if ( !block )
+      return result;
+
+    const char *data = block->data();
+    const int count = block->pointCount();
+    const QgsPointCloudAttributeCollection attributes = block->attributes();
+    const std::size_t recordSize = attributes.pointRecordSize();
+    const QgsVector3D scale = block->scale();
+    const QgsVector3D offset = block->offset();
+
+    int attributeOffset = 0;
+    const QVector< QgsPointCloudAttribute > attributeVector = attributes.attributes();
+    for ( const QgsPointCloudAttribute &attribute : attributeVector )
+    {
+      // coordinates are stored as integers, which must be scaled to the CRS units
+      double valueScale = 1;
+      double valueOffset = 0;
+      if ( attribute.name().compare( QLatin1String( "X" ), Qt::CaseInsensitive ) == 0 )
+      {
+        valueScale = scale.x();
+        valueOffset = offset.x();
+      }
+      else if ( attribute.name().compare( QLatin1String( "Y" ), Qt::CaseInsensitive ) == 0 )
+      {
+        valueScale = scale.y();
+        valueOffset = offset.y();
+      }
+      else if ( attribute.name().compare( QLatin1String( "Z" ), Qt::CaseInsensitive ) == 0 )
+      {
+        valueScale = scale.z();
+        valueOffset = offset.z();
+      }
+
+      const HistogramRange range = mRanges.value( attribute.name() );
+      const double binWidth = ( range.maximum - range.minimum ) / QgsPointCloudStatistics::HISTOGRAM_BIN_COUNT;
+      const bool isClassAttribute = attribute.type() == QgsPointCloudAttribute::Char;
+
+      QgsPointCloudAttributeStatistics stats;
+      stats.histogramMinimum = range.minimum;
+      stats.histogramMaximum = range.maximum;
+      stats.histogram.fill( 0, QgsPointCloudStatistics::HISTOGRAM_BIN_COUNT );
+      qint64 *histogram = stats.histogram.data();
+      qint64 classCounts[256] = { 0 };
+
+      const char *ptr = data + attributeOffset;
+      for ( int i = 0; i < count; ++i, ptr += recordSize )
+      {
+        const double value = readValue( ptr, attribute.type() ) * valueScale + valueOffset;
+
+        // Welford's algorithm
+        stats.count++;
+        const double delta = value - stats.mean;
+        stats.mean += delta / stats.count;
+        stats.m2 += delta * ( value - stats.mean );
+        stats.minimum = std::min( stats.minimum, value );
+        stats.maximum = std::max( stats.maximum, value );
+
+        if ( value < range.minimum )
+        {
+          stats.belowHistogramCount++;
+        }
+        else if ( value > range.maximum )
+        {
+          stats.aboveHistogramCount++;
+        }
+        else
+        {
+          // the maximum itself falls in the last bin
+          const int bin = binWidth > 0 ? static_cast< int >( ( value - range.minimum ) / binWidth ) : 0;
+          histogram[ std::min( bin, QgsPointCloudStatistics::HISTOGRAM_BIN_COUNT - 1 ) ]++;
+        }
+
+        if ( isClassAttribute )
+          classCounts[ static_cast< int >( *ptr ) + 128 ]++;
+      }
+
+      if ( isClassAttribute )
+      {
+        for ( int i = 0; i < 256; ++i )
+        {
+          if ( classCounts[i] > 0 )
+            stats.classCounts.insert( i - 128, classCounts[i] );
+        }
+      }
+
+      result.mStatistics.insert( attribute.name(), stats );
+      attributeOffset += attribute.size();
+    }
+
+    result.mPointCount = count;
+    result.mValid = true;
+    return result;
+  }
+
+  QgsPointCloudIndex *mIndex = nullptr;
+  QgsPointCloudRequest mRequest;
+  QMap< QString, HistogramRange > mRanges;
+  QgsFeedback *mFeedback = nullptr;
+};
+
+///@endcond
+
+QgsPointCloudStatistics QgsPointCloudStatistics::calculate( QgsPointCloudIndex *index, QgsFeedback *feedback )
+{
+  if ( !index || !index->isValid() )
+    return QgsPointCloudStatistics();
+
+  QVector< IndexedPointCloudNode > nodes;
+  QQueue< IndexedPointCloudNode > queue;
+  queue.enqueue( index->root() );
+  while ( !queue.isEmpty() )
+  {
+    const IndexedPointCloudNode node = queue.dequeue();
+    nodes << node;
+    const QList< IndexedPointCloudNode > children = index->nodeChildren( node );
+    for ( const IndexedPointCloudNode &child : children )
+      queue.enqueue( child );
+  }
+
+  const QgsPointCloudAttributeCollection attributes = index->attributes();
+  QgsPointCloudRequest request;
+  request.setAttributes( attributes );
+
+  // the histogram bins must be known before the points are read, so that the histograms of all nodes can be merged
+  QMap< QString, QgsPointCloudStatisticsCalculator::HistogramRange > ranges;
+  const QVector< QgsPointCloudAttribute > attributeVector = attributes.attributes();
+  for ( const QgsPointCloudAttribute &attribute : attributeVector )
+  {
+    const QVariant minimum = index->metadataStatistic( attribute.name(), QgsStatisticalSummary::Min );
+    const QVariant maximum = index->metadataStatistic( attribute.name(), QgsStatisticalSummary::Max );
+    if ( minimum.isValid() && maximum.isValid() )
+    {
+      QgsPointCloudStatisticsCalculator::HistogramRange range;
+      range.minimum = minimum.toDouble();
+      range.maximum = maximum.toDouble();
+      ranges.insert( attribute.name(), range );
+    }
+  }
+
+  // for attributes without metadata, use the range of the points of the root node, which are spread over the whole dataset.
+  // Points of other nodes may still be out of this range, they are counted apart from the histogram bins
+  QgsPointCloudStatisticsCalculator rootCalculator( index, request, ranges, feedback );
+  const QgsPointCloudStatistics rootStatistics = rootCalculator( index->root() );
+  for ( const QgsPointCloudAttribute &attribute : attributeVector )
+  {
+    if ( ranges.contains( attribute.name() ) )
+      continue;
+
+    const QgsPointCloudAttributeStatistics stats = rootStatistics.attributeStatistics( attribute.name() );
+    QgsPointCloudStatisticsCalculator::HistogramRange range;
+    if ( stats.count > 0 )
+    {
+      range.minimum = stats.minimum;
+      range.maximum = stats.maximum;
+    }
+    ranges.insert( attribute.name(), range );
+  }
+
+  const int nodeCount = nodes.size();
+  int processedNodes = 0;
+  QgsPointCloudStatistics statistics = QtConcurrent::blockingMappedReduced< QgsPointCloudStatistics >( nodes,
+                                       QgsPointCloudStatisticsCalculator( index, request, ranges, feedback ),
+                                       [feedback, nodeCount, &processedNodes]( QgsPointCloudStatistics & result, const QgsPointCloudStatistics & nodeStatistics )
+  {
+    result.combineWith( nodeStatistics );
+    processedNodes++;
+    if ( feedback )
+      feedback->setProgress( 100.0 * processedNodes / nodeCount );
+  },
+  QtConcurrent::UnorderedReduce );
+
+  if ( feedback && feedback->isCanceled() )
+    return QgsPointCloudStatistics();
+
+  return statistics;
+}
+
+QString QgsPointCloudStatistics::statisticsFilePath( const QgsPointCloudIndex *index )
+{
+  if ( !index || index->accessType() != QgsPointCloudIndex::Local || index->uri().isEmpty() )
+    return QString();
+
+  // e.g. "ept-stats.json" next to "ept.json"
+  const QFileInfo fi( index->uri() );
+  return fi.absolutePath() + '/' + fi.completeBaseName() + QStringLiteral( "-stats.json" );
+}
+
+QVariant QgsPointCloudStatistics::statistic( const QString &attribute, QgsStatisticalSummary::Statistic statistic ) const
+{
+  const auto it = mStatistics.constFind( attribute );
+  if ( it == mStatistics.constEnd() || it->count == 0 )
+    return QVariant();
+
+  const QgsPointCloudAttributeStatistics &stats = it.value();
+  switch ( statistic )
+  {
+    case QgsStatisticalSummary::Count:
+      return stats.count;
+
+    case QgsStatisticalSummary::Sum:
+      return stats.mean * stats.count;
+
+    case QgsStatisticalSummary::Mean:
+      return stats.mean;
+
+    case QgsStatisticalSummary::StDev:
+      return stats.stDev();
+
+    case QgsStatisticalSummary::StDevSample:
+      return stats.count > 1 ? QVariant( std::sqrt( stats.m2 / ( stats.count - 1 ) ) ) : QVariant();
+
+    case QgsStatisticalSummary::Min:
+      return stats.minimum;
+
+    case QgsStatisticalSummary::Max:
+      return stats.maximum;
+
+    case QgsStatisticalSummary::Range:
+      return stats.maximum - stats.minimum;
+
+    case QgsStatisticalSummary::Variety:
+      return stats.classCounts.isEmpty() ? QVariant() : QVariant( stats.classCounts.size() );
+
+    case QgsStatisticalSummary::CountMissing:
+    case QgsStatisticalSummary::Median:
+    case QgsStatisticalSummary::Minority:
+    case QgsStatisticalSummary::Majority:
+    case QgsStatisticalSummary::FirstQuartile:
+    case QgsStatisticalSummary::ThirdQuartile:
+    case QgsStatisticalSummary::InterQuartileRange:
+    case QgsStatisticalSummary::First:
+    case QgsStatisticalSummary::Last:
+    case QgsStatisticalSummary::All:
+      return QVariant();
+  }
+  return QVariant();
+}
+
+QVariantList QgsPointCloudStatistics::classes( const QString &attribute ) const
+{
+  QVariantList classes;
+  const QMap< int, qint64 > classCounts = mStatistics.value( attribute ).classCounts;
+  for ( auto it = classCounts.constBegin(); it != classCounts.constEnd(); ++it )
+    classes << it.key();
+  return classes;
+}
+
+QVariant QgsPointCloudStatistics::classStatistic( const QString &attribute, const QVariant &value, QgsStatisticalSummary::Statistic statistic ) const
+{
+  if ( statistic != QgsStatisticalSummary::Count )
+    return QVariant();
+
+  const QMap< int, qint64 > classCounts = mStatistics.value( attribute ).classCounts;
+  const auto it = classCounts.constFind( value.toInt() );
+  if ( it == classCounts.constEnd() )
+    return QVariant();
+  return it.value();
+}
+
+void QgsPointCloudStatistics::combineWith( const QgsPointCloudStatistics &other )
+{
+  if ( !other.mValid )
+    return;
+
+  for ( auto it = other.mStatistics.constBegin(); it != other.mStatistics.constEnd(); ++it )
+    mStatistics[ it.key() ].combineWith( it.value() );
+
+  mPointCount += other.mPointCount;
+  mValid = true;
+}
+
+bool QgsPointCloudStatistics::writeToFile( const QString &path ) const
+{
+  if ( !mValid )
+    return false;
+
+  QJsonObject attributesObject;
+  for ( auto it = mStatistics.constBegin(); it != mStatistics.constEnd(); ++it )
+  {
+    const QgsPointCloudAttributeStatistics &stats = it.value();
+    QJsonObject statsObject;
+    statsObject.insert( QStringLiteral( "count" ), static_cast< double >( stats.count ) );
+    statsObject.insert( QStringLiteral( "minimum" ), stats.minimum );
+    statsObject.insert( QStringLiteral( "maximum" ), stats.maximum );
+    statsObject.insert( QStringLiteral( "mean" ), stats.mean );
+    statsObject.insert( QStringLiteral( "m2" ), stats.m2 );
+
+    QJsonObject histogramObject;
+    histogramObject.insert( QStringLiteral( "minimum" ), stats.histogramMinimum );
+    histogramObject.insert( QStringLiteral( "maximum" ), stats.histogramMaximum );
+    QJsonArray bins;
+    for ( qint64 binCount : stats.histogram )
+      bins.append( static_cast< double >( binCount ) );
+    histogramObject.insert( QStringLiteral( "counts" ), bins );
+    histogramObject.insert( QStringLiteral( "below" ), static_cast< double >( stats.belowHistogramCount ) );
+    histogramObject.insert( QStringLiteral( "above" ), static_cast< double >( stats.aboveHistogramCount ) );
+    statsObject.insert( QStringLiteral( "histogram" ), histogramObject );
+
+    if ( !stats.classCounts.isEmpty() )
+    {
+      QJsonObject classesObject;
+      for ( auto classIt = stats.classCounts.constBegin(); classIt != stats.classCounts.constEnd(); ++classIt )
+        classesObject.insert( QString::number( classIt.key() ), static_cast< double >( classIt.value() ) );
+      statsObject.insert( QStringLiteral( "classes" ), classesObject );
+    }
+
+    attributesObject.insert( it.key(), statsObject );
+  }
+
+  QJsonObject root;
+  root.insert( QStringLiteral( "version" ), 1 );
+  root.insert( QStringLiteral( "points" ), static_cast< double >( mPointCount ) );
+  root.insert( QStringLiteral( "attributes" ), attributesObject );
+
+  // the file is replaced at once, as statistics for the same dataset may be calculated by several tasks
+  QSaveFile file( path );
+  if ( !file.open( QIODevice::WriteOnly ) )
+  {
+    QgsDebugMsgLevel( QStringLiteral( "Could not write point cloud statistics to %1" ).arg( path ), 2 );
+    return false;
+  }
+  if ( file.write( QJsonDocument( root ).toJson( QJsonDocument::Compact ) ) < 0 )
+    return false;
+  return file.commit();
+}
+
+bool QgsPointCloudStatistics::readFromFile( const QString &path, qint64 expectedPointCount )
+{
+  mValid = false;
+  mPointCount = 0;
+  mStatistics.clear();
+
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QJsonParseError error;
+  const QJsonDocument doc = QJsonDocument::fromJson( file.readAll(), &error );
+  if ( error.error != QJsonParseError::NoError )
+  {
+    QgsDebugMsgLevel( QStringLiteral( "QJsonParseError when reading point cloud statistics from file %1" ).arg( path ), 2 );
+    return false;
+  }
+
+  const QJsonObject root = doc.object();
+  if ( root.value( QLatin1String( "version" ) ).toInt() != 1 )
+    return false;
+
+  // statistics of an older version of the dataset
+  const qint64 pointCount = static_cast< qint64 >( root.value( QLatin1String( "points" ) ).toDouble() );
+  if ( pointCount != expectedPointCount )
+    return false;
+
+  const QJsonObject attributesObject = root.value( QLatin1String( "attributes" ) ).toObject();
+  for ( auto it = attributesObject.constBegin(); it != attributesObject.constEnd(); ++it )
+  {
+    const QJsonObject statsObject = it.value().toObject();
+    QgsPointCloudAttributeStatistics stats;
+    stats.count = static_cast< qint64 >( statsObject.value( QLatin1String( "count" ) ).toDouble() );
+    stats.minimum = statsObject.value( QLatin1String( "minimum" ) ).toDouble();
+    stats.maximum = statsObject.value( QLatin1String( "maximum" ) ).toDouble();
+    stats.mean = statsObject.value( QLatin1String( "mean" ) ).toDouble();
+    stats.m2 = statsObject.value( QLatin1String( "m2" ) ).toDouble();
+
+    const QJsonObject histogramObject = statsObject.value( QLatin1String( "histogram" ) ).toObject();
+    stats.histogramMinimum = histogramObject.value( QLatin1String( "minimum" ) ).toDouble();
+    stats.histogramMaximum = histogramObject.value( QLatin1String( "maximum" ) ).toDouble();
+    const QJsonArray bins = histogramObject.value( QLatin1String( "counts" ) ).toArray();
+    stats.histogram.reserve( bins.size() );
+    for ( const QJsonValue &binCount : bins )
+      stats.histogram << static_cast< qint64 >( binCount.toDouble() );
+    stats.belowHistogramCount = static_cast< qint64 >( histogramObject.value( QLatin1String( "below" ) ).toDouble() );
+    stats.aboveHistogramCount = static_cast< qint64 >( histogramObject.value( QLatin1String( "above" ) ).toDouble() );
+
+    const QJsonObject classesObject = statsObject.value( QLatin1String( "classes" ) ).toObject();
+    for ( auto classIt = classesObject.constBegin(); classIt != classesObject.constEnd(); ++classIt )
+      stats.classCounts.insert( classIt.key().toInt(), static_cast< qint64 >( classIt.value().toDouble() ) );
+
+    mStatistics.insert( it.key(), stats );
+  }
+
+  mPointCount = pointCount;
+  mValid = true;
+  return true;
+}
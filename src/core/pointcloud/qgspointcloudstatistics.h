@@ -0,0 +1,195 @@
+/***************************************************************************
+  qgspointcloudstatistics.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPOINTCLOUDSTATISTICS_H
+#define QGSPOINTCLOUDSTATISTICS_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+#include "qgsstatisticalsummary.h"
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <limits>
+
+class QgsPointCloudIndex;
+class QgsFeedback;
+
+/**
+ * \ingroup core
+ * \class QgsPointCloudAttributeStatistics
+ * \brief Statistics calculated for a single attribute of a point cloud.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsPointCloudAttributeStatistics
+{
+  public:
+
+    //! Number of points
+    qint64 count = 0;
+    //! Minimum value
+    double minimum = std::numeric_limits< double >::max();
+    //! Maximum value
+    double maximum = std::numeric_limits< double >::lowest();
+    //! Mean value
+    double mean = 0;
+    //! Sum of the squared differences from the mean
+    double m2 = 0;
+
+    //! Lower bound of the first histogram bin
+    double histogramMinimum = 0;
+    //! Upper bound of the last histogram bin
+    double histogramMaximum = 0;
+    //! Point counts of the histogram bins, which evenly split the range between histogramMinimum and histogramMaximum
+    QVector< qint64 > histogram;
+    //! Number of points with a value lower than histogramMinimum, which are not counted in the histogram bins
+    qint64 belowHistogramCount = 0;
+    //! Number of points with a value greater than histogramMaximum, which are not counted in the histogram bins
+    qint64 aboveHistogramCount = 0;
+
+    //! Point counts for each value of class attributes (8 bit attributes such as the LAS classification), or an empty map for other attributes
+    QMap< int, qint64 > classCounts;
+
+    /**
+     * Returns the population standard deviation of the values.
+     */
+    double stDev() const;
+
+    /**
+     * Merges the statistics calculated for another set of points.
+     *
+     * The histograms of both statistics must use the same bins.
+     */
+    void combineWith( const QgsPointCloudAttributeStatistics &other );
+};
+
+/**
+ * \ingroup core
+ * \class QgsPointCloudStatistics
+ * \brief Statistics calculated for all attributes of a point cloud, from all points of its index.
+ *
+ * Statistics are calculated with calculate() in a single parallel pass over the nodes of the index, and
+ * can be persisted with writeToFile() so that later sessions don't need to scan the points again.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsPointCloudStatistics
+{
+  public:
+
+    //! Number of bins of the attribute histograms
+    static constexpr int HISTOGRAM_BIN_COUNT = 256;
+
+    /**
+     * Constructor for an invalid QgsPointCloudStatistics.
+     */
+    QgsPointCloudStatistics() = default;
+
+    /**
+     * Calculates the statistics of all attributes of an \a index, reading the points of all its nodes.
+     *
+     * Nodes are read and processed in parallel. The ranges of the histograms are taken from the metadata
+     * of the index when available, or else from the points of the root node: values out of these ranges are
+     * not counted in the histogram bins, but in QgsPointCloudAttributeStatistics::belowHistogramCount and
+     * QgsPointCloudAttributeStatistics::aboveHistogramCount.
+     *
+     * The optional \a feedback argument can be used to report progress and to cancel the calculation, in which
+     * case invalid statistics are returned.
+     */
+    static QgsPointCloudStatistics calculate( QgsPointCloudIndex *index, QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns the path of the file used to persist the statistics of an \a index, next to the index files.
+     *
+     * Returns an empty string for remote indexes, whose statistics aren't persisted.
+     */
+    static QString statisticsFilePath( const QgsPointCloudIndex *index );
+
+    /**
+     * Returns TRUE if the statistics were successfully calculated or read.
+     */
+    bool isValid() const { return mValid; }
+
+    /**
+     * Returns the total number of points the statistics were calculated for.
+     */
+    qint64 pointCount() const { return mPointCount; }
+
+    /**
+     * Returns the names of the attributes with statistics.
+     */
+    QStringList attributes() const { return mStatistics.keys(); }
+
+    /**
+     * Returns the statistics of an \a attribute, or default statistics if the attribute is unknown.
+     */
+    QgsPointCloudAttributeStatistics attributeStatistics( const QString &attribute ) const { return mStatistics.value( attribute ); }
+
+    /**
+     * Returns a \a statistic of the specified \a attribute, or an invalid variant if the statistic is not available.
+     */
+    QVariant statistic( const QString &attribute, QgsStatisticalSummary::Statistic statistic ) const;
+
+    /**
+     * Returns the classes present in the specified \a attribute, or an empty list if the attribute is not a class attribute.
+     */
+    QVariantList classes( const QString &attribute ) const;
+
+    /**
+     * Returns a \a statistic of a class \a value of the specified \a attribute, or an invalid variant if the statistic is not available.
+     */
+    QVariant classStatistic( const QString &attribute, const QVariant &value, QgsStatisticalSummary::Statistic statistic ) const;
+
+    /**
+     * Merges the statistics calculated for another set of points.
+     */
+    void combineWith( const QgsPointCloudStatistics &other );
+
+    /**
+     * Writes the statistics to a file at the specified \a path.
+     *
+     * Returns FALSE if the file could not be written.
+     *
+     * \see readFromFile()
+     */
+    bool writeToFile( const QString &path ) const;
+
+    /**
+     * Reads statistics previously written with writeToFile() from a file at the specified \a path.
+     *
+     * Returns FALSE if the file could not be read, or if it was written for an index with a different
+     * number of points than \a expectedPointCount.
+     *
+     * \see writeToFile()
+     */
+    bool readFromFile( const QString &path, qint64 expectedPointCount );
+
+  private:
+
+    bool mValid = false;
+    qint64 mPointCount = 0;
+    QMap< QString, QgsPointCloudAttributeStatistics > mStatistics;
+
+    friend struct QgsPointCloudStatisticsCalculator;
+};
+
+#endif // QGSPOINTCLOUDSTATISTICS_H
@@ -0,0 +1,56 @@
+/***************************************************************************
+  qgspointcloudstatisticscalculationtask.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgspointcloudstatisticscalculationtask.h"
+#include "qgspointclouddataprovider.h"
+#include "qgsproviderregistry.h"
+#include "qgsfeedback.h"
+#include "qgsreadwritelocker.h"
+
+QgsPointCloudStatisticsCalculationTask::QgsPointCloudStatisticsCalculationTask( const QString &uri, const QString &providerKey, const QgsDataProvider::ProviderOptions &options )
+  : QgsTask( tr( "Calculating point cloud statistics" ), QgsTask::CanCancel | QgsTask::CancelWithoutPrompt )
+  , mProvider( qobject_cast< QgsPointCloudDataProvider * >( QgsProviderRegistry::instance()->createProvider( providerKey, uri, options ) ) )
+  , mFeedback( std::make_unique< QgsFeedback >() )
+{
+  connect( mFeedback.get(), &QgsFeedback::progressChanged, this, &QgsPointCloudStatisticsCalculationTask::setProgress );
+}
+
+QgsPointCloudStatisticsCalculationTask::~QgsPointCloudStatisticsCalculationTask() = default;
+
+QgsPointCloudStatistics QgsPointCloudStatisticsCalculationTask::statistics() const
+{
+  QgsReadWriteLocker locker( mLock, QgsReadWriteLocker::Read );
+  return mStatistics;
+}
+
+void QgsPointCloudStatisticsCalculationTask::cancel()
+{
+  mFeedback->cancel();
+
+  QgsTask::cancel();
+}
+
+bool QgsPointCloudStatisticsCalculationTask::run()
+{
+  if ( !mProvider || !mProvider->isValid() )
+    return false;
+
+  if ( !mProvider->calculateStatistics( mFeedback.get() ) )
+    return false;
+
+  QgsReadWriteLocker locker( mLock, QgsReadWriteLocker::Write );
+  mStatistics = mProvider->statistics();
+  return mStatistics.isValid();
+}
@@ -0,0 +1,83 @@
+/***************************************************************************
+  qgspointcloudstatisticscalculationtask.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPOINTCLOUDSTATISTICSCALCULATIONTASK_H
+#define QGSPOINTCLOUDSTATISTICSCALCULATIONTASK_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+#include "qgstaskmanager.h"
+#include "qgsdataprovider.h"
+#include "qgspointcloudstatistics.h"
+
+#include <QReadWriteLock>
+#include <memory>
+
+class QgsFeedback;
+class QgsPointCloudDataProvider;
+
+/**
+ * \ingroup core
+ *
+ * \brief A QgsTask which calculates the statistics of a point cloud in a background thread.
+ *
+ * The task opens its own data provider for the point cloud, so that it does not depend on the
+ * lifetime of the layer which started it. The calculated statistics are persisted next to the index
+ * of local point clouds, see QgsPointCloudDataProvider::calculateStatistics().
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsPointCloudStatisticsCalculationTask : public QgsTask
+{
+    Q_OBJECT
+
+  public:
+
+    /**
+     * Constructor for QgsPointCloudStatisticsCalculationTask, calculating the statistics of the point cloud
+     * with the specified \a uri, read by the data provider with matching \a providerKey.
+     *
+     * The data provider is created in the constructor, which must be called from the main thread.
+     */
+    QgsPointCloudStatisticsCalculationTask( const QString &uri, const QString &providerKey, const QgsDataProvider::ProviderOptions &options );
+
+    ~QgsPointCloudStatisticsCalculationTask() override;
+
+    /**
+     * Returns the statistics calculated by the task, or invalid statistics if the task
+     * failed or was canceled.
+     */
+    QgsPointCloudStatistics statistics() const;
+
+    void cancel() override;
+
+  protected:
+
+    bool run() override;
+
+  private:
+
+    std::unique_ptr< QgsPointCloudDataProvider > mProvider;
+
+    std::unique_ptr< QgsFeedback > mFeedback;
+
+    QgsPointCloudStatistics mStatistics;
+
+    mutable QReadWriteLock mLock;
+};
+
+#endif // QGSPOINTCLOUDSTATISTICSCALCULATIONTASK_H
@@ -76,6 +76,7 @@ QList<IndexedPointCloudNode> QgsRemoteEptPointCloudIndex::nodeChildren( const In
 void QgsRemoteEptPointCloudIndex::load( const QString &url )
 {
   mUrl = QUrl( url );
+  mUri = url;
 
   QStringList splitUrl = url.split( '/' );
 
@@ -100,6 +101,11 @@ void QgsRemoteEptPointCloudIndex::load( const QString &url )
 
 QgsPointCloudBlock *QgsRemoteEptPointCloudIndex::nodeData( const IndexedPointCloudNode &n, const QgsPointCloudRequest &request )
 {
+  if ( QgsPointCloudBlock *cached = getNodeDataFromCache( n, request ) )
+  {
+    return cached;
+  }
+
   std::unique_ptr<QgsPointCloudBlockRequest> blockRequest( asyncNodeData( n, request ) );
   if ( !blockRequest )
     return nullptr;
@@ -118,6 +124,11 @@ QgsPointCloudBlock *QgsRemoteEptPointCloudIndex::nodeData( const IndexedPointClo
 
 QgsPointCloudBlockRequest *QgsRemoteEptPointCloudIndex::asyncNodeData( const IndexedPointCloudNode &n, const QgsPointCloudRequest &request )
 {
+  if ( QgsPointCloudBlock *cached = getNodeDataFromCache( n, request ) )
+  {
+    return new QgsPointCloudBlockRequest( n, cached );
+  }
+
   if ( !loadNodeHierarchy( n ) )
     return nullptr;
 
@@ -139,7 +150,15 @@ QgsPointCloudBlockRequest *QgsRemoteEptPointCloudIndex::asyncNodeData( const Ind
     return nullptr;
   }
 
-  return new QgsPointCloudBlockRequest( n, fileUrl, mDataType, attributes(), request.attributes(), scale(), offset() );
+  QgsPointCloudBlockRequest *blockRequest = new QgsPointCloudBlockRequest( n, fileUrl, mDataType, attributes(), request.attributes(), scale(), offset() );
+  // store the decoded block in the cache when it is loaded. This connection is made before any connection made by the caller,
+  // so it is triggered before the caller takes ownership of the block
+  const QString uri = mUri;
+  connect( blockRequest, &QgsPointCloudBlockRequest::finished, blockRequest, [blockRequest, n, request, uri]
+  {
+    QgsPointCloudIndex::storeNodeDataToCache( blockRequest->block(), n, request, uri );
+  } );
+  return blockRequest;
 }
 
 bool QgsRemoteEptPointCloudIndex::hasNode( const IndexedPointCloudNode &n ) const
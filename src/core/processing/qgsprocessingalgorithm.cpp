@@ -30,6 +30,82 @@
 #include "qgsmeshlayer.h"
 #include "qgsexpressioncontextutils.h"
 
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+///@cond PRIVATE
+
+//! Maximum number of features processed by each thread in one go by parallel feature based algorithms
+static const int PARALLEL_FEATURE_BLOCK_SIZE = 256;
+
+/**
+ * Feedback which stores the messages reported while processing a block of features in a worker
+ * thread, so that they can be reported in feature order from the algorithm's thread.
+ */
+class QgsProcessingFeatureBlockFeedback : public QgsProcessingFeedback
+{
+  public:
+
+    QgsProcessingFeatureBlockFeedback()
+      : QgsProcessingFeedback( false )
+    {}
+
+    void setProgressText( const QString & ) override {}
+    void reportError( const QString &error, bool fatalError ) override { mMessages.append( qMakePair( fatalError ? FatalError : Error, error ) ); }
+    void pushWarning( const QString &warning ) override { mMessages.append( qMakePair( Warning, warning ) ); }
+    void pushInfo( const QString &info ) override { mMessages.append( qMakePair( Info, info ) ); }
+    void pushCommandInfo( const QString &info ) override { mMessages.append( qMakePair( CommandInfo, info ) ); }
+    void pushDebugInfo( const QString &info ) override { mMessages.append( qMakePair( DebugInfo, info ) ); }
+    void pushConsoleInfo( const QString &info ) override { mMessages.append( qMakePair( ConsoleInfo, info ) ); }
+
+    //! Reports the stored messages to \a feedback, and clears them
+    void flush( QgsProcessingFeedback *feedback )
+    {
+      for ( const QPair< MessageType, QString > &message : std::as_const( mMessages ) )
+      {
+        switch ( message.first )
+        {
+          case Error:
+          case FatalError:
+            feedback->reportError( message.second, message.first == FatalError );
+            break;
+          case Warning:
+            feedback->pushWarning( message.second );
+            break;
+          case Info:
+            feedback->pushInfo( message.second );
+            break;
+          case CommandInfo:
+            feedback->pushCommandInfo( message.second );
+            break;
+          case DebugInfo:
+            feedback->pushDebugInfo( message.second );
+            break;
+          case ConsoleInfo:
+            feedback->pushConsoleInfo( message.second );
+            break;
+        }
+      }
+      mMessages.clear();
+    }
+
+  private:
+
+    enum MessageType
+    {
+      Error,
+      FatalError,
+      Warning,
+      Info,
+      CommandInfo,
+      DebugInfo,
+      ConsoleInfo,
+    };
+
+    QList< QPair< MessageType, QString > > mMessages;
+};
+
+///@endcond PRIVATE
 
 QgsProcessingAlgorithm::~QgsProcessingAlgorithm()
 {
@@ -1007,20 +1083,107 @@ QVariantMap QgsProcessingFeatureBasedAlgorithm::processAlgorithm( const QVariant
 
   double step = count > 0 ? 100.0 / count : 1;
   int current = 0;
-  while ( it.nextFeature( f ) )
+
+  const int threadCount = QThreadPool::globalInstance()->maxThreadCount();
+  if ( ( flags() & FlagSupportsParallelFeatureProcessing ) && threadCount > 1 )
   {
-    if ( feedback->isCanceled() )
+    // features are read in batches, split into one block of consecutive features per thread.
+    // Each block is processed with its own context and feedback, then the output features and messages
+    // of the blocks are written in order
+    struct Block
+    {
+      std::unique_ptr< QgsProcessingContext > context;
+      std::unique_ptr< QgsProcessingFeatureBlockFeedback > feedback;
+      QgsFeatureList features;
+      QgsFeatureList results;
+      QString error;
+    };
+
+    std::vector< Block > blocks( threadCount );
+    for ( Block &block : blocks )
+    {
+      block.context = std::make_unique< QgsProcessingContext >();
+      block.context->copyThreadSafeSettings( context );
+      block.feedback = std::make_unique< QgsProcessingFeatureBlockFeedback >();
+      QObject::connect( feedback, &QgsFeedback::canceled, block.feedback.get(), &QgsFeedback::cancel, Qt::DirectConnection );
+    }
+
+    auto processBlock = [this, feedback]( Block & block )
+    {
+      try
+      {
+        for ( const QgsFeature &feature : std::as_const( block.features ) )
+        {
+          if ( feedback->isCanceled() )
+            break;
+
+          block.context->expressionContext().setFeature( feature );
+          block.results.append( processFeature( feature, *block.context, block.feedback.get() ) );
+        }
+      }
+      // exceptions must not escape the worker threads, they are rethrown as processing exceptions
+      // from the algorithm's thread and reported to the feedback
+      catch ( QgsException &e )
+      {
+        block.error = e.what();
+      }
+      catch ( std::exception &e )
+      {
+        block.error = QString::fromLocal8Bit( e.what() );
+      }
+      catch ( ... )
+      {
+        block.error = QObject::tr( "Unknown error while processing feature" );
+      }
+    };
+
+    bool finished = false;
+    while ( !finished && !feedback->isCanceled() )
     {
-      break;
+      auto blockEnd = blocks.begin();
+      for ( ; blockEnd != blocks.end() && !finished; ++blockEnd )
+      {
+        blockEnd->features.clear();
+        blockEnd->results.clear();
+        while ( blockEnd->features.size() < PARALLEL_FEATURE_BLOCK_SIZE && it.nextFeature( f ) )
+          blockEnd->features.append( f );
+
+        finished = blockEnd->features.size() < PARALLEL_FEATURE_BLOCK_SIZE;
+      }
+
+      QtConcurrent::blockingMap( blocks.begin(), blockEnd, processBlock );
+
+      for ( auto block = blocks.begin(); block != blockEnd; ++block )
+      {
+        block->feedback->flush( feedback );
+        if ( !block->error.isEmpty() )
+          throw QgsProcessingException( block->error );
+
+        for ( QgsFeature transformedFeature : std::as_const( block->results ) )
+          sink->addFeature( transformedFeature, QgsFeatureSink::FastInsert );
+
+        current += block->features.size();
+      }
+      feedback->setProgress( current * step );
     }
+  }
+  else
+  {
+    while ( it.nextFeature( f ) )
+    {
+      if ( feedback->isCanceled() )
+      {
+        break;
+      }
 
-    context.expressionContext().setFeature( f );
-    const QgsFeatureList transformed = processFeature( f, context, feedback );
-    for ( QgsFeature transformedFeature : transformed )
-      sink->addFeature( transformedFeature, QgsFeatureSink::FastInsert );
+      context.expressionContext().setFeature( f );
+      const QgsFeatureList transformed = processFeature( f, context, feedback );
+      for ( QgsFeature transformedFeature : transformed )
+        sink->addFeature( transformedFeature, QgsFeatureSink::FastInsert );
 
-    feedback->setProgress( current * step );
-    current++;
+      feedback->setProgress( current * step );
+      current++;
+    }
   }
 
   mSource.reset();
@@ -81,6 +81,7 @@ class CORE_EXPORT QgsProcessingAlgorithm
       FlagSkipGenericModelLogging = 1 << 12, //!< When running as part of a model, the generic algorithm setup and results logging should be skipped
       FlagNotAvailableInStandaloneTool = 1 << 13, //!< Algorithm should not be available from the standalone "qgis_process" tool. Used to flag algorithms which make no sense outside of the QGIS application, such as "select by..." style algorithms.
       FlagRequiresProject = 1 << 14, //!< The algorithm requires that a valid QgsProject is available from the processing context in order to execute
+      FlagSupportsParallelFeatureProcessing = 1 << 15, //!< The algorithm's QgsProcessingFeatureBasedAlgorithm::processFeature() implementation is thread safe, allowing features to be processed in parallel (since QGIS 3.22)
       FlagDeprecated = FlagHideFromToolbox | FlagHideFromModeler, //!< Algorithm is deprecated
     };
     Q_DECLARE_FLAGS( Flags, Flag )
@@ -1114,6 +1115,13 @@ class CORE_EXPORT QgsProcessingFeatureBasedAlgorithm : public QgsProcessingAlgor
      * prevent the algorithm execution from continuing. This can be annoying for users though as it
      * can break valid model execution - so use with extreme caution, and consider using
      * \a feedback to instead report non-fatal processing failures for features instead.
+     *
+     * If the algorithm's flags() include QgsProcessingAlgorithm::FlagSupportsParallelFeatureProcessing, this
+     * method is called concurrently from multiple threads, with a separate \a context and \a feedback for
+     * each thread. Implementations must then not modify any algorithm state. Output features are still
+     * written to the sink in the order of the input features, and messages pushed to \a feedback
+     * are reported in the same order. Any exception raised by this method stops the algorithm with a
+     * QgsProcessingException holding the exception's message.
      */
     virtual QgsFeatureList processFeature( const QgsFeature &feature, QgsProcessingContext &context, QgsProcessingFeedback *feedback ) SIP_THROW( QgsProcessingException ) = 0 SIP_VIRTUALERRORHANDLER( processing_exception_handler );
 
@@ -94,12 +94,14 @@ qint64 QgsEptProvider::pointCount() const
 
 QVariantList QgsEptProvider::metadataClasses( const QString &attribute ) const
 {
-  return mIndex->metadataClasses( attribute );
+  const QVariantList classes = mIndex->metadataClasses( attribute );
+  return !classes.isEmpty() ? classes : QgsPointCloudDataProvider::metadataClasses( attribute );
 }
 
 QVariant QgsEptProvider::metadataClassStatistic( const QString &attribute, const QVariant &value, QgsStatisticalSummary::Statistic statistic ) const
 {
-  return mIndex->metadataClassStatistic( attribute, value, statistic );
+  const QVariant result = mIndex->metadataClassStatistic( attribute, value, statistic );
+  return result.isValid() ? result : QgsPointCloudDataProvider::metadataClassStatistic( attribute, value, statistic );
 }
 
 void QgsEptProvider::loadIndex( )
@@ -122,7 +124,8 @@ void QgsEptProvider::generateIndex()
 
 QVariant QgsEptProvider::metadataStatistic( const QString &attribute, QgsStatisticalSummary::Statistic statistic ) const
 {
-  return mIndex->metadataStatistic( attribute, statistic );
+  const QVariant result = mIndex->metadataStatistic( attribute, statistic );
+  return result.isValid() ? result : QgsPointCloudDataProvider::metadataStatistic( attribute, statistic );
 }
 
 QgsEptProviderMetadata::QgsEptProviderMetadata():
@@ -173,6 +176,8 @@ bool QgsEptProviderMetadata::uriIsBlocklisted( const QString &uri ) const
   // internal details only
   if ( fi.fileName().compare( QLatin1String( "ept-build.json" ), Qt::CaseInsensitive ) == 0 )
     return true;
+  if ( fi.fileName().compare( QLatin1String( "ept-stats.json" ), Qt::CaseInsensitive ) == 0 )
+    return true;
 
   return false;
 }
@@ -0,0 +1,508 @@
+/***************************************************************************
+  qgsgdaloverviewbuilder.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsgdaloverviewbuilder.h"
+#include "qgsrasterinterface.h"
+#include "qgslogger.h"
+
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+///@cond PRIVATE
+
+//! Width and height of the overview tiles computed by each task
+static constexpr int TILE_SIZE = 256;
+
+static bool nearestKernel( const double *values, const unsigned char *noData, int width, int height, double &result )
+{
+  // the pixel at the center of the window, like GDAL
+  const int index = ( height / 2 ) * width + width / 2;
+  result = values[index];
+  return !noData[index];
+}
+
+static bool averageKernel( const double *values, const unsigned char *noData, int width, int height, double &result )
+{
+  double sum = 0;
+  int count = 0;
+  for ( int i = 0; i < width * height; ++i )
+  {
+    if ( noData[i] )
+      continue;
+    sum += values[i];
+    count++;
+  }
+  if ( count == 0 )
+    return false;
+  result = sum / count;
+  return true;
+}
+
+static bool minimumKernel( const double *values, const unsigned char *noData, int width, int height, double &result )
+{
+  bool found = false;
+  for ( int i = 0; i < width * height; ++i )
+  {
+    if ( noData[i] )
+      continue;
+    result = found ? std::min( result, values[i] ) : values[i];
+    found = true;
+  }
+  return found;
+}
+
+static bool maximumKernel( const double *values, const unsigned char *noData, int width, int height, double &result )
+{
+  bool found = false;
+  for ( int i = 0; i < width * height; ++i )
+  {
+    if ( noData[i] )
+      continue;
+    result = found ? std::max( result, values[i] ) : values[i];
+    found = true;
+  }
+  return found;
+}
+
+static bool modeKernel( const double *values, const unsigned char *noData, int width, int height, double &result )
+{
+  std::vector< double > sorted;
+  sorted.reserve( static_cast< std::size_t >( width ) * height );
+  for ( int i = 0; i < width * height; ++i )
+  {
+    if ( !noData[i] )
+      sorted.push_back( values[i] );
+  }
+  if ( sorted.empty() )
+    return false;
+
+  // most frequent value, the smallest one in case of ties
+  std::sort( sorted.begin(), sorted.end() );
+  std::size_t bestCount = 0;
+  for ( std::size_t start = 0; start < sorted.size(); )
+  {
+    std::size_t end = start + 1;
+    while ( end < sorted.size() && sorted[end] == sorted[start] )
+      end++;
+    if ( end - start > bestCount )
+    {
+      bestCount = end - start;
+      result = sorted[start];
+    }
+    start = end;
+  }
+  return true;
+}
+
+QgsGdalOverviewBuilder::Kernel QgsGdalOverviewBuilder::kernel( const QString &method )
+{
+  const QString upperMethod = method.toUpper();
+  if ( upperMethod == QLatin1String( "NEAREST" ) )
+    return nearestKernel;
+  else if ( upperMethod == QLatin1String( "AVERAGE" ) )
+    return averageKernel;
+  else if ( upperMethod == QLatin1String( "MIN" ) )
+    return minimumKernel;
+  else if ( upperMethod == QLatin1String( "MAX" ) )
+    return maximumKernel;
+  else if ( upperMethod == QLatin1String( "MODE" ) )
+    return modeKernel;
+  return nullptr;
+}
+
+bool QgsGdalOverviewBuilder::canBuild( GDALDatasetH dataset )
+{
+  const int bandCount = GDALGetRasterCount( dataset );
+  if ( bandCount == 0 )
+    return false;
+
+  for ( int bandNo = 1; bandNo <= bandCount; ++bandNo )
+  {
+    GDALRasterBandH band = GDALGetRasterBand( dataset, bandNo );
+    if ( GDALDataTypeIsComplex( GDALGetRasterDataType( band ) ) )
+      return false;
+
+    // masks and alpha bands need overviews of their own, which GDAL computes together with the bands
+    if ( GDALGetRasterColorInterpretation( band ) == GCI_AlphaBand )
+      return false;
+    const int maskFlags = GDALGetMaskFlags( band );
+    if ( !( maskFlags & GMF_ALL_VALID ) && !( maskFlags & GMF_NODATA ) )
+      return false;
+  }
+  return true;
+}
+
+QgsGdalOverviewBuilder::QgsGdalOverviewBuilder( GDALDatasetH dataset, Kernel kernel )
+  : mDataset( dataset )
+  , mKernel( kernel )
+{
+}
+
+bool QgsGdalOverviewBuilder::canCascade( GDALRasterBandH band ) const
+{
+  if ( mKernel == minimumKernel || mKernel == maximumKernel )
+    return true;
+
+  // the average of the averages is only the average of all the values if none of them is skipped
+  // (nodata values, or NaN values, see build()), if all the averages cover the same number of values
+  // and if the averages are stored without being rounded. Overviews of integer bands store rounded
+  // values, which would accumulate rounding errors from one level to the next
+  if ( mKernel == averageKernel )
+  {
+    int hasNoData = 0;
+    GDALGetRasterNoDataValue( band, &hasNoData );
+    return !hasNoData && GDALDataTypeIsFloating( GDALGetRasterDataType( band ) );
+  }
+
+  // e.g. the mode of the modes is not the mode of all the values
+  return false;
+}
+
+bool QgsGdalOverviewBuilder::build( const QVector<int> &levels, QgsRasterBlockFeedback *feedback )
+{
+  if ( !mDataset || !mKernel )
+    return false;
+
+  QVector< int > sortedLevels;
+  for ( int level : levels )
+  {
+    if ( level > 1 && !sortedLevels.contains( level ) )
+      sortedLevels << level;
+  }
+  std::sort( sortedLevels.begin(), sortedLevels.end() );
+
+  // find all the overviews before computing anything
+  const int bandCount = GDALGetRasterCount( mDataset );
+  const int width = GDALGetRasterXSize( mDataset );
+  const int height = GDALGetRasterYSize( mDataset );
+  QVector< Step > steps;
+  qint64 totalPixels = 0;
+  for ( int level : std::as_const( sortedLevels ) )
+  {
+    Step step;
+    // same size as GDAL uses for the overviews
+    step.width = ( width + level - 1 ) / level;
+    step.height = ( height + level - 1 ) / level;
+    steps << step;
+    totalPixels += static_cast< qint64 >( step.width ) * step.height * bandCount;
+  }
+
+  //! The overviews of a band, and whether they can be computed from each other
+  struct BandLevels
+  {
+    int bandNo = 0;
+    bool hasNoData = false;
+    double noData = 0;
+    bool cascade = false;
+    QVector< GDALRasterBandH > overviews;
+  };
+
+  QVector< BandLevels > bands;
+  for ( int bandNo = 1; bandNo <= bandCount; ++bandNo )
+  {
+    GDALRasterBandH band = GDALGetRasterBand( mDataset, bandNo );
+    BandLevels bandLevels;
+    bandLevels.bandNo = bandNo;
+    int hasNoData = 0;
+    bandLevels.noData = GDALGetRasterNoDataValue( band, &hasNoData );
+    bandLevels.hasNoData = hasNoData;
+    bandLevels.cascade = canCascade( band );
+
+    for ( int i = 0; i < sortedLevels.size(); ++i )
+    {
+      GDALRasterBandH overview = nullptr;
+      for ( int j = 0; j < GDALGetOverviewCount( band ); ++j )
+      {
+        GDALRasterBandH candidate = GDALGetOverview( band, j );
+        if ( GDALGetRasterBandXSize( candidate ) == steps.at( i ).width && GDALGetRasterBandYSize( candidate ) == steps.at( i ).height )
+        {
+          overview = candidate;
+          break;
+        }
+      }
+      if ( !overview )
+      {
+        QgsDebugMsg( QStringLiteral( "No overview of band %1 at level %2" ).arg( bandNo ).arg( sortedLevels.at( i ) ) );
+        return false;
+      }
+      bandLevels.overviews << overview;
+    }
+    bands << bandLevels;
+  }
+
+  // TRUE for the bands in which NaN values were found. NaN values are skipped like nodata values, so
+  // the averages of these bands can't be averaged again
+  QVector< bool > hasNaN( bandCount, false );
+
+  qint64 donePixels = 0;
+  for ( int i = 0; i < sortedLevels.size(); ++i )
+  {
+    const int level = sortedLevels.at( i );
+    Step &step = steps[i];
+
+    for ( const BandLevels &bandLevels : std::as_const( bands ) )
+    {
+      BandStep bandStep;
+      bandStep.bandNo = bandLevels.bandNo;
+      bandStep.overview = bandLevels.overviews.at( i );
+      bandStep.factor = level;
+      bandStep.hasNoData = bandLevels.hasNoData;
+      bandStep.noData = bandLevels.noData;
+
+      // reuse the largest level already computed, as ceil( ceil( n / a ) / b ) == ceil( n / ( a * b ) ). The
+      // pixels of that level must all cover a full window, so that they have the same weight
+      const bool cascade = bandLevels.cascade && ( mKernel != averageKernel || !hasNaN.at( bandLevels.bandNo - 1 ) );
+      if ( cascade )
+      {
+        for ( int j = i - 1; j >= 0; --j )
+        {
+          const int previousLevel = sortedLevels.at( j );
+          if ( level % previousLevel == 0 && width % previousLevel == 0 && height % previousLevel == 0 )
+          {
+            bandStep.source = bandLevels.overviews.at( j );
+            bandStep.factor = level / previousLevel;
+            break;
+          }
+        }
+      }
+
+      step.bands << bandStep;
+    }
+
+    if ( !buildStep( step, donePixels, totalPixels, hasNaN, feedback ) )
+      return false;
+  }
+
+  GDALFlushCache( mDataset );
+  return true;
+}
+
+//! Resamples a tile of source values to a tile of the overview
+static std::vector< double > resampleTile( const std::vector< double > &source, int sourceWidth, int sourceHeight,
+    int width, int height, int factor, bool hasNoData, double noData, QgsGdalOverviewBuilder::Kernel kernel, bool &hasNaN )
+{
+  hasNaN = false;
+  const double outputNoData = hasNoData ? noData : std::numeric_limits<double>::quiet_NaN();
+  std::vector< double > result( static_cast< std::size_t >( width ) * height, outputNoData );
+  std::vector< double > window( static_cast< std::size_t >( factor ) * factor );
+  std::vector< unsigned char > windowNoData( static_cast< std::size_t >( factor ) * factor );
+
+  for ( int row = 0; row < height; ++row )
+  {
+    const int sourceRow = row * factor;
+    const int windowHeight = std::min( factor, sourceHeight - sourceRow );
+    for ( int col = 0; col < width; ++col )
+    {
+      const int sourceCol = col * factor;
+      const int windowWidth = std::min( factor, sourceWidth - sourceCol );
+
+      int i = 0;
+      for ( int windowRow = 0; windowRow < windowHeight; ++windowRow )
+      {
+        const double *sourceValues = source.data() + static_cast< std::size_t >( sourceRow + windowRow ) * sourceWidth + sourceCol;
+        for ( int windowCol = 0; windowCol < windowWidth; ++windowCol, ++i )
+        {
+          window[i] = sourceValues[windowCol];
+          const bool isNaN = std::isnan( window[i] );
+          hasNaN = hasNaN || isNaN;
+          windowNoData[i] = isNaN || ( hasNoData && window[i] == noData );
+        }
+      }
+
+      double value = 0;
+      if ( kernel( window.data(), windowNoData.data(), windowWidth, windowHeight, value ) )
+        result[static_cast< std::size_t >( row ) * width + col] = value;
+    }
+  }
+  return result;
+}
+
+bool QgsGdalOverviewBuilder::buildStep( const Step &step, qint64 &donePixels, qint64 totalPixels, QVector< bool > &hasNaN, QgsRasterBlockFeedback *feedback )
+{
+  const int datasetWidth = GDALGetRasterXSize( mDataset );
+  const int datasetHeight = GDALGetRasterYSize( mDataset );
+  const int bandCount = step.bands.size();
+
+  //! A rectangle of pixels, of the overview or of its source
+  struct Tile
+  {
+    int col = 0;
+    int row = 0;
+    int width = 0;
+    int height = 0;
+  };
+
+  // the window of the source of a band covered by a tile of the overview
+  const auto sourceWindow = [datasetWidth, datasetHeight]( const BandStep & bandStep, const Tile & tile )
+  {
+    const int sourceWidth = bandStep.source ? GDALGetRasterBandXSize( bandStep.source ) : datasetWidth;
+    const int sourceHeight = bandStep.source ? GDALGetRasterBandYSize( bandStep.source ) : datasetHeight;
+    Tile window;
+    window.col = tile.col * bandStep.factor;
+    window.row = tile.row * bandStep.factor;
+    window.width = std::min( tile.width * bandStep.factor, sourceWidth - window.col );
+    window.height = std::min( tile.height * bandStep.factor, sourceHeight - window.row );
+    return window;
+  };
+
+  //! Resampled values of all the bands of a tile
+  struct TileResult
+  {
+    std::vector< std::vector< double > > values;
+    //! TRUE for the bands with NaN values in the source of the tile
+    std::vector< bool > hasNaN;
+  };
+
+  // bands read from the full resolution dataset are read in a single request, which reads each
+  // block of pixel interleaved datasets only once
+  QVector< int > fullResolutionBands;
+  int fullResolutionFactor = 0;
+  for ( const BandStep &bandStep : step.bands )
+  {
+    if ( bandStep.source )
+      continue;
+    fullResolutionBands << bandStep.bandNo;
+    fullResolutionFactor = bandStep.factor;
+  }
+
+  const auto writeTile = [&]( const Tile & tile, const TileResult & result ) -> bool
+  {
+    for ( int i = 0; i < bandCount; ++i )
+    {
+      if ( GDALRasterIO( step.bands.at( i ).overview, GF_Write, tile.col, tile.row, tile.width, tile.height,
+                         const_cast< double * >( result.values[i].data() ), tile.width, tile.height, GDT_Float64, 0, 0 ) != CE_None )
+      {
+        QgsDebugMsg( QStringLiteral( "Failed to write overview tile: %1" ).arg( CPLGetLastErrorMsg() ) );
+        return false;
+      }
+      if ( result.hasNaN[i] )
+        hasNaN[step.bands.at( i ).bandNo - 1] = true;
+    }
+
+    donePixels += static_cast< qint64 >( tile.width ) * tile.height * bandCount;
+    if ( feedback && totalPixels > 0 )
+      feedback->setProgress( 100.0 * static_cast< double >( donePixels ) / static_cast< double >( totalPixels ) );
+    return true;
+  };
+
+  const int maxTilesInFlight = 2 * std::max( 1, QThread::idealThreadCount() );
+  QList< QPair< Tile, QFuture< TileResult > > > results;
+
+  // declared after the results, so that all tasks are finished before they get destroyed
+  QThreadPool pool;
+
+  for ( int row = 0; row < step.height; row += TILE_SIZE )
+  {
+    for ( int col = 0; col < step.width; col += TILE_SIZE )
+    {
+      if ( feedback && feedback->isCanceled() )
+        return false;
+
+      Tile tile;
+      tile.col = col;
+      tile.row = row;
+      tile.width = std::min( TILE_SIZE, step.width - col );
+      tile.height = std::min( TILE_SIZE, step.height - row );
+
+      // the sources are read in this thread, GDAL datasets can't be shared by threads
+      std::vector< Tile > windows( bandCount );
+      auto sources = std::make_shared< std::vector< std::vector< double > > >( bandCount );
+
+      std::vector< double > fullResolutionValues;
+      std::size_t fullResolutionSize = 0;
+      if ( !fullResolutionBands.isEmpty() )
+      {
+        BandStep fullResolutionStep;
+        fullResolutionStep.factor = fullResolutionFactor;
+        const Tile window = sourceWindow( fullResolutionStep, tile );
+        fullResolutionSize = static_cast< std::size_t >( window.width ) * window.height;
+        fullResolutionValues.resize( fullResolutionSize * fullResolutionBands.size() );
+        if ( GDALDatasetRasterIO( mDataset, GF_Read, window.col, window.row, window.width, window.height,
+                                  fullResolutionValues.data(), window.width, window.height, GDT_Float64,
+                                  fullResolutionBands.size(), fullResolutionBands.data(), 0, 0, 0 ) != CE_None )
+        {
+          QgsDebugMsg( QStringLiteral( "Failed to read overview source tile: %1" ).arg( CPLGetLastErrorMsg() ) );
+          return false;
+        }
+      }
+
+      int fullResolutionIndex = 0;
+      for ( int i = 0; i < bandCount; ++i )
+      {
+        const BandStep &bandStep = step.bands.at( i );
+        windows[i] = sourceWindow( bandStep, tile );
+        std::vector< double > &source = ( *sources )[i];
+        if ( !bandStep.source )
+        {
+          const auto first = fullResolutionValues.cbegin() + static_cast< std::ptrdiff_t >( fullResolutionIndex * fullResolutionSize );
+          source.assign( first, first + static_cast< std::ptrdiff_t >( fullResolutionSize ) );
+          fullResolutionIndex++;
+          continue;
+        }
+
+        source.resize( static_cast< std::size_t >( windows[i].width ) * windows[i].height );
+        if ( GDALRasterIO( bandStep.source, GF_Read, windows[i].col, windows[i].row, windows[i].width, windows[i].height,
+                           source.data(), windows[i].width, windows[i].height, GDT_Float64, 0, 0 ) != CE_None )
+        {
+          QgsDebugMsg( QStringLiteral( "Failed to read overview source tile: %1" ).arg( CPLGetLastErrorMsg() ) );
+          return false;
+        }
+      }
+
+      const Kernel kernel = mKernel;
+      const QVector< BandStep > bands = step.bands;
+      results << qMakePair( tile, QtConcurrent::run( &pool, [sources, windows, tile, bands, kernel]
+      {
+        TileResult result;
+        result.values.reserve( bands.size() );
+        result.hasNaN.resize( bands.size() );
+        for ( int i = 0; i < bands.size(); ++i )
+        {
+          const BandStep &bandStep = bands.at( i );
+          bool hasNaN = false;
+          result.values.emplace_back( resampleTile( ( *sources )[i], windows[i].width, windows[i].height, tile.width, tile.height,
+                                      bandStep.factor, bandStep.hasNoData, bandStep.noData, kernel, hasNaN ) );
+          result.hasNaN[i] = hasNaN;
+        }
+        return result;
+      } ) );
+
+      while ( results.size() >= maxTilesInFlight )
+      {
+        const QPair< Tile, QFuture< TileResult > > result = results.takeFirst();
+        if ( !writeTile( result.first, result.second.result() ) )
+          return false;
+      }
+    }
+  }
+
+  while ( !results.isEmpty() )
+  {
+    const QPair< Tile, QFuture< TileResult > > result = results.takeFirst();
+    if ( !writeTile( result.first, result.second.result() ) )
+      return false;
+  }
+
+  return !feedback || !feedback->isCanceled();
+}
+
+///@endcond
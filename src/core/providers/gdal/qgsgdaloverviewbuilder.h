@@ -0,0 +1,125 @@
+/***************************************************************************
+  qgsgdaloverviewbuilder.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSGDALOVERVIEWBUILDER_H
+#define QGSGDALOVERVIEWBUILDER_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+
+#include <QString>
+#include <QVector>
+
+#include <gdal.h>
+
+class QgsRasterBlockFeedback;
+
+///@cond PRIVATE
+
+/**
+ * \ingroup core
+ * \class QgsGdalOverviewBuilder
+ * \brief Computes the overviews of a GDAL dataset.
+ *
+ * Overviews must have been created beforehand (e.g. with GDALBuildOverviews() and the "NONE"
+ * resampling method). When the kernel gives the same result on a window as on the results of
+ * its parts (minimum and maximum, and average for floating point bands without nodata or NaN values,
+ * up to floating point rounding), a level is computed from the largest level already computed whose
+ * factor divides its own factor. Otherwise, e.g. for the mode or the average of integer bands, whose
+ * overviews store rounded values, every level is computed from the full resolution band.
+ *
+ * Levels are processed in tiles covering all the bands: tiles are read and written in the calling
+ * thread (GDAL datasets can't be used from several threads), while the resampling of the tiles runs
+ * concurrently on a pool of worker threads.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsGdalOverviewBuilder
+{
+  public:
+
+    /**
+     * A resampling kernel, computing the value of an overview pixel from the window of
+     * \a width by \a height source pixels it covers, in row order. Nodata pixels of the
+     * window are flagged in \a noData.
+     *
+     * \returns FALSE if the overview pixel is nodata
+     */
+    typedef bool ( *Kernel )( const double *values, const unsigned char *noData, int width, int height, double &result );
+
+    /**
+     * Returns the kernel for a GDAL resampling \a method (e.g. "AVERAGE"), or NULLPTR if
+     * the method is not supported by the builder.
+     */
+    static Kernel kernel( const QString &method );
+
+    /**
+     * Returns TRUE if the overviews of \a dataset can be computed by the builder. Datasets
+     * with complex bands, or with mask or alpha bands, are not supported.
+     */
+    static bool canBuild( GDALDatasetH dataset );
+
+    //! Constructor for QgsGdalOverviewBuilder, using the specified resampling \a kernel
+    QgsGdalOverviewBuilder( GDALDatasetH dataset, Kernel kernel );
+
+    /**
+     * Computes the overviews of all bands for the specified decimation \a levels.
+     *
+     * \returns FALSE if the overviews do not exist, if reading or writing failed, or if
+     * the calculation was canceled
+     */
+    bool build( const QVector< int > &levels, QgsRasterBlockFeedback *feedback = nullptr );
+
+  private:
+
+    //! The overview of a band to compute
+    struct BandStep
+    {
+      //! Band number in the dataset
+      int bandNo = 0;
+      //! Overview to read the values from, NULLPTR to read them from the full resolution band
+      GDALRasterBandH source = nullptr;
+      GDALRasterBandH overview = nullptr;
+      int factor = 1;
+      bool hasNoData = false;
+      double noData = 0;
+    };
+
+    //! The overviews of all the bands for a level
+    struct Step
+    {
+      int width = 0;
+      int height = 0;
+      QVector< BandStep > bands;
+    };
+
+    //! Returns TRUE if overviews of a \a band can be computed from the overviews of a lower level
+    bool canCascade( GDALRasterBandH band ) const;
+
+    /**
+     * Computes the overviews of a \a step, progress is reported for \a totalPixels, of which \a donePixels are already done.
+     * The bands in which NaN values are read are flagged in \a hasNaN, indexed by band number - 1.
+     */
+    bool buildStep( const Step &step, qint64 &donePixels, qint64 totalPixels, QVector< bool > &hasNaN, QgsRasterBlockFeedback *feedback );
+
+    GDALDatasetH mDataset = nullptr;
+    Kernel mKernel = nullptr;
+};
+
+///@endcond
+
+#endif // QGSGDALOVERVIEWBUILDER_H
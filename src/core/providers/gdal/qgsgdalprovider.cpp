@@ -31,6 +31,7 @@
 #include "qgsdataitemprovider.h"
 #include "qgsdatasourceuri.h"
 #include "qgsgdaldataitems.h"
+#include "qgsgdaloverviewbuilder.h"
 #include "qgshtmlutils.h"
 #include "qgsmessagelog.h"
 #include "qgsrectangle.h"
@@ -1626,9 +1627,16 @@ QString QgsGdalProvider::description() const
 
 QgsRasterDataProvider::ProviderCapabilities QgsGdalProvider::providerCapabilities() const
 {
-  return ProviderCapability::ProviderHintBenefitsFromResampling |
-         ProviderCapability::ProviderHintCanPerformProviderResampling |
-         ProviderCapability::ReloadData;
+  QgsRasterDataProvider::ProviderCapabilities capabilities = ProviderCapability::ProviderHintBenefitsFromResampling |
+      ProviderCapability::ProviderHintCanPerformProviderResampling |
+      ProviderCapability::ReloadData;
+
+  // reading remote datasets (e.g. /vsicurl/) concurrently would only multiply the requests to the server
+  const QString path = decodeGdalUri( dataSourceUri() ).value( QStringLiteral( "path" ) ).toString();
+  if ( QFileInfo::exists( path ) )
+    capabilities |= ProviderCapability::ProviderHintCanReadInParallel;
+
+  return capabilities;
 }
 
 QList<QgsProviderSublayerDetails> QgsGdalProvider::sublayerDetails( GDALDatasetH dataset, const QString &baseUri )
@@ -2093,10 +2101,37 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> &rasterPyr
     myProg.type = QgsRaster::ProgressPyramids;
     myProg.provider = this;
     myProg.feedback = feedback;
-    myError = GDALBuildOverviews( mGdalBaseDataset, method,
-                                  myOverviewLevelsVector.size(), myOverviewLevelsVector.data(),
-                                  0, nullptr,
-                                  progressCallback, &myProg ); //this is the arg for the gdal progress callback
+
+    // methods supported by the native builder compute each level from the previous one in parallel,
+    // GDAL only creates the overviews for them
+    bool built = false;
+    const QgsGdalOverviewBuilder::Kernel kernel = QgsGdalOverviewBuilder::kernel( resamplingMethod );
+    if ( kernel && QgsGdalOverviewBuilder::canBuild( mGdalBaseDataset ) &&
+         GDALBuildOverviews( mGdalBaseDataset, "NONE",
+                             myOverviewLevelsVector.size(), myOverviewLevelsVector.data(),
+                             0, nullptr, nullptr, nullptr ) == CE_None )
+    {
+      QgsGdalOverviewBuilder builder( mGdalBaseDataset, kernel );
+      if ( builder.build( myOverviewLevelsVector, feedback ) )
+      {
+        CPLErrorReset();
+        myError = CE_None;
+        built = true;
+      }
+      else if ( feedback && feedback->isCanceled() )
+      {
+        myError = CE_Failure;
+        built = true;
+      }
+    }
+
+    if ( !built )
+    {
+      myError = GDALBuildOverviews( mGdalBaseDataset, method,
+                                    myOverviewLevelsVector.size(), myOverviewLevelsVector.data(),
+                                    0, nullptr,
+                                    progressCallback, &myProg ); //this is the arg for the gdal progress callback
+    }
 
     if ( ( feedback && feedback->isCanceled() ) || myError == CE_Failure || CPLGetLastErrorNo() == CPLE_NotSupported )
     {
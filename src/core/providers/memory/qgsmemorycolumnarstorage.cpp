@@ -0,0 +1,372 @@
+/***************************************************************************
+  qgsmemorycolumnarstorage.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsmemorycolumnarstorage.h"
+
+#include <algorithm>
+#include <limits>
+
+///@cond PRIVATE
+
+// removes the values of all flagged rows, keeping the order of the remaining values
+template <typename T>
+static void compactVector( std::vector< T > &values, const std::vector< bool > &removed )
+{
+  std::size_t j = 0;
+  const std::size_t size = values.size();
+  for ( std::size_t i = 0; i < size; ++i )
+  {
+    if ( removed[i] )
+      continue;
+
+    if ( i != j )
+      values[j] = std::move( values[i] );
+    ++j;
+  }
+  values.resize( j );
+}
+
+QgsMemoryColumnarStorage::QgsMemoryColumnarStorage( const QgsFields &fields )
+{
+  mColumns.reserve( fields.count() );
+  for ( const QgsField &field : fields )
+    mColumns.emplace_back( createColumn( field, 0 ) );
+}
+
+int QgsMemoryColumnarStorage::rowForId( QgsFeatureId id ) const
+{
+  // IDs are always appended in increasing order
+  const auto it = std::lower_bound( mIds.begin(), mIds.end(), id );
+  if ( it == mIds.end() || *it != id )
+    return -1;
+
+  return static_cast< int >( it - mIds.begin() );
+}
+
+void QgsMemoryColumnarStorage::appendFeature( const QgsFeature &feature )
+{
+  Q_ASSERT( mIds.empty() || feature.id() > mIds.back() );
+
+  mIds.emplace_back( feature.id() );
+
+  const QgsGeometry geometry = feature.geometry();
+  mBoundingBoxes.emplace_back( geometry.isNull() ? QgsRectangle() : geometry.boundingBox() );
+  mGeometries.emplace_back( geometry );
+
+  const QgsAttributes attributes = feature.attributes();
+  const int columnCount = static_cast< int >( mColumns.size() );
+  for ( int i = 0; i < columnCount; ++i )
+    appendValue( mColumns[i], i < attributes.size() ? attributes.at( i ) : QVariant() );
+}
+
+void QgsMemoryColumnarStorage::deleteFeatures( const QgsFeatureIds &ids )
+{
+  std::vector< bool > removed( mIds.size(), false );
+  bool hasRemovedRows = false;
+  for ( QgsFeatureId id : ids )
+  {
+    const int row = rowForId( id );
+    if ( row < 0 )
+      continue;
+
+    removed[ row ] = true;
+    hasRemovedRows = true;
+  }
+
+  if ( !hasRemovedRows )
+    return;
+
+  compactVector( mIds, removed );
+  compactVector( mGeometries, removed );
+  compactVector( mBoundingBoxes, removed );
+  for ( Column &column : mColumns )
+    compactColumn( column, removed );
+}
+
+void QgsMemoryColumnarStorage::setGeometry( int row, const QgsGeometry &geometry )
+{
+  mGeometries[ row ] = geometry;
+  mBoundingBoxes[ row ] = geometry.isNull() ? QgsRectangle() : geometry.boundingBox();
+}
+
+QVariant QgsMemoryColumnarStorage::attribute( int row, int field ) const
+{
+  if ( field < 0 || field >= static_cast< int >( mColumns.size() ) )
+    return QVariant();
+
+  return value( mColumns[ field ], row );
+}
+
+void QgsMemoryColumnarStorage::setAttribute( int row, int field, const QVariant &value )
+{
+  if ( field < 0 || field >= static_cast< int >( mColumns.size() ) )
+    return;
+
+  setValue( mColumns[ field ], row, value );
+}
+
+QgsFeature QgsMemoryColumnarStorage::feature( int row ) const
+{
+  QgsAttributeList attributes;
+  const int columnCount = static_cast< int >( mColumns.size() );
+  attributes.reserve( columnCount );
+  for ( int i = 0; i < columnCount; ++i )
+    attributes << i;
+
+  QgsFeature f;
+  readFeature( row, f, attributes, true );
+  return f;
+}
+
+void QgsMemoryColumnarStorage::readFeature( int row, QgsFeature &feature, const QgsAttributeList &attributes, bool fetchGeometry ) const
+{
+  feature.setId( mIds[ row ] );
+
+  const int columnCount = static_cast< int >( mColumns.size() );
+  QgsAttributes values( columnCount );
+  for ( int index : attributes )
+  {
+    if ( index >= 0 && index < columnCount )
+      values[ index ] = value( mColumns[ index ], row );
+  }
+  feature.setAttributes( values );
+
+  if ( fetchGeometry && !mGeometries[ row ].isNull() )
+    feature.setGeometry( mGeometries[ row ] );
+  else
+    feature.clearGeometry();
+
+  feature.setValid( true );
+}
+
+void QgsMemoryColumnarStorage::addField( const QgsField &field )
+{
+  mColumns.emplace_back( createColumn( field, featureCount() ) );
+}
+
+void QgsMemoryColumnarStorage::removeField( int index )
+{
+  if ( index < 0 || index >= static_cast< int >( mColumns.size() ) )
+    return;
+
+  mColumns.erase( mColumns.begin() + index );
+}
+
+QgsMemoryColumnarStorage::Column QgsMemoryColumnarStorage::createColumn( const QgsField &field, int size )
+{
+  Column column;
+  column.type = field.type();
+  switch ( field.type() )
+  {
+    case QVariant::Int:
+    case QVariant::Bool:
+      column.storage = Column::Int;
+      column.ints.resize( size, 0 );
+      break;
+
+    case QVariant::LongLong:
+      column.storage = Column::LongLong;
+      column.longs.resize( size, 0 );
+      break;
+
+    case QVariant::Double:
+      column.storage = Column::Double;
+      column.doubles.resize( size, 0 );
+      break;
+
+    case QVariant::String:
+      column.storage = Column::String;
+      column.stringIndexes.resize( size, 0 );
+      break;
+
+    default:
+      column.storage = Column::Variant;
+      column.variants.resize( size, QVariant() );
+      return column;
+  }
+
+  column.nulls.resize( size, true );
+  return column;
+}
+
+bool QgsMemoryColumnarStorage::isStorable( const Column &column, const QVariant &value )
+{
+  if ( column.storage == Column::Variant || value.isNull() )
+    return true;
+
+  // values are converted to the field types by the provider, anything else is unexpected
+  return value.type() == column.type;
+}
+
+void QgsMemoryColumnarStorage::appendValue( Column &column, const QVariant &value )
+{
+  if ( !isStorable( column, value ) )
+    convertToVariantStorage( column );
+
+  if ( column.storage == Column::Variant )
+  {
+    column.variants.emplace_back( value );
+    return;
+  }
+
+  const bool isNull = value.isNull();
+  column.nulls.push_back( isNull );
+  switch ( column.storage )
+  {
+    case Column::Int:
+      column.ints.emplace_back( isNull ? 0 : ( column.type == QVariant::Bool ? static_cast< qint32 >( value.toBool() ) : value.toInt() ) );
+      break;
+    case Column::LongLong:
+      column.longs.emplace_back( isNull ? 0 : value.toLongLong() );
+      break;
+    case Column::Double:
+      column.doubles.emplace_back( isNull ? 0 : value.toDouble() );
+      break;
+    case Column::String:
+      column.stringIndexes.emplace_back( isNull ? 0 : stringIndex( column, value.toString() ) );
+      break;
+    case Column::Variant:
+      break;
+  }
+}
+
+void QgsMemoryColumnarStorage::setValue( Column &column, int row, const QVariant &value )
+{
+  if ( !isStorable( column, value ) )
+    convertToVariantStorage( column );
+
+  if ( column.storage == Column::Variant )
+  {
+    column.variants[ row ] = value;
+    return;
+  }
+
+  const bool isNull = value.isNull();
+  column.nulls[ row ] = isNull;
+  switch ( column.storage )
+  {
+    case Column::Int:
+      column.ints[ row ] = isNull ? 0 : ( column.type == QVariant::Bool ? static_cast< qint32 >( value.toBool() ) : value.toInt() );
+      break;
+    case Column::LongLong:
+      column.longs[ row ] = isNull ? 0 : value.toLongLong();
+      break;
+    case Column::Double:
+      column.doubles[ row ] = isNull ? 0 : value.toDouble();
+      break;
+    case Column::String:
+      column.stringIndexes[ row ] = isNull ? 0 : stringIndex( column, value.toString() );
+      break;
+    case Column::Variant:
+      break;
+  }
+}
+
+QVariant QgsMemoryColumnarStorage::value( const Column &column, int row )
+{
+  if ( column.storage == Column::Variant )
+    return column.variants[ row ];
+
+  // NULL is returned as an invalid variant, as callers commonly check QVariant::isValid()
+  if ( column.nulls[ row ] )
+    return QVariant();
+
+  switch ( column.storage )
+  {
+    case Column::Int:
+      return column.type == QVariant::Bool ? QVariant( column.ints[ row ] != 0 ) : QVariant( column.ints[ row ] );
+    case Column::LongLong:
+      return QVariant( column.longs[ row ] );
+    case Column::Double:
+      return QVariant( column.doubles[ row ] );
+    case Column::String:
+      // strings are implicitly shared, so this doesn't copy the string data
+      return QVariant( column.dictionary.at( column.stringIndexes[ row ] ) );
+    case Column::Variant:
+      break;
+  }
+  return QVariant();
+}
+
+void QgsMemoryColumnarStorage::convertToVariantStorage( Column &column )
+{
+  if ( column.storage == Column::Variant )
+    return;
+
+  const std::size_t size = column.nulls.size();
+  std::vector< QVariant > variants;
+  variants.reserve( size );
+  for ( std::size_t i = 0; i < size; ++i )
+    variants.emplace_back( value( column, static_cast< int >( i ) ) );
+
+  column.storage = Column::Variant;
+  column.variants = std::move( variants );
+  column.ints = std::vector< qint32 >();
+  column.longs = std::vector< qint64 >();
+  column.doubles = std::vector< double >();
+  column.stringIndexes = std::vector< quint32 >();
+  column.nulls = std::vector< bool >();
+  column.dictionary.clear();
+  column.dictionaryIndexes.clear();
+}
+
+quint32 QgsMemoryColumnarStorage::stringIndex( Column &column, const QString &string )
+{
+  auto it = column.dictionaryIndexes.constFind( string );
+  if ( it != column.dictionaryIndexes.constEnd() )
+    return it.value();
+
+  const quint32 index = static_cast< quint32 >( column.dictionary.size() );
+  column.dictionary.append( string );
+  column.dictionaryIndexes.insert( string, index );
+  return index;
+}
+
+void QgsMemoryColumnarStorage::compactColumn( Column &column, const std::vector< bool > &removed )
+{
+  compactVector( column.ints, removed );
+  compactVector( column.longs, removed );
+  compactVector( column.doubles, removed );
+  compactVector( column.variants, removed );
+  compactVector( column.nulls, removed );
+  compactVector( column.stringIndexes, removed );
+
+  if ( column.storage != Column::String )
+    return;
+
+  // drop the strings which are no longer used
+  QVector< QString > dictionary;
+  QHash< QString, quint32 > dictionaryIndexes;
+  std::vector< quint32 > remap( column.dictionary.size(), std::numeric_limits< quint32 >::max() );
+  const std::size_t size = column.stringIndexes.size();
+  for ( std::size_t i = 0; i < size; ++i )
+  {
+    if ( column.nulls[i] )
+      continue;
+
+    quint32 &index = column.stringIndexes[i];
+    if ( remap[ index ] == std::numeric_limits< quint32 >::max() )
+    {
+      remap[ index ] = static_cast< quint32 >( dictionary.size() );
+      dictionary.append( column.dictionary.at( index ) );
+      dictionaryIndexes.insert( dictionary.constLast(), remap[ index ] );
+    }
+    index = remap[ index ];
+  }
+  column.dictionary = dictionary;
+  column.dictionaryIndexes = dictionaryIndexes;
+}
+
+///@endcond PRIVATE
@@ -0,0 +1,195 @@
+/***************************************************************************
+  qgsmemorycolumnarstorage.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSMEMORYCOLUMNARSTORAGE_H
+#define QGSMEMORYCOLUMNARSTORAGE_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+#include "qgsfeature.h"
+#include "qgsfields.h"
+#include "qgsgeometry.h"
+#include "qgsrectangle.h"
+
+#include <QHash>
+#include <vector>
+
+///@cond PRIVATE
+
+/**
+ * \ingroup core
+ * \brief Column oriented storage of features for the memory provider.
+ *
+ * Instead of storing a QgsFeature object (and a QVector of QVariant values) for every feature,
+ * attribute values are stored in one contiguous array per field: integer, boolean and double
+ * values in plain arrays, strings as indexes into a per field dictionary of distinct values, and
+ * NULL values in a bitmap. Values of other types (dates, binary values, lists...) are stored
+ * as QVariant. Feature geometries are stored alongside their bounding boxes, so that
+ * rectangle filters can be tested without touching the geometries.
+ *
+ * Features are kept ordered by feature ID. Feature IDs must be added in increasing order.
+ *
+ * QgsFeature objects are only created when features are requested, and only contain the requested attributes.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsMemoryColumnarStorage
+{
+  public:
+
+    /**
+     * Constructor for QgsMemoryColumnarStorage, with the specified \a fields.
+     */
+    explicit QgsMemoryColumnarStorage( const QgsFields &fields = QgsFields() );
+
+    /**
+     * Returns the number of stored features.
+     */
+    int featureCount() const { return static_cast< int >( mIds.size() ); }
+
+    /**
+     * Returns the row containing the feature with matching \a id, or -1 if no such feature is stored.
+     */
+    int rowForId( QgsFeatureId id ) const;
+
+    /**
+     * Returns the ID of the feature stored in the specified \a row.
+     */
+    QgsFeatureId idForRow( int row ) const { return mIds[ row ]; }
+
+    /**
+     * Appends a \a feature. Its ID must be greater than the IDs of all stored features, and its
+     * attributes must match the storage's fields.
+     */
+    void appendFeature( const QgsFeature &feature );
+
+    /**
+     * Removes the features with matching \a ids.
+     */
+    void deleteFeatures( const QgsFeatureIds &ids );
+
+    /**
+     * Returns TRUE if the feature stored in \a row has a geometry.
+     */
+    bool hasGeometry( int row ) const { return !mGeometries[ row ].isNull(); }
+
+    /**
+     * Returns the geometry of the feature stored in \a row.
+     */
+    QgsGeometry geometry( int row ) const { return mGeometries[ row ]; }
+
+    /**
+     * Returns the bounding box of the geometry of the feature stored in \a row.
+     */
+    const QgsRectangle &boundingBox( int row ) const { return mBoundingBoxes[ row ]; }
+
+    /**
+     * Sets the \a geometry of the feature stored in \a row.
+     */
+    void setGeometry( int row, const QgsGeometry &geometry );
+
+    /**
+     * Returns the value of the attribute at index \a field of the feature stored in \a row.
+     */
+    QVariant attribute( int row, int field ) const;
+
+    /**
+     * Sets the \a value of the attribute at index \a field of the feature stored in \a row.
+     */
+    void setAttribute( int row, int field, const QVariant &value );
+
+    /**
+     * Creates the feature stored in \a row, containing all attributes and the geometry.
+     */
+    QgsFeature feature( int row ) const;
+
+    /**
+     * Fills \a feature with the feature stored in \a row.
+     *
+     * Only the \a attributes with the listed indexes are read, other attributes are set to NULL.
+     * The geometry is only read if \a fetchGeometry is TRUE.
+     */
+    void readFeature( int row, QgsFeature &feature, const QgsAttributeList &attributes, bool fetchGeometry ) const;
+
+    /**
+     * Appends a \a field, with NULL values for all stored features.
+     */
+    void addField( const QgsField &field );
+
+    /**
+     * Removes the field at the specified \a index.
+     */
+    void removeField( int index );
+
+  private:
+
+    //! Contiguous values of a field
+    struct Column
+    {
+      enum Storage
+      {
+        Int, //!< 32 bit integers and booleans, stored in ints
+        LongLong, //!< 64 bit integers, stored in longs
+        Double, //!< Doubles, stored in doubles
+        String, //!< Strings, stored as indexes into the dictionary
+        Variant, //!< Any other type, stored in variants
+      };
+
+      Storage storage = Variant;
+
+      //! Field type, used for the values and the NULL values returned
+      QVariant::Type type = QVariant::Invalid;
+
+      std::vector< qint32 > ints;
+      std::vector< qint64 > longs;
+      std::vector< double > doubles;
+      std::vector< quint32 > stringIndexes;
+      std::vector< QVariant > variants;
+
+      //! NULL flags, unused for variant storage
+      std::vector< bool > nulls;
+
+      //! Distinct string values, rebuilt when features are deleted
+      QVector< QString > dictionary;
+      QHash< QString, quint32 > dictionaryIndexes;
+    };
+
+    static Column createColumn( const QgsField &field, int size );
+    static void appendValue( Column &column, const QVariant &value );
+    static void setValue( Column &column, int row, const QVariant &value );
+    static QVariant value( const Column &column, int row );
+
+    //! Returns TRUE if the \a value can be stored in the column's native storage
+    static bool isStorable( const Column &column, const QVariant &value );
+
+    //! Converts a column to variant storage, e.g. when storing a value of an unexpected type
+    static void convertToVariantStorage( Column &column );
+
+    static quint32 stringIndex( Column &column, const QString &string );
+
+    //! Removes values from a column, for all rows flagged in \a removed
+    static void compactColumn( Column &column, const std::vector< bool > &removed );
+
+    std::vector< QgsFeatureId > mIds;
+    std::vector< QgsGeometry > mGeometries;
+    std::vector< QgsRectangle > mBoundingBoxes;
+    std::vector< Column > mColumns;
+};
+
+///@endcond PRIVATE
+
+#endif // QGSMEMORYCOLUMNARSTORAGE_H
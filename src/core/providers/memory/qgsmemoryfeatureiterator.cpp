@@ -14,6 +14,7 @@
  ***************************************************************************/
 #include "qgsmemoryfeatureiterator.h"
 #include "qgsmemoryprovider.h"
+#include "qgsmemorycolumnarstorage.h"
 
 #include "qgsgeometry.h"
 #include "qgsgeometryengine.h"
@@ -68,9 +69,17 @@ QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryFeatureSource *sour
   else if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
   {
     mUsingFeatureIdList = true;
-    QgsFeatureMap::const_iterator it = mSource->mFeatures.constFind( mRequest.filterFid() );
-    if ( it != mSource->mFeatures.constEnd() )
-      mFeatureIdList.append( mRequest.filterFid() );
+    if ( mSource->mColumnarStorage )
+    {
+      if ( mSource->mColumnarStorage->rowForId( mRequest.filterFid() ) >= 0 )
+        mFeatureIdList.append( mRequest.filterFid() );
+    }
+    else
+    {
+      QgsFeatureMap::const_iterator it = mSource->mFeatures.constFind( mRequest.filterFid() );
+      if ( it != mSource->mFeatures.constEnd() )
+        mFeatureIdList.append( mRequest.filterFid() );
+    }
   }
   else if ( mRequest.filterType() == QgsFeatureRequest::FilterFids )
   {
@@ -82,6 +91,30 @@ QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryFeatureSource *sour
     mUsingFeatureIdList = false;
   }
 
+  if ( mSource->mColumnarStorage )
+  {
+    // features are created from the columnar storage, so only read what is needed
+    if ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes )
+    {
+      QSet<int> attributeIndexes = qgis::listToSet( mRequest.subsetOfAttributes() );
+      // ensure that all attributes required for expression filter, order by and subset string are being fetched
+      if ( mRequest.filterType() == QgsFeatureRequest::FilterExpression )
+        attributeIndexes.unite( mRequest.filterExpression()->referencedAttributeIndexes( mSource->mFields ) );
+      attributeIndexes.unite( mRequest.orderBy().usedAttributeIndices( mSource->mFields ) );
+      if ( mSubsetExpression )
+        attributeIndexes.unite( mSubsetExpression->referencedAttributeIndexes( mSource->mFields ) );
+      mAttributes = qgis::setToList( attributeIndexes );
+    }
+    else
+    {
+      mAttributes = mSource->mFields.allAttributesList();
+    }
+
+    mFetchGeometry = !( mRequest.flags() & QgsFeatureRequest::NoGeometry )
+                     || ( mRequest.filterType() == QgsFeatureRequest::FilterExpression && mRequest.filterExpression()->needsGeometry() )
+                     || ( mSubsetExpression && mSubsetExpression->needsGeometry() );
+  }
+
   rewind();
 }
 
@@ -97,7 +130,9 @@ bool QgsMemoryFeatureIterator::fetchFeature( QgsFeature &feature )
   if ( mClosed )
     return false;
 
-  if ( mUsingFeatureIdList )
+  if ( mSource->mColumnarStorage )
+    return nextFeatureColumnar( feature );
+  else if ( mUsingFeatureIdList )
     return nextFeatureUsingList( feature );
   else
     return nextFeatureTraverseAll( feature );
@@ -224,6 +259,70 @@ bool QgsMemoryFeatureIterator::nextFeatureTraverseAll( QgsFeature &feature )
   return hasFeature;
 }
 
+bool QgsMemoryFeatureIterator::nextFeatureColumnar( QgsFeature &feature )
+{
+  const QgsMemoryColumnarStorage &storage = *mSource->mColumnarStorage;
+  const int rowCount = storage.featureCount();
+
+  while ( true )
+  {
+    int row = -1;
+    if ( mUsingFeatureIdList )
+    {
+      if ( mFeatureIdListIterator == mFeatureIdList.constEnd() )
+        break;
+
+      row = storage.rowForId( *mFeatureIdListIterator );
+      ++mFeatureIdListIterator;
+      if ( row < 0 )
+        continue;
+    }
+    else
+    {
+      if ( mRow >= rowCount )
+        break;
+
+      row = mRow++;
+    }
+
+    if ( !mFilterRect.isNull() )
+    {
+      if ( !storage.hasGeometry( row ) )
+        continue;
+
+      if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
+      {
+        // do exact check in case we're doing intersection
+        if ( !mSelectRectEngine->intersects( storage.geometry( row ).constGet() ) )
+          continue;
+      }
+      else if ( !mSource->mSpatialIndex && !storage.boundingBox( row ).intersects( mFilterRect ) )
+      {
+        // do bounding box check if we aren't using a spatial index
+        continue;
+      }
+    }
+
+    // the feature is only created for rows which pass the spatial filter
+    storage.readFeature( row, feature, mAttributes, mFetchGeometry );
+
+    if ( mSubsetExpression )
+    {
+      mSource->expressionContext()->setFeature( feature );
+      if ( !mSubsetExpression->evaluate( mSource->expressionContext() ).toBool() )
+        continue;
+    }
+
+    feature.setFields( mSource->mFields ); // allow name-based attribute lookups
+    geometryToDestinationCrs( feature, mTransform );
+    return true;
+  }
+
+  feature.setValid( false );
+  close();
+  return false;
+}
+
 bool QgsMemoryFeatureIterator::rewind()
 {
   if ( mClosed )
@@ -233,6 +332,7 @@ bool QgsMemoryFeatureIterator::rewind()
     mFeatureIdListIterator = mFeatureIdList.constBegin();
   else
     mSelectIterator = mSource->mFeatures.constBegin();
+  mRow = 0;
 
   return true;
 }
@@ -253,6 +353,7 @@ bool QgsMemoryFeatureIterator::close()
 QgsMemoryFeatureSource::QgsMemoryFeatureSource( const QgsMemoryProvider *p )
   : mFields( p->mFields )
   , mFeatures( p->mFeatures )
+  , mColumnarStorage( p->mColumnarStorage )
   , mSpatialIndex( p->mSpatialIndex ? std::make_unique< QgsSpatialIndex >( *p->mSpatialIndex ) : nullptr ) // just shallow copy
   , mSubsetString( p->mSubsetString )
   , mCrs( p->mCrs )
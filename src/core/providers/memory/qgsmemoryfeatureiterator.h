@@ -29,6 +29,7 @@ class QgsMemoryProvider;
 typedef QMap<QgsFeatureId, QgsFeature> QgsFeatureMap;
 
 class QgsSpatialIndex;
+class QgsMemoryColumnarStorage;
 
 
 class QgsMemoryFeatureSource final: public QgsAbstractFeatureSource
@@ -43,6 +44,7 @@ class QgsMemoryFeatureSource final: public QgsAbstractFeatureSource
   private:
     QgsFields mFields;
     QgsFeatureMap mFeatures;
+    std::shared_ptr< const QgsMemoryColumnarStorage > mColumnarStorage;
     std::unique_ptr< QgsSpatialIndex > mSpatialIndex;
     QString mSubsetString;
     std::unique_ptr< QgsExpressionContext > mExpressionContext;
@@ -69,6 +71,7 @@ class QgsMemoryFeatureIterator final: public QgsAbstractFeatureIteratorFromSourc
   private:
     bool nextFeatureUsingList( QgsFeature &feature );
     bool nextFeatureTraverseAll( QgsFeature &feature );
+    bool nextFeatureColumnar( QgsFeature &feature );
 
     QgsGeometry mSelectRectGeom;
     std::unique_ptr< QgsGeometryEngine > mSelectRectEngine;
@@ -80,6 +83,13 @@ class QgsMemoryFeatureIterator final: public QgsAbstractFeatureIteratorFromSourc
     std::unique_ptr< QgsExpression > mSubsetExpression;
     QgsCoordinateTransform mTransform;
 
+    //! Next row to read when traversing the whole columnar storage
+    int mRow = 0;
+    //! Attributes read from the columnar storage
+    QgsAttributeList mAttributes;
+    //! Whether geometries are read from the columnar storage
+    bool mFetchGeometry = true;
+
 };
 
 ///@endcond PRIVATE
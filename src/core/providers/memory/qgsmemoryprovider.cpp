@@ -15,6 +15,7 @@
 
 #include "qgsmemoryprovider.h"
 #include "qgsmemoryfeatureiterator.h"
+#include "qgsmemorycolumnarstorage.h"
 
 #include "qgsfeature.h"
 #include "qgsfields.h"
@@ -72,6 +73,12 @@ QgsMemoryProvider::QgsMemoryProvider( const QString &uri, const ProviderOptions
 
   mNextFeatureId = 1;
 
+  // columnar storage trades slower edits of single features for much lower memory use and faster scans
+  if ( query.hasQueryItem( QStringLiteral( "storage" ) ) && query.queryItemValue( QStringLiteral( "storage" ) ) == QLatin1String( "columnar" ) )
+  {
+    mColumnarStorage = std::make_shared< QgsMemoryColumnarStorage >();
+  }
+
   setNativeTypes( QList< NativeType >()
                   << QgsVectorDataProvider::NativeType( tr( "Whole number (integer)" ), QStringLiteral( "integer" ), QVariant::Int, 0, 10 )
                   // Decimal number from OGR/Shapefile/dbf may come with length up to 32 and
@@ -279,6 +286,10 @@ QString QgsMemoryProvider::dataSourceUri( bool expandAuthConfig ) const
   {
     query.addQueryItem( QStringLiteral( "index" ), QStringLiteral( "yes" ) );
   }
+  if ( mColumnarStorage )
+  {
+    query.addQueryItem( QStringLiteral( "storage" ), QStringLiteral( "columnar" ) );
+  }
 
   QgsAttributeList attrs = const_cast<QgsMemoryProvider *>( this )->attributeIndexes();
   for ( int i = 0; i < attrs.size(); i++ )
@@ -336,10 +347,21 @@ QgsFeatureIterator QgsMemoryProvider::getFeatures( const QgsFeatureRequest &requ
 
 QgsRectangle QgsMemoryProvider::extent() const
 {
-  if ( mExtent.isEmpty() && !mFeatures.isEmpty() )
+  const bool hasFeatures = mColumnarStorage ? mColumnarStorage->featureCount() > 0 : !mFeatures.isEmpty();
+  if ( mExtent.isEmpty() && hasFeatures )
   {
     mExtent.setMinimal();
-    if ( mSubsetString.isEmpty() )
+    if ( mSubsetString.isEmpty() && mColumnarStorage )
+    {
+      // fast way - combine the stored bounding boxes
+      const int count = mColumnarStorage->featureCount();
+      for ( int row = 0; row < count; ++row )
+      {
+        if ( mColumnarStorage->hasGeometry( row ) )
+          mExtent.combineExtentWith( mColumnarStorage->boundingBox( row ) );
+      }
+    }
+    else if ( mSubsetString.isEmpty() )
     {
       // fast way - iterate through all features
       const auto constMFeatures = mFeatures;
@@ -360,7 +382,7 @@ QgsRectangle QgsMemoryProvider::extent() const
       }
     }
   }
-  else if ( mFeatures.isEmpty() )
+  else if ( !hasFeatures )
   {
     mExtent.setMinimal();
   }
@@ -376,7 +398,7 @@ QgsWkbTypes::Type QgsMemoryProvider::wkbType() const
 long long QgsMemoryProvider::featureCount() const
 {
   if ( mSubsetString.isEmpty() )
-    return mFeatures.count();
+    return mColumnarStorage ? mColumnarStorage->featureCount() : mFeatures.count();
 
   // subset string set, no alternative but testing each feature
   QgsFeatureIterator fit = QgsFeatureIterator( new QgsMemoryFeatureIterator( new QgsMemoryFeatureSource( this ), true,  QgsFeatureRequest().setNoAttributes() ) );
@@ -411,6 +433,8 @@ void QgsMemoryProvider::handlePostCloneOperations( QgsVectorDataProvider *source
   {
     // these properties aren't copied when cloning a memory provider by uri, so we need to do it manually
     mFeatures = other->mFeatures;
+    // the storage is shared until one of the providers modifies it
+    mColumnarStorage = other->mColumnarStorage;
     mNextFeatureId = other->mNextFeatureId;
     mExtent = other->mExtent;
   }
@@ -420,8 +444,10 @@ void QgsMemoryProvider::handlePostCloneOperations( QgsVectorDataProvider *source
 bool QgsMemoryProvider::addFeatures( QgsFeatureList &flist, Flags flags )
 {
   bool result = true;
+  QgsMemoryColumnarStorage *columnarStorage = mColumnarStorage ? columnarStorageForWrite() : nullptr;
+
   // whether or not to update the layer extent on the fly as we add features
-  bool updateExtent = mFeatures.isEmpty() || !mExtent.isEmpty();
+  bool updateExtent = ( columnarStorage ? columnarStorage->featureCount() == 0 : mFeatures.isEmpty() ) || !mExtent.isEmpty();
 
   int fieldCount = mFields.count();
 
@@ -503,7 +529,10 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList &flist, Flags flags )
       continue;
     }
 
-    mFeatures.insert( mNextFeatureId, *it );
+    if ( columnarStorage )
+      columnarStorage->appendFeature( *it );
+    else
+      mFeatures.insert( mNextFeatureId, *it );
     addedFids.insert( mNextFeatureId );
 
     if ( it->hasGeometry() )
@@ -522,9 +551,16 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList &flist, Flags flags )
   // Roll back
   if ( ! result && flags.testFlag( QgsFeatureSink::Flag::RollBackOnErrors ) )
   {
-    for ( const QgsFeatureId &addedFid : addedFids )
+    if ( columnarStorage )
     {
-      mFeatures.remove( addedFid );
+      columnarStorage->deleteFeatures( addedFids );
+    }
+    else
+    {
+      for ( const QgsFeatureId &addedFid : addedFids )
+      {
+        mFeatures.remove( addedFid );
+      }
     }
     mExtent = oldExtent;
     mNextFeatureId = oldNextFeatureId;
@@ -539,6 +575,33 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList &flist, Flags flags )
 
 bool QgsMemoryProvider::deleteFeatures( const QgsFeatureIds &id )
 {
+  if ( mColumnarStorage )
+  {
+    QgsMemoryColumnarStorage *columnarStorage = columnarStorageForWrite();
+
+    // update spatial index
+    if ( mSpatialIndex )
+    {
+      for ( QgsFeatureId fid : id )
+      {
+        const int row = columnarStorage->rowForId( fid );
+        if ( row < 0 )
+          continue;
+
+        QgsFeature feature( fid );
+        feature.setGeometry( columnarStorage->geometry( row ) );
+        mSpatialIndex->deleteFeature( feature );
+      }
+    }
+
+    // all features are removed at once, as each removal has to move the following features
+    columnarStorage->deleteFeatures( id );
+
+    updateExtents();
+    clearMinMaxCache();
+    return true;
+  }
+
   for ( QgsFeatureIds::const_iterator it = id.begin(); it != id.end(); ++it )
   {
     QgsFeatureMap::iterator fit = mFeatures.find( *it );
@@ -597,6 +660,12 @@ bool QgsMemoryProvider::addAttributes( const QList<QgsField> &attributes )
     // add new field as a last one
     mFields.append( field );
 
+    if ( mColumnarStorage )
+    {
+      columnarStorageForWrite()->addField( field );
+      continue;
+    }
+
     for ( QgsFeatureMap::iterator fit = mFeatures.begin(); fit != mFeatures.end(); ++fit )
     {
       QgsFeature &f = fit.value();
@@ -643,6 +712,12 @@ bool QgsMemoryProvider::deleteAttributes( const QgsAttributeIds &attributes )
     int idx = *it;
     mFields.remove( idx );
 
+    if ( mColumnarStorage )
+    {
+      columnarStorageForWrite()->removeField( idx );
+      continue;
+    }
+
     for ( QgsFeatureMap::iterator fit = mFeatures.begin(); fit != mFeatures.end(); ++fit )
     {
       QgsFeature &f = fit.value();
@@ -661,12 +736,25 @@ bool QgsMemoryProvider::changeAttributeValues( const QgsChangedAttributesMap &at
 
   QgsChangedAttributesMap rollBackMap;
 
+  QgsMemoryColumnarStorage *columnarStorage = mColumnarStorage ? columnarStorageForWrite() : nullptr;
+
   QString errorMessage;
   for ( QgsChangedAttributesMap::const_iterator it = attr_map.begin(); it != attr_map.end(); ++it )
   {
-    QgsFeatureMap::iterator fit = mFeatures.find( it.key() );
-    if ( fit == mFeatures.end() )
-      continue;
+    QgsFeatureMap::iterator fit;
+    int row = -1;
+    if ( columnarStorage )
+    {
+      row = columnarStorage->rowForId( it.key() );
+      if ( row < 0 )
+        continue;
+    }
+    else
+    {
+      fit = mFeatures.find( it.key() );
+      if ( fit == mFeatures.end() )
+        continue;
+    }
 
     const QgsAttributeMap &attrs = it.value();
     QgsAttributeMap rollBackAttrs;
@@ -690,8 +778,16 @@ bool QgsMemoryProvider::changeAttributeValues( const QgsChangedAttributesMap &at
         result = false;
         break;
       }
-      rollBackAttrs.insert( it2.key(), fit->attribute( it2.key() ) );
-      fit->setAttribute( it2.key(), attrValue );
+      if ( columnarStorage )
+      {
+        rollBackAttrs.insert( it2.key(), columnarStorage->attribute( row, it2.key() ) );
+        columnarStorage->setAttribute( row, it2.key(), attrValue );
+      }
+      else
+      {
+        rollBackAttrs.insert( it2.key(), fit->attribute( it2.key() ) );
+        fit->setAttribute( it2.key(), attrValue );
+      }
     }
     rollBackMap.insert( it.key(), rollBackAttrs );
   }
@@ -710,6 +806,31 @@ bool QgsMemoryProvider::changeAttributeValues( const QgsChangedAttributesMap &at
 
 bool QgsMemoryProvider::changeGeometryValues( const QgsGeometryMap &geometry_map )
 {
+  if ( mColumnarStorage )
+  {
+    QgsMemoryColumnarStorage *columnarStorage = columnarStorageForWrite();
+    for ( QgsGeometryMap::const_iterator it = geometry_map.begin(); it != geometry_map.end(); ++it )
+    {
+      const int row = columnarStorage->rowForId( it.key() );
+      if ( row < 0 )
+        continue;
+
+      // update spatial index
+      if ( mSpatialIndex && columnarStorage->hasGeometry( row ) )
+        mSpatialIndex->deleteFeature( columnarStorage->feature( row ) );
+
+      columnarStorage->setGeometry( row, it.value() );
+
+      // update spatial index
+      if ( mSpatialIndex && columnarStorage->hasGeometry( row ) )
+        mSpatialIndex->addFeature( it.key(), columnarStorage->boundingBox( row ) );
+    }
+
+    updateExtents();
+
+    return true;
+  }
+
   for ( QgsGeometryMap::const_iterator it = geometry_map.begin(); it != geometry_map.end(); ++it )
   {
     QgsFeatureMap::iterator fit = mFeatures.find( it.key() );
@@ -766,6 +887,15 @@ bool QgsMemoryProvider::createSpatialIndex()
     mSpatialIndex = new QgsSpatialIndex();
 
     // add existing features to index
+    if ( mColumnarStorage )
+    {
+      const int count = mColumnarStorage->featureCount();
+      for ( int row = 0; row < count; ++row )
+      {
+        if ( mColumnarStorage->hasGeometry( row ) )
+          mSpatialIndex->addFeature( mColumnarStorage->idForRow( row ), mColumnarStorage->boundingBox( row ) );
+      }
+    }
     for ( QgsFeatureMap::iterator it = mFeatures.begin(); it != mFeatures.end(); ++it )
     {
       mSpatialIndex->addFeature( *it );
@@ -789,6 +919,11 @@ QgsVectorDataProvider::Capabilities QgsMemoryProvider::capabilities() const
 bool QgsMemoryProvider::truncate()
 {
   mFeatures.clear();
+  if ( mColumnarStorage )
+  {
+    // don't clear the storage in place, it may still be in use by feature sources
+    mColumnarStorage = std::make_shared< QgsMemoryColumnarStorage >( mFields );
+  }
   clearMinMaxCache();
   mExtent.setMinimal();
   return true;
@@ -799,6 +934,16 @@ void QgsMemoryProvider::updateExtents()
   mExtent.setMinimal();
 }
 
+QgsMemoryColumnarStorage *QgsMemoryProvider::columnarStorageForWrite()
+{
+  // feature sources keep a reference to the storage for the lifetime of their iterators,
+  // so the storage is detached before it is modified
+  if ( mColumnarStorage.use_count() > 1 )
+    mColumnarStorage = std::make_shared< QgsMemoryColumnarStorage >( *mColumnarStorage );
+
+  return mColumnarStorage.get();
+}
+
 QString QgsMemoryProvider::name() const
 {
   return TEXT_PROVIDER_KEY;
@@ -19,10 +19,13 @@
 #include "qgscoordinatereferencesystem.h"
 #include "qgsfields.h"
 
+#include <memory>
+
 ///@cond PRIVATE
 typedef QMap<QgsFeatureId, QgsFeature> QgsFeatureMap;
 
 class QgsSpatialIndex;
+class QgsMemoryColumnarStorage;
 
 class QgsMemoryFeatureIterator;
 
@@ -84,6 +87,13 @@ class QgsMemoryProvider final: public QgsVectorDataProvider
     void handlePostCloneOperations( QgsVectorDataProvider *source ) override;
 
   private:
+
+    /**
+     * Returns the columnar storage, ready to be modified. Feature sources share the storage with
+     * the provider, so it is copied first if it is in use by a source.
+     */
+    QgsMemoryColumnarStorage *columnarStorageForWrite();
+
     // Coordinate reference system
     QgsCoordinateReferenceSystem mCrs;
 
@@ -96,6 +106,9 @@ class QgsMemoryProvider final: public QgsVectorDataProvider
     QgsFeatureMap mFeatures;
     QgsFeatureId mNextFeatureId;
 
+    // features, when using columnar storage (in which case mFeatures is not used)
+    std::shared_ptr< QgsMemoryColumnarStorage > mColumnarStorage;
+
     // indexing
     QgsSpatialIndex *mSpatialIndex = nullptr;
 
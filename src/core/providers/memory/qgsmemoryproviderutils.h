@@ -45,11 +45,14 @@ class CORE_EXPORT QgsMemoryProviderUtils
      * \param fields fields for layer
      * \param geometryType optional layer geometry type
      * \param crs optional layer CRS for layers with geometry
+     * \param columnarStorage set to TRUE to store the layer's features in columnar storage, which uses
+     * less memory and is faster to iterate for large layers, at the cost of slower edits of individual features (since QGIS 3.22)
      */
     static QgsVectorLayer *createMemoryLayer( const QString &name,
         const QgsFields &fields,
         QgsWkbTypes::Type geometryType = QgsWkbTypes::NoGeometry,
-        const QgsCoordinateReferenceSystem &crs = QgsCoordinateReferenceSystem() ) SIP_FACTORY;
+        const QgsCoordinateReferenceSystem &crs = QgsCoordinateReferenceSystem(),
+        bool columnarStorage = false ) SIP_FACTORY;
 };
 
 #endif // QGSMEMORYPROVIDERUTILS_H
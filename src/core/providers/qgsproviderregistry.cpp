@@ -37,6 +37,7 @@
 
 #ifdef HAVE_EPT
 #include "providers/ept/qgseptprovider.h"
+#include "providers/copc/qgscopcprovider.h"
 #endif
 
 #include "qgsruntimeprofiler.h"
@@ -184,6 +185,11 @@ void QgsProviderRegistry::init()
     QgsProviderMetadata *pc = new QgsEptProviderMetadata();
     mProviders[ pc->key() ] = pc;
   }
+  {
+    QgsScopedRuntimeProfile profile( QObject::tr( "Create COPC point cloud provider" ) );
+    QgsProviderMetadata *pc = new QgsCopcProviderMetadata();
+    mProviders[ pc->key() ] = pc;
+  }
 #endif
 
   registerUnusableUriHandler( new PdalUnusableUriHandlerInterface() );
@@ -22,7 +22,8 @@
 #include "qgsgeometry.h"
 #include "qgsvectorlayer.h"
 
-
+//! Number of features for which expressions are evaluated at once
+static const int EXPRESSION_BATCH_SIZE = 1024;
 
 QgsAggregateCalculator::QgsAggregateCalculator( const QgsVectorLayer *layer )
   : mLayer( layer )
@@ -682,16 +683,31 @@ QVariant QgsAggregateCalculator::calculateNumericAggregate( QgsFeatureIterator &
   QgsStatisticalSummary s( stat );
   QgsFeature f;
 
-  while ( fit.nextFeature( f ) )
+  if ( expression )
   {
-    if ( expression )
+    Q_ASSERT( context );
+    // evaluate the expression over blocks of features, which is much faster than one feature at a time
+    QgsFeatureList features;
+    features.reserve( EXPRESSION_BATCH_SIZE );
+    bool hasMoreFeatures = true;
+    while ( hasMoreFeatures )
     {
-      Q_ASSERT( context );
-      context->setFeature( f );
-      QVariant v = expression->evaluate( context );
-      s.addVariant( v );
+      hasMoreFeatures = fit.nextFeature( f );
+      if ( hasMoreFeatures )
+        features << f;
+
+      if ( features.size() == EXPRESSION_BATCH_SIZE || ( !hasMoreFeatures && !features.isEmpty() ) )
+      {
+        const QVariantList values = expression->evaluateBatch( features, context );
+        for ( const QVariant &v : values )
+          s.addVariant( v );
+        features.clear();
+      }
     }
-    else
+  }
+  else
+  {
+    while ( fit.nextFeature( f ) )
     {
       s.addVariant( f.attribute( attr ) );
     }
@@ -709,16 +725,31 @@ QVariant QgsAggregateCalculator::calculateStringAggregate( QgsFeatureIterator &f
   QgsStringStatisticalSummary s( stat );
   QgsFeature f;
 
-  while ( fit.nextFeature( f ) )
+  if ( expression )
   {
-    if ( expression )
+    Q_ASSERT( context );
+    // evaluate the expression over blocks of features, which is much faster than one feature at a time
+    QgsFeatureList features;
+    features.reserve( EXPRESSION_BATCH_SIZE );
+    bool hasMoreFeatures = true;
+    while ( hasMoreFeatures )
     {
-      Q_ASSERT( context );
-      context->setFeature( f );
-      QVariant v = expression->evaluate( context );
-      s.addValue( v );
+      hasMoreFeatures = fit.nextFeature( f );
+      if ( hasMoreFeatures )
+        features << f;
+
+      if ( features.size() == EXPRESSION_BATCH_SIZE || ( !hasMoreFeatures && !features.isEmpty() ) )
+      {
+        const QVariantList values = expression->evaluateBatch( features, context );
+        for ( const QVariant &v : values )
+          s.addValue( v );
+        features.clear();
+      }
     }
-    else
+  }
+  else
+  {
+    while ( fit.nextFeature( f ) )
     {
       s.addValue( f.attribute( attr ) );
     }
@@ -319,6 +319,16 @@ void QgsMapSettings::setLayerStyleOverrides( const QMap<QString, QString> &overr
   mLayerStyleOverrides = overrides;
 }
 
+QMap<QString, int> QgsMapSettings::layerRenderTileCounts() const
+{
+  return mLayerRenderTileCounts;
+}
+
+void QgsMapSettings::setLayerRenderTileCounts( const QMap<QString, int> &counts )
+{
+  mLayerRenderTileCounts = counts;
+}
+
 void QgsMapSettings::setDestinationCrs( const QgsCoordinateReferenceSystem &crs )
 {
   mDestCRS = crs;
@@ -286,6 +286,30 @@ class CORE_EXPORT QgsMapSettings : public QgsTemporalRangeObject
      */
     void setLayerStyleOverrides( const QMap<QString, QString> &overrides );
 
+    /**
+     * Returns the map of layer tile counts (key: layer ID, value: number of tiles) for layers which
+     * should be split into multiple tiles rendered concurrently.
+     *
+     * \see setLayerRenderTileCounts()
+     * \since QGIS 3.22
+     */
+    QMap<QString, int> layerRenderTileCounts() const;
+
+    /**
+     * Sets the map of layer tile \a counts (key: layer ID, value: number of tiles) for layers which
+     * should be split into multiple tiles rendered concurrently.
+     *
+     * This is an opt-in optimization for maps dominated by a single heavy vector layer. When rendering
+     * with QgsMapRendererParallelJob, a layer with a tile count greater than 1 is split into horizontal
+     * stripes of the map image, which are rendered on separate threads and then composed in order.
+     * Layers which participate in labeling, diagrams or selective masking, as well as rotated maps,
+     * are always rendered in a single piece.
+     *
+     * \see layerRenderTileCounts()
+     * \since QGIS 3.22
+     */
+    void setLayerRenderTileCounts( const QMap<QString, int> &counts );
+
     /**
      * Returns custom rendering flags. Layers might honour these to alter their rendering.
      * \returns custom flags strings, separated by ';'
@@ -828,6 +852,7 @@ class CORE_EXPORT QgsMapSettings : public QgsTemporalRangeObject
     //! list of layers to be rendered (stored as weak pointers)
     QgsWeakMapLayerPointerList mLayers;
     QMap<QString, QString> mLayerStyleOverrides;
+    QMap<QString, int> mLayerRenderTileCounts;
     QString mCustomRenderFlags;
     QVariantMap mCustomRenderingFlags;
     QgsExpressionContext mExpressionContext;
@@ -23,6 +23,7 @@
 #include "qgsfeaturesource.h"
 #include "qgsfeedback.h"
 #include "qgsspatialindexutils.h"
+#include "qgsspatialindexpackedrtree_p.h"
 
 #include <spatialindex/SpatialIndex.h>
 #include <QMutex>
@@ -269,6 +270,12 @@ class QgsSpatialIndexData : public QSharedData
                                   const std::function< bool( const QgsFeature & ) > *callback = nullptr )
       : mFlags( flags )
     {
+      if ( flags & QgsSpatialIndex::FlagStaticIndex )
+      {
+        initStaticTree( fi, feedback, callback );
+        return;
+      }
+
       QgsFeatureIteratorDataStream fids( fi, feedback, mFlags, callback );
       initTree( &fids );
       if ( flags & QgsSpatialIndex::FlagStoreFeatureGeometries )
@@ -284,6 +291,11 @@ class QgsSpatialIndexData : public QSharedData
 
       initTree();
 
+      // static trees are never modified, so they can be shared
+      mStaticTree = other.mStaticTree;
+      if ( mStaticTree )
+        return;
+
       // copy R-tree data one by one (is there a faster way??)
       double low[]  = { std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest() };
       double high[] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
@@ -323,12 +335,61 @@ class QgsSpatialIndexData : public QSharedData
                                         leafCapacity, dimension, variant, indexId );
     }
 
+    void initStaticTree( const QgsFeatureIterator &fi, QgsFeedback *feedback, const std::function< bool( const QgsFeature & ) > *callback )
+    {
+      initTree();
+
+      std::vector< QgsFeatureId > ids;
+      std::vector< QgsRectangle > bounds;
+      QgsFeatureIterator it( fi );
+      QgsFeature f;
+      QgsRectangle rect;
+      QgsFeatureId id;
+      while ( it.nextFeature( f ) )
+      {
+        if ( feedback && feedback->isCanceled() )
+          break;
+
+        if ( callback && !( *callback )( f ) )
+          break;
+
+        if ( QgsSpatialIndex::featureInfo( f, rect, id ) )
+        {
+          ids.emplace_back( id );
+          bounds.emplace_back( rect );
+          if ( mFlags & QgsSpatialIndex::FlagStoreFeatureGeometries )
+            mGeometries.insert( f.id(), f.geometry() );
+        }
+      }
+
+      if ( !ids.empty() )
+        mStaticTree = std::make_shared< const QgsSpatialIndexPackedRTree >( ids, bounds );
+    }
+
+    /**
+     * Moves the entries of the static tree to the R-tree, so that the index can be modified.
+     */
+    void detachStaticTree()
+    {
+      if ( !mStaticTree )
+        return;
+
+      mStaticTree->visitEntries( [this]( QgsFeatureId id, const QgsRectangle & rect )
+      {
+        mRTree->insertData( 0, nullptr, QgsSpatialIndexUtils::rectangleToRegion( rect ), FID_TO_NUMBER( id ) );
+      } );
+      mStaticTree.reset();
+    }
+
     //! Storage manager
     SpatialIndex::IStorageManager *mStorage = nullptr;
 
     //! R-tree containing spatial index
     SpatialIndex::ISpatialIndex *mRTree = nullptr;
 
+    //! Static tree containing the spatial index when bulk loaded with FlagStaticIndex, in which case mRTree is empty
+    std::shared_ptr< const QgsSpatialIndexPackedRTree > mStaticTree;
+
 #if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
     mutable QMutex mMutex;
 #else
@@ -454,6 +515,7 @@ bool QgsSpatialIndex::addFeature( QgsFeatureId id, const QgsRectangle &bounds )
   // TODO: handle possible exceptions correctly
   try
   {
+    d->detachStaticTree();
     d->mRTree->insertData( 0, nullptr, r, FID_TO_NUMBER( id ) );
     return true;
   }
@@ -483,6 +545,7 @@ bool QgsSpatialIndex::deleteFeature( const QgsFeature &f )
     return false;
 
   QMutexLocker locker( &d->mMutex );
+  d->detachStaticTree();
   // TODO: handle exceptions
   if ( d->mFlags & QgsSpatialIndex::FlagStoreFeatureGeometries )
     d->mGeometries.remove( f.id() );
@@ -497,6 +560,9 @@ QList<QgsFeatureId> QgsSpatialIndex::intersects( const QgsRectangle &rect ) cons
   SpatialIndex::Region r = QgsSpatialIndexUtils::rectangleToRegion( rect );
 
   QMutexLocker locker( &d->mMutex );
+  if ( d->mStaticTree )
+    return d->mStaticTree->intersects( rect );
+
   d->mRTree->intersectsWithQuery( r, visitor );
 
   return list;
@@ -511,6 +577,17 @@ QList<QgsFeatureId> QgsSpatialIndex::nearestNeighbor( const QgsPointXY &point, c
   Point p( pt, 2 );
 
   QMutexLocker locker( &d->mMutex );
+  if ( d->mStaticTree )
+  {
+    std::function< double( QgsFeatureId ) > exactDistance;
+    if ( d->mFlags & QgsSpatialIndex::FlagStoreFeatureGeometries )
+    {
+      const QgsGeometry pointGeometry = QgsGeometry::fromPointXY( point );
+      exactDistance = [this, pointGeometry]( QgsFeatureId id ) { return d->mGeometries.value( id ).distance( pointGeometry ); };
+    }
+    return d->mStaticTree->nearestNeighbors( QgsRectangle( point.x(), point.y(), point.x(), point.y() ), neighbors, maxDistance, exactDistance );
+  }
+
   QgsNearestNeighborComparator nnc( ( d->mFlags & QgsSpatialIndex::FlagStoreFeatureGeometries ) ? &d->mGeometries : nullptr,
                                     point, maxDistance );
   d->mRTree->nearestNeighborQuery( neighbors, p, visitor, nnc );
@@ -536,6 +613,14 @@ QList<QgsFeatureId> QgsSpatialIndex::nearestNeighbor( const QgsGeometry &geometr
   SpatialIndex::Region r = QgsSpatialIndexUtils::rectangleToRegion( geometry.boundingBox() );
 
   QMutexLocker locker( &d->mMutex );
+  if ( d->mStaticTree )
+  {
+    std::function< double( QgsFeatureId ) > exactDistance;
+    if ( d->mFlags & QgsSpatialIndex::FlagStoreFeatureGeometries )
+      exactDistance = [this, &geometry]( QgsFeatureId id ) { return d->mGeometries.value( id ).distance( geometry ); };
+    return d->mStaticTree->nearestNeighbors( geometry.boundingBox(), neighbors, maxDistance, exactDistance );
+  }
+
   QgsNearestNeighborComparator nnc( ( d->mFlags & QgsSpatialIndex::FlagStoreFeatureGeometries ) ? &d->mGeometries : nullptr,
                                     geometry, maxDistance );
   d->mRTree->nearestNeighborQuery( neighbors, r, visitor, nnc );
@@ -75,6 +75,7 @@ class CORE_EXPORT QgsSpatialIndex : public QgsFeatureSink
     enum Flag
     {
       FlagStoreFeatureGeometries = 1 << 0, //!< Indicates that the spatial index should also store feature geometries. This requires more memory, but can speed up operations by avoiding additional requests to data providers to fetch matching feature geometries. Additionally, it is required for non-bounding box nearest neighbor searches.
+      FlagStaticIndex = 1 << 1, //!< Indicates that an index bulk loaded from features should be stored in a static, packed R-tree. Static indexes are faster to build and query, and use less memory, but adding or deleting features from a static index converts it back to a regular index. This flag has no effect for indexes which are not bulk loaded (since QGIS 3.22)
     };
     Q_DECLARE_FLAGS( Flags, Flag )
 
@@ -295,6 +296,7 @@ class CORE_EXPORT QgsSpatialIndex : public QgsFeatureSink
     static bool featureInfo( const QgsFeature &f, QgsRectangle &rect, QgsFeatureId &id );
 
     friend class QgsFeatureIteratorDataStream; // for access to featureInfo()
+    friend class QgsSpatialIndexData; // for access to featureInfo()
 
   private:
 
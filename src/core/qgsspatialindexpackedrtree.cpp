@@ -0,0 +1,309 @@
+/***************************************************************************
+                             qgsspatialindexpackedrtree.cpp
+                             -----------------
+    begin                : October 2021
+    copyright            : (C) 2021 by Nyall Dawson
+    email                : nyall dot dawson at gmail dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsspatialindexpackedrtree_p.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <queue>
+
+///@cond PRIVATE
+
+// Position of a point along a Hilbert curve, for coordinates in the [0, 0xFFFF] range.
+// From "Fast Hilbert curve generation, sorting, and range queries" by rawrunprotected (public domain)
+static quint32 hilbertValue( quint32 x, quint32 y )
+{
+  quint32 a = x ^ y;
+  quint32 b = 0xFFFF ^ a;
+  quint32 c = 0xFFFF ^ ( x | y );
+  quint32 d = x & ( y ^ 0xFFFF );
+
+  quint32 A = a | ( b >> 1 );
+  quint32 B = ( a >> 1 ) ^ a;
+  quint32 C = ( ( c >> 1 ) ^ ( b & ( d >> 1 ) ) ) ^ c;
+  quint32 D = ( ( a & ( c >> 1 ) ) ^ ( d >> 1 ) ) ^ d;
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  A = ( ( a & ( a >> 2 ) ) ^ ( b & ( b >> 2 ) ) );
+  B = ( ( a & ( b >> 2 ) ) ^ ( b & ( ( a ^ b ) >> 2 ) ) );
+  C ^= ( ( a & ( c >> 2 ) ) ^ ( b & ( d >> 2 ) ) );
+  D ^= ( ( b & ( c >> 2 ) ) ^ ( ( a ^ b ) & ( d >> 2 ) ) );
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  A = ( ( a & ( a >> 4 ) ) ^ ( b & ( b >> 4 ) ) );
+  B = ( ( a & ( b >> 4 ) ) ^ ( b & ( ( a ^ b ) >> 4 ) ) );
+  C ^= ( ( a & ( c >> 4 ) ) ^ ( b & ( d >> 4 ) ) );
+  D ^= ( ( b & ( c >> 4 ) ) ^ ( ( a ^ b ) & ( d >> 4 ) ) );
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  C ^= ( ( a & ( c >> 8 ) ) ^ ( b & ( d >> 8 ) ) );
+  D ^= ( ( b & ( c >> 8 ) ) ^ ( ( a ^ b ) & ( d >> 8 ) ) );
+
+  a = C ^ ( C >> 1 );
+  b = D ^ ( D >> 1 );
+
+  quint32 i0 = x ^ y;
+  quint32 i1 = b | ( 0xFFFF ^ ( i0 | a ) );
+
+  i0 = ( i0 | ( i0 << 8 ) ) & 0x00FF00FF;
+  i0 = ( i0 | ( i0 << 4 ) ) & 0x0F0F0F0F;
+  i0 = ( i0 | ( i0 << 2 ) ) & 0x33333333;
+  i0 = ( i0 | ( i0 << 1 ) ) & 0x55555555;
+
+  i1 = ( i1 | ( i1 << 8 ) ) & 0x00FF00FF;
+  i1 = ( i1 | ( i1 << 4 ) ) & 0x0F0F0F0F;
+  i1 = ( i1 | ( i1 << 2 ) ) & 0x33333333;
+  i1 = ( i1 | ( i1 << 1 ) ) & 0x55555555;
+
+  return ( i1 << 1 ) | i0;
+}
+
+QgsSpatialIndexPackedRTree::QgsSpatialIndexPackedRTree( const std::vector<QgsFeatureId> &ids, const std::vector<QgsRectangle> &bounds )
+{
+  Q_ASSERT( ids.size() == bounds.size() );
+
+  const std::size_t leafCount = ids.size();
+  if ( leafCount == 0 )
+    return;
+
+  QgsRectangle extent;
+  extent.setMinimal();
+  for ( const QgsRectangle &rect : bounds )
+    extent.combineExtentWith( rect );
+
+  // sort the entries along a Hilbert curve, so that nearby entries end up in the same nodes
+  const double hilbertMax = 0xFFFF;
+  const double scaleX = extent.width() > 0 ? hilbertMax / extent.width() : 0;
+  const double scaleY = extent.height() > 0 ? hilbertMax / extent.height() : 0;
+  std::vector< quint32 > hilbertValues( leafCount );
+  for ( std::size_t i = 0; i < leafCount; ++i )
+  {
+    const QgsRectangle &rect = bounds[i];
+    const quint32 x = static_cast< quint32 >( std::floor( ( ( rect.xMinimum() + rect.xMaximum() ) / 2 - extent.xMinimum() ) * scaleX ) );
+    const quint32 y = static_cast< quint32 >( std::floor( ( ( rect.yMinimum() + rect.yMaximum() ) / 2 - extent.yMinimum() ) * scaleY ) );
+    hilbertValues[i] = hilbertValue( x, y );
+  }
+
+  std::vector< std::size_t > order( leafCount );
+  std::iota( order.begin(), order.end(), 0 );
+  std::sort( order.begin(), order.end(), [&hilbertValues]( std::size_t a, std::size_t b )
+  {
+    return hilbertValues[a] < hilbertValues[b];
+  } );
+
+  // calculate the number of nodes in each level, up to the single root node
+  std::size_t count = leafCount;
+  std::size_t total = leafCount;
+  mLevelBounds.emplace_back( leafCount );
+  do
+  {
+    count = ( count + NODE_SIZE - 1 ) / NODE_SIZE;
+    total += count;
+    mLevelBounds.emplace_back( total );
+  }
+  while ( count != 1 );
+
+  mIds.resize( leafCount );
+  mMinX.resize( total );
+  mMinY.resize( total );
+  mMaxX.resize( total );
+  mMaxY.resize( total );
+  mFirstChild.resize( total - leafCount );
+
+  for ( std::size_t i = 0; i < leafCount; ++i )
+  {
+    const std::size_t index = order[i];
+    const QgsRectangle &rect = bounds[index];
+    mIds[i] = ids[index];
+    mMinX[i] = rect.xMinimum();
+    mMinY[i] = rect.yMinimum();
+    mMaxX[i] = rect.xMaximum();
+    mMaxY[i] = rect.yMaximum();
+  }
+
+  // generate the nodes of each level from the boxes of the level below
+  std::size_t position = 0;
+  std::size_t nodePosition = leafCount;
+  for ( std::size_t level = 0; level + 1 < mLevelBounds.size(); ++level )
+  {
+    const std::size_t end = mLevelBounds[level];
+    while ( position < end )
+    {
+      const std::size_t first = position;
+      double minX = std::numeric_limits< double >::max();
+      double minY = std::numeric_limits< double >::max();
+      double maxX = std::numeric_limits< double >::lowest();
+      double maxY = std::numeric_limits< double >::lowest();
+      for ( std::size_t i = 0; i < NODE_SIZE && position < end; ++i, ++position )
+      {
+        minX = std::min( minX, mMinX[position] );
+        minY = std::min( minY, mMinY[position] );
+        maxX = std::max( maxX, mMaxX[position] );
+        maxY = std::max( maxY, mMaxY[position] );
+      }
+
+      mMinX[nodePosition] = minX;
+      mMinY[nodePosition] = minY;
+      mMaxX[nodePosition] = maxX;
+      mMaxY[nodePosition] = maxY;
+      mFirstChild[nodePosition - leafCount] = first;
+      ++nodePosition;
+    }
+  }
+}
+
+QList<QgsFeatureId> QgsSpatialIndexPackedRTree::intersects( const QgsRectangle &rectangle ) const
+{
+  QList<QgsFeatureId> result;
+  if ( mIds.empty() )
+    return result;
+
+  const double xMin = rectangle.xMinimum();
+  const double yMin = rectangle.yMinimum();
+  const double xMax = rectangle.xMaximum();
+  const double yMax = rectangle.yMaximum();
+  const std::size_t leafCount = mIds.size();
+
+  const std::size_t root = mMinX.size() - 1;
+  if ( mMinX[root] > xMax || mMaxX[root] < xMin || mMinY[root] > yMax || mMaxY[root] < yMin )
+    return result;
+
+  std::vector< std::size_t > stack;
+  stack.emplace_back( root );
+  while ( !stack.empty() )
+  {
+    const std::size_t position = stack.back();
+    stack.pop_back();
+
+    const std::pair< std::size_t, std::size_t > range = children( position );
+    for ( std::size_t i = range.first; i < range.second; ++i )
+    {
+      if ( mMinX[i] > xMax || mMaxX[i] < xMin || mMinY[i] > yMax || mMaxY[i] < yMin )
+        continue;
+
+      if ( i < leafCount )
+        result << mIds[i];
+      else
+        stack.emplace_back( i );
+    }
+  }
+
+  return result;
+}
+
+QList<QgsFeatureId> QgsSpatialIndexPackedRTree::nearestNeighbors( const QgsRectangle &bounds, int neighbors, double maxDistance,
+    const std::function<double ( QgsFeatureId )> &exactDistance ) const
+{
+  QList<QgsFeatureId> result;
+  if ( mIds.empty() )
+    return result;
+
+  struct Entry
+  {
+    double distance;
+    std::size_t position;
+
+    // entries with the smallest distance have the highest priority, and leaves are visited before nodes at the same distance
+    bool operator<( const Entry &other ) const
+    {
+      return distance > other.distance || ( distance == other.distance && position > other.position );
+    }
+  };
+
+  const std::size_t leafCount = mIds.size();
+  const std::size_t root = mMinX.size() - 1;
+  std::priority_queue< Entry > queue;
+  queue.push( Entry{ boxDistance( root, bounds ), root } );
+
+  int count = 0;
+  double lastDistance = 0;
+  while ( !queue.empty() )
+  {
+    const Entry entry = queue.top();
+
+    // also report the features at the same distance as the last neighbor
+    if ( count >= neighbors && entry.distance > lastDistance )
+      break;
+
+    queue.pop();
+
+    if ( entry.position < leafCount )
+    {
+      result << mIds[ entry.position ];
+      ++count;
+      lastDistance = entry.distance;
+      continue;
+    }
+
+    if ( maxDistance > 0 && entry.distance > maxDistance )
+      continue;
+
+    const std::pair< std::size_t, std::size_t > range = children( entry.position );
+    for ( std::size_t i = range.first; i < range.second; ++i )
+    {
+      double distance = boxDistance( i, bounds );
+      if ( maxDistance > 0 && distance > maxDistance )
+        continue;
+
+      if ( i < leafCount && exactDistance )
+      {
+        distance = exactDistance( mIds[i] );
+        if ( maxDistance > 0 && distance > maxDistance )
+          continue;
+      }
+
+      queue.push( Entry{ distance, i } );
+    }
+  }
+
+  return result;
+}
+
+void QgsSpatialIndexPackedRTree::visitEntries( const std::function<void ( QgsFeatureId, const QgsRectangle & )> &visitor ) const
+{
+  const std::size_t leafCount = mIds.size();
+  for ( std::size_t i = 0; i < leafCount; ++i )
+    visitor( mIds[i], QgsRectangle( mMinX[i], mMinY[i], mMaxX[i], mMaxY[i], false ) );
+}
+
+std::pair<std::size_t, std::size_t> QgsSpatialIndexPackedRTree::children( std::size_t position ) const
+{
+  const std::size_t first = mFirstChild[ position - mIds.size() ];
+  // the children of a node never span over two levels
+  const std::size_t levelEnd = *std::upper_bound( mLevelBounds.begin(), mLevelBounds.end(), first );
+  return std::make_pair( first, std::min( first + NODE_SIZE, levelEnd ) );
+}
+
+double QgsSpatialIndexPackedRTree::boxDistance( std::size_t position, const QgsRectangle &bounds ) const
+{
+  const double dx = std::max( { mMinX[position] - bounds.xMaximum(), bounds.xMinimum() - mMaxX[position], 0.0 } );
+  const double dy = std::max( { mMinY[position] - bounds.yMaximum(), bounds.yMinimum() - mMaxY[position], 0.0 } );
+  return std::sqrt( dx * dx + dy * dy );
+}
+
+///@endcond
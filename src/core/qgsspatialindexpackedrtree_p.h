@@ -0,0 +1,120 @@
+/***************************************************************************
+                             qgsspatialindexpackedrtree_p.h
+                             -----------------
+    begin                : October 2021
+    copyright            : (C) 2021 by Nyall Dawson
+    email                : nyall dot dawson at gmail dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSSPATIALINDEXPACKEDRTREE_PRIVATE_H
+#define QGSSPATIALINDEXPACKEDRTREE_PRIVATE_H
+
+#define SIP_NO_FILE
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include "qgsfeatureid.h"
+#include "qgsrectangle.h"
+
+#include <QList>
+#include <functional>
+#include <vector>
+
+/**
+ * \ingroup core
+ * \brief A static R-tree, bulk loaded from a set of bounding boxes and never modified.
+ *
+ * Entries are sorted along a Hilbert curve and packed into full nodes, level by level.
+ * The bounding boxes of all levels are stored in flat arrays (one for each box coordinate),
+ * with the children of a node stored contiguously, so that the boxes of the children of
+ * a node are tested in a tight loop over adjacent memory.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class QgsSpatialIndexPackedRTree
+{
+  public:
+
+    /**
+     * Constructor for QgsSpatialIndexPackedRTree, containing the features with the specified
+     * \a ids and matching \a bounds.
+     */
+    QgsSpatialIndexPackedRTree( const std::vector< QgsFeatureId > &ids, const std::vector< QgsRectangle > &bounds );
+
+    /**
+     * Returns the number of features stored in the tree.
+     */
+    std::size_t size() const { return mIds.size(); }
+
+    /**
+     * Returns the IDs of the features whose bounding box intersects \a rectangle.
+     */
+    QList<QgsFeatureId> intersects( const QgsRectangle &rectangle ) const;
+
+    /**
+     * Returns the IDs of the features nearest to the \a bounds of a query geometry, sorted by increasing distance.
+     *
+     * At least \a neighbors features are returned if available, more if several features have the same
+     * distance as the last of them. If \a maxDistance is greater than 0, features farther than \a maxDistance
+     * are ignored.
+     *
+     * The distance between a feature and the query is the distance between their bounding boxes, unless
+     * an \a exactDistance function is specified. In that case, it is called with the feature ID to calculate the
+     * exact distance of features whose bounding box is within \a maxDistance.
+     */
+    QList<QgsFeatureId> nearestNeighbors( const QgsRectangle &bounds, int neighbors, double maxDistance,
+                                          const std::function< double( QgsFeatureId ) > &exactDistance ) const;
+
+    /**
+     * Calls \a visitor for each feature stored in the tree, with its ID and bounding box.
+     */
+    void visitEntries( const std::function< void( QgsFeatureId, const QgsRectangle & ) > &visitor ) const;
+
+  private:
+
+    //! Returns the range of positions of the boxes of the children of the node at \a position
+    std::pair< std::size_t, std::size_t > children( std::size_t position ) const;
+
+    double boxDistance( std::size_t position, const QgsRectangle &bounds ) const;
+
+    //! Number of children of each node
+    static constexpr std::size_t NODE_SIZE = 16;
+
+    //! Feature IDs, in leaf order
+    std::vector< QgsFeatureId > mIds;
+
+    // bounding boxes of the leaves followed by the nodes of each level, the root is the last one
+    std::vector< double > mMinX;
+    std::vector< double > mMinY;
+    std::vector< double > mMaxX;
+    std::vector< double > mMaxY;
+
+    //! Position of the first child of each node, indexed by node position minus the number of leaves
+    std::vector< std::size_t > mFirstChild;
+
+    //! End position of the boxes of each level, starting with the leaves
+    std::vector< std::size_t > mLevelBounds;
+};
+
+/// @endcond
+
+#endif // QGSSPATIALINDEXPACKEDRTREE_PRIVATE_H
@@ -17,18 +17,69 @@
 
 #include "qgsnetworkaccessmanager.h"
 #include "qgsapplication.h"
+#include "qgstilestore.h"
 #include <QAbstractNetworkCache>
+#include <QBuffer>
+#include <QDateTime>
 #include <QImage>
 #include <QUrl>
 
-QCache<QUrl, QImage> QgsTileCache::sTileCache( 256 );
+QCache<QUrl, QByteArray> QgsTileCache::sTileCache( 32 * 1024 * 1024 );
 QMutex QgsTileCache::sTileCacheMutex;
 
 
 void QgsTileCache::insertTile( const QUrl &url, const QImage &image )
 {
+  QByteArray data;
+  QBuffer buffer( &data );
+  buffer.open( QIODevice::WriteOnly );
+  if ( !image.save( &buffer, "PNG" ) )
+    return;
+
   QMutexLocker locker( &sTileCacheMutex );
-  sTileCache.insert( url, new QImage( image ) );
+  sTileCache.insert( url, new QByteArray( data ), data.size() );
+}
+
+/**
+ * Reads the directives of a Cache-Control header value. Returns FALSE if the response must not be
+ * persisted (no-store, or no-cache as tiles are never revalidated), otherwise sets the \a expiration
+ * from the max-age directive, if any.
+ */
+static bool cacheControlAllowsStore( const QByteArray &cacheControl, QDateTime &expiration )
+{
+  const QList< QByteArray > directives = cacheControl.split( ',' );
+  for ( const QByteArray &rawDirective : directives )
+  {
+    const QByteArray directive = rawDirective.trimmed().toLower();
+    if ( directive == "no-store" || directive == "no-cache" )
+      return false;
+
+    if ( directive.startsWith( "max-age=" ) )
+    {
+      bool ok = false;
+      const qint64 maxAge = directive.mid( 8 ).toLongLong( &ok );
+      if ( ok && maxAge <= 0 )
+        return false;
+      if ( ok )
+        expiration = QDateTime::currentDateTimeUtc().addSecs( maxAge );
+    }
+  }
+  return true;
+}
+
+void QgsTileCache::insertTileData( const QUrl &url, const QByteArray &data, const QByteArray &cacheControl )
+{
+  {
+    QMutexLocker locker( &sTileCacheMutex );
+    sTileCache.insert( url, new QByteArray( data ), data.size() );
+  }
+
+  QDateTime expiration;
+  if ( !cacheControlAllowsStore( cacheControl, expiration ) )
+    return;
+
+  if ( QgsTileStore *store = QgsTileStore::forUrl( url ) )
+    store->storeTileData( url.toString(), data, expiration );
 }
 
 bool QgsTileCache::tile( const QUrl &url, QImage &image )
@@ -38,32 +89,57 @@ bool QgsTileCache::tile( const QUrl &url, QImage &image )
   QgsNetworkAccessManager::instance()->preprocessRequest( &req );
   QUrl adjUrl = req.url();
 
-  QMutexLocker locker( &sTileCacheMutex );
-  bool success = false;
-  if ( QImage *i = sTileCache.object( adjUrl ) )
+  QByteArray imageData;
+  bool inMemory = false;
   {
-    image = *i;
-    success = true;
-  }
-  else if ( QgsNetworkAccessManager::instance()->cache()->metaData( adjUrl ).isValid() )
-  {
-    if ( QIODevice *data = QgsNetworkAccessManager::instance()->cache()->data( adjUrl ) )
+    QMutexLocker locker( &sTileCacheMutex );
+    if ( QByteArray *data = sTileCache.object( adjUrl ) )
     {
-      QByteArray imageData = data->readAll();
-      delete data;
-
-      image = QImage::fromData( imageData );
-
-      // cache it as well (mutex is already locked)
-      // Check for null because it could be a redirect (see: https://github.com/qgis/QGIS/issues/24336 )
-      if ( ! image.isNull( ) )
-      {
-        sTileCache.insert( adjUrl, new QImage( image ) );
-        success = true;
-      }
+      imageData = *data;
+      inMemory = true;
     }
   }
-  return success;
+
+  if ( inMemory )
+  {
+    // decoding happens outside of the lock, so that threads can decode tiles concurrently
+    image = QImage::fromData( imageData );
+    return !image.isNull();
+  }
+
+  QgsTileStore *store = QgsTileStore::forUrl( adjUrl );
+  bool inStore = store && store->tileData( adjUrl.toString(), imageData );
+  QNetworkCacheMetaData metaData;
+  if ( !inStore )
+  {
+    metaData = QgsNetworkAccessManager::instance()->cache()->metaData( adjUrl );
+    if ( !metaData.isValid() )
+      return false;
+
+    QIODevice *data = QgsNetworkAccessManager::instance()->cache()->data( adjUrl );
+    if ( !data )
+      return false;
+
+    imageData = data->readAll();
+    delete data;
+  }
+
+  image = QImage::fromData( imageData );
+
+  // cache it as well
+  // Check for null because it could be a redirect (see: https://github.com/qgis/QGIS/issues/24336 )
+  if ( image.isNull() )
+    return false;
+
+  {
+    QMutexLocker locker( &sTileCacheMutex );
+    sTileCache.insert( adjUrl, new QByteArray( imageData ), imageData.size() );
+  }
+  // the network cache already applied the Cache-Control header of the download to its metadata
+  if ( store && !inStore && metaData.saveToDisk() )
+    store->storeTileData( adjUrl.toString(), imageData, metaData.expirationDate() );
+
+  return true;
 }
 
 int QgsTileCache::totalCost()
@@ -77,3 +153,14 @@ int QgsTileCache::maxCost()
   QMutexLocker locker( &sTileCacheMutex );
   return sTileCache.maxCost();
 }
+
+void QgsTileCache::clear()
+{
+  {
+    QMutexLocker locker( &sTileCacheMutex );
+    sTileCache.clear();
+  }
+
+  if ( QgsTileStore *store = QgsTileStore::sharedStore() )
+    store->clear();
+}
@@ -27,9 +27,10 @@ class QUrl;
 
 /**
  * A simple tile cache implementation. Tiles are cached according to their URL.
- * There is a small in-memory cache and a secondary caching in the local disk.
- * The in-memory cache is there to save CPU time otherwise wasted to read and
- * uncompress data saved on the disk.
+ * There is an in-memory cache of encoded tile data (as downloaded, e.g. PNG or JPEG),
+ * backed by a persistent QgsTileStore per remote tile source, and finally by the
+ * network disk cache. Tiles are decoded on demand when they are retrieved, so that
+ * the in-memory cache only uses a fraction of the memory decoded images would use.
  *
  * The class is thread safe (its methods can be called from any thread).
  *
@@ -41,23 +42,47 @@ class CORE_EXPORT QgsTileCache
 {
   public:
 
-    //! Add a tile image with given URL to the cache
+    /**
+     * Add a tile image with given URL to the cache.
+     *
+     * The image is encoded as PNG to be stored: prefer insertTileData() when the encoded
+     * data of the tile is available.
+     */
     static void insertTile( const QUrl &url, const QImage &image );
 
+    /**
+     * Adds the encoded \a data of a tile (e.g. a PNG or JPEG image as downloaded) with given URL
+     * to the cache. Tiles of remote sources are also added to the persistent tile store.
+     *
+     * The \a cacheControl value of the Cache-Control header of the tile download is respected by
+     * the persistent store: tiles downloaded with the no-store or no-cache directives are not
+     * persisted, and tiles expire after the duration of the max-age directive.
+     *
+     * \since QGIS 3.22
+     */
+    static void insertTileData( const QUrl &url, const QByteArray &data, const QByteArray &cacheControl = QByteArray() );
+
     /**
      * Try to access a tile and load it into "image" argument
      * \returns TRUE if the tile exists in the cache
      */
     static bool tile( const QUrl &url, QImage &image );
 
-    //! how many tiles are stored in the in-memory cache
+    //! how many bytes of tile data are stored in the in-memory cache
     static int totalCost();
-    //! how many tiles can be stored in the in-memory cache
+    //! how many bytes of tile data can be stored in the in-memory cache
     static int maxCost();
 
+    /**
+     * Removes all tiles from the in-memory cache and from the persistent tile store.
+     *
+     * \since QGIS 3.22
+     */
+    static void clear();
+
   private:
-    //! in-memory cache
-    static QCache<QUrl, QImage> sTileCache;
+    //! in-memory cache of encoded tile data, with costs in bytes
+    static QCache<QUrl, QByteArray> sTileCache;
     //! mutex to protect the in-memory cache
     static QMutex sTileCacheMutex;
 };
@@ -0,0 +1,271 @@
+/***************************************************************************
+  qgstilestore.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstilestore.h"
+
+#include "qgslogger.h"
+#include "qgssettings.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
+#include <QUrl>
+
+#include <memory>
+#include <sqlite3.h>
+
+//! Default maximum age of stored tiles: one week
+static const qint64 DEFAULT_MAXIMUM_AGE = 7 * 24 * 3600;
+
+QgsTileStore::QgsTileStore( const QString &path, qint64 maximumSize )
+  : mPath( path )
+  , mMaximumSize( maximumSize )
+  , mMaximumAge( DEFAULT_MAXIMUM_AGE )
+{
+  int result = mDatabase.open_v2( mPath, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, nullptr );
+  if ( result != SQLITE_OK )
+  {
+    QgsDebugMsg( QStringLiteral( "Can't open tile store database %1: %2" ).arg( mPath, mDatabase.errorMessage() ) );
+    mDatabase.reset();
+    return;
+  }
+
+  const QString sql = QStringLiteral( "PRAGMA journal_mode=WAL;"
+                                      "PRAGMA synchronous=NORMAL;"
+                                      "CREATE TABLE IF NOT EXISTS tiles (key TEXT PRIMARY KEY, data BLOB, size INTEGER, created INTEGER, last_access INTEGER, expires INTEGER);"
+                                      "CREATE INDEX IF NOT EXISTS tiles_last_access ON tiles (last_access);" );
+  QString errorMessage;
+  result = mDatabase.exec( sql, errorMessage );
+  if ( result != SQLITE_OK )
+  {
+    QgsDebugMsg( QStringLiteral( "Failed to initialize tile store database %1: %2" ).arg( mPath, errorMessage ) );
+    mDatabase.reset();
+    return;
+  }
+
+  sqlite3_statement_unique_ptr statement = mDatabase.prepare( QStringLiteral( "SELECT SUM(size) FROM tiles" ), result );
+  if ( result == SQLITE_OK && statement.step() == SQLITE_ROW )
+    mTotalSize = statement.columnAsInt64( 0 );
+}
+
+QgsTileStore *QgsTileStore::sharedStore()
+{
+  // created on first use, thread safe as a function local static
+  static const std::unique_ptr< QgsTileStore > sStore = []() -> std::unique_ptr< QgsTileStore >
+  {
+    const QgsSettings settings;
+    const qint64 maximumSize = settings.value( QStringLiteral( "cache/tileStoreSize" ), 256 * 1024 * 1024 ).toLongLong();
+    if ( maximumSize <= 0 )
+      return nullptr;
+
+    QString cacheDirectory = settings.value( QStringLiteral( "cache/directory" ) ).toString();
+    if ( cacheDirectory.isEmpty() )
+      cacheDirectory = QStandardPaths::writableLocation( QStandardPaths::CacheLocation );
+    const QDir storeDirectory( cacheDirectory + QStringLiteral( "/tiles" ) );
+    if ( !storeDirectory.exists() && !storeDirectory.mkpath( QStringLiteral( "." ) ) )
+    {
+      QgsDebugMsg( QStringLiteral( "Can't create tile store directory: " ) + storeDirectory.path() );
+      return nullptr;
+    }
+
+    std::unique_ptr< QgsTileStore > store = std::make_unique< QgsTileStore >( storeDirectory.filePath( QStringLiteral( "tiles.sqlite" ) ), maximumSize );
+    if ( !store->isValid() )
+      return nullptr;
+    return store;
+  }();
+
+  return sStore.get();
+}
+
+QgsTileStore *QgsTileStore::forUrl( const QUrl &url )
+{
+  if ( url.scheme() != QLatin1String( "http" ) && url.scheme() != QLatin1String( "https" ) )
+    return nullptr;
+
+  return sharedStore();
+}
+
+bool QgsTileStore::isValid() const
+{
+  return static_cast< bool >( mDatabase );
+}
+
+bool QgsTileStore::tileData( const QString &key, QByteArray &data )
+{
+  QMutexLocker locker( &mMutex );
+  if ( !mDatabase )
+    return false;
+
+  const qint64 now = QDateTime::currentSecsSinceEpoch();
+  const QByteArray keyUtf8 = key.toUtf8();
+
+  int result;
+  sqlite3_statement_unique_ptr statement = mDatabase.prepare( QStringLiteral( "SELECT data FROM tiles WHERE key = ? AND created >= ? AND ( expires IS NULL OR expires > ? )" ), result );
+  if ( result != SQLITE_OK )
+    return false;
+  sqlite3_bind_text( statement.get(), 1, keyUtf8.constData(), keyUtf8.size(), SQLITE_TRANSIENT );
+  sqlite3_bind_int64( statement.get(), 2, now - mMaximumAge );
+  sqlite3_bind_int64( statement.get(), 3, now );
+  if ( statement.step() != SQLITE_ROW )
+    return false;
+
+  data = statement.columnAsBlob( 0 );
+  statement.reset();
+
+  sqlite3_statement_unique_ptr updateStatement = mDatabase.prepare( QStringLiteral( "UPDATE tiles SET last_access = ? WHERE key = ?" ), result );
+  if ( result == SQLITE_OK )
+  {
+    sqlite3_bind_int64( updateStatement.get(), 1, now );
+    sqlite3_bind_text( updateStatement.get(), 2, keyUtf8.constData(), keyUtf8.size(), SQLITE_TRANSIENT );
+    updateStatement.step();
+  }
+  return true;
+}
+
+bool QgsTileStore::storeTileData( const QString &key, const QByteArray &data, const QDateTime &expiration )
+{
+  QMutexLocker locker( &mMutex );
+  if ( !mDatabase || data.size() > mMaximumSize )
+    return false;
+
+  const qint64 now = QDateTime::currentSecsSinceEpoch();
+  if ( expiration.isValid() && expiration.toSecsSinceEpoch() <= now )
+    return false;
+
+  const QByteArray keyUtf8 = key.toUtf8();
+
+  int result;
+  qint64 previousSize = 0;
+  sqlite3_statement_unique_ptr sizeStatement = mDatabase.prepare( QStringLiteral( "SELECT size FROM tiles WHERE key = ?" ), result );
+  if ( result != SQLITE_OK )
+    return false;
+  sqlite3_bind_text( sizeStatement.get(), 1, keyUtf8.constData(), keyUtf8.size(), SQLITE_TRANSIENT );
+  if ( sizeStatement.step() == SQLITE_ROW )
+    previousSize = sizeStatement.columnAsInt64( 0 );
+  sizeStatement.reset();
+
+  sqlite3_statement_unique_ptr statement = mDatabase.prepare( QStringLiteral( "INSERT OR REPLACE INTO tiles VALUES (?, ?, ?, ?, ?, ?)" ), result );
+  if ( result != SQLITE_OK )
+    return false;
+  sqlite3_bind_text( statement.get(), 1, keyUtf8.constData(), keyUtf8.size(), SQLITE_TRANSIENT );
+  sqlite3_bind_blob( statement.get(), 2, data.constData(), data.size(), SQLITE_TRANSIENT );
+  sqlite3_bind_int64( statement.get(), 3, data.size() );
+  sqlite3_bind_int64( statement.get(), 4, now );
+  sqlite3_bind_int64( statement.get(), 5, now );
+  if ( expiration.isValid() )
+    sqlite3_bind_int64( statement.get(), 6, expiration.toSecsSinceEpoch() );
+  else
+    sqlite3_bind_null( statement.get(), 6 );
+  if ( statement.step() != SQLITE_DONE )
+  {
+    QgsDebugMsg( QStringLiteral( "Tile failed to be stored: %1 (%2)" ).arg( key, mDatabase.errorMessage() ) );
+    return false;
+  }
+
+  mTotalSize += data.size() - previousSize;
+  if ( mTotalSize > mMaximumSize )
+    evict();
+  return true;
+}
+
+qint64 QgsTileStore::totalSize() const
+{
+  QMutexLocker locker( &mMutex );
+  return mTotalSize;
+}
+
+qint64 QgsTileStore::maximumSize() const
+{
+  QMutexLocker locker( &mMutex );
+  return mMaximumSize;
+}
+
+void QgsTileStore::setMaximumSize( qint64 size )
+{
+  QMutexLocker locker( &mMutex );
+  mMaximumSize = size;
+  if ( mTotalSize > mMaximumSize )
+    evict();
+}
+
+qint64 QgsTileStore::maximumAge() const
+{
+  QMutexLocker locker( &mMutex );
+  return mMaximumAge;
+}
+
+void QgsTileStore::setMaximumAge( qint64 age )
+{
+  QMutexLocker locker( &mMutex );
+  mMaximumAge = age;
+}
+
+void QgsTileStore::clear()
+{
+  QMutexLocker locker( &mMutex );
+  if ( !mDatabase )
+    return;
+
+  QString errorMessage;
+  if ( mDatabase.exec( QStringLiteral( "DELETE FROM tiles" ), errorMessage ) != SQLITE_OK )
+  {
+    QgsDebugMsg( QStringLiteral( "Failed to clear tile store: " ) + errorMessage );
+    return;
+  }
+  mTotalSize = 0;
+}
+
+void QgsTileStore::evict()
+{
+  // evict a bit more than needed, so that eviction doesn't run again on every new tile
+  const qint64 targetSize = mMaximumSize / 10 * 9;
+
+  int result;
+  sqlite3_statement_unique_ptr statement = mDatabase.prepare( QStringLiteral( "SELECT rowid, size FROM tiles ORDER BY last_access, rowid" ), result );
+  if ( result != SQLITE_OK )
+    return;
+
+  // collect the least recently used tiles, until enough space is freed
+  qint64 remainingSize = mTotalSize;
+  QList< qint64 > rowIds;
+  while ( remainingSize > targetSize && statement.step() == SQLITE_ROW )
+  {
+    rowIds << statement.columnAsInt64( 0 );
+    remainingSize -= statement.columnAsInt64( 1 );
+  }
+  statement.reset();
+
+  if ( rowIds.isEmpty() )
+    return;
+
+  QString errorMessage;
+  mDatabase.exec( QStringLiteral( "BEGIN TRANSACTION" ), errorMessage );
+  sqlite3_statement_unique_ptr deleteStatement = mDatabase.prepare( QStringLiteral( "DELETE FROM tiles WHERE rowid = ?" ), result );
+  if ( result == SQLITE_OK )
+  {
+    for ( qint64 rowId : std::as_const( rowIds ) )
+    {
+      sqlite3_bind_int64( deleteStatement.get(), 1, rowId );
+      deleteStatement.step();
+      sqlite3_reset( deleteStatement.get() );
+    }
+  }
+  deleteStatement.reset();
+  mDatabase.exec( QStringLiteral( "COMMIT" ), errorMessage );
+
+  sqlite3_statement_unique_ptr sizeStatement = mDatabase.prepare( QStringLiteral( "SELECT SUM(size) FROM tiles" ), result );
+  if ( result == SQLITE_OK && sizeStatement.step() == SQLITE_ROW )
+    mTotalSize = sizeStatement.columnAsInt64( 0 );
+}
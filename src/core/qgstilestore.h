@@ -0,0 +1,136 @@
+/***************************************************************************
+  qgstilestore.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSTILESTORE_H
+#define QGSTILESTORE_H
+
+#include "qgis_core.h"
+#include "qgssqliteutils.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QMutex>
+#include <QString>
+
+class QUrl;
+
+#define SIP_NO_FILE
+
+/**
+ * A persistent, size-bounded store of encoded tile data (e.g. PNG or JPEG images as downloaded),
+ * kept in a SQLite database.
+ *
+ * When the total size of the stored tiles exceeds the maximum size, the least recently
+ * used tiles get evicted. Tiles older than the maximum age, or past the expiration date
+ * they were stored with, are considered stale and are not returned anymore.
+ *
+ * Tiles of all remote sources are kept in a single store shared through sharedStore(), so that
+ * tiles persist between sessions in the local cache directory within a single size budget.
+ *
+ * The class is thread safe (its methods can be called from any thread).
+ *
+ * \note Not available in Python bindings
+ * \ingroup core
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsTileStore
+{
+  public:
+
+    /**
+     * Opens (or creates) a tile store in the SQLite database at \a path, holding at most
+     * \a maximumSize bytes of tile data.
+     */
+    QgsTileStore( const QString &path, qint64 maximumSize );
+
+    //! QgsTileStore cannot be copied
+    QgsTileStore( const QgsTileStore &other ) = delete;
+    //! QgsTileStore cannot be copied
+    QgsTileStore &operator=( const QgsTileStore &other ) = delete;
+
+    /**
+     * Returns the store shared by all remote tile sources, or NULLPTR if the store is disabled
+     * (when the "cache/tileStoreSize" setting is set to 0) or can't be opened.
+     *
+     * The store is kept in the "tiles" directory of the cache directory. The settings are read
+     * when the store is first used.
+     *
+     * \see forUrl()
+     */
+    static QgsTileStore *sharedStore();
+
+    /**
+     * Returns the shared store if tiles of a \a url are persisted, or NULLPTR otherwise: only tiles
+     * of remote (http and https) sources are.
+     *
+     * \see sharedStore()
+     */
+    static QgsTileStore *forUrl( const QUrl &url );
+
+    //! Returns TRUE if the database of the store was successfully opened
+    bool isValid() const;
+
+    //! Returns the path of the database of the store
+    QString path() const { return mPath; }
+
+    /**
+     * Retrieves the \a data of the tile stored with a \a key, and marks it as recently used.
+     * \returns TRUE if a tile that is not stale was found
+     */
+    bool tileData( const QString &key, QByteArray &data );
+
+    /**
+     * Stores the \a data of a tile with a \a key, replacing any previous data, and evicts
+     * the least recently used tiles if the store exceeds its maximum size.
+     *
+     * If \a expiration is valid, the tile is considered stale after this date, e.g. as
+     * set by the max-age directive of the Cache-Control header of the tile download.
+     *
+     * \returns TRUE on success
+     */
+    bool storeTileData( const QString &key, const QByteArray &data, const QDateTime &expiration = QDateTime() );
+
+    //! Returns the total size of the stored tile data, in bytes
+    qint64 totalSize() const;
+
+    //! Returns the maximum size of the stored tile data, in bytes
+    qint64 maximumSize() const;
+
+    //! Sets the maximum \a size of the stored tile data, in bytes. Tiles are evicted if needed.
+    void setMaximumSize( qint64 size );
+
+    //! Returns the maximum age of stored tiles, in seconds. Older tiles are considered stale.
+    qint64 maximumAge() const;
+
+    //! Sets the maximum \a age of stored tiles, in seconds. Older tiles are considered stale.
+    void setMaximumAge( qint64 age );
+
+    //! Removes all tiles from the store
+    void clear();
+
+  private:
+
+    //! Evicts least recently used tiles until the total size is below the maximum size (mutex must be locked)
+    void evict();
+
+    QString mPath;
+    qint64 mMaximumSize = 0;
+    qint64 mMaximumAge = 0;
+    qint64 mTotalSize = 0;
+    sqlite3_database_unique_ptr mDatabase;
+    mutable QMutex mMutex;
+};
+
+#endif // QGSTILESTORE_H
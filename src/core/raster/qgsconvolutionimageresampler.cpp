@@ -0,0 +1,279 @@
+/***************************************************************************
+  qgsconvolutionimageresampler.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsconvolutionimageresampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define QGS_CONVOLUTION_AVX
+#include <immintrin.h>
+#endif
+
+///@cond PRIVATE
+
+//! Source pixels and weights contributing to each output column or row
+struct QgsConvolutionWeights
+{
+  //! First source pixel of each output pixel
+  std::vector< int > first;
+  //! Number of source pixels of each output pixel
+  std::vector< int > count;
+  //! Weights of the source pixels, stride values for each output pixel
+  std::vector< double > weights;
+  int stride = 0;
+};
+
+//! Keys cubic convolution kernel with a = -0.5, as used by GDAL
+static double cubicKernel( double x )
+{
+  const double absX = std::fabs( x );
+  if ( absX <= 1.0 )
+  {
+    const double x2 = x * x;
+    return x2 * ( 1.5 * absX - 2.5 ) + 1;
+  }
+  else if ( absX <= 2.0 )
+  {
+    const double x2 = x * x;
+    return x2 * ( -0.5 * absX + 2.5 ) - 4 * absX + 2;
+  }
+  return 0.0;
+}
+
+static QgsConvolutionWeights cubicWeights( int sourceSize, int size )
+{
+  static constexpr int KERNEL_RADIUS = 2;
+
+  const double ratio = static_cast< double >( sourceSize ) / size;
+  const double scale = 1.0 / ratio;
+
+  // when reducing, the kernel is stretched over all the source pixels covered by an output pixel
+  const int radius = scale < 1.0 ? static_cast< int >( std::ceil( KERNEL_RADIUS / scale ) ) : KERNEL_RADIUS;
+  const double weightScale = scale < 1.0 ? scale : 1.0;
+
+  QgsConvolutionWeights result;
+  result.stride = 2 * radius + 1;
+  result.first.resize( size );
+  result.count.resize( size );
+  result.weights.assign( static_cast< std::size_t >( size ) * result.stride, 0.0 );
+
+  for ( int i = 0; i < size; ++i )
+  {
+    const double center = ( i + 0.5 ) * ratio;
+    const int first = std::max( 0, static_cast< int >( std::floor( center - radius + 0.5 ) ) );
+    const int last = std::min( sourceSize, static_cast< int >( center + radius + 0.5 ) );
+    const int count = std::min( std::max( 0, last - first ), result.stride );
+
+    double *weights = result.weights.data() + static_cast< std::size_t >( i ) * result.stride;
+    double sum = 0;
+    for ( int k = 0; k < count; ++k )
+    {
+      weights[k] = cubicKernel( weightScale * ( first + k - center + 0.5 ) );
+      sum += weights[k];
+    }
+    // the weights of the pixels cut by the image edges are redistributed over the others
+    if ( sum != 0 )
+    {
+      const double inverseSum = 1 / sum;
+      for ( int k = 0; k < count; ++k )
+        weights[k] *= inverseSum;
+    }
+
+    result.first[i] = first;
+    result.count[i] = count;
+  }
+  return result;
+}
+
+// The passes filter the four channels of a pixel together, whatever their order in memory.
+// The scalar and AVX implementations sum the same products in the same order, so that they
+// give the same results.
+
+static void horizontalPassScalar( const uchar *source, const QgsConvolutionWeights &weights, double *output )
+{
+  const int size = static_cast< int >( weights.first.size() );
+  for ( int i = 0; i < size; ++i )
+  {
+    const double *w = weights.weights.data() + static_cast< std::size_t >( i ) * weights.stride;
+    const uchar *pixel = source + 4 * static_cast< std::size_t >( weights.first[i] );
+    double sum[4] = { 0, 0, 0, 0 };
+    for ( int k = 0; k < weights.count[i]; ++k, pixel += 4 )
+    {
+      for ( int c = 0; c < 4; ++c )
+        sum[c] += pixel[c] * w[k];
+    }
+    std::copy( sum, sum + 4, output + 4 * static_cast< std::size_t >( i ) );
+  }
+}
+
+static void verticalPassScalar( const double *const *rows, const double *weights, int count, std::size_t length, double *output )
+{
+  std::fill( output, output + length, 0.0 );
+  for ( int k = 0; k < count; ++k )
+  {
+    const double *row = rows[k];
+    const double weight = weights[k];
+    for ( std::size_t j = 0; j < length; ++j )
+      output[j] += row[j] * weight;
+  }
+}
+
+#ifdef QGS_CONVOLUTION_AVX
+
+__attribute__( ( target( "avx" ) ) )
+static void horizontalPassAvx( const uchar *source, const QgsConvolutionWeights &weights, double *output )
+{
+  const int size = static_cast< int >( weights.first.size() );
+  for ( int i = 0; i < size; ++i )
+  {
+    const double *w = weights.weights.data() + static_cast< std::size_t >( i ) * weights.stride;
+    const uchar *pixel = source + 4 * static_cast< std::size_t >( weights.first[i] );
+    __m256d sum = _mm256_setzero_pd();
+    for ( int k = 0; k < weights.count[i]; ++k, pixel += 4 )
+    {
+      int bytes;
+      std::memcpy( &bytes, pixel, 4 );
+      const __m256d values = _mm256_cvtepi32_pd( _mm_cvtepu8_epi32( _mm_cvtsi32_si128( bytes ) ) );
+      sum = _mm256_add_pd( sum, _mm256_mul_pd( values, _mm256_set1_pd( w[k] ) ) );
+    }
+    _mm256_storeu_pd( output + 4 * static_cast< std::size_t >( i ), sum );
+  }
+}
+
+__attribute__( ( target( "avx" ) ) )
+static void verticalPassAvx( const double *const *rows, const double *weights, int count, std::size_t length, double *output )
+{
+  // length is always a multiple of 4, one value per channel
+  for ( std::size_t j = 0; j < length; j += 4 )
+    _mm256_storeu_pd( output + j, _mm256_setzero_pd() );
+  for ( int k = 0; k < count; ++k )
+  {
+    const double *row = rows[k];
+    const __m256d weight = _mm256_set1_pd( weights[k] );
+    for ( std::size_t j = 0; j < length; j += 4 )
+      _mm256_storeu_pd( output + j, _mm256_add_pd( _mm256_loadu_pd( output + j ), _mm256_mul_pd( _mm256_loadu_pd( row + j ), weight ) ) );
+  }
+}
+
+#endif
+
+static void storeRow( const double *values, int width, QRgb *output, bool premultiplied )
+{
+  for ( int x = 0; x < width; ++x )
+  {
+    uchar bytes[4];
+    for ( int c = 0; c < 4; ++c )
+    {
+      const double value = values[4 * static_cast< std::size_t >( x ) + c];
+      bytes[c] = value <= 0 ? 0 : ( value >= 255 ? 255 : static_cast< uchar >( value + 0.5 ) );
+    }
+    QRgb pixel;
+    std::memcpy( &pixel, bytes, 4 );
+
+    // the kernel overshoots around sharp edges, which must not produce invalid premultiplied colors
+    if ( premultiplied )
+    {
+      const int alpha = qAlpha( pixel );
+      pixel = qRgba( std::min( qRed( pixel ), alpha ), std::min( qGreen( pixel ), alpha ), std::min( qBlue( pixel ), alpha ), alpha );
+    }
+    output[x] = pixel;
+  }
+}
+
+bool QgsConvolutionImageResampler::isAvailable( Implementation implementation )
+{
+  switch ( implementation )
+  {
+    case Implementation::Automatic:
+    case Implementation::Scalar:
+      return true;
+
+    case Implementation::Avx:
+    {
+#ifdef QGS_CONVOLUTION_AVX
+      static const bool sHasAvx = __builtin_cpu_supports( "avx" );
+      return sHasAvx;
+#else
+      return false;
+#endif
+    }
+  }
+  return false;
+}
+
+QImage QgsConvolutionImageResampler::resampleCubic( const QImage &source, const QSize &size, Implementation implementation )
+{
+  if ( source.isNull() || size.isEmpty() )
+    return QImage();
+
+  if ( implementation == Implementation::Automatic )
+    implementation = isAvailable( Implementation::Avx ) ? Implementation::Avx : Implementation::Scalar;
+  else if ( !isAvailable( implementation ) )
+    return QImage();
+
+  void ( *horizontalPass )( const uchar *, const QgsConvolutionWeights &, double * ) = horizontalPassScalar;
+  void ( *verticalPass )( const double *const *, const double *, int, std::size_t, double * ) = verticalPassScalar;
+#ifdef QGS_CONVOLUTION_AVX
+  if ( implementation == Implementation::Avx )
+  {
+    horizontalPass = horizontalPassAvx;
+    verticalPass = verticalPassAvx;
+  }
+#endif
+
+  QImage image = source;
+  if ( image.format() != QImage::Format_ARGB32_Premultiplied && image.format() != QImage::Format_ARGB32 && image.format() != QImage::Format_RGB32 )
+    image = image.convertToFormat( QImage::Format_ARGB32_Premultiplied );
+  const bool premultiplied = image.format() == QImage::Format_ARGB32_Premultiplied;
+
+  QImage result( size, image.format() );
+  if ( result.isNull() )
+    return QImage();
+
+  const QgsConvolutionWeights columnWeights = cubicWeights( image.width(), size.width() );
+  const QgsConvolutionWeights rowWeights = cubicWeights( image.height(), size.height() );
+
+  // the source rows used by an output row always follow the rows of the previous output row, so the
+  // horizontally filtered rows are kept in a ring buffer large enough for the rows of one output row
+  const std::size_t length = 4 * static_cast< std::size_t >( size.width() );
+  const int ringSize = rowWeights.stride;
+  std::vector< double > ring( static_cast< std::size_t >( ringSize ) * length );
+  std::vector< const double * > rows( ringSize );
+  std::vector< double > values( length );
+  int nextSourceRow = 0;
+
+  for ( int y = 0; y < size.height(); ++y )
+  {
+    const int first = rowWeights.first[y];
+    const int count = rowWeights.count[y];
+    nextSourceRow = std::max( nextSourceRow, first );
+    for ( ; nextSourceRow < first + count; ++nextSourceRow )
+      horizontalPass( image.constScanLine( nextSourceRow ), columnWeights, ring.data() + ( nextSourceRow % ringSize ) * length );
+
+    for ( int k = 0; k < count; ++k )
+      rows[k] = ring.data() + ( ( first + k ) % ringSize ) * length;
+
+    verticalPass( rows.data(), rowWeights.weights.data() + static_cast< std::size_t >( y ) * rowWeights.stride, count, length, values.data() );
+    storeRow( values.data(), size.width(), reinterpret_cast< QRgb * >( result.scanLine( y ) ), premultiplied );
+  }
+
+  return result;
+}
+
+///@endcond
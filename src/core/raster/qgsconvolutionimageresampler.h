@@ -0,0 +1,67 @@
+/***************************************************************************
+  qgsconvolutionimageresampler.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSCONVOLUTIONIMAGERESAMPLER_H
+#define QGSCONVOLUTIONIMAGERESAMPLER_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+
+#include <QImage>
+#include <QSize>
+
+///@cond PRIVATE
+
+/**
+ * \ingroup core
+ * \class QgsConvolutionImageResampler
+ * \brief Resamples 32 bit images with a separable cubic convolution kernel.
+ *
+ * The kernel and its scaling when reducing images follow the cubic resampling of GDAL
+ * RasterIO, with a horizontal pass followed by a vertical pass. The weights of each output
+ * column and row are calculated once per call, and the four channels of a pixel are
+ * filtered together, with AVX instructions when the CPU supports them.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsConvolutionImageResampler
+{
+  public:
+
+    //! Implementation used for the filtering passes
+    enum class Implementation
+    {
+      Automatic, //!< The fastest implementation supported by the CPU
+      Scalar, //!< Portable implementation
+      Avx, //!< AVX implementation, only available on x86 CPUs supporting it
+    };
+
+    /**
+     * Resamples a \a source image to the specified \a size with a cubic kernel.
+     *
+     * Returns a null image if the resampling fails, or if the requested \a implementation
+     * is not available.
+     */
+    static QImage resampleCubic( const QImage &source, const QSize &size, Implementation implementation = Implementation::Automatic );
+
+    //! Returns TRUE if the \a implementation can be used on this CPU
+    static bool isAvailable( Implementation implementation );
+};
+
+///@endcond
+
+#endif // QGSCONVOLUTIONIMAGERESAMPLER_H
@@ -16,7 +16,7 @@
  ***************************************************************************/
 
 #include "qgscubicrasterresampler.h"
-#include "qgsgdalutils.h"
+#include "qgsconvolutionimageresampler.h"
 #include <QImage>
 #include <cmath>
 
@@ -27,13 +27,13 @@ QgsCubicRasterResampler *QgsCubicRasterResampler::clone() const
 
 QImage QgsCubicRasterResampler::resampleV2( const QImage &source, const QSize &size )
 {
-  return QgsGdalUtils::resampleImage( source, size, GRIORA_Cubic );
+  return QgsConvolutionImageResampler::resampleCubic( source, size );
 }
 
 Q_NOWARN_DEPRECATED_PUSH
 void QgsCubicRasterResampler::resample( const QImage &srcImage, QImage &dstImage )
 {
-  dstImage = QgsGdalUtils::resampleImage( srcImage, dstImage.size(), GRIORA_Cubic );
+  dstImage = QgsConvolutionImageResampler::resampleCubic( srcImage, dstImage.size() );
 }
 Q_NOWARN_DEPRECATED_POP
 
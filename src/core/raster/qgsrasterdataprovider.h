@@ -104,6 +104,7 @@ class CORE_EXPORT QgsRasterDataProvider : public QgsDataProvider, public QgsRast
       ProviderHintCanPerformProviderResampling = 1 << 4, //!< Provider can perform resampling (to be opposed to post rendering resampling) (since QGIS 3.16)
       ReloadData = 1 << 5, //!< Is able to force reload data / clear local caches. Since QGIS 3.18, see QgsDataProvider::reloadProviderData()
       DpiDependentData = 1 << 6, //! Provider's rendering is dependent on requested pixel size of the viewport (since QGIS 3.20)
+      ProviderHintCanReadInParallel = 1 << 7, //!< Provider reads local data, and clones of the provider can read blocks concurrently from several threads. See QgsRasterDrawer::drawParallel() (since QGIS 3.22)
     };
 
     //! Provider capabilities
@@ -17,18 +17,40 @@
 
 #include "qgslogger.h"
 #include "qgsrasterblock.h"
+#include "qgsrasterdataprovider.h"
 #include "qgsrasterdrawer.h"
 #include "qgsrasterinterface.h"
 #include "qgsrasteriterator.h"
+#include "qgsrasterpipe.h"
 #include "qgsrasterviewport.h"
 #include "qgsmaptopixel.h"
 #include "qgsrendercontext.h"
 #include <QImage>
 #include <QPainter>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
 #ifndef QT_NO_PRINTER
 #include <QPrinter>
 #endif
 
+#include <memory>
+
+//! Minimum number of rows of a stripe drawn by QgsRasterDrawer::drawParallel()
+static constexpr qgssize MINIMUM_STRIPE_ROWS = 256;
+
+///@cond PRIVATE
+
+//! Image of a raster part, read by a worker thread
+struct QgsRasterDrawerPart
+{
+  QImage image;
+  int topLeftCol = 0;
+  int topLeftRow = 0;
+};
+
+///@endcond
+
 QgsRasterDrawer::QgsRasterDrawer( QgsRasterIterator *iterator, double dpiTarget )
   : mIterator( iterator )
   , mDpiTarget( dpiTarget )
@@ -68,52 +90,188 @@ void QgsRasterDrawer::draw( QPainter *p, QgsRasterViewPort *viewPort, const QgsM
       continue;
     }
 
-    QImage img = block->image();
+    drawPart( p, viewPort, block->image(), topLeftCol, topLeftRow, qgsMapToPixel, feedback );
 
-#ifndef QT_NO_PRINTER
-    // Because of bug in Acrobat Reader we must use "white" transparent color instead
-    // of "black" for PDF. See #9101.
-    QPrinter *printer = dynamic_cast<QPrinter *>( p->device() );
-    if ( printer && printer->outputFormat() == QPrinter::PdfFormat )
+    // OK this does not matter much anyway as the tile size quite big so most of the time
+    // there would be just one tile for the whole display area, but it won't hurt...
+    if ( feedback && feedback->isCanceled() )
+      break;
+  }
+}
+
+static QList< QgsRasterDrawerPart > readStripe( const std::shared_ptr< QgsRasterPipe > &pipe, const std::shared_ptr< QgsRasterBlockFeedback > &feedback,
+    int maximumTileWidth, int maximumTileHeight, qgssize nCols, qgssize nRows, const QgsRectangle &extent, int topRow )
+{
+  QList< QgsRasterDrawerPart > parts;
+
+  QgsRasterIterator iterator( pipe->last() );
+  iterator.setMaximumTileWidth( maximumTileWidth );
+  iterator.setMaximumTileHeight( maximumTileHeight );
+
+  // last pipe filter has only 1 band
+  const int bandNumber = 1;
+  iterator.startRasterRead( bandNumber, nCols, nRows, extent, feedback.get() );
+
+  int partCols = 0;
+  int partRows = 0;
+  int topLeftCol = 0;
+  int topLeftRow = 0;
+  std::unique_ptr< QgsRasterBlock > block;
+  while ( iterator.readNextRasterPart( bandNumber, partCols, partRows, block, topLeftCol, topLeftRow ) )
+  {
+    if ( !block )
     {
-      QgsDebugMsgLevel( QStringLiteral( "PdfFormat" ), 4 );
+      QgsDebugMsg( QStringLiteral( "Cannot get block" ) );
+      continue;
+    }
 
-      img = img.convertToFormat( QImage::Format_ARGB32 );
-      QRgb transparentBlack = qRgba( 0, 0, 0, 0 );
-      QRgb transparentWhite = qRgba( 255, 255, 255, 0 );
-      for ( int x = 0; x < img.width(); x++ )
-      {
-        for ( int y = 0; y < img.height(); y++ )
-        {
-          if ( img.pixel( x, y ) == transparentBlack )
-          {
-            img.setPixel( x, y, transparentWhite );
-          }
-        }
-      }
+    QgsRasterDrawerPart part;
+    part.image = block->image();
+    part.topLeftCol = topLeftCol;
+    part.topLeftRow = topRow + topLeftRow;
+    parts << part;
+
+    if ( feedback->isCanceled() )
+      break;
+  }
+  return parts;
+}
+
+void QgsRasterDrawer::drawParallel( QPainter *p, QgsRasterViewPort *viewPort, const QgsMapToPixel *qgsMapToPixel, const QgsRasterPipe *pipe, QgsRasterBlockFeedback *feedback, int stripes )
+{
+  if ( !p || !mIterator || !viewPort || !qgsMapToPixel )
+  {
+    return;
+  }
+
+  // remote providers are drawn at once, which keeps their progressive preview and avoids multiplying the requests
+  if ( !pipe || !pipe->provider() || !( pipe->provider()->providerCapabilities() & QgsRasterDataProvider::ProviderHintCanReadInParallel ) )
+  {
+    draw( p, viewPort, qgsMapToPixel, feedback );
+    return;
+  }
+
+  qgssize stripeCount = 0;
+  if ( stripes > 0 )
+  {
+    stripeCount = std::min( static_cast< qgssize >( stripes ), viewPort->mHeight );
+  }
+  else
+  {
+    const qgssize threadCount = static_cast< qgssize >( std::max( 1, QThread::idealThreadCount() ) );
+    stripeCount = std::min( threadCount, viewPort->mHeight / MINIMUM_STRIPE_ROWS );
+  }
+  if ( stripeCount < 2 )
+  {
+    draw( p, viewPort, qgsMapToPixel, feedback );
+    return;
+  }
+
+  const qgssize rowsPerStripe = ( viewPort->mHeight + stripeCount - 1 ) / stripeCount;
+  const QgsRectangle extent = viewPort->mDrawnExtent;
+
+  QList< std::shared_ptr< QgsRasterBlockFeedback > > stripeFeedbacks;
+  QList< QFuture< QList< QgsRasterDrawerPart > > > stripeFutures;
+
+  // declared after the data used by the stripes, so that all stripes are finished before it gets destroyed
+  QThreadPool pool;
+  pool.setMaxThreadCount( static_cast< int >( stripeCount ) );
+
+  for ( qgssize topRow = 0; topRow < viewPort->mHeight; topRow += rowsPerStripe )
+  {
+    const qgssize nRows = std::min( rowsPerStripe, viewPort->mHeight - topRow );
+
+    // same subdivision of the extent as QgsRasterIterator, so that the stripes are seamless
+    const double ymin = topRow + nRows == viewPort->mHeight ? extent.yMinimum() :
+                        extent.yMaximum() - ( topRow + nRows ) / static_cast< double >( viewPort->mHeight ) * extent.height();
+    const double ymax = extent.yMaximum() - topRow / static_cast< double >( viewPort->mHeight ) * extent.height();
+    const QgsRectangle stripeExtent( extent.xMinimum(), ymin, extent.xMaximum(), ymax );
+
+    // interfaces (and the data provider) are cloned here, as they can't be used from several threads
+    std::shared_ptr< QgsRasterPipe > stripePipe = std::make_shared< QgsRasterPipe >( *pipe );
+
+    std::shared_ptr< QgsRasterBlockFeedback > stripeFeedback = std::make_shared< QgsRasterBlockFeedback >();
+    if ( feedback )
+    {
+      stripeFeedback->setPreviewOnly( feedback->isPreviewOnly() );
+      if ( feedback->isCanceled() )
+        stripeFeedback->cancel();
+      QObject::connect( feedback, &QgsFeedback::canceled, stripeFeedback.get(), &QgsFeedback::cancel, Qt::DirectConnection );
     }
-#endif
+    stripeFeedbacks << stripeFeedback;
 
-    if ( feedback && feedback->renderPartialOutput() )
+    const int maximumTileWidth = mIterator->maximumTileWidth();
+    const int maximumTileHeight = mIterator->maximumTileHeight();
+    const qgssize nCols = viewPort->mWidth;
+    const int stripeTopRow = static_cast< int >( topRow );
+    stripeFutures << QtConcurrent::run( &pool, [stripePipe, stripeFeedback, maximumTileWidth, maximumTileHeight, nCols, nRows, stripeExtent, stripeTopRow]
     {
-      // there could have been partial preview written before
-      // so overwrite anything with the resulting image.
-      // (we are guaranteed to have a temporary image for this layer, see QgsMapRendererJob::needTemporaryImage)
-      p->setCompositionMode( QPainter::CompositionMode_Source );
+      return readStripe( stripePipe, stripeFeedback, maximumTileWidth, maximumTileHeight, nCols, nRows, stripeExtent, stripeTopRow );
+    } );
+  }
+
+  // stripes are drawn in order as they get ready, all painting happens in this thread
+  for ( int i = 0; i < stripeFutures.size(); ++i )
+  {
+    const QList< QgsRasterDrawerPart > parts = stripeFutures.at( i ).result();
+
+    if ( feedback )
+    {
+      const QStringList errors = stripeFeedbacks.at( i )->errors();
+      for ( const QString &error : errors )
+        feedback->appendError( error );
+
+      if ( feedback->isCanceled() )
+        break;
     }
 
-    drawImage( p, viewPort, img, topLeftCol, topLeftRow, qgsMapToPixel );
+    for ( const QgsRasterDrawerPart &part : parts )
+    {
+      drawPart( p, viewPort, part.image, part.topLeftCol, part.topLeftRow, qgsMapToPixel, feedback );
+    }
+  }
+}
+
+void QgsRasterDrawer::drawPart( QPainter *p, QgsRasterViewPort *viewPort, QImage img, int topLeftCol, int topLeftRow, const QgsMapToPixel *qgsMapToPixel, QgsRasterBlockFeedback *feedback ) const
+{
+#ifndef QT_NO_PRINTER
+  // Because of bug in Acrobat Reader we must use "white" transparent color instead
+  // of "black" for PDF. See #9101.
+  QPrinter *printer = dynamic_cast<QPrinter *>( p->device() );
+  if ( printer && printer->outputFormat() == QPrinter::PdfFormat )
+  {
+    QgsDebugMsgLevel( QStringLiteral( "PdfFormat" ), 4 );
 
-    if ( feedback && feedback->renderPartialOutput() )
+    img = img.convertToFormat( QImage::Format_ARGB32 );
+    QRgb transparentBlack = qRgba( 0, 0, 0, 0 );
+    QRgb transparentWhite = qRgba( 255, 255, 255, 0 );
+    for ( int x = 0; x < img.width(); x++ )
     {
-      // go back to the default composition mode
-      p->setCompositionMode( QPainter::CompositionMode_SourceOver );
+      for ( int y = 0; y < img.height(); y++ )
+      {
+        if ( img.pixel( x, y ) == transparentBlack )
+        {
+          img.setPixel( x, y, transparentWhite );
+        }
+      }
     }
+  }
+#endif
 
-    // OK this does not matter much anyway as the tile size quite big so most of the time
-    // there would be just one tile for the whole display area, but it won't hurt...
-    if ( feedback && feedback->isCanceled() )
-      break;
+  if ( feedback && feedback->renderPartialOutput() )
+  {
+    // there could have been partial preview written before
+    // so overwrite anything with the resulting image.
+    // (we are guaranteed to have a temporary image for this layer, see QgsMapRendererJob::needTemporaryImage)
+    p->setCompositionMode( QPainter::CompositionMode_Source );
+  }
+
+  drawImage( p, viewPort, img, topLeftCol, topLeftRow, qgsMapToPixel );
+
+  if ( feedback && feedback->renderPartialOutput() )
+  {
+    // go back to the default composition mode
+    p->setCompositionMode( QPainter::CompositionMode_SourceOver );
   }
 }
 
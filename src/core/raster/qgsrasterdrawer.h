@@ -29,6 +29,7 @@ class QgsRenderContext;
 struct QgsRasterViewPort;
 class QgsRasterBlockFeedback;
 class QgsRasterIterator;
+class QgsRasterPipe;
 
 /**
  * \ingroup core
@@ -54,6 +55,29 @@ class CORE_EXPORT QgsRasterDrawer
      */
     void draw( QPainter *p, QgsRasterViewPort *viewPort, const QgsMapToPixel *qgsMapToPixel, QgsRasterBlockFeedback *feedback = nullptr );
 
+    /**
+     * Draws raster data from a \a pipe, rendering horizontal stripes of the viewport concurrently.
+     *
+     * Every stripe is read from its own copy of the \a pipe (including a clone of the data provider),
+     * so that no interface of the pipe is ever used by more than one thread. The stripe images
+     * are drawn in order onto the painter from the calling thread, which gives the same result as draw().
+     *
+     * The \a pipe must be the one the drawer's iterator reads from. Stripes are only used for data providers
+     * with the QgsRasterDataProvider::ProviderHintCanReadInParallel capability, and when the viewport is large
+     * enough to be split in stripes. Otherwise this falls back to draw(), which renders the preview
+     * of the \a feedback. No preview is rendered while the stripes are read.
+     *
+     * \param p destination QPainter
+     * \param viewPort viewport to render
+     * \param qgsMapToPixel map to pixel converter
+     * \param pipe raster pipe to copy for each stripe
+     * \param feedback optional raster feedback object for cancellation
+     * \param stripes number of stripes, or -1 to use one stripe per available thread for large enough viewports
+     *
+     * \since QGIS 3.22
+     */
+    void drawParallel( QPainter *p, QgsRasterViewPort *viewPort, const QgsMapToPixel *qgsMapToPixel, const QgsRasterPipe *pipe, QgsRasterBlockFeedback *feedback = nullptr, int stripes = -1 );
+
   protected:
 
     /**
@@ -69,6 +93,10 @@ class CORE_EXPORT QgsRasterDrawer
     void drawImage( QPainter *p, QgsRasterViewPort *viewPort, const QImage &img, int topLeftCol, int topLeftRow, const QgsMapToPixel *mapToPixel = nullptr ) const SIP_SKIP;
 
   private:
+
+    //! Draws the image of a raster part, taking care of the output device quirks
+    void drawPart( QPainter *p, QgsRasterViewPort *viewPort, QImage img, int topLeftCol, int topLeftRow, const QgsMapToPixel *qgsMapToPixel, QgsRasterBlockFeedback *feedback ) const;
+
     QgsRasterIterator *mIterator = nullptr;
     double mDpiTarget = -1.0;
 };
@@ -26,6 +26,8 @@
 #include "qgsrasterbandstats.h"
 #include "qgsrasterhistogram.h"
 #include "qgsrasterinterface.h"
+#include "qgsrasterstatisticscalculator.h"
+#include "qgsrasterstatisticsstore.h"
 #include "qgsrectangle.h"
 
 QgsRasterInterface::QgsRasterInterface( QgsRasterInterface *input )
@@ -135,103 +137,16 @@ QgsRasterBandStats QgsRasterInterface::bandStatistics( int bandNo,
     }
   }
 
-  QgsRectangle myExtent = myRasterBandStats.extent;
-  int myWidth = myRasterBandStats.width;
-  int myHeight = myRasterBandStats.height;
-
-  //int myDataType = dataType( bandNo );
-
-  int myXBlockSize = xBlockSize();
-  int myYBlockSize = yBlockSize();
-  if ( myXBlockSize == 0 ) // should not happen, but happens
-  {
-    myXBlockSize = 500;
-  }
-  if ( myYBlockSize == 0 ) // should not happen, but happens
+  std::unique_ptr< QgsRasterStatisticsStore > store = QgsRasterStatisticsStore::forInterface( this );
+  if ( store && store->statistics( myRasterBandStats ) )
   {
-    myYBlockSize = 500;
+    QgsDebugMsgLevel( QStringLiteral( "Using stored statistics." ), 4 );
+    mStatistics.append( myRasterBandStats );
+    return myRasterBandStats;
   }
 
-  int myNXBlocks = ( myWidth + myXBlockSize - 1 ) / myXBlockSize;
-  int myNYBlocks = ( myHeight + myYBlockSize - 1 ) / myYBlockSize;
-
-  double myXRes = myExtent.width() / myWidth;
-  double myYRes = myExtent.height() / myHeight;
-  // TODO: progress signals
-
-  // used by single pass stdev
-  double myMean = 0;
-  double mySumOfSquares = 0;
-
-  bool myFirstIterationFlag = true;
-  bool isNoData = false;
-  for ( int myYBlock = 0; myYBlock < myNYBlocks; myYBlock++ )
-  {
-    for ( int myXBlock = 0; myXBlock < myNXBlocks; myXBlock++ )
-    {
-      if ( feedback && feedback->isCanceled() )
-        return myRasterBandStats;
-
-      QgsDebugMsgLevel( QStringLiteral( "myYBlock = %1 myXBlock = %2" ).arg( myYBlock ).arg( myXBlock ), 4 );
-      int myBlockWidth = std::min( myXBlockSize, myWidth - myXBlock * myXBlockSize );
-      int myBlockHeight = std::min( myYBlockSize, myHeight - myYBlock * myYBlockSize );
-
-      double xmin = myExtent.xMinimum() + myXBlock * myXBlockSize * myXRes;
-      double xmax = xmin + myBlockWidth * myXRes;
-      double ymin = myExtent.yMaximum() - myYBlock * myYBlockSize * myYRes;
-      double ymax = ymin - myBlockHeight * myYRes;
-
-      QgsRectangle myPartExtent( xmin, ymin, xmax, ymax );
-
-      std::unique_ptr< QgsRasterBlock > blk( block( bandNo, myPartExtent, myBlockWidth, myBlockHeight, feedback ) );
-
-      // Collect the histogram counts.
-      for ( qgssize i = 0; i < ( static_cast< qgssize >( myBlockHeight ) ) * myBlockWidth; i++ )
-      {
-        double myValue = blk->valueAndNoData( i, isNoData );
-        if ( isNoData )
-          continue; // NULL
-
-        myRasterBandStats.sum += myValue;
-        myRasterBandStats.elementCount++;
-
-        if ( !std::isfinite( myValue ) ) continue; // inf
-
-        if ( myFirstIterationFlag )
-        {
-          myFirstIterationFlag = false;
-          myRasterBandStats.minimumValue = myValue;
-          myRasterBandStats.maximumValue = myValue;
-        }
-        else
-        {
-          if ( myValue < myRasterBandStats.minimumValue )
-          {
-            myRasterBandStats.minimumValue = myValue;
-          }
-          if ( myValue > myRasterBandStats.maximumValue )
-          {
-            myRasterBandStats.maximumValue = myValue;
-          }
-        }
-
-        // Single pass stdev
-        double myDelta = myValue - myMean;
-        myMean += myDelta / myRasterBandStats.elementCount;
-        mySumOfSquares += myDelta * ( myValue - myMean );
-      }
-    }
-  }
-
-  myRasterBandStats.range = myRasterBandStats.maximumValue - myRasterBandStats.minimumValue;
-  myRasterBandStats.mean = myRasterBandStats.sum / myRasterBandStats.elementCount;
-
-  myRasterBandStats.sumOfSquares = mySumOfSquares; // OK with single pass?
-
-  // stdDev may differ  from GDAL stats, because GDAL is using naive single pass
-  // algorithm which is more error prone (because of rounding errors)
-  // Divide result by sample size - 1 and get square root to get stdev
-  myRasterBandStats.stdDev = std::sqrt( mySumOfSquares / ( myRasterBandStats.elementCount - 1 ) );
+  if ( !QgsRasterStatisticsCalculator::calculate( this, &myRasterBandStats, nullptr, xBlockSize(), yBlockSize(), feedback ) )
+    return myRasterBandStats;
 
   QgsDebugMsgLevel( QStringLiteral( "************ STATS **************" ), 4 );
   QgsDebugMsgLevel( QStringLiteral( "MIN %1" ).arg( myRasterBandStats.minimumValue ), 4 );
@@ -240,8 +155,9 @@ QgsRasterBandStats QgsRasterInterface::bandStatistics( int bandNo,
   QgsDebugMsgLevel( QStringLiteral( "MEAN %1" ).arg( myRasterBandStats.mean ), 4 );
   QgsDebugMsgLevel( QStringLiteral( "STDDEV %1" ).arg( myRasterBandStats.stdDev ), 4 );
 
-  myRasterBandStats.statsGathered = QgsRasterBandStats::All;
   mStatistics.append( myRasterBandStats );
+  if ( store )
+    store->storeStatistics( myRasterBandStats );
 
   return myRasterBandStats;
 }
@@ -424,89 +340,39 @@ QgsRasterHistogram QgsRasterInterface::histogram( int bandNo,
     }
   }
 
-  int myBinCount = myHistogram.binCount;
-  int myWidth = myHistogram.width;
-  int myHeight = myHistogram.height;
-  QgsRectangle myExtent = myHistogram.extent;
-  myHistogram.histogramVector.resize( myBinCount );
-
-  int myXBlockSize = xBlockSize();
-  int myYBlockSize = yBlockSize();
-  if ( myXBlockSize == 0 ) // should not happen, but happens
-  {
-    myXBlockSize = 500;
-  }
-  if ( myYBlockSize == 0 ) // should not happen, but happens
+  std::unique_ptr< QgsRasterStatisticsStore > store = QgsRasterStatisticsStore::forInterface( this );
+  if ( store && store->histogram( myHistogram ) )
   {
-    myYBlockSize = 500;
+    QgsDebugMsgLevel( QStringLiteral( "Using stored histogram." ), 4 );
+    mHistograms.append( myHistogram );
+    return myHistogram;
   }
 
-  int myNXBlocks = ( myWidth + myXBlockSize - 1 ) / myXBlockSize;
-  int myNYBlocks = ( myHeight + myYBlockSize - 1 ) / myYBlockSize;
-
-  double myXRes = myExtent.width() / myWidth;
-  double myYRes = myExtent.height() / myHeight;
-
-  double myMinimum = myHistogram.minimum;
-  double myMaximum = myHistogram.maximum;
-
-  // To avoid rounding errors
-  // TODO: check this
-  double myerval = ( myMaximum - myMinimum ) / myHistogram.binCount;
-  myMinimum -= 0.1 * myerval;
-  myMaximum += 0.1 * myerval;
-
-  QgsDebugMsgLevel( QStringLiteral( "binCount = %1 myMinimum = %2 myMaximum = %3" ).arg( myHistogram.binCount ).arg( myMinimum ).arg( myMaximum ), 4 );
-
-  double myBinSize = ( myMaximum - myMinimum ) / myBinCount;
-
-  // TODO: progress signals
-  bool isNoData = false;
-  for ( int myYBlock = 0; myYBlock < myNYBlocks; myYBlock++ )
+  // statistics of the same pixels are collected in the same pass if they are not known yet,
+  // they are usually requested together with the histogram
+  QgsRasterBandStats myRasterBandStats;
+  initStatistics( myRasterBandStats, bandNo, QgsRasterBandStats::All, extent, sampleSize );
+  bool calculateStatistics = myRasterBandStats.extent == myHistogram.extent
+                             && myRasterBandStats.width == myHistogram.width
+                             && myRasterBandStats.height == myHistogram.height;
+  const auto constStatistics = mStatistics;
+  for ( const QgsRasterBandStats &stats : constStatistics )
   {
-    for ( int myXBlock = 0; myXBlock < myNXBlocks; myXBlock++ )
+    if ( stats.contains( myRasterBandStats ) )
     {
-      if ( feedback && feedback->isCanceled() )
-        return myHistogram;
-
-      int myBlockWidth = std::min( myXBlockSize, myWidth - myXBlock * myXBlockSize );
-      int myBlockHeight = std::min( myYBlockSize, myHeight - myYBlock * myYBlockSize );
-
-      double xmin = myExtent.xMinimum() + myXBlock * myXBlockSize * myXRes;
-      double xmax = xmin + myBlockWidth * myXRes;
-      double ymin = myExtent.yMaximum() - myYBlock * myYBlockSize * myYRes;
-      double ymax = ymin - myBlockHeight * myYRes;
-
-      QgsRectangle myPartExtent( xmin, ymin, xmax, ymax );
-
-      std::unique_ptr< QgsRasterBlock > blk( block( bandNo, myPartExtent, myBlockWidth, myBlockHeight, feedback ) );
-
-      // Collect the histogram counts.
-      for ( qgssize i = 0; i < ( static_cast< qgssize >( myBlockHeight ) ) * myBlockWidth; i++ )
-      {
-        double myValue = blk->valueAndNoData( i, isNoData );
-        if ( isNoData )
-        {
-          continue; // NULL
-        }
-
-        int myBinIndex = static_cast <int>( std::floor( ( myValue - myMinimum ) /  myBinSize ) );
-
-        if ( ( myBinIndex < 0 || myBinIndex > ( myBinCount - 1 ) ) && !includeOutOfRange )
-        {
-          continue;
-        }
-        if ( myBinIndex < 0 ) myBinIndex = 0;
-        if ( myBinIndex > ( myBinCount - 1 ) ) myBinIndex = myBinCount - 1;
-
-        myHistogram.histogramVector[myBinIndex] += 1;
-        myHistogram.nonNullCount++;
-      }
+      calculateStatistics = false;
+      break;
     }
   }
 
-  myHistogram.valid = true;
+  if ( !QgsRasterStatisticsCalculator::calculate( this, calculateStatistics ? &myRasterBandStats : nullptr, &myHistogram, xBlockSize(), yBlockSize(), feedback ) )
+    return myHistogram;
+
   mHistograms.append( myHistogram );
+  if ( calculateStatistics )
+    mStatistics.append( myRasterBandStats );
+  if ( store )
+    store->storeHistogram( myHistogram );
 
 #ifdef QGISDEBUG
   QString hist;
@@ -338,9 +338,10 @@ bool QgsRasterLayerRenderer::render()
   }
 
   // Drawer to pipe?
+  // stripes of the viewport of local data are read concurrently, each from its own copy of the pipe
   QgsRasterIterator iterator( mPipe->last() );
   QgsRasterDrawer drawer( &iterator, renderContext()->dpiTarget() );
-  drawer.draw( renderContext()->painter(), mRasterViewPort, &renderContext()->mapToPixel(), mFeedback );
+  drawer.drawParallel( renderContext()->painter(), mRasterViewPort, &renderContext()->mapToPixel(), mPipe, mFeedback );
 
   if ( restoreOldResamplingStage )
   {
@@ -22,6 +22,10 @@
 #include "qgscoordinatetransform.h"
 #include "qgsexception.h"
 
+#include <QCache>
+#include <QMutex>
+#include <memory>
+
 Q_NOWARN_DEPRECATED_PUSH // because of deprecated members
 QgsRasterProjector::QgsRasterProjector()
   : QgsRasterInterface( nullptr )
@@ -76,6 +80,7 @@ void QgsRasterProjector::setCrs( const QgsCoordinateReferenceSystem &srcCRS,
   mSrcDatumTransform = srcDatumTransform;
   mDestDatumTransform = destDatumTransform;
   Q_NOWARN_DEPRECATED_POP
+  mTransformKey.clear();
 }
 
 void QgsRasterProjector::setCrs( const QgsCoordinateReferenceSystem &srcCRS, const QgsCoordinateReferenceSystem &destCRS, QgsCoordinateTransformContext transformContext )
@@ -87,6 +92,7 @@ void QgsRasterProjector::setCrs( const QgsCoordinateReferenceSystem &srcCRS, con
   mSrcDatumTransform = -1;
   mDestDatumTransform = -1;
   Q_NOWARN_DEPRECATED_POP
+  mTransformKey.clear();
 }
 
 
@@ -114,28 +120,7 @@ ProjectorData::ProjectorData( const QgsRectangle &extent, int width, int height,
   QgsDebugMsgLevel( QStringLiteral( "Entered" ), 4 );
 
   // Get max source resolution and extent if possible
-  if ( input )
-  {
-    QgsRasterDataProvider *provider = dynamic_cast<QgsRasterDataProvider *>( input->sourceInput() );
-    if ( provider )
-    {
-      // If provider-side resampling is possible, we will get a much better looking
-      // result by not requesting at the maximum resolution and then doing nearest
-      // resampling here. A real fix would be to do resampling during reprojection
-      // however.
-      if ( !( provider->providerCapabilities() & QgsRasterDataProvider::ProviderHintCanPerformProviderResampling ) &&
-           ( provider->capabilities() & QgsRasterDataProvider::Size ) )
-      {
-        mMaxSrcXRes = provider->extent().width() / provider->xSize();
-        mMaxSrcYRes = provider->extent().height() / provider->ySize();
-      }
-      // Get source extent
-      if ( mExtent.isEmpty() )
-      {
-        mExtent = provider->extent();
-      }
-    }
-  }
+  sourceProperties( input, mExtent, mMaxSrcXRes, mMaxSrcYRes );
 
   mDestXRes = mDestExtent.width() / ( mDestCols );
   mDestYRes = mDestExtent.height() / ( mDestRows );
@@ -238,6 +223,32 @@ ProjectorData::~ProjectorData()
   delete[] pHelperBottom;
 }
 
+void ProjectorData::sourceProperties( QgsRasterInterface *input, QgsRectangle &extent, double &maxSrcXRes, double &maxSrcYRes )
+{
+  if ( !input )
+    return;
+
+  QgsRasterDataProvider *provider = dynamic_cast<QgsRasterDataProvider *>( input->sourceInput() );
+  if ( provider )
+  {
+    // If provider-side resampling is possible, we will get a much better looking
+    // result by not requesting at the maximum resolution and then doing nearest
+    // resampling here. A real fix would be to do resampling during reprojection
+    // however.
+    if ( !( provider->providerCapabilities() & QgsRasterDataProvider::ProviderHintCanPerformProviderResampling ) &&
+         ( provider->capabilities() & QgsRasterDataProvider::Size ) )
+    {
+      maxSrcXRes = provider->extent().width() / provider->xSize();
+      maxSrcYRes = provider->extent().height() / provider->ySize();
+    }
+    // Get source extent
+    if ( extent.isEmpty() )
+    {
+      extent = provider->extent();
+    }
+  }
+}
+
 
 void ProjectorData::calcSrcExtent()
 {
@@ -579,6 +590,61 @@ bool ProjectorData::approximateSrcRowCol( int destRow, int destCol, int *srcRow,
   return true;
 }
 
+void ProjectorData::srcIndexes( int destRow, qint64 *indexes )
+{
+  if ( !mApproximate )
+  {
+    int srcRow, srcCol;
+    for ( int destCol = 0; destCol < mDestCols; ++destCol )
+    {
+      indexes[destCol] = preciseSrcRowCol( destRow, destCol, &srcRow, &srcCol ) ? static_cast< qint64 >( srcRow ) * mSrcCols + srcCol : -1;
+    }
+    return;
+  }
+
+  // same calculation as approximateSrcRowCol(), but for a whole row at once: the vertical
+  // interpolation fraction is constant along the row, and the loop over the columns has
+  // no branches, so that the compiler can vectorize it
+  if ( matrixRow( destRow ) > mHelperTopRow )
+  {
+    nextHelper();
+  }
+
+  const double destY = mDestExtent.yMaximum() - ( destRow + 0.5 ) * mDestYRes;
+  const double destYMin = mDestExtent.yMaximum() - ( matrixRow( destRow ) + 1 ) * mDestExtent.height() / ( mCPRows - 1 );
+  const double destYMax = mDestExtent.yMaximum() - matrixRow( destRow ) * mDestExtent.height() / ( mCPRows - 1 );
+  const double yfrac = ( destY - destYMin ) / ( destYMax - destYMin );
+
+  const double extentXMin = mExtent.xMinimum();
+  const double extentXMax = mExtent.xMaximum();
+  const double extentYMin = mExtent.yMinimum();
+  const double extentYMax = mExtent.yMaximum();
+  const double srcXMin = mSrcExtent.xMinimum();
+  const double srcYMax = mSrcExtent.yMaximum();
+  const double srcXRes = mSrcXRes;
+  const double srcYRes = mSrcYRes;
+  const double srcRows = mSrcRows;
+  const double srcCols = mSrcCols;
+  const qint64 srcColCount = mSrcCols;
+  const QgsPointXY *top = pHelperTop;
+  const QgsPointXY *bottom = pHelperBottom;
+
+  for ( int destCol = 0; destCol < mDestCols; ++destCol )
+  {
+    const double bx = bottom[destCol].x();
+    const double by = bottom[destCol].y();
+    const double srcX = bx + ( top[destCol].x() - bx ) * yfrac;
+    const double srcY = by + ( top[destCol].y() - by ) * yfrac;
+
+    const double row = std::floor( ( srcYMax - srcY ) / srcYRes );
+    const double col = std::floor( ( srcX - srcXMin ) / srcXRes );
+
+    const bool inside = srcX >= extentXMin && srcX <= extentXMax && srcY >= extentYMin && srcY <= extentYMax
+                        && row >= 0 && row < srcRows && col >= 0 && col < srcCols;
+    indexes[destCol] = inside ? static_cast< qint64 >( row ) * srcColCount + static_cast< qint64 >( col ) : -1;
+  }
+}
+
 void ProjectorData::insertRows( const QgsCoordinateTransform &ct )
 {
   for ( int r = 0; r < mCPRows - 1; r++ )
@@ -773,6 +839,44 @@ QString QgsRasterProjector::precisionLabel( Precision precision )
   return QStringLiteral( "Unknown" );
 }
 
+///@cond PRIVATE
+
+//! Maximum total size of the cached reprojection grids, in bytes
+static const int MAXIMUM_GRID_CACHE_SIZE = 32 * 1024 * 1024;
+
+static QMutex sGridCacheMutex;
+static QCache< QString, std::shared_ptr< const ProjectorGrid > > sGridCache( MAXIMUM_GRID_CACHE_SIZE );
+static int sGridCacheHits = 0;
+
+static std::shared_ptr< const ProjectorGrid > cachedGrid( const QString &key )
+{
+  QMutexLocker locker( &sGridCacheMutex );
+  const std::shared_ptr< const ProjectorGrid > *grid = sGridCache.object( key );
+  if ( !grid )
+    return nullptr;
+
+  sGridCacheHits++;
+  return *grid;
+}
+
+static void storeGrid( const QString &key, const std::shared_ptr< const ProjectorGrid > &grid )
+{
+  const qint64 cost = static_cast< qint64 >( grid->srcIndexes.size() * sizeof( qint64 ) ) + key.size() * 2;
+  if ( cost > MAXIMUM_GRID_CACHE_SIZE )
+    return;
+
+  QMutexLocker locker( &sGridCacheMutex );
+  sGridCache.insert( key, new std::shared_ptr< const ProjectorGrid >( grid ), static_cast< int >( cost ) );
+}
+
+///@endcond
+
+int QgsRasterProjector::gridCacheHits()
+{
+  QMutexLocker locker( &sGridCacheMutex );
+  return sGridCacheHits;
+}
+
 QgsRasterBlock *QgsRasterProjector::block( int bandNo, QgsRectangle  const &extent, int width, int height, QgsRasterBlockFeedback *feedback )
 {
   QgsDebugMsgLevel( QStringLiteral( "extent:\n%1" ).arg( extent.toString() ), 4 );
@@ -792,27 +896,100 @@ QgsRasterBlock *QgsRasterProjector::block( int bandNo, QgsRectangle  const &exte
     return mInput->block( bandNo, extent, width, height, feedback );
   }
 
-  Q_NOWARN_DEPRECATED_PUSH
-  const QgsCoordinateTransform inverseCt = mSrcDatumTransform != -1 || mDestDatumTransform != -1 ?
-      QgsCoordinateTransform( mDestCRS, mSrcCRS, mDestDatumTransform, mSrcDatumTransform ) : QgsCoordinateTransform( mDestCRS, mSrcCRS, mTransformContext ) ;
-  Q_NOWARN_DEPRECATED_POP
+  // approximate grids only depend on the transform, the source and the requested extent and size,
+  // which recur e.g. for every frame of an animation or when tiles are requested again. Grids which
+  // can't be cached are not built at all: the source pixels are calculated row by row instead
+  const qgssize gridSize = static_cast< qgssize >( width ) * static_cast< qgssize >( height ) * sizeof( qint64 );
+  const bool cacheGrid = mPrecision == Approximate && gridSize <= static_cast< qgssize >( MAXIMUM_GRID_CACHE_SIZE );
 
-  ProjectorData pd( extent, width, height, mInput, inverseCt, mPrecision, feedback );
+  std::shared_ptr< const ProjectorGrid > grid;
+  std::unique_ptr< ProjectorData > pd;
+  QString gridKey;
+  if ( cacheGrid )
+  {
+    if ( mTransformKey.isEmpty() )
+    {
+      Q_NOWARN_DEPRECATED_PUSH
+      mTransformKey = QStringList( { mSrcCRS.toWkt( QgsCoordinateReferenceSystem::WKT_PREFERRED ),
+                                     mDestCRS.toWkt( QgsCoordinateReferenceSystem::WKT_PREFERRED ),
+                                     mTransformContext.calculateCoordinateOperation( mDestCRS, mSrcCRS ),
+                                     QString::number( mSrcDatumTransform ),
+                                     QString::number( mDestDatumTransform ) } ).join( '|' );
+      Q_NOWARN_DEPRECATED_POP
+    }
 
-  if ( feedback && feedback->isCanceled() )
-    return new QgsRasterBlock();
+    QgsRectangle sourceExtent;
+    double maxSrcXRes = 0;
+    double maxSrcYRes = 0;
+    ProjectorData::sourceProperties( mInput, sourceExtent, maxSrcXRes, maxSrcYRes );
+
+    gridKey = QStringList( { extent.toString( 17 ),
+                             QStringLiteral( "%1x%2" ).arg( width ).arg( height ),
+                             sourceExtent.toString( 17 ),
+                             qgsDoubleToString( maxSrcXRes, 17 ),
+                             qgsDoubleToString( maxSrcYRes, 17 ),
+                             mTransformKey } ).join( '|' );
+    grid = cachedGrid( gridKey );
+  }
+
+  QgsRectangle srcExtent;
+  int srcRows = 0;
+  int srcCols = 0;
+  if ( grid )
+  {
+    srcExtent = grid->srcExtent;
+    srcRows = grid->srcRows;
+    srcCols = grid->srcCols;
+  }
+  else
+  {
+    Q_NOWARN_DEPRECATED_PUSH
+    const QgsCoordinateTransform inverseCt = mSrcDatumTransform != -1 || mDestDatumTransform != -1 ?
+        QgsCoordinateTransform( mDestCRS, mSrcCRS, mDestDatumTransform, mSrcDatumTransform ) : QgsCoordinateTransform( mDestCRS, mSrcCRS, mTransformContext ) ;
+    Q_NOWARN_DEPRECATED_POP
 
-  QgsDebugMsgLevel( QStringLiteral( "srcExtent:\n%1" ).arg( pd.srcExtent().toString() ), 4 );
-  QgsDebugMsgLevel( QStringLiteral( "srcCols = %1 srcRows = %2" ).arg( pd.srcCols() ).arg( pd.srcRows() ), 4 );
+    pd = std::make_unique< ProjectorData >( extent, width, height, mInput, inverseCt, mPrecision, feedback );
+
+    if ( feedback && feedback->isCanceled() )
+      return new QgsRasterBlock();
+
+    QgsDebugMsgLevel( QStringLiteral( "srcExtent:\n%1" ).arg( pd->srcExtent().toString() ), 4 );
+    QgsDebugMsgLevel( QStringLiteral( "srcCols = %1 srcRows = %2" ).arg( pd->srcCols() ).arg( pd->srcRows() ), 4 );
+
+    srcExtent = pd->srcExtent();
+    srcRows = pd->srcRows();
+    srcCols = pd->srcCols();
+
+    if ( cacheGrid )
+    {
+      std::shared_ptr< ProjectorGrid > newGrid = std::make_shared< ProjectorGrid >();
+      newGrid->srcExtent = srcExtent;
+      newGrid->srcRows = srcRows;
+      newGrid->srcCols = srcCols;
+      if ( srcRows > 0 && srcCols > 0 )
+      {
+        newGrid->srcIndexes.resize( static_cast< std::size_t >( width ) * static_cast< std::size_t >( height ) );
+        for ( int i = 0; i < height; ++i )
+        {
+          if ( feedback && feedback->isCanceled() )
+            return new QgsRasterBlock();
+          pd->srcIndexes( i, newGrid->srcIndexes.data() + static_cast< std::size_t >( i ) * width );
+        }
+      }
+
+      storeGrid( gridKey, newGrid );
+      grid = newGrid;
+    }
+  }
 
   // If we zoom out too much, projector srcRows / srcCols maybe 0, which can cause problems in providers
-  if ( pd.srcRows() <= 0 || pd.srcCols() <= 0 )
+  if ( srcRows <= 0 || srcCols <= 0 )
   {
     QgsDebugMsgLevel( QStringLiteral( "Zero srcRows or srcCols" ), 4 );
     return new QgsRasterBlock();
   }
 
-  std::unique_ptr< QgsRasterBlock > inputBlock( mInput->block( bandNo, pd.srcExtent(), pd.srcCols(), pd.srcRows(), feedback ) );
+  std::unique_ptr< QgsRasterBlock > inputBlock( mInput->block( bandNo, srcExtent, srcCols, srcRows, feedback ) );
   if ( !inputBlock || inputBlock->isEmpty() )
   {
     QgsDebugMsg( QStringLiteral( "No raster data!" ) );
@@ -849,27 +1026,38 @@ QgsRasterBlock *QgsRasterProjector::block( int bandNo, QgsRectangle  const &exte
 
   outputBlock->setIsNoData();
 
-  int srcRow, srcCol;
+  // without a grid, the source pixels of each row are calculated when the row is copied
+  std::vector< qint64 > rowIndexes( grid ? 0 : width );
   for ( int i = 0; i < height; ++i )
   {
     if ( feedback && feedback->isCanceled() )
       break;
-    for ( int j = 0; j < width; ++j )
+
+    const qint64 *srcIndexes = nullptr;
+    if ( grid )
+    {
+      srcIndexes = grid->srcIndexes.data() + static_cast< std::size_t >( i ) * width;
+    }
+    else
     {
-      bool inside = pd.srcRowCol( i, j, &srcRow, &srcCol );
-      if ( !inside ) continue; // we have everything set to no data
+      pd->srcIndexes( i, rowIndexes.data() );
+      srcIndexes = rowIndexes.data();
+    }
 
-      qgssize srcIndex = static_cast< qgssize >( srcRow * pd.srcCols() + srcCol );
+    for ( int j = 0; j < width; ++j )
+    {
+      const qgssize destIndex = static_cast< qgssize >( i ) * width + j;
+      const qint64 srcIndex = srcIndexes[j];
+      if ( srcIndex < 0 ) continue; // we have everything set to no data
 
       // isNoData() may be slow so we check doNoData first
-      if ( doNoData && inputBlock->isNoData( srcRow, srcCol ) )
+      if ( doNoData && inputBlock->isNoData( static_cast< qgssize >( srcIndex ) ) )
       {
         outputBlock->setIsNoData( i, j );
         continue;
       }
 
-      qgssize destIndex = static_cast< qgssize >( i * width + j );
-      char *srcBits = inputBlock->bits( srcIndex );
+      char *srcBits = inputBlock->bits( static_cast< qgssize >( srcIndex ) );
       char *destBits = outputBlock->bits( destIndex );
       if ( !srcBits )
       {
@@ -34,6 +34,7 @@
 #include "qgsrasterinterface.h"
 
 #include <cmath>
+#include <vector>
 
 class QgsPointXY;
 
@@ -124,12 +125,40 @@ class CORE_EXPORT QgsRasterProjector : public QgsRasterInterface
 
     QgsCoordinateTransformContext mTransformContext;
 
+    //! Identifies the CRSs and coordinate operation in the keys of cached reprojection grids, empty until first needed
+    QString mTransformKey;
+
+    //! Returns the number of blocks which reused a cached reprojection grid so far
+    static int gridCacheHits();
+
+    friend class TestQgsRasterLayer;
+
 };
 
 
 #ifndef SIP_RUN
 /// @cond PRIVATE
 
+/**
+ * Source pixels of all the pixels of a reprojected block, as calculated by ProjectorData.
+ * Grids are immutable, so that they can be shared between the requests of blocks with
+ * the same transform, extent and size.
+ */
+struct ProjectorGrid
+{
+  //! Source extent
+  QgsRectangle srcExtent;
+
+  //! Number of source rows
+  int srcRows = 0;
+
+  //! Number of source columns
+  int srcCols = 0;
+
+  //! Index of the source pixel of each destination pixel (row by row), -1 if outside of the source
+  std::vector< qint64 > srcIndexes;
+};
+
 /**
  * Internal class for reprojection of rasters - either exact or approximate.
  * QgsRasterProjector creates it and then keeps calling srcRowCol() to get source pixel position
@@ -152,6 +181,18 @@ class ProjectorData
      */
     bool srcRowCol( int destRow, int destCol, int *srcRow, int *srcCol );
 
+    /**
+     * Calculates the index of the source pixel (row * srcCols() + column) for all the columns
+     * of a destination row, or -1 for the pixels outside of the source. Rows must be calculated in order.
+     */
+    void srcIndexes( int destRow, qint64 *indexes );
+
+    /**
+     * Gets the source raster \a extent and the maximum source resolution (if any) of the data provider
+     * at the source of an \a input.
+     */
+    static void sourceProperties( QgsRasterInterface *input, QgsRectangle &extent, double &maxSrcXRes, double &maxSrcYRes );
+
     QgsRectangle srcExtent() const { return mSrcExtent; }
     int srcRows() const { return mSrcRows; }
     int srcCols() const { return mSrcCols; }
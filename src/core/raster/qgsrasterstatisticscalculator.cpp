@@ -0,0 +1,268 @@
+/***************************************************************************
+  qgsrasterstatisticscalculator.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrasterstatisticscalculator.h"
+#include "qgsrasterbandstats.h"
+#include "qgsrasterblock.h"
+#include "qgsrasterhistogram.h"
+#include "qgsrasterinterface.h"
+#include "qgslogger.h"
+
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+///@cond PRIVATE
+
+//! Partial results of a block
+struct QgsRasterStatisticsBlockResult
+{
+  //! Number of values which are not nodata, including infinite values
+  qgssize elementCount = 0;
+  //! Number of finite values
+  qgssize finiteCount = 0;
+  double sum = 0;
+  double minimum = std::numeric_limits<double>::max();
+  double maximum = -std::numeric_limits<double>::max();
+  //! Mean of the finite values
+  double mean = 0;
+  //! Sum of the squared differences from the mean of the finite values
+  double m2 = 0;
+  //! Number of values of the block in each histogram bin
+  std::vector< int > histogramCounts;
+  //! Number of values of the block counted in the histogram
+  qgssize histogramCount = 0;
+};
+
+struct QgsRasterStatisticsHistogramParameters
+{
+  double minimum = 0;
+  double binSize = 0;
+  int binCount = 0;
+  bool includeOutOfRange = false;
+};
+
+static QgsRasterStatisticsBlockResult accumulateBlock( const std::shared_ptr< QgsRasterBlock > &block, qgssize count, bool calculateStatistics,
+    bool calculateHistogram, const QgsRasterStatisticsHistogramParameters &histogram )
+{
+  QgsRasterStatisticsBlockResult result;
+  if ( calculateHistogram )
+    result.histogramCounts.assign( histogram.binCount, 0 );
+
+  bool isNoData = false;
+  for ( qgssize i = 0; i < count; ++i )
+  {
+    const double value = block->valueAndNoData( i, isNoData );
+    if ( isNoData )
+      continue; // NULL
+
+    if ( calculateHistogram )
+    {
+      int binIndex = static_cast< int >( std::floor( ( value - histogram.minimum ) / histogram.binSize ) );
+      if ( ( binIndex >= 0 && binIndex < histogram.binCount ) || histogram.includeOutOfRange )
+      {
+        binIndex = std::max( 0, std::min( binIndex, histogram.binCount - 1 ) );
+        result.histogramCounts[binIndex] += 1;
+        result.histogramCount++;
+      }
+    }
+
+    if ( !calculateStatistics )
+      continue;
+
+    result.sum += value;
+    result.elementCount++;
+
+    if ( !std::isfinite( value ) )
+      continue; // inf
+
+    result.minimum = std::min( result.minimum, value );
+    result.maximum = std::max( result.maximum, value );
+
+    // Single pass stdev (Welford)
+    result.finiteCount++;
+    const double delta = value - result.mean;
+    result.mean += delta / static_cast< double >( result.finiteCount );
+    result.m2 += delta * ( value - result.mean );
+  }
+  return result;
+}
+
+//! Merges the statistics of a block into the \a total (Chan et al. pairwise update of the variance)
+static void mergeStatistics( QgsRasterStatisticsBlockResult &total, const QgsRasterStatisticsBlockResult &block )
+{
+  total.elementCount += block.elementCount;
+  total.sum += block.sum;
+  if ( block.finiteCount == 0 )
+    return;
+
+  total.minimum = std::min( total.minimum, block.minimum );
+  total.maximum = std::max( total.maximum, block.maximum );
+
+  const double totalCount = static_cast< double >( total.finiteCount );
+  const double blockCount = static_cast< double >( block.finiteCount );
+  const double count = totalCount + blockCount;
+  const double delta = block.mean - total.mean;
+  total.mean += delta * blockCount / count;
+  total.m2 += block.m2 + delta * delta * totalCount * blockCount / count;
+  total.finiteCount += block.finiteCount;
+}
+
+bool QgsRasterStatisticsCalculator::calculate( QgsRasterInterface *input, QgsRasterBandStats *statistics, QgsRasterHistogram *histogram,
+    int xBlockSize, int yBlockSize, QgsRasterBlockFeedback *feedback )
+{
+  if ( !input || ( !statistics && !histogram ) )
+    return false;
+
+  if ( statistics && histogram &&
+       ( statistics->bandNumber != histogram->bandNumber || statistics->extent != histogram->extent ||
+         statistics->width != histogram->width || statistics->height != histogram->height ) )
+  {
+    QgsDebugMsg( QStringLiteral( "Statistics and histogram must be calculated on the same pixels" ) );
+    return false;
+  }
+
+  const int bandNo = statistics ? statistics->bandNumber : histogram->bandNumber;
+  const QgsRectangle extent = statistics ? statistics->extent : histogram->extent;
+  const int width = statistics ? statistics->width : histogram->width;
+  const int height = statistics ? statistics->height : histogram->height;
+
+  if ( xBlockSize <= 0 ) // should not happen, but happens
+    xBlockSize = 500;
+  if ( yBlockSize <= 0 ) // should not happen, but happens
+    yBlockSize = 500;
+
+  const int nXBlocks = ( width + xBlockSize - 1 ) / xBlockSize;
+  const int nYBlocks = ( height + yBlockSize - 1 ) / yBlockSize;
+
+  const double xRes = extent.width() / width;
+  const double yRes = extent.height() / height;
+
+  QgsRasterStatisticsHistogramParameters histogramParameters;
+  if ( histogram )
+  {
+    histogram->histogramVector.resize( histogram->binCount );
+
+    double minimum = histogram->minimum;
+    double maximum = histogram->maximum;
+
+    // To avoid rounding errors
+    // TODO: check this
+    const double interval = ( maximum - minimum ) / histogram->binCount;
+    minimum -= 0.1 * interval;
+    maximum += 0.1 * interval;
+
+    histogramParameters.minimum = minimum;
+    histogramParameters.binSize = ( maximum - minimum ) / histogram->binCount;
+    histogramParameters.binCount = histogram->binCount;
+    histogramParameters.includeOutOfRange = histogram->includeOutOfRange;
+  }
+
+  QgsRasterStatisticsBlockResult total;
+  const auto consume = [statistics, histogram, &total]( const QgsRasterStatisticsBlockResult & result )
+  {
+    if ( statistics )
+      mergeStatistics( total, result );
+
+    if ( histogram )
+    {
+      int *counts = histogram->histogramVector.data();
+      for ( int binIndex = 0; binIndex < histogram->binCount; ++binIndex )
+        counts[binIndex] += result.histogramCounts[binIndex];
+      histogram->nonNullCount += static_cast< int >( result.histogramCount );
+    }
+  };
+
+  const int maxBlocksInFlight = 2 * std::max( 1, QThread::idealThreadCount() );
+  QList< QFuture< QgsRasterStatisticsBlockResult > > results;
+
+  // declared after the results, so that all tasks are finished before they get destroyed
+  QThreadPool pool;
+
+  const bool calculateStatistics = statistics;
+  const bool calculateHistogram = histogram;
+  for ( int yBlock = 0; yBlock < nYBlocks; yBlock++ )
+  {
+    for ( int xBlock = 0; xBlock < nXBlocks; xBlock++ )
+    {
+      if ( feedback && feedback->isCanceled() )
+        return false;
+
+      const int blockWidth = std::min( xBlockSize, width - xBlock * xBlockSize );
+      const int blockHeight = std::min( yBlockSize, height - yBlock * yBlockSize );
+
+      const double xmin = extent.xMinimum() + xBlock * xBlockSize * xRes;
+      const double xmax = xmin + blockWidth * xRes;
+      const double ymin = extent.yMaximum() - yBlock * yBlockSize * yRes;
+      const double ymax = ymin - blockHeight * yRes;
+
+      const QgsRectangle partExtent( xmin, ymin, xmax, ymax );
+
+      // blocks are read in this thread, interfaces can't be used from several threads
+      std::shared_ptr< QgsRasterBlock > block( input->block( bandNo, partExtent, blockWidth, blockHeight, feedback ) );
+      const qgssize count = static_cast< qgssize >( blockHeight ) * blockWidth;
+
+      results << QtConcurrent::run( &pool, [block, count, calculateStatistics, calculateHistogram, histogramParameters]
+      {
+        return accumulateBlock( block, count, calculateStatistics, calculateHistogram, histogramParameters );
+      } );
+
+      // partial results are merged in the order of the blocks, so that results are reproducible
+      while ( results.size() >= maxBlocksInFlight )
+        consume( results.takeFirst().result() );
+    }
+  }
+
+  while ( !results.isEmpty() )
+    consume( results.takeFirst().result() );
+
+  if ( feedback && feedback->isCanceled() )
+    return false;
+
+  if ( statistics )
+  {
+    if ( total.finiteCount > 0 )
+    {
+      statistics->minimumValue = total.minimum;
+      statistics->maximumValue = total.maximum;
+    }
+    statistics->elementCount = total.elementCount;
+    statistics->sum = total.sum;
+    statistics->range = statistics->maximumValue - statistics->minimumValue;
+    statistics->mean = statistics->sum / statistics->elementCount;
+    statistics->sumOfSquares = total.m2;
+
+    // stdDev may differ  from GDAL stats, because GDAL is using naive single pass
+    // algorithm which is more error prone (because of rounding errors)
+    // Divide result by sample size - 1 and get square root to get stdev
+    statistics->stdDev = std::sqrt( total.m2 / ( statistics->elementCount - 1 ) );
+    statistics->statsGathered = QgsRasterBandStats::All;
+  }
+
+  if ( histogram )
+  {
+    histogram->valid = true;
+  }
+
+  return true;
+}
+
+///@endcond
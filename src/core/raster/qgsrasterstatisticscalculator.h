@@ -0,0 +1,64 @@
+/***************************************************************************
+  qgsrasterstatisticscalculator.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRASTERSTATISTICSCALCULATOR_H
+#define QGSRASTERSTATISTICSCALCULATOR_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+
+class QgsRasterInterface;
+class QgsRasterBandStats;
+class QgsRasterHistogram;
+class QgsRasterBlockFeedback;
+
+///@cond PRIVATE
+
+/**
+ * \ingroup core
+ * \class QgsRasterStatisticsCalculator
+ * \brief Calculates the statistics and the histogram of a raster band together, in a single
+ * pass over its blocks.
+ *
+ * Blocks are read from the raster interface in the calling thread (interfaces are not thread
+ * safe), while the values of the blocks already read are accumulated concurrently on a pool
+ * of worker threads. The partial results of the blocks are merged in order, so that the
+ * results do not depend on the scheduling of the threads.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsRasterStatisticsCalculator
+{
+  public:
+
+    /**
+     * Calculates the \a statistics and/or the \a histogram of a band of an \a input, reading
+     * blocks of \a xBlockSize by \a yBlockSize pixels.
+     *
+     * The band, extent and size to use are taken from the \a statistics and \a histogram
+     * (as set up by QgsRasterInterface::initStatistics() and QgsRasterInterface::initHistogram()).
+     * If both are set, they must cover the same band, extent and size. Either of them can be NULLPTR.
+     *
+     * \returns FALSE if the calculation was canceled, or if the statistics and histogram do not match
+     */
+    static bool calculate( QgsRasterInterface *input, QgsRasterBandStats *statistics, QgsRasterHistogram *histogram,
+                           int xBlockSize, int yBlockSize, QgsRasterBlockFeedback *feedback = nullptr );
+};
+
+///@endcond
+
+#endif // QGSRASTERSTATISTICSCALCULATOR_H
@@ -0,0 +1,383 @@
+/***************************************************************************
+  qgsrasterstatisticsstore.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrasterstatisticsstore.h"
+#include "qgsrasterbandstats.h"
+#include "qgsrasterdataprovider.h"
+#include "qgsrasterhistogram.h"
+#include "qgsgdalproviderbase.h"
+#include "qgsogrutils.h"
+#include "qgslogger.h"
+#include "qgssettings.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+
+///@cond PRIVATE
+
+//! Maximum number of statistics and of histograms stored for each band, the oldest ones are dropped first
+static const int MAX_STORED_ENTRIES = 32;
+
+//! Serializes read-modify-write cycles of the store files within the process
+static QMutex sStoreMutex;
+
+static QString doubleToString( double value )
+{
+  // enough digits for the value to be read back exactly
+  return QString::number( value, 'g', 17 );
+}
+
+static QString extentToString( const QgsRectangle &extent )
+{
+  return QStringList{ doubleToString( extent.xMinimum() ), doubleToString( extent.yMinimum() ),
+                      doubleToString( extent.xMaximum() ), doubleToString( extent.yMaximum() ) }.join( ',' );
+}
+
+static QgsRectangle extentFromString( const QString &string )
+{
+  const QStringList parts = string.split( ',' );
+  if ( parts.size() != 4 )
+    return QgsRectangle();
+  return QgsRectangle( parts.at( 0 ).toDouble(), parts.at( 1 ).toDouble(), parts.at( 2 ).toDouble(), parts.at( 3 ).toDouble(), false );
+}
+
+static QDomElement findBandElement( const QDomElement &root, int bandNo )
+{
+  QDomElement bandElement = root.firstChildElement( QStringLiteral( "PAMRasterBand" ) );
+  while ( !bandElement.isNull() )
+  {
+    if ( bandElement.attribute( QStringLiteral( "band" ) ).toInt() == bandNo )
+      return bandElement;
+    bandElement = bandElement.nextSiblingElement( QStringLiteral( "PAMRasterBand" ) );
+  }
+  return QDomElement();
+}
+
+static void appendTextElement( QDomDocument &document, QDomElement &parent, const QString &tagName, const QString &text )
+{
+  QDomElement element = document.createElement( tagName );
+  element.appendChild( document.createTextNode( text ) );
+  parent.appendChild( element );
+}
+
+static void dropOldestEntries( QDomElement &parent, const QString &tagName )
+{
+  int count = parent.elementsByTagName( tagName ).size();
+  while ( count-- > MAX_STORED_ENTRIES )
+    parent.removeChild( parent.firstChildElement( tagName ) );
+}
+
+std::unique_ptr< QgsRasterStatisticsStore > QgsRasterStatisticsStore::forInterface( QgsRasterInterface *input )
+{
+  QgsRasterDataProvider *provider = dynamic_cast< QgsRasterDataProvider * >( input );
+  if ( !provider )
+    return nullptr;
+
+  const QgsSettings settings;
+  if ( !settings.value( QStringLiteral( "cache/rasterStatisticsStore" ), true ).toBool() )
+    return nullptr;
+
+  // only results for local files can be invalidated reliably
+  if ( provider->name() != QLatin1String( "gdal" ) )
+    return nullptr;
+
+  const QString sourcePath = QgsGdalProviderBase::decodeGdalUri( provider->dataSourceUri() ).value( QStringLiteral( "path" ) ).toString();
+  if ( sourcePath.isEmpty() || !QFileInfo( sourcePath ).isFile() )
+    return nullptr;
+
+  // the values of a dataset may be read from several files (e.g. headers and sidecar files), which all
+  // identify the version of the source. VRT sources can be anywhere, including in other VRT files
+  const gdal::dataset_unique_ptr dataset( QgsGdalProviderBase::gdalOpen( provider->dataSourceUri( true ), GDAL_OF_READONLY ) );
+  if ( !dataset )
+    return nullptr;
+
+  if ( QString( GDALGetDriverShortName( GDALGetDatasetDriver( dataset.get() ) ) ) == QLatin1String( "VRT" ) )
+    return nullptr;
+
+  QStringList sourceFiles;
+  char **fileList = GDALGetFileList( dataset.get() );
+  for ( char **file = fileList; file && *file; ++file )
+  {
+    const QString filePath = QString::fromUtf8( *file );
+    if ( !QFileInfo( filePath ).isFile() )
+    {
+      CSLDestroy( fileList );
+      return nullptr;
+    }
+    sourceFiles << filePath;
+  }
+  CSLDestroy( fileList );
+
+  if ( sourceFiles.isEmpty() )
+    return nullptr;
+  sourceFiles.sort();
+
+  QString cacheDirectory = settings.value( QStringLiteral( "cache/directory" ) ).toString();
+  if ( cacheDirectory.isEmpty() )
+    cacheDirectory = QStandardPaths::writableLocation( QStandardPaths::CacheLocation );
+  const QDir storeDirectory( cacheDirectory + QStringLiteral( "/rasterstats" ) );
+  if ( !storeDirectory.exists() && !storeDirectory.mkpath( QStringLiteral( "." ) ) )
+  {
+    QgsDebugMsg( QStringLiteral( "Can't create raster statistics store directory: " ) + storeDirectory.path() );
+    return nullptr;
+  }
+
+  const QString source = provider->name() + ' ' + provider->dataSourceUri();
+  const QString fileName = QString::fromLatin1( QCryptographicHash::hash( source.toUtf8(), QCryptographicHash::Md5 ).toHex() ) + QStringLiteral( ".aux.xml" );
+  return std::unique_ptr< QgsRasterStatisticsStore >( new QgsRasterStatisticsStore( provider, storeDirectory.filePath( fileName ), sourceFiles ) );
+}
+
+QgsRasterStatisticsStore::QgsRasterStatisticsStore( QgsRasterDataProvider *provider, const QString &path, const QStringList &sourceFiles )
+  : mProvider( provider )
+  , mPath( path )
+  , mSourceFiles( sourceFiles )
+{
+}
+
+bool QgsRasterStatisticsStore::statistics( QgsRasterBandStats &statistics ) const
+{
+  QMutexLocker locker( &sStoreMutex );
+  const QDomDocument document = read();
+  const QDomElement bandElement = findBandElement( document.documentElement(), statistics.bandNumber );
+  if ( bandElement.isNull() )
+    return false;
+
+  const QString noData = noDataSignature( statistics.bandNumber );
+  QDomElement statisticsElement = bandElement.firstChildElement( QStringLiteral( "Statistics" ) );
+  for ( ; !statisticsElement.isNull(); statisticsElement = statisticsElement.nextSiblingElement( QStringLiteral( "Statistics" ) ) )
+  {
+    if ( statisticsElement.attribute( QStringLiteral( "noData" ) ) != noData )
+      continue;
+
+    QgsRasterBandStats stored;
+    stored.bandNumber = statistics.bandNumber;
+    stored.extent = extentFromString( statisticsElement.attribute( QStringLiteral( "extent" ) ) );
+    stored.width = statisticsElement.attribute( QStringLiteral( "width" ) ).toInt();
+    stored.height = statisticsElement.attribute( QStringLiteral( "height" ) ).toInt();
+    stored.statsGathered = statisticsElement.attribute( QStringLiteral( "gathered" ) ).toInt();
+    if ( !stored.contains( statistics ) )
+      continue;
+
+    stored.elementCount = statisticsElement.attribute( QStringLiteral( "count" ) ).toULongLong();
+    stored.minimumValue = statisticsElement.attribute( QStringLiteral( "minimum" ) ).toDouble();
+    stored.maximumValue = statisticsElement.attribute( QStringLiteral( "maximum" ) ).toDouble();
+    stored.range = statisticsElement.attribute( QStringLiteral( "range" ) ).toDouble();
+    stored.sum = statisticsElement.attribute( QStringLiteral( "sum" ) ).toDouble();
+    stored.mean = statisticsElement.attribute( QStringLiteral( "mean" ) ).toDouble();
+    stored.sumOfSquares = statisticsElement.attribute( QStringLiteral( "sumOfSquares" ) ).toDouble();
+    stored.stdDev = statisticsElement.attribute( QStringLiteral( "stdDev" ) ).toDouble();
+    statistics = stored;
+    return true;
+  }
+  return false;
+}
+
+bool QgsRasterStatisticsStore::histogram( QgsRasterHistogram &histogram ) const
+{
+  QMutexLocker locker( &sStoreMutex );
+  const QDomDocument document = read();
+  const QDomElement bandElement = findBandElement( document.documentElement(), histogram.bandNumber );
+  if ( bandElement.isNull() )
+    return false;
+
+  const QString noData = noDataSignature( histogram.bandNumber );
+  QDomElement itemElement = bandElement.firstChildElement( QStringLiteral( "Histograms" ) ).firstChildElement( QStringLiteral( "HistItem" ) );
+  for ( ; !itemElement.isNull(); itemElement = itemElement.nextSiblingElement( QStringLiteral( "HistItem" ) ) )
+  {
+    if ( itemElement.attribute( QStringLiteral( "noData" ) ) != noData )
+      continue;
+
+    QgsRasterHistogram stored;
+    stored.bandNumber = histogram.bandNumber;
+    stored.extent = extentFromString( itemElement.attribute( QStringLiteral( "extent" ) ) );
+    stored.width = itemElement.attribute( QStringLiteral( "width" ) ).toInt();
+    stored.height = itemElement.attribute( QStringLiteral( "height" ) ).toInt();
+    stored.minimum = itemElement.firstChildElement( QStringLiteral( "HistMin" ) ).text().toDouble();
+    stored.maximum = itemElement.firstChildElement( QStringLiteral( "HistMax" ) ).text().toDouble();
+    stored.binCount = itemElement.firstChildElement( QStringLiteral( "BucketCount" ) ).text().toInt();
+    stored.includeOutOfRange = itemElement.firstChildElement( QStringLiteral( "IncludeOutOfRange" ) ).text().toInt();
+    if ( !( stored == histogram ) )
+      continue;
+
+    const QStringList counts = itemElement.firstChildElement( QStringLiteral( "HistCounts" ) ).text().split( '|' );
+    if ( counts.size() != stored.binCount )
+      continue;
+
+    stored.histogramVector.reserve( stored.binCount );
+    for ( const QString &count : counts )
+      stored.histogramVector << count.toInt();
+    stored.nonNullCount = itemElement.attribute( QStringLiteral( "nonNullCount" ) ).toInt();
+    stored.valid = true;
+    histogram = stored;
+    return true;
+  }
+  return false;
+}
+
+void QgsRasterStatisticsStore::storeStatistics( const QgsRasterBandStats &statistics )
+{
+  QMutexLocker locker( &sStoreMutex );
+  QDomDocument document = read();
+  QDomElement bandElement = this->bandElement( document, statistics.bandNumber );
+
+  QDomElement statisticsElement = document.createElement( QStringLiteral( "Statistics" ) );
+  statisticsElement.setAttribute( QStringLiteral( "noData" ), noDataSignature( statistics.bandNumber ) );
+  statisticsElement.setAttribute( QStringLiteral( "extent" ), extentToString( statistics.extent ) );
+  statisticsElement.setAttribute( QStringLiteral( "width" ), statistics.width );
+  statisticsElement.setAttribute( QStringLiteral( "height" ), statistics.height );
+  statisticsElement.setAttribute( QStringLiteral( "gathered" ), statistics.statsGathered );
+  statisticsElement.setAttribute( QStringLiteral( "count" ), QString::number( statistics.elementCount ) );
+  statisticsElement.setAttribute( QStringLiteral( "minimum" ), doubleToString( statistics.minimumValue ) );
+  statisticsElement.setAttribute( QStringLiteral( "maximum" ), doubleToString( statistics.maximumValue ) );
+  statisticsElement.setAttribute( QStringLiteral( "range" ), doubleToString( statistics.range ) );
+  statisticsElement.setAttribute( QStringLiteral( "sum" ), doubleToString( statistics.sum ) );
+  statisticsElement.setAttribute( QStringLiteral( "mean" ), doubleToString( statistics.mean ) );
+  statisticsElement.setAttribute( QStringLiteral( "sumOfSquares" ), doubleToString( statistics.sumOfSquares ) );
+  statisticsElement.setAttribute( QStringLiteral( "stdDev" ), doubleToString( statistics.stdDev ) );
+  bandElement.appendChild( statisticsElement );
+  dropOldestEntries( bandElement, QStringLiteral( "Statistics" ) );
+
+  write( document );
+}
+
+void QgsRasterStatisticsStore::storeHistogram( const QgsRasterHistogram &histogram )
+{
+  QMutexLocker locker( &sStoreMutex );
+  QDomDocument document = read();
+  QDomElement bandElement = this->bandElement( document, histogram.bandNumber );
+
+  QDomElement histogramsElement = bandElement.firstChildElement( QStringLiteral( "Histograms" ) );
+  if ( histogramsElement.isNull() )
+  {
+    histogramsElement = document.createElement( QStringLiteral( "Histograms" ) );
+    bandElement.appendChild( histogramsElement );
+  }
+
+  QStringList counts;
+  counts.reserve( histogram.histogramVector.size() );
+  for ( int count : histogram.histogramVector )
+    counts << QString::number( count );
+
+  const bool approximate = !( mProvider->capabilities() & QgsRasterInterface::Size )
+                           || histogram.width < mProvider->xSize() || histogram.height < mProvider->ySize();
+
+  QDomElement itemElement = document.createElement( QStringLiteral( "HistItem" ) );
+  itemElement.setAttribute( QStringLiteral( "noData" ), noDataSignature( histogram.bandNumber ) );
+  itemElement.setAttribute( QStringLiteral( "extent" ), extentToString( histogram.extent ) );
+  itemElement.setAttribute( QStringLiteral( "width" ), histogram.width );
+  itemElement.setAttribute( QStringLiteral( "height" ), histogram.height );
+  itemElement.setAttribute( QStringLiteral( "nonNullCount" ), QString::number( histogram.nonNullCount ) );
+  appendTextElement( document, itemElement, QStringLiteral( "HistMin" ), doubleToString( histogram.minimum ) );
+  appendTextElement( document, itemElement, QStringLiteral( "HistMax" ), doubleToString( histogram.maximum ) );
+  appendTextElement( document, itemElement, QStringLiteral( "BucketCount" ), QString::number( histogram.binCount ) );
+  appendTextElement( document, itemElement, QStringLiteral( "IncludeOutOfRange" ), histogram.includeOutOfRange ? QStringLiteral( "1" ) : QStringLiteral( "0" ) );
+  appendTextElement( document, itemElement, QStringLiteral( "Approximate" ), approximate ? QStringLiteral( "1" ) : QStringLiteral( "0" ) );
+  appendTextElement( document, itemElement, QStringLiteral( "HistCounts" ), counts.join( '|' ) );
+  histogramsElement.appendChild( itemElement );
+  dropOldestEntries( histogramsElement, QStringLiteral( "HistItem" ) );
+
+  write( document );
+}
+
+QDomDocument QgsRasterStatisticsStore::read() const
+{
+  QFile file( mPath );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return QDomDocument();
+
+  QDomDocument document;
+  if ( !document.setContent( &file ) )
+  {
+    QgsDebugMsg( QStringLiteral( "Invalid raster statistics store file %1" ).arg( mPath ) );
+    return QDomDocument();
+  }
+
+  // results calculated for a previous version of the source file are discarded
+  const QDomElement root = document.documentElement();
+  if ( root.tagName() != QLatin1String( "PAMDataset" ) || root.attribute( QStringLiteral( "source" ) ) != sourceSignature() )
+    return QDomDocument();
+
+  return document;
+}
+
+void QgsRasterStatisticsStore::write( const QDomDocument &document ) const
+{
+  // QSaveFile writes to a temporary file and renames it on commit, so that other processes
+  // never read partially written files
+  QSaveFile file( mPath );
+  if ( !file.open( QIODevice::WriteOnly ) )
+  {
+    QgsDebugMsg( QStringLiteral( "Could not write raster statistics store file %1" ).arg( mPath ) );
+    return;
+  }
+
+  QTextStream stream( &file );
+  document.save( stream, 2 );
+  stream.flush();
+  if ( !file.commit() )
+  {
+    QgsDebugMsg( QStringLiteral( "Could not write raster statistics store file %1" ).arg( mPath ) );
+  }
+}
+
+QDomElement QgsRasterStatisticsStore::bandElement( QDomDocument &document, int bandNo ) const
+{
+  QDomElement root = document.documentElement();
+  if ( root.isNull() )
+  {
+    root = document.createElement( QStringLiteral( "PAMDataset" ) );
+    root.setAttribute( QStringLiteral( "source" ), sourceSignature() );
+    document.appendChild( root );
+  }
+
+  QDomElement bandElement = findBandElement( root, bandNo );
+  if ( bandElement.isNull() )
+  {
+    bandElement = document.createElement( QStringLiteral( "PAMRasterBand" ) );
+    bandElement.setAttribute( QStringLiteral( "band" ), bandNo );
+    root.appendChild( bandElement );
+  }
+  return bandElement;
+}
+
+QString QgsRasterStatisticsStore::noDataSignature( int bandNo ) const
+{
+  QStringList parts;
+  parts << ( mProvider->sourceHasNoDataValue( bandNo ) && mProvider->useSourceNoDataValue( bandNo ) ? doubleToString( mProvider->sourceNoDataValue( bandNo ) ) : QString() );
+  const QgsRasterRangeList userNoData = mProvider->userNoDataValues( bandNo );
+  for ( const QgsRasterRange &range : userNoData )
+    parts << QStringLiteral( "%1:%2:%3" ).arg( doubleToString( range.min() ), doubleToString( range.max() ) ).arg( range.bounds() );
+  return parts.join( ';' );
+}
+
+QString QgsRasterStatisticsStore::sourceSignature() const
+{
+  QStringList parts;
+  for ( const QString &sourceFile : mSourceFiles )
+  {
+    const QFileInfo sourceInfo( sourceFile );
+    parts << QStringLiteral( "%1:%2:%3" ).arg( sourceFile ).arg( sourceInfo.size() ).arg( sourceInfo.lastModified().toMSecsSinceEpoch() );
+  }
+  return parts.join( ';' );
+}
+
+///@endcond
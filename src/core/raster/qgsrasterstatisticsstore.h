@@ -0,0 +1,111 @@
+/***************************************************************************
+  qgsrasterstatisticsstore.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRASTERSTATISTICSSTORE_H
+#define QGSRASTERSTATISTICSSTORE_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+
+#include <QDomDocument>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+class QgsRasterInterface;
+class QgsRasterDataProvider;
+class QgsRasterBandStats;
+class QgsRasterHistogram;
+
+///@cond PRIVATE
+
+/**
+ * \ingroup core
+ * \class QgsRasterStatisticsStore
+ * \brief Persists the statistics and histograms calculated for a local raster file, so that
+ * they can be reused across sessions.
+ *
+ * Results are stored in an XML file in the cache directory, laid out like the GDAL PAM
+ * (.aux.xml) files, with the extent, size and nodata settings used for each entry. The stored
+ * results are discarded as soon as the size or modification time of any of the files of the
+ * raster dataset change.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsRasterStatisticsStore
+{
+  public:
+
+    /**
+     * Returns the store for the statistics of \a input, or NULLPTR if they can't be persisted:
+     * \a input is not the GDAL data provider of local files, it reads a VRT dataset, or persistence
+     * is disabled by the "cache/rasterStatisticsStore" setting.
+     */
+    static std::unique_ptr< QgsRasterStatisticsStore > forInterface( QgsRasterInterface *input );
+
+    /**
+     * Looks for stored statistics matching the band, extent, size and gathered statistics
+     * of \a statistics, and copies them to \a statistics.
+     * \returns TRUE if matching statistics were found
+     */
+    bool statistics( QgsRasterBandStats &statistics ) const;
+
+    /**
+     * Looks for a stored histogram matching the band, bins, range, extent and size
+     * of \a histogram, and copies it to \a histogram.
+     * \returns TRUE if a matching histogram was found
+     */
+    bool histogram( QgsRasterHistogram &histogram ) const;
+
+    //! Stores calculated \a statistics
+    void storeStatistics( const QgsRasterBandStats &statistics );
+
+    //! Stores a calculated \a histogram
+    void storeHistogram( const QgsRasterHistogram &histogram );
+
+    //! Returns the path of the file storing the results
+    QString path() const { return mPath; }
+
+  private:
+
+    QgsRasterStatisticsStore( QgsRasterDataProvider *provider, const QString &path, const QStringList &sourceFiles );
+
+    //! Reads the stored document, returns an empty document if it does not match the current source file
+    QDomDocument read() const;
+
+    //! Writes the \a document
+    void write( const QDomDocument &document ) const;
+
+    //! Returns the band element of \a document for \a bandNo, created if it does not exist yet
+    QDomElement bandElement( QDomDocument &document, int bandNo ) const;
+
+    //! Returns a string identifying the nodata values used for \a bandNo
+    QString noDataSignature( int bandNo ) const;
+
+    //! Returns a string identifying the current version of the source files
+    QString sourceSignature() const;
+
+    QgsRasterDataProvider *mProvider = nullptr;
+    QString mPath;
+    //! Files of the source dataset, sorted
+    QStringList mSourceFiles;
+};
+
+///@endcond
+
+#endif // QGSRASTERSTATISTICSSTORE_H
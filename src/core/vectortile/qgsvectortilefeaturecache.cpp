@@ -0,0 +1,91 @@
+/***************************************************************************
+  qgsvectortilefeaturecache.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsvectortilefeaturecache.h"
+
+#include <QCryptographicHash>
+#include <QMutexLocker>
+
+#include <algorithm>
+
+QMutex QgsVectorTileFeatureCache::sMutex;
+
+// decoded features take several times the memory of the raw tile data
+QCache< QString, QgsVectorTileFeatures > QgsVectorTileFeatureCache::sCache( 16 * 1024 * 1024 );
+
+QString QgsVectorTileFeatureCache::sourceId( const QString &sourceType, const QString &sourcePath )
+{
+  // hashed, so that the separator of the cache keys can't appear in the source part
+  return QString::fromLatin1( QCryptographicHash::hash( QString( sourceType + ':' + sourcePath ).toUtf8(), QCryptographicHash::Md5 ).toHex() );
+}
+
+QString QgsVectorTileFeatureCache::cacheKey( const QString &sourceId, const QString &signature, QgsTileXYZ tileID )
+{
+  return sourceId + '|' + tileID.toString() + '|' + signature;
+}
+
+bool QgsVectorTileFeatureCache::features( const QString &key, QgsVectorTileFeatures &features )
+{
+  QMutexLocker locker( &sMutex );
+  const QgsVectorTileFeatures *cached = sCache.object( key );
+  if ( !cached )
+    return false;
+
+  // features are implicitly shared, so copying them is cheap
+  features = *cached;
+  return true;
+}
+
+void QgsVectorTileFeatureCache::storeFeatures( const QString &key, const QgsVectorTileFeatures &features, int cost )
+{
+  QMutexLocker locker( &sMutex );
+  sCache.insert( key, new QgsVectorTileFeatures( features ), std::max( cost, 1 ) );
+}
+
+int QgsVectorTileFeatureCache::maximumCacheSize()
+{
+  QMutexLocker locker( &sMutex );
+  return sCache.maxCost();
+}
+
+void QgsVectorTileFeatureCache::setMaximumCacheSize( int size )
+{
+  QMutexLocker locker( &sMutex );
+  sCache.setMaxCost( std::max( size, 0 ) );
+}
+
+QStringList QgsVectorTileFeatureCache::keys()
+{
+  QMutexLocker locker( &sMutex );
+  return sCache.keys();
+}
+
+void QgsVectorTileFeatureCache::removeSource( const QString &sourceId )
+{
+  QMutexLocker locker( &sMutex );
+  const QString prefix = sourceId + '|';
+  const QList< QString > keys = sCache.keys();
+  for ( const QString &key : keys )
+  {
+    if ( key.startsWith( prefix ) )
+      sCache.remove( key );
+  }
+}
+
+void QgsVectorTileFeatureCache::clear()
+{
+  QMutexLocker locker( &sMutex );
+  sCache.clear();
+}
@@ -0,0 +1,120 @@
+/***************************************************************************
+  qgsvectortilefeaturecache.h
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSVECTORTILEFEATURECACHE_H
+#define QGSVECTORTILEFEATURECACHE_H
+
+#define SIP_NO_FILE
+
+#include "qgis_core.h"
+#include "qgsvectortilerenderer.h"
+
+#include <QCache>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+/**
+ * \ingroup core
+ * \brief A global cache of the features decoded from vector tiles, shared by all vector tile layers.
+ *
+ * Decoding the raw data of a tile is the most expensive step of vector tile rendering, so the decoded
+ * features of recently rendered tiles are kept and reused when the same tiles are rendered again, e.g.
+ * when the map is panned. The least recently used tiles are evicted when the cache is full.
+ *
+ * Features decoded for a tile depend on the fields and sub-layers requested by the renderer and labeling,
+ * so cache keys are built from the tile source, the tile ID and a signature of the decoding parameters
+ * (see cacheKey()). The tiles of a source must be removed with removeSource() when its data changes.
+ *
+ * All methods are thread safe.
+ *
+ * \note not available in Python bindings
+ * \since QGIS 3.22
+ */
+class CORE_EXPORT QgsVectorTileFeatureCache
+{
+  public:
+
+    /**
+     * Returns the identifier of a tile source from its \a sourceType and \a sourcePath,
+     * as used by cacheKey() and removeSource().
+     */
+    static QString sourceId( const QString &sourceType, const QString &sourcePath );
+
+    /**
+     * Returns a cache key for the tile with matching \a tileID from the source with matching \a sourceId,
+     * decoded with parameters summarized by a \a signature.
+     *
+     * The signature must identify everything else affecting the decoded features, i.e. the destination
+     * CRS, the requested fields for each sub-layer and the set of requested sub-layers.
+     *
+     * \see sourceId()
+     */
+    static QString cacheKey( const QString &sourceId, const QString &signature, QgsTileXYZ tileID );
+
+    /**
+     * Retrieves the decoded \a features stored for a \a key.
+     *
+     * Returns FALSE if no features are stored for the key.
+     */
+    static bool features( const QString &key, QgsVectorTileFeatures &features );
+
+    /**
+     * Stores the decoded \a features for a \a key. The \a cost of the entry should be the size
+     * of the raw tile data the features were decoded from.
+     */
+    static void storeFeatures( const QString &key, const QgsVectorTileFeatures &features, int cost );
+
+    /**
+     * Returns the maximum size of the cache, as the total size in bytes of the raw data of the cached tiles.
+     *
+     * \see setMaximumCacheSize()
+     */
+    static int maximumCacheSize();
+
+    /**
+     * Sets the maximum \a size of the cache, as the total size in bytes of the raw data of the cached tiles.
+     *
+     * A size of 0 disables the cache.
+     *
+     * \see maximumCacheSize()
+     */
+    static void setMaximumCacheSize( int size );
+
+    /**
+     * Returns the keys of all the tiles in the cache.
+     */
+    static QStringList keys();
+
+    /**
+     * Removes all the tiles of the source with matching \a sourceId from the cache, e.g. because
+     * the source of a layer was changed.
+     *
+     * \see sourceId()
+     */
+    static void removeSource( const QString &sourceId );
+
+    /**
+     * Removes all tiles from the cache.
+     */
+    static void clear();
+
+  private:
+
+    static QMutex sMutex;
+    static QCache< QString, QgsVectorTileFeatures > sCache;
+};
+
+#endif // QGSVECTORTILEFEATURECACHE_H
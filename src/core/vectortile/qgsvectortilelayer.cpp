@@ -32,6 +32,7 @@
 #include "qgsjsonutils.h"
 #include "qgspainting.h"
 #include "qgsmaplayerfactory.h"
+#include "qgsvectortilefeaturecache.h"
 
 #include <QUrl>
 #include <QUrlQuery>
@@ -189,6 +190,24 @@ bool QgsVectorTileLayer::setupArcgisVectorTileServiceConnection( const QString &
 
 QgsVectorTileLayer::~QgsVectorTileLayer() = default;
 
+void QgsVectorTileLayer::setDataSourcePrivate( const QString &dataSource, const QString &baseName, const QString &provider,
+    const QgsDataProvider::ProviderOptions &options, QgsDataProvider::ReadFlags flags )
+{
+  Q_UNUSED( provider )
+  Q_UNUSED( options )
+  Q_UNUSED( flags )
+
+  // tiles decoded from the previous source are not needed anymore, and tiles decoded from
+  // the new one may be outdated if the source is reloaded
+  QgsVectorTileFeatureCache::removeSource( QgsVectorTileFeatureCache::sourceId( mSourceType, mSourcePath ) );
+
+  setName( baseName );
+  mDataSource = dataSource;
+  setValid( loadDataSource() );
+
+  QgsVectorTileFeatureCache::removeSource( QgsVectorTileFeatureCache::sourceId( mSourceType, mSourcePath ) );
+}
+
 
 QgsVectorTileLayer *QgsVectorTileLayer::clone() const
 {
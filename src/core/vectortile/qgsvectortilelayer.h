@@ -180,6 +180,8 @@ class CORE_EXPORT QgsVectorTileLayer : public QgsMapLayer
   private:
     bool loadDataSource();
 
+    void setDataSourcePrivate( const QString &dataSource, const QString &baseName, const QString &provider, const QgsDataProvider::ProviderOptions &options, QgsDataProvider::ReadFlags flags ) override;
+
   private:
     //! Type of the data source
     QString mSourceType;
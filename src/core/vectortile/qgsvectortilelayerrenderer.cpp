@@ -15,12 +15,16 @@
 
 #include "qgsvectortilelayerrenderer.h"
 
+#include <QCryptographicHash>
 #include <QElapsedTimer>
+#include <QThreadPool>
+#include <QtConcurrent>
 
 #include "qgsexpressioncontextutils.h"
 #include "qgsfeedback.h"
 #include "qgslogger.h"
 
+#include "qgsvectortilefeaturecache.h"
 #include "qgsvectortilemvtdecoder.h"
 #include "qgsvectortilelayer.h"
 #include "qgsvectortileloader.h"
@@ -30,6 +34,16 @@
 #include "qgsvectortilelabeling.h"
 #include "qgsmapclippingutils.h"
 
+/**
+ * Returns the pool of threads decoding the raw tiles. A dedicated pool is used because
+ * the renderer waits for the decoded tiles from a job typically running on the global thread pool.
+ */
+static QThreadPool *decodingThreadPool()
+{
+  static QThreadPool sPool;
+  return &sPool;
+}
+
 QgsVectorTileLayerRenderer::QgsVectorTileLayerRenderer( QgsVectorTileLayer *layer, QgsRenderContext &context )
   : QgsMapLayerRenderer( layer->id(), &context )
   , mSourceType( layer->sourceType() )
@@ -123,7 +137,8 @@ bool QgsVectorTileLayerRenderer::render()
     {
       QgsDebugMsgLevel( QStringLiteral( "Got tile asynchronously: " ) + rawTile.id.toString(), 2 );
       if ( !rawTile.data.isEmpty() )
-        decodeAndDrawTile( rawTile );
+        startDecodingTile( rawTile );
+      drawDecodedTiles( false );
     } );
   }
 
@@ -167,14 +182,33 @@ bool QgsVectorTileLayerRenderer::render()
     mRequiredLayers.unite( mLabelProvider->requiredLayers( ctx, mTileZoom ) );
   }
 
+  // everything else which affects the decoded features goes to the signature, so that tiles decoded
+  // by previous renders can be reused as long as the source, fields and layers are the same
+  mCacheSourceId = QgsVectorTileFeatureCache::sourceId( mSourceType, mSourcePath );
+  QStringList signatureParts;
+  const QgsCoordinateTransform ct = ctx.coordinateTransform();
+  if ( ct.isValid() )
+    signatureParts << ct.destinationCrs().toWkt( QgsCoordinateReferenceSystem::WKT_PREFERRED ) << ct.coordinateOperation();
+  for ( auto it = mPerLayerFields.constBegin(); it != mPerLayerFields.constEnd(); ++it )
+    signatureParts << it.key() + ':' + it.value().names().join( ',' );
+  QStringList requiredLayers = qgis::setToList( mRequiredLayers );
+  std::sort( requiredLayers.begin(), requiredLayers.end() );
+  signatureParts << requiredLayers.join( ',' );
+  mCacheSignature = QString::fromLatin1( QCryptographicHash::hash( signatureParts.join( '|' ).toUtf8(), QCryptographicHash::Md5 ).toHex() );
+
   if ( !isAsync )
   {
+    // keep a few tiles ahead being decoded in worker threads while the decoded ones get drawn
+    const int maxPendingTiles = 2 * std::max( 1, QThread::idealThreadCount() );
     for ( QgsVectorTileRawData &rawTile : rawTiles )
     {
       if ( ctx.renderingStopped() )
         break;
 
-      decodeAndDrawTile( rawTile );
+      startDecodingTile( rawTile );
+      if ( mPendingTiles.size() >= maxPendingTiles )
+        mPendingTiles.first().waitForFinished();
+      drawDecodedTiles( false );
     }
   }
   else
@@ -184,6 +218,9 @@ bool QgsVectorTileLayerRenderer::render()
     asyncLoader->downloadBlocking();
   }
 
+  // draw the tiles still being decoded
+  drawDecodedTiles( true );
+
   mRenderer->stopRender( ctx );
 
   QgsDebugMsgLevel( QStringLiteral( "Total time for decoding: %1" ).arg( mTotalDecodeTime / 1000. ), 2 );
@@ -198,44 +235,85 @@ bool QgsVectorTileLayerRenderer::forceRasterRender() const
   return renderContext()->testFlag( QgsRenderContext::UseAdvancedEffects ) && ( !qgsDoubleNear( mLayerOpacity, 1.0 ) );
 }
 
-void QgsVectorTileLayerRenderer::decodeAndDrawTile( const QgsVectorTileRawData &rawTile )
+QgsVectorTileLayerRenderer::DecodedTile QgsVectorTileLayerRenderer::decodeTileFeatures( const QgsVectorTileRawData &rawTile, const QMap<QString, QgsFields> &perLayerFields,
+    const QgsCoordinateTransform &ct, const QSet<QString> &requiredLayers, const QString &cacheKey )
 {
-  QgsRenderContext &ctx = *renderContext();
+  DecodedTile decodedTile;
+  decodedTile.id = rawTile.id;
 
-  QgsDebugMsgLevel( QStringLiteral( "Drawing tile " ) + rawTile.id.toString(), 2 );
-
-  QElapsedTimer tLoad;
-  tLoad.start();
+  if ( QgsVectorTileFeatureCache::features( cacheKey, decodedTile.features ) )
+  {
+    decodedTile.valid = true;
+    return decodedTile;
+  }
 
   // currently only MVT encoding supported
   QgsVectorTileMVTDecoder decoder;
   if ( !decoder.decode( rawTile.id, rawTile.data ) )
   {
     QgsDebugMsgLevel( QStringLiteral( "Failed to parse raw tile data! " ) + rawTile.id.toString(), 2 );
-    return;
+    return decodedTile;
   }
 
-  if ( ctx.renderingStopped() )
-    return;
+  decodedTile.features = decoder.layerFeatures( perLayerFields, ct, &requiredLayers );
+  decodedTile.valid = true;
+  QgsVectorTileFeatureCache::storeFeatures( cacheKey, decodedTile.features, rawTile.data.size() );
+  return decodedTile;
+}
+
+void QgsVectorTileLayerRenderer::startDecodingTile( const QgsVectorTileRawData &rawTile )
+{
+  const QString cacheKey = QgsVectorTileFeatureCache::cacheKey( mCacheSourceId, mCacheSignature, rawTile.id );
+  mPendingTiles << QtConcurrent::run( decodingThreadPool(), &QgsVectorTileLayerRenderer::decodeTileFeatures,
+                                      rawTile, mPerLayerFields, renderContext()->coordinateTransform(), mRequiredLayers, cacheKey );
+}
+
+void QgsVectorTileLayerRenderer::drawDecodedTiles( bool waitForAll )
+{
+  while ( !mPendingTiles.isEmpty() )
+  {
+    if ( renderContext()->renderingStopped() )
+    {
+      // pending decoding tasks only work on copies of the renderer data, they can safely finish on their own
+      mPendingTiles.clear();
+      return;
+    }
+
+    if ( !waitForAll && !mPendingTiles.first().isFinished() )
+      return;
+
+    QElapsedTimer tWait;
+    tWait.start();
+    const DecodedTile decodedTile = mPendingTiles.takeFirst().result();
+    mTotalDecodeTime += tWait.elapsed();
+
+    if ( decodedTile.valid )
+      drawTile( decodedTile );
+  }
+}
+
+void QgsVectorTileLayerRenderer::drawTile( const DecodedTile &decodedTile )
+{
+  QgsRenderContext &ctx = *renderContext();
+
+  QgsDebugMsgLevel( QStringLiteral( "Drawing tile " ) + decodedTile.id.toString(), 2 );
 
   QgsCoordinateTransform ct = ctx.coordinateTransform();
 
-  QgsVectorTileRendererData tile( rawTile.id );
+  QgsVectorTileRendererData tile( decodedTile.id );
   tile.setFields( mPerLayerFields );
-  tile.setFeatures( decoder.layerFeatures( mPerLayerFields, ct, &mRequiredLayers ) );
+  tile.setFeatures( decodedTile.features );
 
   try
   {
-    tile.setTilePolygon( QgsVectorTileUtils::tilePolygon( rawTile.id, ct, mTileMatrix, ctx.mapToPixel() ) );
+    tile.setTilePolygon( QgsVectorTileUtils::tilePolygon( decodedTile.id, ct, mTileMatrix, ctx.mapToPixel() ) );
   }
   catch ( QgsCsException & )
   {
-    QgsDebugMsgLevel( QStringLiteral( "Failed to generate tile polygon " ) + rawTile.id.toString(), 2 );
+    QgsDebugMsgLevel( QStringLiteral( "Failed to generate tile polygon " ) + decodedTile.id.toString(), 2 );
     return;
   }
 
-  mTotalDecodeTime += tLoad.elapsed();
-
   // calculate tile polygon in screen coordinates
 
   if ( ctx.renderingStopped() )
@@ -26,6 +26,9 @@ class QgsVectorTileLabelProvider;
 
 #include "qgsvectortilerenderer.h"
 #include "qgsmapclippingregion.h"
+#include "qgscoordinatetransform.h"
+
+#include <QFuture>
 
 /**
  * \ingroup core
@@ -33,7 +36,8 @@ class QgsVectorTileLabelProvider;
  * In render() function (assumed to be run in a worker thread) it will:
  *
  * # fetch vector tiles using QgsVectorTileLoader
- * # decode raw tiles into QgsFeature objects using QgsVectorTileDecoder
+ * # decode raw tiles into QgsFeature objects using QgsVectorTileDecoder, in parallel worker threads,
+ *   unless the features of the tiles are available in QgsVectorTileFeatureCache
  * # render tiles using a class derived from QgsVectorTileRenderer
  *
  * \since QGIS 3.14
@@ -49,7 +53,29 @@ class QgsVectorTileLayerRenderer : public QgsMapLayerRenderer
     bool forceRasterRender() const override;
 
   private:
-    void decodeAndDrawTile( const QgsVectorTileRawData &rawTile );
+
+    //! Features decoded from a raw tile
+    struct DecodedTile
+    {
+      QgsTileXYZ id;
+      bool valid = false;
+      QgsVectorTileFeatures features;
+    };
+
+    //! Decodes a raw tile, or takes its features from the cache. Called from worker threads.
+    static DecodedTile decodeTileFeatures( const QgsVectorTileRawData &rawTile, const QMap<QString, QgsFields> &perLayerFields,
+                                           const QgsCoordinateTransform &ct, const QSet< QString > &requiredLayers, const QString &cacheKey );
+
+    //! Starts decoding a raw tile in a worker thread, and adds it to the list of tiles to draw
+    void startDecodingTile( const QgsVectorTileRawData &rawTile );
+
+    /**
+     * Draws the decoded tiles in the order they were started. If \a waitForAll is FALSE, drawing stops
+     * at the first tile which is not decoded yet.
+     */
+    void drawDecodedTiles( bool waitForAll );
+
+    void drawTile( const DecodedTile &decodedTile );
 
     // data coming from the vector tile layer
 
@@ -93,6 +119,14 @@ class QgsVectorTileLayerRenderer : public QgsMapLayerRenderer
     //! Cached list of layers required for renderer and labeling
     QSet< QString > mRequiredLayers;
 
+    //! Identifier of the tile source, used to build the keys of decoded tiles in QgsVectorTileFeatureCache
+    QString mCacheSourceId;
+    //! Signature of the decoding parameters, used to build the keys of decoded tiles in QgsVectorTileFeatureCache
+    QString mCacheSignature;
+
+    //! Tiles being decoded in worker threads, in the order they will be drawn
+    QList< QFuture< DecodedTile > > mPendingTiles;
+
     //! Counter of total elapsed time to decode tiles (ms)
     int mTotalDecodeTime = 0;
     //! Counter of total elapsed time to render tiles (ms)
@@ -174,8 +174,7 @@ void QgsVectorTileMVTEncoder::addLayer( QgsVectorLayer *layer, QgsFeedback *feed
 
   // add buffer to both filter extent in layer CRS (for feature request) and tile extent in target CRS (for clipping)
   double bufferRatio = static_cast<double>( mBuffer ) / mResolution;
-  QgsRectangle tileExtent = mTileExtent;
-  tileExtent.grow( bufferRatio * mTileExtent.width() );
+  const QgsRectangle tileExtent = bufferedTileExtent();
   layerTileExtent.grow( bufferRatio * std::max( layerTileExtent.width(), layerTileExtent.height() ) );
 
   QgsFeatureRequest request;
@@ -190,16 +189,7 @@ void QgsVectorTileMVTEncoder::addLayer( QgsVectorLayer *layer, QgsFeedback *feed
     return;  // nothing to write - do not add the layer at all
   }
 
-  vector_tile::Tile_Layer *tileLayer = tile.add_layers();
-  tileLayer->set_name( layerName.toUtf8() );
-  tileLayer->set_version( 2 );  // 2 means MVT spec version 2.1
-  tileLayer->set_extent( static_cast<::google::protobuf::uint32>( mResolution ) );
-
-  const QgsFields fields = layer->fields();
-  for ( int i = 0; i < fields.count(); ++i )
-  {
-    tileLayer->add_keys( fields[i].name().toUtf8() );
-  }
+  vector_tile::Tile_Layer *tileLayer = addTileLayer( layerName, layer->fields() );
 
   do
   {
@@ -231,6 +221,54 @@ void QgsVectorTileMVTEncoder::addLayer( QgsVectorLayer *layer, QgsFeedback *feed
   mKnownValues.clear();
 }
 
+void QgsVectorTileMVTEncoder::addLayer( const QString &layerName, const QgsFields &fields, const QVector<QgsFeature> &features, QgsFeedback *feedback )
+{
+  if ( features.isEmpty() || ( feedback && feedback->isCanceled() ) )
+    return;  // nothing to write - do not add the layer at all
+
+  vector_tile::Tile_Layer *tileLayer = addTileLayer( layerName, fields );
+
+  const QgsRectangle tileExtent = bufferedTileExtent();
+  for ( QgsFeature f : features )
+  {
+    if ( feedback && feedback->isCanceled() )
+      break;
+
+    // clip, unless the whole geometry is within the tile
+    QgsGeometry g = f.geometry();
+    if ( !tileExtent.contains( g.boundingBox() ) )
+    {
+      g = g.clipped( tileExtent );
+      f.setGeometry( g );
+    }
+
+    addFeature( tileLayer, f );
+  }
+
+  mKnownValues.clear();
+}
+
+vector_tile::Tile_Layer *QgsVectorTileMVTEncoder::addTileLayer( const QString &layerName, const QgsFields &fields )
+{
+  vector_tile::Tile_Layer *tileLayer = tile.add_layers();
+  tileLayer->set_name( layerName.toUtf8() );
+  tileLayer->set_version( 2 );  // 2 means MVT spec version 2.1
+  tileLayer->set_extent( static_cast<::google::protobuf::uint32>( mResolution ) );
+
+  for ( int i = 0; i < fields.count(); ++i )
+  {
+    tileLayer->add_keys( fields[i].name().toUtf8() );
+  }
+  return tileLayer;
+}
+
+QgsRectangle QgsVectorTileMVTEncoder::bufferedTileExtent() const
+{
+  QgsRectangle tileExtent = mTileExtent;
+  tileExtent.grow( static_cast<double>( mBuffer ) / mResolution * mTileExtent.width() );
+  return tileExtent;
+}
+
 void QgsVectorTileMVTEncoder::addFeature( vector_tile::Tile_Layer *tileLayer, const QgsFeature &f )
 {
   QgsGeometry g = f.geometry();
@@ -53,6 +53,14 @@ class CORE_EXPORT QgsVectorTileMVTEncoder
     //! Sets size of the buffer zone around tile edges in integer tile coordinates
     void setTileBuffer( int buffer ) { mBuffer = buffer; }
 
+    /**
+     * Returns the extent of the tile in EPSG:3857 grown by the size of the buffer zone, i.e. the area
+     * features of added layers are clipped to.
+     *
+     * \since QGIS 3.22
+     */
+    QgsRectangle bufferedTileExtent() const;
+
     //! Sets coordinate transform context for transforms between layers and tile matrix CRS
     void setTransformContext( const QgsCoordinateTransformContext &transformContext ) { mTransformContext = transformContext; }
 
@@ -63,10 +71,24 @@ class CORE_EXPORT QgsVectorTileMVTEncoder
      */
     void addLayer( QgsVectorLayer *layer, QgsFeedback *feedback = nullptr, QString filterExpression = QString(), QString layerName = QString() );
 
+    /**
+     * Adds a layer named \a layerName with \a features which are already in the tile matrix CRS (EPSG:3857),
+     * e.g. features read only once and shared by the encoders of many tiles. Geometries are clipped to the
+     * tile extent (including the buffer), so \a features only need to be the ones intersecting it.
+     *
+     * The attributes of \a features must match the specified \a fields.
+     *
+     * Optional feedback object may be provided to support cancellation.
+     *
+     * \since QGIS 3.22
+     */
+    void addLayer( const QString &layerName, const QgsFields &fields, const QVector< QgsFeature > &features, QgsFeedback *feedback = nullptr );
+
     //! Encodes MVT using data stored previously with addLayer() calls
     QByteArray encode() const;
 
   private:
+    vector_tile::Tile_Layer *addTileLayer( const QString &layerName, const QgsFields &fields );
     void addFeature( vector_tile::Tile_Layer *tileLayer, const QgsFeature &f );
 
   private:
@@ -30,7 +30,53 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QThreadPool>
 #include <QUrl>
+#include <QtConcurrentRun>
+
+///@cond PRIVATE
+
+//! Input layer of the writer, with the transform of its features to EPSG:3857
+struct QgsVectorTileWriterLayerData
+{
+  QgsVectorLayer *layer = nullptr;
+  QString layerName;
+  QString filterExpression;
+  QgsFields fields;
+  QgsCoordinateTransform ct;
+  int minZoom = -1;
+  int maxZoom = -1;
+};
+
+//! Number of rows and columns of the blocks of tiles whose features are read and encoded together
+constexpr int QGS_VECTOR_TILE_WRITER_BLOCK_SIZE = 8;
+
+/**
+ * Encodes a tile from the features of the layers intersecting it (one list per layer, in the same order
+ * as \a layers, already reprojected to EPSG:3857), called from worker threads
+ */
+static QByteArray encodeTile( QgsTileXYZ tileID, const std::vector< QgsVectorTileWriterLayerData > &layers, const QVector< QVector< QgsFeature > > &features, bool gzip, QgsFeedback *feedback )
+{
+  QgsVectorTileMVTEncoder encoder( tileID );
+
+  for ( std::size_t i = 0; i < layers.size(); ++i )
+  {
+    if ( feedback && feedback->isCanceled() )
+      return QByteArray();
+
+    encoder.addLayer( layers[i].layerName, layers[i].fields, features.at( static_cast< int >( i ) ), feedback );
+  }
+
+  const QByteArray tileData = encoder.encode();
+  if ( !gzip || tileData.isEmpty() )
+    return tileData;
+
+  QByteArray gzipTileData;
+  QgsMbTiles::encodeGzip( tileData, gzipTileData );
+  return gzipTileData;
+}
+
+///@endcond
 
 
 QgsVectorTileWriter::QgsVectorTileWriter()
@@ -151,61 +197,198 @@ bool QgsVectorTileWriter::writeTiles( QgsFeedback *feedback )
     }
   }
 
+  const QgsCoordinateReferenceSystem destCrs( "EPSG:3857" );
+  std::vector< QgsVectorTileWriterLayerData > layersData;
+  for ( const Layer &layer : std::as_const( mLayers ) )
+  {
+    if ( ( layer.minZoom() >= 0 && layer.minZoom() > mMaxZoom ) ||
+         ( layer.maxZoom() >= 0 && layer.maxZoom() < mMinZoom ) )
+      continue;
+
+    QgsVectorTileWriterLayerData layerData;
+    layerData.layer = layer.layer();
+    layerData.layerName = layer.layerName().isEmpty() ? layer.layer()->name() : layer.layerName();
+    layerData.filterExpression = layer.filterExpression();
+    layerData.fields = layer.layer()->fields();
+    layerData.ct = QgsCoordinateTransform( layer.layer()->crs(), destCrs, mTransformContext );
+    layerData.minZoom = layer.minZoom();
+    layerData.maxZoom = layer.maxZoom();
+    layersData.emplace_back( std::move( layerData ) );
+  }
+
+  // tiles are processed in square blocks: the features of each block are read with a single request
+  // per layer and binned to the tiles of the block, which then get encoded by worker threads and written
+  // in order by this thread, within a single transaction for MBTiles. Only the features of one block are
+  // kept in memory at a time
+  QThreadPool pool;
+  pool.setMaxThreadCount( QThreadPool::globalInstance()->maxThreadCount() );
+  const bool gzip = static_cast< bool >( mbtiles );
+
   int tilesCreated = 0;
   for ( int zoomLevel = mMinZoom; zoomLevel <= mMaxZoom; ++zoomLevel )
   {
     QgsTileMatrix tileMatrix = QgsTileMatrix::fromWebMercator( zoomLevel );
 
+    std::vector< QgsVectorTileWriterLayerData > zoomLayersData;
+    for ( const QgsVectorTileWriterLayerData &layerData : layersData )
+    {
+      if ( ( layerData.minZoom < 0 || zoomLevel >= layerData.minZoom ) &&
+           ( layerData.maxZoom < 0 || zoomLevel <= layerData.maxZoom ) )
+        zoomLayersData.emplace_back( layerData );
+    }
+
     QgsTileRange tileRange = tileMatrix.tileRangeFromExtent( outputExtent );
-    for ( int row = tileRange.startRow(); row <= tileRange.endRow(); ++row )
+    for ( int blockRow = tileRange.startRow(); blockRow <= tileRange.endRow(); blockRow += QGS_VECTOR_TILE_WRITER_BLOCK_SIZE )
     {
-      for ( int col = tileRange.startColumn(); col <= tileRange.endColumn(); ++col )
+      for ( int blockCol = tileRange.startColumn(); blockCol <= tileRange.endColumn(); blockCol += QGS_VECTOR_TILE_WRITER_BLOCK_SIZE )
       {
-        QgsTileXYZ tileID( col, row, zoomLevel );
-        QgsVectorTileMVTEncoder encoder( tileID );
-        encoder.setTransformContext( mTransformContext );
-
-        for ( const Layer &layer : std::as_const( mLayers ) )
+        const int blockEndRow = std::min( blockRow + QGS_VECTOR_TILE_WRITER_BLOCK_SIZE - 1, tileRange.endRow() );
+        const int blockEndCol = std::min( blockCol + QGS_VECTOR_TILE_WRITER_BLOCK_SIZE - 1, tileRange.endColumn() );
+        const int blockWidth = blockEndCol - blockCol + 1;
+
+        QVector< QgsTileXYZ > tileIDs;
+        QVector< QgsRectangle > tileExtents;
+        QgsRectangle blockExtent;
+        for ( int row = blockRow; row <= blockEndRow; ++row )
         {
-          if ( ( layer.minZoom() >= 0 && zoomLevel < layer.minZoom() ) ||
-               ( layer.maxZoom() >= 0 && zoomLevel > layer.maxZoom() ) )
-            continue;
-
-          encoder.addLayer( layer.layer(), feedback, layer.filterExpression(), layer.layerName() );
+          for ( int col = blockCol; col <= blockEndCol; ++col )
+          {
+            const QgsTileXYZ tileID( col, row, zoomLevel );
+            const QgsRectangle tileExtent = QgsVectorTileMVTEncoder( tileID ).bufferedTileExtent();
+            tileIDs << tileID;
+            tileExtents << tileExtent;
+            blockExtent.combineExtentWith( tileExtent );
+          }
         }
+        const double bufferSize = ( tileExtents.at( 0 ).width() - tileMatrix.tileExtent( tileIDs.at( 0 ) ).width() ) / 2;
 
-        if ( feedback && feedback->isCanceled() )
+        // features of each tile, per layer
+        QVector< QVector< QVector< QgsFeature > > > tileFeatures( tileIDs.size(), QVector< QVector< QgsFeature > >( static_cast< int >( zoomLayersData.size() ) ) );
+        for ( std::size_t layerIndex = 0; layerIndex < zoomLayersData.size(); ++layerIndex )
         {
-          mErrorMessage = tr( "Operation has been canceled" );
-          return false;
+          const QgsVectorTileWriterLayerData &layerData = zoomLayersData[layerIndex];
+
+          QgsRectangle layerBlockExtent;
+          try
+          {
+            layerBlockExtent = layerData.ct.transformBoundingBox( blockExtent, QgsCoordinateTransform::ReverseTransform );
+          }
+          catch ( const QgsCsException & )
+          {
+            QgsDebugMsg( "Failed to reproject tiles extent to the layer" );
+            continue;
+          }
+
+          QgsFeatureRequest request;
+          request.setFilterRect( layerBlockExtent );
+          if ( !layerData.filterExpression.isEmpty() )
+            request.setFilterExpression( layerData.filterExpression );
+          QgsFeatureIterator fit = layerData.layer->getFeatures( request );
+
+          QgsFeature f;
+          while ( fit.nextFeature( f ) )
+          {
+            if ( feedback && feedback->isCanceled() )
+            {
+              mErrorMessage = tr( "Operation has been canceled" );
+              return false;
+            }
+
+            QgsGeometry g = f.geometry();
+            if ( g.isNull() )
+              continue;
+
+            try
+            {
+              g.transform( layerData.ct );
+            }
+            catch ( const QgsCsException & )
+            {
+              QgsDebugMsg( "Failed to reproject geometry " + QString::number( f.id() ) );
+              continue;
+            }
+            f.setGeometry( g );
+
+            // only check the tiles of the block which may intersect the feature, found from its bounding
+            // box grown by the size of the tiles buffer zone
+            QgsRectangle searchExtent = g.boundingBox();
+            searchExtent.grow( bufferSize );
+            const QgsTileRange featureTileRange = tileMatrix.tileRangeFromExtent( searchExtent );
+            if ( !featureTileRange.isValid() )
+              continue;
+
+            const QgsRectangle featureExtent = g.boundingBox();
+            for ( int row = std::max( blockRow, featureTileRange.startRow() ); row <= std::min( blockEndRow, featureTileRange.endRow() ); ++row )
+            {
+              for ( int col = std::max( blockCol, featureTileRange.startColumn() ); col <= std::min( blockEndCol, featureTileRange.endColumn() ); ++col )
+              {
+                const int tileIndex = ( row - blockRow ) * blockWidth + ( col - blockCol );
+                if ( tileExtents.at( tileIndex ).intersects( featureExtent ) )
+                  tileFeatures[tileIndex][static_cast< int >( layerIndex )] << f;
+              }
+            }
+          }
         }
 
-        QByteArray tileData = encoder.encode();
-
-        ++tilesCreated;
-        if ( feedback )
+        QVector< QFuture< QByteArray > > encodedTiles;
+        encodedTiles.reserve( tileIDs.size() );
+        for ( int i = 0; i < tileIDs.size(); ++i )
         {
-          feedback->setProgress( static_cast<double>( tilesCreated ) / tilesToCreate * 100 );
+          const QgsTileXYZ tileID = tileIDs.at( i );
+          const QVector< QVector< QgsFeature > > features = std::move( tileFeatures[i] );
+          encodedTiles << QtConcurrent::run( &pool, [tileID, &zoomLayersData, features, gzip, feedback]
+          {
+            return encodeTile( tileID, zoomLayersData, features, gzip, feedback );
+          } );
         }
+        tileFeatures.clear();
 
-        if ( tileData.isEmpty() )
-        {
-          // skipping empty tile - no need to write it
-          continue;
-        }
+        if ( mbtiles )
+          mbtiles->beginTransaction();
 
-        if ( sourceType == QLatin1String( "xyz" ) )
+        for ( int i = 0; i < tileIDs.size(); ++i )
         {
-          if ( !writeTileFileXYZ( sourcePath, tileID, tileMatrix, tileData ) )
-            return false;  // error message already set
-        }
-        else  // mbtiles
-        {
-          QByteArray gzipTileData;
-          QgsMbTiles::encodeGzip( tileData, gzipTileData );
-          int rowTMS = pow( 2, tileID.zoomLevel() ) - tileID.row() - 1;
-          mbtiles->setTileData( tileID.zoomLevel(), tileID.column(), rowTMS, gzipTileData );
+          const QByteArray tileData = encodedTiles[i].result();
+
+          if ( feedback && feedback->isCanceled() )
+          {
+            pool.waitForDone();
+            if ( mbtiles )
+              mbtiles->commitTransaction();
+            mErrorMessage = tr( "Operation has been canceled" );
+            return false;
+          }
+
+          ++tilesCreated;
+          if ( feedback )
+          {
+            feedback->setProgress( static_cast<double>( tilesCreated ) / tilesToCreate * 100 );
+          }
+
+          if ( tileData.isEmpty() )
+          {
+            // skipping empty tile - no need to write it
+            continue;
+          }
+
+          const QgsTileXYZ tileID = tileIDs.at( i );
+          if ( sourceType == QLatin1String( "xyz" ) )
+          {
+            if ( !writeTileFileXYZ( sourcePath, tileID, tileMatrix, tileData ) )
+            {
+              pool.waitForDone();
+              return false;  // error message already set
+            }
+          }
+          else  // mbtiles
+          {
+            int rowTMS = pow( 2, tileID.zoomLevel() ) - tileID.row() - 1;
+            mbtiles->setTileData( tileID.zoomLevel(), tileID.column(), rowTMS, tileData );
+          }
         }
+
+        if ( mbtiles )
+          mbtiles->commitTransaction();
       }
     }
   }
@@ -46,6 +46,10 @@ class QgsVectorLayer;
  *
  * Currently the writer only support MVT encoding of data.
  *
+ * Tiles are written in blocks of neighbouring tiles: the features of a block are
+ * read with a single request per layer, and its tiles get encoded in parallel
+ * worker threads (since QGIS 3.22).
+ *
  * Metadata support: it is possible to pass a QVariantMap with metadata. This
  * is backend dependent. Currently only "mbtiles" source type supports writing
  * of metadata. The key-value pairs will be written to the "metadata" table
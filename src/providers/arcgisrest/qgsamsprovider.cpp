@@ -1137,7 +1137,8 @@ void QgsAmsTiledImageDownloadHandler::tileReplyFinished()
     {
       QgsDebugMsg( QStringLiteral( "tile reply: length %1" ).arg( reply->bytesAvailable() ) );
 
-      QImage myLocalImage = QImage::fromData( reply->readAll() );
+      const QByteArray tileData = reply->readAll();
+      QImage myLocalImage = QImage::fromData( tileData );
 
       if ( !myLocalImage.isNull() )
       {
@@ -1149,7 +1150,7 @@ void QgsAmsTiledImageDownloadHandler::tileReplyFinished()
         p.drawImage( r, myLocalImage );
         p.end();
 
-        QgsTileCache::insertTile( reply->url(), myLocalImage );
+        QgsTileCache::insertTileData( reply->url(), tileData, reply->rawHeader( "Cache-Control" ) );
 
         if ( mFeedback )
           mFeedback->onNewData();
@@ -74,12 +74,14 @@ QgsPointCloudAttributeCollection QgsPdalProvider::attributes() const
 
 QVariantList QgsPdalProvider::metadataClasses( const QString &attribute ) const
 {
-  return mIndex->metadataClasses( attribute );
+  const QVariantList classes = mIndex->metadataClasses( attribute );
+  return !classes.isEmpty() ? classes : QgsPointCloudDataProvider::metadataClasses( attribute );
 }
 
 QVariant QgsPdalProvider::metadataClassStatistic( const QString &attribute, const QVariant &value, QgsStatisticalSummary::Statistic statistic ) const
 {
-  return mIndex->metadataClassStatistic( attribute, value, statistic );
+  const QVariant result = mIndex->metadataClassStatistic( attribute, value, statistic );
+  return result.isValid() ? result : QgsPointCloudDataProvider::metadataClassStatistic( attribute, value, statistic );
 }
 
 static QString _outdir( const QString &filename )
@@ -184,10 +186,8 @@ bool QgsPdalProvider::anyIndexingTaskExists()
 
 QVariant QgsPdalProvider::metadataStatistic( const QString &attribute, QgsStatisticalSummary::Statistic statistic ) const
 {
-  if ( mIndex )
-    return mIndex->metadataStatistic( attribute, statistic );
-  else
-    return QVariant();
+  const QVariant result = mIndex ? mIndex->metadataStatistic( attribute, statistic ) : QVariant();
+  return result.isValid() ? result : QgsPointCloudDataProvider::metadataStatistic( attribute, statistic );
 }
 
 qint64 QgsPdalProvider::pointCount() const
@@ -869,12 +869,12 @@ QImage *QgsWmsProvider::draw( QgsRectangle const &viewExtent, int pixelWidth, in
       if ( mbtilesReader && !QgsTileCache::tile( r.url, localImage ) )
       {
         QUrlQuery query( r.url );
-        QImage img = mbtilesReader->tileDataAsImage( query.queryItemValue( "z" ).toInt(),
-                     query.queryItemValue( "x" ).toInt(),
-                     query.queryItemValue( "y" ).toInt() );
-        if ( img.isNull() )
+        const QByteArray tileData = mbtilesReader->tileData( query.queryItemValue( "z" ).toInt(),
+                                    query.queryItemValue( "x" ).toInt(),
+                                    query.queryItemValue( "y" ).toInt() );
+        if ( tileData.isEmpty() )
           continue;
-        QgsTileCache::insertTile( r.url, img );
+        QgsTileCache::insertTileData( r.url, tileData );
       }
 
       if ( QgsTileCache::tile( r.url, localImage ) )
@@ -4395,7 +4395,8 @@ void QgsWmsTiledImageDownloadHandler::tileReplyFinished()
 
       QgsDebugMsgLevel( QStringLiteral( "tile reply: length %1" ).arg( reply->bytesAvailable() ), 2 );
 
-      QImage myLocalImage = QImage::fromData( reply->readAll() );
+      const QByteArray tileData = reply->readAll();
+      QImage myLocalImage = QImage::fromData( tileData );
 
       if ( !myLocalImage.isNull() )
       {
@@ -4416,7 +4417,7 @@ void QgsWmsTiledImageDownloadHandler::tileReplyFinished()
                     .arg( r.width() ).arg( r.height() ) );
 #endif
 
-        QgsTileCache::insertTile( reply->url(), myLocalImage );
+        QgsTileCache::insertTileData( reply->url(), tileData, reply->rawHeader( "Cache-Control" ) );
 
         if ( mFeedback )
           mFeedback->onNewData();
@@ -0,0 +1,181 @@
+/***************************************************************************
+  qgsexpressionbench.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsexpression.h"
+#include "qgsexpressioncontext.h"
+#include "qgsfeature.h"
+#include "qgsfields.h"
+
+#include <QObject>
+#include <QRandomGenerator>
+
+/**
+ * Benchmarks expression evaluation over a set of in-memory features, comparing
+ * the evaluation modes.
+ *
+ * Run e.g. "qgsexpressionbench -median 5" (or with -callgrind for instruction counts).
+ */
+class QgsExpressionBench : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+
+    void initTestCase();
+    void cleanupTestCase();
+    void evaluate_data();
+    void evaluate();
+    void evaluateBatch_data();
+    void evaluateBatch();
+
+  private:
+
+    static QList< QPair< QString, QString > > expressions();
+
+    QgsFields mFields;
+    QVector< QgsFeature > mFeatures;
+};
+
+void QgsExpressionBench::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mFields.append( QgsField( QStringLiteral( "population" ), QVariant::Int ) );
+  mFields.append( QgsField( QStringLiteral( "area" ), QVariant::Double ) );
+  mFields.append( QgsField( QStringLiteral( "height" ), QVariant::Double ) );
+  mFields.append( QgsField( QStringLiteral( "name" ), QVariant::String ) );
+
+  // a fixed seed keeps the runs comparable
+  QRandomGenerator generator( 42 );
+  const int featureCount = 100000;
+  mFeatures.reserve( featureCount );
+  for ( int i = 0; i < featureCount; ++i )
+  {
+    QgsFeature feature( mFields, i );
+    feature.setAttributes( QgsAttributes()
+                           << QVariant( static_cast< int >( generator.bounded( 100000 ) ) )
+                           << QVariant( generator.bounded( 1000.0 ) )
+                           // some NULL values, as found in real world data
+                           << ( i % 10 == 0 ? QVariant( QVariant::Double ) : QVariant( generator.bounded( 50.0 ) ) )
+                           << QVariant( QStringLiteral( "feature %1" ).arg( i ) ) );
+    mFeatures.append( feature );
+  }
+}
+
+void QgsExpressionBench::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void QgsExpressionBench::evaluate_data()
+{
+  QTest::addColumn<QString>( "expression" );
+  QTest::addColumn<int>( "mode" );
+
+  const QList< QPair< QString, QString > > benchExpressions = expressions();
+  for ( const QPair< QString, QString > &expression : benchExpressions )
+  {
+    QTest::newRow( QStringLiteral( "%1 tree" ).arg( expression.first ).toUtf8().constData() ) << expression.second << static_cast< int >( QgsExpression::TreeEvaluation );
+    QTest::newRow( QStringLiteral( "%1 bytecode" ).arg( expression.first ).toUtf8().constData() ) << expression.second << static_cast< int >( QgsExpression::BytecodeEvaluation );
+  }
+}
+
+QList< QPair< QString, QString > > QgsExpressionBench::expressions()
+{
+  return
+  {
+    { QStringLiteral( "density" ), QStringLiteral( "\"population\" / \"area\"" ) },
+    { QStringLiteral( "symbol size" ), QStringLiteral( "sqrt(\"area\") * 0.5 + \"height\" / 10" ) },
+    { QStringLiteral( "filter" ), QStringLiteral( "\"population\" > 5000 AND \"area\" < 500 OR \"height\" IS NULL" ) },
+    { QStringLiteral( "classification" ), QStringLiteral( "CASE WHEN \"population\" / \"area\" > 1000 THEN 3 WHEN \"population\" / \"area\" > 100 THEN 2 ELSE 1 END" ) },
+    { QStringLiteral( "mixed" ), QStringLiteral( "CASE WHEN \"population\" > 50000 THEN upper(\"name\") ELSE \"name\" END" ) },
+  };
+}
+
+void QgsExpressionBench::evaluate()
+{
+  QFETCH( QString, expression );
+  QFETCH( int, mode );
+
+  QgsExpressionContext context;
+  QgsExpressionContextScope *scope = new QgsExpressionContextScope();
+  scope->setFields( mFields );
+  context.appendScope( scope );
+
+  QgsExpression exp( expression );
+  exp.setEvaluationMode( static_cast< QgsExpression::EvaluationMode >( mode ) );
+  QVERIFY( exp.prepare( &context ) );
+
+  double sum = 0;
+  QBENCHMARK
+  {
+    for ( const QgsFeature &feature : std::as_const( mFeatures ) )
+    {
+      context.setFeature( feature );
+      const QVariant res = exp.evaluate( &context );
+      sum += res.toDouble();
+    }
+  }
+  QVERIFY( !exp.hasEvalError() );
+  Q_UNUSED( sum )
+}
+
+void QgsExpressionBench::evaluateBatch_data()
+{
+  QTest::addColumn<QString>( "expression" );
+
+  const QList< QPair< QString, QString > > benchExpressions = expressions();
+  for ( const QPair< QString, QString > &expression : benchExpressions )
+    QTest::newRow( expression.first.toUtf8().constData() ) << expression.second;
+}
+
+void QgsExpressionBench::evaluateBatch()
+{
+  QFETCH( QString, expression );
+
+  QgsExpressionContext context;
+  QgsExpressionContextScope *scope = new QgsExpressionContextScope();
+  scope->setFields( mFields );
+  context.appendScope( scope );
+
+  QgsExpression exp( expression );
+  QVERIFY( exp.prepare( &context ) );
+
+  // blocks of the same size as used by QgsAggregateCalculator
+  const int blockSize = 1024;
+  QList< QgsFeatureList > blocks;
+  for ( int i = 0; i < mFeatures.size(); i += blockSize )
+    blocks << mFeatures.mid( i, blockSize ).toList();
+
+  double sum = 0;
+  QBENCHMARK
+  {
+    for ( const QgsFeatureList &block : std::as_const( blocks ) )
+    {
+      const QVariantList res = exp.evaluateBatch( block, &context );
+      for ( const QVariant &value : res )
+        sum += value.toDouble();
+    }
+  }
+  QVERIFY( !exp.hasEvalError() );
+  Q_UNUSED( sum )
+}
+
+QGSTEST_MAIN( QgsExpressionBench )
+#include "qgsexpressionbench.moc"
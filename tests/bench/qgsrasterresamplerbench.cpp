@@ -0,0 +1,132 @@
+/***************************************************************************
+  qgsrasterresamplerbench.cpp
+  --------------------------------------
+  Date                 : October 2021
+  Copyright            : (C) 2021 by Nyall Dawson
+  Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsbilinearrasterresampler.h"
+#include "qgsconvolutionimageresampler.h"
+#include "qgsgdalutils.h"
+
+#include <QImage>
+#include <QObject>
+#include <QRandomGenerator>
+
+/**
+ * Benchmarks the cubic resampling of rendered raster images, comparing GDAL
+ * RasterIO with the scalar and AVX convolution implementations.
+ *
+ * Run e.g. "qgsrasterresamplerbench -median 5" (or with -callgrind for instruction counts).
+ */
+class QgsRasterResamplerBench : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+
+    void initTestCase();
+    void cleanupTestCase();
+    void cubic_data();
+    void cubic();
+    void bilinear_data();
+    void bilinear();
+
+  private:
+
+    QImage mImage;
+};
+
+void QgsRasterResamplerBench::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  // a fixed seed keeps the runs comparable
+  QRandomGenerator generator( 42 );
+  mImage = QImage( 1024, 768, QImage::Format_ARGB32_Premultiplied );
+  for ( int y = 0; y < mImage.height(); ++y )
+  {
+    QRgb *line = reinterpret_cast< QRgb * >( mImage.scanLine( y ) );
+    for ( int x = 0; x < mImage.width(); ++x )
+      line[x] = qPremultiply( generator.generate() );
+  }
+}
+
+void QgsRasterResamplerBench::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void QgsRasterResamplerBench::cubic_data()
+{
+  QTest::addColumn<QSize>( "size" );
+  QTest::addColumn<int>( "implementation" );
+
+  const QList< QPair< QString, QSize > > sizes
+  {
+    { QStringLiteral( "zoom out" ), QSize( 400, 300 ) },
+    { QStringLiteral( "zoom in" ), QSize( 2048, 1536 ) },
+  };
+  for ( const QPair< QString, QSize > &size : sizes )
+  {
+    // -1 stands for GDAL RasterIO
+    QTest::newRow( QStringLiteral( "%1 gdal" ).arg( size.first ).toUtf8().constData() ) << size.second << -1;
+    QTest::newRow( QStringLiteral( "%1 scalar" ).arg( size.first ).toUtf8().constData() ) << size.second << static_cast< int >( QgsConvolutionImageResampler::Implementation::Scalar );
+    QTest::newRow( QStringLiteral( "%1 avx" ).arg( size.first ).toUtf8().constData() ) << size.second << static_cast< int >( QgsConvolutionImageResampler::Implementation::Avx );
+  }
+}
+
+void QgsRasterResamplerBench::cubic()
+{
+  QFETCH( QSize, size );
+  QFETCH( int, implementation );
+
+  if ( implementation >= 0 && !QgsConvolutionImageResampler::isAvailable( static_cast< QgsConvolutionImageResampler::Implementation >( implementation ) ) )
+    QSKIP( "Implementation not supported by this CPU" );
+
+  QImage result;
+  QBENCHMARK
+  {
+    if ( implementation < 0 )
+      result = QgsGdalUtils::resampleImage( mImage, size, GRIORA_Cubic );
+    else
+      result = QgsConvolutionImageResampler::resampleCubic( mImage, size, static_cast< QgsConvolutionImageResampler::Implementation >( implementation ) );
+  }
+  QCOMPARE( result.size(), size );
+}
+
+void QgsRasterResamplerBench::bilinear_data()
+{
+  QTest::addColumn<QSize>( "size" );
+
+  QTest::newRow( "zoom out" ) << QSize( 400, 300 );
+  QTest::newRow( "zoom in" ) << QSize( 2048, 1536 );
+}
+
+void QgsRasterResamplerBench::bilinear()
+{
+  QFETCH( QSize, size );
+
+  QgsBilinearRasterResampler resampler;
+  QImage result;
+  QBENCHMARK
+  {
+    result = resampler.resampleV2( mImage, size );
+  }
+  QCOMPARE( result.size(), size );
+}
+
+QGSTEST_MAIN( QgsRasterResamplerBench )
+#include "qgsrasterresamplerbench.moc"
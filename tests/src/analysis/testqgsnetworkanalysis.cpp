@@ -25,6 +25,9 @@ Email                : nyall dot dawson at gmail dot com
 #include "qgsgraphbuilder.h"
 #include "qgsgraph.h"
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
+#include "qgscontractionhierarchy.h"
+#include <QTemporaryDir>
 
 class TestQgsNetworkAnalysis : public QObject
 {
@@ -43,6 +46,7 @@ class TestQgsNetworkAnalysis : public QObject
     void dijkkjkjkskkjsktra();
     void testRouteFail();
     void testRouteFail2();
+    void compactGraphShortestPath();
 
   private:
     std::unique_ptr< QgsVectorLayer > buildNetwork();
@@ -576,6 +580,124 @@ void TestQgsNetworkAnalysis::testRouteFail2()
 }
 
 
+void TestQgsNetworkAnalysis::compactGraphShortestPath()
+{
+  // a grid with edges in both directions, with pseudo random costs which are never lower than the edge length
+  const int size = 15;
+  QgsGraph graph;
+  for ( int i = 0; i < size; ++i )
+  {
+    for ( int j = 0; j < size; ++j )
+      graph.addVertex( QgsPointXY( i, j ) );
+  }
+  quint32 seed = 1;
+  auto addEdges = [&graph, &seed]( int from, int to )
+  {
+    seed = seed * 1664525u + 1013904223u;
+    graph.addEdge( from, to, QVector< QVariant >() << 1.0 + ( ( seed >> 16 ) % 100 ) / 10.0 );
+    seed = seed * 1664525u + 1013904223u;
+    graph.addEdge( to, from, QVector< QVariant >() << 1.0 + ( ( seed >> 16 ) % 100 ) / 10.0 );
+  };
+  for ( int i = 0; i < size; ++i )
+  {
+    for ( int j = 0; j < size; ++j )
+    {
+      if ( i + 1 < size )
+        addEdges( i * size + j, ( i + 1 ) * size + j );
+      if ( j + 1 < size )
+        addEdges( i * size + j, i * size + j + 1 );
+    }
+  }
+  // an isolated vertex
+  const int isolated = graph.addVertex( QgsPointXY( 100, 100 ) );
+
+  const QgsCompactGraph compactGraph( &graph, 0 );
+  QCOMPARE( compactGraph.vertexCount(), graph.vertexCount() );
+  QCOMPARE( compactGraph.edgeCount(), graph.edgeCount() );
+  QVERIFY( compactGraph.costLowerBound( 0, 1 ) >= 1.0 );
+
+  const QgsContractionHierarchy hierarchy( compactGraph );
+  QVERIFY( hierarchy.isValid() );
+  QVERIFY( hierarchy.isValidForGraph( compactGraph ) );
+
+  const QTemporaryDir dir;
+  const QString path = dir.filePath( QStringLiteral( "hierarchy.qch" ) );
+  QVERIFY( hierarchy.writeToFile( path ) );
+  QgsContractionHierarchy readHierarchy;
+  QVERIFY( readHierarchy.readFromFile( path, compactGraph ) );
+  QCOMPARE( readHierarchy.shortcutCount(), hierarchy.shortcutCount() );
+  // a hierarchy can't be read for another graph
+  QgsGraph otherGraph = graph;
+  otherGraph.addEdge( 0, isolated, QVector< QVariant >() << 1 );
+  QgsContractionHierarchy otherHierarchy;
+  QVERIFY( !otherHierarchy.readFromFile( path, QgsCompactGraph( &otherGraph, 0 ) ) );
+  QVERIFY( !otherHierarchy.isValid() );
+  // a hierarchy built for another graph must not be used for searches
+  const QgsCompactGraph otherCompactGraph( &otherGraph, 0 );
+  const QgsContractionHierarchy builtOtherHierarchy( otherCompactGraph );
+  QVERIFY( builtOtherHierarchy.isValid() );
+  QVERIFY( !builtOtherHierarchy.isValidForGraph( compactGraph ) );
+
+  auto checkPath = [&]( int start, int end, const QVector< int > &path, double expectedCost )
+  {
+    double cost = 0;
+    int vertex = start;
+    for ( int edge : path )
+    {
+      QCOMPARE( compactGraph.edgeSource( edge ), vertex );
+      vertex = compactGraph.edgeTarget( edge );
+      cost += compactGraph.edgeCost( edge );
+    }
+    QCOMPARE( vertex, end );
+    QGSCOMPARENEAR( cost, expectedCost, 1e-9 );
+  };
+
+  for ( int start = 0; start < size * size; start += 17 )
+  {
+    QVector< int > tree;
+    QVector< double > costs;
+    QgsGraphAnalyzer::dijkstra( &graph, start, 0, &tree, &costs );
+
+    // same results from the compact graph
+    QVector< int > compactTree;
+    QVector< double > compactCosts;
+    QgsGraphAnalyzer::dijkstra( &compactGraph, start, &compactTree, &compactCosts );
+    QCOMPARE( compactCosts, costs );
+
+    for ( int end = 0; end < size * size; end += 7 )
+    {
+      QVector< int > path;
+      QGSCOMPARENEAR( QgsGraphAnalyzer::shortestPath( &compactGraph, start, end, &path ), costs.at( end ), 1e-9 );
+      checkPath( start, end, path, costs.at( end ) );
+
+      QGSCOMPARENEAR( QgsGraphAnalyzer::shortestPath( &compactGraph, start, end, &path, &hierarchy ), costs.at( end ), 1e-9 );
+      checkPath( start, end, path, costs.at( end ) );
+
+      QGSCOMPARENEAR( QgsGraphAnalyzer::shortestPath( &compactGraph, start, end, &path, &readHierarchy ), costs.at( end ), 1e-9 );
+      checkPath( start, end, path, costs.at( end ) );
+
+      // reversed search from the end vertex
+      QVector< int > reverseTree;
+      QVector< double > reverseCosts;
+      QgsGraphAnalyzer::dijkstra( &compactGraph, end, &reverseTree, &reverseCosts, true );
+      QGSCOMPARENEAR( reverseCosts.at( start ), costs.at( end ), 1e-9 );
+      path.clear();
+      for ( int vertex = start; vertex != end; vertex = compactGraph.edgeTarget( reverseTree.at( vertex ) ) )
+        path.append( reverseTree.at( vertex ) );
+      checkPath( start, end, path, costs.at( end ) );
+    }
+
+    QVector< int > path;
+    QVERIFY( std::isinf( QgsGraphAnalyzer::shortestPath( &compactGraph, start, isolated, &path ) ) );
+    QVERIFY( path.isEmpty() );
+    QVERIFY( std::isinf( QgsGraphAnalyzer::shortestPath( &compactGraph, start, isolated, &path, &hierarchy ) ) );
+    QVERIFY( path.isEmpty() );
+    // the other graph connects the isolated vertex, which must not affect searches in this graph
+    QVERIFY( std::isinf( QgsGraphAnalyzer::shortestPath( &compactGraph, start, isolated, &path, &builtOtherHierarchy ) ) );
+    QVERIFY( path.isEmpty() );
+  }
+}
+
 
 QGSTEST_MAIN( TestQgsNetworkAnalysis )
 #include "testqgsnetworkanalysis.moc"
@@ -22,12 +22,17 @@
 #include "qgstotalcurvaturefilter.h"
 #include "qgsapplication.h"
 #include "qgssettings.h"
+#include "qgsogrutils.h"
 
 #ifdef HAVE_OPENCL
 #include "qgsopenclutils.h"
 #endif
 
 #include <QDir>
+#include <QTemporaryDir>
+
+#include <cmath>
+#include <vector>
 
 // If true regenerate raster reference images
 const bool REGENERATE_REFERENCES = false;
@@ -47,6 +52,8 @@ class TestNineCellFilters : public QObject
     void testAspect();
     void testRuggedness();
     void testTotalCurvature();
+    void testSlopeStripes();
+    void testHillshadeStripes();
 #ifdef HAVE_OPENCL
     void testHillshadeCl();
     void testSlopeCl();
@@ -60,6 +67,8 @@ class TestNineCellFilters : public QObject
 
     template <class T> void _testAlg( const QString &name, bool useOpenCl = false );
 
+    template <class T> void _testStripes( const QString &name );
+
     static QString referenceFile( const QString &name )
     {
       return QStringLiteral( "%1/analysis/%2.tif" ).arg( TEST_DATA_DIR, name );
@@ -215,6 +224,96 @@ void TestNineCellFilters::testTotalCurvature()
   _testAlg<QgsTotalCurvatureFilter>( QStringLiteral( "totalcurvature" ) );
 }
 
+template <class T>
+void TestNineCellFilters::_testStripes( const QString &name )
+{
+#ifdef HAVE_OPENCL
+  QgsOpenClUtils::setEnabled( false );
+#endif
+
+  // the CPU route processes stripes of about a million cells: with 2048 columns a stripe has
+  // 512 rows, so this raster is split into two full stripes and a partial one
+  const int xSize = 2048;
+  const int ySize = 1100;
+  const float nodata = -9999;
+
+  QTemporaryDir dir;
+  const QString inputFile = dir.filePath( name + QStringLiteral( "_input.tif" ) );
+  const QString outputFile = dir.filePath( name + QStringLiteral( "_output.tif" ) );
+  {
+    gdal::dataset_unique_ptr input( GDALCreate( GDALGetDriverByName( "GTiff" ), inputFile.toUtf8().constData(), xSize, ySize, 1, GDT_Float32, nullptr ) );
+    QVERIFY( input );
+    double geoTransform[6] = { 500000, 10, 0, 4000000, 0, -10 };
+    GDALSetGeoTransform( input.get(), geoTransform );
+    GDALRasterBandH band = GDALGetRasterBand( input.get(), 1 );
+    GDALSetRasterNoDataValue( band, nodata );
+
+    // a smooth surface with some nodata cells, including on the rows next to the stripe boundaries
+    std::vector< float > row( xSize );
+    for ( int y = 0; y < ySize; ++y )
+    {
+      for ( int x = 0; x < xSize; ++x )
+        row[x] = ( x * 7 + y * 13 ) % 101 == 0 ? nodata : static_cast< float >( 200 + 50 * std::sin( x / 40.0 ) * std::cos( y / 30.0 ) + 0.01 * x * y / 100.0 );
+      QCOMPARE( GDALRasterIO( band, GF_Write, 0, y, xSize, 1, row.data(), xSize, 1, GDT_Float32, 0, 0 ), CE_None );
+    }
+  }
+
+  T filter( inputFile, outputFile, QStringLiteral( "GTiff" ) );
+  QCOMPARE( filter.processRaster(), 0 );
+
+  gdal::dataset_unique_ptr input( GDALOpen( inputFile.toUtf8().constData(), GA_ReadOnly ) );
+  gdal::dataset_unique_ptr output( GDALOpen( outputFile.toUtf8().constData(), GA_ReadOnly ) );
+  QVERIFY( input );
+  QVERIFY( output );
+  GDALRasterBandH inputBand = GDALGetRasterBand( input.get(), 1 );
+  GDALRasterBandH outputBand = GDALGetRasterBand( output.get(), 1 );
+
+  // compute the expected output with a sliding window of three scanlines, as the filter used to,
+  // with (input) nodata values outside the raster
+  const std::size_t lineSize = xSize + 2;
+  std::vector< float > scanLines( 3 * lineSize, static_cast< float >( filter.inputNodataValue() ) );
+  auto readLine = [&]( int y, float * line )
+  {
+    std::fill( line, line + lineSize, static_cast< float >( filter.inputNodataValue() ) );
+    if ( y >= 0 && y < ySize )
+      QCOMPARE( GDALRasterIO( inputBand, GF_Read, 0, y, xSize, 1, line + 1, xSize, 1, GDT_Float32, 0, 0 ), CE_None );
+  };
+
+  std::vector< float > expectedLine( xSize );
+  std::vector< float > outputLine( xSize );
+  int differentRows = 0;
+  for ( int y = 0; y < ySize; ++y )
+  {
+    float *scanLine1 = scanLines.data();
+    float *scanLine2 = scanLine1 + lineSize;
+    float *scanLine3 = scanLine2 + lineSize;
+    readLine( y - 1, scanLine1 );
+    readLine( y, scanLine2 );
+    readLine( y + 1, scanLine3 );
+    for ( int x = 0; x < xSize; ++x )
+    {
+      expectedLine[x] = filter.processNineCellWindow( &scanLine1[x], &scanLine1[x + 1], &scanLine1[x + 2],
+                        &scanLine2[x], &scanLine2[x + 1], &scanLine2[x + 2],
+                        &scanLine3[x], &scanLine3[x + 1], &scanLine3[x + 2] );
+    }
+
+    QCOMPARE( GDALRasterIO( outputBand, GF_Read, 0, y, xSize, 1, outputLine.data(), xSize, 1, GDT_Float32, 0, 0 ), CE_None );
+    if ( outputLine != expectedLine )
+      differentRows++;
+  }
+  QCOMPARE( differentRows, 0 );
+}
+
+void TestNineCellFilters::testSlopeStripes()
+{
+  _testStripes<QgsSlopeFilter>( QStringLiteral( "slope" ) );
+}
+
+void TestNineCellFilters::testHillshadeStripes()
+{
+  _testStripes<QgsHillshadeFilter>( QStringLiteral( "hillshade" ) );
+}
+
 
 QGSTEST_MAIN( TestNineCellFilters )
 
@@ -60,6 +60,10 @@
 #include "qgsmeshlayer.h"
 #include "qgsmarkersymbol.h"
 #include "qgsfillsymbol.h"
+#include "qgsexception.h"
+
+#include <QThreadPool>
+#include <stdexcept>
 
 class TestQgsProcessingAlgs: public QObject
 {
@@ -90,6 +94,8 @@ class TestQgsProcessingAlgs: public QObject
     void parseGeoTags();
     void featureFilterAlg();
     void transformAlg();
+    void parallelFeatureProcessing();
+    void parallelFeatureProcessingException();
     void kmeansCluster();
     void categorizeByStyle();
     void extractBinary();
@@ -1020,6 +1026,92 @@ void TestQgsProcessingAlgs::transformAlg()
   QVERIFY( ok );
 }
 
+void TestQgsProcessingAlgs::parallelFeatureProcessing()
+{
+  std::unique_ptr< QgsProcessingAlgorithm > alg( QgsApplication::processingRegistry()->createAlgorithmById( QStringLiteral( "native:multiparttosingleparts" ) ) );
+  QVERIFY( alg != nullptr );
+  QVERIFY( alg->flags() & QgsProcessingAlgorithm::FlagSupportsParallelFeatureProcessing );
+
+  std::unique_ptr< QgsProcessingContext > context = std::make_unique< QgsProcessingContext >();
+  QgsProject p;
+  context->setProject( &p );
+
+  QgsProcessingFeedback feedback;
+
+  // enough features to fill several batches of blocks
+  QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "MultiPoint?crs=EPSG:4326&field=col1:integer" ), QStringLiteral( "test" ), QStringLiteral( "memory" ) );
+  QVERIFY( layer->isValid() );
+  QgsFeatureList features;
+  for ( int i = 0; i < 5000; ++i )
+  {
+    QgsFeature f;
+    f.setAttributes( QgsAttributes() << i );
+    f.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "MultiPoint ((%1 1), (%1 2))" ).arg( i ) ) );
+    features << f;
+  }
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+  p.addMapLayer( layer );
+
+  QVariantMap parameters;
+  parameters.insert( QStringLiteral( "INPUT" ), QStringLiteral( "test" ) );
+  parameters.insert( QStringLiteral( "OUTPUT" ), QStringLiteral( "memory:" ) );
+  bool ok = false;
+  QVariantMap results = alg->run( parameters, *context, &feedback, &ok );
+  QVERIFY( ok );
+
+  QgsVectorLayer *outputLayer = qobject_cast< QgsVectorLayer * >( context->getMapLayer( results.value( QStringLiteral( "OUTPUT" ) ).toString() ) );
+  QVERIFY( outputLayer );
+  QCOMPARE( outputLayer->featureCount(), 10000LL );
+
+  // output features must be in the same order as the input features
+  QgsFeatureIterator it = outputLayer->getFeatures();
+  QgsFeature f;
+  int i = 0;
+  while ( it.nextFeature( f ) )
+  {
+    QCOMPARE( f.attribute( 0 ).toInt(), i / 2 );
+    QCOMPARE( f.geometry().asWkt(), QStringLiteral( "Point (%1 %2)" ).arg( i / 2 ).arg( i % 2 + 1 ) );
+    i++;
+  }
+  QCOMPARE( i, 10000 );
+
+  // another algorithm flagged for parallel processing
+  alg.reset( QgsApplication::processingRegistry()->createAlgorithmById( QStringLiteral( "native:swapxy" ) ) );
+  QVERIFY( alg != nullptr );
+  QVERIFY( alg->flags() & QgsProcessingAlgorithm::FlagSupportsParallelFeatureProcessing );
+
+  QgsVectorLayer *pointLayer = new QgsVectorLayer( QStringLiteral( "Point?crs=EPSG:4326&field=col1:integer" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) );
+  QVERIFY( pointLayer->isValid() );
+  features.clear();
+  for ( int j = 0; j < 5000; ++j )
+  {
+    QgsFeature pointFeature;
+    pointFeature.setAttributes( QgsAttributes() << j );
+    pointFeature.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( j + 0.5, j ) ) );
+    features << pointFeature;
+  }
+  QVERIFY( pointLayer->dataProvider()->addFeatures( features ) );
+  p.addMapLayer( pointLayer );
+
+  parameters.insert( QStringLiteral( "INPUT" ), QStringLiteral( "points" ) );
+  results = alg->run( parameters, *context, &feedback, &ok );
+  QVERIFY( ok );
+
+  outputLayer = qobject_cast< QgsVectorLayer * >( context->getMapLayer( results.value( QStringLiteral( "OUTPUT" ) ).toString() ) );
+  QVERIFY( outputLayer );
+  QCOMPARE( outputLayer->featureCount(), 5000LL );
+
+  it = outputLayer->getFeatures();
+  i = 0;
+  while ( it.nextFeature( f ) )
+  {
+    QCOMPARE( f.attribute( 0 ).toInt(), i );
+    QCOMPARE( f.geometry().asWkt(), QStringLiteral( "Point (%1 %1.5)" ).arg( i ) );
+    i++;
+  }
+  QCOMPARE( i, 5000 );
+}
+
 void TestQgsProcessingAlgs::kmeansCluster()
 {
   // make some features
@@ -5030,6 +5122,79 @@ void TestQgsProcessingAlgs::raiseException()
   QCOMPARE( feedback.errors, QStringList() << QStringLiteral( "you done screwed up boy" ) );
 }
 
+//! Feature based algorithm raising an exception for one feature, from the parallel processing workers
+class TestThrowingFeatureAlgorithm : public QgsProcessingFeatureBasedAlgorithm
+{
+  public:
+
+    explicit TestThrowingFeatureAlgorithm( bool throwCsException )
+      : mThrowCsException( throwCsException )
+    {}
+
+    QString name() const override { return QStringLiteral( "throwingfeature" ); }
+    QString displayName() const override { return QStringLiteral( "Throwing feature" ); }
+    QString outputName() const override { return QStringLiteral( "Output" ); }
+    Flags flags() const override { return QgsProcessingFeatureBasedAlgorithm::flags() | FlagSupportsParallelFeatureProcessing; }
+    TestThrowingFeatureAlgorithm *createInstance() const override { return new TestThrowingFeatureAlgorithm( mThrowCsException ); }
+
+    QgsFeatureList processFeature( const QgsFeature &feature, QgsProcessingContext &, QgsProcessingFeedback * ) override
+    {
+      if ( feature.attribute( 0 ).toInt() == 3000 )
+      {
+        if ( mThrowCsException )
+          throw QgsCsException( QStringLiteral( "could not transform feature" ) );
+        else
+          throw std::runtime_error( "invalid feature" );
+      }
+      return QgsFeatureList() << feature;
+    }
+
+  private:
+
+    bool mThrowCsException = false;
+};
+
+void TestQgsProcessingAlgs::parallelFeatureProcessingException()
+{
+  // make sure the features are processed in parallel
+  const int maxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 4 );
+
+  std::unique_ptr< QgsProcessingContext > context = std::make_unique< QgsProcessingContext >();
+  QgsProject p;
+  context->setProject( &p );
+
+  QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "Point?crs=EPSG:4326&field=col1:integer" ), QStringLiteral( "test" ), QStringLiteral( "memory" ) );
+  QVERIFY( layer->isValid() );
+  QgsFeatureList features;
+  for ( int i = 0; i < 5000; ++i )
+  {
+    QgsFeature f;
+    f.setAttributes( QgsAttributes() << i );
+    f.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "Point (%1 1)" ).arg( i ) ) );
+    features << f;
+  }
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+  p.addMapLayer( layer );
+
+  QVariantMap parameters;
+  parameters.insert( QStringLiteral( "INPUT" ), QStringLiteral( "test" ) );
+  parameters.insert( QStringLiteral( "OUTPUT" ), QStringLiteral( "memory:" ) );
+
+  // exceptions other than QgsProcessingException must not escape the worker threads
+  for ( bool throwCsException : { true, false } )
+  {
+    TestThrowingFeatureAlgorithm alg( throwCsException );
+    TestProcessingFeedback feedback;
+    bool ok = true;
+    alg.run( parameters, *context, &feedback, &ok );
+    QVERIFY( !ok );
+    QCOMPARE( feedback.errors, QStringList() << ( throwCsException ? QStringLiteral( "could not transform feature" ) : QStringLiteral( "invalid feature" ) ) );
+  }
+
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreadCount );
+}
+
 void TestQgsProcessingAlgs::raiseWarning()
 {
   TestProcessingFeedback feedback;
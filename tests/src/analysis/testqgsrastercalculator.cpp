@@ -19,6 +19,7 @@ Email                : nyall dot dawson at gmail dot com
 #endif
 
 #include "qgsrastercalculator.h"
+#include "qgsrastercalckernel.h"
 #include "qgsrastercalcnode.h"
 #include "qgsrasterdataprovider.h"
 #include "qgsrasterlayer.h"
@@ -54,6 +55,8 @@ class TestQgsRasterCalculator : public QObject
 
     void rasterRefOp();
     void dualOpRasterRaster(); //test dual op on raster ref and raster ref
+    void kernel_data();
+    void kernel(); //test compiled kernels give the same results as the calculation nodes
 
     void calcWithLayers();
     void calcWithReprojectedLayers();
@@ -434,6 +437,73 @@ void TestQgsRasterCalculator::dualOpRasterRaster()
   QCOMPARE( result.data()[5], -9999.0 );
 }
 
+void TestQgsRasterCalculator::kernel_data()
+{
+  QTest::addColumn< QString >( "formula" );
+
+  QTest::newRow( "plus" ) << QStringLiteral( "\"raster1\" + \"raster2\"" );
+  QTest::newRow( "ndvi" ) << QStringLiteral( "( \"raster2\" - \"raster1\" ) / ( \"raster2\" + \"raster1\" )" );
+  QTest::newRow( "division by zero" ) << QStringLiteral( "\"raster1\" / ( \"raster2\" - 13 )" );
+  QTest::newRow( "numbers" ) << QStringLiteral( "2 * \"raster1\" ^ 2 + 1" );
+  QTest::newRow( "comparison" ) << QStringLiteral( "( \"raster1\" > 1 ) AND ( \"raster2\" < 14 )" );
+  QTest::newRow( "functions" ) << QStringLiteral( "sqrt( \"raster1\" ) + log10( \"raster2\" ) - abs( \"raster1\" )" );
+  QTest::newRow( "min max" ) << QStringLiteral( "max( \"raster1\", \"raster2\" ) - min( \"raster1\", 3 )" );
+  QTest::newRow( "sign" ) << QStringLiteral( "-\"raster1\"" );
+}
+
+void TestQgsRasterCalculator::kernel()
+{
+  QFETCH( QString, formula );
+
+  QgsRasterBlock m1( Qgis::DataType::Float32, 2, 3 );
+  m1.setNoDataValue( -1.0 );
+  m1.setValue( 0, 0, 1.0 );
+  m1.setValue( 0, 1, 2.0 );
+  m1.setValue( 1, 0, -2.0 );
+  m1.setValue( 1, 1, -1.0 ); //nodata
+  m1.setValue( 2, 0, 5.0 );
+  m1.setValue( 2, 1, 4.0 );
+
+  QgsRasterBlock m2( Qgis::DataType::Int16, 2, 3 );
+  m2.setNoDataValue( -2.0 ); //different no data value
+  m2.setValue( 0, 0, 3.0 );
+  m2.setValue( 0, 1, -2.0 ); //nodata
+  m2.setValue( 1, 0, 13.0 );
+  m2.setValue( 1, 1, 7.0 );
+  m2.setValue( 2, 0, 15.0 );
+  m2.setValue( 2, 1, 13.0 );
+
+  QMap<QString, QgsRasterBlock *> rasterData;
+  rasterData.insert( QStringLiteral( "raster1" ), &m1 );
+  rasterData.insert( QStringLiteral( "raster2" ), &m2 );
+
+  QString errorString;
+  std::unique_ptr< QgsRasterCalcNode > node( QgsRasterCalcNode::parseRasterCalcString( formula, errorString ) );
+  QVERIFY( node );
+
+  const float nodata = -FLT_MAX;
+  const QgsRasterCalcKernel kernel( node.get() );
+  QVERIFY( kernel.isValid() );
+  QVector< const QgsRasterBlock * > inputs;
+  const QStringList references = kernel.rasterReferences();
+  for ( const QString &reference : references )
+    inputs << rasterData.value( reference );
+
+  float result[6];
+  kernel.evaluate( inputs, 0, 6, result, nodata );
+
+  // compare with the row by row calculation
+  for ( int row = 0; row < 3; ++row )
+  {
+    QgsRasterMatrix expected( 2, 1, nullptr, nodata );
+    QVERIFY( node->calculate( rasterData, expected, row ) );
+    for ( int col = 0; col < 2; ++col )
+    {
+      QCOMPARE( result[row * 2 + col], static_cast< float >( expected.data()[col] ) );
+    }
+  }
+}
+
 void TestQgsRasterCalculator::calcWithLayers()
 {
   QgsRasterCalculatorEntry entry1;
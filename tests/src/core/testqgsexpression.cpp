@@ -4526,6 +4526,238 @@ class TestQgsExpression: public QObject
       QCOMPARE( QgsExpressionUtils::toLocalizedString( QString( "hello world" ) ), QStringLiteral( "hello world" ) );
     }
 
+    void testBytecodeEvaluation_data()
+    {
+      QTest::addColumn<QString>( "expression" );
+
+      QTest::newRow( "int arithmetic" ) << QStringLiteral( "\"int_field\" * 2 + 3 - \"long_field\"" );
+      QTest::newRow( "double arithmetic" ) << QStringLiteral( "\"double_field\" * 2.5 / \"int_field\"" );
+      QTest::newRow( "int division" ) << QStringLiteral( "\"int_field\" / 2" );
+      QTest::newRow( "division by zero" ) << QStringLiteral( "\"double_field\" / (\"int_field\" - \"int_field\")" );
+      QTest::newRow( "integer division" ) << QStringLiteral( "\"double_field\" // \"int_field\"" );
+      QTest::newRow( "modulo" ) << QStringLiteral( "\"long_field\" % \"int_field\"" );
+      QTest::newRow( "double modulo" ) << QStringLiteral( "\"double_field\" % 3" );
+      QTest::newRow( "power" ) << QStringLiteral( "\"int_field\" ^ 2" );
+      QTest::newRow( "negate" ) << QStringLiteral( "-\"int_field\" + -\"double_field\"" );
+      QTest::newRow( "negate null" ) << QStringLiteral( "-\"null_field\"" );
+      QTest::newRow( "comparison" ) << QStringLiteral( "\"int_field\" > 2" );
+      QTest::newRow( "equality" ) << QStringLiteral( "\"double_field\" = \"int_field\" * 1.5" );
+      QTest::newRow( "is null" ) << QStringLiteral( "\"null_field\" IS NULL" );
+      QTest::newRow( "is not" ) << QStringLiteral( "\"int_field\" IS NOT \"double_field\"" );
+      QTest::newRow( "logic" ) << QStringLiteral( "\"int_field\" > 1 AND (\"double_field\" < 4 OR \"null_field\" > 2)" );
+      QTest::newRow( "not" ) << QStringLiteral( "NOT (\"int_field\" > 1)" );
+      QTest::newRow( "case" ) << QStringLiteral( "CASE WHEN \"int_field\" > 2 THEN \"double_field\" WHEN \"int_field\" = 1 THEN \"int_field\" ELSE 7 END" );
+      QTest::newRow( "case without else" ) << QStringLiteral( "CASE WHEN \"int_field\" > 2 THEN \"double_field\" * 2 END" );
+      QTest::newRow( "math functions" ) << QStringLiteral( "sqrt(\"int_field\") + abs(-\"double_field\") + floor(\"double_field\") + ceil(\"double_field\")" );
+      QTest::newRow( "log" ) << QStringLiteral( "ln(\"int_field\" - 2) + log10(\"double_field\")" );
+      QTest::newRow( "function null" ) << QStringLiteral( "sqrt(\"null_field\")" );
+      QTest::newRow( "string fallback" ) << QStringLiteral( "\"string_field\" || 'x'" );
+      QTest::newRow( "mixed fallback" ) << QStringLiteral( "length(\"string_field\") * \"int_field\" > 3 AND \"string_field\" LIKE 'a%'" );
+      QTest::newRow( "string field in case" ) << QStringLiteral( "CASE WHEN \"int_field\" > 2 THEN \"string_field\" ELSE 'small' END" );
+      QTest::newRow( "string comparison" ) << QStringLiteral( "\"string_field\" = 'abc'" );
+      QTest::newRow( "string logic" ) << QStringLiteral( "\"string_field\" AND \"int_field\"" );
+      QTest::newRow( "eval error" ) << QStringLiteral( "\"int_field\" + to_int('a') > 1" );
+      QTest::newRow( "variables" ) << QStringLiteral( "@my_var * \"int_field\"" );
+      QTest::newRow( "missing field" ) << QStringLiteral( "\"xxxxx\" + 1" );
+    }
+
+    void testBytecodeEvaluation()
+    {
+      QFETCH( QString, expression );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "int_field" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "double_field" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "long_field" ), QVariant::LongLong ) );
+      fields.append( QgsField( QStringLiteral( "null_field" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "string_field" ), QVariant::String ) );
+
+      QList< QgsAttributes > attributes;
+      attributes << ( QgsAttributes() << 1 << 1.5 << QVariant( qlonglong( 10 ) ) << QVariant( QVariant::Int ) << QStringLiteral( "abc" ) );
+      attributes << ( QgsAttributes() << 3 << 4.75 << QVariant( qlonglong( -7 ) ) << 5 << QStringLiteral( "xyz" ) );
+      attributes << ( QgsAttributes() << 0 << -2.0 << QVariant( qlonglong( 0 ) ) << QVariant() << QVariant( QVariant::String ) );
+      attributes << ( QgsAttributes() << QVariant( QVariant::Int ) << QVariant( QVariant::Double ) << QVariant( QVariant::LongLong ) << QVariant( QVariant::Int ) << QStringLiteral( "1" ) );
+      // unexpected attribute types must be handled too
+      attributes << ( QgsAttributes() << QStringLiteral( "5" ) << 2.5 << QVariant( qlonglong( 1 ) ) << 0 << QString() );
+
+      QgsExpressionContext context;
+      QgsExpressionContextScope *scope = new QgsExpressionContextScope();
+      scope->setFields( fields );
+      scope->setVariable( QStringLiteral( "my_var" ), 3 );
+      context.appendScope( scope );
+
+      QgsExpression treeExpression( expression );
+      QVERIFY( !treeExpression.hasParserError() );
+      QCOMPARE( treeExpression.evaluationMode(), QgsExpression::TreeEvaluation );
+      treeExpression.prepare( &context );
+
+      QgsExpression bytecodeExpression( expression );
+      bytecodeExpression.setEvaluationMode( QgsExpression::BytecodeEvaluation );
+      QCOMPARE( bytecodeExpression.evaluationMode(), QgsExpression::BytecodeEvaluation );
+      bytecodeExpression.prepare( &context );
+
+      for ( const QgsAttributes &featureAttributes : std::as_const( attributes ) )
+      {
+        QgsFeature feature( fields );
+        feature.setAttributes( featureAttributes );
+        context.setFeature( feature );
+
+        const QVariant treeResult = treeExpression.evaluate( &context );
+        const QVariant bytecodeResult = bytecodeExpression.evaluate( &context );
+        QCOMPARE( bytecodeResult.type(), treeResult.type() );
+        QCOMPARE( bytecodeResult.isNull(), treeResult.isNull() );
+        QCOMPARE( bytecodeResult, treeResult );
+        QCOMPARE( bytecodeExpression.hasEvalError(), treeExpression.hasEvalError() );
+        QCOMPARE( bytecodeExpression.evalErrorString(), treeExpression.evalErrorString() );
+      }
+
+      // evaluation without a feature must be handled
+      context.setFeature( QgsFeature() );
+      const QVariant treeResult = treeExpression.evaluate( &context );
+      const QVariant bytecodeResult = bytecodeExpression.evaluate( &context );
+      QCOMPARE( bytecodeResult, treeResult );
+      QCOMPARE( bytecodeExpression.evalErrorString(), treeExpression.evalErrorString() );
+    }
+
+    void testBytecodeEvaluationModeCopy()
+    {
+      QgsExpression exp( QStringLiteral( "1 + 2" ) );
+      exp.setEvaluationMode( QgsExpression::BytecodeEvaluation );
+      QgsExpression exp2( exp );
+      QCOMPARE( exp2.evaluationMode(), QgsExpression::BytecodeEvaluation );
+      exp2.setEvaluationMode( QgsExpression::TreeEvaluation );
+      QCOMPARE( exp2.evaluationMode(), QgsExpression::TreeEvaluation );
+      QCOMPARE( exp.evaluationMode(), QgsExpression::BytecodeEvaluation );
+      QCOMPARE( exp.evaluate(), QVariant( 3 ) );
+      QCOMPARE( exp2.evaluate(), QVariant( 3 ) );
+    }
+
+    void testBytecodeEvaluationConcurrent()
+    {
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "int_field" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "double_field" ), QVariant::Double ) );
+
+      QgsExpressionContext context;
+      QgsExpressionContextScope *scope = new QgsExpressionContextScope();
+      scope->setFields( fields );
+      context.appendScope( scope );
+
+      QgsExpression exp( QStringLiteral( "\"int_field\" * 2 + sqrt(\"double_field\") - CASE WHEN \"int_field\" > 500 THEN 1 ELSE 0 END" ) );
+      exp.setEvaluationMode( QgsExpression::BytecodeEvaluation );
+      exp.prepare( &context );
+
+      // copies of the expression share the compiled program, and must not interfere when evaluated concurrently
+      struct Evaluate
+      {
+        typedef double result_type;
+
+        double operator()( int value ) const
+        {
+          QgsExpression copy( expression );
+          QgsExpressionContext featureContext( context );
+          QgsFeature feature( fields );
+          feature.setAttributes( QgsAttributes() << value << static_cast< double >( value ) * value );
+          featureContext.setFeature( feature );
+          return copy.evaluate( &featureContext ).toDouble();
+        }
+
+        QgsExpression expression;
+        QgsExpressionContext context;
+        QgsFields fields;
+      };
+
+      QList< int > values;
+      for ( int i = 0; i < 1000; ++i )
+        values << i;
+      const QList< double > results = QtConcurrent::blockingMapped< QList< double > >( values, Evaluate{ exp, context, fields } );
+      QCOMPARE( results.size(), values.size() );
+      for ( int i = 0; i < values.size(); ++i )
+        QCOMPARE( results.at( i ), 3.0 * i - ( i > 500 ? 1 : 0 ) );
+    }
+
+    void testBatchEvaluation_data()
+    {
+      testBytecodeEvaluation_data();
+
+      QTest::newRow( "partial errors" ) << QStringLiteral( "to_int(\"string_field\") + \"int_field\"" );
+      QTest::newRow( "error in right side" ) << QStringLiteral( "\"int_field\" > 2 OR to_int(\"string_field\") > 0" );
+      QTest::newRow( "error in condition" ) << QStringLiteral( "CASE WHEN to_int(\"string_field\") > 0 THEN 1 WHEN \"int_field\" > 2 THEN -\"double_field\" END" );
+      QTest::newRow( "in operator" ) << QStringLiteral( "\"int_field\" IN (1, 3) AND sqrt(\"double_field\") > 1" );
+      QTest::newRow( "static" ) << QStringLiteral( "1 + 2" );
+      QTest::newRow( "column" ) << QStringLiteral( "\"double_field\"" );
+    }
+
+    void testBatchEvaluation()
+    {
+      QFETCH( QString, expression );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "int_field" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "double_field" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "long_field" ), QVariant::LongLong ) );
+      fields.append( QgsField( QStringLiteral( "null_field" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "string_field" ), QVariant::String ) );
+
+      QList< QgsAttributes > attributes;
+      attributes << ( QgsAttributes() << 1 << 1.5 << QVariant( qlonglong( 10 ) ) << QVariant( QVariant::Int ) << QStringLiteral( "abc" ) );
+      attributes << ( QgsAttributes() << 3 << 4.75 << QVariant( qlonglong( -7 ) ) << 5 << QStringLiteral( "xyz" ) );
+      attributes << ( QgsAttributes() << 0 << -2.0 << QVariant( qlonglong( 0 ) ) << QVariant() << QVariant( QVariant::String ) );
+      attributes << ( QgsAttributes() << QVariant( QVariant::Int ) << QVariant( QVariant::Double ) << QVariant( QVariant::LongLong ) << QVariant( QVariant::Int ) << QStringLiteral( "1" ) );
+      attributes << ( QgsAttributes() << 4 << 0.5 << QVariant( qlonglong( 3 ) ) << 2 << QStringLiteral( "12" ) );
+
+      QgsFeatureList features;
+      for ( const QgsAttributes &featureAttributes : std::as_const( attributes ) )
+      {
+        QgsFeature feature( fields );
+        feature.setAttributes( featureAttributes );
+        features << feature;
+      }
+
+      QgsExpressionContext context;
+      QgsExpressionContextScope *scope = new QgsExpressionContextScope();
+      scope->setFields( fields );
+      scope->setVariable( QStringLiteral( "my_var" ), 3 );
+      context.appendScope( scope );
+
+      QgsExpression treeExpression( expression );
+      QVERIFY( !treeExpression.hasParserError() );
+      treeExpression.prepare( &context );
+
+      QVariantList treeResults;
+      QString firstError;
+      for ( const QgsFeature &feature : std::as_const( features ) )
+      {
+        context.setFeature( feature );
+        treeResults << treeExpression.evaluate( &context );
+        if ( firstError.isNull() && treeExpression.hasEvalError() )
+          firstError = treeExpression.evalErrorString();
+      }
+
+      QgsExpression batchExpression( expression );
+      batchExpression.prepare( &context );
+      const QVariantList batchResults = batchExpression.evaluateBatch( features, &context );
+      QCOMPARE( batchResults.size(), treeResults.size() );
+      for ( int i = 0; i < batchResults.size(); ++i )
+      {
+        QCOMPARE( batchResults.at( i ).type(), treeResults.at( i ).type() );
+        QCOMPARE( batchResults.at( i ).isNull(), treeResults.at( i ).isNull() );
+        QCOMPARE( batchResults.at( i ), treeResults.at( i ) );
+      }
+      QCOMPARE( batchExpression.hasEvalError(), !firstError.isNull() );
+      QCOMPARE( batchExpression.evalErrorString(), firstError );
+
+      // features without attributes must be handled, as must unprepared expressions
+      QgsExpression unpreparedExpression( expression );
+      const QVariantList invalidResults = unpreparedExpression.evaluateBatch( QgsFeatureList() << QgsFeature() << features.at( 1 ), &context );
+      QCOMPARE( invalidResults.size(), 2 );
+      context.setFeature( QgsFeature() );
+      QCOMPARE( invalidResults.at( 0 ), treeExpression.evaluate( &context ) );
+      QCOMPARE( invalidResults.at( 1 ), treeResults.at( 1 ) );
+
+      QVERIFY( batchExpression.evaluateBatch( QgsFeatureList(), &context ).isEmpty() );
+    }
+
 };
 
 QGSTEST_MAIN( TestQgsExpression )
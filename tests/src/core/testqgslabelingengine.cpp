@@ -37,6 +37,7 @@
 #include "qgsmarkersymbol.h"
 #include "qgsmarkersymbollayer.h"
 #include "qgsfillsymbol.h"
+#include "qgsmaprenderercache.h"
 
 class TestQgsLabelingEngine : public QObject
 {
@@ -79,6 +80,9 @@ class TestQgsLabelingEngine : public QObject
     void drawUnplaced();
     void labelingResults();
     void labelingResultsWithCallouts();
+    void labelingResultsPartitionedProblem();
+    void reusePlacements();
+    void reusePlacementsWithObstacles();
     void pointsetExtend();
     void curvedOverrun();
     void parallelOverrun();
@@ -2112,6 +2116,290 @@ void TestQgsLabelingEngine::labelingResults()
   QCOMPARE( labels.count(), 0 );
 }
 
+void TestQgsLabelingEngine::labelingResultsPartitionedProblem()
+{
+  // a grid of many independent clusters of conflicting labels, large enough for the labeling problem
+  // to be split into several partitions, which are solved in parallel
+  QgsPalLayerSettings settings;
+  settings.fieldName = QStringLiteral( "id" );
+  settings.placement = QgsPalLayerSettings::OverPoint;
+
+  QgsTextFormat format;
+  format.setFont( QgsFontUtils::getStandardTestFont( QStringLiteral( "Bold" ) ) );
+  format.setSize( 10 );
+  settings.setFormat( format );
+
+  std::unique_ptr< QgsVectorLayer> vl( new QgsVectorLayer( QStringLiteral( "Point?crs=epsg:3857&field=id:integer" ), QStringLiteral( "vl" ), QStringLiteral( "memory" ) ) );
+  vl->setRenderer( new QgsNullSymbolRenderer() );
+
+  // each cluster contains two features at the same location, only one of them can be labeled
+  QgsFeatureList features;
+  for ( int i = 0; i < 40; ++i )
+  {
+    for ( int j = 0; j < 40; ++j )
+    {
+      for ( int k = 0; k < 2; ++k )
+      {
+        QgsFeature f;
+        f.setAttributes( QgsAttributes() << k + 1 );
+        f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 25 + i * 50, 25 + j * 50 ) ) );
+        features << f;
+      }
+    }
+  }
+  QVERIFY( vl->dataProvider()->addFeatures( features ) );
+  vl->updateExtents();
+
+  vl->setLabeling( new QgsVectorLayerSimpleLabeling( settings ) );  // TODO: this should not be necessary!
+  vl->setLabelsEnabled( true );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setLabelingEngineSettings( createLabelEngineSettings() );
+  mapSettings.setDestinationCrs( vl->crs() );
+  mapSettings.setOutputSize( QSize( 2000, 2000 ) );
+  mapSettings.setExtent( QgsRectangle( 0, 0, 2000, 2000 ) );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << vl.get() );
+  mapSettings.setOutputDpi( 96 );
+
+  QgsLabelingEngineSettings engineSettings = mapSettings.labelingEngineSettings();
+  engineSettings.setFlag( QgsLabelingEngineSettings::UsePartialCandidates, false );
+  engineSettings.setFlag( QgsLabelingEngineSettings::DrawLabelRectOnly, true );
+  mapSettings.setLabelingEngineSettings( engineSettings );
+
+  QgsMapRendererSequentialJob job( mapSettings );
+  job.start();
+  job.waitForFinished();
+
+  std::unique_ptr< QgsLabelingResults > results( job.takeLabelingResults() );
+  QVERIFY( results );
+
+  // exactly one label must be placed for each cluster
+  QCOMPARE( results->allLabels().count(), 1600 );
+  for ( int i = 0; i < 40; ++i )
+  {
+    for ( int j = 0; j < 40; ++j )
+    {
+      QCOMPARE( results->labelsAtPosition( QgsPointXY( 25 + i * 50, 25 + j * 50 ) ).count(), 1 );
+    }
+  }
+}
+
+void TestQgsLabelingEngine::reusePlacements()
+{
+  // test that label placements are reused when the map is panned
+  QgsPalLayerSettings settings;
+  settings.fieldName = QStringLiteral( "id" );
+  settings.placement = QgsPalLayerSettings::AroundPoint;
+
+  QgsTextFormat format;
+  format.setFont( QgsFontUtils::getStandardTestFont( QStringLiteral( "Bold" ) ) );
+  format.setSize( 10 );
+  settings.setFormat( format );
+
+  std::unique_ptr< QgsVectorLayer> vl( new QgsVectorLayer( QStringLiteral( "Point?crs=epsg:3857&field=id:integer" ), QStringLiteral( "vl" ), QStringLiteral( "memory" ) ) );
+  vl->setRenderer( new QgsNullSymbolRenderer() );
+
+  QgsFeatureList features;
+  for ( int i = 0; i < 10; ++i )
+  {
+    for ( int j = 0; j < 10; ++j )
+    {
+      QgsFeature f;
+      f.setAttributes( QgsAttributes() << i * 10 + j );
+      f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 50 + i * 100, 50 + j * 100 ) ) );
+      features << f;
+    }
+  }
+  QVERIFY( vl->dataProvider()->addFeatures( features ) );
+  vl->updateExtents();
+
+  vl->setLabeling( new QgsVectorLayerSimpleLabeling( settings ) );
+  vl->setLabelsEnabled( true );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setLabelingEngineSettings( createLabelEngineSettings() );
+  mapSettings.setDestinationCrs( vl->crs() );
+  mapSettings.setOutputSize( QSize( 1000, 1000 ) );
+  mapSettings.setExtent( QgsRectangle( 0, 0, 1000, 1000 ) );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << vl.get() );
+  mapSettings.setOutputDpi( 96 );
+
+  QgsLabelingEngineSettings engineSettings = mapSettings.labelingEngineSettings();
+  engineSettings.setFlag( QgsLabelingEngineSettings::UsePartialCandidates, false );
+  engineSettings.setFlag( QgsLabelingEngineSettings::DrawLabelRectOnly, true );
+  engineSettings.setFlag( QgsLabelingEngineSettings::ReusePlacements, true );
+  mapSettings.setLabelingEngineSettings( engineSettings );
+
+  QgsMapRendererCache cache;
+
+  QgsMapRendererSequentialJob job( mapSettings );
+  job.setCache( &cache );
+  job.start();
+  job.waitForFinished();
+
+  std::unique_ptr< QgsLabelingResults > results( job.takeLabelingResults() );
+  QVERIFY( results );
+  QCOMPARE( results->allLabels().count(), 100 );
+
+  auto findLabel = []( const QgsLabelingResults & results, const QString & text )
+  {
+    const QList< QgsLabelPosition > labels = results.allLabels();
+    for ( const QgsLabelPosition &label : labels )
+    {
+      if ( label.labelText == text )
+        return label;
+    }
+    return QgsLabelPosition();
+  };
+
+  // the label of the feature at ( 450, 450 )
+  const QgsLabelPosition label = findLabel( *results, QStringLiteral( "44" ) );
+  const QgsRectangle before = label.labelRect;
+  QVERIFY( !before.isEmpty() );
+
+  QgsLabelPlacementCache placements = cache.labelPlacementCache();
+  QCOMPARE( placements.placementCount(), 100 );
+  QCOMPARE( placements.extent(), mapSettings.visibleExtent() );
+
+  // move the stored placement of the label, so that a reused placement can be told apart from a recalculated one
+  const QgsLabelPlacementCache::Placement *placement = placements.placement( vl->id(), label.providerID, label.featureId );
+  QVERIFY( placement );
+  QgsLabelPlacementCache::Placement movedPlacement = *placement;
+  movedPlacement.position = QgsPointXY( placement->position.x() + 20, placement->position.y() );
+  movedPlacement.boundingBox = QgsRectangle( placement->boundingBox.xMinimum() + 20, placement->boundingBox.yMinimum(),
+                               placement->boundingBox.xMaximum() + 20, placement->boundingBox.yMaximum() );
+  placements.addPlacement( vl->id(), label.providerID, label.featureId, movedPlacement );
+  cache.setLabelPlacementCache( placements );
+
+  // pan the map, the label of a feature well inside both maps must keep its stored placement
+  mapSettings.setExtent( QgsRectangle( 100, 0, 1100, 1000 ) );
+  QVERIFY( !cache.labelPlacementCache().reusableExtent( mapSettings ).isEmpty() );
+
+  QgsMapRendererSequentialJob job2( mapSettings );
+  job2.setCache( &cache );
+  job2.start();
+  job2.waitForFinished();
+
+  results.reset( job2.takeLabelingResults() );
+  QVERIFY( results );
+  const QgsRectangle moved( before.xMinimum() + 20, before.yMinimum(), before.xMaximum() + 20, before.yMaximum() );
+  QCOMPARE( findLabel( *results, QStringLiteral( "44" ) ).labelRect.toString( 3 ), moved.toString( 3 ) );
+  QCOMPARE( cache.labelPlacementCache().extent(), mapSettings.visibleExtent() );
+
+  // without reuse, the label gets its original placement back
+  engineSettings.setFlag( QgsLabelingEngineSettings::ReusePlacements, false );
+  mapSettings.setLabelingEngineSettings( engineSettings );
+  QgsMapRendererSequentialJob job3( mapSettings );
+  job3.start();
+  job3.waitForFinished();
+  results.reset( job3.takeLabelingResults() );
+  QVERIFY( results );
+  QCOMPARE( findLabel( *results, QStringLiteral( "44" ) ).labelRect.toString( 3 ), before.toString( 3 ) );
+
+  // placements can't be reused after zooming
+  QgsMapSettings zoomed = mapSettings;
+  zoomed.setExtent( QgsRectangle( 100, 0, 600, 500 ) );
+  QVERIFY( cache.labelPlacementCache().reusableExtent( zoomed ).isEmpty() );
+
+  // placements are discarded when the layer is repainted
+  cache.invalidateCacheForLayer( vl.get() );
+  QVERIFY( cache.labelPlacementCache().isEmpty() );
+}
+
+void TestQgsLabelingEngine::reusePlacementsWithObstacles()
+{
+  // test that reused placements get the same cost on every redraw when their labels overlap an obstacle
+  QgsPalLayerSettings settings;
+  settings.fieldName = QStringLiteral( "id" );
+  settings.placement = QgsPalLayerSettings::AroundPoint;
+
+  QgsTextFormat format;
+  format.setFont( QgsFontUtils::getStandardTestFont( QStringLiteral( "Bold" ) ) );
+  format.setSize( 10 );
+  settings.setFormat( format );
+
+  std::unique_ptr< QgsVectorLayer> vl( new QgsVectorLayer( QStringLiteral( "Point?crs=epsg:3857&field=id:integer" ), QStringLiteral( "vl" ), QStringLiteral( "memory" ) ) );
+  vl->setRenderer( new QgsNullSymbolRenderer() );
+  QgsFeature f;
+  f.setAttributes( QgsAttributes() << 44 );
+  f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 450, 450 ) ) );
+  QVERIFY( vl->dataProvider()->addFeature( f ) );
+  vl->setLabeling( new QgsVectorLayerSimpleLabeling( settings ) );
+  vl->setLabelsEnabled( true );
+
+  // a layer which is only an obstacle, covering all the candidates of the label with a low obstacle factor
+  // so that the label is still placed but its cost is penalized
+  QgsPalLayerSettings obstacleSettings;
+  obstacleSettings.fieldName = QStringLiteral( "id" );
+  obstacleSettings.drawLabels = false;
+  obstacleSettings.obstacleSettings().setIsObstacle( true );
+  obstacleSettings.obstacleSettings().setType( QgsLabelObstacleSettings::PolygonWhole );
+  obstacleSettings.obstacleSettings().setFactor( 0.05 );
+
+  std::unique_ptr< QgsVectorLayer> obstacleLayer( new QgsVectorLayer( QStringLiteral( "Polygon?crs=epsg:3857&field=id:integer" ), QStringLiteral( "obstacles" ), QStringLiteral( "memory" ) ) );
+  obstacleLayer->setRenderer( new QgsNullSymbolRenderer() );
+  f.setAttributes( QgsAttributes() << 1 );
+  f.setGeometry( QgsGeometry::fromRect( QgsRectangle( 300, 300, 600, 600 ) ) );
+  QVERIFY( obstacleLayer->dataProvider()->addFeature( f ) );
+  obstacleLayer->setLabeling( new QgsVectorLayerSimpleLabeling( obstacleSettings ) );
+  obstacleLayer->setLabelsEnabled( true );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setLabelingEngineSettings( createLabelEngineSettings() );
+  mapSettings.setDestinationCrs( vl->crs() );
+  mapSettings.setOutputSize( QSize( 1000, 1000 ) );
+  mapSettings.setExtent( QgsRectangle( 0, 0, 1000, 1000 ) );
+  mapSettings.setLayers( QList<QgsMapLayer *>() << vl.get() << obstacleLayer.get() );
+  mapSettings.setOutputDpi( 96 );
+
+  QgsLabelingEngineSettings engineSettings = mapSettings.labelingEngineSettings();
+  engineSettings.setFlag( QgsLabelingEngineSettings::UsePartialCandidates, false );
+  engineSettings.setFlag( QgsLabelingEngineSettings::DrawLabelRectOnly, true );
+  engineSettings.setFlag( QgsLabelingEngineSettings::ReusePlacements, true );
+  mapSettings.setLabelingEngineSettings( engineSettings );
+
+  QgsMapRendererCache cache;
+
+  // render the same extent several times, the placement stored after each render is reused by the next one
+  QgsRectangle firstRect;
+  double firstCost = 0;
+  for ( int i = 0; i < 4; ++i )
+  {
+    QgsMapRendererSequentialJob job( mapSettings );
+    job.setCache( &cache );
+    job.start();
+    job.waitForFinished();
+
+    std::unique_ptr< QgsLabelingResults > results( job.takeLabelingResults() );
+    QVERIFY( results );
+    const QList< QgsLabelPosition > labels = results->allLabels();
+    QCOMPARE( labels.count(), 1 );
+    QCOMPARE( labels.at( 0 ).labelText, QStringLiteral( "44" ) );
+    QVERIFY( !labels.at( 0 ).isUnplaced );
+
+    const QgsLabelPlacementCache placements = cache.labelPlacementCache();
+    const QgsLabelPlacementCache::Placement *placement = placements.placement( vl->id(), labels.at( 0 ).providerID, labels.at( 0 ).featureId );
+    QVERIFY( placement );
+    if ( i == 0 )
+    {
+      firstRect = labels.at( 0 ).labelRect;
+      firstCost = placement->cost;
+      // the stored cost doesn't include the obstacle penalty, which is applied again when the placement is reused
+      QVERIFY( firstCost < 0.05 * 12 );
+    }
+    else
+    {
+      QCOMPARE( labels.at( 0 ).labelRect.toString( 3 ), firstRect.toString( 3 ) );
+      QCOMPARE( placement->cost, firstCost );
+    }
+  }
+
+  // placements are discarded when a layer which is only an obstacle for the labels is repainted
+  QVERIFY( !cache.labelPlacementCache().isEmpty() );
+  obstacleLayer->triggerRepaint();
+  QVERIFY( cache.labelPlacementCache().isEmpty() );
+}
+
 void TestQgsLabelingEngine::labelingResultsWithCallouts()
 {
   // test retrieval of rendered callout properties from labeling results
@@ -15,10 +15,17 @@
 #include "qgstest.h"
 
 #include <QImage>
+#include <QTemporaryDir>
 
 #include "qgsmaprenderercache.h"
 #include "qgsmaptopixel.h"
 #include "qgsrectangle.h"
+#include "qgsmaprendererdiskcache.h"
+#include "qgsmapsettings.h"
+#include "qgsvectorlayer.h"
+#include "qgsexpressioncontextutils.h"
+#include "qgsfeaturefilterprovider.h"
+#include "qgsfeaturerequest.h"
 
 class TestQgsMapRendererCache: public QObject
 {
@@ -34,6 +41,8 @@ class TestQgsMapRendererCache: public QObject
     void cleanup(); // will be called after every testfunction.
 
     void testCache();
+    void testDiskCache();
+    void testPersistentCacheKey();
 };
 
 
@@ -154,6 +163,125 @@ void TestQgsMapRendererCache::testCache()
   QVERIFY( !cache.hasAnyCacheImage( imgRedKey ) );
 }
 
+void TestQgsMapRendererCache::testDiskCache()
+{
+  QTemporaryDir dir;
+  QVERIFY( dir.isValid() );
+
+  QImage imgRed( 100, 100, QImage::Format::Format_ARGB32_Premultiplied );
+  imgRed.fill( Qt::red );
+  imgRed.setDevicePixelRatio( 2 );
+  QImage imgBlue( 50, 50, QImage::Format::Format_ARGB32_Premultiplied );
+  imgBlue.fill( Qt::blue );
+
+  {
+    QgsMapRendererDiskCache cache( dir.path() );
+    QCOMPARE( cache.directory(), dir.path() );
+    QCOMPARE( cache.cacheSize(), 0LL );
+    QVERIFY( cache.image( QStringLiteral( "abcd" ) ).isNull() );
+
+    cache.storeImage( QStringLiteral( "abcd" ), imgRed );
+    cache.storeImage( QStringLiteral( "efgh" ), imgBlue );
+    QVERIFY( cache.cacheSize() > 100 * 100 * 4 + 50 * 50 * 4 );
+
+    const QImage red = cache.image( QStringLiteral( "abcd" ) );
+    QCOMPARE( red.size(), imgRed.size() );
+    QCOMPARE( red.format(), imgRed.format() );
+    QCOMPARE( red.devicePixelRatio(), 2.0 );
+    QCOMPARE( red.pixelColor( 10, 20 ), QColor( Qt::red ) );
+    QCOMPARE( cache.image( QStringLiteral( "efgh" ) ).pixelColor( 10, 20 ), QColor( Qt::blue ) );
+  }
+
+  {
+    // images must be shared with other caches using the same directory
+    QgsMapRendererDiskCache cache( dir.path() );
+    QCOMPARE( cache.image( QStringLiteral( "abcd" ) ).pixelColor( 10, 20 ), QColor( Qt::red ) );
+
+    // replacing an image
+    cache.storeImage( QStringLiteral( "abcd" ), imgBlue );
+    QCOMPARE( cache.image( QStringLiteral( "abcd" ) ).size(), imgBlue.size() );
+
+    // shrinking the cache must evict images
+    cache.setMaximumSize( 50 * 50 * 4 + 100 );
+    QVERIFY( cache.cacheSize() <= 50 * 50 * 4 + 100 );
+
+    cache.clear();
+    QCOMPARE( cache.cacheSize(), 0LL );
+    QVERIFY( cache.image( QStringLiteral( "abcd" ) ).isNull() );
+    QVERIFY( cache.image( QStringLiteral( "efgh" ) ).isNull() );
+  }
+}
+
+class TestFeatureFilterProvider : public QgsFeatureFilterProvider
+{
+  public:
+
+    void filterFeatures( const QgsVectorLayer *, QgsFeatureRequest &request ) const override
+    {
+      if ( !expression.isEmpty() )
+        request.combineFilterExpression( expression );
+    }
+
+    QStringList layerAttributes( const QgsVectorLayer *, const QStringList &attributes ) const override { return attributes; }
+    QgsFeatureFilterProvider *clone() const override { return new TestFeatureFilterProvider( *this ); }
+
+    QString expression;
+};
+
+void TestQgsMapRendererCache::testPersistentCacheKey()
+{
+  QgsVectorLayer layer( QStringLiteral( "Point?crs=EPSG:3111" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) );
+  QVERIFY( layer.isValid() );
+
+  QgsMapSettings settings;
+  settings.setDestinationCrs( QgsCoordinateReferenceSystem( QStringLiteral( "EPSG:3111" ) ) );
+  settings.setExtent( QgsRectangle( 0, 0, 100, 100 ) );
+  settings.setOutputSize( QSize( 100, 100 ) );
+  settings.setLayers( QList< QgsMapLayer * >() << &layer );
+
+  const QString key = QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings );
+  QVERIFY( !key.isEmpty() );
+  QCOMPARE( QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings ), key );
+
+  QgsMapSettings settings2 = settings;
+  settings2.setExtent( QgsRectangle( 0, 0, 200, 200 ) );
+  QVERIFY( QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings2 ) != key );
+
+  settings2 = settings;
+  settings2.setOutputDpi( 192 );
+  QVERIFY( QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings2 ) != key );
+
+  // variables used by data defined properties must result in a different key
+  settings2 = settings;
+  QgsExpressionContext context;
+  context.appendScope( new QgsExpressionContextScope() );
+  context.lastScope()->setVariable( QStringLiteral( "symbol_size" ), 5 );
+  settings2.setExpressionContext( context );
+  const QString variableKey = QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings2 );
+  QVERIFY( variableKey != key );
+  context.lastScope()->setVariable( QStringLiteral( "symbol_size" ), 6 );
+  settings2.setExpressionContext( context );
+  QVERIFY( QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings2 ) != variableKey );
+
+  QgsExpressionContextUtils::setLayerVariable( &layer, QStringLiteral( "symbol_size" ), 7 );
+  QVERIFY( QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings ) != key );
+  QgsExpressionContextUtils::removeLayerVariable( &layer, QStringLiteral( "symbol_size" ) );
+  QCOMPARE( QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings ), key );
+
+  // filters of a feature filter provider must result in a different key
+  TestFeatureFilterProvider filter;
+  QCOMPARE( QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings, &filter ), key );
+  filter.expression = QStringLiteral( "\"fid\" > 5" );
+  const QString filterKey = QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings, &filter );
+  QVERIFY( filterKey != key );
+  filter.expression = QStringLiteral( "\"fid\" > 6" );
+  QVERIFY( QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings, &filter ) != filterKey );
+
+  // style changes must result in a different key
+  layer.setOpacity( 0.5 );
+  QVERIFY( QgsAbstractMapRendererPersistentCache::layerCacheKey( &layer, settings ) != key );
+}
+
 
 QGSTEST_MAIN( TestQgsMapRendererCache )
 #include "testqgsmaprenderercache.moc"
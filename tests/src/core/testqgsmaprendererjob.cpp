@@ -31,6 +31,7 @@
 #include "qgsfield.h"
 #include "qgis.h"
 #include "qgsmaprenderersequentialjob.h"
+#include "qgsmaprendererparalleljob.h"
 #include "qgsmaplayer.h"
 #include "qgsreadwritecontext.h"
 #include "qgsproviderregistry.h"
@@ -45,6 +46,11 @@
 #include "qgssinglesymbolrenderer.h"
 #include "qgsrasterlayertemporalproperties.h"
 #include "qgslinesymbol.h"
+#include "qgsabstractmaprendererpersistentcache.h"
+#include "qgsfeaturefilterprovider.h"
+#include "qgsmaplayertiledrenderer.h"
+#include "qgssymbollayer.h"
+#include "qgsproperty.h"
 
 //qgs unit test utility class
 #include "qgsmultirenderchecker.h"
@@ -88,8 +94,11 @@ class TestQgsMapRendererJob : public QObject
     void stagedRendererWithStagedLabeling();
 
     void vectorLayerBoundsWithReprojection();
+    void tiledLayerParallelRender();
 
     void temporalRender();
+    void persistentCache();
+    void sequentialJobFeatureFilter();
 
   private:
     bool imageCheck( const QString &type, const QImage &image, int mismatchCount = 0 );
@@ -890,6 +899,59 @@ void TestQgsMapRendererJob::vectorLayerBoundsWithReprojection()
   QVERIFY( imageCheck( QStringLiteral( "vector_layer_bounds_with_reprojection" ), img ) );
 }
 
+void TestQgsMapRendererJob::tiledLayerParallelRender()
+{
+  std::unique_ptr< QgsVectorLayer > gridLayer = std::make_unique< QgsVectorLayer >( TEST_DATA_DIR + QStringLiteral( "/grid_4326.geojson" ),
+      QStringLiteral( "grid" ), QStringLiteral( "ogr" ) );
+  QVERIFY( gridLayer->isValid() );
+
+  std::unique_ptr< QgsLineSymbol > symbol = std::make_unique< QgsLineSymbol >();
+  symbol->setColor( QColor( 255, 0, 255 ) );
+  symbol->setWidth( 2 );
+  std::unique_ptr< QgsSingleSymbolRenderer > renderer = std::make_unique< QgsSingleSymbolRenderer >( symbol.release() );
+  gridLayer->setRenderer( renderer.release() );
+
+  QgsMapSettings mapSettings;
+
+  mapSettings.setDestinationCrs( QgsCoordinateReferenceSystem( QStringLiteral( "EPSG:3857" ) ) );
+  mapSettings.setExtent( QgsRectangle( -37000835.1, -20182273.7, 37000835.1, 20182273.7 ) );
+  mapSettings.setOutputSize( QSize( 512, 512 ) );
+  mapSettings.setFlag( QgsMapSettings::DrawLabeling, false );
+  mapSettings.setOutputDpi( 96 );
+  mapSettings.setLayers( QList< QgsMapLayer * >() << gridLayer.get() );
+
+  QMap< QString, int > tileCounts;
+  tileCounts.insert( gridLayer->id(), 7 );
+  mapSettings.setLayerRenderTileCounts( tileCounts );
+  QCOMPARE( mapSettings.layerRenderTileCounts().value( gridLayer->id() ), 7 );
+
+  // tiled render must be identical to the untiled one
+  int renderedTiles = QgsMapLayerTiledRenderer::renderedTileCount();
+  QgsMapRendererParallelJob renderJob( mapSettings );
+  renderJob.start();
+  renderJob.waitForFinished();
+  QVERIFY( renderJob.errors().isEmpty() );
+  // the layer must really have been rendered in tiles
+  QCOMPARE( QgsMapLayerTiledRenderer::renderedTileCount() - renderedTiles, 7 );
+  QImage img = renderJob.renderedImage();
+  QVERIFY( imageCheck( QStringLiteral( "vector_layer_bounds_with_reprojection" ), img ) );
+
+  // symbols with a data defined width can paint further than their estimated bleed, so they are not tiled
+  QgsSymbol *layerSymbol = static_cast< QgsSingleSymbolRenderer * >( gridLayer->renderer() )->symbol()->clone();
+  layerSymbol->symbolLayer( 0 )->setDataDefinedProperty( QgsSymbolLayer::PropertyStrokeWidth, QgsProperty::fromExpression( QStringLiteral( "2" ) ) );
+  gridLayer->setRenderer( new QgsSingleSymbolRenderer( layerSymbol ) );
+  QVERIFY( !QgsMapLayerTiledRenderer::layerIsEligible( gridLayer.get(), mapSettings, QgsRenderContext::fromMapSettings( mapSettings ), nullptr ) );
+
+  renderedTiles = QgsMapLayerTiledRenderer::renderedTileCount();
+  QgsMapRendererParallelJob renderJob2( mapSettings );
+  renderJob2.start();
+  renderJob2.waitForFinished();
+  QVERIFY( renderJob2.errors().isEmpty() );
+  QCOMPARE( QgsMapLayerTiledRenderer::renderedTileCount(), renderedTiles );
+  img = renderJob2.renderedImage();
+  QVERIFY( imageCheck( QStringLiteral( "vector_layer_bounds_with_reprojection" ), img ) );
+}
+
 void TestQgsMapRendererJob::temporalRender()
 {
   std::unique_ptr< QgsRasterLayer > rasterLayer = std::make_unique< QgsRasterLayer >( TEST_DATA_DIR + QStringLiteral( "/raster_layer.tiff" ),
@@ -947,6 +1009,158 @@ void TestQgsMapRendererJob::temporalRender()
 
 }
 
+class TestPersistentCache : public QgsAbstractMapRendererPersistentCache
+{
+  public:
+
+    QImage image( const QString &key ) const override
+    {
+      lookups++;
+      return images.value( key );
+    }
+
+    void storeImage( const QString &key, const QImage &image ) override
+    {
+      stores++;
+      images.insert( key, image );
+    }
+
+    void clear() override
+    {
+      images.clear();
+    }
+
+    QHash< QString, QImage > images;
+    mutable int lookups = 0;
+    int stores = 0;
+};
+
+class TestFeatureFilterProvider : public QgsFeatureFilterProvider
+{
+  public:
+
+    void filterFeatures( const QgsVectorLayer *, QgsFeatureRequest &request ) const override
+    {
+      if ( !expression.isEmpty() )
+        request.combineFilterExpression( expression );
+    }
+
+    QStringList layerAttributes( const QgsVectorLayer *, const QStringList &attributes ) const override { return attributes; }
+    QgsFeatureFilterProvider *clone() const override { return new TestFeatureFilterProvider( *this ); }
+
+    QString expression;
+};
+
+void TestQgsMapRendererJob::persistentCache()
+{
+  std::unique_ptr< QgsRasterLayer > rasterLayer = std::make_unique< QgsRasterLayer >( TEST_DATA_DIR + QStringLiteral( "/raster_layer.tiff" ),
+      QStringLiteral( "raster" ), QStringLiteral( "gdal" ) );
+  QVERIFY( rasterLayer->isValid() );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setExtent( rasterLayer->extent() );
+  mapSettings.setDestinationCrs( rasterLayer->crs() );
+  mapSettings.setOutputSize( QSize( 512, 512 ) );
+  mapSettings.setFlag( QgsMapSettings::DrawLabeling, false );
+  mapSettings.setOutputDpi( 96 );
+  mapSettings.setLayers( QList< QgsMapLayer * >() << rasterLayer.get() );
+
+  TestPersistentCache cache;
+
+  // first render stores the layer image
+  QgsMapRendererSequentialJob renderJob( mapSettings );
+  renderJob.setPersistentCache( &cache );
+  renderJob.start();
+  renderJob.waitForFinished();
+  QCOMPARE( cache.lookups, 1 );
+  QCOMPARE( cache.stores, 1 );
+  const QString key = QgsAbstractMapRendererPersistentCache::layerCacheKey( rasterLayer.get(), mapSettings );
+  QVERIFY( cache.images.contains( key ) );
+  QVERIFY( imageCheck( QStringLiteral( "temporal_render_visible" ), renderJob.renderedImage() ) );
+
+  // replace the cached image, so that a render from the cache can be told apart from a new render
+  QImage cachedImage( cache.images.value( key ).size(), QImage::Format_ARGB32_Premultiplied );
+  cachedImage.fill( QColor( 0, 0, 255 ) );
+  cache.images.insert( key, cachedImage );
+
+  QgsMapRendererSequentialJob renderJob2( mapSettings );
+  renderJob2.setPersistentCache( &cache );
+  renderJob2.start();
+  renderJob2.waitForFinished();
+  QCOMPARE( cache.lookups, 2 );
+  QCOMPARE( cache.stores, 1 );
+  QCOMPARE( renderJob2.renderedImage().pixelColor( 256, 256 ), QColor( 0, 0, 255 ) );
+
+  // feature filters (e.g. server access control) only apply to vector layers, so the raster image is still read from the cache
+  TestFeatureFilterProvider filterProvider;
+  QgsMapRendererSequentialJob renderJob3( mapSettings );
+  renderJob3.setPersistentCache( &cache );
+  renderJob3.setFeatureFilterProvider( &filterProvider );
+  renderJob3.start();
+  renderJob3.waitForFinished();
+  QCOMPARE( cache.lookups, 3 );
+  QCOMPARE( cache.stores, 1 );
+  QCOMPARE( renderJob3.renderedImage().pixelColor( 256, 256 ), QColor( 0, 0, 255 ) );
+
+  // variables can change the render through data defined properties, so a new image must be rendered
+  QgsExpressionContextScope *scope = new QgsExpressionContextScope();
+  scope->setVariable( QStringLiteral( "my_var" ), 5 );
+  QgsExpressionContext expressionContext;
+  expressionContext.appendScope( scope );
+  mapSettings.setExpressionContext( expressionContext );
+  QgsMapRendererSequentialJob renderJob4( mapSettings );
+  renderJob4.setPersistentCache( &cache );
+  renderJob4.start();
+  renderJob4.waitForFinished();
+  QCOMPARE( cache.lookups, 4 );
+  QCOMPARE( cache.stores, 2 );
+  QVERIFY( imageCheck( QStringLiteral( "temporal_render_visible" ), renderJob4.renderedImage() ) );
+}
+
+void TestQgsMapRendererJob::sequentialJobFeatureFilter()
+{
+  std::unique_ptr< QgsVectorLayer > gridLayer = std::make_unique< QgsVectorLayer >( TEST_DATA_DIR + QStringLiteral( "/grid_4326.geojson" ),
+      QStringLiteral( "grid" ), QStringLiteral( "ogr" ) );
+  QVERIFY( gridLayer->isValid() );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setDestinationCrs( gridLayer->crs() );
+  mapSettings.setExtent( gridLayer->extent() );
+  mapSettings.setOutputSize( QSize( 256, 256 ) );
+  mapSettings.setBackgroundColor( QColor( 255, 255, 255 ) );
+  mapSettings.setFlag( QgsMapSettings::DrawLabeling, false );
+  mapSettings.setOutputDpi( 96 );
+  mapSettings.setLayers( QList< QgsMapLayer * >() << gridLayer.get() );
+
+  const auto isBlank = []( const QImage & image )
+  {
+    for ( int y = 0; y < image.height(); ++y )
+    {
+      for ( int x = 0; x < image.width(); ++x )
+      {
+        if ( image.pixel( x, y ) != qRgb( 255, 255, 255 ) )
+          return false;
+      }
+    }
+    return true;
+  };
+
+  TestFeatureFilterProvider filterProvider;
+  QgsMapRendererSequentialJob renderJob( mapSettings );
+  renderJob.setFeatureFilterProvider( &filterProvider );
+  renderJob.start();
+  renderJob.waitForFinished();
+  QVERIFY( !isBlank( renderJob.renderedImage() ) );
+
+  // the filter must reach the internal job of the sequential job
+  filterProvider.expression = QStringLiteral( "FALSE" );
+  QgsMapRendererSequentialJob renderJob2( mapSettings );
+  renderJob2.setFeatureFilterProvider( &filterProvider );
+  renderJob2.start();
+  renderJob2.waitForFinished();
+  QVERIFY( isBlank( renderJob2.renderedImage() ) );
+}
+
 bool TestQgsMapRendererJob::imageCheck( const QString &testName, const QImage &image, int mismatchCount )
 {
   mReport += "<h2>" + testName + "</h2>\n";
@@ -24,6 +24,10 @@
 #include <QTime>
 #include <QDesktopServices>
 #include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QRandomGenerator>
+
+#include <map>
 
 #include "cpl_conv.h"
 #include "gdal.h"
@@ -46,6 +50,17 @@
 #include "qgsrastertransparency.h"
 #include "qgspalettedrasterrenderer.h"
 #include "qgsrasterlayertemporalproperties.h"
+#include "qgsrasterdrawer.h"
+#include "qgsrasteriterator.h"
+#include "qgsrasterpipe.h"
+#include "qgsrasterprojector.h"
+#include "qgsrasterstatisticsstore.h"
+#include "qgsrasterviewport.h"
+#include "qgsmaptopixel.h"
+#include "qgssettings.h"
+#include "qgsconvolutionimageresampler.h"
+#include "qgsgdalutils.h"
+#include "qgsogrutils.h"
 
 //qgis unit test includes
 #include <qgsrenderchecker.h>
@@ -83,6 +98,10 @@ class TestQgsRasterLayer : public QObject
     void checkStats();
     void checkScaleOffset();
     void buildExternalOverviews();
+    void buildAverageOverviews();
+    void buildFloatAverageOverviews();
+    void buildNoDataAverageOverviews();
+    void buildModeOverviews();
     void registry();
     void transparency();
     void multiBandColorRenderer();
@@ -100,6 +119,11 @@ class TestQgsRasterLayer : public QObject
     void testRefreshRendererIfNeeded();
     void sample();
     void testTemporalProperties();
+    void parallelDrawing();
+    void reprojectedBlocks();
+    void parallelStatistics();
+    void statisticsStoreSources();
+    void cubicResampling();
 
 
   private:
@@ -108,6 +132,8 @@ class TestQgsRasterLayer : public QObject
     void populateColorRampShader( QgsColorRampShader *colorRampShader,
                                   QgsColorRamp *colorRamp,
                                   int numberOfEntries );
+    //! Checks that each overview level of the bands of \a fileName is the average of the full resolution values it covers
+    void compareWithFullResolutionAverages( const QString &fileName, bool rounded );
     bool testColorRamp( const QString &name, QgsColorRamp *colorRamp,
                         QgsColorRampShader::Type type, int numberOfEntries );
     QString mTestDataDir;
@@ -608,6 +634,259 @@ void TestQgsRasterLayer::buildExternalOverviews()
   mReport += QLatin1String( "<p>Passed</p>" );
 }
 
+void TestQgsRasterLayer::compareWithFullResolutionAverages( const QString &fileName, bool rounded )
+{
+  GDALDatasetH dataset = GDALOpen( fileName.toLocal8Bit().constData(), GA_ReadOnly );
+  QVERIFY( dataset );
+  const int width = GDALGetRasterXSize( dataset );
+  const int height = GDALGetRasterYSize( dataset );
+  for ( int bandNo = 1; bandNo <= GDALGetRasterCount( dataset ); ++bandNo )
+  {
+    GDALRasterBandH band = GDALGetRasterBand( dataset, bandNo );
+    QCOMPARE( GDALGetOverviewCount( band ), 2 );
+    int hasNoData = 0;
+    const double noData = GDALGetRasterNoDataValue( band, &hasNoData );
+
+    std::vector< double > sourceValues( static_cast< std::size_t >( width ) * height );
+    QCOMPARE( GDALRasterIO( band, GF_Read, 0, 0, width, height, sourceValues.data(), width, height, GDT_Float64, 0, 0 ), CE_None );
+
+    // every level is compared with the average of the full resolution values it covers, not with the average of the previous level
+    for ( int i = 0; i < 2; ++i )
+    {
+      const int factor = i == 0 ? 2 : 4;
+      GDALRasterBandH overview = GDALGetOverview( band, i );
+      const int overviewWidth = GDALGetRasterBandXSize( overview );
+      const int overviewHeight = GDALGetRasterBandYSize( overview );
+      QCOMPARE( overviewWidth, ( width + factor - 1 ) / factor );
+      QCOMPARE( overviewHeight, ( height + factor - 1 ) / factor );
+
+      std::vector< double > values( static_cast< std::size_t >( overviewWidth ) * overviewHeight );
+      QCOMPARE( GDALRasterIO( overview, GF_Read, 0, 0, overviewWidth, overviewHeight, values.data(), overviewWidth, overviewHeight, GDT_Float64, 0, 0 ), CE_None );
+
+      for ( int row = 0; row < overviewHeight; ++row )
+      {
+        for ( int col = 0; col < overviewWidth; ++col )
+        {
+          double sum = 0;
+          int count = 0;
+          for ( int sourceRow = row * factor; sourceRow < std::min( ( row + 1 ) * factor, height ); ++sourceRow )
+          {
+            for ( int sourceCol = col * factor; sourceCol < std::min( ( col + 1 ) * factor, width ); ++sourceCol )
+            {
+              const double value = sourceValues[static_cast< std::size_t >( sourceRow ) * width + sourceCol];
+              if ( std::isnan( value ) || ( hasNoData && value == noData ) )
+                continue;
+              sum += value;
+              count++;
+            }
+          }
+          const double value = values[static_cast< std::size_t >( row ) * overviewWidth + col];
+          if ( count == 0 )
+          {
+            QVERIFY( hasNoData ? value == noData : std::isnan( value ) );
+          }
+          else if ( rounded )
+          {
+            QCOMPARE( value, std::round( sum / count ) );
+          }
+          else
+          {
+            QGSCOMPARENEAR( value, sum / count, 1e-9 );
+          }
+        }
+      }
+    }
+  }
+  GDALClose( dataset );
+}
+
+void TestQgsRasterLayer::buildAverageOverviews()
+{
+  const QTemporaryDir tempDir;
+  const QString fileName = tempDir.filePath( QStringLiteral( "landsat.tif" ) );
+  QVERIFY( QFile::copy( mTestDataDir + "landsat.tif", fileName ) );
+  std::unique_ptr< QgsRasterLayer > layer = std::make_unique< QgsRasterLayer >( fileName, QStringLiteral( "landsat" ) );
+  QVERIFY( layer->isValid() );
+
+  QList< QgsRasterPyramid > pyramids = layer->dataProvider()->buildPyramidList( QList< int >() << 2 << 4 );
+  for ( QgsRasterPyramid &pyramid : pyramids )
+    pyramid.setBuild( true );
+  QCOMPARE( layer->dataProvider()->buildPyramids( pyramids, QStringLiteral( "AVERAGE" ), QgsRaster::PyramidsGTiff ), QString() );
+  layer.reset();
+
+  // byte bands store rounded averages, the second level must not be the rounded average of the rounded averages
+  compareWithFullResolutionAverages( fileName, true );
+}
+
+void TestQgsRasterLayer::buildFloatAverageOverviews()
+{
+  const QTemporaryDir tempDir;
+  const QString fileName = tempDir.filePath( QStringLiteral( "float.tif" ) );
+
+  // the second band has NaN values, whose averages can't be averaged again
+  const int size = 100;
+  {
+    gdal::dataset_unique_ptr dataset( GDALCreate( GDALGetDriverByName( "GTiff" ), fileName.toLocal8Bit().constData(), size, size, 2, GDT_Float64, nullptr ) );
+    QVERIFY( dataset );
+    for ( int bandNo = 1; bandNo <= 2; ++bandNo )
+    {
+      std::vector< double > values( static_cast< std::size_t >( size ) * size );
+      for ( int row = 0; row < size; ++row )
+      {
+        for ( int col = 0; col < size; ++col )
+        {
+          double value = std::sin( row * 0.37 + bandNo ) * 100 + col / 7.0;
+          if ( bandNo == 2 && ( row * 13 + col * 7 ) % 11 == 0 )
+            value = std::numeric_limits< double >::quiet_NaN();
+          values[static_cast< std::size_t >( row ) * size + col] = value;
+        }
+      }
+      QCOMPARE( GDALRasterIO( GDALGetRasterBand( dataset.get(), bandNo ), GF_Write, 0, 0, size, size, values.data(), size, size, GDT_Float64, 0, 0 ), CE_None );
+    }
+  }
+
+  std::unique_ptr< QgsRasterLayer > layer = std::make_unique< QgsRasterLayer >( fileName, QStringLiteral( "float" ) );
+  QVERIFY( layer->isValid() );
+
+  QList< QgsRasterPyramid > pyramids = layer->dataProvider()->buildPyramidList( QList< int >() << 2 << 4 );
+  for ( QgsRasterPyramid &pyramid : pyramids )
+    pyramid.setBuild( true );
+  QCOMPARE( layer->dataProvider()->buildPyramids( pyramids, QStringLiteral( "AVERAGE" ), QgsRaster::PyramidsGTiff ), QString() );
+  layer.reset();
+
+  compareWithFullResolutionAverages( fileName, false );
+}
+
+void TestQgsRasterLayer::buildNoDataAverageOverviews()
+{
+  const QTemporaryDir tempDir;
+  const QString fileName = tempDir.filePath( QStringLiteral( "landsat.tif" ) );
+  QVERIFY( QFile::copy( mTestDataDir + "landsat.tif", fileName ) );
+
+  // one of the most frequent values becomes nodata, so that windows have various numbers of valid values
+  const double noData = 127;
+  {
+    const gdal::dataset_unique_ptr dataset( GDALOpen( fileName.toLocal8Bit().constData(), GA_Update ) );
+    QVERIFY( dataset );
+    for ( int bandNo = 1; bandNo <= GDALGetRasterCount( dataset.get() ); ++bandNo )
+      QCOMPARE( GDALSetRasterNoDataValue( GDALGetRasterBand( dataset.get(), bandNo ), noData ), CE_None );
+  }
+
+  std::unique_ptr< QgsRasterLayer > layer = std::make_unique< QgsRasterLayer >( fileName, QStringLiteral( "landsat" ) );
+  QVERIFY( layer->isValid() );
+  QList< QgsRasterPyramid > pyramids = layer->dataProvider()->buildPyramidList( QList< int >() << 2 << 4 );
+  for ( QgsRasterPyramid &pyramid : pyramids )
+    pyramid.setBuild( true );
+  QCOMPARE( layer->dataProvider()->buildPyramids( pyramids, QStringLiteral( "AVERAGE" ), QgsRaster::PyramidsGTiff ), QString() );
+  layer.reset();
+
+  // averages skipping nodata can't be averaged again, the second level is the average of the full resolution
+  const gdal::dataset_unique_ptr dataset( GDALOpen( fileName.toLocal8Bit().constData(), GA_ReadOnly ) );
+  QVERIFY( dataset );
+  GDALRasterBandH band = GDALGetRasterBand( dataset.get(), 1 );
+  QCOMPARE( GDALGetOverviewCount( band ), 2 );
+  GDALRasterBandH overview = GDALGetOverview( band, 1 );
+  const int sourceWidth = GDALGetRasterBandXSize( band );
+  const int sourceHeight = GDALGetRasterBandYSize( band );
+  const int width = GDALGetRasterBandXSize( overview );
+  const int height = GDALGetRasterBandYSize( overview );
+  QCOMPARE( width, ( sourceWidth + 3 ) / 4 );
+
+  std::vector< double > sourceValues( static_cast< std::size_t >( sourceWidth ) * sourceHeight );
+  std::vector< double > values( static_cast< std::size_t >( width ) * height );
+  QCOMPARE( GDALRasterIO( band, GF_Read, 0, 0, sourceWidth, sourceHeight, sourceValues.data(), sourceWidth, sourceHeight, GDT_Float64, 0, 0 ), CE_None );
+  QCOMPARE( GDALRasterIO( overview, GF_Read, 0, 0, width, height, values.data(), width, height, GDT_Float64, 0, 0 ), CE_None );
+
+  int noDataPixels = 0;
+  for ( int row = 0; row < height; ++row )
+  {
+    for ( int col = 0; col < width; ++col )
+    {
+      double sum = 0;
+      int count = 0;
+      for ( int sourceRow = row * 4; sourceRow < std::min( row * 4 + 4, sourceHeight ); ++sourceRow )
+      {
+        for ( int sourceCol = col * 4; sourceCol < std::min( col * 4 + 4, sourceWidth ); ++sourceCol )
+        {
+          const double value = sourceValues[static_cast< std::size_t >( sourceRow ) * sourceWidth + sourceCol];
+          if ( value == noData )
+          {
+            noDataPixels++;
+            continue;
+          }
+          sum += value;
+          count++;
+        }
+      }
+      const double expected = count > 0 ? std::round( sum / count ) : noData;
+      QCOMPARE( values[static_cast< std::size_t >( row ) * width + col], expected );
+    }
+  }
+  QVERIFY( noDataPixels > 0 );
+}
+
+void TestQgsRasterLayer::buildModeOverviews()
+{
+  const QTemporaryDir tempDir;
+  const QString fileName = tempDir.filePath( QStringLiteral( "landsat.tif" ) );
+  QVERIFY( QFile::copy( mTestDataDir + "landsat.tif", fileName ) );
+  std::unique_ptr< QgsRasterLayer > layer = std::make_unique< QgsRasterLayer >( fileName, QStringLiteral( "landsat" ) );
+  QVERIFY( layer->isValid() );
+
+  QList< QgsRasterPyramid > pyramids = layer->dataProvider()->buildPyramidList( QList< int >() << 2 << 4 );
+  for ( QgsRasterPyramid &pyramid : pyramids )
+    pyramid.setBuild( true );
+  QCOMPARE( layer->dataProvider()->buildPyramids( pyramids, QStringLiteral( "MODE" ), QgsRaster::PyramidsGTiff ), QString() );
+  layer.reset();
+
+  // the mode of the modes is not the mode of all the values, every level is the mode of the full resolution
+  const gdal::dataset_unique_ptr dataset( GDALOpen( fileName.toLocal8Bit().constData(), GA_ReadOnly ) );
+  QVERIFY( dataset );
+  for ( int bandNo = 1; bandNo <= GDALGetRasterCount( dataset.get() ); ++bandNo )
+  {
+    GDALRasterBandH band = GDALGetRasterBand( dataset.get(), bandNo );
+    QCOMPARE( GDALGetOverviewCount( band ), 2 );
+    const int sourceWidth = GDALGetRasterBandXSize( band );
+    const int sourceHeight = GDALGetRasterBandYSize( band );
+    std::vector< double > sourceValues( static_cast< std::size_t >( sourceWidth ) * sourceHeight );
+    QCOMPARE( GDALRasterIO( band, GF_Read, 0, 0, sourceWidth, sourceHeight, sourceValues.data(), sourceWidth, sourceHeight, GDT_Float64, 0, 0 ), CE_None );
+
+    for ( int i = 0; i < 2; ++i )
+    {
+      const int factor = i == 0 ? 2 : 4;
+      GDALRasterBandH overview = GDALGetOverview( band, i );
+      const int width = GDALGetRasterBandXSize( overview );
+      const int height = GDALGetRasterBandYSize( overview );
+      std::vector< double > values( static_cast< std::size_t >( width ) * height );
+      QCOMPARE( GDALRasterIO( overview, GF_Read, 0, 0, width, height, values.data(), width, height, GDT_Float64, 0, 0 ), CE_None );
+
+      for ( int row = 0; row < height; ++row )
+      {
+        for ( int col = 0; col < width; ++col )
+        {
+          // most frequent value, the smallest one in case of ties
+          std::map< double, int > counts;
+          for ( int sourceRow = row * factor; sourceRow < std::min( row * factor + factor, sourceHeight ); ++sourceRow )
+          {
+            for ( int sourceCol = col * factor; sourceCol < std::min( col * factor + factor, sourceWidth ); ++sourceCol )
+              counts[sourceValues[static_cast< std::size_t >( sourceRow ) * sourceWidth + sourceCol]]++;
+          }
+          double expected = 0;
+          int bestCount = 0;
+          for ( const auto &count : counts )
+          {
+            if ( count.second > bestCount )
+            {
+              bestCount = count.second;
+              expected = count.first;
+            }
+          }
+          QCOMPARE( values[static_cast< std::size_t >( row ) * width + col], expected );
+        }
+      }
+    }
+  }
+}
 
 void TestQgsRasterLayer::registry()
 {
@@ -1040,5 +1319,310 @@ void TestQgsRasterLayer::testTemporalProperties()
   QCOMPARE( temporalProperties->fixedTemporalRange().end(), dateTimeRange.end() );
 }
 
+void TestQgsRasterLayer::parallelDrawing()
+{
+  // drawing concurrent stripes of the viewport must give the same image as drawing it at once
+  QgsRasterPipe pipe( *mpLandsatRasterLayer->pipe() );
+
+  QgsRasterViewPort viewPort;
+  viewPort.mTopLeftPoint = QgsPointXY( 0, 0 );
+  viewPort.mBottomRightPoint = QgsPointXY( 600, 600 );
+  viewPort.mWidth = 600;
+  viewPort.mHeight = 600;
+  viewPort.mDrawnExtent = mpLandsatRasterLayer->extent();
+  viewPort.mSrcCRS = mpLandsatRasterLayer->crs();
+  viewPort.mDestCRS = mpLandsatRasterLayer->crs();
+  const QgsMapToPixel mapToPixel;
+
+  QImage expected( 600, 600, QImage::Format_ARGB32_Premultiplied );
+  expected.fill( 0 );
+  {
+    QPainter painter( &expected );
+    QgsRasterIterator iterator( pipe.last() );
+    iterator.setMaximumTileWidth( 250 );
+    iterator.setMaximumTileHeight( 100 );
+    QgsRasterDrawer drawer( &iterator );
+    drawer.draw( &painter, &viewPort, &mapToPixel );
+  }
+
+  // local files can be read in parallel
+  QVERIFY( pipe.provider()->providerCapabilities() & QgsRasterDataProvider::ProviderHintCanReadInParallel );
+
+  // the stripe count is forced, so that stripes are drawn whatever the number of available threads,
+  // including stripes which don't match the tiles of the iterator
+  for ( const int stripes : { 2, 4, 7 } )
+  {
+    QImage image( 600, 600, QImage::Format_ARGB32_Premultiplied );
+    image.fill( 0 );
+    {
+      QPainter painter( &image );
+      QgsRasterIterator iterator( pipe.last() );
+      iterator.setMaximumTileWidth( 250 );
+      iterator.setMaximumTileHeight( 100 );
+      QgsRasterDrawer drawer( &iterator );
+      QgsRasterBlockFeedback feedback;
+      drawer.drawParallel( &painter, &viewPort, &mapToPixel, &pipe, &feedback, stripes );
+      QVERIFY( feedback.errors().isEmpty() );
+    }
+
+    QCOMPARE( image, expected );
+  }
+}
+
+void TestQgsRasterLayer::reprojectedBlocks()
+{
+  QgsRasterProjector projector;
+  projector.setInput( mpLandsatRasterLayer->dataProvider() );
+  const QgsCoordinateReferenceSystem destCrs( QStringLiteral( "EPSG:4326" ) );
+  projector.setCrs( mpLandsatRasterLayer->crs(), destCrs, QgsCoordinateTransformContext() );
+  const QgsCoordinateTransform ct( mpLandsatRasterLayer->crs(), destCrs, QgsCoordinateTransformContext() );
+  const QgsRectangle extent = ct.transformBoundingBox( mpLandsatRasterLayer->extent() );
+
+  // the second block uses the cached reprojection grid of the first one
+  projector.setPrecision( QgsRasterProjector::Approximate );
+  const int hits = QgsRasterProjector::gridCacheHits();
+  std::unique_ptr< QgsRasterBlock > block( projector.block( 1, extent, 150, 100 ) );
+  QVERIFY( block->isValid() );
+  std::unique_ptr< QgsRasterBlock > cachedBlock( projector.block( 1, extent, 150, 100 ) );
+  QCOMPARE( QgsRasterProjector::gridCacheHits(), hits + 1 );
+  QCOMPARE( cachedBlock->data(), block->data() );
+
+  // a different size must not reuse the grid
+  std::unique_ptr< QgsRasterBlock > largerBlock( projector.block( 1, extent, 300, 200 ) );
+  QCOMPARE( QgsRasterProjector::gridCacheHits(), hits + 1 );
+  QCOMPARE( largerBlock->width(), 300 );
+  QCOMPARE( largerBlock->height(), 200 );
+
+  // another projector with the same transform reuses the grid
+  QgsRasterProjector otherProjector;
+  otherProjector.setInput( mpLandsatRasterLayer->dataProvider() );
+  otherProjector.setCrs( mpLandsatRasterLayer->crs(), destCrs, QgsCoordinateTransformContext() );
+  std::unique_ptr< QgsRasterBlock > otherBlock( otherProjector.block( 1, extent, 150, 100 ) );
+  QCOMPARE( QgsRasterProjector::gridCacheHits(), hits + 2 );
+  QCOMPARE( otherBlock->data(), block->data() );
+
+  // grids larger than the cache are not kept, the block is reprojected row by row
+  std::unique_ptr< QgsRasterBlock > hugeBlock( projector.block( 1, extent, 2100, 2100 ) );
+  QVERIFY( hugeBlock->isValid() );
+  hugeBlock.reset( projector.block( 1, extent, 2100, 2100 ) );
+  QVERIFY( hugeBlock->isValid() );
+  QCOMPARE( QgsRasterProjector::gridCacheHits(), hits + 2 );
+
+  // the approximation must match the exact reprojection, except for a few pixels along the edges of source pixels
+  projector.setPrecision( QgsRasterProjector::Exact );
+  std::unique_ptr< QgsRasterBlock > exactBlock( projector.block( 1, extent, 150, 100 ) );
+  std::unique_ptr< QgsRasterBlock > otherExactBlock( projector.block( 1, extent, 150, 100 ) );
+  QCOMPARE( QgsRasterProjector::gridCacheHits(), hits + 2 );
+  QCOMPARE( otherExactBlock->data(), exactBlock->data() );
+  int differences = 0;
+  for ( int row = 0; row < 100; ++row )
+  {
+    for ( int col = 0; col < 150; ++col )
+    {
+      if ( exactBlock->value( row, col ) != block->value( row, col ) )
+        differences++;
+    }
+  }
+  QVERIFY( differences < 150 * 100 / 20 );
+}
+
+void TestQgsRasterLayer::parallelStatistics()
+{
+  const QTemporaryDir cacheDir;
+  QgsSettings().setValue( QStringLiteral( "cache/directory" ), cacheDir.path() );
+
+  const QString landsatFileName = mTestDataDir + "landsat.tif";
+  std::unique_ptr< QgsRasterLayer > layer = std::make_unique< QgsRasterLayer >( landsatFileName, QStringLiteral( "landsat" ) );
+  QVERIFY( layer->isValid() );
+
+  // statistics of a part of the raster are not calculated by GDAL but by the generic method
+  const QgsRectangle fullExtent = layer->extent();
+  const QgsRectangle extent( fullExtent.xMinimum(), fullExtent.yMinimum(), fullExtent.center().x(), fullExtent.yMaximum() );
+  const QgsRasterBandStats stats = layer->dataProvider()->bandStatistics( 1, QgsRasterBandStats::All, extent );
+
+  // compare with a sequential calculation over a single block
+  std::unique_ptr< QgsRasterBlock > block( layer->dataProvider()->block( 1, stats.extent, stats.width, stats.height ) );
+  double minimum = std::numeric_limits<double>::max();
+  double maximum = -std::numeric_limits<double>::max();
+  double sum = 0;
+  qgssize count = 0;
+  bool isNoData = false;
+  for ( qgssize i = 0; i < static_cast< qgssize >( stats.width ) * stats.height; ++i )
+  {
+    const double value = block->valueAndNoData( i, isNoData );
+    if ( isNoData )
+      continue;
+    minimum = std::min( minimum, value );
+    maximum = std::max( maximum, value );
+    sum += value;
+    count++;
+  }
+  const double mean = sum / count;
+  double squares = 0;
+  for ( qgssize i = 0; i < static_cast< qgssize >( stats.width ) * stats.height; ++i )
+  {
+    const double value = block->valueAndNoData( i, isNoData );
+    if ( !isNoData )
+      squares += ( value - mean ) * ( value - mean );
+  }
+
+  QCOMPARE( stats.elementCount, count );
+  QCOMPARE( stats.minimumValue, minimum );
+  QCOMPARE( stats.maximumValue, maximum );
+  QGSCOMPARENEAR( stats.mean, mean, 0.000000001 );
+  QGSCOMPARENEAR( stats.stdDev, std::sqrt( squares / ( count - 1 ) ), 0.000000001 );
+
+  // the histogram of the same pixels counts all of them
+  const QgsRasterHistogram histogram = layer->dataProvider()->histogram( 1, 0, stats.minimumValue, stats.maximumValue, extent );
+  QVERIFY( histogram.valid );
+  QCOMPARE( static_cast< qgssize >( histogram.nonNullCount ), count );
+  qgssize histogramCount = 0;
+  for ( int binCount : histogram.histogramVector )
+    histogramCount += binCount;
+  QCOMPARE( histogramCount, count );
+
+  // results are stored, and reused by a new layer of the same file
+  QVERIFY( !QDir( cacheDir.path() + QStringLiteral( "/rasterstats" ) ).entryList( QDir::Files ).isEmpty() );
+  layer = std::make_unique< QgsRasterLayer >( landsatFileName, QStringLiteral( "landsat" ) );
+  const QgsRasterBandStats storedStats = layer->dataProvider()->bandStatistics( 1, QgsRasterBandStats::All, extent );
+  QCOMPARE( storedStats.elementCount, stats.elementCount );
+  QCOMPARE( storedStats.mean, stats.mean );
+  QCOMPARE( storedStats.stdDev, stats.stdDev );
+  const QgsRasterHistogram storedHistogram = layer->dataProvider()->histogram( 1, 0, stats.minimumValue, stats.maximumValue, extent );
+  QVERIFY( storedHistogram.valid );
+  QCOMPARE( storedHistogram.histogramVector, histogram.histogramVector );
+
+  // other nodata values must not reuse the stored results
+  layer->dataProvider()->setUserNoDataValue( 1, QgsRasterRangeList() << QgsRasterRange( stats.minimumValue, stats.minimumValue ) );
+  const QgsRasterBandStats noDataStats = layer->dataProvider()->bandStatistics( 1, QgsRasterBandStats::All, extent );
+  QVERIFY( noDataStats.elementCount < stats.elementCount );
+
+  QgsSettings().remove( QStringLiteral( "cache/directory" ) );
+}
+
+void TestQgsRasterLayer::statisticsStoreSources()
+{
+  const QTemporaryDir cacheDir;
+  QgsSettings().setValue( QStringLiteral( "cache/directory" ), cacheDir.path() );
+
+  // a dataset with a sidecar file
+  const QTemporaryDir dataDir;
+  const QString fileName = dataDir.filePath( QStringLiteral( "landsat.tif" ) );
+  QVERIFY( QFile::copy( mTestDataDir + "landsat.tif", fileName ) );
+  const QString auxFileName = fileName + QStringLiteral( ".aux.xml" );
+  {
+    QFile auxFile( auxFileName );
+    QVERIFY( auxFile.open( QIODevice::WriteOnly ) );
+    auxFile.write( "<PAMDataset>\n</PAMDataset>\n" );
+  }
+
+  std::unique_ptr< QgsRasterLayer > layer = std::make_unique< QgsRasterLayer >( fileName, QStringLiteral( "landsat" ) );
+  QVERIFY( layer->isValid() );
+  QgsRasterBandStats stats;
+  stats.bandNumber = 1;
+  stats.extent = layer->extent();
+  stats.width = 10;
+  stats.height = 10;
+  stats.statsGathered = QgsRasterBandStats::All;
+  stats.elementCount = 100;
+  stats.mean = 42;
+
+  std::unique_ptr< QgsRasterStatisticsStore > store = QgsRasterStatisticsStore::forInterface( layer->dataProvider() );
+  QVERIFY( store );
+  store->storeStatistics( stats );
+
+  QgsRasterBandStats storedStats;
+  storedStats.bandNumber = 1;
+  storedStats.extent = stats.extent;
+  storedStats.width = 10;
+  storedStats.height = 10;
+  storedStats.statsGathered = QgsRasterBandStats::Mean;
+  QVERIFY( store->statistics( storedStats ) );
+  QCOMPARE( storedStats.mean, 42.0 );
+
+  // changing the sidecar file, but not the raster file, must drop the stored results
+  store.reset();
+  layer.reset();
+  {
+    QFile auxFile( auxFileName );
+    QVERIFY( auxFile.open( QIODevice::WriteOnly ) );
+    auxFile.write( "<PAMDataset>\n  <Metadata />\n</PAMDataset>\n" );
+  }
+  layer = std::make_unique< QgsRasterLayer >( fileName, QStringLiteral( "landsat" ) );
+  store = QgsRasterStatisticsStore::forInterface( layer->dataProvider() );
+  QVERIFY( store );
+  storedStats.mean = 0;
+  QVERIFY( !store->statistics( storedStats ) );
+
+  // the sources of VRT datasets can change without the VRT file changing, nothing is stored for them
+  const QString vrtFileName = dataDir.filePath( QStringLiteral( "landsat.vrt" ) );
+  {
+    const gdal::dataset_unique_ptr source( GDALOpen( fileName.toUtf8().constData(), GA_ReadOnly ) );
+    QVERIFY( source );
+    const gdal::dataset_unique_ptr vrt( GDALCreateCopy( GDALGetDriverByName( "VRT" ), vrtFileName.toUtf8().constData(), source.get(), FALSE, nullptr, nullptr, nullptr ) );
+    QVERIFY( vrt );
+  }
+  std::unique_ptr< QgsRasterLayer > vrtLayer = std::make_unique< QgsRasterLayer >( vrtFileName, QStringLiteral( "vrt" ) );
+  QVERIFY( vrtLayer->isValid() );
+  QVERIFY( !QgsRasterStatisticsStore::forInterface( vrtLayer->dataProvider() ) );
+
+  QgsSettings().remove( QStringLiteral( "cache/directory" ) );
+}
+
+void TestQgsRasterLayer::cubicResampling()
+{
+  QRandomGenerator generator( 42 );
+  QImage source( 200, 150, QImage::Format_ARGB32_Premultiplied );
+  for ( int y = 0; y < source.height(); ++y )
+  {
+    QRgb *line = reinterpret_cast< QRgb * >( source.scanLine( y ) );
+    for ( int x = 0; x < source.width(); ++x )
+      line[x] = qPremultiply( generator.generate() );
+  }
+
+  const QList< QSize > sizes { QSize( 63, 41 ), QSize( 200, 150 ), QSize( 517, 333 ), QSize( 1, 1 ) };
+  for ( const QSize &size : sizes )
+  {
+    const QImage scalar = QgsConvolutionImageResampler::resampleCubic( source, size, QgsConvolutionImageResampler::Implementation::Scalar );
+    QCOMPARE( scalar.size(), size );
+    QCOMPARE( scalar.format(), source.format() );
+
+    // the vectorized implementation must give exactly the same results
+    if ( QgsConvolutionImageResampler::isAvailable( QgsConvolutionImageResampler::Implementation::Avx ) )
+    {
+      const QImage avx = QgsConvolutionImageResampler::resampleCubic( source, size, QgsConvolutionImageResampler::Implementation::Avx );
+      QCOMPARE( avx, scalar );
+    }
+
+    // and results must stay close to the cubic resampling of GDAL
+    const QImage gdal = QgsGdalUtils::resampleImage( source, size, GRIORA_Cubic );
+    QCOMPARE( gdal.size(), size );
+    double difference = 0;
+    for ( int y = 0; y < size.height(); ++y )
+    {
+      const QRgb *scalarLine = reinterpret_cast< const QRgb * >( scalar.constScanLine( y ) );
+      const QRgb *gdalLine = reinterpret_cast< const QRgb * >( gdal.constScanLine( y ) );
+      for ( int x = 0; x < size.width(); ++x )
+      {
+        difference += std::abs( qRed( scalarLine[x] ) - qRed( gdalLine[x] ) ) + std::abs( qGreen( scalarLine[x] ) - qGreen( gdalLine[x] ) )
+                      + std::abs( qBlue( scalarLine[x] ) - qBlue( gdalLine[x] ) ) + std::abs( qAlpha( scalarLine[x] ) - qAlpha( gdalLine[x] ) );
+      }
+    }
+    QVERIFY( difference / ( 4.0 * size.width() * size.height() ) < 1 );
+  }
+
+  // a resampled uniform image is uniform
+  QImage uniform( 10, 10, QImage::Format_ARGB32 );
+  uniform.fill( qRgba( 10, 20, 30, 200 ) );
+  const QImage resampled = QgsConvolutionImageResampler::resampleCubic( uniform, QSize( 37, 3 ) );
+  for ( int y = 0; y < resampled.height(); ++y )
+  {
+    for ( int x = 0; x < resampled.width(); ++x )
+      QCOMPARE( resampled.pixel( x, y ), qRgba( 10, 20, 30, 200 ) );
+  }
+
+  QVERIFY( QgsConvolutionImageResampler::resampleCubic( QImage(), QSize( 10, 10 ) ).isNull() );
+}
+
 QGSTEST_MAIN( TestQgsRasterLayer )
 #include "testqgsrasterlayer.moc"
@@ -427,6 +427,99 @@ class TestQgsSpatialIndex : public QObject
       QCOMPARE( i2.nearestNeighbor( g, 2, 0.2 ), QList< QgsFeatureId >() );
     }
 
+    void testStaticIndex()
+    {
+      QgsVectorLayer vl( QStringLiteral( "Point" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      QgsFeatureList flist;
+      for ( int x = 0; x < 50; ++x )
+      {
+        for ( int y = 0; y < 50; ++y )
+        {
+          QgsFeature f;
+          f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( x, y * 0.5 ) ) );
+          flist << f;
+        }
+      }
+      vl.dataProvider()->addFeatures( flist );
+
+      QgsSpatialIndex dynamicIndex( vl.getFeatures() );
+      QgsSpatialIndex staticIndex( vl.getFeatures(), nullptr, QgsSpatialIndex::FlagStaticIndex );
+
+      const QList< QgsRectangle > rects = QList< QgsRectangle >() << QgsRectangle( 0, 0, 10, 10 )
+                                          << QgsRectangle( 2.5, 3.5, 17.2, 4.1 )
+                                          << QgsRectangle( 49, 24.5, 60, 30 )
+                                          << QgsRectangle( -10, -10, -1, -1 )
+                                          << QgsRectangle( -100, -100, 100, 100 );
+      for ( const QgsRectangle &rect : rects )
+      {
+        QList<QgsFeatureId> expected = dynamicIndex.intersects( rect );
+        QList<QgsFeatureId> fids = staticIndex.intersects( rect );
+        std::sort( expected.begin(), expected.end() );
+        std::sort( fids.begin(), fids.end() );
+        QCOMPARE( fids, expected );
+      }
+      QCOMPARE( staticIndex.intersects( QgsRectangle( -100, -100, 100, 100 ) ).count(), 2500 );
+
+      QCOMPARE( staticIndex.nearestNeighbor( QgsPointXY( 10.1, 5.1 ), 1 ), QList< QgsFeatureId >() << 511 );
+      QCOMPARE( staticIndex.nearestNeighbor( QgsPointXY( 10.1, 5.1 ), 1 ), dynamicIndex.nearestNeighbor( QgsPointXY( 10.1, 5.1 ), 1 ) );
+      QCOMPARE( staticIndex.nearestNeighbor( QgsPointXY( 10.1, 5.1 ), 2 ), QList< QgsFeatureId >() << 511 << 512 );
+      QCOMPARE( staticIndex.nearestNeighbor( QgsPointXY( 10.1, 5.1 ), 2, 0.3 ), QList< QgsFeatureId >() << 511 );
+      QCOMPARE( staticIndex.nearestNeighbor( QgsPointXY( -10, -10 ), 1, 5 ), QList< QgsFeatureId >() );
+
+      // copies share the static index, until they are modified
+      QgsSpatialIndex copy( staticIndex );
+      QVERIFY( copy.addFeature( 10000, QgsRectangle( -5, -5, -4, -4 ) ) );
+      QCOMPARE( copy.intersects( QgsRectangle( -10, -10, -1, -1 ) ), QList< QgsFeatureId >() << 10000 );
+      QCOMPARE( copy.intersects( QgsRectangle( -100, -100, 100, 100 ) ).count(), 2501 );
+      QCOMPARE( staticIndex.intersects( QgsRectangle( -100, -100, 100, 100 ) ).count(), 2500 );
+      QVERIFY( copy.deleteFeature( vl.getFeature( 1 ) ) );
+      QCOMPARE( copy.intersects( QgsRectangle( -100, -100, 100, 100 ) ).count(), 2500 );
+      QCOMPARE( staticIndex.intersects( QgsRectangle( -0.1, -0.1, 0.1, 0.1 ) ), QList< QgsFeatureId >() << 1 );
+      QVERIFY( copy.intersects( QgsRectangle( -0.1, -0.1, 0.1, 0.1 ) ).isEmpty() );
+
+      // empty static index
+      QgsSpatialIndex emptyIndex( QgsFeatureIterator(), nullptr, QgsSpatialIndex::FlagStaticIndex );
+      QVERIFY( emptyIndex.intersects( QgsRectangle( -100, -100, 100, 100 ) ).isEmpty() );
+      QVERIFY( emptyIndex.nearestNeighbor( QgsPointXY( 1, 1 ) ).isEmpty() );
+    }
+
+    void testStaticIndexNearestNeighbour()
+    {
+      QgsVectorLayer vl( QStringLiteral( "LineString" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      QgsFeature f1;
+      f1.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString(1 1, 3 1, 3 3)" ) ) );
+      QgsFeature f2;
+      f2.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString(0 1, 0 3)" ) ) );
+      QgsFeature f3;
+      f3.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString(0 4, 1 5, 3 3)" ) ) );
+      QgsFeatureList flist = QgsFeatureList() << f1 << f2 << f3;
+      vl.dataProvider()->addFeatures( flist );
+
+      QgsSpatialIndex i( vl.getFeatures(), nullptr, QgsSpatialIndex::FlagStaticIndex );
+      QgsSpatialIndex i2( vl.getFeatures(), nullptr, QgsSpatialIndex::FlagStoreFeatureGeometries | QgsSpatialIndex::FlagStaticIndex );
+
+      // i does not store feature geometries, so nearest neighbour search uses bounding box only
+      QCOMPARE( i.nearestNeighbor( QgsPointXY( 1, 2.9 ), 1 ), QList< QgsFeatureId >() << 1 );
+      QCOMPARE( i.nearestNeighbor( QgsPointXY( 1, 2.9 ), 2 ), QList< QgsFeatureId >() << 1 << 3 );
+      // i2 does store feature geometries, so nearest neighbour is exact
+      QCOMPARE( i2.nearestNeighbor( QgsPointXY( 1, 2.9 ), 1 ), QList< QgsFeatureId >() << 2 );
+      QCOMPARE( i2.nearestNeighbor( QgsPointXY( 1, 2.9 ), 2 ), QList< QgsFeatureId >() << 2 << 3 );
+
+      // with maximum distance
+      QCOMPARE( i.nearestNeighbor( QgsPointXY( 1, 2.9 ), 1, 0.5 ), QList< QgsFeatureId >() << 1 );
+      QCOMPARE( i2.nearestNeighbor( QgsPointXY( 1, 2.9 ), 1, 0.5 ), QList< QgsFeatureId >() );
+      QCOMPARE( i.nearestNeighbor( QgsPointXY( 1, 2.9 ), 2, 0.5 ), QList< QgsFeatureId >() << 1 << 3 );
+      QCOMPARE( i2.nearestNeighbor( QgsPointXY( 1, 2.9 ), 2, 0.5 ), QList< QgsFeatureId >() );
+      QCOMPARE( i2.nearestNeighbor( QgsPointXY( 1, 2.9 ), 2, 1.1 ), QList< QgsFeatureId >() << 2 );
+      QCOMPARE( i2.nearestNeighbor( QgsPointXY( 1, 2.9 ), 2, 2 ), QList< QgsFeatureId >() << 2 << 3 );
+
+      // using geometries as input, not points
+      QgsGeometry g = QgsGeometry::fromWkt( QStringLiteral( "LineString (1 0, 1 -1, -2 -1, -2 7, 5 4, 5 0)" ) );
+      QCOMPARE( i2.nearestNeighbor( g, 1 ), QList< QgsFeatureId >() << 3 );
+      QCOMPARE( i2.nearestNeighbor( g, 2 ), QList< QgsFeatureId >() << 3 << 1 );
+      QCOMPARE( i2.nearestNeighbor( g, 2, 0.2 ), QList< QgsFeatureId >() );
+    }
+
 };
 
 QGSTEST_MAIN( TestQgsSpatialIndex )
@@ -0,0 +1,193 @@
+/***************************************************************************
+                         testqgstilestore.cpp
+                         ----------------------
+    begin                : October 2021
+    copyright            : (C) 2021 by Nyall Dawson
+    email                : nyall dot dawson at gmail dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+#include <QObject>
+#include <QTemporaryDir>
+#include <QUrl>
+
+#include "qgsapplication.h"
+#include "qgstilestore.h"
+#include "qgstilecache.h"
+
+class TestQgsTileStore : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+
+    void testStoreAndRetrieve();
+    void testPersistence();
+    void testEviction();
+    void testMaximumAge();
+    void testExpiration();
+    void testForUrl();
+    void testTileCacheControl();
+};
+
+
+void TestQgsTileStore::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void TestQgsTileStore::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsTileStore::testStoreAndRetrieve()
+{
+  QTemporaryDir dir;
+  QgsTileStore store( dir.filePath( QStringLiteral( "tiles.sqlite" ) ), 1024 * 1024 );
+  QVERIFY( store.isValid() );
+  QCOMPARE( store.totalSize(), 0LL );
+
+  QByteArray data;
+  QVERIFY( !store.tileData( QStringLiteral( "tile1" ), data ) );
+
+  QVERIFY( store.storeTileData( QStringLiteral( "tile1" ), QByteArray( 100, 'a' ) ) );
+  QVERIFY( store.storeTileData( QStringLiteral( "tile2" ), QByteArray( 50, 'b' ) ) );
+  QCOMPARE( store.totalSize(), 150LL );
+
+  QVERIFY( store.tileData( QStringLiteral( "tile1" ), data ) );
+  QCOMPARE( data, QByteArray( 100, 'a' ) );
+
+  // replacing data of a tile
+  QVERIFY( store.storeTileData( QStringLiteral( "tile1" ), QByteArray( 10, 'c' ) ) );
+  QCOMPARE( store.totalSize(), 60LL );
+  QVERIFY( store.tileData( QStringLiteral( "tile1" ), data ) );
+  QCOMPARE( data, QByteArray( 10, 'c' ) );
+
+  store.clear();
+  QCOMPARE( store.totalSize(), 0LL );
+  QVERIFY( !store.tileData( QStringLiteral( "tile1" ), data ) );
+}
+
+void TestQgsTileStore::testPersistence()
+{
+  QTemporaryDir dir;
+  const QString path = dir.filePath( QStringLiteral( "tiles.sqlite" ) );
+  {
+    QgsTileStore store( path, 1024 * 1024 );
+    QVERIFY( store.storeTileData( QStringLiteral( "tile1" ), QByteArray( 100, 'a' ) ) );
+  }
+
+  QgsTileStore store( path, 1024 * 1024 );
+  QCOMPARE( store.totalSize(), 100LL );
+  QByteArray data;
+  QVERIFY( store.tileData( QStringLiteral( "tile1" ), data ) );
+  QCOMPARE( data, QByteArray( 100, 'a' ) );
+}
+
+void TestQgsTileStore::testEviction()
+{
+  QTemporaryDir dir;
+  QgsTileStore store( dir.filePath( QStringLiteral( "tiles.sqlite" ) ), 1000 );
+
+  QVERIFY( store.storeTileData( QStringLiteral( "tile1" ), QByteArray( 400, 'a' ) ) );
+  QVERIFY( store.storeTileData( QStringLiteral( "tile2" ), QByteArray( 400, 'b' ) ) );
+  QCOMPARE( store.totalSize(), 800LL );
+
+  // too large for the store
+  QVERIFY( !store.storeTileData( QStringLiteral( "big" ), QByteArray( 2000, 'c' ) ) );
+
+  // exceeding the maximum size evicts tiles
+  QVERIFY( store.storeTileData( QStringLiteral( "tile3" ), QByteArray( 400, 'c' ) ) );
+  QVERIFY( store.totalSize() <= 1000 );
+  QByteArray data;
+  QVERIFY( store.tileData( QStringLiteral( "tile3" ), data ) );
+
+  store.setMaximumSize( 100 );
+  QCOMPARE( store.totalSize(), 0LL );
+}
+
+void TestQgsTileStore::testMaximumAge()
+{
+  QTemporaryDir dir;
+  QgsTileStore store( dir.filePath( QStringLiteral( "tiles.sqlite" ) ), 1024 * 1024 );
+  QVERIFY( store.storeTileData( QStringLiteral( "tile1" ), QByteArray( 100, 'a' ) ) );
+
+  QByteArray data;
+  QVERIFY( store.tileData( QStringLiteral( "tile1" ), data ) );
+  store.setMaximumAge( -10 );
+  QVERIFY( !store.tileData( QStringLiteral( "tile1" ), data ) );
+}
+
+void TestQgsTileStore::testExpiration()
+{
+  QTemporaryDir dir;
+  QgsTileStore store( dir.filePath( QStringLiteral( "tiles.sqlite" ) ), 1024 * 1024 );
+
+  // already expired tiles are not stored
+  QVERIFY( !store.storeTileData( QStringLiteral( "expired" ), QByteArray( 100, 'a' ), QDateTime::currentDateTimeUtc().addSecs( -10 ) ) );
+  QCOMPARE( store.totalSize(), 0LL );
+
+  QVERIFY( store.storeTileData( QStringLiteral( "tile1" ), QByteArray( 100, 'a' ), QDateTime::currentDateTimeUtc().addSecs( 3600 ) ) );
+  QByteArray data;
+  QVERIFY( store.tileData( QStringLiteral( "tile1" ), data ) );
+  QCOMPARE( data, QByteArray( 100, 'a' ) );
+}
+
+void TestQgsTileStore::testForUrl()
+{
+  QVERIFY( !QgsTileStore::forUrl( QUrl( QStringLiteral( "file:///tmp/tiles/0/0/0.png" ) ) ) );
+
+  // all remote sources share a single store, with a single size budget
+  QgsTileStore *store = QgsTileStore::forUrl( QUrl( QStringLiteral( "https://tile.example.com/0/0/0.png" ) ) );
+  QVERIFY( store );
+  QCOMPARE( store, QgsTileStore::sharedStore() );
+  QCOMPARE( QgsTileStore::forUrl( QUrl( QStringLiteral( "https://tile.example.com/1/0/0.png" ) ) ), store );
+  QCOMPARE( QgsTileStore::forUrl( QUrl( QStringLiteral( "http://other.example.com:8080/0/0/0.png" ) ) ), store );
+}
+
+void TestQgsTileStore::testTileCacheControl()
+{
+  QgsTileStore *store = QgsTileStore::sharedStore();
+  QVERIFY( store );
+
+  const QUrl url( QStringLiteral( "https://tile.example.com/cache-control/0/0/0.png" ) );
+  const QUrl noStoreUrl( QStringLiteral( "https://tile.example.com/cache-control/0/0/1.png" ) );
+  const QUrl noCacheUrl( QStringLiteral( "https://tile.example.com/cache-control/0/0/2.png" ) );
+  const QUrl expiredUrl( QStringLiteral( "https://tile.example.com/cache-control/0/0/3.png" ) );
+  const QUrl maxAgeUrl( QStringLiteral( "https://tile.example.com/cache-control/0/0/4.png" ) );
+  QgsTileCache::insertTileData( url, QByteArray( 10, 'a' ) );
+  QgsTileCache::insertTileData( noStoreUrl, QByteArray( 10, 'b' ), QByteArrayLiteral( "public, no-store" ) );
+  QgsTileCache::insertTileData( noCacheUrl, QByteArray( 10, 'c' ), QByteArrayLiteral( "No-Cache" ) );
+  QgsTileCache::insertTileData( expiredUrl, QByteArray( 10, 'd' ), QByteArrayLiteral( "max-age=0" ) );
+  QgsTileCache::insertTileData( maxAgeUrl, QByteArray( 10, 'e' ), QByteArrayLiteral( "public, max-age=3600" ) );
+
+  QByteArray data;
+  QVERIFY( store->tileData( url.toString(), data ) );
+  QVERIFY( !store->tileData( noStoreUrl.toString(), data ) );
+  QVERIFY( !store->tileData( noCacheUrl.toString(), data ) );
+  QVERIFY( !store->tileData( expiredUrl.toString(), data ) );
+  QVERIFY( store->tileData( maxAgeUrl.toString(), data ) );
+  QCOMPARE( data, QByteArray( 10, 'e' ) );
+
+  // clearing the tile cache, as done by the "Clear cache" button of the network options, clears the store too
+  QgsTileCache::clear();
+  QCOMPARE( QgsTileCache::totalCost(), 0 );
+  QCOMPARE( store->totalSize(), 0LL );
+  QVERIFY( !store->tileData( url.toString(), data ) );
+}
+
+QGSTEST_MAIN( TestQgsTileStore )
+#include "testqgstilestore.moc"
@@ -28,6 +28,8 @@
 #include "qgsfontutils.h"
 #include "qgslinesymbollayer.h"
 #include "qgslinesymbol.h"
+#include "qgsvectortilefeaturecache.h"
+#include "qgsmaprenderersequentialjob.h"
 
 /**
  * \ingroup UnitTests
@@ -57,6 +59,7 @@ class TestQgsVectorTileLayer : public QObject
     void test_basic();
     void test_render();
     void test_render_withClip();
+    void test_renderCachedTiles();
     void test_labeling();
     void test_relativePaths();
     void test_polygonWithLineStyle();
@@ -165,6 +168,43 @@ void TestQgsVectorTileLayer::test_render_withClip()
   QVERIFY( res );
 }
 
+void TestQgsVectorTileLayer::test_renderCachedTiles()
+{
+  // first render decodes the tiles and fills the cache
+  QgsVectorTileFeatureCache::clear();
+  QVERIFY( imageCheck( "render_test_basic", mLayer, mLayer->extent() ) );
+  const QStringList keys = QgsVectorTileFeatureCache::keys();
+  QVERIFY( !keys.isEmpty() );
+
+  // second render must draw the cached features: replace them by empty tiles, so nothing gets drawn
+  for ( const QString &key : keys )
+    QgsVectorTileFeatureCache::storeFeatures( key, QgsVectorTileFeatures(), 1 );
+  QgsMapRendererSequentialJob job( *mMapSettings );
+  job.start();
+  job.waitForFinished();
+  const QImage image = job.renderedImage();
+  bool empty = true;
+  for ( int y = 0; y < image.height() && empty; ++y )
+  {
+    for ( int x = 0; x < image.width() && empty; ++x )
+      empty = image.pixel( x, y ) == mMapSettings->backgroundColor().rgb();
+  }
+  QVERIFY( empty );
+
+  // changing the source of the layer drops its cached tiles
+  mLayer->setDataSource( mLayer->source(), mLayer->name(), mLayer->providerType() );
+  QVERIFY( mLayer->isValid() );
+  QVERIFY( QgsVectorTileFeatureCache::keys().isEmpty() );
+  QVERIFY( imageCheck( "render_test_basic", mLayer, mLayer->extent() ) );
+  QVERIFY( !QgsVectorTileFeatureCache::keys().isEmpty() );
+
+  // without cache budget tiles are always decoded
+  const int maximumCacheSize = QgsVectorTileFeatureCache::maximumCacheSize();
+  QgsVectorTileFeatureCache::setMaximumCacheSize( 0 );
+  QVERIFY( imageCheck( "render_test_basic", mLayer, mLayer->extent() ) );
+  QgsVectorTileFeatureCache::setMaximumCacheSize( maximumCacheSize );
+}
+
 void TestQgsVectorTileLayer::test_labeling()
 {
   QgsTextFormat format;
@@ -28,6 +28,7 @@
 #include "qgsvectortilewriter.h"
 
 #include <QTemporaryDir>
+#include <QThreadPool>
 
 /**
  * \ingroup UnitTests
@@ -54,6 +55,10 @@ class TestQgsVectorTileWriter : public QObject
     void test_mbtiles();
     void test_mbtiles_metadata();
     void test_filtering();
+    void test_parallel();
+
+  private:
+    bool writeTiles( const QString &uri, const QList<QgsVectorTileWriter::Layer> &layers, int maxZoom );
 };
 
 
@@ -315,6 +320,113 @@ void TestQgsVectorTileWriter::test_filtering()
   QCOMPARE( features0["polys"].count(), 0 );
 }
 
+bool TestQgsVectorTileWriter::writeTiles( const QString &uri, const QList<QgsVectorTileWriter::Layer> &layers, int maxZoom )
+{
+  QgsVectorTileWriter writer;
+  writer.setDestinationUri( uri );
+  writer.setMaxZoom( maxZoom );
+  writer.setLayers( layers );
+  return writer.writeTiles() && writer.errorMessage().isEmpty();
+}
+
+void TestQgsVectorTileWriter::test_parallel()
+{
+  // tiles encoded by several threads must match the ones encoded by a single thread, at zoom
+  // levels where the tiles are processed in several blocks too
+
+  QTemporaryDir dir;
+  const QString tmpDir = dir.path();
+  const int maxZoom = 7;
+
+  std::unique_ptr< QgsVectorLayer > vlPoints = std::make_unique< QgsVectorLayer >( mDataDir + "/points.shp", "points", "ogr" );
+  std::unique_ptr< QgsVectorLayer > vlLines = std::make_unique< QgsVectorLayer >( mDataDir + "/lines.shp", "lines", "ogr" );
+  std::unique_ptr< QgsVectorLayer > vlPolys = std::make_unique< QgsVectorLayer >( mDataDir + "/polys.shp", "polys", "ogr" );
+
+  QList<QgsVectorTileWriter::Layer> layers;
+  layers << QgsVectorTileWriter::Layer( vlPoints.get() );
+  layers << QgsVectorTileWriter::Layer( vlLines.get() );
+  layers << QgsVectorTileWriter::Layer( vlPolys.get() );
+  layers[1].setMaxZoom( 5 );
+
+  QgsVectorTileWriter extentWriter;
+  extentWriter.setLayers( layers );
+  const QgsRectangle extent = extentWriter.fullExtent();
+
+  QMap<QString, QgsFields> perLayerFields;
+  perLayerFields["points"] = QgsFields();
+  perLayerFields["lines"] = QgsFields();
+  perLayerFields["polys"] = QgsFields();
+
+  const int maxThreads = QThreadPool::globalInstance()->maxThreadCount();
+  const QStringList types = QStringList() << "xyz" << "mbtiles";
+  for ( const QString &type : types )
+  {
+    QgsDataSourceUri dsSingle;
+    QgsDataSourceUri dsParallel;
+    dsSingle.setParam( "type", type );
+    dsParallel.setParam( "type", type );
+    if ( type == QLatin1String( "xyz" ) )
+    {
+      dsSingle.setParam( "url", QUrl::fromLocalFile( tmpDir + "/single" ).toString() + "/{z}-{x}-{y}.pbf" );
+      dsParallel.setParam( "url", QUrl::fromLocalFile( tmpDir + "/parallel" ).toString() + "/{z}-{x}-{y}.pbf" );
+    }
+    else
+    {
+      dsSingle.setParam( "url", tmpDir + "/single.mbtiles" );
+      dsParallel.setParam( "url", tmpDir + "/parallel.mbtiles" );
+    }
+
+    QThreadPool::globalInstance()->setMaxThreadCount( 1 );
+    const bool resSingle = writeTiles( dsSingle.encodedUri(), layers, maxZoom );
+    QThreadPool::globalInstance()->setMaxThreadCount( std::max( 4, maxThreads ) );
+    const bool resParallel = writeTiles( dsParallel.encodedUri(), layers, maxZoom );
+    QThreadPool::globalInstance()->setMaxThreadCount( maxThreads );
+    QVERIFY( resSingle );
+    QVERIFY( resParallel );
+
+    std::unique_ptr< QgsVectorTileLayer > vtSingle = std::make_unique< QgsVectorTileLayer >( dsSingle.encodedUri(), "single" );
+    std::unique_ptr< QgsVectorTileLayer > vtParallel = std::make_unique< QgsVectorTileLayer >( dsParallel.encodedUri(), "parallel" );
+
+    QMap< QString, int > featuresCountSingle;
+    QMap< QString, int > featuresCountParallel;
+    int tilesCount = 0;
+    for ( int zoomLevel = 0; zoomLevel <= maxZoom; ++zoomLevel )
+    {
+      QgsTileMatrix tileMatrix = QgsTileMatrix::fromWebMercator( zoomLevel );
+      const QgsTileRange tileRange = tileMatrix.tileRangeFromExtent( extent );
+      for ( int row = tileRange.startRow(); row <= tileRange.endRow(); ++row )
+      {
+        for ( int col = tileRange.startColumn(); col <= tileRange.endColumn(); ++col )
+        {
+          const QgsTileXYZ tileID( col, row, zoomLevel );
+          const QByteArray tileSingle = vtSingle->getRawTile( tileID );
+          const QByteArray tileParallel = vtParallel->getRawTile( tileID );
+          QCOMPARE( tileParallel, tileSingle );
+          if ( tileSingle.isEmpty() )
+            continue;
+
+          ++tilesCount;
+          QgsVectorTileMVTDecoder decoderSingle;
+          QgsVectorTileMVTDecoder decoderParallel;
+          QVERIFY( decoderSingle.decode( tileID, tileSingle ) );
+          QVERIFY( decoderParallel.decode( tileID, tileParallel ) );
+          const QgsVectorTileFeatures featuresSingle = decoderSingle.layerFeatures( perLayerFields, QgsCoordinateTransform() );
+          const QgsVectorTileFeatures featuresParallel = decoderParallel.layerFeatures( perLayerFields, QgsCoordinateTransform() );
+          for ( auto it = featuresSingle.constBegin(); it != featuresSingle.constEnd(); ++it )
+            featuresCountSingle[it.key()] += it.value().count();
+          for ( auto it = featuresParallel.constBegin(); it != featuresParallel.constEnd(); ++it )
+            featuresCountParallel[it.key()] += it.value().count();
+        }
+      }
+    }
+
+    QVERIFY( tilesCount > 0 );
+    QCOMPARE( featuresCountParallel, featuresCountSingle );
+    QVERIFY( featuresCountSingle.value( "points" ) > 0 );
+    QVERIFY( featuresCountSingle.value( "lines" ) > 0 );
+    QVERIFY( featuresCountSingle.value( "polys" ) > 0 );
+  }
+}
 
 QGSTEST_MAIN( TestQgsVectorTileWriter )
 #include "testqgsvectortilewriter.moc"
@@ -0,0 +1,390 @@
+/***************************************************************************
+     testqgscopcprovider.cpp
+     --------------------------------------
+    Date                 : October 2021
+    Copyright            : (C) 2021 by Nyall Dawson
+    Email                : nyall dot dawson at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+#include <QObject>
+#include <QString>
+
+//qgis includes...
+#include "qgis.h"
+#include "qgsapplication.h"
+#include "qgsproviderregistry.h"
+#include "qgscopcprovider.h"
+#include "qgspointcloudlayer.h"
+#include "qgspointcloudindex.h"
+#include "qgspointcloudrequest.h"
+#include "qgspointcloudblock.h"
+#include "qgspointcloudstatistics.h"
+
+#include <QTemporaryDir>
+#include <numeric>
+#include <QtEndian>
+
+/**
+ * \ingroup UnitTests
+ * This is a unit test for the COPC provider
+ */
+class TestQgsCopcProvider : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init() {}// will be called before each testfunction is executed.
+    void cleanup() {}// will be called after every testfunction.
+
+    void filters();
+    void encodeUri();
+    void decodeUri();
+    void preferredUri();
+    void layerTypesForUri();
+    void brokenPath();
+    void notCopcFile();
+    void validLayer();
+    void hierarchy();
+    void nodeData();
+    void unsupportedPointFormat();
+    void hierarchyCycle();
+    void calculateStatistics();
+
+  private:
+    QString mTestDataDir;
+};
+
+//runs before all tests
+void TestQgsCopcProvider::initTestCase()
+{
+  // init QGIS's paths - true means that all path will be inited from prefix
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mTestDataDir = QStringLiteral( TEST_DATA_DIR ) + '/'; //defined in CmakeLists.txt
+}
+
+//runs after all tests
+void TestQgsCopcProvider::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsCopcProvider::filters()
+{
+  QgsProviderMetadata *metadata = QgsProviderRegistry::instance()->providerMetadata( QStringLiteral( "copc" ) );
+  QVERIFY( metadata );
+
+  QCOMPARE( metadata->filters( QgsProviderMetadata::FilterType::FilterPointCloud ), QStringLiteral( "COPC Point Clouds (*.copc.laz *.COPC.LAZ)" ) );
+  QCOMPARE( metadata->filters( QgsProviderMetadata::FilterType::FilterVector ), QString() );
+
+  const QString registryPointCloudFilters = QgsProviderRegistry::instance()->filePointCloudFilters();
+  QVERIFY( registryPointCloudFilters.contains( "(*.copc.laz *.COPC.LAZ)" ) );
+}
+
+void TestQgsCopcProvider::encodeUri()
+{
+  QgsProviderMetadata *metadata = QgsProviderRegistry::instance()->providerMetadata( QStringLiteral( "copc" ) );
+  QVERIFY( metadata );
+
+  QVariantMap parts;
+  parts.insert( QStringLiteral( "path" ), QStringLiteral( "/home/point_clouds/cloud.copc.laz" ) );
+  QCOMPARE( metadata->encodeUri( parts ), QStringLiteral( "/home/point_clouds/cloud.copc.laz" ) );
+}
+
+void TestQgsCopcProvider::decodeUri()
+{
+  QgsProviderMetadata *metadata = QgsProviderRegistry::instance()->providerMetadata( QStringLiteral( "copc" ) );
+  QVERIFY( metadata );
+
+  const QVariantMap parts = metadata->decodeUri( QStringLiteral( "/home/point_clouds/cloud.copc.laz" ) );
+  QCOMPARE( parts.value( QStringLiteral( "path" ) ).toString(), QStringLiteral( "/home/point_clouds/cloud.copc.laz" ) );
+}
+
+void TestQgsCopcProvider::preferredUri()
+{
+  QgsProviderMetadata *copcMetadata = QgsProviderRegistry::instance()->providerMetadata( QStringLiteral( "copc" ) );
+  QVERIFY( copcMetadata->capabilities() & QgsProviderMetadata::PriorityForUri );
+
+  QList<QgsProviderRegistry::ProviderCandidateDetails> candidates = QgsProviderRegistry::instance()->preferredProvidersForUri( QStringLiteral( "/home/test/cloud.copc.laz" ) );
+  QCOMPARE( candidates.size(), 1 );
+  QCOMPARE( candidates.at( 0 ).metadata()->key(), QStringLiteral( "copc" ) );
+  QCOMPARE( candidates.at( 0 ).layerTypes(), QList< QgsMapLayerType >() << QgsMapLayerType::PointCloudLayer );
+
+  candidates = QgsProviderRegistry::instance()->preferredProvidersForUri( QStringLiteral( "/home/test/CLOUD.COPC.LAZ" ) );
+  QCOMPARE( candidates.size(), 1 );
+  QCOMPARE( candidates.at( 0 ).metadata()->key(), QStringLiteral( "copc" ) );
+
+  QCOMPARE( copcMetadata->priorityForUri( QStringLiteral( "/home/test/cloud.copc.laz" ) ), 110 );
+
+  // plain LAZ files are left to other providers
+  candidates = QgsProviderRegistry::instance()->preferredProvidersForUri( QStringLiteral( "/home/test/cloud.laz" ) );
+  for ( const QgsProviderRegistry::ProviderCandidateDetails &candidate : std::as_const( candidates ) )
+    QVERIFY( candidate.metadata()->key() != QLatin1String( "copc" ) );
+}
+
+void TestQgsCopcProvider::layerTypesForUri()
+{
+  QgsProviderMetadata *copcMetadata = QgsProviderRegistry::instance()->providerMetadata( QStringLiteral( "copc" ) );
+  QVERIFY( copcMetadata->capabilities() & QgsProviderMetadata::LayerTypesForUri );
+
+  QCOMPARE( copcMetadata->validLayerTypesForUri( QStringLiteral( "/home/test/cloud.copc.laz" ) ), QList< QgsMapLayerType >() << QgsMapLayerType::PointCloudLayer );
+  QCOMPARE( copcMetadata->validLayerTypesForUri( QStringLiteral( "/home/test/cloud.laz" ) ), QList< QgsMapLayerType >() );
+  QCOMPARE( copcMetadata->validLayerTypesForUri( QStringLiteral( "/home/test/ept.json" ) ), QList< QgsMapLayerType >() );
+}
+
+void TestQgsCopcProvider::brokenPath()
+{
+  // test loading a bad layer URI
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( QStringLiteral( "not valid" ), QStringLiteral( "layer" ), QStringLiteral( "copc" ) );
+  QVERIFY( !layer->isValid() );
+}
+
+void TestQgsCopcProvider::notCopcFile()
+{
+  // a LAS file without the COPC info record can't be opened by the provider
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/las/cloud.las" ), QStringLiteral( "layer" ), QStringLiteral( "copc" ) );
+  QVERIFY( !layer->isValid() );
+}
+
+void TestQgsCopcProvider::validLayer()
+{
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/copc/sample.copc.laz" ), QStringLiteral( "layer" ), QStringLiteral( "copc" ) );
+  QVERIFY( layer->isValid() );
+
+  QCOMPARE( layer->dataProvider()->pointCount(), 35 );
+  QCOMPARE( layer->pointCount(), 35 );
+  QGSCOMPARENEAR( layer->extent().xMinimum(), 5.0, 0.001 );
+  QGSCOMPARENEAR( layer->extent().yMinimum(), 5.0, 0.001 );
+  QGSCOMPARENEAR( layer->extent().xMaximum(), 114.0, 0.001 );
+  QGSCOMPARENEAR( layer->extent().yMaximum(), 112.0, 0.001 );
+  QCOMPARE( layer->dataProvider()->originalMetadata().value( QStringLiteral( "dataformat_id" ) ).toInt(), 7 );
+  QCOMPARE( layer->dataProvider()->originalMetadata().value( QStringLiteral( "minor_version" ) ).toInt(), 4 );
+
+  QVERIFY( layer->attributes().indexOf( QStringLiteral( "Red" ) ) >= 0 );
+  QVERIFY( layer->attributes().indexOf( QStringLiteral( "Classification" ) ) >= 0 );
+  QVERIFY( layer->attributes().indexOf( QStringLiteral( "Infrared" ) ) < 0 );
+}
+
+void TestQgsCopcProvider::hierarchy()
+{
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/copc/sample.copc.laz" ), QStringLiteral( "layer" ), QStringLiteral( "copc" ) );
+  QVERIFY( layer->isValid() );
+  QgsPointCloudIndex *index = layer->dataProvider()->index();
+  QVERIFY( index );
+
+  // the entry of node 1-1-1-1 is stored in a child page of the hierarchy
+  const IndexedPointCloudNode root = index->root();
+  QVERIFY( index->hasNode( root ) );
+  QVERIFY( index->hasNode( IndexedPointCloudNode::fromString( QStringLiteral( "1-0-0-0" ) ) ) );
+  QVERIFY( index->hasNode( IndexedPointCloudNode::fromString( QStringLiteral( "1-1-1-1" ) ) ) );
+  QVERIFY( !index->hasNode( IndexedPointCloudNode::fromString( QStringLiteral( "1-0-0-1" ) ) ) );
+  QVERIFY( !index->hasNode( IndexedPointCloudNode::fromString( QStringLiteral( "2-0-0-0" ) ) ) );
+
+  QList< IndexedPointCloudNode > children = index->nodeChildren( root );
+  std::sort( children.begin(), children.end(), []( const IndexedPointCloudNode & a, const IndexedPointCloudNode & b ) { return a.toString() < b.toString(); } );
+  QCOMPARE( children.size(), 2 );
+  QCOMPARE( children.at( 0 ).toString(), QStringLiteral( "1-0-0-0" ) );
+  QCOMPARE( children.at( 1 ).toString(), QStringLiteral( "1-1-1-1" ) );
+
+  QCOMPARE( index->nodePointCount( root ), 20 );
+  QCOMPARE( index->nodePointCount( IndexedPointCloudNode::fromString( QStringLiteral( "1-0-0-0" ) ) ), 10 );
+  QCOMPARE( index->nodePointCount( IndexedPointCloudNode::fromString( QStringLiteral( "1-1-1-1" ) ) ), 5 );
+}
+
+void TestQgsCopcProvider::nodeData()
+{
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/copc/sample.copc.laz" ), QStringLiteral( "layer" ), QStringLiteral( "copc" ) );
+  QVERIFY( layer->isValid() );
+  QgsPointCloudIndex *index = layer->dataProvider()->index();
+
+  QgsPointCloudRequest request;
+  request.setAttributes( layer->attributes() );
+
+  // the chunks are not stored in the order of the hierarchy entries (1-1-1-1, 0-0-0-0 then 1-0-0-0),
+  // so a node only gets its own points back if the offset of its chunk is used.
+  // The points use the point format 7 (layered compression). Point i of a node is stored as
+  // X = base + 100 * i, Y = base + 50 * i, Z = base + 10 * i, Intensity = 100 * node number + i,
+  // 2 returns with ReturnNumber = 1 + i % 2, Classification = 40 + node number, ScanAngleRank = 0.6 * i degrees,
+  // UserData = i, PointSourceId = node number + 1, Red = 256 * i, Green = 1000 * node number and Blue = 65535 - i
+  struct ExpectedNode
+  {
+    QString node;
+    int pointCount;
+    int number;
+    int base;
+  };
+  const QList< ExpectedNode > expectedNodes
+  {
+    { QStringLiteral( "0-0-0-0" ), 20, 0, 500 },
+    { QStringLiteral( "1-0-0-0" ), 10, 1, 1000 },
+    { QStringLiteral( "1-1-1-1" ), 5, 2, 11000 },
+  };
+
+  for ( const ExpectedNode &expected : expectedNodes )
+  {
+    std::unique_ptr< QgsPointCloudBlock > block( index->nodeData( IndexedPointCloudNode::fromString( expected.node ), request ) );
+    QVERIFY( block );
+    QCOMPARE( block->pointCount(), expected.pointCount );
+    QCOMPARE( block->scale(), QgsVector3D( 0.01, 0.01, 0.01 ) );
+
+    const QgsPointCloudAttributeCollection attributes = block->attributes();
+    const int recordSize = attributes.pointRecordSize();
+    int xOffset = 0;
+    int yOffset = 0;
+    int zOffset = 0;
+    int intensityOffset = 0;
+    int returnNumberOffset = 0;
+    int numberOfReturnsOffset = 0;
+    int classificationOffset = 0;
+    int scanAngleOffset = 0;
+    int userDataOffset = 0;
+    int pointSourceIdOffset = 0;
+    int redOffset = 0;
+    int greenOffset = 0;
+    int blueOffset = 0;
+    QVERIFY( attributes.find( QStringLiteral( "X" ), xOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "Y" ), yOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "Z" ), zOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "Intensity" ), intensityOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "ReturnNumber" ), returnNumberOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "NumberOfReturns" ), numberOfReturnsOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "Classification" ), classificationOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "ScanAngleRank" ), scanAngleOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "UserData" ), userDataOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "PointSourceId" ), pointSourceIdOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "Red" ), redOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "Green" ), greenOffset ) );
+    QVERIFY( attributes.find( QStringLiteral( "Blue" ), blueOffset ) );
+
+    for ( int i = 0; i < block->pointCount(); ++i )
+    {
+      const char *point = block->data() + static_cast< std::size_t >( i ) * recordSize;
+      qint32 x;
+      qint32 y;
+      qint32 z;
+      quint16 intensity;
+      float scanAngle;
+      quint16 pointSourceId;
+      quint16 red;
+      quint16 green;
+      quint16 blue;
+      memcpy( &x, point + xOffset, sizeof( qint32 ) );
+      memcpy( &y, point + yOffset, sizeof( qint32 ) );
+      memcpy( &z, point + zOffset, sizeof( qint32 ) );
+      memcpy( &intensity, point + intensityOffset, sizeof( quint16 ) );
+      memcpy( &scanAngle, point + scanAngleOffset, sizeof( float ) );
+      memcpy( &pointSourceId, point + pointSourceIdOffset, sizeof( quint16 ) );
+      memcpy( &red, point + redOffset, sizeof( quint16 ) );
+      memcpy( &green, point + greenOffset, sizeof( quint16 ) );
+      memcpy( &blue, point + blueOffset, sizeof( quint16 ) );
+      QCOMPARE( x, expected.base + 100 * i );
+      QCOMPARE( y, expected.base + 50 * i );
+      QCOMPARE( z, expected.base + 10 * i );
+      QCOMPARE( static_cast< int >( intensity ), 100 * expected.number + i );
+      QCOMPARE( static_cast< int >( point[returnNumberOffset] ), 1 + i % 2 );
+      QCOMPARE( static_cast< int >( point[numberOfReturnsOffset] ), 2 );
+      QCOMPARE( static_cast< int >( point[classificationOffset] ), 40 + expected.number );
+      QGSCOMPARENEAR( scanAngle, 0.6 * i, 0.0001 );
+      QCOMPARE( static_cast< int >( point[userDataOffset] ), i );
+      QCOMPARE( static_cast< int >( pointSourceId ), expected.number + 1 );
+      QCOMPARE( static_cast< int >( red ), 256 * i );
+      QCOMPARE( static_cast< int >( green ), 1000 * expected.number );
+      QCOMPARE( static_cast< int >( blue ), 65535 - i );
+    }
+  }
+
+  // nodes without a chunk have no data
+  QVERIFY( !index->nodeData( IndexedPointCloudNode::fromString( QStringLiteral( "2-0-0-0" ) ), request ) );
+}
+
+void TestQgsCopcProvider::unsupportedPointFormat()
+{
+  // a copy of the sample, flagged with the point format 9 (compressed), which the decoder can not handle
+  QTemporaryDir dir;
+  QVERIFY( dir.isValid() );
+  const QString fileName = dir.filePath( QStringLiteral( "format9.copc.laz" ) );
+  QVERIFY( QFile::copy( mTestDataDir + QStringLiteral( "point_clouds/copc/sample.copc.laz" ), fileName ) );
+  QFile file( fileName );
+  QVERIFY( file.open( QIODevice::ReadWrite ) );
+  QVERIFY( file.seek( 104 ) );
+  QCOMPARE( file.write( QByteArray( 1, static_cast< char >( 0x89 ) ) ), 1LL );
+  file.close();
+
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( fileName, QStringLiteral( "layer" ), QStringLiteral( "copc" ) );
+  QVERIFY( !layer->isValid() );
+}
+
+void TestQgsCopcProvider::hierarchyCycle()
+{
+  // a copy of the sample where the root hierarchy page refers to itself instead of to its child page
+  QTemporaryDir dir;
+  QVERIFY( dir.isValid() );
+  const QString fileName = dir.filePath( QStringLiteral( "cycle.copc.laz" ) );
+  QVERIFY( QFile::copy( mTestDataDir + QStringLiteral( "point_clouds/copc/sample.copc.laz" ), fileName ) );
+  QFile file( fileName );
+  QVERIFY( file.open( QIODevice::ReadWrite ) );
+  // the hierarchy pages are stored at the end of the file: the root page with 3 entries, then the child page with 1 entry
+  const qint64 rootPageOffset = file.size() - 4 * 32;
+  // offset field of the third entry of the root page
+  QVERIFY( file.seek( rootPageOffset + 2 * 32 + 16 ) );
+  const quint64 offset = qToLittleEndian( static_cast< quint64 >( rootPageOffset ) );
+  QCOMPARE( file.write( reinterpret_cast< const char * >( &offset ), sizeof( quint64 ) ), static_cast< qint64 >( sizeof( quint64 ) ) );
+  file.close();
+
+  // the page is only read once, so loading finishes without the nodes of the child page
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( fileName, QStringLiteral( "layer" ), QStringLiteral( "copc" ) );
+  QVERIFY( layer->isValid() );
+  QgsPointCloudIndex *index = layer->dataProvider()->index();
+  QVERIFY( index->hasNode( index->root() ) );
+  QVERIFY( index->hasNode( IndexedPointCloudNode::fromString( QStringLiteral( "1-0-0-0" ) ) ) );
+  QVERIFY( !index->hasNode( IndexedPointCloudNode::fromString( QStringLiteral( "1-1-1-1" ) ) ) );
+}
+
+void TestQgsCopcProvider::calculateStatistics()
+{
+  // work on a copy of the sample, as statistics are written next to the file
+  QTemporaryDir dir;
+  QVERIFY( dir.isValid() );
+  const QString fileName = dir.filePath( QStringLiteral( "sample.copc.laz" ) );
+  QVERIFY( QFile::copy( mTestDataDir + QStringLiteral( "point_clouds/copc/sample.copc.laz" ), fileName ) );
+
+  QgsPointCloudLayer::LayerOptions options;
+  options.skipStatisticsCalculation = true;
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( fileName, QStringLiteral( "layer" ), QStringLiteral( "copc" ), options );
+  QVERIFY( layer->isValid() );
+  QVERIFY( layer->dataProvider()->calculateStatistics() );
+  const QgsPointCloudStatistics stats = layer->dataProvider()->statistics();
+  QVERIFY( stats.isValid() );
+  QCOMPARE( stats.pointCount(), 35 );
+  QVERIFY( QFile::exists( dir.filePath( QStringLiteral( "sample.copc-stats.json" ) ) ) );
+
+  // COPC files have no statistics in their metadata, so the histogram ranges are taken from the root node,
+  // whose intensities are 0 to 19: the intensities of the other nodes (100 to 109 and 200 to 204) are out of the histogram
+  const QgsPointCloudAttributeStatistics intensity = stats.attributeStatistics( QStringLiteral( "Intensity" ) );
+  QCOMPARE( intensity.count, qint64( 35 ) );
+  QCOMPARE( intensity.minimum, 0.0 );
+  QCOMPARE( intensity.maximum, 204.0 );
+  QCOMPARE( intensity.histogramMinimum, 0.0 );
+  QCOMPARE( intensity.histogramMaximum, 19.0 );
+  QCOMPARE( std::accumulate( intensity.histogram.constBegin(), intensity.histogram.constEnd(), qint64( 0 ) ), qint64( 20 ) );
+  QCOMPARE( intensity.histogram.constLast(), qint64( 1 ) );
+  QCOMPARE( intensity.belowHistogramCount, qint64( 0 ) );
+  QCOMPARE( intensity.aboveHistogramCount, qint64( 15 ) );
+
+  QCOMPARE( stats.classes( QStringLiteral( "Classification" ) ), QVariantList() << 40 << 41 << 42 );
+  QCOMPARE( stats.classStatistic( QStringLiteral( "Classification" ), 41, QgsStatisticalSummary::Count ).toInt(), 10 );
+}
+
+QGSTEST_MAIN( TestQgsCopcProvider )
+#include "testqgscopcprovider.moc"
@@ -14,6 +14,7 @@
  ***************************************************************************/
 
 #include <limits>
+#include <numeric>
 
 #include "qgstest.h"
 #include <QObject>
@@ -22,6 +23,11 @@
 #include <QApplication>
 #include <QFileInfo>
 #include <QDir>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QSignalSpy>
+#include <QThreadPool>
 
 //qgis includes...
 #include "qgis.h"
@@ -31,6 +37,47 @@
 #include "qgspointcloudlayer.h"
 #include "qgspointcloudindex.h"
 #include "qgspointcloudlayerelevationproperties.h"
+#include "qgspointcloudrequest.h"
+#include "qgspointcloudblock.h"
+#include "qgspointcloudstatistics.h"
+#include "qgspointcloudblockrequest.h"
+#include "qgspointcloudattributebyramprenderer.h"
+#include "qgsmaplayerrenderer.h"
+#include "qgsmapsettings.h"
+#include "qgsmultirenderchecker.h"
+#include "qgsnetworkaccessmanager.h"
+#include "qgsrendercontext.h"
+
+/**
+ * Point cloud renderer stopping the rendering once it has drawn a number of blocks,
+ * like a render canceled by the user while the following nodes are being decoded
+ */
+class TestStoppingRenderer : public QgsPointCloudAttributeByRampRenderer
+{
+  public:
+    TestStoppingRenderer( int stopAfterBlocks, std::shared_ptr< int > blocksRendered )
+      : mStopAfterBlocks( stopAfterBlocks )
+      , mBlocksRendered( blocksRendered )
+    {
+      setMaximumScreenError( 0.1 );
+    }
+
+    QgsPointCloudRenderer *clone() const override
+    {
+      return new TestStoppingRenderer( mStopAfterBlocks, mBlocksRendered );
+    }
+
+    void renderBlock( const QgsPointCloudBlock *block, QgsPointCloudRenderContext &context ) override
+    {
+      QgsPointCloudAttributeByRampRenderer::renderBlock( block, context );
+      if ( ++*mBlocksRendered >= mStopAfterBlocks )
+        context.renderContext().setRenderingStopped( true );
+    }
+
+  private:
+    int mStopAfterBlocks = 0;
+    std::shared_ptr< int > mBlocksRendered;
+};
 
 /**
  * \ingroup UnitTests
@@ -58,10 +105,21 @@ class TestQgsEptProvider : public QObject
     void attributes();
     void calculateZRange();
     void testIdentify();
+    void nodeDataCache();
+    void calculateStatistics();
+    void calculateStatisticsInBackground();
+    void renderMultipleDecodeThreads();
+    void cancelRenderLocal();
+    void cancelRenderRemote();
+    void cancelBlockRequests();
 
   private:
+    //! Renders \a layer with \a threads decoding threads, \a completed is set to FALSE if the rendering was stopped
+    QImage renderLayer( QgsPointCloudLayer *layer, int threads, bool &completed );
+
     QString mTestDataDir;
     QString mReport;
+    QString mRequestPreprocessorId;
 };
 
 //runs before all tests
@@ -73,11 +131,21 @@ void TestQgsEptProvider::initTestCase()
 
   mTestDataDir = QStringLiteral( TEST_DATA_DIR ) + '/'; //defined in CmakeLists.txt
   mReport = QStringLiteral( "<h1>EPT Provider Tests</h1>\n" );
+
+  // remote datasets are read from the local test data, using http://ept.test/ urls
+  const QString testDataUrl = QUrl::fromLocalFile( mTestDataDir ).toString();
+  mRequestPreprocessorId = QgsNetworkAccessManager::setRequestPreprocessor( [testDataUrl]( QNetworkRequest * request )
+  {
+    const QString url = request->url().toString();
+    if ( url.startsWith( QLatin1String( "http://ept.test/" ) ) )
+      request->setUrl( QUrl( testDataUrl + url.mid( 16 ) ) );
+  } );
 }
 
 //runs after all tests
 void TestQgsEptProvider::cleanupTestCase()
 {
+  QgsNetworkAccessManager::removeRequestPreprocessor( mRequestPreprocessorId );
   QgsApplication::exitQgis();
   QString myReportFile = QDir::tempPath() + "/qgistest.html";
   QFile myFile( myReportFile );
@@ -153,6 +221,7 @@ void TestQgsEptProvider::uriIsBlocklisted()
 {
   QVERIFY( !QgsProviderRegistry::instance()->uriIsBlocklisted( QStringLiteral( "/home/nyall/ept.json" ) ) );
   QVERIFY( QgsProviderRegistry::instance()->uriIsBlocklisted( QStringLiteral( "/home/nyall/ept-build.json" ) ) );
+  QVERIFY( QgsProviderRegistry::instance()->uriIsBlocklisted( QStringLiteral( "/home/nyall/ept-stats.json" ) ) );
 }
 
 void TestQgsEptProvider::brokenPath()
@@ -389,5 +458,338 @@ void TestQgsEptProvider::testIdentify()
 }
 
 
+void TestQgsEptProvider::nodeDataCache()
+{
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/ept/sunshine-coast/ept.json" ), QStringLiteral( "layer" ), QStringLiteral( "ept" ) );
+  QVERIFY( layer->isValid() );
+
+  QgsPointCloudIndex *index = layer->dataProvider()->index();
+  const IndexedPointCloudNode root = IndexedPointCloudNode::fromString( QStringLiteral( "0-0-0-0" ) );
+
+  QgsPointCloudAttributeCollection attributes;
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "X" ), QgsPointCloudAttribute::Int32 ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Y" ), QgsPointCloudAttribute::Int32 ) );
+  QgsPointCloudRequest request;
+  request.setAttributes( attributes );
+
+  std::unique_ptr< QgsPointCloudBlock > block( index->nodeData( root, request ) );
+  QVERIFY( block );
+  QCOMPARE( block->pointCount(), 253 );
+
+  // a second layer with the same source must reuse the decoded block
+  std::unique_ptr< QgsPointCloudLayer > layer2 = std::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/ept/sunshine-coast/ept.json" ), QStringLiteral( "layer2" ), QStringLiteral( "ept" ) );
+  QVERIFY( layer2->isValid() );
+  std::unique_ptr< QgsPointCloudBlock > cachedBlock( layer2->dataProvider()->index()->nodeData( root, request ) );
+  QVERIFY( cachedBlock );
+  QCOMPARE( cachedBlock->pointCount(), 253 );
+  QCOMPARE( cachedBlock->data(), block->data() );
+
+  // a request for other attributes must not use the cached block
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Classification" ), QgsPointCloudAttribute::Char ) );
+  request.setAttributes( attributes );
+  std::unique_ptr< QgsPointCloudBlock > otherBlock( index->nodeData( root, request ) );
+  QVERIFY( otherBlock );
+  QCOMPARE( otherBlock->attributes().count(), 3 );
+  QVERIFY( otherBlock->data() != block->data() );
+
+  // disabling the cache
+  const int previousSize = QgsPointCloudIndex::maximumCacheSize();
+  QgsPointCloudIndex::setMaximumCacheSize( 0 );
+  QCOMPARE( QgsPointCloudIndex::maximumCacheSize(), 0 );
+  request.setAttributes( layer->attributes() );
+  std::unique_ptr< QgsPointCloudBlock > uncachedBlock1( index->nodeData( root, request ) );
+  std::unique_ptr< QgsPointCloudBlock > uncachedBlock2( index->nodeData( root, request ) );
+  QVERIFY( uncachedBlock1 );
+  QVERIFY( uncachedBlock2 );
+  QVERIFY( uncachedBlock1->data() != uncachedBlock2->data() );
+  QgsPointCloudIndex::setMaximumCacheSize( previousSize );
+}
+
+void TestQgsEptProvider::calculateStatistics()
+{
+  // work on a copy of the dataset, as statistics are written next to the index
+  QTemporaryDir dir;
+  const QString sourceDir = mTestDataDir + QStringLiteral( "point_clouds/ept/sunshine-coast" );
+  for ( const QString &file : { QStringLiteral( "ept.json" ), QStringLiteral( "ept-hierarchy/0-0-0-0.json" ), QStringLiteral( "ept-data/0-0-0-0.bin" ) } )
+  {
+    QVERIFY( QDir().mkpath( QFileInfo( dir.filePath( file ) ).absolutePath() ) );
+    QVERIFY( QFile::copy( sourceDir + '/' + file, dir.filePath( file ) ) );
+  }
+
+  QgsPointCloudLayer::LayerOptions options;
+  options.skipStatisticsCalculation = true;
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( dir.filePath( QStringLiteral( "ept.json" ) ), QStringLiteral( "layer" ), QStringLiteral( "ept" ), options );
+  QVERIFY( layer->isValid() );
+  QVERIFY( !layer->dataProvider()->statistics().isValid() );
+
+  QVERIFY( layer->dataProvider()->calculateStatistics() );
+  QgsPointCloudStatistics stats = layer->dataProvider()->statistics();
+  QVERIFY( stats.isValid() );
+  QCOMPARE( stats.pointCount(), 253 );
+  QCOMPARE( stats.statistic( QStringLiteral( "Intensity" ), QgsStatisticalSummary::Count ).toInt(), 253 );
+  QCOMPARE( stats.statistic( QStringLiteral( "Intensity" ), QgsStatisticalSummary::Min ).toInt(), 199 );
+  QCOMPARE( stats.statistic( QStringLiteral( "Intensity" ), QgsStatisticalSummary::Max ).toInt(), 2086 );
+  QGSCOMPARENEAR( stats.statistic( QStringLiteral( "Intensity" ), QgsStatisticalSummary::Mean ).toDouble(), 728.521739, 0.0001 );
+  QGSCOMPARENEAR( stats.statistic( QStringLiteral( "Z" ), QgsStatisticalSummary::Min ).toDouble(), 74.34, 0.0001 );
+  QGSCOMPARENEAR( stats.statistic( QStringLiteral( "Z" ), QgsStatisticalSummary::Max ).toDouble(), 80.02, 0.0001 );
+  QCOMPARE( stats.classes( QStringLiteral( "Classification" ) ), QVariantList() << 1 << 2 << 3 << 5 );
+  QCOMPARE( stats.classStatistic( QStringLiteral( "Classification" ), 2, QgsStatisticalSummary::Count ).toInt(), 160 );
+  QCOMPARE( stats.classStatistic( QStringLiteral( "Classification" ), 4, QgsStatisticalSummary::Count ), QVariant() );
+
+  const QgsPointCloudAttributeStatistics intensity = stats.attributeStatistics( QStringLiteral( "Intensity" ) );
+  QCOMPARE( intensity.histogram.size(), QgsPointCloudStatistics::HISTOGRAM_BIN_COUNT );
+  QCOMPARE( std::accumulate( intensity.histogram.constBegin(), intensity.histogram.constEnd(), qint64( 0 ) ), qint64( 253 ) );
+  QCOMPARE( intensity.belowHistogramCount, qint64( 0 ) );
+  QCOMPARE( intensity.aboveHistogramCount, qint64( 0 ) );
+
+  // statistics are persisted, and read back by other providers for the same dataset
+  QVERIFY( QFile::exists( dir.filePath( QStringLiteral( "ept-stats.json" ) ) ) );
+  std::unique_ptr< QgsPointCloudLayer > layer2 = std::make_unique< QgsPointCloudLayer >( dir.filePath( QStringLiteral( "ept.json" ) ), QStringLiteral( "layer2" ), QStringLiteral( "ept" ) );
+  QVERIFY( layer2->isValid() );
+  stats = layer2->dataProvider()->statistics();
+  QVERIFY( stats.isValid() );
+  QCOMPARE( stats.pointCount(), 253 );
+  QCOMPARE( stats.statistic( QStringLiteral( "Intensity" ), QgsStatisticalSummary::Max ).toInt(), 2086 );
+  QCOMPARE( stats.attributeStatistics( QStringLiteral( "Intensity" ) ).histogram, intensity.histogram );
+  QCOMPARE( stats.classStatistic( QStringLiteral( "Classification" ), 3, QgsStatisticalSummary::Count ).toInt(), 89 );
+
+  // statistics missing from the EPT metadata are taken from the calculated statistics
+  QVERIFY( !layer2->dataProvider()->index()->metadataStatistic( QStringLiteral( "Intensity" ), QgsStatisticalSummary::Sum ).isValid() );
+  QGSCOMPARENEAR( layer2->dataProvider()->metadataStatistic( QStringLiteral( "Intensity" ), QgsStatisticalSummary::Sum ).toDouble(), 184316, 0.01 );
+}
+
+void TestQgsEptProvider::calculateStatisticsInBackground()
+{
+  // work on a copy of the dataset, as statistics are written next to the index
+  QTemporaryDir dir;
+  const QString sourceDir = mTestDataDir + QStringLiteral( "point_clouds/ept/sunshine-coast" );
+  for ( const QString &file : { QStringLiteral( "ept.json" ), QStringLiteral( "ept-hierarchy/0-0-0-0.json" ), QStringLiteral( "ept-data/0-0-0-0.bin" ) } )
+  {
+    QVERIFY( QDir().mkpath( QFileInfo( dir.filePath( file ) ).absolutePath() ) );
+    QVERIFY( QFile::copy( sourceDir + '/' + file, dir.filePath( file ) ) );
+  }
+
+  // a layer loaded without stored statistics calculates them in a background task
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( dir.filePath( QStringLiteral( "ept.json" ) ), QStringLiteral( "layer" ), QStringLiteral( "ept" ) );
+  QVERIFY( layer->isValid() );
+
+  QElapsedTimer timer;
+  timer.start();
+  while ( !layer->dataProvider()->statistics().isValid() && timer.elapsed() < 30000 )
+    QCoreApplication::processEvents( QEventLoop::AllEvents, 100 );
+
+  const QgsPointCloudStatistics stats = layer->dataProvider()->statistics();
+  QVERIFY( stats.isValid() );
+  QCOMPARE( stats.pointCount(), 253 );
+  QCOMPARE( stats.statistic( QStringLiteral( "Intensity" ), QgsStatisticalSummary::Max ).toInt(), 2086 );
+  QVERIFY( QFile::exists( dir.filePath( QStringLiteral( "ept-stats.json" ) ) ) );
+}
+
+QImage TestQgsEptProvider::renderLayer( QgsPointCloudLayer *layer, int threads, bool &completed )
+{
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( QSize( 400, 400 ) );
+  mapSettings.setOutputDpi( 96 );
+  mapSettings.setDestinationCrs( layer->crs() );
+  mapSettings.setExtent( layer->extent() );
+  mapSettings.setLayers( QList< QgsMapLayer * >() << layer );
+
+  QImage image( mapSettings.outputSize(), QImage::Format_ARGB32_Premultiplied );
+  image.fill( Qt::white );
+  QPainter painter( &image );
+  QgsRenderContext context = QgsRenderContext::fromMapSettings( mapSettings );
+  context.setPainter( &painter );
+
+  const int maxThreads = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( threads );
+  std::unique_ptr< QgsMapLayerRenderer > renderer( layer->createMapRenderer( context ) );
+  completed = renderer->render();
+  renderer.reset();
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreads );
+
+  painter.end();
+  return image;
+}
+
+void TestQgsEptProvider::renderMultipleDecodeThreads()
+{
+  // disable the cache, so that all nodes get decoded
+  const int cacheSize = QgsPointCloudIndex::maximumCacheSize();
+  QgsPointCloudIndex::setMaximumCacheSize( 0 );
+
+  // render with several decoding threads, compared with the control image of the single threaded renderer tests
+  std::unique_ptr< QgsPointCloudLayer > rgbLayer = std::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/ept/rgb/ept.json" ), QStringLiteral( "layer" ), QStringLiteral( "ept" ) );
+  QVERIFY( rgbLayer->isValid() );
+  rgbLayer->renderer()->setPointSize( 2 );
+  rgbLayer->renderer()->setPointSizeUnit( QgsUnitTypes::RenderMillimeters );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( QSize( 400, 400 ) );
+  mapSettings.setOutputDpi( 96 );
+  mapSettings.setDestinationCrs( rgbLayer->crs() );
+  mapSettings.setExtent( QgsRectangle( 497753.5, 7050887.5, 497754.6, 7050888.6 ) );
+  mapSettings.setLayers( QList< QgsMapLayer * >() << rgbLayer.get() );
+
+  const int maxThreads = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 8 );
+  QgsMultiRenderChecker checker;
+  checker.setMapSettings( mapSettings );
+  checker.setControlPathPrefix( QStringLiteral( "pointcloudrenderer" ) );
+  checker.setControlName( QStringLiteral( "expected_rgb_render" ) );
+  const bool res = checker.runTest( QStringLiteral( "expected_rgb_render" ) );
+  mReport += checker.report();
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreads );
+  QVERIFY( res );
+
+  // nodes decoded by several threads, locally or after being downloaded, must be drawn in the same order
+  // as by a single thread
+  QgsPointCloudLayer::LayerOptions options;
+  options.skipStatisticsCalculation = true;
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/ept/lone-star-laszip/ept.json" ), QStringLiteral( "layer" ), QStringLiteral( "ept" ), options );
+  QVERIFY( layer->isValid() );
+  QCOMPARE( layer->dataProvider()->index()->accessType(), QgsPointCloudIndex::Local );
+  std::shared_ptr< int > blocksRendered = std::make_shared< int >( 0 );
+  layer->setRenderer( new TestStoppingRenderer( std::numeric_limits< int >::max(), blocksRendered ) );
+
+  std::unique_ptr< QgsPointCloudLayer > remoteLayer = std::make_unique< QgsPointCloudLayer >( QStringLiteral( "http://ept.test/point_clouds/ept/lone-star-laszip/ept.json" ), QStringLiteral( "layer" ), QStringLiteral( "ept" ), options );
+  QVERIFY( remoteLayer->isValid() );
+  QCOMPARE( remoteLayer->dataProvider()->index()->accessType(), QgsPointCloudIndex::Remote );
+  remoteLayer->setRenderer( new TestStoppingRenderer( std::numeric_limits< int >::max(), blocksRendered ) );
+
+  bool completed = false;
+  const QImage imageSingle = renderLayer( layer.get(), 1, completed );
+  QVERIFY( completed );
+  const int nodesCount = *blocksRendered;
+  QVERIFY( nodesCount > 2 );
+
+  QImage blankImage( imageSingle.size(), imageSingle.format() );
+  blankImage.fill( Qt::white );
+  QVERIFY( imageSingle != blankImage );
+
+  *blocksRendered = 0;
+  const QImage imageParallel = renderLayer( layer.get(), 8, completed );
+  QVERIFY( completed );
+  QCOMPARE( *blocksRendered, nodesCount );
+  QCOMPARE( imageParallel, imageSingle );
+
+  *blocksRendered = 0;
+  const QImage imageRemote = renderLayer( remoteLayer.get(), 8, completed );
+  QVERIFY( completed );
+  QCOMPARE( *blocksRendered, nodesCount );
+  QCOMPARE( imageRemote, imageSingle );
+
+  QgsPointCloudIndex::setMaximumCacheSize( cacheSize );
+}
+
+void TestQgsEptProvider::cancelRenderLocal()
+{
+  const int cacheSize = QgsPointCloudIndex::maximumCacheSize();
+  QgsPointCloudIndex::setMaximumCacheSize( 0 );
+
+  QgsPointCloudLayer::LayerOptions options;
+  options.skipStatisticsCalculation = true;
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/ept/lone-star-laszip/ept.json" ), QStringLiteral( "layer" ), QStringLiteral( "ept" ), options );
+  QVERIFY( layer->isValid() );
+
+  // the rendering is stopped after the second node, while the following ones are decoded ahead of it.
+  // These must be discarded without being drawn
+  std::shared_ptr< int > blocksRendered = std::make_shared< int >( 0 );
+  layer->setRenderer( new TestStoppingRenderer( 2, blocksRendered ) );
+
+  bool completed = true;
+  renderLayer( layer.get(), 8, completed );
+  QVERIFY( !completed );
+  QCOMPARE( *blocksRendered, 2 );
+
+  // same with a single decoding thread
+  *blocksRendered = 0;
+  renderLayer( layer.get(), 1, completed );
+  QVERIFY( !completed );
+  QCOMPARE( *blocksRendered, 2 );
+
+  QgsPointCloudIndex::setMaximumCacheSize( cacheSize );
+}
+
+void TestQgsEptProvider::cancelRenderRemote()
+{
+  const int cacheSize = QgsPointCloudIndex::maximumCacheSize();
+  QgsPointCloudIndex::setMaximumCacheSize( 0 );
+
+  QgsPointCloudLayer::LayerOptions options;
+  options.skipStatisticsCalculation = true;
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( QStringLiteral( "http://ept.test/point_clouds/ept/lone-star-laszip/ept.json" ), QStringLiteral( "layer" ), QStringLiteral( "ept" ), options );
+  QVERIFY( layer->isValid() );
+  QCOMPARE( layer->dataProvider()->index()->accessType(), QgsPointCloudIndex::Remote );
+
+  // the rendering is stopped after the second node, while the requests of the sliding window are still
+  // downloading or decoding their blocks. These requests must be deleted with their blocks
+  std::shared_ptr< int > blocksRendered = std::make_shared< int >( 0 );
+  layer->setRenderer( new TestStoppingRenderer( 2, blocksRendered ) );
+
+  bool completed = true;
+  renderLayer( layer.get(), 8, completed );
+  QVERIFY( !completed );
+  QCOMPARE( *blocksRendered, 2 );
+
+  // the requests left over must not deliver anything once control returns to the event loop
+  QCoreApplication::processEvents();
+  QCOMPARE( *blocksRendered, 2 );
+
+  QgsPointCloudIndex::setMaximumCacheSize( cacheSize );
+}
+
+void TestQgsEptProvider::cancelBlockRequests()
+{
+  const int cacheSize = QgsPointCloudIndex::maximumCacheSize();
+  QgsPointCloudIndex::setMaximumCacheSize( 0 );
+  const int maxThreads = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 8 );
+
+  QgsPointCloudLayer::LayerOptions options;
+  options.skipStatisticsCalculation = true;
+  std::unique_ptr< QgsPointCloudLayer > layer = std::make_unique< QgsPointCloudLayer >( QStringLiteral( "http://ept.test/point_clouds/ept/lone-star-laszip/ept.json" ), QStringLiteral( "layer" ), QStringLiteral( "ept" ), options );
+  QVERIFY( layer->isValid() );
+
+  QgsPointCloudIndex *index = layer->dataProvider()->index();
+  QgsPointCloudRequest request;
+  request.setAttributes( index->attributes() );
+
+  QList< IndexedPointCloudNode > nodes;
+  nodes << index->root();
+  nodes << index->nodeChildren( index->root() );
+  QVERIFY( nodes.size() > 1 );
+
+  std::vector< std::unique_ptr< QgsPointCloudBlockRequest > > requests;
+  std::vector< std::unique_ptr< QSignalSpy > > spies;
+  for ( const IndexedPointCloudNode &node : std::as_const( nodes ) )
+  {
+    requests.emplace_back( index->asyncNodeData( node, request ) );
+    QVERIFY( requests.back() );
+    spies.emplace_back( std::make_unique< QSignalSpy >( requests.back().get(), &QgsPointCloudBlockRequest::finished ) );
+  }
+
+  // blocks are decoded on the pool of the requests, several at once
+  QVERIFY( spies.front()->count() > 0 || spies.front()->wait( 30000 ) );
+  std::unique_ptr< QgsPointCloudBlock > block( requests.front()->block() );
+  QVERIFY( block );
+  QCOMPARE( block->pointCount(), 41998 );
+
+  // delete the other requests while they are still downloading or decoding. The blocks of the finished
+  // requests belong to the caller, the other ones are deleted with their request
+  for ( std::size_t i = 1; i < requests.size(); ++i )
+  {
+    if ( spies[i]->count() > 0 )
+      delete requests[i]->block();
+    spies[i].reset();
+    requests[i].reset();
+  }
+
+  // nothing is delivered once the decoding of the deleted requests finishes
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreads );
+  QCoreApplication::processEvents();
+
+  QgsPointCloudIndex::setMaximumCacheSize( cacheSize );
+}
+
 QGSTEST_MAIN( TestQgsEptProvider )
 #include "testqgseptprovider.moc"
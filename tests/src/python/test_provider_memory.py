@@ -1060,5 +1060,130 @@ class TestPyQgsMemoryProviderIndexed(unittest.TestCase, ProviderTestCase):
         pass
 
 
+
+class TestPyQgsMemoryProviderColumnar(unittest.TestCase, ProviderTestCase):
+    """Runs the provider test suite against a memory layer using columnar storage"""
+
+    @classmethod
+    def createLayer(cls):
+        vl = QgsVectorLayer(
+            'Point?crs=epsg:4326&field=pk:integer&field=cnt:integer&field=name:string(0)&field=name2:string(0)&field=num_char:string&field=dt:datetime&field=date:date&field=time:time&key=pk&storage=columnar',
+            'test', 'memory')
+        assert (vl.isValid())
+
+        f1 = QgsFeature()
+        f1.setAttributes(
+            [5, -200, NULL, 'NuLl', '5', QDateTime(QDate(2020, 5, 4), QTime(12, 13, 14)), QDate(2020, 5, 2),
+             QTime(12, 13, 1)])
+        f1.setGeometry(QgsGeometry.fromWkt('Point (-71.123 78.23)'))
+
+        f2 = QgsFeature()
+        f2.setAttributes([3, 300, 'Pear', 'PEaR', '3', NULL, NULL, NULL])
+
+        f3 = QgsFeature()
+        f3.setAttributes(
+            [1, 100, 'Orange', 'oranGe', '1', QDateTime(QDate(2020, 5, 3), QTime(12, 13, 14)), QDate(2020, 5, 3),
+             QTime(12, 13, 14)])
+        f3.setGeometry(QgsGeometry.fromWkt('Point (-70.332 66.33)'))
+
+        f4 = QgsFeature()
+        f4.setAttributes(
+            [2, 200, 'Apple', 'Apple', '2', QDateTime(QDate(2020, 5, 4), QTime(12, 14, 14)), QDate(2020, 5, 4),
+             QTime(12, 14, 14)])
+        f4.setGeometry(QgsGeometry.fromWkt('Point (-68.2 70.8)'))
+
+        f5 = QgsFeature()
+        f5.setAttributes(
+            [4, 400, 'Honey', 'Honey', '4', QDateTime(QDate(2021, 5, 4), QTime(13, 13, 14)), QDate(2021, 5, 4),
+             QTime(13, 13, 14)])
+        f5.setGeometry(QgsGeometry.fromWkt('Point (-65.32 78.3)'))
+
+        vl.dataProvider().addFeatures([f1, f2, f3, f4, f5])
+        return vl
+
+    @classmethod
+    def setUpClass(cls):
+        """Run before all tests"""
+        # Create test layer
+        cls.vl = cls.createLayer()
+        assert (cls.vl.isValid())
+        cls.source = cls.vl.dataProvider()
+
+        # poly layer
+        cls.poly_vl = QgsVectorLayer('Polygon?crs=epsg:4326&index=yes&field=pk:integer&key=pk&storage=columnar',
+                                     'test', 'memory')
+        assert (cls.poly_vl.isValid())
+        cls.poly_provider = cls.poly_vl.dataProvider()
+
+        f1 = QgsFeature()
+        f1.setAttributes([1])
+        f1.setGeometry(QgsGeometry.fromWkt(
+            'Polygon ((-69.0 81.4, -69.0 80.2, -73.7 80.2, -73.7 76.3, -74.9 76.3, -74.9 81.4, -69.0 81.4))'))
+
+        f2 = QgsFeature()
+        f2.setAttributes([2])
+        f2.setGeometry(QgsGeometry.fromWkt('Polygon ((-67.6 81.2, -66.3 81.2, -66.3 76.9, -67.6 76.9, -67.6 81.2))'))
+
+        f3 = QgsFeature()
+        f3.setAttributes([3])
+        f3.setGeometry(QgsGeometry.fromWkt('Polygon ((-68.4 75.8, -67.5 72.6, -68.6 73.7, -70.2 72.9, -68.4 75.8))'))
+
+        f4 = QgsFeature()
+        f4.setAttributes([4])
+
+        cls.poly_provider.addFeatures([f1, f2, f3, f4])
+
+    @classmethod
+    def tearDownClass(cls):
+        """Run after all tests"""
+
+    def getEditableLayer(self):
+        return self.createLayer()
+
+    def testUri(self):
+        """Test that the storage mode is kept in the layer uri"""
+        self.assertIn('storage=columnar', self.source.dataSourceUri())
+        vl = QgsVectorLayer(self.source.dataSourceUri(), 'test', 'memory')
+        self.assertTrue(vl.isValid())
+        self.assertIn('storage=columnar', vl.dataProvider().dataSourceUri())
+
+        layer = QgsMemoryProviderUtils.createMemoryLayer('my name', QgsFields(), QgsWkbTypes.Point, QgsCoordinateReferenceSystem(), True)
+        self.assertTrue(layer.isValid())
+        self.assertIn('storage=columnar', layer.dataProvider().dataSourceUri())
+
+    def testEditColumns(self):
+        """Test editing features and attributes stored in columns"""
+        vl = self.createLayer()
+        pr = vl.dataProvider()
+
+        # iterators keep using the features as they were when they were created
+        it = pr.getFeatures()
+
+        self.assertTrue(pr.changeAttributeValues({2: {2: 'Banana', 1: NULL}}))
+        self.assertTrue(pr.deleteFeatures([1, 4]))
+        self.assertTrue(pr.addAttributes([QgsField('flag', QVariant.Bool)]))
+        self.assertTrue(pr.changeAttributeValues({3: {8: True}}))
+        self.assertTrue(pr.deleteAttributes([4]))
+        self.assertTrue(pr.changeGeometryValues({5: QgsGeometry.fromWkt('Point (1 2)')}))
+
+        self.assertEqual([f['name'] for f in it], [NULL, 'Pear', 'Orange', 'Apple', 'Honey'])
+
+        features = {f.id(): f for f in pr.getFeatures()}
+        self.assertEqual(sorted(features.keys()), [2, 3, 5])
+        self.assertEqual(features[2].attributes(), [3, NULL, 'Banana', 'PEaR', NULL, NULL, NULL, NULL])
+        self.assertEqual(features[3]['flag'], True)
+        self.assertEqual(features[5]['name'], 'Honey')
+        self.assertEqual(features[5].geometry().asWkt(), 'Point (1 2)')
+        self.assertEqual(pr.extent().toString(), QgsRectangle(-70.332, 2, 1, 66.33).toString())
+
+        # only the requested attributes are read
+        request = QgsFeatureRequest().setSubsetOfAttributes(['name'], pr.fields()).setFlags(QgsFeatureRequest.NoGeometry)
+        f = next(pr.getFeatures(request))
+        self.assertEqual(f.attributes(), [NULL, NULL, 'Banana', NULL, NULL, NULL, NULL, NULL])
+        self.assertFalse(f.hasGeometry())
+
+        self.assertTrue(pr.truncate())
+        self.assertEqual(pr.featureCount(), 0)
+
 if __name__ == '__main__':
     unittest.main()
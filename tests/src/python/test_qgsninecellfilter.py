@@ -0,0 +1,95 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsNineCellFilter.
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+
+__author__ = 'Nyall Dawson'
+__date__ = '18/10/2021'
+__copyright__ = 'Copyright 2021, The QGIS Project'
+
+import math
+import os
+import struct
+import tempfile
+
+import qgis  # NOQA
+
+from osgeo import gdal
+
+from qgis.analysis import (QgsNineCellFilter,
+                           QgsSlopeFilter)
+from qgis.testing import start_app, unittest
+
+start_app()
+
+WIDTH = 20
+HEIGHT = 15
+
+
+class DoubleValueFilter(QgsNineCellFilter):
+    """
+    Filter implemented in Python, returning twice the value of the central cell
+    """
+
+    def processNineCellWindow(self, x11, x21, x31, x12, x22, x32, x13, x23, x33):
+        return x22 * 2
+
+
+class TestQgsNineCellFilter(unittest.TestCase):
+
+    def setUp(self):
+        self.temp_dir = tempfile.TemporaryDirectory()
+        self.input_file = os.path.join(self.temp_dir.name, 'dem.tif')
+
+        # a plane rising by 2 units per cell to the east
+        ds = gdal.GetDriverByName('GTiff').Create(self.input_file, WIDTH, HEIGHT, 1, gdal.GDT_Float32)
+        ds.SetGeoTransform([0, 1, 0, HEIGHT, 0, -1])
+        values = [2.0 * x for y in range(HEIGHT) for x in range(WIDTH)]
+        ds.GetRasterBand(1).WriteRaster(0, 0, WIDTH, HEIGHT, struct.pack('f' * len(values), *values))
+        ds = None
+
+    def tearDown(self):
+        self.temp_dir.cleanup()
+
+    def readOutput(self, path):
+        ds = gdal.Open(path)
+        self.assertIsNotNone(ds)
+        self.assertEqual(ds.RasterXSize, WIDTH)
+        self.assertEqual(ds.RasterYSize, HEIGHT)
+        data = ds.GetRasterBand(1).ReadRaster(0, 0, WIDTH, HEIGHT, buf_type=gdal.GDT_Float32)
+        return struct.unpack('f' * WIDTH * HEIGHT, data)
+
+    def testSlope(self):
+        """
+        Run a built-in filter from Python, which must not hold the GIL while the filter runs
+        """
+        output_file = os.path.join(self.temp_dir.name, 'slope.tif')
+        slope = QgsSlopeFilter(self.input_file, output_file, 'GTiff')
+        self.assertEqual(slope.processRaster(), 0)
+
+        values = self.readOutput(output_file)
+        expected = math.degrees(math.atan(2))
+        for y in range(1, HEIGHT - 1):
+            for x in range(1, WIDTH - 1):
+                self.assertAlmostEqual(values[y * WIDTH + x], expected, 3)
+
+    def testPythonFilter(self):
+        """
+        Run a filter implemented in Python, which is called from the worker threads
+        """
+        output_file = os.path.join(self.temp_dir.name, 'double.tif')
+        double_filter = DoubleValueFilter(self.input_file, output_file, 'GTiff')
+        self.assertEqual(double_filter.processRaster(), 0)
+
+        values = self.readOutput(output_file)
+        for y in range(HEIGHT):
+            for x in range(WIDTH):
+                self.assertEqual(values[y * WIDTH + x], 4.0 * x)
+
+
+if __name__ == '__main__':
+    unittest.main()
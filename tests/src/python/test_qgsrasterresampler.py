@@ -21,7 +21,8 @@ import qgis  # NOQA
 
 import os
 
-from qgis.PyQt.QtGui import qRed
+from qgis.PyQt.QtCore import QSize
+from qgis.PyQt.QtGui import qRed, qRgb, QImage
 
 from qgis.core import (QgsRasterLayer,
                        QgsRectangle,
@@ -213,7 +214,8 @@ class TestQgsRasterResampler(unittest.TestCase):
                                         [125, 125, 125, 125, 126, 126, 126, 126],
                                         [125, 125, 125, 125, 126, 126, 126, 126]])
 
-        # with resampling
+        # with resampling. The cubic resampler no longer uses GDAL, but gives the same results as GDAL's
+        # cubic RasterIO for these blocks, see testCubicResampleMatchesGdal
         filter.setZoomedInResampler(QgsCubicRasterResampler())
         block = filter.block(1, extent, 2, 2)
         self.checkBlockContents(block, [[124, 127], [125, 126]])
@@ -311,6 +313,32 @@ class TestQgsRasterResampler(unittest.TestCase):
                                  [126, 125, 127, 127, 126, 125, 125, 126]]
                                 )
 
+    def testCubicResampleMatchesGdal(self):
+        """
+        Compare the cubic resampler to GDAL's cubic RasterIO, which it replaces
+        """
+        width = 60
+        height = 45
+        values = [(x * 37 + y * 91 + (x * y) % 13 * 11) % 256 for y in range(height) for x in range(width)]
+        image = QImage(width, height, QImage.Format_ARGB32)
+        for y in range(height):
+            for x in range(width):
+                value = values[y * width + x]
+                image.setPixel(x, y, qRgb(value, value, value))
+
+        ds = gdal.GetDriverByName('MEM').Create('', width, height, 1, gdal.GDT_Byte)
+        ds.GetRasterBand(1).WriteRaster(0, 0, width, height, struct.pack('B' * len(values), *values))
+
+        # upsampling and downsampling
+        for size in (QSize(157, 101), QSize(23, 17)):
+            resampled = QgsCubicRasterResampler().resampleV2(image, size)
+            self.assertEqual(resampled.size(), size)
+            data = ds.GetRasterBand(1).ReadRaster(0, 0, width, height, size.width(), size.height(), resample_alg=gdal.GRIORA_Cubic)
+            expected = struct.unpack('B' * size.width() * size.height(), data)
+            for y in range(size.height()):
+                for x in range(size.width()):
+                    self.assertLessEqual(abs(qRed(resampled.pixel(x, y)) - expected[y * size.width() + x]), 1, (size, x, y))
+
     @contextmanager
     def setupGDALResampling(self):
 